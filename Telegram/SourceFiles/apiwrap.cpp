@@ -93,9 +93,11 @@ constexpr auto kUnreadMentionsPreloadIfLess = 5;
 constexpr auto kUnreadMentionsFirstRequestLimit = 10;
 constexpr auto kUnreadMentionsNextRequestLimit = 100;
 constexpr auto kSharedMediaLimit = 100;
+constexpr auto kFileReferenceMessagesLimit = 100;
 //constexpr auto kFeedMessagesLimit = 50; // #feed
 constexpr auto kReadFeaturedSetsTimeout = crl::time(1000);
 constexpr auto kFileLoaderQueueStopTimeout = crl::time(5000);
+constexpr auto kFileLoaderWorkersLimit = 4;
 //constexpr auto kFeedReadTimeout = crl::time(1000); // #feed
 constexpr auto kStickersByEmojiInvalidateTimeout = crl::time(60 * 60 * 1000);
 constexpr auto kNotifySettingSaveTimeout = crl::time(1000);
@@ -103,6 +105,14 @@ constexpr auto kDialogsFirstLoad = 20;
 constexpr auto kDialogsPerPage = 500;
 constexpr auto kBlockedFirstSlice = 16;
 
+[[nodiscard]] int FileLoaderWorkersCount() {
+	// Each worker may hold a few decoded full size images at once.
+	return std::clamp(
+		QThread::idealThreadCount() / 2,
+		1,
+		kFileLoaderWorkersLimit);
+}
+
 using PhotoFileLocationId = Data::PhotoFileLocationId;
 using DocumentFileLocationId = Data::DocumentFileLocationId;
 using UpdatedFileReferences = Data::UpdatedFileReferences;
@@ -233,10 +243,15 @@ ApiWrap::ApiWrap(not_null<Main::Session*> session)
 , _draftsSaveTimer([=] { saveDraftsToCloud(); })
 , _featuredSetsReadTimer([=] { readFeaturedSets(); })
 , _dialogsLoadState(std::make_unique<DialogsLoadState>())
-, _fileLoader(std::make_unique<TaskQueue>(kFileLoaderQueueStopTimeout))
+, _fileLoader(std::make_unique<TaskQueue>(
+	kFileLoaderQueueStopTimeout,
+	FileLoaderWorkersCount()))
 //, _feedReadTimer([=] { readFeeds(); }) // #feed
 , _proxyPromotionTimer([=] { refreshProxyPromotion(); })
 , _updateNotifySettingsTimer([=] { sendNotifySettingsUpdates(); })
+, _fileReferenceMessagesDelayed([=] {
+	sendMessageFileReferenceRequests();
+})
 , _selfDestruct(std::make_unique<Api::SelfDestruct>(this))
 , _sensitiveContent(std::make_unique<Api::SensitiveContent>(this)) {
 	crl::on_main([=] {
@@ -1810,10 +1825,17 @@ void ApiWrap::scheduleStickerSetRequest(uint64 setId, uint64 access) {
 }
 
 void ApiWrap::requestStickerSets() {
+	auto readLocally = false;
 	for (auto i = _stickerSetRequests.begin(), j = i, e = _stickerSetRequests.end(); i != e; i = j) {
 		++j;
 		if (i.value().second) continue;
 
+		if (Local::readStickerSetStickers(i.key())) {
+			_stickerSetRequests.erase(i);
+			readLocally = true;
+			continue;
+		}
+
 		auto waitMs = (j == e) ? 0 : kSmallDelayMs;
 		i.value().second = request(MTPmessages_GetStickerSet(MTP_inputStickerSetID(MTP_long(i.key()), MTP_long(i.value().first)))).done([this, setId = i.key()](const MTPmessages_StickerSet &result) {
 			gotStickerSet(setId, result);
@@ -1821,6 +1843,9 @@ void ApiWrap::requestStickerSets() {
 			_stickerSetRequests.remove(setId);
 		}).afterDelay(waitMs).send();
 	}
+	if (readLocally) {
+		_session->data().notifyStickersUpdated();
+	}
 }
 
 void ApiWrap::saveStickerSets(
@@ -2771,41 +2796,109 @@ void ApiWrap::requestFileReference(
 
 	request(std::move(data)).done([=](const auto &result) {
 		const auto parsed = Data::GetFileReferences(result);
-		for (const auto &p : parsed.data) {
-			// Unpack here the parsed pair by hand to workaround a GCC bug.
-			// See https://gcc.gnu.org/bugzilla/show_bug.cgi?id=87122
-			const auto &origin = p.first;
-			const auto &reference = p.second;
-			const auto documentId = base::get_if<DocumentFileLocationId>(
-				&origin);
-			if (documentId) {
-				_session->data().document(
-					documentId->id
-				)->refreshFileReference(reference);
+		applyFileReferences(parsed);
+		finishFileReferenceRequest(origin, parsed);
+	}).fail([=](const RPCError &error) {
+		finishFileReferenceRequest(origin, UpdatedFileReferences());
+	}).send();
+}
+
+void ApiWrap::requestMessageFileReference(
+		ChannelData *channel,
+		FullMsgId itemId,
+		FileReferencesHandler &&handler) {
+	const auto origin = Data::FileOrigin(itemId);
+	const auto i = _fileReferenceHandlers.find(origin);
+	if (i != end(_fileReferenceHandlers)) {
+		i->second.push_back(std::move(handler));
+		return;
+	}
+	auto handlers = std::vector<FileReferencesHandler>();
+	handlers.push_back(std::move(handler));
+	_fileReferenceHandlers.emplace(origin, std::move(handlers));
+
+	// Opening an old chat may expire references of many files at once,
+	// we refresh all of them with one request per channel.
+	_fileReferenceMessages[channel].push_back(itemId);
+	_fileReferenceMessagesDelayed.call();
+}
+
+void ApiWrap::sendMessageFileReferenceRequests() {
+	for (auto &[channel, itemIds] : base::take(_fileReferenceMessages)) {
+		const auto count = int(itemIds.size());
+		for (auto from = 0; from < count;) {
+			const auto till = std::min(
+				from + kFileReferenceMessagesLimit,
+				count);
+			auto ids = QVector<MTPInputMessage>();
+			ids.reserve(till - from);
+			for (auto i = from; i != till; ++i) {
+				ids.push_back(MTP_inputMessageID(MTP_int(itemIds[i].msg)));
 			}
-			const auto photoId = base::get_if<PhotoFileLocationId>(&origin);
-			if (photoId) {
-				_session->data().photo(
-					photoId->id
-				)->refreshFileReference(reference);
+			const auto origins = std::vector<FullMsgId>(
+				begin(itemIds) + from,
+				begin(itemIds) + till);
+			const auto done = [=](const MTPmessages_Messages &result) {
+				const auto parsed = Data::GetFileReferences(result);
+				applyFileReferences(parsed);
+				for (const auto &itemId : origins) {
+					finishFileReferenceRequest(itemId, parsed);
+				}
+			};
+			const auto fail = [=](const RPCError &error) {
+				for (const auto &itemId : origins) {
+					finishFileReferenceRequest(
+						itemId,
+						UpdatedFileReferences());
+				}
+			};
+			if (channel) {
+				request(MTPchannels_GetMessages(
+					channel->inputChannel,
+					MTP_vector<MTPInputMessage>(ids)
+				)).done(done).fail(fail).send();
+			} else {
+				request(MTPmessages_GetMessages(
+					MTP_vector<MTPInputMessage>(ids)
+				)).done(done).fail(fail).send();
 			}
+			from = till;
 		}
-		const auto i = _fileReferenceHandlers.find(origin);
-		Assert(i != end(_fileReferenceHandlers));
-		auto handlers = std::move(i->second);
-		_fileReferenceHandlers.erase(i);
-		for (auto &handler : handlers) {
-			handler(parsed);
+	}
+}
+
+void ApiWrap::applyFileReferences(const UpdatedFileReferences &data) {
+	for (const auto &p : data.data) {
+		// Unpack here the parsed pair by hand to workaround a GCC bug.
+		// See https://gcc.gnu.org/bugzilla/show_bug.cgi?id=87122
+		const auto &origin = p.first;
+		const auto &reference = p.second;
+		const auto documentId = base::get_if<DocumentFileLocationId>(
+			&origin);
+		if (documentId) {
+			_session->data().document(
+				documentId->id
+			)->refreshFileReference(reference);
 		}
-	}).fail([=](const RPCError &error) {
-		const auto i = _fileReferenceHandlers.find(origin);
-		Assert(i != end(_fileReferenceHandlers));
-		auto handlers = std::move(i->second);
-		_fileReferenceHandlers.erase(i);
-		for (auto &handler : handlers) {
-			handler(UpdatedFileReferences());
+		const auto photoId = base::get_if<PhotoFileLocationId>(&origin);
+		if (photoId) {
+			_session->data().photo(
+				photoId->id
+			)->refreshFileReference(reference);
 		}
-	}).send();
+	}
+}
+
+void ApiWrap::finishFileReferenceRequest(
+		Data::FileOrigin origin,
+		const UpdatedFileReferences &data) {
+	const auto i = _fileReferenceHandlers.find(origin);
+	Assert(i != end(_fileReferenceHandlers));
+	auto handlers = std::move(i->second);
+	_fileReferenceHandlers.erase(i);
+	for (auto &handler : handlers) {
+		handler(data);
+	}
 }
 
 void ApiWrap::refreshFileReference(
@@ -2850,17 +2943,11 @@ void ApiWrap::refreshFileReference(
 				request(MTPmessages_GetScheduledMessages(
 					item->history()->peer->input,
 					MTP_vector<MTPint>(1, MTP_int(realId))));
-			} else if (const auto channel = item->history()->peer->asChannel()) {
-				request(MTPchannels_GetMessages(
-					channel->inputChannel,
-					MTP_vector<MTPInputMessage>(
-						1,
-						MTP_inputMessageID(MTP_int(item->id)))));
 			} else {
-				request(MTPmessages_GetMessages(
-					MTP_vector<MTPInputMessage>(
-						1,
-						MTP_inputMessageID(MTP_int(item->id)))));
+				requestMessageFileReference(
+					item->history()->peer->asChannel(),
+					data,
+					std::move(handler));
 			}
 		} else {
 			fail();
@@ -4529,7 +4616,8 @@ void ApiWrap::sendVoiceMessage(
 		QByteArray result,
 		VoiceWaveform waveform,
 		int duration,
-		const SendAction &action) {
+		const SendAction &action,
+		uint64 streamedId) {
 	const auto caption = TextWithTags();
 	const auto to = fileLoadTaskOptions(action);
 	_fileLoader->addTask(std::make_unique<FileLoadTask>(
@@ -4537,7 +4625,8 @@ void ApiWrap::sendVoiceMessage(
 		duration,
 		waveform,
 		to,
-		caption));
+		caption,
+		streamedId));
 }
 
 void ApiWrap::editMedia(
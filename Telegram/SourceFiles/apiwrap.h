@@ -391,7 +391,8 @@ public:
 		QByteArray result,
 		VoiceWaveform waveform,
 		int duration,
-		const SendAction &action);
+		const SendAction &action,
+		uint64 streamedId = 0);
 	void sendFiles(
 		Storage::PreparedList &&list,
 		SendMediaType type,
@@ -655,6 +656,15 @@ private:
 		Data::FileOrigin origin,
 		FileReferencesHandler &&handler,
 		Request &&data);
+	void requestMessageFileReference(
+		ChannelData *channel,
+		FullMsgId itemId,
+		FileReferencesHandler &&handler);
+	void sendMessageFileReferenceRequests();
+	void applyFileReferences(const UpdatedFileReferences &data);
+	void finishFileReferenceRequest(
+		Data::FileOrigin origin,
+		const UpdatedFileReferences &data);
 
 	void photoUploadReady(const FullMsgId &msgId, const MTPInputFile &file);
 
@@ -797,6 +807,10 @@ private:
 	std::map<
 		Data::FileOrigin,
 		std::vector<FileReferencesHandler>> _fileReferenceHandlers;
+	base::flat_map<
+		ChannelData*,
+		std::vector<FullMsgId>> _fileReferenceMessages;
+	SingleQueuedInvokation _fileReferenceMessagesDelayed;
 
 	mtpRequestId _deepLinkInfoRequestId = 0;
 
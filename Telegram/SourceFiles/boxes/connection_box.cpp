@@ -38,6 +38,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace {
 
 constexpr auto kSaveSettingsDelayedTimeout = crl::time(1000);
+constexpr auto kMaxParallelProxyCheckers = 8;
 
 using ProxyData = MTP::ProxyData;
 
@@ -991,8 +992,27 @@ ProxiesBoxController::ProxiesBoxController()
 		}
 	});
 
+	checkWaitingProxies();
+}
+
+void ProxiesBoxController::checkWaitingProxies() {
+	// Items in Checking state without checkers are waiting for their turn,
+	// so that a long list doesn't open dozens of connections at once.
+	const auto running = [](const Item &item) {
+		return (item.checker != nullptr) || (item.checkerv6 != nullptr);
+	};
+	auto count = int(ranges::count_if(_list, running));
 	for (auto &item : _list) {
-		refreshChecker(item);
+		if (count >= kMaxParallelProxyCheckers) {
+			break;
+		} else if (item.state == ItemState::Checking && !running(item)) {
+			refreshChecker(item);
+			if (running(item)) {
+				++count;
+			} else {
+				updateView(item);
+			}
+		}
 	}
 }
 
@@ -1120,6 +1140,7 @@ void ProxiesBoxController::setupChecker(int id, const Checker &checker) {
 			item->ping = pingTime;
 			updateView(*item);
 		}
+		checkWaitingProxies();
 	});
 	const auto failed = [=] {
 		const auto item = findById(id);
@@ -1133,6 +1154,7 @@ void ProxiesBoxController::setupChecker(int id, const Checker &checker) {
 			&& item->state == ItemState::Checking) {
 			item->state = ItemState::Unavailable;
 			updateView(*item);
+			checkWaitingProxies();
 		}
 	};
 	pointer->connect(pointer, &Connection::disconnected, failed);
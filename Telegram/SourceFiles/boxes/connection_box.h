@@ -91,6 +91,7 @@ private:
 	std::vector<Item>::iterator findByProxy(const ProxyData &proxy);
 	void setDeleted(int id, bool deleted);
 	void updateView(const Item &item);
+	void checkWaitingProxies();
 	void share(const ProxyData &proxy);
 	void saveDelayed();
 	void refreshChecker(Item &item);
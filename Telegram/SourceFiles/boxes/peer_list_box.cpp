@@ -715,6 +715,7 @@ void PeerListContent::addToSearchIndex(not_null<PeerListRow*> row) {
 	for (auto ch : row->nameFirstLetters()) {
 		_searchIndex[ch].push_back(row);
 	}
+	_searchIndexChanged = true;
 }
 
 void PeerListContent::removeFromSearchIndex(not_null<PeerListRow*> row) {
@@ -1363,18 +1364,46 @@ void PeerListContent::searchQueryChanged(QString query) {
 	auto searchWordsList = TextUtilities::PrepareSearchWords(query);
 	auto normalizedQuery = searchWordsList.join(' ');
 	if (_normalizedSearchQuery != normalizedQuery) {
+		// If each previous word is a prefix of some new word and the index
+		// didn't change, the new results are a subset of the previous ones.
+		const auto previousWords = _normalizedSearchQuery.isEmpty()
+			? QStringList()
+			: _normalizedSearchQuery.split(' ');
+		const auto narrowing = !previousWords.isEmpty()
+			&& !_searchIndexChanged
+			&& ranges::all_of(previousWords, [&](const QString &word) {
+				return ranges::any_of(searchWordsList, [&](
+						const QString &searchWord) {
+					return searchWord.startsWith(word);
+				});
+			});
+		auto previousResults = std::vector<not_null<PeerListRow*>>();
+		if (narrowing) {
+			previousResults.reserve(_filterResults.size());
+			for (const auto row : _filterResults) {
+				if (!row->isSearchResult()) {
+					previousResults.push_back(row);
+				}
+			}
+		}
 		setSearchQuery(query, normalizedQuery);
 		if (_controller->searchInLocal() && !searchWordsList.isEmpty()) {
+			_searchIndexChanged = false;
 			auto minimalList = (const std::vector<not_null<PeerListRow*>>*)nullptr;
-			for_const (auto &searchWord, searchWordsList) {
-				auto searchWordStart = searchWord[0].toLower();
-				auto it = _searchIndex.find(searchWordStart);
-				if (it == _searchIndex.cend()) {
-					// Some word can't be found in any row.
-					minimalList = nullptr;
-					break;
-				} else if (!minimalList || minimalList->size() > it->second.size()) {
-					minimalList = &it->second;
+			if (narrowing) {
+				minimalList = &previousResults;
+			} else {
+				for_const (auto &searchWord, searchWordsList) {
+					auto searchWordStart = searchWord[0].toLower();
+					auto it = _searchIndex.find(searchWordStart);
+					if (it == _searchIndex.cend()) {
+						// Some word can't be found in any row.
+						minimalList = nullptr;
+						break;
+					} else if (!minimalList
+						|| minimalList->size() > it->second.size()) {
+						minimalList = &it->second;
+					}
 				}
 			}
 			if (minimalList) {
@@ -1445,6 +1474,7 @@ void PeerListContent::restoreState(
 	auto query = state->searchQuery;
 	auto searchWords = TextUtilities::PrepareSearchWords(query);
 	setSearchQuery(query, searchWords.join(' '));
+	_searchIndexChanged = true;
 	for (auto peer : state->filterResults) {
 		if (auto existingRow = findRow(peer->id)) {
 			_filterResults.push_back(existingRow);
@@ -624,6 +624,7 @@ private:
 	std::map<PeerData*, std::vector<not_null<PeerListRow*>>> _rowsByPeer;
 
 	std::map<QChar, std::vector<not_null<PeerListRow*>>> _searchIndex;
+	bool _searchIndexChanged = false;
 	QString _searchQuery;
 	QString _normalizedSearchQuery;
 	QString _mentionHighlight;
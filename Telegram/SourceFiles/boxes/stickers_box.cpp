@@ -959,7 +959,12 @@ void StickersBox::Inner::validateLottieAnimation(not_null<Row*> set) {
 	set->lottie->updates(
 	) | rpl::start_with_next([=] {
 		updateRowThumbnail(set);
-	}, lifetime());
+	}, set->lottieLifetime);
+}
+
+void StickersBox::Inner::destroyLottieAnimation(not_null<Row*> set) {
+	set->lottieLifetime.destroy();
+	set->lottie = nullptr;
 }
 
 void StickersBox::Inner::updateRowThumbnail(not_null<Row*> set) {
@@ -1641,7 +1646,7 @@ void StickersBox::Inner::updateRows() {
 			if (sticker) {
 				if ((row->thumbnail.get() != thumbnail.get())
 					|| (!thumbnail && row->sticker != sticker)) {
-					row->lottie = nullptr;
+					destroyLottieAnimation(row.get());
 				}
 				row->thumbnail = thumbnail;
 				row->sticker = sticker;
@@ -1879,9 +1884,24 @@ void StickersBox::Inner::visibleTopBottomUpdated(
 	if (_section == Section::Featured) {
 		readVisibleSets();
 	}
+	clearHiddenLottieData();
 	checkLoadMore();
 }
 
+void StickersBox::Inner::clearHiddenLottieData() {
+	// Keep the animated thumbnails one screen around the visible area,
+	// they'll be created again in paintRowThumbnail() when needed.
+	const auto visibleHeight = _visibleBottom - _visibleTop;
+	const auto top = _visibleTop - _itemsTop - visibleHeight;
+	const auto bottom = _visibleBottom - _itemsTop + visibleHeight;
+	for (auto i = 0, count = int(_rows.size()); i != count; ++i) {
+		const auto rowTop = i * _rowHeight;
+		if (i != _above && (rowTop + _rowHeight <= top || rowTop >= bottom)) {
+			destroyLottieAnimation(_rows[i].get());
+		}
+	}
+}
+
 void StickersBox::Inner::checkLoadMore() {
 	if (_loadMoreCallback) {
 		auto scrollHeight = (_visibleBottom - _visibleTop);
@@ -255,6 +255,7 @@ private:
 		anim::value yadd;
 		std::unique_ptr<Ui::RippleAnimation> ripple;
 		std::unique_ptr<Lottie::SinglePlayer> lottie;
+		rpl::lifetime lottieLifetime;
 	};
 	struct MegagroupSet {
 		inline bool operator==(const MegagroupSet &other) const {
@@ -301,6 +302,8 @@ private:
 	void setActionSel(int32 actionSel);
 	float64 aboveShadowOpacity() const;
 	void validateLottieAnimation(not_null<Row*> set);
+	void clearHiddenLottieData();
+	void destroyLottieAnimation(not_null<Row*> set);
 	void updateRowThumbnail(not_null<Row*> set);
 
 	void readVisibleSets();
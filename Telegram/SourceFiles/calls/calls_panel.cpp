@@ -846,6 +846,11 @@ void Panel::stateChanged(State state) {
 			auto incomingWaiting = _call->isIncomingWaiting();
 			if (incomingWaiting) {
 				_updateOuterRippleTimer.callEach(Call::kSoundSampleMs);
+			} else if (_updateOuterRippleTimer.isActive()) {
+				// The waiting sound is over, don't wake up ten times
+				// a second for the rest of the call.
+				_updateOuterRippleTimer.cancel();
+				_answerHangupRedial->setOuterValue(0.);
 			}
 			toggleButton(_decline, incomingWaiting);
 			toggleButton(_cancel, (state == State::Busy));
@@ -42,6 +42,8 @@ private:
 	base::weak_ptr<Call> _call;
 	QPointer<Ui::FlatLabel> _text;
 	base::Timer _updateTextTimer;
+	crl::time _lastUpdateTime = 0;
+	crl::time _maxUpdateLag = 0;
 
 };
 
@@ -66,8 +68,19 @@ void DebugInfoBox::prepare() {
 }
 
 void DebugInfoBox::updateText() {
+	// The timer lag shows how busy the main thread is, which helps
+	// to tell UI stalls apart from network problems in the call log.
+	const auto now = crl::now();
+	const auto passed = _lastUpdateTime ? (now - _lastUpdateTime) : 0;
+	const auto lag = std::max(passed - kUpdateDebugTimeoutMs, crl::time(0));
+	_lastUpdateTime = now;
+	accumulate_max(_maxUpdateLag, lag);
+
 	if (auto call = _call.get()) {
-		_text->setText(call->getDebugLog());
+		_text->setText(call->getDebugLog()
+			+ qsl("\nUI timer lag: %1 ms (max %2 ms)"
+			).arg(lag
+			).arg(_maxUpdateLag));
 	}
 }
 
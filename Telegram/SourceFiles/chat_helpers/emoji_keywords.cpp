@@ -172,26 +172,16 @@ void WriteLocalCache(const QString &id, const LangPackData &data) {
 
 void AppendFoundEmoji(
 		std::vector<Result> &result,
+		std::unordered_set<EmojiPtr> &added,
 		const QString &label,
 		const std::vector<LangPackEmoji> &list) {
-	// It is important that the 'result' won't relocate while inserting.
-	result.reserve(result.size() + list.size());
-	const auto alreadyBegin = begin(result);
-	const auto alreadyEnd = alreadyBegin + result.size();
-
-	auto &&add = ranges::view::all(
-		list
-	) | ranges::view::filter([&](const LangPackEmoji &entry) {
-		const auto i = ranges::find(
-			alreadyBegin,
-			alreadyEnd,
-			entry.emoji,
-			&Result::emoji);
-		return (i == alreadyEnd);
-	}) | ranges::view::transform([&](const LangPackEmoji &entry) {
-		return Result{ entry.emoji, label, entry.text };
-	});
-	result.insert(end(result), add.begin(), add.end());
+	// Short prefixes match thousands of keywords, so the duplicates are
+	// checked in a hash set instead of a scan of the whole 'result'.
+	for (const auto &entry : list) {
+		if (added.emplace(entry.emoji).second) {
+			result.push_back({ entry.emoji, label, entry.text });
+		}
+	}
 }
 
 void AppendLegacySuggestions(
@@ -485,8 +475,9 @@ std::vector<Result> EmojiKeywords::LangPack::query(
 	});
 
 	auto result = std::vector<Result>();
+	auto added = std::unordered_set<EmojiPtr>();
 	for (const auto &[key, list] : chosen) {
-		AppendFoundEmoji(result, key, list);
+		AppendFoundEmoji(result, added, key, list);
 	}
 	return result;
 }
@@ -610,27 +601,23 @@ std::vector<Result> EmojiKeywords::query(
 		return {};
 	}
 	auto result = std::vector<Result>();
+	auto added = std::unordered_set<EmojiPtr>();
 	for (const auto &[language, item] : _data) {
-		const auto list = item->query(normalized, exact);
-
-		// It is important that the 'result' won't relocate while inserting.
-		result.reserve(result.size() + list.size());
-		const auto alreadyBegin = begin(result);
-		const auto alreadyEnd = alreadyBegin + result.size();
-
-		auto &&add = ranges::view::all(
-			list
-		) | ranges::view::filter([&](Result entry) {
+		auto list = item->query(normalized, exact);
+		if (result.empty()) {
 			// In each item->query() result the list has no duplicates.
 			// So we need to check only for duplicates between queries.
-			const auto i = ranges::find(
-				alreadyBegin,
-				alreadyEnd,
-				entry.emoji,
-				&Result::emoji);
-			return (i == alreadyEnd);
-		});
-		result.insert(end(result), add.begin(), add.end());
+			result = std::move(list);
+			for (const auto &entry : result) {
+				added.emplace(entry.emoji);
+			}
+			continue;
+		}
+		for (auto &entry : list) {
+			if (added.emplace(entry.emoji).second) {
+				result.push_back(std::move(entry));
+			}
+		}
 	}
 	if (!exact) {
 		AppendLegacySuggestions(result, query);
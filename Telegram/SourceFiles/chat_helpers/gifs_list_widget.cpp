@@ -39,6 +39,7 @@ constexpr auto kSaveChosenTabTimeout = 1000;
 constexpr auto kSearchRequestDelay = 400;
 constexpr auto kInlineItemsMaxPerRow = 5;
 constexpr auto kSearchBotUsername = "gif"_cs;
+constexpr auto kScrollingTimeout = crl::time(100);
 
 } // namespace
 
@@ -294,6 +295,11 @@ void GifsListWidget::paintInlineItems(Painter &p, QRect clip) {
 	}
 	auto gifPaused = controller()->isGifPausedAtLeastFor(Window::GifPauseReason::SavedGifs);
 	InlineBots::Layout::PaintContext context(crl::now(), false, gifPaused, false);
+	if (_lastScrolled + kScrollingTimeout > context.ms) {
+		context.scrolling = true;
+		_updateInlineItems.callOnce(
+			_lastScrolled + kScrollingTimeout - context.ms);
+	}
 
 	auto top = st::stickerPanPadding;
 	auto fromx = rtl() ? (width() - clip.x() - clip.width()) : clip.x();
@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_keys.h"
 #include "apiwrap.h"
 #include "storage/localstorage.h"
+#include "storage/storage_cache_metrics.h"
 #include "mainwidget.h"
 #include "main/main_session.h"
 #include "mainwindow.h"
@@ -721,13 +722,12 @@ std::vector<not_null<DocumentData*>> GetListByEmoji(
 		TimeId date = 0;
 	};
 	auto result = std::vector<StickerWithDate>();
+	auto added = base::flat_set<not_null<DocumentData*>>();
 	auto &sets = session->data().stickerSetsRef();
 	auto setsToRequest = base::flat_map<uint64, uint64>();
 
 	const auto add = [&](not_null<DocumentData*> document, TimeId date) {
-		if (ranges::find(result, document, [](const StickerWithDate &data) {
-			return data.document;
-		}) == result.end()) {
+		if (added.emplace(document).second) {
 			result.push_back({ document, date });
 		}
 	};
@@ -799,6 +799,7 @@ std::vector<not_null<DocumentData*>> GetListByEmoji(
 				const auto date = usageDate
 					? usageDate
 					: InstallDate(document);
+				added.emplace(document);
 				result.push_back({
 					document,
 					date ? date : CreateRecentSortKey(document) });
@@ -1127,12 +1128,21 @@ auto LottieCachedFromContent(
 		baseKey.low + keyShift
 	};
 	const auto get = [=](FnMut<void(QByteArray &&cached)> handler) {
-		session->data().cacheBigFile().get(
-			key,
-			std::move(handler));
+		const auto started = crl::now();
+		session->data().cacheBigFile().get(key, [
+			=,
+			handler = std::move(handler)
+		](QByteArray &&cached) mutable {
+			Storage::CountCacheRead(
+				Storage::CacheKind::Sticker,
+				!cached.isEmpty(),
+				started);
+			handler(std::move(cached));
+		});
 	};
 	const auto weak = base::make_weak(session.get());
 	const auto put = [=](QByteArray &&cached) {
+		Storage::CountCacheWrite(Storage::CacheKind::Sticker, cached.size());
 		crl::on_main(weak, [=, data = std::move(cached)]() mutable {
 			weak->data().cacheBigFile().put(key, std::move(data));
 		});
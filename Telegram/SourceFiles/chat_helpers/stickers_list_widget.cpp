@@ -25,6 +25,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_keys.h"
 #include "mainwindow.h"
 #include "dialogs/dialogs_layout.h"
+#include "core/paint_profiler.h"
 #include "boxes/sticker_set_box.h"
 #include "boxes/stickers_box.h"
 #include "boxes/confirm_box.h"
@@ -44,6 +45,15 @@ namespace {
 constexpr auto kInlineItemsMaxPerRow = 5;
 constexpr auto kSearchRequestDelay = 400;
 
+// If painting takes longer, the rest of the sets wait for the next paint
+// before their players are allowed to render the following frames.
+constexpr auto kLottiePaintBudget = crl::time(8);
+// The delayed sets are painted after a frame interval, so that the main
+// loop gets idle time between the paints under a constant load.
+constexpr auto kLottieDelayedRepaint = crl::time(16);
+constexpr auto kLogLottieDelayedEach = 100;
+constexpr auto kMaxLiveLottieStickers = 120;
+
 bool SetInMyList(MTPDstickerSet::Flags flags) {
 	return (flags & MTPDstickerSet::Flag::f_installed_date)
 		&& !(flags & MTPDstickerSet::Flag::f_archived);
@@ -835,7 +845,8 @@ StickersListWidget::StickersListWidget(
 , _addWidth(st::stickersTrendingAdd.font->width(_addText))
 , _settings(this, tr::lng_stickers_you_have(tr::now))
 , _previewTimer([=] { showPreview(); })
-, _searchRequestTimer([=] { sendSearchRequest(); }) {
+, _searchRequestTimer([=] { sendSearchRequest(); })
+, _lottieDelayedTimer([=] { update(); }) {
 	setMouseTracking(true);
 	setAttribute(Qt::WA_OpaquePaintEvent);
 
@@ -1324,6 +1335,9 @@ QRect StickersListWidget::stickerRect(int section, int sel) {
 }
 
 void StickersListWidget::paintEvent(QPaintEvent *e) {
+	const auto profile = Core::PaintProfilerScope(
+		"StickersListWidget",
+		Core::PaintZone::Frame);
 	Painter p(this);
 	auto clip = e->rect();
 	p.fillRect(clip, st::emojiPanBg);
@@ -1343,6 +1357,7 @@ void StickersListWidget::paintStickers(Painter &p, QRect clip) {
 	auto &sets = shownSets();
 	auto selectedSticker = base::get_if<OverSticker>(&_selected);
 	auto selectedButton = base::get_if<OverButton>(_pressed ? &_pressed : &_selected);
+	const auto paintStarted = crl::now();
 
 	if (sets.empty() && _section == Section::Search) {
 		paintEmptySearchResults(p);
@@ -1425,7 +1440,7 @@ void StickersListWidget::paintStickers(Painter &p, QRect clip) {
 				auto deleteSelected = false;
 				paintSticker(p, set, info.rowsTop, info.section, index, selected, deleteSelected);
 			}
-			markLottieFrameShown(set);
+			markLottieFrameShown(set, paintStarted);
 			return true;
 		}
 		if (setHasTitle(set) && clip.top() < info.rowsTop) {
@@ -1473,19 +1488,38 @@ void StickersListWidget::paintStickers(Painter &p, QRect clip) {
 				paintSticker(p, set, info.rowsTop, info.section, index, selected, deleteSelected);
 			}
 		}
-		markLottieFrameShown(set);
+		markLottieFrameShown(set, paintStarted);
 		return true;
 	});
 }
 
-void StickersListWidget::markLottieFrameShown(Set &set) {
-	if (const auto player = set.lottiePlayer) {
-		const auto paused = controller()->isGifPausedAtLeastFor(
-			Window::GifPauseReason::SavedGifs);
-		if (!paused) {
-			player->markFrameShown();
+void StickersListWidget::markLottieFrameShown(
+		Set &set,
+		crl::time paintStarted) {
+	const auto player = set.lottiePlayer;
+	if (!player) {
+		return;
+	}
+	const auto paused = controller()->isGifPausedAtLeastFor(
+		Window::GifPauseReason::SavedGifs);
+	if (paused) {
+		return;
+	}
+	// Sets delayed in the previous paint go first this time,
+	// so that under a constant load all of them keep moving.
+	const auto delayed = _lottieDelayedSets.remove(set.id);
+	if (!delayed && crl::now() - paintStarted > kLottiePaintBudget) {
+		_lottieDelayedSets.emplace(set.id);
+		if (!(++_lottieDelayedFrames % kLogLottieDelayedEach)) {
+			DEBUG_LOG(("Stickers Panel: %1 lottie frames delayed "
+				"over the paint budget.").arg(_lottieDelayedFrames));
+		}
+		if (!_lottieDelayedTimer.isActive()) {
+			_lottieDelayedTimer.callOnce(kLottieDelayedRepaint);
 		}
+		return;
 	}
+	player->markFrameShown();
 }
 
 void StickersListWidget::checkVisibleLottie() {
@@ -1497,17 +1531,53 @@ void StickersListWidget::checkVisibleLottie() {
 	const auto destroyAfterDistance = (visibleBottom - visibleTop) * 2;
 	const auto destroyAbove = visibleTop - destroyAfterDistance;
 	const auto destroyBelow = visibleBottom + destroyAfterDistance;
+	auto live = 0;
+	auto hidden = std::vector<std::pair<int, int>>(); // distance, section
 	enumerateSections([&](const SectionInfo &info) {
+		auto &set = shownSets()[info.section];
 		if (destroyBelow <= info.rowsTop
 			|| destroyAbove >= info.rowsBottom) {
-			destroyLottieIn(shownSets()[info.section]);
+			destroyLottieIn(set);
+			return true;
 		} else if ((visibleTop > info.rowsTop && visibleTop < info.rowsBottom)
 			|| (visibleBottom > info.rowsTop
 				&& visibleBottom < info.rowsBottom)) {
 			pauseInvisibleLottieIn(info);
 		}
+		if (set.lottiePlayer) {
+			live += liveLottieCount(set);
+			if (info.rowsBottom <= visibleTop) {
+				hidden.emplace_back(
+					visibleTop - info.rowsBottom,
+					info.section);
+			} else if (info.rowsTop >= visibleBottom) {
+				hidden.emplace_back(
+					info.rowsTop - visibleBottom,
+					info.section);
+			}
+		}
 		return true;
 	});
+
+	// Fast scrolling through large sets may keep too many animations in the
+	// preload distance, release the farthest ones first.
+	if (live <= kMaxLiveLottieStickers) {
+		return;
+	}
+	ranges::sort(hidden, std::greater<>());
+	for (const auto &[distance, section] : hidden) {
+		auto &set = shownSets()[section];
+		live -= liveLottieCount(set);
+		destroyLottieIn(set);
+		if (live <= kMaxLiveLottieStickers) {
+			break;
+		}
+	}
+}
+
+int StickersListWidget::liveLottieCount(const Set &set) const {
+	const auto i = _lottieData.find(set.id);
+	return (i != end(_lottieData)) ? int(i->second.items.size()) : 0;
 }
 
 void StickersListWidget::destroyLottieIn(Set &set) {
@@ -1519,6 +1589,7 @@ void StickersListWidget::destroyLottieIn(Set &set) {
 		sticker.animated = nullptr;
 	}
 	_lottieData.remove(set.id);
+	_lottieDelayedSets.remove(set.id);
 }
 
 void StickersListWidget::pauseInvisibleLottieIn(const SectionInfo &info) {
@@ -1698,6 +1769,9 @@ void StickersListWidget::paintSticker(Painter &p, Set &set, int y, int section,
 	if (sticker.animated && sticker.animated->ready()) {
 		auto request = Lottie::FrameRequest();
 		request.box = boundingBoxSize() * cIntRetinaFactor();
+		const auto profile = Core::PaintProfilerScope(
+			"StickersListWidget::lottie",
+			Core::PaintZone::Image);
 		const auto frame = sticker.animated->frame(request);
 		p.drawImage(
 			QRect(ppos, frame.size() / cIntRetinaFactor()),
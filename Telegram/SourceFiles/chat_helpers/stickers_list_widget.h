@@ -251,10 +251,11 @@ private:
 
 	void ensureLottiePlayer(Set &set);
 	void setupLottie(Set &set, int section, int index);
-	void markLottieFrameShown(Set &set);
+	void markLottieFrameShown(Set &set, crl::time paintStarted);
 	void checkVisibleLottie();
 	void pauseInvisibleLottieIn(const SectionInfo &info);
 	void destroyLottieIn(Set &set);
+	[[nodiscard]] int liveLottieCount(const Set &set) const;
 	void refillLottieData();
 	void refillLottieData(Set &set);
 	void clearLottieData();
@@ -345,6 +346,9 @@ private:
 	mtpRequestId _searchRequestId = 0;
 
 	base::flat_map<uint64, LottieSet> _lottieData;
+	base::flat_set<uint64> _lottieDelayedSets;
+	base::Timer _lottieDelayedTimer;
+	int _lottieDelayedFrames = 0;
 
 	rpl::event_stream<not_null<DocumentData*>> _chosen;
 	rpl::event_stream<> _scrollUpdated;
@@ -20,6 +20,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/local_url_handlers.h"
 #include "core/launcher.h"
 #include "core/kotato_settings.h"
+#include "core/startup_tracer.h"
 #include "core/ui_integration.h"
 #include "chat_helpers/emoji_keywords.h"
 #include "storage/localstorage.h"
@@ -96,32 +97,7 @@ Application::Application(not_null<Launcher*> launcher)
 , _langpack(std::make_unique<Lang::Instance>())
 , _langCloudManager(std::make_unique<Lang::CloudManager>(langpack()))
 , _emojiKeywords(std::make_unique<ChatHelpers::EmojiKeywords>())
-, _audio(std::make_unique<Media::Audio::Instance>())
-, _logo(Window::LoadLogo())
-, _logoBlue(Window::LoadLogo(1))
-, _logoGreen(Window::LoadLogo(2))
-, _logoOrange(Window::LoadLogo(3))
-, _logoRed(Window::LoadLogo(4))
-, _logoOld(Window::LoadLogo(5))
-, _logoNoMargin(Window::LoadLogoNoMargin())
-, _logoNoMarginBlue(Window::LoadLogoNoMargin(1))
-, _logoNoMarginGreen(Window::LoadLogoNoMargin(2))
-, _logoNoMarginOrange(Window::LoadLogoNoMargin(3))
-, _logoNoMarginRed(Window::LoadLogoNoMargin(4))
-, _logoNoMarginOld(Window::LoadLogoNoMargin(5)) {
-	Expects(!_logo.isNull());
-	Expects(!_logoBlue.isNull());
-	Expects(!_logoGreen.isNull());
-	Expects(!_logoOrange.isNull());
-	Expects(!_logoRed.isNull());
-	Expects(!_logoOld.isNull());
-	Expects(!_logoNoMargin.isNull());
-	Expects(!_logoNoMarginBlue.isNull());
-	Expects(!_logoNoMarginGreen.isNull());
-	Expects(!_logoNoMarginOrange.isNull());
-	Expects(!_logoNoMarginRed.isNull());
-	Expects(!_logoNoMarginOld.isNull());
-
+, _audio(std::make_unique<Media::Audio::Instance>()) {
 	Ui::Integration::Set(&_private->uiIntegration);
 
 	activeAccount().sessionChanges(
@@ -182,6 +158,8 @@ Application::~Application() {
 }
 
 void Application::run() {
+	const auto phase = StartupPhase("Application::run");
+
 	KotatoSettings::Start();
 	if (!cMainFont().isEmpty()) {
 		style::internal::CustomMainFont = cMainFont();
@@ -201,15 +179,21 @@ void Application::run() {
 	if (cUseOriginalMetrics()) {
 		style::internal::UseOriginalMetrics = cUseOriginalMetrics();
 	}
-	style::internal::StartFonts();
+	{
+		const auto phase = StartupPhase("Application::startFonts");
+		style::internal::StartFonts();
+	}
 
 	ThirdParty::start();
 	Global::start();
 	refreshGlobalProxy(); // Depends on Global::started().
 
 	startLocalStorage();
-	Lang::Current().fillDefaultJson();
-	Lang::Current().fillFromJson();
+	{
+		const auto phase = StartupPhase("Lang::fillFromJson");
+		Lang::Current().fillDefaultJson();
+		Lang::Current().fillFromJson();
+	}
 	ValidateScale();
 
 	if (Local::oldSettingsVersion() < AppVersion) {
@@ -225,9 +209,12 @@ void Application::run() {
 	_translator = std::make_unique<Lang::Translator>();
 	QCoreApplication::instance()->installTranslator(_translator.get());
 
-	style::startManager(cScale());
-	Ui::InitTextOptions();
-	Ui::Emoji::Init();
+	{
+		const auto phase = StartupPhase("Application::startStyle");
+		style::startManager(cScale());
+		Ui::InitTextOptions();
+		Ui::Emoji::Init();
+	}
 	Media::Player::start(_audio.get());
 
 	style::ShortAnimationPlaying(
@@ -248,7 +235,10 @@ void Application::run() {
 	// Create mime database, so it won't be slow later.
 	QMimeDatabase().mimeTypeForName(qsl("text/plain"));
 
-	_window = std::make_unique<Window::Controller>(&activeAccount());
+	{
+		const auto phase = StartupPhase("Window::Controller");
+		_window = std::make_unique<Window::Controller>(&activeAccount());
+	}
 
 	QCoreApplication::instance()->installEventFilter(this);
 	connect(
@@ -272,6 +262,7 @@ void Application::run() {
 		DEBUG_LOG(("Application Info: local map read..."));
 		activeAccount().startMtp();
 		DEBUG_LOG(("Application Info: MTP started..."));
+		const auto phase = StartupPhase("Window::setup");
 		if (activeAccount().sessionExists()) {
 			_window->setupMain();
 		} else {
@@ -279,6 +270,7 @@ void Application::run() {
 		}
 	}
 
+	const auto showPhase = StartupPhase("Window::show");
 	_window->widget()->show();
 
 	const auto currentGeometry = _window->widget()->geometry();
@@ -393,6 +385,15 @@ bool Application::eventFilter(QObject *object, QEvent *e) {
 		}
 	} break;
 
+	case QEvent::Paint: {
+		if (StartupTracerEnabled()
+			&& _window
+			&& object == _window->widget().get()) {
+			// Finish after the first frame of the main window is painted.
+			crl::on_main(this, [] { StartupTracerFinish(); });
+		}
+	} break;
+
 	case QEvent::ApplicationActivate: {
 		if (object == QCoreApplication::instance()) {
 			updateNonIdle();
@@ -458,6 +459,7 @@ void Application::badMtprotoConfigurationError() {
 }
 
 void Application::startLocalStorage() {
+	const auto phase = StartupPhase("Local::start");
 	Local::start();
 
 	const auto writing = _lifetime.make_state<bool>(false);
@@ -809,6 +811,30 @@ void Application::checkMediaViewActivation() {
 	}
 }
 
+QImage Application::logo(int variant) const {
+	if (variant < 0 || variant >= kLogoVariants) {
+		variant = 0;
+	}
+	auto &result = _logos[variant];
+	if (result.isNull()) {
+		result = Window::LoadLogo(variant);
+		Assert(!result.isNull());
+	}
+	return result;
+}
+
+QImage Application::logoNoMargin(int variant) const {
+	if (variant < 0 || variant >= kLogoVariants) {
+		variant = 0;
+	}
+	auto &result = _logosNoMargin[variant];
+	if (result.isNull()) {
+		result = Window::LoadLogoNoMargin(variant);
+		Assert(!result.isNull());
+	}
+	return result;
+}
+
 QPoint Application::getPointForCallPanelCenter() const {
 	if (const auto window = activeWindow()) {
 		return window->getPointForCallPanelCenter();
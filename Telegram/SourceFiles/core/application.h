@@ -115,28 +115,9 @@ public:
 	PeerData *ui_getPeerForMouseAction();
 
 	QPoint getPointForCallPanelCenter() const;
-	QImage logo(int variant = 0) const {
-		switch (variant) {
-			case 1: return _logoBlue;
-			case 2: return _logoGreen;
-			case 3: return _logoOrange;
-			case 4: return _logoRed;
-			case 5: return _logoOld;
-		}
-
-		return _logo;
-	}
-	QImage logoNoMargin(int variant = 0) const {
-		switch (variant) {
-			case 1: return _logoNoMarginBlue;
-			case 2: return _logoNoMarginGreen;
-			case 3: return _logoNoMarginOrange;
-			case 4: return _logoNoMarginRed;
-			case 5: return _logoNoMarginOld;
-		}
-
-		return _logoNoMargin;
-	}
+	// Logo variants are loaded from resources when first requested.
+	[[nodiscard]] QImage logo(int variant = 0) const;
+	[[nodiscard]] QImage logoNoMargin(int variant = 0) const;
 
 	[[nodiscard]] Settings &settings() {
 		return _settings;
@@ -243,6 +224,7 @@ protected:
 
 private:
 	static constexpr auto kDefaultSaveDelay = crl::time(1000);
+	static constexpr auto kLogoVariants = 6;
 
 	friend bool IsAppLaunched();
 	friend Application &App();
@@ -296,18 +278,8 @@ private:
 	QPointer<Ui::BoxContent> _badProxyDisableBox;
 
 	const std::unique_ptr<Media::Audio::Instance> _audio;
-	const QImage _logo;
-	const QImage _logoBlue;
-	const QImage _logoGreen;
-	const QImage _logoOrange;
-	const QImage _logoRed;
-	const QImage _logoOld;
-	const QImage _logoNoMargin;
-	const QImage _logoNoMarginBlue;
-	const QImage _logoNoMarginGreen;
-	const QImage _logoNoMarginOrange;
-	const QImage _logoNoMarginRed;
-	const QImage _logoNoMarginOld;
+	mutable std::array<QImage, kLogoVariants> _logos;
+	mutable std::array<QImage, kLogoVariants> _logosNoMargin;
 
 	rpl::variable<bool> _passcodeLock;
 	rpl::event_stream<bool> _termsLockChanges;
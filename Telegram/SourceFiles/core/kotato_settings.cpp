@@ -11,6 +11,9 @@ https://github.com/kotatogram/kotatogram-desktop/blob/dev/LEGAL
 #include "mainwidget.h"
 #include "window/window_controller.h"
 #include "core/application.h"
+#include "core/media_active_cache.h"
+#include "ffmpeg/ffmpeg_utility.h"
+#include "media/audio/media_audio.h"
 #include "base/parse_helper.h"
 #include "facades.h"
 #include "ui/widgets/input_fields.h"
@@ -19,13 +22,17 @@ https://github.com/kotatogram/kotatogram-desktop/blob/dev/LEGAL
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonValue>
+#include <QtCore/QSaveFile>
 #include <QtCore/QTimer>
+#include <atomic>
 
 namespace KotatoSettings {
 namespace {
 
 constexpr auto kWriteJsonTimeout = crl::time(5000);
 
+std::atomic<int> WriteGeneration = 0;
+
 QString DefaultFilePath() {
 	return cWorkingDir() + qsl("tdata/kotato-settings-default.json");
 }
@@ -67,7 +74,11 @@ void WriteDefaultCustomFile() {
 	}
 }
 
-bool ReadOption(QJsonObject obj, QString key, std::function<void(QJsonValue)> callback) {
+template <typename Callback>
+bool ReadOption(
+		const QJsonObject &obj,
+		const QString &key,
+		Callback &&callback) {
 	const auto it = obj.constFind(key);
 	if (it == obj.constEnd()) {
 		return false;
@@ -76,9 +87,13 @@ bool ReadOption(QJsonObject obj, QString key, std::function<void(QJsonValue)> ca
 	return true;
 }
 
-bool ReadObjectOption(QJsonObject obj, QString key, std::function<void(QJsonObject)> callback) {
+template <typename Callback>
+bool ReadObjectOption(
+		const QJsonObject &obj,
+		const QString &key,
+		Callback &&callback) {
 	auto readResult = false;
-	auto readValueResult = ReadOption(obj, key, [&](QJsonValue v) {
+	auto readValueResult = ReadOption(obj, key, [&](const QJsonValue &v) {
 		if (v.isObject()) {
 			callback(v.toObject());
 			readResult = true;
@@ -87,9 +102,13 @@ bool ReadObjectOption(QJsonObject obj, QString key, std::function<void(QJsonObje
 	return (readValueResult && readResult);
 }
 
-bool ReadArrayOption(QJsonObject obj, QString key, std::function<void(QJsonArray)> callback) {
+template <typename Callback>
+bool ReadArrayOption(
+		const QJsonObject &obj,
+		const QString &key,
+		Callback &&callback) {
 	auto readResult = false;
-	auto readValueResult = ReadOption(obj, key, [&](QJsonValue v) {
+	auto readValueResult = ReadOption(obj, key, [&](const QJsonValue &v) {
 		if (v.isArray()) {
 			callback(v.toArray());
 			readResult = true;
@@ -98,9 +117,13 @@ bool ReadArrayOption(QJsonObject obj, QString key, std::function<void(QJsonArray
 	return (readValueResult && readResult);
 }
 
-bool ReadStringOption(QJsonObject obj, QString key, std::function<void(QString)> callback) {
+template <typename Callback>
+bool ReadStringOption(
+		const QJsonObject &obj,
+		const QString &key,
+		Callback &&callback) {
 	auto readResult = false;
-	auto readValueResult = ReadOption(obj, key, [&](QJsonValue v) {
+	auto readValueResult = ReadOption(obj, key, [&](const QJsonValue &v) {
 		if (v.isString()) {
 			callback(v.toString());
 			readResult = true;
@@ -109,9 +132,13 @@ bool ReadStringOption(QJsonObject obj, QString key, std::function<void(QString)>
 	return (readValueResult && readResult);
 }
 
-bool ReadIntOption(QJsonObject obj, QString key, std::function<void(int)> callback) {
+template <typename Callback>
+bool ReadIntOption(
+		const QJsonObject &obj,
+		const QString &key,
+		Callback &&callback) {
 	auto readResult = false;
-	auto readValueResult = ReadOption(obj, key, [&](QJsonValue v) {
+	auto readValueResult = ReadOption(obj, key, [&](const QJsonValue &v) {
 		if (v.isDouble()) {
 			callback(v.toInt());
 			readResult = true;
@@ -120,9 +147,13 @@ bool ReadIntOption(QJsonObject obj, QString key, std::function<void(int)> callba
 	return (readValueResult && readResult);
 }
 
-bool ReadBoolOption(QJsonObject obj, QString key, std::function<void(bool)> callback) {
+template <typename Callback>
+bool ReadBoolOption(
+		const QJsonObject &obj,
+		const QString &key,
+		Callback &&callback) {
 	auto readResult = false;
-	auto readValueResult = ReadOption(obj, key, [&](QJsonValue v) {
+	auto readValueResult = ReadOption(obj, key, [&](const QJsonValue &v) {
 		if (v.isBool()) {
 			callback(v.toBool());
 			readResult = true;
@@ -131,6 +162,31 @@ bool ReadBoolOption(QJsonObject obj, QString key, std::function<void(bool)> call
 	return (readValueResult && readResult);
 }
 
+// Only the latest serialized settings are written, so a slow background
+// write can't overwrite a newer file written synchronously on exit.
+void WriteCustomFile(int generation, const QByteArray &content) {
+	static auto Mutex = QMutex();
+
+	QMutexLocker lock(&Mutex);
+	if (generation != WriteGeneration) {
+		return;
+	}
+	const char *customHeader = R"HEADER(
+// This file was automatically generated from current settings
+// It's better to edit it with app closed, so there will be no rewrites
+// You should restart app to see changes
+
+)HEADER";
+
+	auto file = QSaveFile(CustomFilePath());
+	if (!file.open(QIODevice::WriteOnly)) {
+		return;
+	}
+	file.write(customHeader);
+	file.write(content);
+	file.commit();
+}
+
 std::unique_ptr<Manager> Data;
 
 } // namespace
@@ -152,7 +208,7 @@ void Manager::fill() {
 void Manager::write(bool force) {
 	if (force && _jsonWriteTimer.isActive()) {
 		_jsonWriteTimer.stop();
-		writeTimeout();
+		writeCurrentSettings(true);
 	} else if (!force && !_jsonWriteTimer.isActive()) {
 		_jsonWriteTimer.start(kWriteJsonTimeout);
 	}
@@ -312,6 +368,10 @@ bool Manager::readCustomFile() {
 		cSetNoTaskbarFlashing(v);
 	});
 
+	ReadBoolOption(settings, "streamed_voice_upload", [&](auto v) {
+		cSetStreamedVoiceUpload(v);
+	});
+
 	ReadIntOption(settings, "recent_stickers_limit", [&](auto v) {
 		if (v >= 0 || v <= 200) {
 			SetRecentStickersLimit(v);
@@ -333,6 +393,22 @@ bool Manager::readCustomFile() {
 			cSetCustomAppIcon(v);
 		}
 	});
+
+	ReadIntOption(settings, "media_memory_limit", [&](auto v) {
+		if (v >= 64 && v <= 4096) {
+			Core::SetMediaMemoryLimit(int64(v) * 1024 * 1024);
+		}
+	});
+
+	ReadBoolOption(settings, "hardware_video_decoding", [&](auto v) {
+		FFmpeg::SetHardwareDecoding(v);
+	});
+
+	ReadIntOption(settings, "audio_decode_ahead", [&](auto v) {
+		if (v >= 0 && v <= 30000) {
+			Media::Player::SetDecodeAheadDuration(v);
+		}
+	});
 	return true;
 }
 
@@ -373,10 +449,20 @@ void Manager::writeDefaultFile() {
 	settings.insert(qsl("disable_up_edit"), cDisableUpEdit());
 	settings.insert(qsl("confirm_before_calls"), cConfirmBeforeCall());
 	settings.insert(qsl("no_taskbar_flash"), cNoTaskbarFlashing());
+	settings.insert(qsl("streamed_voice_upload"), cStreamedVoiceUpload());
 	settings.insert(qsl("recent_stickers_limit"), RecentStickersLimit());
 	settings.insert(qsl("userpic_corner_type"), cUserpicCornersType());
 	settings.insert(qsl("always_show_top_userpic"), cShowTopBarUserpic());
 	settings.insert(qsl("custom_app_icon"), cCustomAppIcon());
+	settings.insert(
+		qsl("media_memory_limit"),
+		int(Core::MediaMemoryLimit() / (1024 * 1024)));
+	settings.insert(
+		qsl("hardware_video_decoding"),
+		FFmpeg::HardwareDecoding());
+	settings.insert(
+		qsl("audio_decode_ahead"),
+		int(Media::Player::DecodeAheadDuration()));
 
 	auto settingsScales = QJsonArray();
 	settings.insert(qsl("scales"), settingsScales);
@@ -389,21 +475,10 @@ void Manager::writeDefaultFile() {
 	file.write(document.toJson(QJsonDocument::Indented));
 }
 
-void Manager::writeCurrentSettings() {
-	auto file = QFile(CustomFilePath());
-	if (!file.open(QIODevice::WriteOnly)) {
-		return;
-	}
+void Manager::writeCurrentSettings(bool now) {
 	if (_jsonWriteTimer.isActive()) {
 		writing();
 	}
-	const char *customHeader = R"HEADER(
-// This file was automatically generated from current settings
-// It's better to edit it with app closed, so there will be no rewrites
-// You should restart app to see changes
-
-)HEADER";
-	file.write(customHeader);
 
 	auto settings = QJsonObject();
 
@@ -438,10 +513,20 @@ void Manager::writeCurrentSettings() {
 	settings.insert(qsl("disable_up_edit"), cDisableUpEdit());
 	settings.insert(qsl("confirm_before_calls"), cConfirmBeforeCall());
 	settings.insert(qsl("no_taskbar_flash"), cNoTaskbarFlashing());
+	settings.insert(qsl("streamed_voice_upload"), cStreamedVoiceUpload());
 	settings.insert(qsl("recent_stickers_limit"), RecentStickersLimit());
 	settings.insert(qsl("userpic_corner_type"), cUserpicCornersType());
 	settings.insert(qsl("always_show_top_userpic"), cShowTopBarUserpic());
 	settings.insert(qsl("custom_app_icon"), cCustomAppIcon());
+	settings.insert(
+		qsl("media_memory_limit"),
+		int(Core::MediaMemoryLimit() / (1024 * 1024)));
+	settings.insert(
+		qsl("hardware_video_decoding"),
+		FFmpeg::HardwareDecoding());
+	settings.insert(
+		qsl("audio_decode_ahead"),
+		int(Media::Player::DecodeAheadDuration()));
 
 	auto settingsScales = QJsonArray();
 	auto currentScales = cInterfaceScales();
@@ -465,11 +550,24 @@ void Manager::writeCurrentSettings() {
 
 	auto document = QJsonDocument();
 	document.setObject(settings);
-	file.write(document.toJson(QJsonDocument::Indented));
+	auto content = document.toJson(QJsonDocument::Indented);
+	if (content == _writtenContent) {
+		return;
+	}
+	_writtenContent = content;
+
+	const auto generation = ++WriteGeneration;
+	if (now) {
+		WriteCustomFile(generation, content);
+	} else {
+		crl::async([=, content = std::move(content)] {
+			WriteCustomFile(generation, content);
+		});
+	}
 }
 
 void Manager::writeTimeout() {
-	writeCurrentSettings();
+	writeCurrentSettings(false);
 }
 
 void Manager::writing() {
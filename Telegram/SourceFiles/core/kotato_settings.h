@@ -24,11 +24,12 @@ public slots:
 
 private:
 	void writeDefaultFile();
-	void writeCurrentSettings();
+	void writeCurrentSettings(bool now);
 	bool readCustomFile();
 	void writing();
 
 	QTimer _jsonWriteTimer;
+	QByteArray _writtenContent;
 
 };
 
@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/crash_reports.h"
 #include "core/update_checker.h"
 #include "core/sandbox.h"
+#include "core/startup_tracer.h"
 #include "base/concurrent_timer.h"
 #include "facades.h"
 
@@ -268,12 +269,16 @@ int Launcher::exec() {
 		return psCleanup();
 	}
 
-	// Must be started before Platform is started.
-	Logs::start(this);
+	{
+		const auto phase = StartupPhase("Launcher::startPlatform");
 
-	// Must be started before Sandbox is created.
-	Platform::start();
-	Ui::DisableCustomScaling();
+		// Must be started before Platform is started.
+		Logs::start(this);
+
+		// Must be started before Sandbox is created.
+		Platform::start();
+		Ui::DisableCustomScaling();
+	}
 
 	auto result = executeApplication();
 
@@ -395,6 +400,7 @@ void Launcher::processArguments() {
 		{ "-workdir"        , KeyFormat::OneValue },
 		{ "--"              , KeyFormat::OneValue },
 		{ "-scale"          , KeyFormat::OneValue },
+		{ "-tracestartup"   , KeyFormat::NoValues },
 	};
 	auto parseResult = QMap<QByteArray, QStringList>();
 	auto parsingKey = QByteArray();
@@ -419,6 +425,9 @@ void Launcher::processArguments() {
 		}
 	}
 
+	if (parseResult.contains("-tracestartup")) {
+		StartupTracerStart();
+	}
 	if (parseResult.contains("-externalupdater")) {
 		SetUpdaterDisabledAtStartup();
 	}
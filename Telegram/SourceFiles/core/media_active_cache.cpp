@@ -0,0 +1,139 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/media_active_cache.h"
+
+namespace Core {
+namespace {
+
+constexpr auto kDefaultMemoryLimit = int64(256) * 1024 * 1024;
+constexpr auto kVisibleTimeout = crl::time(1000);
+constexpr auto kKindsCount = int(MediaMemoryKind::kCount);
+
+struct KindState {
+	details::MediaActiveCacheBase *cache = nullptr;
+	int64 usage = 0;
+	int64 unloaded = 0;
+	int64 limit = 0;
+};
+
+int64 MemoryLimit = kDefaultMemoryLimit;
+int64 MemoryUsage = 0;
+std::array<KindState, kKindsCount> Kinds;
+
+[[nodiscard]] KindState &StateFor(MediaMemoryKind kind) {
+	Expects(kind != MediaMemoryKind::kCount);
+
+	return Kinds[int(kind)];
+}
+
+} // namespace
+
+void SetMediaMemoryLimit(int64 limit) {
+	Expects(limit > 0);
+
+	MemoryLimit = limit;
+	details::CheckMediaMemory();
+}
+
+int64 MediaMemoryLimit() {
+	return MemoryLimit;
+}
+
+void SetMediaMemoryKindLimit(MediaMemoryKind kind, int64 limit) {
+	Expects(limit >= 0);
+
+	StateFor(kind).limit = limit;
+	details::CheckMediaMemory();
+}
+
+MediaMemoryStats MediaMemoryStatsFor(MediaMemoryKind kind) {
+	const auto &state = StateFor(kind);
+	auto result = MediaMemoryStats();
+	result.usage = state.usage;
+	result.entries = state.cache ? state.cache->entries() : 0;
+	result.unloaded = state.unloaded;
+	return result;
+}
+
+QString MediaMemoryDescription() {
+	const auto describe = [](MediaMemoryKind kind, const QString &name) {
+		const auto stats = MediaMemoryStatsFor(kind);
+		return qsl("%1 %2 bytes in %3 entries, %4 unloaded"
+			).arg(name
+			).arg(stats.usage
+			).arg(stats.entries
+			).arg(stats.unloaded);
+	};
+	return qsl("%1 of %2 bytes used; %3; %4; %5."
+		).arg(MemoryUsage
+		).arg(MemoryLimit
+		).arg(describe(MediaMemoryKind::Images, qsl("images"))
+		).arg(describe(
+			MediaMemoryKind::ImageVariants,
+			qsl("image variants"))
+		).arg(describe(MediaMemoryKind::Documents, qsl("documents")));
+}
+
+namespace details {
+
+MediaActiveCacheBase::MediaActiveCacheBase(MediaMemoryKind kind)
+: _kind(kind) {
+	Expects(StateFor(kind).cache == nullptr);
+
+	StateFor(kind).cache = this;
+}
+
+MediaActiveCacheBase::~MediaActiveCacheBase() {
+	StateFor(_kind).cache = nullptr;
+}
+
+void MediaActiveCacheBase::changeUsage(int64 delta) {
+	StateFor(_kind).usage += delta;
+	MemoryUsage += delta;
+}
+
+void MediaActiveCacheBase::countUnloaded() {
+	++StateFor(_kind).unloaded;
+}
+
+void CheckMediaMemory() {
+	const auto visibleSince = crl::now() - kVisibleTimeout;
+	for (auto &state : Kinds) {
+		if (!state.cache || !state.limit) {
+			continue;
+		}
+		while (state.usage > state.limit) {
+			const auto used = state.cache->lowestUsed();
+			if (!used || *used >= visibleSince) {
+				break;
+			}
+			state.cache->unloadLowest();
+		}
+	}
+	while (MemoryUsage > MemoryLimit) {
+		auto lowest = (MediaActiveCacheBase*)nullptr;
+		auto lowestUsed = visibleSince;
+		for (const auto &state : Kinds) {
+			if (!state.cache) {
+				continue;
+			} else if (const auto used = state.cache->lowestUsed()) {
+				if (*used < lowestUsed) {
+					lowest = state.cache;
+					lowestUsed = *used;
+				}
+			}
+		}
+		if (!lowest) {
+			break;
+		}
+		lowest->unloadLowest();
+	}
+}
+
+} // namespace details
+} // namespace Core
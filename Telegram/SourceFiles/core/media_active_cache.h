@@ -7,15 +7,66 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
-#include "base/last_used_cache.h"
-
 namespace Core {
 
+enum class MediaMemoryKind {
+	Images,
+	ImageVariants,
+	Documents,
+
+	kCount,
+};
+
+struct MediaMemoryStats {
+	int64 usage = 0;
+	int entries = 0;
+	int64 unloaded = 0;
+};
+
+// All media caches share one memory limit. When it is exceeded the
+// least recently used entry of all caches is unloaded first, entries
+// used during the last second are considered visible and are kept.
+void SetMediaMemoryLimit(int64 limit);
+[[nodiscard]] int64 MediaMemoryLimit();
+
+// Additionally a kind may have a limit of its own, its least recently used
+// entries are unloaded when it is exceeded even if the shared one is not.
+void SetMediaMemoryKindLimit(MediaMemoryKind kind, int64 limit);
+[[nodiscard]] MediaMemoryStats MediaMemoryStatsFor(MediaMemoryKind kind);
+[[nodiscard]] QString MediaMemoryDescription();
+
+namespace details {
+
+class MediaActiveCacheBase {
+public:
+	explicit MediaActiveCacheBase(MediaMemoryKind kind);
+	MediaActiveCacheBase(const MediaActiveCacheBase &other) = delete;
+	MediaActiveCacheBase &operator=(
+		const MediaActiveCacheBase &other) = delete;
+	virtual ~MediaActiveCacheBase();
+
+	[[nodiscard]] virtual std::optional<crl::time> lowestUsed() const = 0;
+	virtual void unloadLowest() = 0;
+	[[nodiscard]] virtual int entries() const = 0;
+
+protected:
+	void changeUsage(int64 delta);
+	void countUnloaded();
+
+private:
+	const MediaMemoryKind _kind;
+
+};
+
+void CheckMediaMemory();
+
+} // namespace details
+
 template <typename Type>
-class MediaActiveCache {
+class MediaActiveCache final : public details::MediaActiveCacheBase {
 public:
 	template <typename Unload>
-	MediaActiveCache(int64 limit, Unload &&unload);
+	MediaActiveCache(MediaMemoryKind kind, Unload &&unload);
 
 	void up(Type *entry);
 	void remove(Type *entry);
@@ -24,60 +75,95 @@ public:
 	void increment(int64 amount);
 	void decrement(int64 amount);
 
-private:
-	template <typename Unload>
-	void check(Unload &&unload);
+	std::optional<crl::time> lowestUsed() const override;
+	void unloadLowest() override;
+	int entries() const override;
 
-	base::last_used_cache<Type*> _cache;
+private:
+	struct Entry {
+		Type *value = nullptr;
+		crl::time used = 0;
+	};
+	using Entries = std::list<Entry>;
+
+	Entries _entries; // The least recently used entry goes first.
+	std::unordered_map<Type*, typename Entries::iterator> _positions;
+	Fn<void(Type*)> _unload;
 	SingleQueuedInvokation _delayed;
-	int64 _usage = 0;
-	int64 _limit = 0;
 
 };
 
 template <typename Type>
 template <typename Unload>
-MediaActiveCache<Type>::MediaActiveCache(int64 limit, Unload &&unload)
-: _delayed([=] { check(unload); })
-, _limit(limit) {
+MediaActiveCache<Type>::MediaActiveCache(
+	MediaMemoryKind kind,
+	Unload &&unload)
+: MediaActiveCacheBase(kind)
+, _unload(std::forward<Unload>(unload))
+, _delayed([] { details::CheckMediaMemory(); }) {
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::up(Type *entry) {
-	_cache.up(entry);
+	const auto now = crl::now();
+	const auto i = _positions.find(entry);
+	if (i != end(_positions)) {
+		i->second->used = now;
+		_entries.splice(end(_entries), _entries, i->second);
+	} else {
+		_positions.emplace(
+			entry,
+			_entries.insert(end(_entries), Entry{ entry, now }));
+	}
 	_delayed.call();
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::remove(Type *entry) {
-	_cache.remove(entry);
+	const auto i = _positions.find(entry);
+	if (i != end(_positions)) {
+		_entries.erase(i->second);
+		_positions.erase(i);
+	}
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::clear() {
-	_cache.clear();
+	_entries.clear();
+	_positions.clear();
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::increment(int64 amount) {
-	_usage += amount;
+	changeUsage(amount);
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::decrement(int64 amount) {
-	_usage -= amount;
+	changeUsage(-amount);
 }
 
 template <typename Type>
-template <typename Unload>
-void MediaActiveCache<Type>::check(Unload &&unload) {
-	while (_usage > _limit) {
-		if (const auto entry = _cache.take_lowest()) {
-			unload(entry);
-		} else {
-			break;
-		}
-	}
+std::optional<crl::time> MediaActiveCache<Type>::lowestUsed() const {
+	return _entries.empty()
+		? std::nullopt
+		: std::make_optional(_entries.front().used);
+}
+
+template <typename Type>
+void MediaActiveCache<Type>::unloadLowest() {
+	Expects(!_entries.empty());
+
+	const auto entry = _entries.front().value;
+	_entries.pop_front();
+	_positions.erase(entry);
+	countUnloaded();
+	_unload(entry);
+}
+
+template <typename Type>
+int MediaActiveCache<Type>::entries() const {
+	return int(_entries.size());
 }
 
 } // namespace Core
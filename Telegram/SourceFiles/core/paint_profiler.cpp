@@ -0,0 +1,161 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/paint_profiler.h"
+
+#include <QtCore/QMutex>
+#include <chrono>
+#include <map>
+
+namespace Core {
+namespace {
+
+constexpr auto kRecordsLimit = 65536;
+
+struct Record {
+	const char *name = nullptr;
+	int64 started = 0;
+	int64 duration = 0;
+	int thread = 0;
+	PaintZone zone = PaintZone::Frame;
+};
+
+struct Records {
+	QMutex mutex;
+	std::vector<Record> list;
+	int next = 0;
+};
+
+[[nodiscard]] Records &Recorded() {
+	static auto Instance = Records();
+	return Instance;
+}
+
+[[nodiscard]] int64 NowMicroseconds() {
+	using Clock = std::chrono::steady_clock;
+	static const auto Start = Clock::now();
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		Clock::now() - Start).count();
+}
+
+[[nodiscard]] int CurrentThread() {
+	static auto Threads = std::atomic<int>(0);
+	thread_local const auto Result = ++Threads;
+	return Result;
+}
+
+[[nodiscard]] const char *ZoneName(PaintZone zone) {
+	switch (zone) {
+	case PaintZone::Frame: return "frame";
+	case PaintZone::Text: return "text";
+	case PaintZone::Image: return "image";
+	case PaintZone::MediaDecode: return "decode";
+	}
+	Unexpected("Zone in Core::ZoneName.");
+}
+
+[[nodiscard]] std::vector<Record> TakeSnapshot() {
+	auto &records = Recorded();
+	QMutexLocker lock(&records.mutex);
+	auto result = records.list;
+	std::rotate(
+		begin(result),
+		begin(result) + (records.next % std::max(int(result.size()), 1)),
+		end(result));
+	return result;
+}
+
+void Push(Record record) {
+	auto &records = Recorded();
+	QMutexLocker lock(&records.mutex);
+	if (records.list.size() < kRecordsLimit) {
+		records.list.push_back(record);
+	} else {
+		records.list[records.next] = record;
+		records.next = (records.next + 1) % kRecordsLimit;
+	}
+}
+
+} // namespace
+
+PaintProfilerScope::PaintProfilerScope(const char *name, PaintZone zone)
+: _name(name)
+, _zone(zone) {
+	if (PaintProfilerEnabled()) {
+		_started = NowMicroseconds();
+	}
+}
+
+PaintProfilerScope::~PaintProfilerScope() {
+	if (_started >= 0 && PaintProfilerEnabled()) {
+		Push({
+			_name,
+			_started,
+			NowMicroseconds() - _started,
+			CurrentThread(),
+			_zone });
+	}
+}
+
+void PaintProfilerSetEnabled(bool enabled) {
+	if (enabled) {
+		auto &records = Recorded();
+		QMutexLocker lock(&records.mutex);
+		records.list.clear();
+		records.next = 0;
+	}
+	PaintProfilerEnabledFlag.store(enabled, std::memory_order_relaxed);
+}
+
+QString PaintProfilerSummary() {
+	auto frames = std::map<QString, std::vector<int64>>();
+	for (const auto &record : TakeSnapshot()) {
+		if (record.zone == PaintZone::Frame) {
+			frames[record.name].push_back(record.duration);
+		}
+	}
+	auto result = QStringList();
+	for (auto &[name, durations] : frames) {
+		ranges::sort(durations);
+		const auto percentile = [&](int value) {
+			const auto index = (int(durations.size()) - 1) * value / 100;
+			return durations[index] / 1000.;
+		};
+		result.push_back(qsl("%1: %2 frames, p50 %3 ms, p95 %4 ms, p99 %5 ms"
+			).arg(name
+			).arg(durations.size()
+			).arg(percentile(50), 0, 'f', 2
+			).arg(percentile(95), 0, 'f', 2
+			).arg(percentile(99), 0, 'f', 2));
+	}
+	return result.isEmpty()
+		? qsl("No frames recorded.")
+		: result.join('\n');
+}
+
+QByteArray PaintProfilerChromeTrace() {
+	auto result = QByteArray("{\"traceEvents\":[");
+	auto first = true;
+	for (const auto &record : TakeSnapshot()) {
+		if (!first) {
+			result.append(',');
+		}
+		first = false;
+		result.append(QString(
+			"{\"name\":\"%1\",\"cat\":\"%2\",\"ph\":\"X\","
+			"\"ts\":%3,\"dur\":%4,\"pid\":1,\"tid\":%5}"
+		).arg(record.name
+		).arg(ZoneName(record.zone)
+		).arg(record.started
+		).arg(record.duration
+		).arg(record.thread).toUtf8());
+	}
+	result.append("]}");
+	return result;
+}
+
+} // namespace Core
@@ -0,0 +1,52 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <atomic>
+
+namespace Core {
+
+enum class PaintZone : uchar {
+	Frame,
+	Text,
+	Image,
+	MediaDecode,
+};
+
+// Records the durations of paint events and of the heavy parts inside
+// them into a ring buffer, from any thread. When disabled each scope costs
+// one relaxed flag check.
+inline std::atomic<bool> PaintProfilerEnabledFlag = false;
+
+[[nodiscard]] inline bool PaintProfilerEnabled() {
+	return PaintProfilerEnabledFlag.load(std::memory_order_relaxed);
+}
+
+class PaintProfilerScope final {
+public:
+	PaintProfilerScope(const char *name, PaintZone zone);
+	PaintProfilerScope(const PaintProfilerScope &other) = delete;
+	PaintProfilerScope &operator=(const PaintProfilerScope &other) = delete;
+	~PaintProfilerScope();
+
+private:
+	const char *_name = nullptr;
+	int64 _started = -1;
+	PaintZone _zone = PaintZone::Frame;
+
+};
+
+void PaintProfilerSetEnabled(bool enabled);
+
+// Frame time percentiles for each profiled widget, one per line.
+[[nodiscard]] QString PaintProfilerSummary();
+
+// All the recorded scopes in Chrome trace event format.
+[[nodiscard]] QByteArray PaintProfilerChromeTrace();
+
+} // namespace Core
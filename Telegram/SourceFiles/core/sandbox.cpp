@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "core/launcher.h"
 #include "core/local_url_handlers.h"
+#include "core/startup_tracer.h"
 #include "core/update_checker.h"
 #include "base/timer.h"
 #include "base/concurrent_timer.h"
@@ -92,6 +93,8 @@ Sandbox::Sandbox(
 }
 
 int Sandbox::start() {
+	StartupTracerMark("Sandbox::start");
+
 	if (!Core::UpdaterDisabled()) {
 		_updateChecker = std::make_unique<Core::UpdateChecker>();
 	}
@@ -150,13 +153,17 @@ void Sandbox::launchApplication() {
 		} else if (_application) {
 			return;
 		}
+		StartupTracerMark("Sandbox::launchApplication");
 		setupScreenScale();
 
 		base::InitObservables([] {
 			Instance()._handleObservables.call();
 		});
 
-		_application = std::make_unique<Application>(_launcher);
+		{
+			const auto phase = StartupPhase("Application::create");
+			_application = std::make_unique<Application>(_launcher);
+		}
 
 		// Ideally this should go to constructor.
 		// But we want to catch all native events and Application installs
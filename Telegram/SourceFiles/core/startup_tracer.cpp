@@ -0,0 +1,168 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/startup_tracer.h"
+
+#include <QtCore/QMutex>
+#include <chrono>
+#include <map>
+
+namespace Core {
+namespace {
+
+constexpr auto kRecordsLimit = 65536;
+constexpr auto kMarkDuration = int64(-1);
+
+struct Record {
+	const char *name = nullptr;
+	int64 started = 0;
+	int64 duration = 0;
+	int thread = 0;
+};
+
+struct Records {
+	QMutex mutex;
+	std::vector<Record> list;
+};
+
+[[nodiscard]] Records &Recorded() {
+	static auto Instance = Records();
+	return Instance;
+}
+
+[[nodiscard]] int64 NowMicroseconds() {
+	using Clock = std::chrono::steady_clock;
+	static const auto Start = Clock::now();
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		Clock::now() - Start).count();
+}
+
+[[nodiscard]] int CurrentThread() {
+	static auto Threads = std::atomic<int>(0);
+	thread_local const auto Result = ++Threads;
+	return Result;
+}
+
+void Push(Record record) {
+	auto &records = Recorded();
+	QMutexLocker lock(&records.mutex);
+	if (records.list.size() < kRecordsLimit) {
+		records.list.push_back(record);
+	}
+}
+
+[[nodiscard]] std::vector<Record> TakeRecords() {
+	auto &records = Recorded();
+	QMutexLocker lock(&records.mutex);
+	return base::take(records.list);
+}
+
+[[nodiscard]] QString Summary(const std::vector<Record> &records) {
+	struct Total {
+		int64 duration = 0;
+		int count = 0;
+	};
+	auto totals = std::map<QString, Total>();
+	auto result = QStringList();
+	for (const auto &record : records) {
+		if (record.duration == kMarkDuration) {
+			result.push_back(qsl("%1 at %2 ms"
+				).arg(record.name
+				).arg(record.started / 1000., 0, 'f', 1));
+			continue;
+		}
+		auto &total = totals[record.name];
+		total.duration += record.duration;
+		++total.count;
+	}
+	for (const auto &[name, total] : totals) {
+		result.push_back(qsl("%1: %2 ms in %3 calls"
+			).arg(name
+			).arg(total.duration / 1000., 0, 'f', 1
+			).arg(total.count));
+	}
+	return result.join('\n');
+}
+
+[[nodiscard]] QByteArray ChromeTrace(const std::vector<Record> &records) {
+	auto result = QByteArray("{\"traceEvents\":[");
+	auto first = true;
+	for (const auto &record : records) {
+		if (!first) {
+			result.append(',');
+		}
+		first = false;
+		if (record.duration == kMarkDuration) {
+			result.append(QString(
+				"{\"name\":\"%1\",\"cat\":\"startup\",\"ph\":\"i\","
+				"\"s\":\"g\",\"ts\":%2,\"pid\":1,\"tid\":%3}"
+			).arg(record.name
+			).arg(record.started
+			).arg(record.thread).toUtf8());
+		} else {
+			result.append(QString(
+				"{\"name\":\"%1\",\"cat\":\"startup\",\"ph\":\"X\","
+				"\"ts\":%2,\"dur\":%3,\"pid\":1,\"tid\":%4}"
+			).arg(record.name
+			).arg(record.started
+			).arg(record.duration
+			).arg(record.thread).toUtf8());
+		}
+	}
+	result.append("]}");
+	return result;
+}
+
+} // namespace
+
+StartupPhase::StartupPhase(const char *name) : _name(name) {
+	if (StartupTracerEnabled()) {
+		_started = NowMicroseconds();
+	}
+}
+
+StartupPhase::~StartupPhase() {
+	if (_started >= 0 && StartupTracerEnabled()) {
+		Push({
+			_name,
+			_started,
+			NowMicroseconds() - _started,
+			CurrentThread() });
+	}
+}
+
+void StartupTracerStart() {
+	NowMicroseconds();
+	StartupTracerEnabledFlag.store(true, std::memory_order_relaxed);
+}
+
+void StartupTracerMark(const char *name) {
+	if (StartupTracerEnabled()) {
+		Push({ name, NowMicroseconds(), kMarkDuration, CurrentThread() });
+	}
+}
+
+void StartupTracerFinish() {
+	if (!StartupTracerEnabled()) {
+		return;
+	}
+	StartupTracerEnabledFlag.store(false, std::memory_order_relaxed);
+
+	const auto records = TakeRecords();
+	LOG(("Startup Trace:\n%1").arg(Summary(records)));
+
+	const auto path = cWorkingDir() + "startup_trace.json";
+	auto f = QFile(path);
+	if (f.open(QIODevice::WriteOnly)) {
+		f.write(ChromeTrace(records));
+		f.close();
+	} else {
+		LOG(("Startup Trace Error: could not write '%1'.").arg(path));
+	}
+}
+
+} // namespace Core
@@ -0,0 +1,43 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <atomic>
+
+namespace Core {
+
+// Records named startup phases when launched with -tracestartup and writes
+// them as a Chrome trace after the first main window paint. Phases may nest
+// and repeat, afterwards each scope costs one relaxed flag check.
+inline std::atomic<bool> StartupTracerEnabledFlag = false;
+
+[[nodiscard]] inline bool StartupTracerEnabled() {
+	return StartupTracerEnabledFlag.load(std::memory_order_relaxed);
+}
+
+class StartupPhase final {
+public:
+	explicit StartupPhase(const char *name);
+	StartupPhase(const StartupPhase &other) = delete;
+	StartupPhase &operator=(const StartupPhase &other) = delete;
+	~StartupPhase();
+
+private:
+	const char *_name = nullptr;
+	int64 _started = -1;
+
+};
+
+void StartupTracerStart();
+void StartupTracerMark(const char *name);
+
+// Logs the time spent in each phase, writes the trace to the working
+// folder and stops recording.
+void StartupTracerFinish();
+
+} // namespace Core
@@ -0,0 +1,228 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/timer_wheel.h"
+
+#include "base/timer.h"
+
+namespace Core {
+namespace details {
+namespace {
+
+constexpr auto kTick = crl::time(1000);
+constexpr auto kSlotBits = 6;
+constexpr auto kSlotsCount = (1 << kSlotBits);
+constexpr auto kSlotMask = kSlotsCount - 1;
+constexpr auto kLevelsCount = 3;
+constexpr auto kMaxDelta = (int64(1) << (kSlotBits * kLevelsCount)) - 1;
+constexpr auto kFiringLevel = kLevelsCount;
+
+} // namespace
+
+// Three levels of 64 slots: seconds, 64 second blocks and 4096 second
+// blocks. A slot of the upper level is moved to the lower one when the
+// current tick enters its block, so each timer is moved at most twice.
+class TimerWheel final {
+public:
+	TimerWheel();
+
+	void add(not_null<WheelTimer*> timer);
+	void remove(not_null<WheelTimer*> timer);
+
+private:
+	using Slot = std::vector<WheelTimer*>;
+
+	[[nodiscard]] static int64 TickFromTime(crl::time time);
+	[[nodiscard]] static int64 DueTick(not_null<WheelTimer*> timer);
+	void place(not_null<WheelTimer*> timer);
+	void cascade(int level);
+	void advance();
+	void fire();
+	void schedule();
+	[[nodiscard]] std::optional<int64> nextWakeTick() const;
+
+	std::array<std::array<Slot, kSlotsCount>, kLevelsCount> _slots;
+	Slot _firing;
+	int64 _tick = 0;
+	int64 _scheduledTick = 0;
+	int _count = 0;
+	base::Timer _timer;
+
+};
+
+TimerWheel::TimerWheel()
+: _tick(TickFromTime(crl::now()))
+, _timer([=] { advance(); }) {
+}
+
+int64 TimerWheel::TickFromTime(crl::time time) {
+	return time / kTick;
+}
+
+int64 TimerWheel::DueTick(not_null<WheelTimer*> timer) {
+	return (timer->_when + kTick - 1) / kTick;
+}
+
+void TimerWheel::add(not_null<WheelTimer*> timer) {
+	Expects(timer->_level < 0);
+
+	if (!_count) {
+		_tick = TickFromTime(crl::now());
+	}
+	++_count;
+	place(timer);
+	schedule();
+}
+
+void TimerWheel::remove(not_null<WheelTimer*> timer) {
+	if (timer->_level < 0) {
+		return;
+	} else if (timer->_level == kFiringLevel) {
+		_firing[timer->_index] = nullptr;
+	} else {
+		auto &slot = _slots[timer->_level][timer->_slot];
+		const auto last = slot.back();
+		slot[timer->_index] = last;
+		last->_index = timer->_index;
+		slot.pop_back();
+	}
+	timer->_level = timer->_slot = timer->_index = -1;
+	--_count;
+}
+
+void TimerWheel::place(not_null<WheelTimer*> timer) {
+	const auto due = std::max(DueTick(timer), _tick + 1);
+	const auto tick = std::min(due, _tick + kMaxDelta);
+	const auto delta = tick - _tick;
+	auto level = 0;
+	while (delta >> (kSlotBits * (level + 1))) {
+		++level;
+	}
+	const auto index = int((tick >> (kSlotBits * level)) & kSlotMask);
+	auto &slot = _slots[level][index];
+	timer->_level = level;
+	timer->_slot = index;
+	timer->_index = int(slot.size());
+	slot.push_back(timer);
+}
+
+void TimerWheel::cascade(int level) {
+	const auto index = int((_tick >> (kSlotBits * level)) & kSlotMask);
+	for (const auto timer : base::take(_slots[level][index])) {
+		place(timer);
+	}
+}
+
+void TimerWheel::advance() {
+	const auto now = TickFromTime(crl::now());
+	while (_count > 0 && _tick < now) {
+		++_tick;
+		for (auto level = kLevelsCount - 1; level > 0; --level) {
+			const auto lowerMask = (int64(1) << (kSlotBits * level)) - 1;
+			if (!(_tick & lowerMask)) {
+				cascade(level);
+			}
+		}
+		fire();
+	}
+	_tick = now;
+	_scheduledTick = 0;
+	schedule();
+}
+
+void TimerWheel::fire() {
+	Expects(_firing.empty());
+
+	_firing = base::take(_slots[0][_tick & kSlotMask]);
+	for (auto i = 0, count = int(_firing.size()); i != count; ++i) {
+		const auto timer = _firing[i];
+		timer->_level = kFiringLevel;
+		timer->_index = i;
+	}
+	for (auto i = 0; i != int(_firing.size()); ++i) {
+		const auto timer = _firing[i];
+		if (!timer) {
+			continue;
+		}
+		_firing[i] = nullptr;
+		timer->_level = timer->_slot = timer->_index = -1;
+		if (DueTick(timer) > _tick) {
+			// Was placed with a clamped delta.
+			place(timer);
+			continue;
+		}
+		--_count;
+		timer->_when = 0;
+		if (const auto &callback = timer->_callback) {
+			callback();
+		}
+	}
+	_firing.clear();
+}
+
+std::optional<int64> TimerWheel::nextWakeTick() const {
+	if (!_count) {
+		return std::nullopt;
+	}
+	for (auto i = 1; i != kSlotsCount; ++i) {
+		if (!_slots[0][(_tick + i) & kSlotMask].empty()) {
+			return _tick + i;
+		}
+	}
+	return ((_tick >> kSlotBits) + 1) << kSlotBits;
+}
+
+void TimerWheel::schedule() {
+	const auto next = nextWakeTick();
+	if (!next) {
+		_timer.cancel();
+		_scheduledTick = 0;
+		return;
+	} else if (_scheduledTick && _scheduledTick <= *next) {
+		return;
+	}
+	_scheduledTick = *next;
+	_timer.callOnce(std::max(*next * kTick - crl::now(), crl::time(0)));
+}
+
+[[nodiscard]] TimerWheel &Wheel() {
+	static auto Instance = TimerWheel();
+	return Instance;
+}
+
+} // namespace details
+
+WheelTimer::WheelTimer(Fn<void()> callback)
+: _callback(std::move(callback)) {
+}
+
+WheelTimer::~WheelTimer() {
+	cancel();
+}
+
+void WheelTimer::setCallback(Fn<void()> callback) {
+	_callback = std::move(callback);
+}
+
+void WheelTimer::callOnce(crl::time timeout) {
+	cancel();
+	_when = std::max(crl::now() + timeout, crl::time(1));
+	details::Wheel().add(this);
+}
+
+void WheelTimer::cancel() {
+	if (_when) {
+		details::Wheel().remove(this);
+		_when = 0;
+	}
+}
+
+crl::time WheelTimer::remainingTime() const {
+	return _when ? std::max(_when - crl::now(), crl::time(0)) : 0;
+}
+
+} // namespace Core
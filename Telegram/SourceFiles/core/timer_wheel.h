@@ -0,0 +1,47 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Core {
+namespace details {
+class TimerWheel;
+} // namespace details
+
+// Single shot timer with a precision of one second for long expirations,
+// like "last seen" texts or mute periods. All such timers share one
+// hierarchical timer wheel, so the ones that are due in the same second
+// are served by a single wakeup. Main thread only.
+class WheelTimer final {
+public:
+	WheelTimer() = default;
+	explicit WheelTimer(Fn<void()> callback);
+	WheelTimer(const WheelTimer &other) = delete;
+	WheelTimer &operator=(const WheelTimer &other) = delete;
+	~WheelTimer();
+
+	void setCallback(Fn<void()> callback);
+	void callOnce(crl::time timeout);
+	void cancel();
+
+	[[nodiscard]] bool isActive() const {
+		return (_when != 0);
+	}
+	[[nodiscard]] crl::time remainingTime() const;
+
+private:
+	friend class details::TimerWheel;
+
+	Fn<void()> _callback;
+	crl::time _when = 0;
+	int _level = -1;
+	int _slot = -1;
+	int _index = -1;
+
+};
+
+} // namespace Core
@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_user.h"
 #include "data/data_chat.h"
 #include "data/data_session.h"
+#include "data/data_peer_allocator.h"
 #include "data/data_folder.h"
 #include "data/data_location.h"
 #include "data/data_histories.h"
@@ -44,6 +45,14 @@ void MegagroupInfo::setLocation(const ChannelLocation &location) {
 	_location = location;
 }
 
+void *ChannelData::operator new(std::size_t size) {
+	return Data::PeerAllocator<ChannelData>::Allocate(size);
+}
+
+void ChannelData::operator delete(void *pointer) {
+	Data::PeerAllocator<ChannelData>::Deallocate(pointer);
+}
+
 ChannelData::ChannelData(not_null<Data::Session*> owner, PeerId id)
 : PeerData(owner, id)
 , inputChannel(MTP_inputChannel(MTP_int(bareId()), MTP_long(0))) {
@@ -377,12 +386,16 @@ QString ChannelData::adminRank(not_null<UserData*> user) const {
 
 auto ChannelData::unavailableReasons() const
 -> const std::vector<Data::UnavailableReason> & {
-	return _unavailableReasons;
+	static const auto kEmpty = std::vector<Data::UnavailableReason>();
+	return _unavailableReasons ? *_unavailableReasons : kEmpty;
 }
 
 void ChannelData::setUnavailableReasons(std::vector<Data::UnavailableReason> &&reasons) {
-	if (_unavailableReasons != reasons) {
-		_unavailableReasons = std::move(reasons);
+	if (unavailableReasons() != reasons) {
+		_unavailableReasons = reasons.empty()
+			? nullptr
+			: std::make_unique<std::vector<Data::UnavailableReason>>(
+				std::move(reasons));
 		Notify::peerUpdatedDelayed(
 			this,
 			Notify::PeerUpdate::Flag::UnavailableReasonChanged);
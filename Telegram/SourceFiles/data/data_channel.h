@@ -123,6 +123,9 @@ public:
 
 	ChannelData(not_null<Data::Session*> owner, PeerId id);
 
+	static void *operator new(std::size_t size);
+	static void operator delete(void *pointer);
+
 	void setPhoto(const MTPChatPhoto &photo);
 	void setPhoto(PhotoId photoId, const MTPChatPhoto &photo);
 
@@ -422,7 +425,9 @@ private:
 	RestrictionFlags _restrictions;
 	TimeId _restrictedUntil;
 
-	std::vector<Data::UnavailableReason> _unavailableReasons;
+	// Allocated only for the few restricted peers.
+	std::unique_ptr<
+		std::vector<Data::UnavailableReason>> _unavailableReasons;
 	QString _inviteLink;
 	ChannelData *_linkedChat = nullptr;
 
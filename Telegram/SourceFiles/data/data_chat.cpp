@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_user.h"
 #include "data/data_channel.h"
 #include "data/data_session.h"
+#include "data/data_peer_allocator.h"
 #include "history/history.h"
 #include "main/main_session.h"
 #include "apiwrap.h"
@@ -21,6 +22,14 @@ using UpdateFlag = Notify::PeerUpdate::Flag;
 
 } // namespace
 
+void *ChatData::operator new(std::size_t size) {
+	return Data::PeerAllocator<ChatData>::Allocate(size);
+}
+
+void ChatData::operator delete(void *pointer) {
+	Data::PeerAllocator<ChatData>::Deallocate(pointer);
+}
+
 ChatData::ChatData(not_null<Data::Session*> owner, PeerId id)
 : PeerData(owner, id)
 , inputChat(MTP_int(bareId())) {
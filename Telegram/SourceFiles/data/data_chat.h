@@ -38,6 +38,9 @@ public:
 
 	ChatData(not_null<Data::Session*> owner, PeerId id);
 
+	static void *operator new(std::size_t size);
+	static void operator delete(void *pointer);
+
 	void setPhoto(const MTPChatPhoto &photo);
 	void setPhoto(PhotoId photoId, const MTPChatPhoto &photo);
 
@@ -42,22 +42,25 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace {
 
-// Updated Mar 3, 2020: Increase the size of the memory cache for media, to prevent items still being displayed from being unloaded.
-constexpr auto kMemoryForCache = 128 * 1024 * 1024; // was 32, updated to 128
 const auto kAnimatedStickerDimensions = QSize(512, 512);
+constexpr auto kStickerSmallSize = 128;
 
 using FilePathResolve = DocumentData::FilePathResolve;
 
 Core::MediaActiveCache<DocumentData> &ActiveCache() {
 	static auto Instance = Core::MediaActiveCache<DocumentData>(
-		kMemoryForCache,
+		Core::MediaMemoryKind::Documents,
 		[](DocumentData *document) { document->unload(); });
 	return Instance;
 }
 
+int64 ComputeUsage(const std::unique_ptr<Image> &image) {
+	return image ? (int64(image->width()) * image->height() * 4) : 0;
+}
+
 int64 ComputeUsage(StickerData *sticker) {
-	return (sticker != nullptr && sticker->image != nullptr)
-		? sticker->image->width() * sticker->image->height() * 4
+	return (sticker != nullptr)
+		? (ComputeUsage(sticker->image) + ComputeUsage(sticker->small))
 		: 0;
 }
 
@@ -718,9 +721,10 @@ void DocumentData::unload() {
 	//_thumbnailInline->unload();
 	//_thumbnail->unload();
 	if (sticker()) {
-		if (sticker()->image) {
+		if (sticker()->image || sticker()->small) {
 			ActiveCache().decrement(ComputeUsage(sticker()));
 			sticker()->image = nullptr;
+			sticker()->small = nullptr;
 		}
 	}
 	_replyPreview.clear();
@@ -795,7 +799,8 @@ bool DocumentData::loaded(FilePathResolve resolve) const {
 						_data,
 						_loader->imageFormat(),
 						_loader->imageData()));
-				ActiveCache().increment(ComputeUsage(that->sticker()));
+				ActiveCache().increment(
+					ComputeUsage(that->sticker()->image));
 			}
 
 			that->refreshGoodThumbnail();
@@ -893,6 +898,14 @@ bool DocumentData::waitingForAlbum() const {
 	return uploading() && uploadingData->waitingForAlbum;
 }
 
+void DocumentData::setFilledFromServer() {
+	_flags |= Flag::FilledFromServer;
+}
+
+bool DocumentData::filledFromServer() const {
+	return (_flags & Flag::FilledFromServer);
+}
+
 void DocumentData::save(
 		Data::FileOrigin origin,
 		const QString &toFile,
@@ -1190,6 +1203,7 @@ void DocumentData::checkStickerLarge() {
 
 	automaticLoad(stickerSetOrigin(), nullptr);
 	if (!data->image && !data->animated && loaded()) {
+		const auto was = ComputeUsage(data);
 		if (_data.isEmpty()) {
 			const auto &loc = location(true);
 			if (loc.accessEnable()) {
@@ -1207,7 +1221,7 @@ void DocumentData::checkStickerLarge() {
 					format,
 					std::move(image)));
 		}
-		if (const auto usage = ComputeUsage(data)) {
+		if (const auto usage = ComputeUsage(data) - was) {
 			ActiveCache().increment(usage);
 			ActiveCache().up(this);
 		}
@@ -1221,8 +1235,49 @@ void DocumentData::checkStickerSmall() {
 		if (data && data->animated) {
 			automaticLoad(stickerSetOrigin(), nullptr);
 		}
+	} else if (data) {
+		checkStickerSmallImage();
+	}
+}
+
+void DocumentData::checkStickerSmallImage() {
+	const auto data = sticker();
+	Assert(data != nullptr);
+
+	automaticLoad(stickerSetOrigin(), nullptr);
+	if (data->image || data->small || !loaded()) {
+		return;
+	}
+
+	// Static stickers are 512x512, the panels never show them that big.
+	const auto box = QSize(kStickerSmallSize, kStickerSmallSize)
+		* cIntRetinaFactor();
+	if (_data.isEmpty()) {
+		const auto &loc = location(true);
+		if (loc.accessEnable()) {
+			data->small = std::make_unique<Image>(
+				std::make_unique<Images::LocalFileSource>(
+					loc.name(),
+					QByteArray(),
+					QByteArray(),
+					QImage(),
+					box));
+			loc.accessDisable();
+		}
 	} else {
-		checkStickerLarge();
+		auto format = QByteArray();
+		auto image = Images::ReadScaled(_data, box, &format);
+		data->small = std::make_unique<Image>(
+			std::make_unique<Images::LocalFileSource>(
+				QString(),
+				_data,
+				format,
+				std::move(image),
+				box));
+	}
+	if (const auto usage = ComputeUsage(data->small)) {
+		ActiveCache().increment(usage);
+		ActiveCache().up(this);
 	}
 }
 
@@ -1239,7 +1294,7 @@ Image *DocumentData::getStickerSmall() {
 	if ((data && data->animated) || thumbnailEnoughForSticker()) {
 		return _thumbnail->isNull() ? nullptr : _thumbnail.get();
 	} else if (data) {
-		return data->image.get();
+		return data->small ? data->small.get() : data->image.get();
 	}
 	return nullptr;
 }
@@ -1287,6 +1342,10 @@ bool DocumentData::hasRemoteLocation() const {
 	return (_dc != 0 && _access != 0);
 }
 
+int32 DocumentData::dcId() const {
+	return _dc;
+}
+
 bool DocumentData::useStreamingLoader() const {
 	return isAnimation()
 		|| isVideoFile()
@@ -57,6 +57,7 @@ struct StickerData : public DocumentAdditionalData {
 	Data::FileOrigin setOrigin() const;
 
 	std::unique_ptr<Image> image;
+	std::unique_ptr<Image> small; // Decoded to fit the sticker panels.
 	bool animated = false;
 	QString alt;
 	MTPInputStickerSet set = MTP_inputStickerSetEmpty();
@@ -125,6 +126,11 @@ public:
 	void setWaitingForAlbum();
 	[[nodiscard]] bool waitingForAlbum() const;
 
+	// Set when the fields were applied from an MTP document,
+	// not from the local storage.
+	void setFilledFromServer();
+	[[nodiscard]] bool filledFromServer() const;
+
 	[[nodiscard]] QByteArray data() const;
 	[[nodiscard]] const FileLocation &location(bool check = false) const;
 	void setLocation(const FileLocation &loc);
@@ -196,6 +202,7 @@ public:
 	void setContentUrl(const QString &url);
 	void setWebLocation(const WebFileLocation &location);
 	[[nodiscard]] bool hasRemoteLocation() const;
+	[[nodiscard]] int32 dcId() const;
 	[[nodiscard]] bool hasWebLocation() const;
 	[[nodiscard]] bool isNull() const;
 	[[nodiscard]] MTPInputDocument mtpInput() const;
@@ -254,6 +261,7 @@ private:
 		ImageType = 0x08,
 		DownloadCancelled = 0x10,
 		LoadedInMediaCache = 0x20,
+		FilledFromServer = 0x40,
 	};
 	using Flags = base::flags<Flag>;
 	friend constexpr bool is_flag_type(Flag) { return true; };
@@ -275,6 +283,7 @@ private:
 	LocationType locationType() const;
 	void validateLottieSticker();
 	void validateGoodThumbnail();
+	void checkStickerSmallImage();
 	void setMaybeSupportsStreaming(bool supports);
 	void setLoadedInMediaCacheLocation();
 
@@ -196,6 +196,10 @@ QImage GoodThumbSource::takeLoaded() {
 	return std::move(_loaded);
 }
 
+QImage GoodThumbSource::preview() {
+	return QImage();
+}
+
 void GoodThumbSource::unload() {
 	_loaded = QImage();
 	cancel();
@@ -21,6 +21,7 @@ public:
 	void load(FileOrigin origin) override;
 	void loadEvenCancelled(FileOrigin origin) override;
 	QImage takeLoaded() override;
+	QImage preview() override;
 	void unload() override;
 
 	void automaticLoad(
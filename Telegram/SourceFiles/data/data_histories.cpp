@@ -372,28 +372,17 @@ void Histories::requestFakeChatListMessage(
 	}
 
 	_fakeChatListRequests.emplace(history);
-	sendRequest(history, RequestType::History, [=](Fn<void()> finish) {
-		return session().api().request(MTPmessages_GetHistory(
-			history->peer->input,
-			MTP_int(0),  // offset_id
-			MTP_int(0),  // offset_date
-			MTP_int(0),  // add_offset
-			MTP_int(2),  // limit
-			MTP_int(0),  // max_id
-			MTP_int(0),  // min_id
-			MTP_int(0)
-		)).done([=](const MTPmessages_Messages &result) {
-			_fakeChatListRequests.erase(history);
-			history->setFakeChatListMessageFrom(result);
-			finish();
-		}).fail([=](const RPCError &error) {
-			_fakeChatListRequests.erase(history);
-			history->setFakeChatListMessageFrom(MTP_messages_messages(
-				MTP_vector<MTPMessage>(0),
-				MTP_vector<MTPChat>(0),
-				MTP_vector<MTPUser>(0)));
-			finish();
-		}).send();
+	const auto range = MessagesRange{ 0, 0, 2 };
+	requestMessages(history, range, [=](
+			const MTPmessages_Messages &result) {
+		_fakeChatListRequests.erase(history);
+		history->setFakeChatListMessageFrom(result);
+	}, [=](const RPCError &error) {
+		_fakeChatListRequests.erase(history);
+		history->setFakeChatListMessageFrom(MTP_messages_messages(
+			MTP_vector<MTPMessage>(0),
+			MTP_vector<MTPChat>(0),
+			MTP_vector<MTPUser>(0)));
 	});
 }
 
@@ -415,6 +404,9 @@ void Histories::sendReadRequests() {
 	for (auto &[history, state] : _states) {
 		if (!state.willReadTill) {
 			continue;
+		} else if (state.sentReadTill && !state.sentReadDone) {
+			// Wait for the sent one, it will send the merged mark when done.
+			continue;
 		} else if (state.willReadWhen <= now) {
 			sendReadRequest(history, state);
 		} else if (!next || *next > state.willReadWhen) {
@@ -627,6 +619,10 @@ void Histories::checkPostponed(not_null<History*> history, int id) {
 }
 
 void Histories::cancelRequest(int id) {
+	if (const auto key = _messagesRequestBySubscriber.take(id)) {
+		cancelMessagesSubscriber(*key, id);
+		return;
+	}
 	const auto history = _historyByRequest.take(id);
 	if (!history) {
 		return;
@@ -675,6 +671,109 @@ void Histories::finishSentRequest(
 	checkEmptyState(history);
 }
 
+int Histories::requestMessages(
+		not_null<History*> history,
+		MessagesRange range,
+		Fn<void(const MTPmessages_Messages&)> done,
+		Fn<void(const RPCError&)> fail) {
+	Expects(range.limit > 0);
+
+	const auto subscriber = ++_requestAutoincrement;
+	auto handlers = MessagesRequestHandlers{
+		std::move(done),
+		std::move(fail)
+	};
+
+	// The server returns the same slice for the same offset_id, so a
+	// request with a window inside an already sent one gets its result.
+	const auto covers = [&](const auto &pair) {
+		const auto &shared = pair.second;
+		return (shared.history == history)
+			&& (shared.range.offsetId == range.offsetId)
+			&& (shared.range.addOffset <= range.addOffset)
+			&& (range.addOffset + range.limit
+				<= shared.range.addOffset + shared.range.limit);
+	};
+	const auto i = ranges::find_if(_messagesRequests, covers);
+	if (i != end(_messagesRequests)) {
+		++_messagesRequestsMerged;
+		i->second.handlers.emplace(subscriber, std::move(handlers));
+		_messagesRequestBySubscriber.emplace(subscriber, i->first);
+		return subscriber;
+	}
+
+	const auto key = subscriber;
+	auto &shared = _messagesRequests.emplace(
+		key,
+		SharedMessagesRequest{ history, range }).first->second;
+	shared.handlers.emplace(subscriber, std::move(handlers));
+	_messagesRequestBySubscriber.emplace(subscriber, key);
+
+	const auto id = sendRequest(history, RequestType::History, [=](
+			Fn<void()> finish) {
+		return session().api().request(MTPmessages_GetHistory(
+			history->peer->input,
+			MTP_int(range.offsetId),
+			MTP_int(0), // offset_date
+			MTP_int(range.addOffset),
+			MTP_int(range.limit),
+			MTP_int(0), // max_id
+			MTP_int(0), // min_id
+			MTP_int(0) // hash
+		)).done([=](const MTPmessages_Messages &result) {
+			for (const auto &handlers : takeMessagesHandlers(key)) {
+				if (handlers.done) {
+					handlers.done(result);
+				}
+			}
+			finish();
+		}).fail([=](const RPCError &error) {
+			for (const auto &handlers : takeMessagesHandlers(key)) {
+				if (handlers.fail) {
+					handlers.fail(error);
+				}
+			}
+			finish();
+		}).send();
+	});
+	const auto j = _messagesRequests.find(key);
+	Assert(j != end(_messagesRequests));
+	j->second.id = id;
+	return subscriber;
+}
+
+int Histories::mergedMessagesRequests() const {
+	return _messagesRequestsMerged;
+}
+
+auto Histories::takeMessagesHandlers(int key)
+-> std::vector<MessagesRequestHandlers> {
+	auto shared = _messagesRequests.take(key);
+	if (!shared) {
+		return {};
+	}
+	auto result = std::vector<MessagesRequestHandlers>();
+	result.reserve(shared->handlers.size());
+	for (auto &[subscriber, handlers] : shared->handlers) {
+		_messagesRequestBySubscriber.remove(subscriber);
+		result.push_back(std::move(handlers));
+	}
+	return result;
+}
+
+void Histories::cancelMessagesSubscriber(int key, int subscriber) {
+	const auto i = _messagesRequests.find(key);
+	if (i == end(_messagesRequests)) {
+		return;
+	}
+	i->second.handlers.remove(subscriber);
+	if (i->second.handlers.empty()) {
+		const auto id = i->second.id;
+		_messagesRequests.erase(i);
+		cancelRequest(id);
+	}
+}
+
 Histories::State *Histories::lookup(not_null<History*> history) {
 	const auto i = _states.find(history);
 	return (i != end(_states)) ? &i->second : nullptr;
@@ -31,6 +31,13 @@ public:
 		Send,
 	};
 
+	// Arguments of messages.getHistory that select the returned slice.
+	struct MessagesRange {
+		MsgId offsetId = 0;
+		int addOffset = 0;
+		int limit = 0;
+	};
+
 	explicit Histories(not_null<Session*> owner);
 
 	[[nodiscard]] Session &owner() const;
@@ -74,6 +81,15 @@ public:
 		Fn<mtpRequestId(Fn<void()> finish)> generator);
 	void cancelRequest(int id);
 
+	// Shares one messages.getHistory between all callers whose range
+	// lies inside a range that is already being requested.
+	int requestMessages(
+		not_null<History*> history,
+		MessagesRange range,
+		Fn<void(const MTPmessages_Messages&)> done,
+		Fn<void(const RPCError&)> fail = nullptr);
+	[[nodiscard]] int mergedMessagesRequests() const;
+
 private:
 	struct PostponedHistoryRequest {
 		Fn<mtpRequestId(Fn<void()> finish)> generator;
@@ -83,6 +99,16 @@ private:
 		mtpRequestId id = 0;
 		RequestType type = RequestType::None;
 	};
+	struct MessagesRequestHandlers {
+		Fn<void(const MTPmessages_Messages&)> done;
+		Fn<void(const RPCError&)> fail;
+	};
+	struct SharedMessagesRequest {
+		not_null<History*> history;
+		MessagesRange range;
+		int id = 0;
+		base::flat_map<int, MessagesRequestHandlers> handlers;
+	};
 	struct State {
 		base::flat_map<int, PostponedHistoryRequest> postponed;
 		base::flat_map<int, SentRequest> sent;
@@ -106,6 +132,9 @@ private:
 	[[nodiscard]] bool postponeHistoryRequest(const State &state) const;
 	[[nodiscard]] bool postponeEntryRequest(const State &state) const;
 	void postponeRequestDialogEntries();
+	[[nodiscard]] std::vector<MessagesRequestHandlers> takeMessagesHandlers(
+		int key);
+	void cancelMessagesSubscriber(int key, int subscriber);
 
 	void sendDialogRequests();
 	void applyPeerDialogs(const MTPmessages_PeerDialogs &dialogs);
@@ -116,6 +145,9 @@ private:
 	base::flat_map<not_null<History*>, State> _states;
 	base::flat_map<int, not_null<History*>> _historyByRequest;
 	int _requestAutoincrement = 0;
+	base::flat_map<int, SharedMessagesRequest> _messagesRequests;
+	base::flat_map<int, int> _messagesRequestBySubscriber;
+	int _messagesRequestsMerged = 0;
 	base::Timer _readRequestsTimer;
 
 	base::flat_set<not_null<Data::Folder*>> _dialogFolderRequests;
@@ -0,0 +1,123 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_messages_index.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kMinCapacity = 256;
+
+} // namespace
+
+uint64 MessagesIndex::Key(ChannelId channel, MsgId msg) {
+	return (uint64(uint32(channel)) << 32) | uint64(uint32(msg));
+}
+
+uint64 MessagesIndex::Hash(uint64 key) {
+	// Finalizer from MurmurHash3, message ids are sequential.
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	key *= 0xC4CEB9FE1A85EC53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+int MessagesIndex::lookup(uint64 key) const {
+	if (_slots.empty()) {
+		return -1;
+	}
+	const auto mask = int(_slots.size()) - 1;
+	for (auto i = int(Hash(key) & uint64(mask));; i = (i + 1) & mask) {
+		const auto &slot = _slots[i];
+		if (!slot.item) {
+			return -1;
+		} else if (slot.key == key) {
+			return i;
+		}
+	}
+}
+
+HistoryItem *MessagesIndex::find(ChannelId channel, MsgId msg) const {
+	const auto index = lookup(Key(channel, msg));
+	return (index >= 0) ? _slots[index].item : nullptr;
+}
+
+HistoryItem *MessagesIndex::insert(
+		FullMsgId id,
+		not_null<HistoryItem*> item) {
+	// Keep the load factor under 3/4, probe sequences stay short.
+	if ((_count + 1) * 4 > int(_slots.size()) * 3) {
+		rehash(std::max(int(_slots.size()) * 2, kMinCapacity));
+	}
+	const auto key = Key(id.channel, id.msg);
+	const auto mask = int(_slots.size()) - 1;
+	for (auto i = int(Hash(key) & uint64(mask));; i = (i + 1) & mask) {
+		auto &slot = _slots[i];
+		if (!slot.item) {
+			slot.key = key;
+			slot.item = item;
+			++_count;
+			return nullptr;
+		} else if (slot.key == key) {
+			return std::exchange(slot.item, item.get());
+		}
+	}
+}
+
+HistoryItem *MessagesIndex::take(FullMsgId id) {
+	auto index = lookup(Key(id.channel, id.msg));
+	if (index < 0) {
+		return nullptr;
+	}
+	const auto result = _slots[index].item;
+	--_count;
+
+	// Backward shift deletion, so no tombstones are needed.
+	const auto mask = int(_slots.size()) - 1;
+	for (auto next = (index + 1) & mask;; next = (next + 1) & mask) {
+		const auto &slot = _slots[next];
+		if (!slot.item) {
+			break;
+		}
+		const auto home = int(Hash(slot.key) & uint64(mask));
+		const auto stays = (next > index)
+			? (home > index && home <= next)
+			: (home > index || home <= next);
+		if (!stays) {
+			_slots[index] = slot;
+			index = next;
+		}
+	}
+	_slots[index] = Slot();
+	return result;
+}
+
+void MessagesIndex::clear() {
+	base::take(_slots);
+	_count = 0;
+}
+
+void MessagesIndex::rehash(int capacity) {
+	Expects(capacity > 0 && !(capacity & (capacity - 1)));
+
+	auto slots = std::exchange(_slots, std::vector<Slot>(capacity));
+	const auto mask = capacity - 1;
+	for (const auto &slot : slots) {
+		if (!slot.item) {
+			continue;
+		}
+		auto i = int(Hash(slot.key) & uint64(mask));
+		while (_slots[i].item) {
+			i = (i + 1) & mask;
+		}
+		_slots[i] = slot;
+	}
+}
+
+} // namespace Data
@@ -0,0 +1,51 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "data/data_types.h"
+
+class HistoryItem;
+
+namespace Data {
+
+// All loaded messages of a session in one open addressing hash table
+// with linear probing, so that a lookup usually touches one cache line
+// instead of a std::map node and an unordered_map bucket chain.
+class MessagesIndex final {
+public:
+	[[nodiscard]] HistoryItem *find(ChannelId channel, MsgId msg) const;
+	[[nodiscard]] HistoryItem *find(FullMsgId id) const {
+		return find(id.channel, id.msg);
+	}
+
+	// Returns the item that was registered with the same id, if any.
+	HistoryItem *insert(FullMsgId id, not_null<HistoryItem*> item);
+	HistoryItem *take(FullMsgId id);
+
+	[[nodiscard]] int size() const {
+		return _count;
+	}
+	void clear();
+
+private:
+	struct Slot {
+		uint64 key = 0;
+		HistoryItem *item = nullptr; // nullptr for an empty slot.
+	};
+
+	[[nodiscard]] static uint64 Key(ChannelId channel, MsgId msg);
+	[[nodiscard]] static uint64 Hash(uint64 key);
+	[[nodiscard]] int lookup(uint64 key) const;
+	void rehash(int capacity);
+
+	std::vector<Slot> _slots;
+	int _count = 0;
+
+};
+
+} // namespace Data
@@ -0,0 +1,158 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_messages_search_index.h"
+
+#include "history/history.h"
+#include "history/history_item.h"
+
+namespace Data {
+
+void MessagesSearchIndex::add(not_null<HistoryItem*> item) {
+	if (!item->isService()) {
+		_pending.emplace(item);
+	}
+}
+
+void MessagesSearchIndex::changed(not_null<HistoryItem*> item) {
+	unindexOne(item);
+	add(item);
+}
+
+void MessagesSearchIndex::remove(not_null<HistoryItem*> item) {
+	_pending.erase(item);
+	unindexOne(item);
+}
+
+void MessagesSearchIndex::clear() {
+	_items.clear();
+	_words.clear();
+	_pending.clear();
+}
+
+void MessagesSearchIndex::indexPending() {
+	for (const auto item : base::take(_pending)) {
+		indexOne(item);
+	}
+}
+
+void MessagesSearchIndex::indexOne(not_null<HistoryItem*> item) {
+	auto words = TextUtilities::PrepareSearchWords(item->searchText());
+	if (words.isEmpty()) {
+		return;
+	}
+	words.removeDuplicates();
+	for (const auto &word : words) {
+		_items[word].emplace(item);
+	}
+	_words.emplace(item, std::move(words));
+}
+
+void MessagesSearchIndex::unindexOne(not_null<HistoryItem*> item) {
+	const auto i = _words.find(item);
+	if (i == end(_words)) {
+		return;
+	}
+	for (const auto &word : i->second) {
+		const auto j = _items.find(word);
+		if (j != end(_items)) {
+			j->second.remove(item);
+			if (j->second.empty()) {
+				_items.erase(j);
+			}
+		}
+	}
+	_words.erase(i);
+}
+
+std::vector<not_null<HistoryItem*>> MessagesSearchIndex::search(
+		const QString &query,
+		History *history,
+		int limit) {
+	Expects(limit > 0);
+
+	indexPending();
+
+	auto words = TextUtilities::PrepareSearchWords(query);
+	if (words.isEmpty()) {
+		return {};
+	}
+
+	// Take candidates from the word with the fewest matches and check
+	// the rest of the words against the words of each candidate.
+	const auto prefixed = [&](const QString &word) {
+		const auto from = _items.lower_bound(word);
+		auto till = from;
+		while (till != end(_items) && till->first.startsWith(word)) {
+			++till;
+		}
+		return std::make_pair(from, till);
+	};
+	auto best = prefixed(words.front());
+	auto bestCount = 0;
+	for (auto i = best.first; i != best.second; ++i) {
+		bestCount += i->second.size();
+	}
+	for (const auto &word : words) {
+		const auto range = prefixed(word);
+		auto count = 0;
+		for (auto i = range.first; i != range.second; ++i) {
+			count += i->second.size();
+		}
+		if (count < bestCount) {
+			best = range;
+			bestCount = count;
+		}
+	}
+	if (!bestCount) {
+		return {};
+	}
+
+	const auto matches = [&](not_null<HistoryItem*> item) {
+		if (history
+			&& item->history() != history
+			&& item->history() != history->migrateFrom()) {
+			return false;
+		}
+		const auto i = _words.find(item);
+		Assert(i != end(_words));
+		const auto &itemWords = i->second;
+		for (const auto &word : words) {
+			const auto found = ranges::find_if(itemWords, [&](
+					const QString &itemWord) {
+				return itemWord.startsWith(word);
+			});
+			if (found == end(itemWords)) {
+				return false;
+			}
+		}
+		return true;
+	};
+	// An item can be found by several words with the same prefix,
+	// so the candidates are collected first and deduplicated once.
+	auto result = std::vector<not_null<HistoryItem*>>();
+	result.reserve(bestCount);
+	for (auto i = best.first; i != best.second; ++i) {
+		result.insert(end(result), i->second.begin(), i->second.end());
+	}
+	ranges::sort(result);
+	result.erase(std::unique(begin(result), end(result)), end(result));
+	result.erase(
+		ranges::remove_if(result, [&](not_null<HistoryItem*> item) {
+			return !matches(item);
+		}),
+		end(result));
+	ranges::sort(result, ranges::greater(), [](not_null<HistoryItem*> item) {
+		return std::make_pair(item->date(), item->id);
+	});
+	if (result.size() > limit) {
+		result.erase(begin(result) + limit, end(result));
+	}
+	return result;
+}
+
+} // namespace Data
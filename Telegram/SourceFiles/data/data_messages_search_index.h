@@ -0,0 +1,43 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class History;
+class HistoryItem;
+
+namespace Data {
+
+// Word index over the text of loaded messages, so that a search can show
+// messages that are already in memory before the server answers.
+// Items are only queued when they are loaded or edited, the text is split
+// into words when the index is queried for the first time after that.
+class MessagesSearchIndex final {
+public:
+	void add(not_null<HistoryItem*> item);
+	void changed(not_null<HistoryItem*> item);
+	void remove(not_null<HistoryItem*> item);
+	void clear();
+
+	// Newest first, every query word must be a prefix of some item word.
+	[[nodiscard]] std::vector<not_null<HistoryItem*>> search(
+		const QString &query,
+		History *history,
+		int limit);
+
+private:
+	void indexPending();
+	void indexOne(not_null<HistoryItem*> item);
+	void unindexOne(not_null<HistoryItem*> item);
+
+	std::map<QString, base::flat_set<not_null<HistoryItem*>>> _items;
+	std::unordered_map<HistoryItem*, QStringList> _words;
+	std::unordered_set<HistoryItem*> _pending;
+
+};
+
+} // namespace Data
@@ -28,6 +28,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "window/window_session_controller.h"
 #include "ui/image/image.h"
+#include "ui/image/image_userpics.h"
 #include "ui/empty_userpic.h"
 #include "ui/text_options.h"
 #include "history/history.h"
@@ -170,8 +171,12 @@ void PeerData::updateNameDelayed(
 		}
 	}
 	fillNames();
-	if (update.flags) {
-		Notify::PeerUpdated().notify(update, true);
+	if (!update.flags) {
+		return;
+	} else if (owner().peerNamesBatched()) {
+		Notify::peerUpdatedDelayed(update);
+	} else {
+		Notify::peerUpdatedSend(update);
 	}
 }
 
@@ -249,35 +254,92 @@ void PeerData::paintUserpic(Painter &p, int x, int y, int size) const {
 }
 
 void PeerData::paintUserpicCircled(Painter &p, int x, int y, int size) const {
-	if (auto userpic = currentUserpic()) {
-		p.drawPixmap(x, y, userpic->pixCircled(userpicOrigin(), size, size));
-	} else {
-		_userpicEmpty->paint(p, x, y, x + size + x, size);
-	}
+	p.drawPixmap(x, y, preparedUserpic(size, Images::UserpicShape::Circled));
 }
 
 void PeerData::paintUserpicRoundedLarge(Painter &p, int x, int y, int size) const {
-	if (auto userpic = currentUserpic()) {
-		p.drawPixmap(x, y, userpic->pixRounded(userpicOrigin(), size, size, ImageRoundRadius::Large));
-	} else {
-		_userpicEmpty->paintRoundedLarge(p, x, y, x + size + x, size);
-	}
+	p.drawPixmap(x, y, preparedUserpic(size, Images::UserpicShape::RoundedLarge));
 }
 
 void PeerData::paintUserpicRounded(Painter &p, int x, int y, int size) const {
-	if (auto userpic = currentUserpic()) {
-		p.drawPixmap(x, y, userpic->pixRounded(userpicOrigin(), size, size, ImageRoundRadius::Small));
-	} else {
-		_userpicEmpty->paintRounded(p, x, y, x + size + x, size);
-	}
+	p.drawPixmap(x, y, preparedUserpic(size, Images::UserpicShape::Rounded));
 }
 
 void PeerData::paintUserpicSquare(Painter &p, int x, int y, int size) const {
-	if (auto userpic = currentUserpic()) {
-		p.drawPixmap(x, y, userpic->pix(userpicOrigin(), size, size));
-	} else {
-		_userpicEmpty->paintSquare(p, x, y, x + size + x, size);
+	p.drawPixmap(x, y, preparedUserpic(size, Images::UserpicShape::Square));
+}
+
+const QPixmap &PeerData::preparedUserpic(
+		int size,
+		Images::UserpicShape shape) const {
+	using Shape = Images::UserpicShape;
+
+	// Prepared pixmaps stay valid while the original is unloaded,
+	// so look them up before loading the image again.
+	if (_userpic && _userpicLocation.valid()) {
+		const auto key = inMemoryKey(_userpicLocation);
+		if (const auto result = Images::LookupUserpic(key, size, shape)) {
+			return *result;
+		}
+	}
+	if (const auto userpic = currentUserpic()) {
+		const auto origin = userpicOrigin();
+		auto pixmap = [&] {
+			switch (shape) {
+			case Shape::Square:
+				return userpic->pix(origin, size, size);
+			case Shape::Rounded:
+				return userpic->pixRounded(
+					origin,
+					size,
+					size,
+					ImageRoundRadius::Small);
+			case Shape::RoundedLarge:
+				return userpic->pixRounded(
+					origin,
+					size,
+					size,
+					ImageRoundRadius::Large);
+			}
+			return userpic->pixCircled(origin, size, size);
+		}();
+		return Images::RememberUserpic(
+			userpicUniqueKey(),
+			size,
+			shape,
+			std::move(pixmap));
+	}
+	const auto key = _userpicEmpty->uniqueKey();
+	if (const auto result = Images::LookupUserpic(key, size, shape)) {
+		return *result;
+	}
+	auto image = QImage(
+		QSize(size, size) * cIntRetinaFactor(),
+		QImage::Format_ARGB32_Premultiplied);
+	image.setDevicePixelRatio(cRetinaFactor());
+	image.fill(Qt::transparent);
+	{
+		Painter p(&image);
+		switch (shape) {
+		case Shape::Square:
+			_userpicEmpty->paintSquare(p, 0, 0, size, size);
+			break;
+		case Shape::Rounded:
+			_userpicEmpty->paintRounded(p, 0, 0, size, size);
+			break;
+		case Shape::RoundedLarge:
+			_userpicEmpty->paintRoundedLarge(p, 0, 0, size, size);
+			break;
+		case Shape::Circled:
+			_userpicEmpty->paint(p, 0, 0, size, size);
+			break;
+		}
 	}
+	return Images::RememberUserpic(
+		key,
+		size,
+		shape,
+		App::pixmapFromImageInPlace(std::move(image)));
 }
 
 void PeerData::loadUserpic() {
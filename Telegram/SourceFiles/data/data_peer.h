@@ -20,6 +20,10 @@ namespace Ui {
 class EmptyUserpic;
 } // namespace Ui
 
+namespace Images {
+enum class UserpicShape : uchar;
+} // namespace Images
+
 namespace Main {
 class Account;
 class Session;
@@ -367,6 +371,9 @@ private:
 	void fillNames();
 	std::unique_ptr<Ui::EmptyUserpic> createEmptyUserpic() const;
 	void refreshEmptyUserpic() const;
+	[[nodiscard]] const QPixmap &preparedUserpic(
+		int size,
+		Images::UserpicShape shape) const;
 	[[nodiscard]] virtual auto unavailableReasons() const
 		-> const std::vector<Data::UnavailableReason> &;
 
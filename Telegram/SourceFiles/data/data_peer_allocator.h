@@ -0,0 +1,86 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Data {
+
+// Keeps all objects of one peer type in large chunks of slots, so that
+// hundreds of thousands of users from big groups don't get a separate
+// heap block each and lie close to each other in memory.
+//
+// Peers are created and destroyed only on the main thread.
+template <typename Type>
+class PeerAllocator final {
+public:
+	[[nodiscard]] static void *Allocate(std::size_t size) {
+		Expects(size == sizeof(Type));
+
+		return Instance().allocate();
+	}
+	static void Deallocate(void *pointer) {
+		Instance().deallocate(pointer);
+	}
+
+	[[nodiscard]] static int Used() {
+		return Instance()._used;
+	}
+	[[nodiscard]] static int64 Reserved() {
+		return int64(Instance()._chunks.size()) * kChunkSize * sizeof(Slot);
+	}
+
+private:
+	static constexpr auto kChunkSize = 1024;
+
+	union Slot {
+		Slot *next;
+		alignas(Type) std::byte storage[sizeof(Type)];
+	};
+
+	[[nodiscard]] static PeerAllocator &Instance() {
+		static auto result = PeerAllocator();
+		return result;
+	}
+
+	void *allocate() {
+		if (!_free) {
+			addChunk();
+		}
+		const auto result = std::exchange(_free, _free->next);
+		++_used;
+		return result;
+	}
+
+	void deallocate(void *pointer) {
+		Expects(_used > 0);
+
+		const auto slot = static_cast<Slot*>(pointer);
+		slot->next = _free;
+		_free = slot;
+		if (!--_used) {
+			// All peers are destroyed when the session is closed.
+			_free = nullptr;
+			_chunks.clear();
+		}
+	}
+
+	void addChunk() {
+		auto chunk = std::make_unique<Slot[]>(kChunkSize);
+		for (auto i = 0; i != kChunkSize; ++i) {
+			chunk[i].next = (i + 1 != kChunkSize) ? &chunk[i + 1] : _free;
+		}
+		_free = &chunk[0];
+		_chunks.push_back(std::move(chunk));
+	}
+
+	std::vector<std::unique_ptr<Slot[]>> _chunks;
+	Slot *_free = nullptr;
+	int _used = 0;
+
+};
+
+} // namespace Data
@@ -90,6 +90,14 @@ bool PhotoData::waitingForAlbum() const {
 	return uploading() && uploadingData->waitingForAlbum;
 }
 
+void PhotoData::setFilledFromServer() {
+	_filledFromServer = true;
+}
+
+bool PhotoData::filledFromServer() const {
+	return _filledFromServer;
+}
+
 int32 PhotoData::loadOffset() const {
 	return _large->loadOffset();
 }
@@ -155,6 +163,10 @@ MTPInputPhoto PhotoData::mtpInput() const {
 		MTP_bytes(_fileReference));
 }
 
+int32 PhotoData::dcId() const {
+	return _dc;
+}
+
 QByteArray PhotoData::fileReference() const {
 	return _fileReference;
 }
@@ -41,6 +41,11 @@ public:
 	void setWaitingForAlbum();
 	[[nodiscard]] bool waitingForAlbum() const;
 
+	// Set when the fields were applied from an MTP photo,
+	// not from the local storage.
+	void setFilledFromServer();
+	[[nodiscard]] bool filledFromServer() const;
+
 	void unload();
 	[[nodiscard]] Image *getReplyPreview(Data::FileOrigin origin);
 
@@ -49,6 +54,7 @@ public:
 		uint64 access,
 		const QByteArray &fileReference);
 	[[nodiscard]] MTPInputPhoto mtpInput() const;
+	[[nodiscard]] int32 dcId() const;
 	[[nodiscard]] QByteArray fileReference() const;
 	void refreshFileReference(const QByteArray &value);
 
@@ -98,6 +104,7 @@ private:
 	uint64 _access = 0;
 	QByteArray _fileReference;
 	Data::ReplyPreview _replyPreview;
+	bool _filledFromServer = false;
 
 	not_null<Data::Session*> _owner;
 
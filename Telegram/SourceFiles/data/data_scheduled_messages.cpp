@@ -380,11 +380,16 @@ void ScheduledMessages::parse(
 			return;
 		}
 		auto received = base::flat_set<not_null<HistoryItem*>>();
+		auto changed = base::flat_set<not_null<HistoryItem*>>();
 		auto clear = base::flat_set<not_null<HistoryItem*>>();
 		auto &list = _data.emplace(history, List()).first->second;
 		for (const auto &message : messages) {
+			const auto same = unchanged(list, message);
 			if (const auto item = append(history, list, message)) {
 				received.emplace(item);
+				if (!same) {
+					changed.emplace(item);
+				}
 			}
 		}
 		for (const auto &owned : list.items) {
@@ -393,7 +398,7 @@ void ScheduledMessages::parse(
 				clear.emplace(item);
 			}
 		}
-		updated(history, received, clear);
+		updated(history, changed, clear);
 	});
 }
 
@@ -407,6 +412,9 @@ HistoryItem *ScheduledMessages::append(
 	const auto i = list.itemById.find(id);
 	if (i != end(list.itemById)) {
 		const auto existing = i->second;
+		if (unchanged(list, message)) {
+			return existing;
+		}
 		message.match([&](const MTPDmessage &data) {
 			existing->updateSentContent({
 				qs(data.vmessage()),
@@ -433,6 +441,24 @@ HistoryItem *ScheduledMessages::append(
 	return item;
 }
 
+bool ScheduledMessages::unchanged(
+		const List &list,
+		const MTPMessage &message) const {
+	return message.match([&](const MTPDmessage &data) {
+		const auto i = list.itemById.find(data.vid().v);
+		if (i == end(list.itemById)) {
+			return false;
+		}
+		const auto existing = i->second;
+		const auto edited = existing->Get<HistoryMessageEdited>();
+		return (existing->date() == data.vdate().v)
+			&& ((edited ? edited->date : TimeId(0))
+				== data.vedit_date().value_or_empty());
+	}, [&](const auto &data) {
+		return list.itemById.contains(data.vid().v);
+	});
+}
+
 void ScheduledMessages::clearNotSending(not_null<History*> history) {
 	const auto i = _data.find(history);
 	if (i == end(_data)) {
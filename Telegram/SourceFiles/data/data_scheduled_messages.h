@@ -71,6 +71,9 @@ private:
 		not_null<History*> history,
 		List &list,
 		const MTPMessage &message);
+	[[nodiscard]] bool unchanged(
+		const List &list,
+		const MTPMessage &message) const;
 	void clearNotSending(not_null<History*> history);
 	void updated(
 		not_null<History*> history,
@@ -21,6 +21,8 @@ namespace {
 
 constexpr auto kSharedMediaLimit = 100;
 constexpr auto kDefaultSearchTimeoutMs = crl::time(200);
+constexpr auto kCacheLifetime = 10 * 60 * crl::time(1000);
+constexpr auto kCacheEntriesLimit = 16;
 
 } // namespace
 
@@ -202,17 +204,47 @@ bool SearchController::hasInCache(const Query &query) const {
 }
 
 void SearchController::setQuery(const Query &query) {
-	if (query.query.isEmpty()) {
-		_cache.clear();
-		_current = _cache.end();
-	} else {
-		_current = _cache.find(query);
-	}
+	const auto now = crl::now();
+	removeStaleCacheEntries(now);
+	_current = _cache.find(query);
 	if (_current == _cache.end()) {
 		_current = _cache.emplace(
 			query,
 			std::make_unique<CacheEntry>(query)).first;
 	}
+	_current->second->lastUsed = now;
+}
+
+void SearchController::removeStaleCacheEntries(crl::time now) {
+	const auto current = (_current != _cache.end())
+		? _current->second.get()
+		: nullptr;
+	const auto stale = [&](const auto &pair) {
+		return (pair.second.get() != current)
+			&& (pair.second->lastUsed + kCacheLifetime <= now);
+	};
+	_cache.erase(ranges::remove_if(_cache, stale), end(_cache));
+	while (_cache.size() >= kCacheEntriesLimit) {
+		const auto oldest = ranges::min_element(
+			_cache,
+			ranges::less(),
+			[&](const auto &pair) {
+				return (pair.second.get() == current)
+					? std::numeric_limits<crl::time>::max()
+					: pair.second->lastUsed;
+			});
+		if (oldest->second.get() == current) {
+			break;
+		}
+		_cache.erase(oldest);
+	}
+	_current = _cache.end();
+	for (auto i = _cache.begin(); i != _cache.end(); ++i) {
+		if (i->second.get() == current) {
+			_current = i;
+			break;
+		}
+	}
 }
 
 rpl::producer<SparseIdsMergedSlice> SearchController::idsSlice(
@@ -354,7 +386,8 @@ void SearchController::restoreState(SavedState &&state) {
 void SearchController::requestMore(
 		const SparseIdsSliceBuilder::AroundData &key,
 		const Query &query,
-		Data *listData) {
+		Data *listData,
+		bool prefetch) {
 	if (listData->requests.contains(key)) {
 		return;
 	}
@@ -381,6 +414,9 @@ void SearchController::requestMore(
 				key.aroundId,
 				key.direction,
 				result);
+			if (!prefetch) {
+				prefetchNext(key, parsed, query, listData);
+			}
 			listData->list.addSlice(
 				std::move(parsed.messageIds),
 				parsed.noSkipRange,
@@ -395,6 +431,36 @@ void SearchController::requestMore(
 	});
 }
 
+void SearchController::prefetchNext(
+		const SparseIdsSliceBuilder::AroundData &key,
+		const SearchResult &parsed,
+		const Query &query,
+		Data *listData) {
+	// Request one more page in the direction the list is being scrolled,
+	// so that the next insufficientAround() finds it already loaded.
+	if (parsed.messageIds.empty()
+		|| !key.aroundId
+		|| parsed.fullCount <= int(parsed.messageIds.size())) {
+		return;
+	}
+	using Direction = ::Data::LoadDirection;
+	if (key.direction != Direction::After) {
+		if (parsed.noSkipRange.from > 0) {
+			requestMore(
+				{ parsed.noSkipRange.from, Direction::Before },
+				query,
+				listData,
+				true);
+		}
+	} else if (parsed.noSkipRange.till < ServerMaxMsgId) {
+		requestMore(
+			{ parsed.noSkipRange.till, Direction::After },
+			query,
+			listData,
+			true);
+	}
+}
+
 DelayedSearchController::DelayedSearchController(
 	not_null<Main::Session*> session)
 : _controller(session) {
@@ -106,6 +106,7 @@ private:
 
 		Data peerData;
 		std::optional<Data> migratedData;
+		crl::time lastUsed = 0;
 	};
 
 	struct CacheLess {
@@ -127,7 +128,14 @@ private:
 	void requestMore(
 		const SparseIdsSliceBuilder::AroundData &key,
 		const Query &query,
+		Data *listData,
+		bool prefetch = false);
+	void prefetchNext(
+		const SparseIdsSliceBuilder::AroundData &key,
+		const SearchResult &parsed,
+		const Query &query,
 		Data *listData);
+	void removeStaleCacheEntries(crl::time now);
 
 	const not_null<Main::Session*> _session;
 	Cache _cache;
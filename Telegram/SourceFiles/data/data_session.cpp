@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "core/mime_type.h" // Core::IsMimeSticker
 #include "core/crash_reports.h" // CrashReports::SetAnnotation
+#include "core/media_active_cache.h"
 #include "ui/image/image.h"
 #include "ui/image/image_source.h" // Images::LocalFileSource
 #include "export/export_controller.h"
@@ -26,6 +27,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/history_view_element.h"
 #include "inline_bots/inline_bot_layout_item.h"
 #include "storage/localstorage.h"
+#include "storage/storage_cache_metrics.h"
 #include "storage/storage_encrypted_file.h"
 #include "main/main_account.h"
 #include "media/player/media_player_instance.h" // instance()->play()
@@ -45,6 +47,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_game.h"
 #include "data/data_poll.h"
 #include "data/data_scheduled_messages.h"
+#include "data/data_peer_allocator.h"
 #include "data/data_cloud_themes.h"
 #include "data/data_streaming.h"
 #include "data/data_media_rotation.h"
@@ -56,11 +59,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "app.h"
 #include "styles/style_boxes.h" // st::backgroundSize
 
+#include <QtGui/QGuiApplication>
+
 namespace Data {
 namespace {
 
 constexpr auto kMaxNotifyCheckDelay = 24 * 3600 * crl::time(1000);
 constexpr auto kMaxWallpaperSize = 10 * 1024 * 1024;
+constexpr auto kUnreadCheckDelay = 3 * crl::time(1000);
+constexpr auto kReadLocalStickersDelay = crl::time(1000);
+constexpr auto kInactiveSendActionsFrameDelay = crl::time(250);
+constexpr auto kPollUpdatesThrottle = crl::time(1000);
 
 using ViewElement = HistoryView::Element;
 
@@ -187,9 +196,11 @@ Session::Session(not_null<Main::Session*> session)
 , _contactsList(Dialogs::SortMode::Name)
 , _contactsNoChatsList(Dialogs::SortMode::Name)
 , _selfDestructTimer([=] { checkSelfDestructItems(); })
+, _unreadCheckTimer([=] { checkUnreadStateConsistency(); })
 , _sendActionsAnimation([=](crl::time now) {
 	return sendActionsAnimationCallback(now);
 })
+, _pollsUpdatedTimer([=] { sendThrottledPollNotifications(); })
 , _unmuteByFinishedTimer([=] { unmuteByFinished(); })
 , _groups(this)
 , _scheduledMessages(std::make_unique<ScheduledMessages>(this))
@@ -220,8 +231,7 @@ void Session::clear() {
 	_histories->unloadAll();
 	_scheduledMessages = nullptr;
 	_dependentMessages.clear();
-	base::take(_messages);
-	base::take(_channelMessages);
+	_messages.clear();
 	_messageByRandomId.clear();
 	_sentMessagesData.clear();
 	cSetRecentInlineBots(RecentInlineBots());
@@ -696,6 +706,9 @@ not_null<PeerData*> Session::processChat(const MTPChat &data) {
 }
 
 UserData *Session::processUsers(const MTPVector<MTPUser> &data) {
+	++_peersBatchLevel;
+	const auto guard = gsl::finally([&] { --_peersBatchLevel; });
+
 	auto result = (UserData*)nullptr;
 	for (const auto &user : data.v) {
 		result = processUser(user);
@@ -704,6 +717,9 @@ UserData *Session::processUsers(const MTPVector<MTPUser> &data) {
 }
 
 PeerData *Session::processChats(const MTPVector<MTPChat> &data) {
+	++_peersBatchLevel;
+	const auto guard = gsl::finally([&] { --_peersBatchLevel; });
+
 	auto result = (PeerData*)nullptr;
 	for (const auto &chat : data.v) {
 		result = processChat(chat);
@@ -821,8 +837,17 @@ void Session::registerSendAction(
 }
 
 bool Session::sendActionsAnimationCallback(crl::time now) {
+	// While the app is in background we still expire the actions on time,
+	// but repaint the typing animations only a few times per second.
+	const auto inactive = (QGuiApplication::applicationState()
+		!= Qt::ApplicationActive);
+	const auto animate = !inactive
+		|| (now - _sendActionsLastFrame >= kInactiveSendActionsFrameDelay);
+	if (animate) {
+		_sendActionsLastFrame = now;
+	}
 	for (auto i = begin(_sendActions); i != end(_sendActions);) {
-		if (i->first->updateSendActionNeedsAnimating(now)) {
+		if (i->first->updateSendActionNeedsAnimating(now, false, animate)) {
 			++i;
 		} else {
 			i = _sendActions.erase(i);
@@ -1045,6 +1070,33 @@ Session::~Session() {
 
 	clear();
 	Images::ClearRemote();
+
+	LOG(("Cache Metrics: %1").arg(Storage::CacheMetricsDescription()));
+	LOG(("History Requests: %1 merged into already sent ones."
+		).arg(_histories->mergedMessagesRequests()));
+	LOG(("Updates Batches: %1 item repaint and resize requests merged."
+		).arg(_updatesBatchMerged));
+	LOG(("Media Fields: %1 unchanged photos and documents skipped."
+		).arg(_mediaApplySkipped));
+	LOG(("Memory: %1").arg(memoryDescription()));
+}
+
+QString Session::memoryDescription() const {
+	return qsl("%1 users in %2 bytes, %3 chats in %4 bytes, "
+		"%5 channels in %6 bytes.\n"
+		"%7 messages, %8 photos, %9 documents, %10 web pages.\n"
+		"Media: %11"
+		).arg(PeerAllocator<UserData>::Used()
+		).arg(PeerAllocator<UserData>::Reserved()
+		).arg(PeerAllocator<ChatData>::Used()
+		).arg(PeerAllocator<ChatData>::Reserved()
+		).arg(PeerAllocator<ChannelData>::Used()
+		).arg(PeerAllocator<ChannelData>::Reserved()
+		).arg(_messages.size()
+		).arg(_photos.size()
+		).arg(_documents.size()
+		).arg(_webpages.size()
+		).arg(Core::MediaMemoryDescription());
 }
 
 template <typename Method>
@@ -1148,14 +1200,11 @@ rpl::producer<not_null<HistoryItem*>> Session::unreadItemAdded() const {
 }
 
 void Session::changeMessageId(ChannelId channel, MsgId wasId, MsgId nowId) {
-	const auto list = messagesListForInsert(channel);
-	auto i = list->find(wasId);
-	Assert(i != list->end());
-	auto owned = std::move(i->second);
-	list->erase(i);
-	const auto [j, ok] = list->emplace(nowId, std::move(owned));
+	const auto item = _messages.take(FullMsgId(channel, wasId));
+	Assert(item != nullptr);
+	const auto previous = _messages.insert(FullMsgId(channel, nowId), item);
 
-	Ensures(ok);
+	Ensures(!previous);
 }
 
 void Session::notifyItemIdChange(IdChange event) {
@@ -1181,6 +1230,12 @@ rpl::producer<Session::IdChange> Session::itemIdChanged() const {
 }
 
 void Session::requestItemRepaint(not_null<const HistoryItem*> item) {
+	if (_updatesBatchLevel > 0) {
+		if (!_itemsRepaintDelayed.emplace(item).second) {
+			++_updatesBatchMerged;
+		}
+		return;
+	}
 	_itemRepaintRequest.fire_copy(item);
 	enumerateItemViews(item, [&](not_null<const ViewElement*> view) {
 		requestViewRepaint(view);
@@ -1200,6 +1255,12 @@ rpl::producer<not_null<const ViewElement*>> Session::viewRepaintRequest() const
 }
 
 void Session::requestItemResize(not_null<const HistoryItem*> item) {
+	if (_updatesBatchLevel > 0) {
+		if (!_itemsResizeDelayed.emplace(item).second) {
+			++_updatesBatchMerged;
+		}
+		return;
+	}
 	_itemResizeRequest.fire_copy(item);
 	enumerateItemViews(item, [&](not_null<ViewElement*> view) {
 		requestViewResize(view);
@@ -1296,11 +1357,34 @@ rpl::producer<not_null<History*>> Session::historyChanged() const {
 }
 
 void Session::sendHistoryChangeNotifications() {
+	if (_updatesBatchLevel > 0) {
+		return;
+	}
 	for (const auto history : base::take(_historiesChanged)) {
 		_historyChanged.fire_copy(history);
 	}
 }
 
+void Session::startUpdatesBatch() {
+	++_updatesBatchLevel;
+}
+
+void Session::finishUpdatesBatch() {
+	Expects(_updatesBatchLevel > 0);
+
+	if (--_updatesBatchLevel > 0) {
+		return;
+	}
+	for (const auto item : base::take(_itemsResizeDelayed)) {
+		requestItemResize(item);
+	}
+	for (const auto item : base::take(_itemsRepaintDelayed)) {
+		requestItemRepaint(item);
+	}
+	sendHistoryChangeNotifications();
+	Notify::peerUpdatedSendDelayed();
+}
+
 void Session::registerHeavyViewPart(not_null<ViewElement*> view) {
 	_heavyViewParts.emplace(view);
 }
@@ -1396,6 +1480,32 @@ rpl::producer<not_null<UserData*>> Session::megagroupParticipantAdded(
 	});
 }
 
+void Session::readLocalStickersDelayed() {
+	_localStickersReadPending = true;
+	base::call_delayed(kReadLocalStickersDelay, _session, [=] {
+		readLocalStickersIfNeeded();
+	});
+}
+
+void Session::readLocalStickersIfNeeded() const {
+	if (!_localStickersReadPending) {
+		return;
+	}
+	_localStickersReadPending = false;
+	Local::readInstalledStickers();
+	Local::readFeaturedStickers();
+	Local::readRecentStickers();
+	Local::readFavedStickers();
+	Local::readSavedGifs();
+
+	// We could be inside of an accessor call here, notify a bit later.
+	crl::on_main(_session, [=] {
+		auto &data = _session->data();
+		data.notifyStickersUpdated();
+		data.notifySavedGifsUpdated();
+	});
+}
+
 void Session::notifyStickersUpdated() {
 	_stickersUpdated.fire({});
 }
@@ -1617,6 +1727,7 @@ bool Session::checkEntitiesAndViewsUpdate(const MTPDmessage &data) {
 }
 
 void Session::addSavedGif(not_null<DocumentData*> document) {
+	readLocalStickersIfNeeded();
 	const auto index = _savedGifs.indexOf(document);
 	if (!index) {
 		return;
@@ -1709,49 +1820,28 @@ void Session::processMessages(
 	processMessages(data.v, type);
 }
 
-const Session::Messages *Session::messagesList(ChannelId channelId) const {
-	if (channelId == NoChannel) {
-		return &_messages;
-	}
-	const auto i = _channelMessages.find(channelId);
-	return (i != end(_channelMessages)) ? &i->second : nullptr;
-}
-
-auto Session::messagesListForInsert(ChannelId channelId)
--> not_null<Messages*> {
-	return (channelId == NoChannel)
-		? &_messages
-		: &_channelMessages[channelId];
-}
-
 void Session::registerMessage(not_null<HistoryItem*> item) {
-	const auto list = messagesListForInsert(item->channelId());
-	const auto itemId = item->id;
-	const auto i = list->find(itemId);
-	if (i != list->end()) {
+	const auto id = FullMsgId(item->channelId(), item->id);
+	if (const auto existing = _messages.find(id)) {
 		LOG(("App Error: Trying to re-registerMessage()."));
-		i->second->destroy();
+		existing->destroy();
 	}
-	list->emplace(itemId, item);
+	_messages.insert(id, item);
+	_messagesSearchIndex.add(item);
 }
 
 void Session::processMessagesDeleted(
 		ChannelId channelId,
 		const QVector<MTPint> &data) {
-	const auto list = messagesList(channelId);
 	const auto affected = (channelId != NoChannel)
 		? historyLoaded(peerFromChannel(channelId))
 		: nullptr;
-	if (!list && !affected) {
-		return;
-	}
 
 	auto historiesToCheck = base::flat_set<not_null<History*>>();
 	for (const auto messageId : data) {
-		const auto i = list ? list->find(messageId.v) : Messages::iterator();
-		if (list && i != list->end()) {
-			const auto history = i->second->history();
-			i->second->destroy();
+		if (const auto item = _messages.find(channelId, messageId.v)) {
+			const auto history = item->history();
+			item->destroy();
 			if (!history->chatListMessageKnown()) {
 				historiesToCheck.emplace(history);
 			}
@@ -1780,9 +1870,12 @@ void Session::removeDependencyMessage(not_null<HistoryItem*> item) {
 void Session::unregisterMessage(not_null<HistoryItem*> item) {
 	const auto peerId = item->history()->peer->id;
 	_itemRemoved.fire_copy(item);
+	_itemsRepaintDelayed.remove(item);
+	_itemsResizeDelayed.remove(item);
 	groups().unregisterMessage(item);
 	removeDependencyMessage(item);
-	messagesListForInsert(peerToChannel(peerId))->erase(item->id);
+	_messagesSearchIndex.remove(item);
+	_messages.take(FullMsgId(peerToChannel(peerId), item->id));
 }
 
 MsgId Session::nextLocalMessageId() {
@@ -1792,17 +1885,7 @@ MsgId Session::nextLocalMessageId() {
 }
 
 HistoryItem *Session::message(ChannelId channelId, MsgId itemId) const {
-	if (!itemId) {
-		return nullptr;
-	}
-
-	const auto data = messagesList(channelId);
-	if (!data) {
-		return nullptr;
-	}
-
-	const auto i = data->find(itemId);
-	return (i != data->end()) ? i->second.get() : nullptr;
+	return itemId ? _messages.find(channelId, itemId) : nullptr;
 }
 
 HistoryItem *Session::message(
@@ -2041,6 +2124,9 @@ void Session::unreadStateChanged(
 		_chatsList.unreadStateChanged(wasState, nowState);
 	}
 	Notify::unreadCounterUpdated();
+	if (Logs::DebugEnabled()) {
+		_unreadCheckTimer.callOnce(kUnreadCheckDelay);
+	}
 }
 
 void Session::unreadEntryChanged(const Dialogs::Key &key, bool added) {
@@ -2055,6 +2141,40 @@ void Session::unreadEntryChanged(const Dialogs::Key &key, bool added) {
 		}
 	}
 	Notify::unreadCounterUpdated();
+	if (Logs::DebugEnabled()) {
+		_unreadCheckTimer.callOnce(kUnreadCheckDelay);
+	}
+}
+
+void Session::checkUnreadStateConsistency() const {
+	const auto serialize = [](const Dialogs::UnreadState &state) {
+		return qsl("messages %1 (%2 muted), chats %3 (%4 muted), "
+			"marks %5 (%6 muted)"
+			).arg(state.messages
+			).arg(state.messagesMuted
+			).arg(state.chats
+			).arg(state.chatsMuted
+			).arg(state.marks
+			).arg(state.marksMuted);
+	};
+	const auto check = [&](
+			not_null<const Dialogs::MainList*> list,
+			const QString &name) {
+		const auto counted = serialize(list->unreadState());
+		const auto recounted = serialize(list->countUnreadState());
+		if (counted != recounted) {
+			LOG(("Unread Error: %1 counters are %2, but entries sum to %3."
+				).arg(name
+				).arg(counted
+				).arg(recounted));
+		}
+	};
+	check(&_chatsList, qsl("Chats list"));
+	for (const auto &[id, folder] : _folders) {
+		if (folder->chatsList()->loaded()) {
+			check(folder->chatsList(), qsl("Folder %1").arg(id));
+		}
+	}
 }
 
 void Session::selfDestructIn(not_null<HistoryItem*> item, crl::time delay) {
@@ -2259,6 +2379,15 @@ void Session::photoApplyFields(
 void Session::photoApplyFields(
 		not_null<PhotoData*> photo,
 		const MTPDphoto &data) {
+	// Popular photos come in many responses, the same server data means
+	// the same images, so we don't look them up again.
+	if (photo->filledFromServer()
+		&& photo->date == data.vdate().v
+		&& photo->dcId() == data.vdc_id().v
+		&& photo->fileReference() == data.vfile_reference().v) {
+		++_mediaApplySkipped;
+		return;
+	}
 	const auto &sizes = data.vsizes().v;
 	const auto find = [&](const QByteArray &levels) {
 		const auto kInvalidIndex = int(levels.size());
@@ -2297,6 +2426,7 @@ void Session::photoApplyFields(
 			thumbnailSmall,
 			thumbnail,
 			large);
+		photo->setFilledFromServer();
 	}
 }
 
@@ -2515,6 +2645,16 @@ void Session::documentApplyFields(
 void Session::documentApplyFields(
 		not_null<DocumentData*> document,
 		const MTPDdocument &data) {
+	// Same as for photos, stickers and gifs come in many responses.
+	// Documents read from the local storage get the server data once.
+	if (document->filledFromServer()
+		&& document->date == data.vdate().v
+		&& document->dcId() == data.vdc_id().v
+		&& document->size == data.vsize().v
+		&& document->fileReference() == data.vfile_reference().v) {
+		++_mediaApplySkipped;
+		return;
+	}
 	const auto thumbnailInline = FindDocumentInlineThumbnail(data);
 	const auto thumbnailSize = FindDocumentThumbnail(data);
 	const auto thumbnail = Images::Create(data, thumbnailSize);
@@ -2530,6 +2670,7 @@ void Session::documentApplyFields(
 		data.vdc_id().v,
 		data.vsize().v,
 		thumbnail->location());
+	document->setFilledFromServer();
 }
 
 void Session::documentApplyFields(
@@ -2902,7 +3043,7 @@ void Session::applyUpdate(const MTPDupdateMessagePoll &update) {
 			: i->second.get();
 	}();
 	if (updated && updated->applyResults(update.vresults())) {
-		notifyPollUpdateDelayed(updated);
+		notifyPollUpdateThrottled(updated);
 	}
 }
 
@@ -3243,6 +3384,20 @@ void Session::notifyPollUpdateDelayed(not_null<PollData*> poll) {
 	}
 }
 
+void Session::notifyPollUpdateThrottled(not_null<PollData*> poll) {
+	// Votes in large polls come constantly, relayout only once in a while.
+	_pollsUpdatedThrottled.emplace(poll);
+	if (!_pollsUpdatedTimer.isActive()) {
+		_pollsUpdatedTimer.callOnce(kPollUpdatesThrottle);
+	}
+}
+
+void Session::sendThrottledPollNotifications() {
+	for (const auto poll : base::take(_pollsUpdatedThrottled)) {
+		notifyPollUpdateDelayed(poll);
+	}
+}
+
 void Session::sendWebPageGamePollNotifications() {
 	for (const auto page : base::take(_webpagesUpdated)) {
 		const auto i = _webpageViews.find(page);
@@ -3260,6 +3415,7 @@ void Session::sendWebPageGamePollNotifications() {
 		}
 	}
 	for (const auto poll : base::take(_pollsUpdated)) {
+		_pollsUpdatedThrottled.remove(poll);
 		if (const auto i = _pollViews.find(poll); i != _pollViews.end()) {
 			for (const auto view : i->second) {
 				requestViewResize(view);
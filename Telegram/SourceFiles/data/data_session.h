@@ -13,8 +13,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "dialogs/dialogs_indexed_list.h"
 #include "dialogs/dialogs_main_list.h"
 #include "data/data_groups.h"
+#include "data/data_messages_index.h"
+#include "data/data_messages_search_index.h"
 #include "data/data_notify_settings.h"
 #include "history/history_location_manager.h"
+#include "core/timer_wheel.h"
 #include "base/timer.h"
 #include "base/flags.h"
 #include "ui/effects/animations.h"
@@ -79,6 +82,9 @@ public:
 		return *_session;
 	}
 
+	[[nodiscard]] MessagesSearchIndex &messagesSearchIndex() {
+		return _messagesSearchIndex;
+	}
 	[[nodiscard]] Groups &groups() {
 		return _groups;
 	}
@@ -106,6 +112,10 @@ public:
 
 	void clear();
 
+	// Counts of loaded entities and the memory of the shared caches,
+	// for the logs on exit and the "memorystats" debug code.
+	[[nodiscard]] QString memoryDescription() const;
+
 	void startExport(PeerData *peer = nullptr);
 	void startExport(const MTPInputPeer &singlePeer);
 	void suggestStartExport(TimeId availableAt);
@@ -231,6 +241,17 @@ public:
 	[[nodiscard]] rpl::producer<not_null<History*>> historyChanged() const;
 	void sendHistoryChangeNotifications();
 
+	// While a batch of updates is applied history change notifications
+	// and item repaints are collected and sent once when it is finished.
+	void startUpdatesBatch();
+	void finishUpdatesBatch();
+
+	// While a vector of users or chats is processed their name changes
+	// go to the delayed peer updates, so the names are indexed once.
+	[[nodiscard]] bool peerNamesBatched() const {
+		return (_peersBatchLevel > 0);
+	}
+
 	void registerHeavyViewPart(not_null<ViewElement*> view);
 	void unregisterHeavyViewPart(not_null<ViewElement*> view);
 	void unloadHeavyViewParts(
@@ -307,22 +328,32 @@ public:
 	[[nodiscard]] rpl::producer<int> featuredStickerSetsUnreadCountValue() const {
 		return _featuredStickerSetsUnreadCount.value();
 	}
+	// Local stickers and saved gifs are read some time after the main
+	// widget has started, or earlier if anything asks for them.
+	void readLocalStickersDelayed();
+
 	const Stickers::Sets &stickerSets() const {
+		readLocalStickersIfNeeded();
 		return _stickerSets;
 	}
 	Stickers::Sets &stickerSetsRef() {
+		readLocalStickersIfNeeded();
 		return _stickerSets;
 	}
 	const Stickers::Order &stickerSetsOrder() const {
+		readLocalStickersIfNeeded();
 		return _stickerSetsOrder;
 	}
 	Stickers::Order &stickerSetsOrderRef() {
+		readLocalStickersIfNeeded();
 		return _stickerSetsOrder;
 	}
 	const Stickers::Order &featuredStickerSetsOrder() const {
+		readLocalStickersIfNeeded();
 		return _featuredStickerSetsOrder;
 	}
 	Stickers::Order &featuredStickerSetsOrderRef() {
+		readLocalStickersIfNeeded();
 		return _featuredStickerSetsOrder;
 	}
 	const Stickers::Order &archivedStickerSetsOrder() const {
@@ -332,9 +363,11 @@ public:
 		return _archivedStickerSetsOrder;
 	}
 	const Stickers::SavedGifs &savedGifs() const {
+		readLocalStickersIfNeeded();
 		return _savedGifs;
 	}
 	Stickers::SavedGifs &savedGifsRef() {
+		readLocalStickersIfNeeded();
 		return _savedGifs;
 	}
 
@@ -607,6 +640,7 @@ public:
 	void notifyWebPageUpdateDelayed(not_null<WebPageData*> page);
 	void notifyGameUpdateDelayed(not_null<GameData*> game);
 	void notifyPollUpdateDelayed(not_null<PollData*> poll);
+	void notifyPollUpdateThrottled(not_null<PollData*> poll);
 	bool hasPendingWebPageGamePollNotification() const;
 	void sendWebPageGamePollNotifications();
 
@@ -684,8 +718,6 @@ public:
 	void clearLocalStorage();
 
 private:
-	using Messages = std::unordered_map<MsgId, not_null<HistoryItem*>>;
-
 	void suggestStartExport();
 
 	void setupContactViewsViewer();
@@ -694,6 +726,8 @@ private:
 	void setupUserIsContactViewer();
 
 	void checkSelfDestructItems();
+	void checkUnreadStateConsistency() const;
+	void sendThrottledPollNotifications();
 
 	int computeUnreadBadge(const Dialogs::UnreadState &state) const;
 	bool computeUnreadBadgeMuted(const Dialogs::UnreadState &state) const;
@@ -703,8 +737,6 @@ private:
 		Data::Folder *requestFolder,
 		const MTPDdialogFolder &data);
 
-	const Messages *messagesList(ChannelId channelId) const;
-	not_null<Messages*> messagesListForInsert(ChannelId channelId);
 	not_null<HistoryItem*> registerMessage(
 		std::unique_ptr<HistoryItem> item);
 	void changeMessageId(ChannelId channel, MsgId wasId, MsgId nowId);
@@ -787,6 +819,8 @@ private:
 		not_null<Folder*> folder,
 		const MTPDfolder &data);
 
+	void readLocalStickersIfNeeded() const;
+
 	bool stickersUpdateNeeded(crl::time lastUpdate, crl::time now) const {
 		constexpr auto kStickersUpdateTimeout = crl::time(3600'000);
 		return (lastUpdate == 0)
@@ -849,6 +883,11 @@ private:
 	rpl::event_stream<not_null<const History*>> _historyCleared;
 	base::flat_set<not_null<History*>> _historiesChanged;
 	rpl::event_stream<not_null<History*>> _historyChanged;
+	base::flat_set<not_null<const HistoryItem*>> _itemsRepaintDelayed;
+	base::flat_set<not_null<const HistoryItem*>> _itemsResizeDelayed;
+	int _updatesBatchLevel = 0;
+	int _updatesBatchMerged = 0;
+	int _peersBatchLevel = 0;
 	rpl::event_stream<MegagroupParticipant> _megagroupParticipantRemoved;
 	rpl::event_stream<MegagroupParticipant> _megagroupParticipantAdded;
 	rpl::event_stream<DialogsRowReplacement> _dialogsRowReplacements;
@@ -868,14 +907,15 @@ private:
 	Stickers::Order _featuredStickerSetsOrder;
 	Stickers::Order _archivedStickerSetsOrder;
 	Stickers::SavedGifs _savedGifs;
+	mutable bool _localStickersReadPending = false;
 
 	Dialogs::MainList _chatsList;
 	Dialogs::IndexedList _contactsList;
 	Dialogs::IndexedList _contactsNoChatsList;
 
 	MsgId _localMessageIdCounter = StartClientMsgId;
-	Messages _messages;
-	std::map<ChannelId, Messages> _channelMessages;
+	MessagesIndex _messages;
+	MessagesSearchIndex _messagesSearchIndex;
 	std::map<
 		not_null<HistoryItem*>,
 		base::flat_set<not_null<HistoryItem*>>> _dependentMessages;
@@ -885,10 +925,12 @@ private:
 
 	base::Timer _selfDestructTimer;
 	std::vector<FullMsgId> _selfDestructItems;
+	base::Timer _unreadCheckTimer;
 
 	// When typing in this history started.
 	base::flat_map<not_null<History*>, crl::time> _sendActions;
 	Ui::Animations::Basic _sendActionsAnimation;
+	crl::time _sendActionsLastFrame = 0;
 
 	std::unordered_map<
 		PhotoId,
@@ -899,6 +941,7 @@ private:
 	std::unordered_map<
 		DocumentId,
 		std::unique_ptr<DocumentData>> _documents;
+	int _mediaApplySkipped = 0;
 	std::unordered_map<
 		not_null<const DocumentData*>,
 		base::flat_set<not_null<HistoryItem*>>> _documentItems;
@@ -937,6 +980,8 @@ private:
 	base::flat_set<not_null<WebPageData*>> _webpagesUpdated;
 	base::flat_set<not_null<GameData*>> _gamesUpdated;
 	base::flat_set<not_null<PollData*>> _pollsUpdated;
+	base::flat_set<not_null<PollData*>> _pollsUpdatedThrottled;
+	base::Timer _pollsUpdatedTimer;
 
 	base::flat_map<FolderId, std::unique_ptr<Folder>> _folders;
 	//rpl::variable<FeedId> _defaultFeedId = FeedId(); // #feed
@@ -956,7 +1001,7 @@ private:
 	rpl::event_stream<> _defaultChatNotifyUpdates;
 	rpl::event_stream<> _defaultBroadcastNotifyUpdates;
 	std::unordered_set<not_null<const PeerData*>> _mutedPeers;
-	base::Timer _unmuteByFinishedTimer;
+	Core::WheelTimer _unmuteByFinishedTimer;
 
 	std::unordered_map<PeerId, std::unique_ptr<PeerData>> _peers;
 
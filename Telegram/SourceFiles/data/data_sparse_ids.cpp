@@ -16,17 +16,23 @@ SparseIdsSlice::SparseIdsSlice(
 	std::optional<int> fullCount,
 	std::optional<int> skippedBefore,
 	std::optional<int> skippedAfter)
-: _ids(ids)
+: _ids(std::make_shared<const base::flat_set<MsgId>>(ids))
 , _range(range)
 , _fullCount(fullCount)
 , _skippedBefore(skippedBefore)
 , _skippedAfter(skippedAfter) {
 }
 
+const base::flat_set<MsgId> &SparseIdsSlice::ids() const {
+	static const auto kEmpty = base::flat_set<MsgId>();
+	return _ids ? *_ids : kEmpty;
+}
+
 std::optional<int> SparseIdsSlice::indexOf(MsgId msgId) const {
-	auto it = _ids.find(msgId);
-	if (it != _ids.end()) {
-		return (it - _ids.begin());
+	const auto &ids = this->ids();
+	auto it = ids.find(msgId);
+	if (it != ids.end()) {
+		return (it - ids.begin());
 	}
 	return std::nullopt;
 }
@@ -34,7 +40,7 @@ std::optional<int> SparseIdsSlice::indexOf(MsgId msgId) const {
 MsgId SparseIdsSlice::operator[](int index) const {
 	Expects(index >= 0 && index < size());
 
-	return *(_ids.begin() + index);
+	return *(ids().begin() + index);
 }
 
 std::optional<int> SparseIdsSlice::distance(
@@ -49,12 +55,13 @@ std::optional<int> SparseIdsSlice::distance(
 }
 
 std::optional<MsgId> SparseIdsSlice::nearest(MsgId msgId) const {
-	if (auto it = ranges::lower_bound(_ids, msgId); it != _ids.end()) {
+	const auto &ids = this->ids();
+	if (auto it = ranges::lower_bound(ids, msgId); it != ids.end()) {
 		return *it;
-	} else if (_ids.empty()) {
+	} else if (ids.empty()) {
 		return std::nullopt;
 	}
-	return _ids.back();
+	return ids.back();
 }
 
 SparseIdsMergedSlice::SparseIdsMergedSlice(Key key)
@@ -30,13 +30,17 @@ public:
 	std::optional<int> skippedBefore() const { return _skippedBefore; }
 	std::optional<int> skippedAfter() const { return _skippedAfter; }
 	std::optional<int> indexOf(MsgId msgId) const;
-	int size() const { return _ids.size(); }
+	int size() const { return _ids ? _ids->size() : 0; }
 	MsgId operator[](int index) const;
 	std::optional<int> distance(MsgId a, MsgId b) const;
 	std::optional<MsgId> nearest(MsgId msgId) const;
 
 private:
-	base::flat_set<MsgId> _ids;
+	[[nodiscard]] const base::flat_set<MsgId> &ids() const;
+
+	// Slices are copied a lot through rpl::combine and merged slices,
+	// so the ids are shared between the copies and never modified.
+	std::shared_ptr<const base::flat_set<MsgId>> _ids;
 	MsgRange _range;
 	std::optional<int> _fullCount;
 	std::optional<int> _skippedBefore;
@@ -37,6 +37,8 @@ public:
 		not_null<DocumentData*> document,
 		FileOrigin origin,
 		bool forceRemoteLoader = false);
+	// All views showing the same document share one player and decoder,
+	// frames for equal requests are prepared once in VideoTrack::frame().
 	[[nodiscard]] std::shared_ptr<Document> sharedDocument(
 		not_null<DocumentData*> document,
 		FileOrigin origin);
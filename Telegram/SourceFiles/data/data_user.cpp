@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "observer_peer.h"
 #include "storage/localstorage.h"
 #include "data/data_session.h"
+#include "data/data_peer_allocator.h"
 #include "ui/text_options.h"
 #include "apiwrap.h"
 #include "lang/lang_keys.h"
@@ -50,6 +51,14 @@ const Ui::Text::String &BotCommand::descriptionText() const {
 	return _descriptionText;
 }
 
+void *UserData::operator new(std::size_t size) {
+	return Data::PeerAllocator<UserData>::Allocate(size);
+}
+
+void UserData::operator delete(void *pointer) {
+	Data::PeerAllocator<UserData>::Deallocate(pointer);
+}
+
 UserData::UserData(not_null<Data::Session*> owner, PeerId id)
 : PeerData(owner, id) {
 }
@@ -83,13 +92,17 @@ void UserData::setPhoto(const MTPUserProfilePhoto &photo) {
 
 auto UserData::unavailableReasons() const
 -> const std::vector<Data::UnavailableReason> & {
-	return _unavailableReasons;
+	static const auto kEmpty = std::vector<Data::UnavailableReason>();
+	return _unavailableReasons ? *_unavailableReasons : kEmpty;
 }
 
 void UserData::setUnavailableReasons(
 		std::vector<Data::UnavailableReason> &&reasons) {
-	if (_unavailableReasons != reasons) {
-		_unavailableReasons = std::move(reasons);
+	if (unavailableReasons() != reasons) {
+		_unavailableReasons = reasons.empty()
+			? nullptr
+			: std::make_unique<std::vector<Data::UnavailableReason>>(
+				std::move(reasons));
 		Notify::peerUpdatedDelayed(
 			this,
 			Notify::PeerUpdate::Flag::UnavailableReasonChanged);
@@ -64,6 +64,9 @@ public:
 		kEssentialFullFlags.value()>;
 
 	UserData(not_null<Data::Session*> owner, PeerId id);
+
+	static void *operator new(std::size_t size);
+	static void operator delete(void *pointer);
 	void setPhoto(const MTPUserProfilePhoto &photo);
 
 	void setName(
@@ -222,7 +225,9 @@ private:
 	Flags _flags;
 	FullFlags _fullFlags;
 
-	std::vector<Data::UnavailableReason> _unavailableReasons;
+	// Allocated only for the few restricted peers.
+	std::unique_ptr<
+		std::vector<Data::UnavailableReason>> _unavailableReasons;
 	QString _phone;
 	ContactStatus _contactStatus = ContactStatus::Unknown;
 	BlockStatus _blockStatus = BlockStatus::Unknown;
@@ -0,0 +1,157 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "dialogs/dialogs_benchmark.h"
+
+#include "dialogs/dialogs_indexed_list.h"
+#include "dialogs/dialogs_main_list.h"
+#include "dialogs/dialogs_layout.h"
+#include "data/data_session.h"
+#include "data/data_folder.h"
+#include "history/history.h"
+#include "main/main_session.h"
+#include "styles/style_dialogs.h"
+#include "styles/style_window.h"
+
+#include <chrono>
+
+namespace Dialogs {
+namespace {
+
+constexpr auto kRepeats = 5;
+constexpr auto kQueriesLimit = 100;
+constexpr auto kPaintRowsLimit = 100;
+
+template <typename Callback>
+[[nodiscard]] int64 BestMicroseconds(Callback &&callback) {
+	using Clock = std::chrono::steady_clock;
+
+	auto result = std::numeric_limits<int64>::max();
+	for (auto i = 0; i != kRepeats; ++i) {
+		const auto started = Clock::now();
+		callback();
+		const auto elapsed = std::chrono::duration_cast<
+			std::chrono::microseconds>(Clock::now() - started).count();
+		result = std::min(result, int64(elapsed));
+	}
+	return result;
+}
+
+[[nodiscard]] std::vector<Key> CollectKeys(
+		not_null<Main::Session*> session) {
+	auto result = std::vector<Key>();
+	const auto collect = [&](not_null<MainList*> list) {
+		for (const auto row : list->indexed()->all()) {
+			result.push_back(row->key());
+		}
+	};
+	collect(session->data().chatsList());
+	if (const auto folder = session->data().folderLoaded(Data::Folder::kId)) {
+		collect(folder->chatsList());
+	}
+	return result;
+}
+
+[[nodiscard]] std::vector<QStringList> CollectQueries(
+		const std::vector<Key> &keys) {
+	auto result = std::vector<QStringList>();
+	for (const auto key : keys) {
+		if (result.size() == kQueriesLimit) {
+			break;
+		}
+		const auto &words = key.entry()->chatListNameWords();
+		if (!words.empty()) {
+			result.push_back({ words.begin()->mid(0, 2) });
+		}
+	}
+	return result;
+}
+
+} // namespace
+
+QString RunListBenchmark(not_null<Main::Session*> session) {
+	const auto keys = CollectKeys(session);
+	const auto queries = CollectQueries(keys);
+	auto lines = QStringList();
+	const auto add = [&](const QString &name, int64 microseconds) {
+		lines.push_back(qsl("%1: %2 us").arg(name).arg(microseconds));
+	};
+	lines.push_back(qsl("Entries: %1, queries: %2, best of %3 runs."
+		).arg(keys.size()
+		).arg(queries.size()
+		).arg(kRepeats));
+
+	add(qsl("addToEnd"), BestMicroseconds([&] {
+		auto list = IndexedList(SortMode::Date);
+		for (const auto key : keys) {
+			list.addToEnd(key);
+		}
+	}));
+
+	auto byDate = IndexedList(SortMode::Date);
+	auto links = std::vector<RowsByLetter>();
+	links.reserve(keys.size());
+	for (const auto key : keys) {
+		links.push_back(byDate.addToEnd(key));
+	}
+	add(qsl("adjustByDate"), BestMicroseconds([&] {
+		for (const auto &rows : links) {
+			byDate.adjustByDate(rows);
+		}
+	}));
+
+	auto byName = IndexedList(SortMode::Name);
+	add(qsl("addByName"), BestMicroseconds([&] {
+		for (const auto key : keys) {
+			byName.del(key);
+			byName.addByName(key);
+		}
+	}));
+	add(qsl("peerNameChanged"), BestMicroseconds([&] {
+		for (const auto key : keys) {
+			if (const auto history = key.history()) {
+				byName.peerNameChanged(
+					history->peer,
+					history->chatListFirstLetters());
+			}
+		}
+	}));
+
+	auto found = 0;
+	add(qsl("filtered"), BestMicroseconds([&] {
+		found = 0;
+		for (const auto &words : queries) {
+			found += byDate.filtered(words).size();
+		}
+	}));
+	lines.push_back(qsl("filtered rows: %1").arg(found));
+
+	const auto width = st::columnMinimalWidthLeft * 3 / 2;
+	auto image = QImage(
+		QSize(width, st::dialogsRowHeight) * cIntRetinaFactor(),
+		QImage::Format_ARGB32_Premultiplied);
+	image.setDevicePixelRatio(cRetinaFactor());
+	auto painted = 0;
+	add(qsl("RowPainter::paint"), BestMicroseconds([&] {
+		Painter p(&image);
+		const auto now = crl::now();
+		painted = 0;
+		for (const auto row : byDate.all()) {
+			if (painted++ == kPaintRowsLimit) {
+				break;
+			}
+			Layout::RowPainter::paint(p, row, width, false, false, now);
+		}
+	}));
+	lines.push_back(qsl("painted rows: %1").arg(std::min(
+		painted,
+		kPaintRowsLimit)));
+
+	return lines.join('\n');
+}
+
+} // namespace Dialogs
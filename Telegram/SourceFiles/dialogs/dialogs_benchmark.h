@@ -0,0 +1,20 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace Dialogs {
+
+// Times the chats list operations on copies of the current chats list,
+// returns the best of a few runs for each of them, one per line.
+[[nodiscard]] QString RunListBenchmark(not_null<Main::Session*> session);
+
+} // namespace Dialogs
@@ -12,6 +12,31 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history.h"
 
 namespace Dialogs {
+namespace {
+
+// First string that is greater than every string starting with prefix.
+[[nodiscard]] QString PrefixEnd(const QString &prefix) {
+	auto result = prefix;
+	while (!result.isEmpty()) {
+		const auto last = result.size() - 1;
+		const auto code = result[last].unicode();
+		if (code != 0xFFFF) {
+			result[last] = QChar(ushort(code + 1));
+			return result;
+		}
+		result.chop(1);
+	}
+	return result;
+}
+
+[[nodiscard]] bool HasWordWithPrefix(
+		const base::flat_set<QString> &words,
+		const QString &prefix) {
+	const auto i = words.lower_bound(prefix);
+	return (i != words.end()) && i->startsWith(prefix);
+}
+
+} // namespace
 
 IndexedList::IndexedList(SortMode sortMode)
 : _sortMode(sortMode)
@@ -23,6 +48,7 @@ RowsByLetter IndexedList::addToEnd(Key key) {
 	RowsByLetter result;
 	if (!_list.contains(key)) {
 		result.emplace(0, _list.addToEnd(key));
+		indexWords(key);
 		for (const auto ch : key.entry()->chatListFirstLetters()) {
 			auto j = _index.find(ch);
 			if (j == _index.cend()) {
@@ -40,6 +66,7 @@ Row *IndexedList::addByName(Key key) {
 	}
 
 	const auto result = _list.addByName(key);
+	indexWords(key);
 	for (const auto ch : key.entry()->chatListFirstLetters()) {
 		auto j = _index.find(ch);
 		if (j == _index.cend()) {
@@ -119,6 +146,9 @@ void IndexedList::adjustByName(
 	const auto mainRow = _list.adjustByName(key);
 	if (!mainRow) return;
 
+	unindexWords(key);
+	indexWords(key);
+
 	auto toRemove = oldLetters;
 	auto toAdd = base::flat_set<QChar>();
 	for (const auto ch : key.entry()->chatListFirstLetters()) {
@@ -156,6 +186,9 @@ void IndexedList::adjustNames(
 	auto mainRow = _list.getRow(key);
 	if (!mainRow) return;
 
+	unindexWords(key);
+	indexWords(key);
+
 	auto toRemove = oldLetters;
 	auto toAdd = base::flat_set<QChar>();
 	for (const auto ch : key.entry()->chatListFirstLetters()) {
@@ -188,6 +221,7 @@ void IndexedList::adjustNames(
 
 void IndexedList::del(Key key, Row *replacedBy) {
 	if (_list.del(key, replacedBy)) {
+		unindexWords(key);
 		for (const auto ch : key.entry()->chatListFirstLetters()) {
 			if (auto it = _index.find(ch); it != _index.cend()) {
 				it->second.del(key, replacedBy);
@@ -198,55 +232,105 @@ void IndexedList::del(Key key, Row *replacedBy) {
 
 void IndexedList::clear() {
 	_index.clear();
+	_words.clear();
+	_wordsByKey.clear();
+}
+
+void IndexedList::indexWords(Key key) {
+	const auto &words = key.entry()->chatListNameWords();
+	for (const auto &word : words) {
+		_words[word].emplace(key);
+	}
+	_wordsByKey.emplace(key, words);
+}
+
+void IndexedList::unindexWords(Key key) {
+	const auto i = _wordsByKey.find(key);
+	if (i == end(_wordsByKey)) {
+		return;
+	}
+	for (const auto &word : i->second) {
+		const auto j = _words.find(word);
+		if (j != end(_words)) {
+			j->second.erase(key);
+			if (j->second.empty()) {
+				_words.erase(j);
+			}
+		}
+	}
+	_wordsByKey.erase(i);
 }
 
 std::vector<not_null<Row*>> IndexedList::filtered(
 		const QStringList &words) const {
-	const auto minimal = [&]() -> const Dialogs::List* {
-		if (empty()) {
-			return nullptr;
+	using Iterator = decltype(_words)::const_iterator;
+	struct Range {
+		Iterator from;
+		Iterator till;
+		int count = 0;
+	};
+	auto result = std::vector<not_null<Row*>>();
+	if (empty()) {
+		return result;
+	}
+
+	// Take the word matching the fewest indexed words, counting each
+	// range only while it is still smaller than the best one found.
+	auto best = std::optional<Range>();
+	auto bestWord = QString();
+	for (const auto &word : words) {
+		if (word.isEmpty()) {
+			continue;
 		}
-		auto result = (const Dialogs::List*)nullptr;
-		for (const auto &word : words) {
-			if (word.isEmpty()) {
-				continue;
-			}
-			const auto found = filtered(word[0]);
-			if (!found || found->empty()) {
-				return nullptr;
-			} else if (!result || result->size() > found->size()) {
-				result = found;
-			}
+		const auto from = _words.lower_bound(word);
+		const auto till = _words.lower_bound(PrefixEnd(word));
+		if (from == till) {
+			return result;
+		}
+		const auto limit = best
+			? best->count
+			: std::numeric_limits<int>::max();
+		auto count = 0;
+		for (auto i = from; i != till && count < limit; ++i) {
+			++count;
+		}
+		if (count < limit) {
+			best = Range{ from, till, count };
+			bestWord = word;
 		}
+	}
+	if (!best) {
 		return result;
-	}();
-	auto result = std::vector<not_null<Row*>>();
-	if (!minimal || minimal->empty()) {
+	}
+	const auto letterList = filtered(bestWord[0]);
+	if (!letterList || letterList->empty()) {
 		return result;
 	}
-	result.reserve(minimal->size());
-	for (const auto row : *minimal) {
-		const auto &nameWords = row->entry()->chatListNameWords();
-		const auto found = [&](const QString &word) {
-			for (const auto &name : nameWords) {
-				if (name.startsWith(word)) {
-					return true;
-				}
-			}
-			return false;
-		};
-		const auto allFound = [&] {
-			for (const auto &word : words) {
-				if (!found(word)) {
-					return false;
-				}
-			}
-			return true;
-		}();
+
+	auto candidates = std::vector<Key>();
+	for (auto i = best->from; i != best->till; ++i) {
+		candidates.insert(end(candidates), begin(i->second), end(i->second));
+	}
+	ranges::sort(candidates);
+	candidates.erase(
+		std::unique(begin(candidates), end(candidates)),
+		end(candidates));
+	result.reserve(candidates.size());
+	for (const auto key : candidates) {
+		const auto i = _wordsByKey.find(key);
+		if (i == end(_wordsByKey)) {
+			continue;
+		}
+		const auto allFound = ranges::all_of(words, [&](const QString &word) {
+			return word.isEmpty() || HasWordWithPrefix(i->second, word);
+		});
 		if (allFound) {
-			result.push_back(row);
+			if (const auto row = letterList->getRow(key)) {
+				result.push_back(row);
+			}
 		}
 	}
+	ranges::sort(result, std::less<>(), &Row::pos);
 	return result;
 }
 
@@ -10,6 +10,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "dialogs/dialogs_entry.h"
 #include "dialogs/dialogs_list.h"
 
+#include <map>
+
 class History;
 
 namespace Dialogs {
@@ -82,10 +84,17 @@ private:
 		not_null<History*> history,
 		const base::flat_set<QChar> &oldChars);
 
+	void indexWords(Key key);
+	void unindexWords(Key key);
+
 	SortMode _sortMode = SortMode();
 	List _list, _empty;
 	base::flat_map<QChar, List> _index;
 
+	// Name words of all entries sorted for prefix lookups in filtered().
+	std::map<QString, base::flat_set<Key>> _words;
+	std::map<Key, base::flat_set<QString>> _wordsByKey;
+
 };
 
 } // namespace Dialogs
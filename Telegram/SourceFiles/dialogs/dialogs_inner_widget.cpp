@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history.h"
 #include "history/history_item.h"
 #include "core/shortcuts.h"
+#include "core/paint_profiler.h"
 #include "ui/widgets/buttons.h"
 #include "ui/widgets/popup_menu.h"
 #include "ui/text_options.h"
@@ -53,11 +54,27 @@ namespace {
 
 constexpr auto kHashtagResultsLimit = 5;
 constexpr auto kStartReorderThreshold = 30;
+constexpr auto kRowsCacheLimit = 64;
+constexpr auto kPaintStatsPeriod = 10 * crl::time(1000);
 
 inline int DialogsRowHeight() {
 	return (DialogListLines() == 1 ? st::dialogsImportantBarHeight : st::dialogsRowHeight);
 }
 
+template <typename State>
+[[nodiscard]] bool SameRowCacheState(const State &a, const State &b) {
+	return (a.width == b.width)
+		&& (a.unreadCount == b.unreadCount)
+		&& (a.item == b.item)
+		&& (a.date == b.date)
+		&& (a.active == b.active)
+		&& (a.selected == b.selected)
+		&& (a.unreadMark == b.unreadMark)
+		&& (a.unreadMuted == b.unreadMuted)
+		&& (a.mentions == b.mentions)
+		&& (a.pinned == b.pinned);
+}
+
 inline int DialogsPhotoSize() {
 	return (DialogListLines() == 1 ? st::dialogsUnreadHeight : st::dialogsPhotoSize);
 }
@@ -138,12 +155,16 @@ InnerWidget::InnerWidget(
 	});
 	_cancelSearchFromUser->hide();
 
-	subscribe(session().downloaderTaskFinished(), [=] { update(); });
+	subscribe(session().downloaderTaskFinished(), [=] {
+		clearRowsCache();
+		update();
+	});
 
 	subscribe(session().notifications().settingsChanged(), [=](
 			Window::Notifications::ChangeType change) {
 		if (change == Window::Notifications::ChangeType::CountMessages) {
 			// Folder rows change their unread badge with this setting.
+			clearRowsCache();
 			update();
 		}
 	});
@@ -218,6 +239,7 @@ InnerWidget::InnerWidget(
 	subscribe(Window::Theme::Background(), [=](const Window::Theme::BackgroundUpdate &data) {
 		if (data.paletteChanged()) {
 			Layout::clearUnreadBadgesCache();
+			clearRowsCache();
 		}
 	});
 
@@ -233,9 +255,11 @@ InnerWidget::InnerWidget(
 			stopReorderPinned();
 		}
 		if (update.flags & UpdateFlag::NameChanged) {
+			clearRowsCache();
 			this->update();
 		}
 		if (update.flags & (UpdateFlag::PhotoChanged | UpdateFlag::UserOccupiedChanged)) {
+			clearRowsCache();
 			this->update();
 			emit App::main()->dialogsUpdated();
 		}
@@ -393,6 +417,9 @@ void InnerWidget::changeOpenedFolder(Data::Folder *folder) {
 }
 
 void InnerWidget::paintEvent(QPaintEvent *e) {
+	const auto profile = Core::PaintProfilerScope(
+		"Dialogs::InnerWidget",
+		Core::PaintZone::Frame);
 	Painter p(this);
 
 	const auto r = e->rect();
@@ -404,6 +431,14 @@ void InnerWidget::paintEvent(QPaintEvent *e) {
 	auto dialogsClip = r;
 	auto ms = crl::now();
 	if (_state == WidgetState::Default) {
+		const auto started = std::chrono::steady_clock::now();
+		const auto countTime = gsl::finally([&] {
+			countPaintTime(std::chrono::duration_cast<
+				std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now() - started).count());
+		});
+		++_rowsCacheFrame;
+
 		paintCollapsedRows(p, r);
 
 		const auto rows = shownDialogs();
@@ -439,7 +474,7 @@ void InnerWidget::paintEvent(QPaintEvent *e) {
 				}
 				const auto isActive = (row->key() == active);
 				const auto isSelected = (row->key() == selected);
-				Layout::RowPainter::paint(
+				paintCachedDialog(
 					p,
 					row,
 					fullWidth,
@@ -491,6 +526,7 @@ void InnerWidget::paintEvent(QPaintEvent *e) {
 					}
 				}
 			}
+			pruneRowsCache();
 		}
 		if (!otherStart) {
 			p.fillRect(dialogsClip, st::dialogsBg);
@@ -670,6 +706,104 @@ void InnerWidget::paintEvent(QPaintEvent *e) {
 	}
 }
 
+void InnerWidget::paintCachedDialog(
+		Painter &p,
+		not_null<Row*> row,
+		int fullWidth,
+		bool active,
+		bool selected,
+		crl::time ms) {
+	const auto entry = row->entry();
+	const auto history = row->history();
+	if (row->animating()
+		|| (history && history->hasSendActionAnimation())) {
+		_rowsCache.erase(entry);
+		Layout::RowPainter::paint(p, row, fullWidth, active, selected, ms);
+		return;
+	}
+	auto state = RowCacheState();
+	state.width = fullWidth;
+	state.unreadCount = entry->chatListUnreadCount();
+	state.item = entry->chatListMessage();
+	state.date = QDate::currentDate();
+	state.active = active;
+	state.selected = selected;
+	state.unreadMark = entry->chatListUnreadMark();
+	state.unreadMuted = entry->chatListMutedBadge();
+	state.mentions = history && history->hasUnreadMentions();
+	state.pinned = entry->isPinnedDialog();
+
+	auto &cache = _rowsCache[entry];
+	cache.usedFrame = _rowsCacheFrame;
+	if (cache.frame.isNull() || !SameRowCacheState(cache.state, state)) {
+		const auto size = QSize(fullWidth, DialogsRowHeight());
+		if (cache.frame.size() != size * cIntRetinaFactor()) {
+			cache.frame = QPixmap(size * cIntRetinaFactor());
+			cache.frame.setDevicePixelRatio(cRetinaFactor());
+		}
+		cache.frame.fill(st::dialogsBg->c);
+		{
+			Painter q(&cache.frame);
+			Layout::RowPainter::paint(
+				q,
+				row,
+				fullWidth,
+				active,
+				selected,
+				ms);
+		}
+		cache.state = state;
+		++_rowsCacheMisses;
+	} else {
+		++_rowsCacheHits;
+	}
+	p.drawPixmap(0, 0, cache.frame);
+}
+
+void InnerWidget::invalidateRowCache(Key key) {
+	if (key) {
+		_rowsCache.erase(key.entry());
+	}
+}
+
+void InnerWidget::clearRowsCache() {
+	_rowsCache.clear();
+}
+
+void InnerWidget::pruneRowsCache() {
+	if (_rowsCache.size() <= kRowsCacheLimit) {
+		return;
+	}
+	for (auto i = begin(_rowsCache); i != end(_rowsCache);) {
+		if (i->second.usedFrame != _rowsCacheFrame) {
+			i = _rowsCache.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void InnerWidget::countPaintTime(int64 nanoseconds) {
+	const auto now = crl::now();
+	if (!_paintStatsStarted) {
+		_paintStatsStarted = now;
+	}
+	_paintNanoseconds += nanoseconds;
+	++_paintFrames;
+	if (now - _paintStatsStarted < kPaintStatsPeriod) {
+		return;
+	}
+	DEBUG_LOG(("Dialogs Paint: %1 frames, average %2 us, "
+		"cached rows %3, repainted rows %4."
+		).arg(_paintFrames
+		).arg(_paintNanoseconds / (_paintFrames * 1000)
+		).arg(_rowsCacheHits
+		).arg(_rowsCacheMisses));
+	_paintStatsStarted = now;
+	_paintNanoseconds = 0;
+	_paintFrames = _rowsCacheHits = _rowsCacheMisses = 0;
+}
+
 void InnerWidget::paintCollapsedRows(Painter &p, QRect clip) const {
 	auto index = 0;
 	const auto rowHeight = st::dialogsImportantBarHeight;
@@ -1425,6 +1559,7 @@ void InnerWidget::resizeEvent(QResizeEvent *e) {
 void InnerWidget::dialogRowReplaced(
 		Row *oldRow,
 		Row *newRow) {
+	clearRowsCache();
 	if (_state == WidgetState::Filtered) {
 		for (auto i = _filterResults.begin(); i != _filterResults.end();) {
 			if (*i == oldRow) { // this row is shown in filtered and maybe is in contacts!
@@ -1544,6 +1679,7 @@ int InnerWidget::defaultRowTop(not_null<Row*> row) const {
 void InnerWidget::repaintDialogRow(
 		Mode list,
 		not_null<Row*> row) {
+	invalidateRowCache(row->key());
 	if (_state == WidgetState::Default) {
 		if (_mode == list) {
 			if (const auto folder = row->folder()) {
@@ -1593,6 +1729,7 @@ void InnerWidget::updateDialogRow(
 	if (updateRect.isEmpty()) {
 		updateRect = QRect(0, 0, width(), DialogsRowHeight());
 	}
+	invalidateRowCache(row.key);
 	if (IsServerMsgId(-row.fullId.msg)) {
 		if (const auto peer = row.key.peer()) {
 			if (const auto from = peer->migrateFrom()) {
@@ -1981,6 +2118,8 @@ void InnerWidget::visibleTopBottomUpdated(
 }
 
 void InnerWidget::itemRemoved(not_null<const HistoryItem*> item) {
+	clearRowsCache();
+
 	int wasCount = _searchResults.size();
 	for (auto i = _searchResults.begin(); i != _searchResults.end();) {
 		if ((*i)->item() == item) {
@@ -2110,6 +2249,25 @@ bool InnerWidget::searchReceived(
 	return lastDateFound != 0;
 }
 
+void InnerWidget::localSearchReceived(
+		const std::vector<not_null<HistoryItem*>> &items) {
+	if (_state != WidgetState::Filtered
+		|| items.empty()
+		|| uniqueSearchResults()) {
+		return;
+	}
+
+	// Results from the server replace these when they arrive.
+	clearSearchResults(false);
+	for (const auto item : items) {
+		_searchResults.push_back(
+			std::make_unique<FakeRow>(_searchInChat, item));
+	}
+	_searchedCount = _searchResults.size();
+	_waitingForSearch = false;
+	refresh();
+}
+
 void InnerWidget::peerSearchReceived(
 		const QString &query,
 		const QVector<MTPPeer> &my,
@@ -2197,6 +2355,7 @@ bool InnerWidget::needCollapsedRowsRefresh() const {
 }
 
 void InnerWidget::refresh(bool toTop) {
+	clearRowsCache();
 	if (needCollapsedRowsRefresh()) {
 		return refreshWithCollapsedRows(toTop);
 	}
@@ -76,6 +76,8 @@ public:
 		HistoryItem *inject,
 		SearchRequestType type,
 		int fullCount);
+	void localSearchReceived(
+		const std::vector<not_null<HistoryItem*>> &items);
 	void peerSearchReceived(
 		const QString &query,
 		const QVector<MTPPeer> &my,
@@ -161,6 +163,23 @@ private:
 	struct CollapsedRow;
 	struct HashtagResult;
 	struct PeerSearchResult;
+	struct RowCacheState {
+		int width = 0;
+		int unreadCount = 0;
+		HistoryItem *item = nullptr;
+		QDate date;
+		bool active = false;
+		bool selected = false;
+		bool unreadMark = false;
+		bool unreadMuted = false;
+		bool mentions = false;
+		bool pinned = false;
+	};
+	struct RowCache {
+		RowCacheState state;
+		QPixmap frame;
+		uint64 usedFrame = 0;
+	};
 
 	enum class JumpSkip {
 		PreviousOrBegin,
@@ -259,6 +278,17 @@ private:
 	void paintCollapsedRows(
 		Painter &p,
 		QRect clip) const;
+	void paintCachedDialog(
+		Painter &p,
+		not_null<Row*> row,
+		int fullWidth,
+		bool active,
+		bool selected,
+		crl::time ms);
+	void invalidateRowCache(Key key);
+	void clearRowsCache();
+	void pruneRowsCache();
+	void countPaintTime(int64 nanoseconds);
 	void paintCollapsedRow(
 		Painter &p,
 		not_null<const CollapsedRow*> row,
@@ -334,6 +364,15 @@ private:
 	};
 	std::vector<PinnedRow> _pinnedRows;
 	Ui::Animations::Basic _pinnedShiftAnimation;
+
+	// Rendered rows of the chats list, repainted only on changes.
+	base::flat_map<not_null<Entry*>, RowCache> _rowsCache;
+	uint64 _rowsCacheFrame = 0;
+	int _rowsCacheHits = 0;
+	int _rowsCacheMisses = 0;
+	int64 _paintNanoseconds = 0;
+	int _paintFrames = 0;
+	crl::time _paintStatsStarted = 0;
 	base::flat_set<Key> _pinnedOnDragStart;
 
 	// Remember the last currently dragged row top shift for updating area.
@@ -13,6 +13,28 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwidget.h"
 
 namespace Dialogs {
+namespace {
+
+// Same as std::partition_point, but checks the elements near the start
+// first, so moving a row by a few positions takes a few comparisons.
+template <typename Iterator, typename Predicate>
+Iterator GallopPartitionPoint(
+		Iterator first,
+		Iterator last,
+		Predicate &&predicate) {
+	auto step = typename std::iterator_traits<Iterator>::difference_type(1);
+	while (first != last) {
+		const auto till = (step < (last - first)) ? (first + step) : last;
+		if (!predicate(*(till - 1))) {
+			return std::partition_point(first, till, predicate);
+		}
+		first = till;
+		step *= 2;
+	}
+	return last;
+}
+
+} // namespace
 
 List::List(SortMode sortMode) : _sortMode(sortMode) {
 }
@@ -28,7 +50,7 @@ not_null<Row*> List::addToEnd(Key key) {
 		return result;
 	}
 	const auto result = _rowByKey.emplace(
-		key,
+		key.entry(),
 		std::make_unique<Row>(key, _rows.size())
 	).first->second.get();
 	_rows.emplace_back(result);
@@ -63,17 +85,19 @@ void List::adjustByName(not_null<Row*> row) {
 	const auto &name = row->entry()->chatListName();
 	const auto index = row->pos();
 	const auto i = _rows.begin() + index;
-	const auto before = std::find_if(i + 1, _rows.end(), [&](Row *row) {
+	const auto before = GallopPartitionPoint(i + 1, _rows.end(), [&](
+			Row *row) {
 		const auto &greater = row->entry()->chatListName();
-		return greater.compare(name, Qt::CaseInsensitive) >= 0;
+		return greater.compare(name, Qt::CaseInsensitive) < 0;
 	});
 	if (before != i + 1) {
 		rotate(i, i + 1, before);
 	} else if (i != _rows.begin()) {
 		const auto from = std::make_reverse_iterator(i);
-		const auto after = std::find_if(from, _rows.rend(), [&](Row *row) {
+		const auto after = GallopPartitionPoint(from, _rows.rend(), [&](
+				Row *row) {
 			const auto &less = row->entry()->chatListName();
-			return less.compare(name, Qt::CaseInsensitive) <= 0;
+			return less.compare(name, Qt::CaseInsensitive) > 0;
 		}).base();
 		if (after != i) {
 			rotate(after, i, i + 1);
@@ -87,15 +111,17 @@ void List::adjustByDate(not_null<Row*> row) {
 	const auto key = row->sortKey();
 	const auto index = row->pos();
 	const auto i = _rows.begin() + index;
-	const auto before = std::find_if(i + 1, _rows.end(), [&](Row *row) {
-		return (row->sortKey() <= key);
+	const auto before = GallopPartitionPoint(i + 1, _rows.end(), [&](
+			Row *row) {
+		return (row->sortKey() > key);
 	});
 	if (before != i + 1) {
 		rotate(i, i + 1, before);
 	} else {
 		const auto from = std::make_reverse_iterator(i);
-		const auto after = std::find_if(from, _rows.rend(), [&](Row *row) {
-			return (row->sortKey() >= key);
+		const auto after = GallopPartitionPoint(from, _rows.rend(), [&](
+				Row *row) {
+			return (row->sortKey() < key);
 		}).base();
 		if (after != i) {
 			rotate(after, i, i + 1);
@@ -104,7 +130,7 @@ void List::adjustByDate(not_null<Row*> row) {
 }
 
 bool List::moveToTop(Key key) {
-	const auto i = _rowByKey.find(key);
+	const auto i = _rowByKey.find(key.entry());
 	if (i == _rowByKey.cend()) {
 		return false;
 	}
@@ -128,7 +154,7 @@ void List::rotate(
 }
 
 bool List::del(Key key, Row *replacedBy) {
-	auto i = _rowByKey.find(key);
+	auto i = _rowByKey.find(key.entry());
 	if (i == _rowByKey.cend()) {
 		return false;
 	}
@@ -30,10 +30,10 @@ public:
 		return _rows.empty();
 	}
 	bool contains(Key key) const {
-		return _rowByKey.find(key) != _rowByKey.end();
+		return _rowByKey.find(key.entry()) != _rowByKey.end();
 	}
 	Row *getRow(Key key) const {
-		const auto i = _rowByKey.find(key);
+		const auto i = _rowByKey.find(key.entry());
 		return (i != _rowByKey.end()) ? i->second.get() : nullptr;
 	}
 	Row *rowAtY(int y, int h) const {
@@ -79,7 +79,7 @@ private:
 
 	SortMode _sortMode = SortMode();
 	std::vector<not_null<Row*>> _rows;
-	std::map<Key, std::unique_ptr<Row>> _rowByKey;
+	std::unordered_map<Entry*, std::unique_ptr<Row>> _rowByKey;
 
 };
 
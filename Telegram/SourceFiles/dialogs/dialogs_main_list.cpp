@@ -72,6 +72,15 @@ UnreadState MainList::unreadState() const {
 	return _unreadState;
 }
 
+UnreadState MainList::countUnreadState() const {
+	auto result = UnreadState();
+	result.known = true;
+	for (const auto row : _all.all()) {
+		result += row->entry()->chatListUnreadState();
+	}
+	return result;
+}
+
 not_null<IndexedList*> MainList::indexed(Mode list) {
 	return (list == Mode::All) ? &_all : &_important;
 }
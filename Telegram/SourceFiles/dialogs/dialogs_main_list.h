@@ -29,6 +29,9 @@ public:
 		bool added);
 	UnreadState unreadState() const;
 
+	// Sums the states of all entries again, for consistency checks.
+	UnreadState countUnreadState() const;
+
 	not_null<IndexedList*> indexed(Mode list = Mode::All);
 	not_null<const IndexedList*> indexed(Mode list = Mode::All) const;
 	not_null<PinnedList*> pinned();
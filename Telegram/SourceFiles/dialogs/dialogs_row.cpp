@@ -115,6 +115,11 @@ void BasicRow::stopLastRipple() {
 	}
 }
 
+bool BasicRow::animating() const {
+	return _ripple
+		|| (_onlineUserpic && _onlineUserpic->animation.animating());
+}
+
 void BasicRow::paintRipple(
 		Painter &p,
 		int x,
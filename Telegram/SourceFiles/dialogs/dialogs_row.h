@@ -39,6 +39,9 @@ public:
 	void addRipple(QPoint origin, QSize size, Fn<void()> updateCallback);
 	void stopLastRipple();
 
+	// Ripple or online badge animation is running.
+	[[nodiscard]] bool animating() const;
+
 	void paintRipple(
 		Painter &p,
 		int x,
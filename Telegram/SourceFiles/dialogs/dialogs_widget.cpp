@@ -51,6 +51,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Dialogs {
 namespace {
 
+constexpr auto kMinSearchDelay = crl::time(250);
+
 QString SwitchToChooseFromQuery() {
 	return qsl("from:");
 }
@@ -770,6 +772,7 @@ bool Widget::onSearchMessages(bool searchCache) {
 		_searchNextRate = 0;
 		_searchFull = _searchFullMigrated = false;
 		cancelSearchRequest();
+		showLocalSearchResults();
 		if (const auto peer = _searchInChat.peer()) {
 			auto &histories = session().data().histories();
 			const auto type = Data::Histories::RequestType::History;
@@ -847,10 +850,16 @@ bool Widget::onSearchMessages(bool searchCache) {
 				_peerSearchRequest = 0;
 				peerSearchReceived(i.value(), 0);
 				result = true;
+			} else {
+				showPeerSearchFromPrefix(query);
 			}
 		} else if (_peerSearchQuery != query) {
 			_peerSearchQuery = query;
 			_peerSearchFull = false;
+			if (_peerSearchRequest) {
+				_peerSearchQueries.remove(_peerSearchRequest);
+				MTP::cancel(base::take(_peerSearchRequest));
+			}
 			_peerSearchRequest = MTP::send(
 				MTPcontacts_Search(
 					MTP_string(_peerSearchQuery),
@@ -880,9 +889,68 @@ bool Widget::searchForPeersRequired(const QString &query) const {
 	return (query[0] != '#');
 }
 
+bool Widget::showPeerSearchFromPrefix(const QString &query) {
+	const auto words = TextUtilities::PrepareSearchWords(query);
+	if (words.isEmpty()) {
+		return false;
+	}
+	const auto matches = [&](const MTPPeer &data) {
+		const auto peer = session().data().peerLoaded(peerFromMTP(data));
+		if (!peer) {
+			return false;
+		}
+		const auto &names = peer->nameWords();
+		return ranges::all_of(words, [&](const QString &word) {
+			const auto i = names.lower_bound(word);
+			return (i != names.end()) && i->startsWith(word);
+		});
+	};
+	const auto filter = [&](const QVector<MTPPeer> &list) {
+		auto result = QVector<MTPPeer>();
+		for (const auto &peer : list) {
+			if (matches(peer)) {
+				result.push_back(peer);
+			}
+		}
+		return result;
+	};
+
+	// Show what the server found for a shorter query right away,
+	// the request for the full query will refine it.
+	for (auto length = query.size() - 1; length > 0; --length) {
+		const auto i = _peerSearchCache.constFind(query.mid(0, length));
+		if (i == _peerSearchCache.cend()) {
+			continue;
+		}
+		const auto &data = i.value().c_contacts_found();
+		_inner->peerSearchReceived(
+			query,
+			filter(data.vmy_results().v),
+			filter(data.vresults().v));
+		return true;
+	}
+	return false;
+}
+
+crl::time Widget::countSearchDelay() {
+	// Wait a bit longer than the usual pause between the typed keys.
+	const auto now = crl::now();
+	const auto interval = _searchLastTyped
+		? std::min(now - _searchLastTyped, crl::time(AutoSearchTimeout))
+		: crl::time(AutoSearchTimeout);
+	_searchLastTyped = now;
+	_searchTypingInterval = _searchTypingInterval
+		? (_searchTypingInterval * 3 + interval) / 4
+		: interval;
+	return std::clamp(
+		_searchTypingInterval * 3 / 2,
+		kMinSearchDelay,
+		crl::time(AutoSearchTimeout));
+}
+
 void Widget::onNeedSearchMessages() {
 	if (!onSearchMessages(true)) {
-		_searchTimer.start(AutoSearchTimeout);
+		_searchTimer.start(countSearchDelay());
 	}
 }
 
@@ -1160,6 +1228,21 @@ void Widget::searchReceived(
 	update();
 }
 
+void Widget::showLocalSearchResults() {
+	if (_searchQuery.isEmpty() || _searchQueryFrom) {
+		return;
+	}
+	const auto history = _searchInChat.history();
+	if (_searchInChat && !history) {
+		return;
+	}
+	_inner->localSearchReceived(
+		session().data().messagesSearchIndex().search(
+			_searchQuery,
+			history,
+			SearchPerPage));
+}
+
 void Widget::peerSearchReceived(
 		const MTPcontacts_Found &result,
 		mtpRequestId requestId) {
@@ -137,10 +137,13 @@ private:
 		mtpRequestId requestId);
 	void escape();
 	void cancelSearchRequest();
+	void showLocalSearchResults();
 
 	void setupSupportMode();
 	void setupConnectingWidget();
 	bool searchForPeersRequired(const QString &query) const;
+	bool showPeerSearchFromPrefix(const QString &query);
+	crl::time countSearchDelay();
 	void setSearchInChat(Key chat, UserData *from = nullptr);
 	void showJumpToDate();
 	void showSearchFrom();
@@ -210,6 +213,8 @@ private:
 	QString _lastFilterText;
 
 	QTimer _searchTimer;
+	crl::time _searchLastTyped = 0;
+	crl::time _searchTypingInterval = 0;
 
 	QString _peerSearchQuery;
 	bool _peerSearchFull = false;
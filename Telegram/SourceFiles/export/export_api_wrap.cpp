@@ -14,6 +14,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/mtproto_rpc_sender.h"
 #include "base/value_ordering.h"
 #include "base/bytes.h"
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDateTime>
+#include <QtCore/QTimer>
+
 #include <set>
 #include <deque>
 
@@ -22,13 +27,53 @@ namespace {
 
 constexpr auto kUserpicsSliceLimit = 100;
 constexpr auto kFileChunkSize = 128 * 1024;
-constexpr auto kFileRequestsCount = 2;
+constexpr auto kFileRequestsCount = 8;
 constexpr auto kFileNextRequestDelay = crl::time(20);
+constexpr auto kFilePrefetchCount = 4;
+constexpr auto kFilePrefetchMaxSize = kFileChunkSize;
 constexpr auto kChatsSliceLimit = 100;
 constexpr auto kMessagesSliceLimit = 100;
 constexpr auto kTopPeerSliceLimit = 100;
 constexpr auto kFileMaxSize = 1500 * 1024 * 1024;
-constexpr auto kLocationCacheSize = 100'000;
+constexpr auto kFilesManifestMaxDays = 90;
+constexpr auto kFloodRateWindow = crl::time(60 * 1000);
+constexpr auto kFloodRateMargin = 0.8;
+constexpr auto kFloodRateMin = 0.2;
+constexpr auto kFloodRateMax = 100.;
+constexpr auto kFloodRateRaiseAfter = 50;
+constexpr auto kFloodRateRaise = 1.2;
+constexpr auto kFloodBurstDuration = crl::time(2000);
+
+// Requests are paced separately for each method, keyed by an address that
+// is unique for each request type.
+using RequestKind = const void*;
+
+template <typename Request>
+[[nodiscard]] RequestKind RequestKindOf() {
+	static auto tag = char(0);
+	return &tag;
+}
+
+[[nodiscard]] crl::time FloodWait(const RPCError &error) {
+	if (!MTP::isFloodError(error)) {
+		return 0;
+	}
+	const auto seconds = error.type().mid(
+		qstr("FLOOD_WAIT_").size()).toInt();
+	return std::max(seconds, 1) * crl::time(1000);
+}
+
+// Lists the files downloaded by an export with their locations, so that an
+// export to the same folder later copies them instead of downloading again.
+// Manifests are kept in the app data, one per export folder, to leave
+// nothing of ours in the exported data.
+[[nodiscard]] QString FilesManifestPath(
+		const QString &manifests,
+		const QString &folder) {
+	const auto utf8 = QDir(folder).absolutePath().toUtf8();
+	const auto hash = hashMd5Hex(utf8.constData(), utf8.size());
+	return manifests + QString::fromLatin1(hash.data(), hash.size());
+}
 
 struct LocationKey {
 	uint64 type;
@@ -45,6 +90,43 @@ std::tuple<const uint64 &, const uint64 &> value_ordering_helper(const LocationK
 		value.id);
 }
 
+Data::File::SkipReason ComputeSkipReason(
+		const Settings &settings,
+		const Data::File &file,
+		const Data::Message *message) {
+	using SkipReason = Data::File::SkipReason;
+	using Type = MediaSettings::Type;
+	const auto type = message ? message->media.content.match(
+	[&](const Data::Document &data) {
+		if (data.isSticker) {
+			return Type::Sticker;
+		} else if (data.isVideoMessage) {
+			return Type::VideoMessage;
+		} else if (data.isVoiceMessage) {
+			return Type::VoiceMessage;
+		} else if (data.isAnimated) {
+			return Type::GIF;
+		} else if (data.isVideoFile) {
+			return Type::Video;
+		} else {
+			return Type::File;
+		}
+	}, [](const auto &data) {
+		return Type::Photo;
+	}) : Type(0);
+
+	const auto limit = settings.media.sizeLimit;
+	if (message && Data::SkipMessageByDate(*message, settings)) {
+		return SkipReason::DateLimits;
+	} else if ((settings.media.types & type) != type) {
+		return SkipReason::FileType;
+	} else if ((message ? message->file().size : file.size) >= limit) {
+		// Don't load thumbs for large files that we skip.
+		return SkipReason::FileSize;
+	}
+	return SkipReason::None;
+}
+
 LocationKey ComputeLocationKey(const Data::FileLocation &value) {
 	auto result = LocationKey();
 	result.type = value.dcId;
@@ -115,19 +197,71 @@ Settings::Type SettingsFromDialogsType(Data::DialogInfo::Type type) {
 
 } // namespace
 
+// Keeps a token bucket for each request kind. Kinds start unlimited, a
+// FLOOD_WAIT blocks the kind for the wait and limits it to a bit less than
+// the rate it was sent at before the flood. A long run of requests without
+// floods raises the limit back, so the rate follows what the server allows.
+class ApiWrap::RequestsPacer {
+public:
+	explicit RequestsPacer(Fn<void(FnMut<void()>)> runner);
+
+	void send(RequestKind kind, FnMut<void()> request);
+	void resend(RequestKind kind, crl::time wait, FnMut<void()> request);
+	void succeeded(RequestKind kind);
+
+private:
+	struct Bucket {
+		double rate = 0.; // Requests per second, zero for unlimited.
+		double tokens = 0.;
+		crl::time refilled = 0;
+		crl::time blockedTill = 0;
+		crl::time wakeAt = 0;
+		int succeeded = 0;
+		std::deque<crl::time> sent;
+		std::deque<FnMut<void()>> queue;
+	};
+
+	[[nodiscard]] crl::time takeToken(Bucket &bucket, crl::time now) const;
+	void sendQueued(RequestKind kind);
+	void wakeAt(RequestKind kind, Bucket &bucket, crl::time when);
+	void wake(RequestKind kind, crl::time when);
+
+	Fn<void(FnMut<void()>)> _runner;
+	base::flat_map<RequestKind, Bucket> _buckets;
+
+};
+
 class ApiWrap::LoadedFileCache {
 public:
 	using Location = Data::FileLocation;
 
-	LoadedFileCache(int limit);
+	void startManifest(const QString &manifests, const QString &folder);
+	[[nodiscard]] Output::Result flushManifest();
 
-	void save(const Location &location, const QString &relativePath);
+	void save(
+		const Location &location,
+		const QString &relativePath,
+		int size);
 	std::optional<QString> find(const Location &location) const;
+	std::optional<QString> findPrevious(
+		const Location &location,
+		int size) const;
 
 private:
-	int _limit = 0;
+	struct Previous {
+		QString path;
+		int size = 0;
+	};
+
+	void removeStale(const QString &manifests);
+	void loadPrevious(const QString &manifests, const QString &folder);
+	void writeManifest(const QByteArray &block);
+
+	// Files are kept for the whole export, so media forwarded to many
+	// chats is stored once and all the messages link to the same file.
 	std::map<LocationKey, QString> _map;
-	std::deque<LocationKey> _list;
+	std::map<LocationKey, Previous> _previous;
+	std::unique_ptr<Output::File> _manifest;
 
 };
 
@@ -192,6 +326,16 @@ struct ApiWrap::FileProcess {
 	std::deque<Request> requests;
 };
 
+struct ApiWrap::FilePrefetches {
+	struct Entry {
+		QByteArray bytes;
+		bool finished = false;
+		FnMut<void(QByteArray&&)> waiting;
+	};
+	std::map<LocationKey, Entry> map;
+	int loading = 0;
+};
+
 struct ApiWrap::FileProgress {
 	int ready = 0;
 	int total = 0;
@@ -227,15 +371,19 @@ struct ApiWrap::ChatProcess {
 	Fn<bool(Data::MessagesSlice&&)> handleSlice;
 	FnMut<void()> done;
 
-	FnMut<void(MTPmessages_Messages&&)> requestDone;
-
 	int localSplitIndex = 0;
 	int32 largestIdPlusOne = 1;
 
+	// The next slice is requested while files of the current one load.
+	std::optional<MTPmessages_Messages> nextSlice;
+	bool nextSliceRequested = false;
+	bool nextSliceWaiting = false;
+
 	Data::ParseMediaContext context;
 	std::optional<Data::MessagesSlice> slice;
 	bool lastSlice = false;
 	int fileIndex = 0;
+	int prefetchIndex = 0;
 };
 
 
@@ -246,7 +394,9 @@ public:
 	using Response = typename Request::ResponseType;
 
 	RequestBuilder(
-		Original &&builder,
+		not_null<RequestsPacer*> pacer,
+		RequestKind kind,
+		Fn<Original()> original,
 		FnMut<void(RPCError&&)> commonFailHandler);
 
 	[[nodiscard]] RequestBuilder &done(FnMut<void()> &&handler);
@@ -255,20 +405,38 @@ public:
 	[[nodiscard]] RequestBuilder &fail(
 		FnMut<bool(const RPCError &)> &&handler);
 
-	mtpRequestId send();
+	void send();
 
 private:
-	Original _builder;
-	FnMut<void(RPCError&&)> _commonFailHandler;
+	struct State {
+		not_null<RequestsPacer*> pacer;
+		RequestKind kind = nullptr;
+		Fn<Original()> original;
+		FnMut<void(Response &&)> done;
+		FnMut<void(RPCError&&)> fail;
+	};
+
+	static void Send(
+		const std::shared_ptr<State> &state,
+		crl::time floodWait = 0);
+
+	std::shared_ptr<State> _state;
 
 };
 
 template <typename Request>
 ApiWrap::RequestBuilder<Request>::RequestBuilder(
-	Original &&builder,
+	not_null<RequestsPacer*> pacer,
+	RequestKind kind,
+	Fn<Original()> original,
 	FnMut<void(RPCError&&)> commonFailHandler)
-: _builder(std::move(builder))
-, _commonFailHandler(std::move(commonFailHandler)) {
+: _state(std::make_shared<State>(State{
+	pacer,
+	kind,
+	std::move(original),
+	{},
+	std::move(commonFailHandler)
+})) {
 }
 
 template <typename Request>
@@ -276,7 +444,10 @@ auto ApiWrap::RequestBuilder<Request>::done(
 	FnMut<void()> &&handler
 ) -> RequestBuilder& {
 	if (handler) {
-		auto &silence_warning = _builder.done(std::move(handler));
+		_state->done = [handler = std::move(handler)](
+				Response &&result) mutable {
+			handler();
+		};
 	}
 	return *this;
 }
@@ -286,7 +457,7 @@ auto ApiWrap::RequestBuilder<Request>::done(
 	FnMut<void(Response &&)> &&handler
 ) -> RequestBuilder& {
 	if (handler) {
-		auto &silence_warning = _builder.done(std::move(handler));
+		_state->done = std::move(handler);
 	}
 	return *this;
 }
@@ -296,42 +467,286 @@ auto ApiWrap::RequestBuilder<Request>::fail(
 	FnMut<bool(const RPCError &)> &&handler
 ) -> RequestBuilder& {
 	if (handler) {
-		auto &silence_warning = _builder.fail([
-			common = base::take(_commonFailHandler),
+		_state->fail = [
+			common = std::move(_state->fail),
 			specific = std::move(handler)
 		](RPCError &&error) mutable {
 			if (!specific(error)) {
 				common(std::move(error));
 			}
-		});
+		};
 	}
 	return *this;
 }
 
 template <typename Request>
-mtpRequestId ApiWrap::RequestBuilder<Request>::send() {
-	return _commonFailHandler
-		? _builder.fail(base::take(_commonFailHandler)).send()
-		: _builder.send();
+void ApiWrap::RequestBuilder<Request>::send() {
+	Send(base::take(_state));
+}
+
+template <typename Request>
+void ApiWrap::RequestBuilder<Request>::Send(
+		const std::shared_ptr<State> &state,
+		crl::time floodWait) {
+	auto request = [=] {
+		state->original().done([=](Response &&result) {
+			state->pacer->succeeded(state->kind);
+			if (state->done) {
+				state->done(std::move(result));
+			}
+		}).fail([=](RPCError &&error) {
+			if (const auto wait = FloodWait(error)) {
+				Send(state, wait);
+			} else {
+				state->fail(std::move(error));
+			}
+		}).handleFloodErrors().send();
+	};
+	if (floodWait) {
+		state->pacer->resend(state->kind, floodWait, std::move(request));
+	} else {
+		state->pacer->send(state->kind, std::move(request));
+	}
+}
+
+ApiWrap::RequestsPacer::RequestsPacer(Fn<void(FnMut<void()>)> runner)
+: _runner(std::move(runner)) {
+}
+
+void ApiWrap::RequestsPacer::send(
+		RequestKind kind,
+		FnMut<void()> request) {
+	_buckets[kind].queue.push_back(std::move(request));
+	sendQueued(kind);
+}
+
+void ApiWrap::RequestsPacer::resend(
+		RequestKind kind,
+		crl::time wait,
+		FnMut<void()> request) {
+	auto &bucket = _buckets[kind];
+	const auto now = crl::now();
+	while (!bucket.sent.empty()
+		&& bucket.sent.front() + kFloodRateWindow <= now) {
+		bucket.sent.pop_front();
+	}
+
+	// The server took the requests of the last window and wants a pause,
+	// so it allows about that many per the window and the pause together.
+	const auto count = std::max(int(bucket.sent.size()), 1);
+	const auto duration = std::max(
+		(bucket.sent.empty() ? 0 : (now - bucket.sent.front())) + wait,
+		crl::time(1000));
+	const auto rate = std::max(
+		count * 1000. * kFloodRateMargin / duration,
+		kFloodRateMin);
+	bucket.rate = (bucket.rate > 0.) ? std::min(bucket.rate, rate) : rate;
+	bucket.tokens = 0.;
+	bucket.blockedTill = std::max(bucket.blockedTill, now + wait);
+	bucket.refilled = bucket.blockedTill;
+	bucket.succeeded = 0;
+	bucket.sent.clear();
+	bucket.queue.push_front(std::move(request));
+
+	DEBUG_LOG(("Export Info: flood wait %1 ms, pacing at %2 per second."
+		).arg(wait
+		).arg(bucket.rate));
+
+	sendQueued(kind);
+}
+
+void ApiWrap::RequestsPacer::succeeded(RequestKind kind) {
+	auto &bucket = _buckets[kind];
+	if (bucket.rate > 0. && ++bucket.succeeded >= kFloodRateRaiseAfter) {
+		bucket.rate *= kFloodRateRaise;
+		bucket.succeeded = 0;
+		if (bucket.rate > kFloodRateMax) {
+			bucket.rate = 0.;
+		}
+	}
+}
+
+crl::time ApiWrap::RequestsPacer::takeToken(
+		Bucket &bucket,
+		crl::time now) const {
+	if (bucket.blockedTill > now) {
+		return bucket.blockedTill - now;
+	} else if (bucket.rate > 0.) {
+		const auto burst = std::max(
+			bucket.rate * kFloodBurstDuration / 1000.,
+			1.);
+		bucket.tokens = std::min(
+			bucket.tokens + (now - bucket.refilled) * bucket.rate / 1000.,
+			burst);
+		bucket.refilled = now;
+		if (bucket.tokens < 1.) {
+			return crl::time(
+				std::ceil((1. - bucket.tokens) * 1000. / bucket.rate));
+		}
+		bucket.tokens -= 1.;
+	}
+	bucket.sent.push_back(now);
+	while (bucket.sent.front() + kFloodRateWindow <= now) {
+		bucket.sent.pop_front();
+	}
+	return 0;
+}
+
+void ApiWrap::RequestsPacer::sendQueued(RequestKind kind) {
+	const auto now = crl::now();
+	while (true) {
+		const auto i = _buckets.find(kind);
+		if (i == end(_buckets) || i->second.queue.empty()) {
+			return;
+		}
+		auto &bucket = i->second;
+		if (const auto wait = takeToken(bucket, now)) {
+			wakeAt(kind, bucket, now + wait);
+			return;
+		}
+		auto request = std::move(bucket.queue.front());
+		bucket.queue.pop_front();
+		request();
+	}
+}
+
+void ApiWrap::RequestsPacer::wakeAt(
+		RequestKind kind,
+		Bucket &bucket,
+		crl::time when) {
+	if (bucket.wakeAt && bucket.wakeAt <= when) {
+		return;
+	}
+	bucket.wakeAt = when;
+	const auto delay = when - crl::now();
+	crl::on_main([=, runner = _runner] {
+		QTimer::singleShot(int(delay), [=] {
+			runner([=] {
+				wake(kind, when);
+			});
+		});
+	});
+}
+
+void ApiWrap::RequestsPacer::wake(RequestKind kind, crl::time when) {
+	const auto i = _buckets.find(kind);
+	if (i == end(_buckets)) {
+		return;
+	} else if (i->second.wakeAt == when) {
+		i->second.wakeAt = 0;
+	}
+	sendQueued(kind);
+}
+
+void ApiWrap::LoadedFileCache::startManifest(
+		const QString &manifests,
+		const QString &folder) {
+	if (manifests.isEmpty()) {
+		return;
+	}
+	removeStale(manifests);
+
+	// Previous exports to the chosen folder are either the folder itself,
+	// when this export got a subfolder of it, or its other subfolders.
+	auto parent = QDir(folder);
+	if (parent.cdUp()) {
+		loadPrevious(manifests, parent.absolutePath() + '/');
+		const auto self = QDir(folder).absolutePath();
+		const auto list = parent.entryInfoList(
+			QDir::Dirs | QDir::NoDotAndDotDot);
+		for (const auto &info : list) {
+			if (info.absoluteFilePath() != self) {
+				loadPrevious(manifests, info.absoluteFilePath() + '/');
+			}
+		}
+	}
+	_manifest = std::make_unique<Output::File>(
+		FilesManifestPath(manifests, folder),
+		nullptr);
+
+	// The first line tells which folder the manifest belongs to.
+	writeManifest(QDir(folder).absolutePath().toUtf8() + '\n');
+}
+
+// Manifests of folders that were removed or not exported to for a long
+// time are dropped, so that they don't pile up in the app data.
+void ApiWrap::LoadedFileCache::removeStale(const QString &manifests) {
+	const auto expired = QDateTime::currentDateTime().addDays(
+		-kFilesManifestMaxDays);
+	const auto list = QDir(manifests).entryInfoList(QDir::Files);
+	for (const auto &info : list) {
+		QFile f(info.absoluteFilePath());
+		const auto folder = f.open(QIODevice::ReadOnly)
+			? QString::fromUtf8(f.readLine().trimmed())
+			: QString();
+		f.close();
+		if (folder.isEmpty()
+			|| !QDir(folder).exists()
+			|| info.lastModified() < expired) {
+			QFile::remove(info.absoluteFilePath());
+		}
+	}
+}
+
+void ApiWrap::LoadedFileCache::loadPrevious(
+		const QString &manifests,
+		const QString &folder) {
+	QFile f(FilesManifestPath(manifests, folder));
+	if (!f.open(QIODevice::ReadOnly)) {
+		return;
+	} else if (QString::fromUtf8(f.readLine().trimmed())
+		!= QDir(folder).absolutePath()) {
+		return;
+	}
+	while (!f.atEnd()) {
+		const auto line = f.readLine().trimmed();
+		const auto parts = line.split(' ');
+		if (parts.size() < 4) {
+			continue;
+		}
+		auto key = LocationKey();
+		key.type = parts[0].toULongLong();
+		key.id = parts[1].toULongLong();
+		const auto size = parts[2].toInt();
+		const auto skip = parts[0].size() + parts[1].size() + parts[2].size();
+		const auto relativePath = QString::fromUtf8(line.mid(skip + 3));
+		if (size > 0 && !relativePath.isEmpty()) {
+			_previous[key] = Previous{ folder + relativePath, size };
+		}
+	}
+}
+
+void ApiWrap::LoadedFileCache::writeManifest(const QByteArray &block) {
+	if (!_manifest) {
+		return;
+	} else if (const auto result = _manifest->writeBlock(block); !result) {
+		LOG(("Export Error: Could not write the files manifest."));
+		_manifest = nullptr;
+	}
 }
 
-ApiWrap::LoadedFileCache::LoadedFileCache(int limit) : _limit(limit) {
-	Expects(limit >= 0);
+Output::Result ApiWrap::LoadedFileCache::flushManifest() {
+	return _manifest ? _manifest->flush() : Output::Result::Success();
 }
 
 void ApiWrap::LoadedFileCache::save(
 		const Location &location,
-		const QString &relativePath) {
+		const QString &relativePath,
+		int size) {
 	if (!location) {
 		return;
 	}
 	const auto key = ComputeLocationKey(location);
 	_map[key] = relativePath;
-	_list.push_back(key);
-	if (_list.size() > _limit) {
-		const auto key = _list.front();
-		_list.pop_front();
-		_map.erase(key);
+	if (size > 0) {
+		writeManifest(QByteArray::number(key.type)
+			+ ' '
+			+ QByteArray::number(key.id)
+			+ ' '
+			+ QByteArray::number(size)
+			+ ' '
+			+ relativePath.toUtf8()
+			+ '\n');
 	}
 }
 
@@ -347,6 +762,22 @@ std::optional<QString> ApiWrap::LoadedFileCache::find(
 	return std::nullopt;
 }
 
+std::optional<QString> ApiWrap::LoadedFileCache::findPrevious(
+		const Location &location,
+		int size) const {
+	if (!location || size <= 0) {
+		return std::nullopt;
+	}
+	const auto key = ComputeLocationKey(location);
+	const auto i = _previous.find(key);
+	if (i == end(_previous)
+		|| i->second.size != size
+		|| QFileInfo(i->second.path).size() != size) {
+		return std::nullopt;
+	}
+	return i->second.path;
+}
+
 ApiWrap::FileProcess::FileProcess(const QString &path, Output::Stats *stats)
 : file(path, stats) {
 }
@@ -355,13 +786,18 @@ template <typename Request>
 auto ApiWrap::mainRequest(Request &&request) {
 	Expects(_takeoutId.has_value());
 
-	auto original = std::move(_mtp.request(MTPInvokeWithTakeout<Request>(
+	using Invoke = MTPInvokeWithTakeout<Request>;
+	const auto invoke = Invoke(
 		MTP_long(*_takeoutId),
-		std::forward<Request>(request)
-	)).toDC(MTP::ShiftDcId(0, MTP::kExportDcShift)));
-
-	return RequestBuilder<MTPInvokeWithTakeout<Request>>(
-		std::move(original),
+		std::forward<Request>(request));
+
+	return RequestBuilder<Invoke>(
+		_pacer.get(),
+		RequestKindOf<Request>(),
+		[=] {
+			return std::move(_mtp.request(Invoke(invoke)).toDC(
+				MTP::ShiftDcId(0, MTP::kExportDcShift)));
+		},
 		[=](RPCError &&result) { error(std::move(result)); });
 }
 
@@ -382,37 +818,50 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int offset) {
 		|| location.data.type() == mtpc_inputTakeoutFileLocation);
 	Expects(_takeoutId.has_value());
 
-	return std::move(_mtp.request(MTPInvokeWithTakeout<MTPupload_GetFile>(
+	using Invoke = MTPInvokeWithTakeout<MTPupload_GetFile>;
+	const auto invoke = Invoke(
 		MTP_long(*_takeoutId),
 		MTPupload_GetFile(
 			MTP_flags(0),
 			location.data,
 			MTP_int(offset),
-			MTP_int(kFileChunkSize))
-	)).fail([=](RPCError &&result) {
-		if (result.type() == qstr("TAKEOUT_FILE_EMPTY")
-			&& _otherDataProcess != nullptr) {
-			filePartDone(
-				0,
-				MTP_upload_file(
-					MTP_storage_filePartial(),
-					MTP_int(0),
-					MTP_bytes()));
-		} else if (result.type() == qstr("LOCATION_INVALID")
-			|| result.type() == qstr("VERSION_INVALID")) {
-			filePartUnavailable();
-		} else if (result.code() == 400
-			&& result.type().startsWith(qstr("FILE_REFERENCE_"))) {
-			filePartRefreshReference(offset);
-		} else {
-			error(std::move(result));
-		}
-	}).toDC(MTP::ShiftDcId(location.dcId, MTP::kExportMediaDcShift)));
+			MTP_int(kFileChunkSize)));
+	const auto dcId = MTP::ShiftDcId(
+		location.dcId,
+		MTP::kExportMediaDcShift);
+
+	return RequestBuilder<Invoke>(
+		_pacer.get(),
+		RequestKindOf<MTPupload_GetFile>(),
+		[=] {
+			return std::move(_mtp.request(Invoke(invoke)).toDC(dcId));
+		},
+		[=](RPCError &&result) {
+			if (result.type() == qstr("TAKEOUT_FILE_EMPTY")
+				&& _otherDataProcess != nullptr) {
+				filePartDone(
+					0,
+					MTP_upload_file(
+						MTP_storage_filePartial(),
+						MTP_int(0),
+						MTP_bytes()));
+			} else if (result.type() == qstr("LOCATION_INVALID")
+				|| result.type() == qstr("VERSION_INVALID")) {
+				filePartUnavailable();
+			} else if (result.code() == 400
+				&& result.type().startsWith(qstr("FILE_REFERENCE_"))) {
+				filePartRefreshReference(offset);
+			} else {
+				error(std::move(result));
+			}
+		});
 }
 
 ApiWrap::ApiWrap(Fn<void(FnMut<void()>)> runner)
-: _mtp(std::move(runner))
-, _fileCache(std::make_unique<LoadedFileCache>(kLocationCacheSize)) {
+: _mtp(runner, MTP::ConcurrentSender::Delivery::Batched)
+, _pacer(std::make_unique<RequestsPacer>(runner))
+, _fileCache(std::make_unique<LoadedFileCache>())
+, _filePrefetches(std::make_unique<FilePrefetches>()) {
 }
 
 rpl::producer<RPCError> ApiWrap::errors() const {
@@ -425,6 +874,7 @@ rpl::producer<Output::Result> ApiWrap::ioErrors() const {
 
 void ApiWrap::startExport(
 		const Settings &settings,
+		const Environment &environment,
 		Output::Stats *stats,
 		FnMut<void(StartInfo)> done) {
 	Expects(_settings == nullptr);
@@ -432,6 +882,9 @@ void ApiWrap::startExport(
 
 	_settings = std::make_unique<Settings>(settings);
 	_stats = stats;
+	_fileCache->startManifest(
+		environment.filesManifestsPath,
+		_settings->path);
 	_startProcess = std::make_unique<StartProcess>();
 	_startProcess->done = std::move(done);
 
@@ -1032,6 +1485,10 @@ void ApiWrap::messagesCountLoaded(int localSplitIndex, int count) {
 void ApiWrap::finishExport(FnMut<void()> done) {
 	const auto guard = gsl::finally([&] { _takeoutId = std::nullopt; });
 
+	if (const auto result = _fileCache->flushManifest(); !result) {
+		LOG(("Export Error: Could not write the files manifest."));
+	}
+
 	mainRequest(MTPaccount_FinishTakeoutSession(
 		MTP_flags(MTPaccount_FinishTakeoutSession::Flag::f_success)
 	)).done(std::move(done)).send();
@@ -1039,9 +1496,12 @@ void ApiWrap::finishExport(FnMut<void()> done) {
 
 void ApiWrap::cancelExportFast() {
 	if (_takeoutId.has_value()) {
-		const auto requestId = mainRequest(MTPaccount_FinishTakeoutSession(
-			MTP_flags(0)
-		)).send();
+		// Sent past the pacer, so that the request id can be detached.
+		const auto requestId = _mtp.request(
+			MTPInvokeWithTakeout<MTPaccount_FinishTakeoutSession>(
+				MTP_long(*_takeoutId),
+				MTPaccount_FinishTakeoutSession(MTP_flags(0)))
+		).toDC(MTP::ShiftDcId(0, MTP::kExportDcShift)).send();
 		_mtp.request(requestId).detach();
 	}
 }
@@ -1286,6 +1746,14 @@ void ApiWrap::requestMessagesSlice() {
 	if (!count) {
 		loadMessagesFiles({});
 		return;
+	} else if (_chatProcess->nextSliceRequested) {
+		if (_chatProcess->nextSlice) {
+			_chatProcess->nextSliceRequested = false;
+			messagesSliceLoaded(*base::take(_chatProcess->nextSlice));
+		} else {
+			_chatProcess->nextSliceWaiting = true;
+		}
+		return;
 	}
 	requestChatMessages(
 		_chatProcess->info.splits[_chatProcess->localSplitIndex],
@@ -1293,21 +1761,51 @@ void ApiWrap::requestMessagesSlice() {
 		-kMessagesSliceLimit,
 		kMessagesSliceLimit,
 		[=](const MTPmessages_Messages &result) {
+		messagesSliceLoaded(result);
+	});
+}
+
+void ApiWrap::requestNextMessagesSlice() {
+	Expects(_chatProcess != nullptr);
+	Expects(_chatProcess->slice.has_value());
+	Expects(!_chatProcess->nextSliceRequested);
+
+	if (_chatProcess->lastSlice || _chatProcess->slice->list.empty()) {
+		return;
+	}
+	_chatProcess->nextSliceRequested = true;
+	requestChatMessages(
+		_chatProcess->info.splits[_chatProcess->localSplitIndex],
+		_chatProcess->slice->list.back().id + 1,
+		-kMessagesSliceLimit,
+		kMessagesSliceLimit,
+		[=](MTPmessages_Messages &&result) {
 		Expects(_chatProcess != nullptr);
 
-		result.match([&](const MTPDmessages_messagesNotModified &data) {
-			error("Unexpected messagesNotModified received.");
-		}, [&](const auto &data) {
-			if constexpr (MTPDmessages_messages::Is<decltype(data)>()) {
-				_chatProcess->lastSlice = true;
-			}
-			loadMessagesFiles(Data::ParseMessagesSlice(
-				_chatProcess->context,
-				data.vmessages(),
-				data.vusers(),
-				data.vchats(),
-				_chatProcess->info.relativePath));
-		});
+		if (base::take(_chatProcess->nextSliceWaiting)) {
+			_chatProcess->nextSliceRequested = false;
+			messagesSliceLoaded(result);
+		} else {
+			_chatProcess->nextSlice = std::move(result);
+		}
+	});
+}
+
+void ApiWrap::messagesSliceLoaded(const MTPmessages_Messages &result) {
+	Expects(_chatProcess != nullptr);
+
+	result.match([&](const MTPDmessages_messagesNotModified &data) {
+		error("Unexpected messagesNotModified received.");
+	}, [&](const auto &data) {
+		if constexpr (MTPDmessages_messages::Is<decltype(data)>()) {
+			_chatProcess->lastSlice = true;
+		}
+		loadMessagesFiles(Data::ParseMessagesSlice(
+			_chatProcess->context,
+			data.vmessages(),
+			data.vusers(),
+			data.vchats(),
+			_chatProcess->info.relativePath));
 	});
 }
 
@@ -1319,11 +1817,14 @@ void ApiWrap::requestChatMessages(
 		FnMut<void(MTPmessages_Messages&&)> done) {
 	Expects(_chatProcess != nullptr);
 
-	_chatProcess->requestDone = std::move(done);
+	// Both the current and the next slice may be requested at once,
+	// so the handler is kept with the request, not in the process.
+	const auto shared = std::make_shared<
+		FnMut<void(MTPmessages_Messages&&)>>(std::move(done));
 	const auto doneHandler = [=](MTPmessages_Messages &&result) {
 		Expects(_chatProcess != nullptr);
 
-		base::take(_chatProcess->requestDone)(std::move(result));
+		base::take(*shared)(std::move(result));
 	};
 	if (_chatProcess->info.onlyMyMessages) {
 		splitRequest(splitIndex, MTPmessages_Search(
@@ -1366,7 +1867,7 @@ void ApiWrap::requestChatMessages(
 						offsetId,
 						addOffset,
 						limit,
-						base::take(_chatProcess->requestDone));
+						base::take(*shared));
 					return true;
 				}
 			}
@@ -1384,7 +1885,9 @@ void ApiWrap::loadMessagesFiles(Data::MessagesSlice &&slice) {
 	}
 	_chatProcess->slice = std::move(slice);
 	_chatProcess->fileIndex = 0;
+	_chatProcess->prefetchIndex = 0;
 
+	requestNextMessagesSlice();
 	loadNextMessageFile();
 }
 
@@ -1427,6 +1930,7 @@ void ApiWrap::loadNextMessageFile() {
 			[=](const QString &path) { loadMessageFileDone(path); },
 			currentFileMessage());
 		if (!ready) {
+			prefetchMessageFiles();
 			return;
 		}
 		const auto thumbProgress = [=](FileProgress value) {
@@ -1439,6 +1943,7 @@ void ApiWrap::loadNextMessageFile() {
 			[=](const QString &path) { loadMessageThumbDone(path); },
 			currentFileMessage());
 		if (!thumbReady) {
+			prefetchMessageFiles();
 			return;
 		}
 	}
@@ -1450,6 +1955,7 @@ void ApiWrap::finishMessagesSlice() {
 	Expects(_chatProcess->slice.has_value());
 
 	auto slice = *base::take(_chatProcess->slice);
+	clearFinishedPrefetches();
 	if (!slice.list.empty()) {
 		_chatProcess->largestIdPlusOne = slice.list.back().id + 1;
 		if (!_chatProcess->handleSlice(std::move(slice))) {
@@ -1522,6 +2028,7 @@ void ApiWrap::finishMessages() {
 	Expects(!_chatProcess->slice.has_value());
 
 	const auto process = base::take(_chatProcess);
+	clearFinishedPrefetches();
 	process->done();
 }
 
@@ -1541,44 +2048,153 @@ bool ApiWrap::processFileLoad(
 		return true;
 	} else if (writePreloadedFile(file, origin)) {
 		return !file.relativePath.isEmpty();
+	} else if (const auto reason = ComputeSkipReason(
+			*_settings,
+			file,
+			message)
+		; reason != SkipReason::None) {
+		file.skipReason = reason;
+		return true;
+	} else if (writePreviousFile(file, origin)) {
+		return !file.relativePath.isEmpty();
 	}
 
-	using Type = MediaSettings::Type;
-	const auto type = message ? message->media.content.match(
-	[&](const Data::Document &data) {
-		if (data.isSticker) {
-			return Type::Sticker;
-		} else if (data.isVideoMessage) {
-			return Type::VideoMessage;
-		} else if (data.isVoiceMessage) {
-			return Type::VoiceMessage;
-		} else if (data.isAnimated) {
-			return Type::GIF;
-		} else if (data.isVideoFile) {
-			return Type::Video;
-		} else {
-			return Type::File;
+	const auto key = ComputeLocationKey(file.location);
+	auto &prefetches = _filePrefetches->map;
+	const auto i = prefetches.find(key);
+	if (i == end(prefetches)) {
+		loadFile(file, origin, std::move(progress), std::move(done));
+		return false;
+	} else if (i->second.finished) {
+		auto bytes = std::move(i->second.bytes);
+		prefetches.erase(i);
+		if (bytes.isEmpty()) {
+			loadFile(file, origin, std::move(progress), std::move(done));
+			return false;
 		}
-	}, [](const auto &data) {
-		return Type::Photo;
-	}) : Type(0);
-
-	const auto limit = _settings->media.sizeLimit;
-	if (message && Data::SkipMessageByDate(*message, *_settings)) {
-		file.skipReason = SkipReason::DateLimits;
-		return true;
-	} else if ((_settings->media.types & type) != type) {
-		file.skipReason = SkipReason::FileType;
-		return true;
-	} else if ((message ? message->file().size : file.size) >= limit) {
-		// Don't load thumbs for large files that we skip.
-		file.skipReason = SkipReason::FileSize;
-		return true;
+		file.content = std::move(bytes);
+		writePreloadedFile(file, origin);
+		file.content = QByteArray();
+		return !file.relativePath.isEmpty();
 	}
-	loadFile(file, origin, std::move(progress), std::move(done));
+
+	// The file is written as soon as its prefetch request finishes.
+	i->second.waiting = [
+		=,
+		file = file,
+		done = std::move(done)
+	](QByteArray &&bytes) mutable {
+		if (bytes.isEmpty()) {
+			loadFile(file, origin, std::move(progress), std::move(done));
+			return;
+		}
+		file.content = std::move(bytes);
+		writePreloadedFile(file, origin);
+		if (!file.relativePath.isEmpty()) {
+			done(file.relativePath);
+		}
+	};
 	return false;
 }
 
+void ApiWrap::prefetchMessageFiles() {
+	Expects(_chatProcess != nullptr);
+	Expects(_chatProcess->slice.has_value());
+
+	// Small files following the one being loaded are requested at once
+	// and kept in memory, so that not every file waits a round trip.
+	auto &process = *_chatProcess;
+	const auto &list = process.slice->list;
+	accumulate_max(process.prefetchIndex, process.fileIndex + 1);
+	while (process.prefetchIndex < list.size()
+		&& _filePrefetches->loading < kFilePrefetchCount) {
+		const auto &message = list[process.prefetchIndex++];
+		prefetchFile(message.file(), &message);
+		prefetchFile(message.thumb().file, &message);
+	}
+}
+
+void ApiWrap::prefetchFile(
+		const Data::File &file,
+		const Data::Message *message) {
+	Expects(_takeoutId.has_value());
+
+	using SkipReason = Data::File::SkipReason;
+
+	if (!file.relativePath.isEmpty()
+		|| file.skipReason != SkipReason::None
+		|| !file.location
+		|| !file.content.isEmpty()
+		|| file.size <= 0
+		|| file.size > kFilePrefetchMaxSize
+		|| ComputeSkipReason(*_settings, file, message) != SkipReason::None
+		|| _fileCache->find(file.location)
+		|| _fileCache->findPrevious(file.location, file.size)) {
+		return;
+	}
+	const auto key = ComputeLocationKey(file.location);
+	if (!_filePrefetches->map.try_emplace(key).second) {
+		return;
+	}
+	++_filePrefetches->loading;
+
+	const auto size = file.size;
+	const auto &location = file.location;
+	const auto finish = [=](QByteArray bytes) {
+		--_filePrefetches->loading;
+		auto &prefetches = _filePrefetches->map;
+		const auto i = prefetches.find(key);
+		if (i != end(prefetches)) {
+			if (auto waiting = base::take(i->second.waiting)) {
+				prefetches.erase(i);
+				waiting(std::move(bytes));
+			} else {
+				i->second.bytes = std::move(bytes);
+				i->second.finished = true;
+			}
+		}
+		if (_chatProcess && _chatProcess->slice) {
+			prefetchMessageFiles();
+		}
+	};
+	_mtp.request(MTPInvokeWithTakeout<MTPupload_GetFile>(
+		MTP_long(*_takeoutId),
+		MTPupload_GetFile(
+			MTP_flags(0),
+			location.data,
+			MTP_int(0),
+			MTP_int(kFileChunkSize))
+	)).done([=](const MTPupload_File &result) {
+		// Anything unusual is left for the regular loading to handle.
+		finish(result.match([&](const MTPDupload_file &data) {
+			if (_stats) {
+				_stats->incrementDownloadedBytes(data.vbytes().v.size());
+			}
+			return (data.vbytes().v.size() == size)
+				? data.vbytes().v
+				: QByteArray();
+		}, [](const MTPDupload_fileCdnRedirect &data) {
+			return QByteArray();
+		}));
+	}).fail([=](RPCError &&error) {
+		finish(QByteArray());
+	}).toDC(MTP::ShiftDcId(
+		location.dcId,
+		MTP::kExportMediaDcShift
+	)).send();
+}
+
+void ApiWrap::clearFinishedPrefetches() {
+	auto &prefetches = _filePrefetches->map;
+	for (auto i = begin(prefetches); i != end(prefetches);) {
+		if (i->second.finished) {
+			i = prefetches.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
 bool ApiWrap::writePreloadedFile(
 		Data::File &file,
 		const Data::FileOrigin &origin) {
@@ -1591,9 +2207,16 @@ bool ApiWrap::writePreloadedFile(
 		return true;
 	} else if (!file.content.isEmpty()) {
 		const auto process = prepareFileProcess(file, origin);
-		if (const auto result = process->file.writeBlock(file.content)) {
+		auto result = process->file.writeBlock(file.content);
+		if (result) {
+			result = process->file.flush();
+		}
+		if (result) {
 			file.relativePath = process->relativePath;
-			_fileCache->save(file.location, file.relativePath);
+			_fileCache->save(
+				file.location,
+				file.relativePath,
+				file.content.size());
 		} else {
 			ioError(result);
 		}
@@ -1602,6 +2225,34 @@ bool ApiWrap::writePreloadedFile(
 	return false;
 }
 
+bool ApiWrap::writePreviousFile(
+		Data::File &file,
+		const Data::FileOrigin &origin) {
+	Expects(_settings != nullptr);
+
+	const auto source = _fileCache->findPrevious(file.location, file.size);
+	if (!source) {
+		return false;
+	} else if (!QFile(*source).open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	const auto process = prepareFileProcess(file, origin);
+	const auto path = _settings->path + process->relativePath;
+	const auto result = Output::File::Copy(*source, path, _stats);
+	if (!result && result.path == *source) {
+		// The previous export was changed meanwhile, download the file.
+		LOG(("Export Error: Could not read '%1', loading it.").arg(*source));
+		QFile::remove(path);
+		return false;
+	} else if (!result) {
+		ioError(result);
+	} else {
+		file.relativePath = process->relativePath;
+		_fileCache->save(file.location, file.relativePath, file.size);
+	}
+	return true;
+}
+
 void ApiWrap::loadFile(
 		const Data::File &file,
 		const Data::FileOrigin &origin,
@@ -1687,6 +2338,9 @@ void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
 		return;
 	}
 	const auto &data = result.c_upload_file();
+	if (_stats) {
+		_stats->incrementDownloadedBytes(data.vbytes().v.size());
+	}
 	if (data.vbytes().v.isEmpty()) {
 		if (_fileProcess->size > 0) {
 			error("Empty bytes received in file part.");
@@ -1732,9 +2386,13 @@ void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
 		}
 	}
 
+	if (const auto result = _fileProcess->file.flush(); !result) {
+		ioError(result);
+		return;
+	}
 	auto process = base::take(_fileProcess);
 	const auto relativePath = process->relativePath;
-	_fileCache->save(process->location, relativePath);
+	_fileCache->save(process->location, relativePath, process->file.size());
 	process->done(process->relativePath);
 }
 
@@ -32,6 +32,7 @@ class Stats;
 } // namespace Output
 
 struct Settings;
+struct Environment;
 
 class ApiWrap {
 public:
@@ -46,6 +47,7 @@ public:
 	};
 	void startExport(
 		const Settings &settings,
+		const Environment &environment,
 		Output::Stats *stats,
 		FnMut<void(StartInfo)> done);
 
@@ -89,11 +91,13 @@ public:
 
 private:
 	class LoadedFileCache;
+	class RequestsPacer;
 	struct StartProcess;
 	struct ContactsProcess;
 	struct UserpicsProcess;
 	struct OtherDataProcess;
 	struct FileProcess;
+	struct FilePrefetches;
 	struct FileProgress;
 	struct ChatsProcess;
 	struct LeftChannelsProcess;
@@ -145,6 +149,8 @@ private:
 	void checkFirstMessageDate(int localSplitIndex, int count);
 	void messagesCountLoaded(int localSplitIndex, int count);
 	void requestMessagesSlice();
+	void requestNextMessagesSlice();
+	void messagesSliceLoaded(const MTPmessages_Messages &result);
 	void requestChatMessages(
 		int splitIndex,
 		int offsetId,
@@ -169,12 +175,20 @@ private:
 		Fn<bool(FileProgress)> progress,
 		FnMut<void(QString)> done,
 		Data::Message *message = nullptr);
+	void prefetchMessageFiles();
+	void prefetchFile(
+		const Data::File &file,
+		const Data::Message *message);
+	void clearFinishedPrefetches();
 	std::unique_ptr<FileProcess> prepareFileProcess(
 		const Data::File &file,
 		const Data::FileOrigin &origin) const;
 	bool writePreloadedFile(
 		Data::File &file,
 		const Data::FileOrigin &origin);
+	bool writePreviousFile(
+		Data::File &file,
+		const Data::FileOrigin &origin);
 	void loadFile(
 		const Data::File &file,
 		const Data::FileOrigin &origin,
@@ -206,6 +220,7 @@ private:
 	void ioError(const Output::Result &result);
 
 	MTP::ConcurrentSender _mtp;
+	std::unique_ptr<RequestsPacer> _pacer;
 	std::optional<uint64> _takeoutId;
 	Output::Stats *_stats = nullptr;
 
@@ -218,6 +233,7 @@ private:
 	std::unique_ptr<UserpicsProcess> _userpicsProcess;
 	std::unique_ptr<OtherDataProcess> _otherDataProcess;
 	std::unique_ptr<FileProcess> _fileProcess;
+	std::unique_ptr<FilePrefetches> _filePrefetches;
 	std::unique_ptr<LeftChannelsProcess> _leftChannelsProcess;
 	std::unique_ptr<DialogsProcess> _dialogsProcess;
 	std::unique_ptr<ChatProcess> _chatProcess;
@@ -239,6 +239,7 @@ void ControllerObject::startExport(
 
 	_settings.path = Output::NormalizePath(_settings);
 	_writer = Output::CreateWriter(_settings.format);
+	_stats.start();
 	fillExportSteps();
 	exportNext();
 }
@@ -314,6 +315,7 @@ void ControllerObject::exportNext() {
 		if (ioCatchError(_writer->finish())) {
 			return;
 		}
+		LOG(("Export Info: Finished, %1.").arg(_stats.description()));
 		_api.finishExport([=] {
 			setFinishedState();
 		});
@@ -336,9 +338,11 @@ void ControllerObject::exportNext() {
 
 void ControllerObject::initialize() {
 	setState(stateInitializing());
-	_api.startExport(_settings, &_stats, [=](ApiWrap::StartInfo info) {
-		initialized(info);
-	});
+	_api.startExport(
+		_settings,
+		_environment,
+		&_stats,
+		[=](ApiWrap::StartInfo info) { initialized(info); });
 }
 
 void ControllerObject::initialized(const ApiWrap::StartInfo &info) {
@@ -457,6 +461,7 @@ void ControllerObject::exportNextDialog() {
 				return false;
 			}
 			_messagesWritten += result.list.size();
+			_stats.incrementMessages(result.list.size());
 			setState(stateDialogs(DownloadProgress()));
 			return true;
 		}, [=] {
@@ -488,6 +493,7 @@ ProcessingState ControllerObject::prepareState(
 	result.substepsPassed = _substepsPassed;
 	result.substepsNow = substepsInStep(_lastProcessingStep);
 	result.substepsTotal = _substepsTotal;
+	result.elapsed = _stats.elapsed();
 	return result;
 }
 
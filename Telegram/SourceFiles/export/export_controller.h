@@ -72,6 +72,8 @@ struct ProcessingState {
 	QString bytesName;
 	int bytesLoaded = 0;
 	int bytesCount = 0;
+
+	crl::time elapsed = 0;
 };
 
 struct ApiErrorState {
@@ -111,6 +111,9 @@ struct Environment {
 	QByteArray aboutWebSessions;
 	QByteArray aboutChats;
 	QByteArray aboutLeftChats;
+
+	// Manifests of the files downloaded by exports, see ApiWrap.
+	QString filesManifestsPath;
 };
 
 } // namespace Export
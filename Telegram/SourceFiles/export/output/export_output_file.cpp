@@ -17,16 +17,33 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Export {
 namespace Output {
+namespace {
+
+constexpr auto kBufferSize = 1024 * 1024;
+
+} // namespace
 
 File::File(const QString &path, Stats *stats) : _path(path), _stats(stats) {
 }
 
+File::~File() {
+	(void)writeBuffer();
+}
+
 int File::size() const {
-	return _offset;
+	return _offset + _buffer.size();
 }
 
 bool File::empty() const {
-	return !_offset;
+	return !_offset && _buffer.isEmpty();
+}
+
+Result File::flush() {
+	const auto result = writeBuffer();
+	if (!result) {
+		_file.reset();
+	}
+	return result;
 }
 
 Result File::writeBlock(const QByteArray &block) {
@@ -48,15 +65,50 @@ Result File::writeBlockAttempt(const QByteArray &block) {
 	const auto size = block.size();
 	if (!size) {
 		return Result::Success();
+	} else if (_buffer.size() + size > kBufferSize) {
+		if (const auto result = writeBuffer(); !result) {
+			return result;
+		}
 	}
-	if (_file->write(block) == size && _file->flush()) {
+	if (size >= kBufferSize) {
+		if (!writeToDisk(block)) {
+			return error();
+		}
 		_offset += size;
-		if (_stats) {
-			_stats->incrementBytes(size);
+	} else {
+		if (_buffer.isEmpty()) {
+			_buffer.reserve(kBufferSize);
 		}
+		_buffer.append(block);
+	}
+	if (_stats) {
+		_stats->incrementBytes(size);
+	}
+	return Result::Success();
+}
+
+Result File::writeBuffer() {
+	if (_buffer.isEmpty()) {
 		return Result::Success();
+	} else if (const auto result = reopen(); !result) {
+		return result;
+	}
+	if (!writeToDisk(_buffer)) {
+		return error();
 	}
-	return error();
+	_offset += _buffer.size();
+	_buffer = QByteArray();
+	return Result::Success();
+}
+
+bool File::writeToDisk(const QByteArray &bytes) {
+	const auto started = crl::now();
+	const auto result = (_file->write(bytes) == bytes.size())
+		&& _file->flush();
+	if (_stats) {
+		_stats->addWriteTime(crl::now() - started);
+	}
+	return result;
 }
 
 Result File::reopen() {
@@ -128,11 +180,19 @@ Result File::Copy(
 	if (!f.exists() || !f.open(QIODevice::ReadOnly)) {
 		return Result(Result::Type::FatalError, source);
 	}
-	const auto bytes = f.readAll();
-	if (bytes.size() != f.size()) {
-		return Result(Result::Type::FatalError, source);
+	const auto size = f.size();
+	auto file = File(path, stats);
+	auto copied = qint64(0);
+	while (copied < size) {
+		const auto bytes = f.read(kBufferSize);
+		if (bytes.isEmpty()) {
+			return Result(Result::Type::FatalError, source);
+		} else if (const auto result = file.writeBlock(bytes); !result) {
+			return result;
+		}
+		copied += bytes.size();
 	}
-	return File(path, stats).writeBlock(bytes);
+	return file.flush();
 }
 
 } // namespace Output
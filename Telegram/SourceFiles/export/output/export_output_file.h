@@ -22,11 +22,17 @@ class Stats;
 class File {
 public:
 	File(const QString &path, Stats *stats);
+	File(const File &other) = delete;
+	File &operator=(const File &other) = delete;
+	~File();
 
 	[[nodiscard]] int size() const;
 	[[nodiscard]] bool empty() const;
 
+	// Small blocks are collected in memory and written to disk together,
+	// call flush() before the file contents are read by someone else.
 	[[nodiscard]] Result writeBlock(const QByteArray &block);
+	[[nodiscard]] Result flush();
 
 	[[nodiscard]] static QString PrepareRelativePath(
 		const QString &folder,
@@ -40,6 +46,8 @@ public:
 private:
 	[[nodiscard]] Result reopen();
 	[[nodiscard]] Result writeBlockAttempt(const QByteArray &block);
+	[[nodiscard]] Result writeBuffer();
+	[[nodiscard]] bool writeToDisk(const QByteArray &bytes);
 
 	[[nodiscard]] Result error() const;
 	[[nodiscard]] Result fatalError() const;
@@ -47,6 +55,7 @@ private:
 	QString _path;
 	int _offset = 0;
 	std::optional<QFile> _file;
+	QByteArray _buffer;
 
 	Stats *_stats = nullptr;
 	bool _inStats = false;
@@ -91,6 +91,25 @@ auto CalculateThumbSize(
 	};
 }
 
+[[nodiscard]] const char *FindEscaped(const char *from, const char *till) {
+	// Bytes that SerializeString may need to replace, the rest are copied
+	// in whole runs instead of one by one.
+	static const auto Table = [] {
+		auto result = std::array<bool, 256>{ { false } };
+		for (auto ch = 0; ch != 32; ++ch) {
+			result[ch] = true;
+		}
+		for (const auto ch : { '"', '&', '\'', '<', '>', char(0xE2) }) {
+			result[uchar(ch)] = true;
+		}
+		return result;
+	}();
+	while (from != till && !Table[uchar(*from)]) {
+		++from;
+	}
+	return from;
+}
+
 QByteArray SerializeString(const QByteArray &value) {
 	const auto size = value.size();
 	const auto begin = value.data();
@@ -99,6 +118,13 @@ QByteArray SerializeString(const QByteArray &value) {
 	auto result = QByteArray();
 	result.reserve(size * 6);
 	for (auto p = begin; p != end; ++p) {
+		if (const auto till = FindEscaped(p, end); till != p) {
+			result.append(p, till - p);
+			if (till == end) {
+				break;
+			}
+			p = till;
+		}
 		const auto ch = *p;
 		if (ch == '\n') {
 			result.append("<br>", 4);
@@ -1778,7 +1804,10 @@ Result HtmlWriter::Wrap::close() {
 		while (!_context.empty()) {
 			block.append(_context.popTag());
 		}
-		return _file.writeBlock(block);
+		if (const auto result = _file.writeBlock(block); !result) {
+			return result;
+		}
+		return _file.flush();
 	}
 	return Result::Success();
 }
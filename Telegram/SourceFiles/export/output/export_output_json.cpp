@@ -23,6 +23,25 @@ namespace {
 
 using Context = details::JsonContext;
 
+[[nodiscard]] const char *FindEscaped(const char *from, const char *till) {
+	// Bytes that SerializeString may need to replace, the rest are copied
+	// in whole runs instead of one by one.
+	static const auto Table = [] {
+		auto result = std::array<bool, 256>{ { false } };
+		for (auto ch = 0; ch != 32; ++ch) {
+			result[ch] = true;
+		}
+		for (const auto ch : { '"', '\\', char(0xE2) }) {
+			result[uchar(ch)] = true;
+		}
+		return result;
+	}();
+	while (from != till && !Table[uchar(*from)]) {
+		++from;
+	}
+	return from;
+}
+
 QByteArray SerializeString(const QByteArray &value) {
 	const auto size = value.size();
 	const auto begin = value.data();
@@ -32,6 +51,13 @@ QByteArray SerializeString(const QByteArray &value) {
 	result.reserve(2 + size * 4);
 	result.append('"');
 	for (auto p = begin; p != end; ++p) {
+		if (const auto till = FindEscaped(p, end); till != p) {
+			result.append(p, till - p);
+			if (till == end) {
+				break;
+			}
+			p = till;
+		}
 		const auto ch = *p;
 		if (ch == '\n') {
 			result.append("\\n", 2);
@@ -1100,7 +1126,10 @@ Result JsonWriter::finish() {
 
 	auto block = popNesting();
 	Assert(_context.nesting.empty());
-	return _output->writeBlock(block);
+	if (const auto result = _output->writeBlock(block); !result) {
+		return result;
+	}
+	return _output->flush();
 }
 
 QString JsonWriter::mainFilePath() {
@@ -12,7 +12,15 @@ namespace Output {
 
 Stats::Stats(const Stats &other)
 : _files(other._files.load())
-, _bytes(other._bytes.load()) {
+, _bytes(other._bytes.load())
+, _messages(other._messages.load())
+, _downloaded(other._downloaded.load())
+, _writeTime(other._writeTime.load())
+, _started(other._started.load()) {
+}
+
+void Stats::start() {
+	_started = crl::now();
 }
 
 void Stats::incrementFiles() {
@@ -23,6 +31,18 @@ void Stats::incrementBytes(int count) {
 	_bytes += count;
 }
 
+void Stats::incrementMessages(int count) {
+	_messages += count;
+}
+
+void Stats::incrementDownloadedBytes(int count) {
+	_downloaded += count;
+}
+
+void Stats::addWriteTime(crl::time time) {
+	_writeTime += time;
+}
+
 int Stats::filesCount() const {
 	return _files;
 }
@@ -31,5 +51,36 @@ int64 Stats::bytesCount() const {
 	return _bytes;
 }
 
+int Stats::messagesCount() const {
+	return _messages;
+}
+
+int64 Stats::downloadedBytesCount() const {
+	return _downloaded;
+}
+
+crl::time Stats::writeTime() const {
+	return _writeTime;
+}
+
+crl::time Stats::elapsed() const {
+	const auto started = _started.load();
+	return started ? (crl::now() - started) : 0;
+}
+
+QString Stats::description() const {
+	const auto time = std::max(elapsed(), crl::time(1));
+	const auto perSecond = [&](int64 value) {
+		return int(value * 1000 / time);
+	};
+	return QString("%1s, %2 messages/s, download %3 KB/s, write %4 KB/s, "
+		"disk %5%"
+	).arg(time / 1000
+	).arg(perSecond(messagesCount())
+	).arg(perSecond(downloadedBytesCount()) / 1024
+	).arg(perSecond(bytesCount()) / 1024
+	).arg(writeTime() * 100 / time);
+}
+
 } // namespace Output
 } // namespace Export
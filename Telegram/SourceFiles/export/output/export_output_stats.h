@@ -17,15 +17,32 @@ public:
 	Stats() = default;
 	Stats(const Stats &other);
 
+	void start();
+
 	void incrementFiles();
 	void incrementBytes(int count);
+	void incrementMessages(int count);
+	void incrementDownloadedBytes(int count);
+	void addWriteTime(crl::time time);
 
 	int filesCount() const;
 	int64 bytesCount() const;
+	int messagesCount() const;
+	int64 downloadedBytesCount() const;
+	crl::time writeTime() const;
+	crl::time elapsed() const;
+
+	// Written bytes, messages and downloaded bytes per second on average
+	// with the share of time spent writing to disk, for the log.
+	QString description() const;
 
 private:
-	std::atomic<int> _files;
-	std::atomic<int64> _bytes;
+	std::atomic<int> _files = { 0 };
+	std::atomic<int64> _bytes = { 0 };
+	std::atomic<int> _messages = { 0 };
+	std::atomic<int64> _downloaded = { 0 };
+	std::atomic<crl::time> _writeTime = { 0 };
+	std::atomic<crl::time> _started = { 0 };
 
 };
 
@@ -12,6 +12,28 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Export {
 namespace View {
+namespace {
+
+constexpr auto kEtaMinElapsed = 10 * crl::time(1000);
+constexpr auto kEtaMinProgress = 0.01;
+
+// The average speed of the whole export so far is used, so the estimate
+// doesn't jump between small and large chats or files.
+QString ComputeEta(crl::time elapsed, float64 progress) {
+	if (elapsed < kEtaMinElapsed
+		|| progress < kEtaMinProgress
+		|| progress >= 1.) {
+		return QString();
+	}
+	const auto left = int64(elapsed * (1. - progress) / progress) / 1000;
+	const auto rounded = (left > 60) ? (left - left % 60 + 60) : left;
+	return tr::lng_export_state_eta(
+		tr::now,
+		lt_duration,
+		formatDurationText(rounded));
+}
+
+} // namespace
 
 const QString Content::kDoneId = "done";
 
@@ -51,7 +73,17 @@ Content ContentFromState(const ProcessingState &state) {
 			&& !state.entityIndex)
 			? addPart(state.itemIndex, state.itemCount)
 			: addPart(state.entityIndex, state.entityCount);
-		push("main", label, info, doneProgress + addProgress);
+		const auto progress = doneProgress + addProgress;
+		const auto eta = ComputeEta(state.elapsed, progress);
+		push(
+			"main",
+			label,
+			(eta.isEmpty()
+				? info
+				: info.isEmpty()
+				? eta
+				: (info + ", " + eta)),
+			progress);
 	};
 	const auto pushBytes = [&](const QString &id, const QString &label) {
 		if (!state.bytesCount) {
@@ -82,6 +82,7 @@ Environment PrepareEnvironment() {
 	result.aboutWebSessions = tr::lng_export_about_web_sessions(tr::now).toUtf8();
 	result.aboutChats = tr::lng_export_about_chats(tr::now).toUtf8();
 	result.aboutLeftChats = tr::lng_export_about_left_chats(tr::now).toUtf8();
+	result.filesManifestsPath = cWorkingDir() + qsl("tdata/export_files/");
 	return result;
 }
 
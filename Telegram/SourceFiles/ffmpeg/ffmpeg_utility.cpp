@@ -8,16 +8,22 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ffmpeg/ffmpeg_utility.h"
 
 #include "base/algorithm.h"
+#include "base/flat_map.h"
 #include "logs.h"
 
 #include <QImage>
+#include <QMutex>
 
 #ifdef LIB_FFMPEG_USE_QT_PRIVATE_API
 #include <private/qdrawhelper_p.h>
 #endif // LIB_FFMPEG_USE_QT_PRIVATE_API
 
+#include <atomic>
+
 extern "C" {
 #include <libavutil/opt.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/pixdesc.h>
 } // extern "C"
 
 namespace FFmpeg {
@@ -31,9 +37,164 @@ constexpr auto kAvioBlockSize = 4096;
 constexpr auto kTimeUnknown = std::numeric_limits<crl::time>::min();
 constexpr auto kDurationMax = crl::time(std::numeric_limits<int>::max());
 
+std::atomic<bool> HardwareDecodingEnabled = false;
+std::atomic<bool> HardwareDecodingFailed = false;
+std::atomic<const char*> ActiveHardwareDecoder = nullptr;
+
+[[nodiscard]] std::vector<AVHWDeviceType> HardwareDeviceTypes() {
+#ifdef Q_OS_WIN
+	return { AV_HWDEVICE_TYPE_D3D11VA, AV_HWDEVICE_TYPE_DXVA2 };
+#elif defined Q_OS_MAC // Q_OS_WIN
+	return { AV_HWDEVICE_TYPE_VIDEOTOOLBOX };
+#else // Q_OS_WIN || Q_OS_MAC
+	return { AV_HWDEVICE_TYPE_VAAPI, AV_HWDEVICE_TYPE_VDPAU };
+#endif // Q_OS_WIN || Q_OS_MAC
+}
+
+enum AVPixelFormat GetHardwareFormat(
+		AVCodecContext *context,
+		const enum AVPixelFormat *formats) {
+	const auto wanted = AVPixelFormat(
+		reinterpret_cast<intptr_t>(context->opaque));
+	for (auto i = formats; *i != AV_PIX_FMT_NONE; ++i) {
+		if (*i == wanted) {
+			return *i;
+		}
+	}
+
+	// Hardware format is not available, fallback to the software one.
+	for (auto i = formats; *i != AV_PIX_FMT_NONE; ++i) {
+		const auto descriptor = av_pix_fmt_desc_get(*i);
+		if (descriptor && !(descriptor->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+			return *i;
+		}
+	}
+	return AV_PIX_FMT_NONE;
+}
+
+bool InitHardwareDecoding(
+		not_null<AVCodecContext*> context,
+		not_null<const AVCodec*> codec) {
+	for (const auto type : HardwareDeviceTypes()) {
+		for (auto i = 0;; ++i) {
+			const auto config = avcodec_get_hw_config(codec, i);
+			if (!config) {
+				break;
+			} else if (!(config->methods
+					& AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX)
+				|| config->device_type != type) {
+				continue;
+			}
+			auto device = (AVBufferRef*)nullptr;
+			const auto error = AvErrorWrap(
+				av_hwdevice_ctx_create(&device, type, nullptr, nullptr, 0));
+			if (error) {
+				LogError(qstr("av_hwdevice_ctx_create"), error);
+				break;
+			}
+			context->hw_device_ctx = device;
+			context->opaque = reinterpret_cast<void*>(
+				intptr_t(config->pix_fmt));
+			context->get_format = GetHardwareFormat;
+			ActiveHardwareDecoder = av_hwdevice_get_type_name(type);
+			return true;
+		}
+	}
+	return false;
+}
+
+constexpr auto kFramePoolBucketMax = 4;
+constexpr auto kFramePoolBytesMax = int64_t(96 * 1024 * 1024);
+
+// Buffers of released frame images, bucketed by allocation size.
+// All frame storage has the same format, so the size is the only key.
+// When the pool is full the least recently used sizes are freed first.
+struct FramePoolBucket {
+	std::vector<uchar*> buffers;
+	uint64_t lastUsed = 0;
+};
+
+struct FramePool {
+	QMutex mutex;
+	base::flat_map<int, FramePoolBucket> buckets;
+	uint64_t usedCounter = 0;
+	bool retaining = true;
+	FrameStoragePoolStats stats;
+};
+
+[[nodiscard]] FramePool &Pool() {
+	// Never destroyed, frame images may be released during shutdown.
+	static const auto result = new FramePool();
+	return *result;
+}
+
+struct PooledBuffer {
+	uchar *data = nullptr;
+	int size = 0;
+};
+
+[[nodiscard]] uchar *AcquireBuffer(int size) {
+	auto &pool = Pool();
+	QMutexLocker lock(&pool.mutex);
+	pool.retaining = true;
+	const auto i = pool.buckets.find(size);
+	if (i != end(pool.buckets) && !i->second.buffers.empty()) {
+		const auto result = i->second.buffers.back();
+		i->second.buffers.pop_back();
+		i->second.lastUsed = ++pool.usedCounter;
+		--pool.stats.pooledBuffers;
+		pool.stats.pooledBytes -= size;
+		++pool.stats.reused;
+		return result;
+	}
+	++pool.stats.allocated;
+	return nullptr;
+}
+
+// Must be called with the pool mutex locked.
+void EvictLeastRecentlyUsed(FramePool &pool) {
+	const auto i = std::min_element(
+		begin(pool.buckets),
+		end(pool.buckets),
+		[](const auto &a, const auto &b) {
+			return (a.second.lastUsed < b.second.lastUsed);
+		});
+	Assert(i != end(pool.buckets));
+
+	const auto size = i->first;
+	for (const auto buffer : i->second.buffers) {
+		delete[] buffer;
+		--pool.stats.pooledBuffers;
+		pool.stats.pooledBytes -= size;
+	}
+	pool.buckets.erase(i);
+}
+
 void AlignedImageBufferCleanupHandler(void* data) {
-	const auto buffer = static_cast<uchar*>(data);
-	delete[] buffer;
+	const auto buffer = static_cast<PooledBuffer*>(data);
+	auto &pool = Pool();
+	{
+		QMutexLocker lock(&pool.mutex);
+		++pool.stats.released;
+		auto &bucket = pool.buckets[buffer->size];
+		bucket.lastUsed = ++pool.usedCounter;
+		if (pool.retaining
+			&& bucket.buffers.size() < kFramePoolBucketMax
+			&& buffer->size <= kFramePoolBytesMax) {
+			bucket.buffers.push_back(buffer->data);
+			++pool.stats.pooledBuffers;
+			pool.stats.pooledBytes += buffer->size;
+			delete buffer;
+			while (pool.stats.pooledBytes > kFramePoolBytesMax) {
+				EvictLeastRecentlyUsed(pool);
+			}
+			return;
+		} else if (bucket.buffers.empty()) {
+			pool.buckets.erase(buffer->size);
+		}
+	}
+	delete[] buffer->data;
+	delete buffer;
 }
 
 [[nodiscard]] bool IsValidAspectRatio(AVRational aspect) {
@@ -160,7 +321,12 @@ void FormatDeleter::operator()(AVFormatContext *value) {
 	}
 }
 
-CodecPointer MakeCodecPointer(not_null<AVStream*> stream) {
+namespace {
+
+CodecPointer OpenCodec(
+		not_null<const AVCodecParameters*> parameters,
+		AVRational timeBase,
+		bool hardware) {
 	auto error = AvErrorWrap();
 
 	auto result = CodecPointer(avcodec_alloc_context3(nullptr));
@@ -169,25 +335,109 @@ CodecPointer MakeCodecPointer(not_null<AVStream*> stream) {
 		LogError(qstr("avcodec_alloc_context3"));
 		return {};
 	}
-	error = avcodec_parameters_to_context(context, stream->codecpar);
+	error = avcodec_parameters_to_context(context, parameters);
 	if (error) {
 		LogError(qstr("avcodec_parameters_to_context"), error);
 		return {};
 	}
-	av_codec_set_pkt_timebase(context, stream->time_base);
+	av_codec_set_pkt_timebase(context, timeBase);
 	av_opt_set_int(context, "refcounted_frames", 1, 0);
 
 	const auto codec = avcodec_find_decoder(context->codec_id);
 	if (!codec) {
 		LogError(qstr("avcodec_find_decoder"), context->codec_id);
 		return {};
-	} else if ((error = avcodec_open2(context, codec, nullptr))) {
+	}
+	const auto hardwareUsed = hardware
+		&& HardwareDecodingEnabled
+		&& !HardwareDecodingFailed
+		&& InitHardwareDecoding(context, codec);
+	if ((error = avcodec_open2(context, codec, nullptr))) {
 		LogError(qstr("avcodec_open2"), error);
 		return {};
+	} else if (hardwareUsed) {
+		DEBUG_LOG(("Streaming Info: Using hardware decoder '%1'."
+			).arg(ActiveHardwareDecoder.load()));
 	}
 	return result;
 }
 
+} // namespace
+
+CodecPointer MakeCodecPointer(not_null<AVStream*> stream, bool hardware) {
+	return OpenCodec(stream->codecpar, stream->time_base, hardware);
+}
+
+CodecPointer MakeSoftwareCodecPointer(not_null<AVCodecContext*> hardware) {
+	const auto parameters = avcodec_parameters_alloc();
+	if (!parameters) {
+		LogError(qstr("avcodec_parameters_alloc"));
+		return {};
+	}
+	const auto guard = gsl::finally([&] {
+		auto value = parameters;
+		avcodec_parameters_free(&value);
+	});
+	const auto error = AvErrorWrap(
+		avcodec_parameters_from_context(parameters, hardware));
+	if (error) {
+		LogError(qstr("avcodec_parameters_from_context"), error);
+		return {};
+	}
+
+	// The context holds the hardware pixel format, let the decoder choose.
+	parameters->format = AV_PIX_FMT_NONE;
+	return OpenCodec(
+		parameters,
+		av_codec_get_pkt_timebase(hardware),
+		false);
+}
+
+void SetHardwareDecoding(bool enabled) {
+	HardwareDecodingEnabled = enabled;
+	HardwareDecodingFailed = false;
+}
+
+bool HardwareDecoding() {
+	return HardwareDecodingEnabled;
+}
+
+QString HardwareDecodingStatus() {
+	const auto active = ActiveHardwareDecoder.load();
+	return !HardwareDecodingEnabled
+		? qsl("Hardware decoding is disabled.")
+		: HardwareDecodingFailed
+		? qsl("Hardware decoding failed, using software decoding.")
+		: active
+		? qsl("Hardware decoder: %1.").arg(active)
+		: qsl("Hardware decoding is enabled, no decoder used yet.");
+}
+
+AvErrorWrap TransferHardwareFrame(
+		FramePointer &frame,
+		FramePointer &storage) {
+	if (!frame->hw_frames_ctx) {
+		return AvErrorWrap();
+	}
+	if (!storage) {
+		storage = MakeFramePointer();
+	}
+	auto error = AvErrorWrap(
+		av_hwframe_transfer_data(storage.get(), frame.get(), 0));
+	if (!error) {
+		error = av_frame_copy_props(storage.get(), frame.get());
+	}
+	if (error) {
+		LogError(qstr("av_hwframe_transfer_data"), error);
+		ClearFrameMemory(storage.get());
+		HardwareDecodingFailed = true;
+		return error;
+	}
+	av_frame_unref(frame.get());
+	std::swap(frame, storage);
+	return AvErrorWrap();
+}
+
 void CodecDeleter::operator()(AVCodecContext *value) {
 	if (value) {
 		avcodec_free_context(&value);
@@ -237,6 +487,9 @@ SwscalePointer MakeSwscalePointer(
 		return SwscalePointer();
 	}
 
+	// When only the pixel format changes there is nothing to interpolate,
+	// so let swscale pick its unscaled (SIMD) conversion path.
+	const auto flags = (srcSize == dstSize) ? SWS_POINT : SWS_BICUBIC;
 	const auto result = sws_getCachedContext(
 		existing ? existing->release() : nullptr,
 		srcSize.width(),
@@ -245,7 +498,7 @@ SwscalePointer MakeSwscalePointer(
 		dstSize.width(),
 		dstSize.height(),
 		AVPixelFormat(dstFormat),
-		0,
+		flags,
 		nullptr,
 		nullptr,
 		nullptr);
@@ -376,8 +629,11 @@ QImage CreateFrameStorage(QSize size) {
 		? (widthAlign - (width % widthAlign))
 		: 0);
 	const auto perLine = neededWidth * kPixelBytesSize;
-	const auto buffer = new uchar[perLine * height + kAlignImageBy];
-	const auto cleanupData = static_cast<void *>(buffer);
+	const auto bytes = perLine * height + kAlignImageBy;
+	const auto reused = AcquireBuffer(bytes);
+	const auto buffer = reused ? reused : new uchar[bytes];
+	const auto cleanupData = static_cast<void*>(
+		new PooledBuffer{ buffer, bytes });
 	const auto address = reinterpret_cast<uintptr_t>(buffer);
 	const auto alignedBuffer = buffer + ((address % kAlignImageBy)
 		? (kAlignImageBy - (address % kAlignImageBy))
@@ -392,6 +648,23 @@ QImage CreateFrameStorage(QSize size) {
 		cleanupData);
 }
 
+void FrameStoragePoolTrim() {
+	auto &pool = Pool();
+	QMutexLocker lock(&pool.mutex);
+	while (!pool.buckets.empty()) {
+		EvictLeastRecentlyUsed(pool);
+	}
+
+	// Frames released after that are freed until the next allocation.
+	pool.retaining = false;
+}
+
+FrameStoragePoolStats FrameStoragePoolStatsGet() {
+	auto &pool = Pool();
+	QMutexLocker lock(&pool.mutex);
+	return pool.stats;
+}
+
 void UnPremultiply(QImage &to, const QImage &from) {
 	// This creates QImage::Format_ARGB32_Premultiplied, but we use it
 	// as an image in QImage::Format_ARGB32 format.
@@ -136,7 +136,19 @@ struct CodecDeleter {
 	void operator()(AVCodecContext *value);
 };
 using CodecPointer = std::unique_ptr<AVCodecContext, CodecDeleter>;
-[[nodiscard]] CodecPointer MakeCodecPointer(not_null<AVStream*> stream);
+[[nodiscard]] CodecPointer MakeCodecPointer(
+	not_null<AVStream*> stream,
+	bool hardware = false);
+
+// Opens the same codec without hardware decoding, for a failed transfer.
+[[nodiscard]] CodecPointer MakeSoftwareCodecPointer(
+	not_null<AVCodecContext*> hardware);
+
+// Hardware decoding is tried only for codecs opened with hardware = true,
+// if it is unavailable the decoder silently falls back to software.
+void SetHardwareDecoding(bool enabled);
+[[nodiscard]] bool HardwareDecoding();
+[[nodiscard]] QString HardwareDecodingStatus();
 
 struct FrameDeleter {
 	void operator()(AVFrame *value);
@@ -146,6 +158,11 @@ using FramePointer = std::unique_ptr<AVFrame, FrameDeleter>;
 [[nodiscard]] bool FrameHasData(AVFrame *frame);
 void ClearFrameMemory(AVFrame *frame);
 
+// Moves a decoded hardware frame to system memory, swapping with storage.
+[[nodiscard]] AvErrorWrap TransferHardwareFrame(
+	FramePointer &frame,
+	FramePointer &storage);
+
 struct SwscaleDeleter {
 	QSize srcSize;
 	int srcFormat = int(AV_PIX_FMT_NONE);
@@ -190,6 +207,19 @@ void LogError(QLatin1String method, FFmpeg::AvErrorWrap error);
 [[nodiscard]] bool GoodStorageForFrame(const QImage &storage, QSize size);
 [[nodiscard]] QImage CreateFrameStorage(QSize size);
 
+// Frame storage buffers are recycled through a process-wide pool.
+struct FrameStoragePoolStats {
+	int64_t allocated = 0;
+	int64_t reused = 0;
+	int64_t released = 0;
+	int64_t pooledBuffers = 0;
+	int64_t pooledBytes = 0;
+};
+[[nodiscard]] FrameStoragePoolStats FrameStoragePoolStatsGet();
+
+// Frees the pooled buffers, for example when nothing is played anymore.
+void FrameStoragePoolTrim();
+
 void UnPremultiply(QImage &to, const QImage &from);
 void PremultiplyInplace(QImage &image);
 
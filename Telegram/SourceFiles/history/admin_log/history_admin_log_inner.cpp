@@ -60,6 +60,54 @@ constexpr auto kScrollDateHideTimeout = 1000;
 constexpr auto kEventsFirstPage = 20;
 constexpr auto kEventsPerPage = 50;
 
+// Older events are requested while this many screens are left to scroll,
+// so the next page usually arrives before the user gets to the edge.
+constexpr auto kPrefetchHeightsCount = 6;
+
+using FilterFlag = MTPDchannelAdminLogEventsFilter::Flag;
+using FilterFlags = MTPDchannelAdminLogEventsFilter::Flags;
+
+// Filter flags that could have matched the event. The filter box always
+// toggles these groups together, so a filter either has all of them or
+// none of them. Zero means we don't know which flag matches the event.
+FilterFlags EventFilterFlags(const MTPChannelAdminLogEventAction &action) {
+	const auto restrictions = FilterFlag::f_ban
+		| FilterFlag::f_unban
+		| FilterFlag::f_kick
+		| FilterFlag::f_unkick;
+	const auto info = FilterFlag::f_info | FilterFlag::f_settings;
+	switch (action.type()) {
+	case mtpc_channelAdminLogEventActionChangeTitle:
+	case mtpc_channelAdminLogEventActionChangeAbout:
+	case mtpc_channelAdminLogEventActionChangeUsername:
+	case mtpc_channelAdminLogEventActionChangePhoto:
+	case mtpc_channelAdminLogEventActionToggleInvites:
+	case mtpc_channelAdminLogEventActionToggleSignatures:
+	case mtpc_channelAdminLogEventActionChangeStickerSet:
+	case mtpc_channelAdminLogEventActionTogglePreHistoryHidden:
+	case mtpc_channelAdminLogEventActionDefaultBannedRights:
+	case mtpc_channelAdminLogEventActionChangeLinkedChat:
+	case mtpc_channelAdminLogEventActionChangeLocation:
+	case mtpc_channelAdminLogEventActionToggleSlowMode: return info;
+	case mtpc_channelAdminLogEventActionUpdatePinned:
+		return FilterFlag::f_pinned;
+	case mtpc_channelAdminLogEventActionEditMessage:
+		return FilterFlag::f_edit;
+	case mtpc_channelAdminLogEventActionDeleteMessage:
+		return FilterFlag::f_delete;
+	case mtpc_channelAdminLogEventActionParticipantJoin:
+	case mtpc_channelAdminLogEventActionParticipantInvite:
+		return FilterFlag::f_join | FilterFlag::f_invite;
+	case mtpc_channelAdminLogEventActionParticipantLeave:
+		return FilterFlag::f_leave;
+	case mtpc_channelAdminLogEventActionParticipantToggleBan:
+		return restrictions;
+	case mtpc_channelAdminLogEventActionParticipantToggleAdmin:
+		return FilterFlag::f_promote | FilterFlag::f_demote;
+	}
+	return 0;
+}
+
 } // namespace
 
 template <InnerWidget::EnumItemsDirection direction, typename Method>
@@ -387,16 +435,91 @@ void InnerWidget::checkPreloadMore() {
 	if (_visibleTop + PreloadHeightsCount * (_visibleBottom - _visibleTop) > height()) {
 		preloadMore(Direction::Down);
 	}
-	if (_visibleTop < PreloadHeightsCount * (_visibleBottom - _visibleTop)) {
+	if (_visibleTop < kPrefetchHeightsCount * (_visibleBottom - _visibleTop)) {
 		preloadMore(Direction::Up);
 	}
 }
 
 void InnerWidget::applyFilter(FilterValue &&value) {
 	if (_filter != value) {
+		const auto filterLoadedItems = canFilterLoaded(value);
 		_filter = value;
-		clearAndRequestLog();
+		if (filterLoadedItems) {
+			filterLoaded();
+		} else {
+			clearAndRequestLog();
+		}
+	}
+}
+
+bool InnerWidget::canFilterLoaded(const FilterValue &value) const {
+	if (_filterChanged || _items.empty()) {
+		return false;
 	}
+	const auto narrowerFlags = !_filter.flags
+		|| (value.flags && !(value.flags & ~_filter.flags));
+	const auto narrowerUsers = _filter.allUsers
+		|| (!value.allUsers && ranges::all_of(value.admins, [&](
+				not_null<UserData*> user) {
+			return ranges::contains(_filter.admins, user);
+		}));
+	if (!narrowerFlags || !narrowerUsers) {
+		return false;
+	}
+	return ranges::all_of(_items, [&](const OwnedItem &item) {
+		const auto i = _itemsFilterInfo.find(item->data());
+		if (i == end(_itemsFilterInfo) || !i->second.flags) {
+			return false;
+		}
+		const auto matched = (i->second.flags & value.flags);
+		return !value.flags
+			|| !matched
+			|| (matched == i->second.flags);
+	});
+}
+
+void InnerWidget::filterLoaded() {
+	_api.request(base::take(_preloadUpRequestId)).cancel();
+	_api.request(base::take(_preloadDownRequestId)).cancel();
+
+	const auto matches = [&](const EventFilterInfo &info) {
+		const auto byFlags = !_filter.flags || (info.flags & _filter.flags);
+		const auto byUser = _filter.allUsers
+			|| ranges::any_of(_filter.admins, [&](not_null<UserData*> user) {
+				return (user->bareId() == info.userId);
+			});
+		return byFlags && byUser;
+	};
+	const auto removed = ranges::remove_if(_items, [&](
+			const OwnedItem &item) {
+		const auto data = item->data();
+		const auto i = _itemsFilterInfo.find(data);
+		if (i == end(_itemsFilterInfo)) {
+			_itemsByData.erase(data);
+			return true;
+		} else if (matches(i->second)) {
+			return false;
+		}
+		_itemsFilterInfo.erase(i);
+		_itemsByData.erase(data);
+		return true;
+	});
+	if (removed != end(_items)) {
+		_visibleTopItem = nullptr;
+		_visibleTopFromItem = 0;
+		_scrollDateLastItem = nullptr;
+		_scrollDateLastItemTop = 0;
+		_mouseActionItem = nullptr;
+		_selectedItem = nullptr;
+		_selectedText = TextSelection();
+		_items.erase(removed, end(_items));
+	}
+
+	// The loaded events ids stay in _eventIds, further pages are requested
+	// with the new filter starting where the previous filter stopped.
+	updateEmptyText();
+	itemsAdded(Direction::Down, _items.size());
+	update();
 }
 
 void InnerWidget::applySearch(const QString &query) {
@@ -595,6 +718,7 @@ void InnerWidget::saveState(not_null<SectionMemento*> memento) {
 			_upLoaded,
 			_downLoaded);
 		base::take(_itemsByData);
+		base::take(_itemsFilterInfo);
 	}
 	_upLoaded = _downLoaded = true; // Don't load or handle anything anymore.
 }
@@ -697,9 +821,14 @@ void InnerWidget::addEvents(Direction direction, const QVector<MTPChannelAdminLo
 			}
 
 			auto count = 0;
+			const auto info = EventFilterInfo{
+				EventFilterFlags(data.vaction()),
+				data.vuser_id().v
+			};
 			const auto addOne = [&](OwnedItem item) {
 				_eventIds.emplace(id);
 				_itemsByData.emplace(item->data(), item.get());
+				_itemsFilterInfo.emplace(item->data(), info);
 				addToItems.push_back(std::move(item));
 				++count;
 			};
@@ -910,6 +1039,7 @@ void InnerWidget::clearAfterFilterChange() {
 	_items.clear();
 	_eventIds.clear();
 	_itemsByData.clear();
+	_itemsFilterInfo.clear();
 	updateEmptyText();
 	updateSize();
 }
@@ -184,6 +184,8 @@ private:
 	void paintEmpty(Painter &p);
 	void clearAfterFilterChange();
 	void clearAndRequestLog();
+	[[nodiscard]] bool canFilterLoaded(const FilterValue &value) const;
+	void filterLoaded();
 	void addEvents(Direction direction, const QVector<MTPChannelAdminLogEvent> &events);
 	Element *viewForItem(const HistoryItem *item);
 
@@ -226,6 +228,14 @@ private:
 	std::vector<OwnedItem> _items;
 	std::set<uint64> _eventIds;
 	std::map<not_null<const HistoryItem*>, not_null<Element*>> _itemsByData;
+
+	// Event types and authors of loaded items, to apply a narrower filter
+	// without requesting the events again.
+	struct EventFilterInfo {
+		MTPDchannelAdminLogEventsFilter::Flags flags = 0;
+		UserId userId = 0;
+	};
+	base::flat_map<not_null<const HistoryItem*>, EventFilterInfo> _itemsFilterInfo;
 	base::flat_set<FullMsgId> _animatedStickersPlayed;
 	int _itemsTop = 0;
 	int _itemsWidth = 0;
@@ -60,6 +60,7 @@ constexpr auto kStatusShowClientsideChooseContact = 6000;
 constexpr auto kStatusShowClientsidePlayGame = 10000;
 constexpr auto kSetMyActionForMs = 10000;
 constexpr auto kNewBlockEachMessage = 50;
+constexpr auto kViewsBudget = 1000;
 constexpr auto kSkipCloudDraftsFor = TimeId(3);
 
 } // namespace
@@ -107,13 +108,19 @@ HistoryItem *History::currentNotification() {
 		: _notifications.front().get();
 }
 
+HistoryItem *History::nextNotification() {
+	return (_notifications.size() > 1)
+		? _notifications[1].get()
+		: nullptr;
+}
+
 bool History::hasNotification() const {
 	return !empty(_notifications);
 }
 
 void History::skipNotification() {
 	if (!empty(_notifications)) {
-		_notifications.pop_front();
+		_notifications.erase(begin(_notifications));
 	}
 }
 
@@ -468,7 +475,14 @@ bool History::paintSendAction(
 	return false;
 }
 
-bool History::updateSendActionNeedsAnimating(crl::time now, bool force) {
+bool History::hasSendActionAnimation() const {
+	return bool(_sendActionAnimation);
+}
+
+bool History::updateSendActionNeedsAnimating(
+		crl::time now,
+		bool force,
+		bool animate) {
 	auto changed = force;
 	for (auto i = begin(_typing); i != end(_typing);) {
 		if (now >= i->second) {
@@ -574,7 +588,7 @@ bool History::updateSendActionNeedsAnimating(crl::time now, bool force) {
 		}
 	}
 	const auto result = (!_typing.empty() || !_sendActions.empty());
-	if (changed || (result && !anim::Disabled())) {
+	if (changed || (result && animate && !anim::Disabled())) {
 		owner().updateSendActionAnimation({
 			this,
 			_sendActionAnimation.width(),
@@ -1344,7 +1358,7 @@ HistoryBlock *History::prepareBlockForAddingItem() {
 			return _buildingFrontBlock->block;
 		}
 
-		blocks.push_front(std::make_unique<HistoryBlock>(this));
+		blocks.insert(begin(blocks), std::make_unique<HistoryBlock>(this));
 		for (auto i = 0, l = int(blocks.size()); i != l; ++i) {
 			blocks[i]->setIndexInHistory(i);
 		}
@@ -2859,6 +2873,90 @@ void History::forceFullResize() {
 	_flags |= Flag::f_has_pending_resized_items;
 }
 
+bool History::unloadFarBlocks(int visibleTop, int visibleBottom) {
+	if (isBuildingFrontBlock() || blocks.size() < 2) {
+		return false;
+	}
+	auto count = 0;
+	for (const auto &block : blocks) {
+		count += block->messages.size();
+	}
+	if (count <= kViewsBudget) {
+		return false;
+	}
+	const auto keep = kKeepViewsHeights
+		* std::max(visibleBottom - visibleTop, 1);
+	auto result = false;
+	while (count > kViewsBudget && blocks.size() > 1) {
+		const auto front = blocks.front().get();
+		const auto back = blocks.back().get();
+		const auto fromFront = visibleTop - (front->y() + front->height());
+		const auto fromBack = back->y() - visibleBottom;
+		const auto unloadFront = (fromFront > keep)
+			&& canUnloadBlock(front)
+			&& (fromFront >= fromBack || !canUnloadBlock(back));
+		const auto unloadBack = !unloadFront
+			&& (fromBack > keep)
+			&& canUnloadBlock(back);
+		if (unloadFront) {
+			count -= front->messages.size();
+			unloadFrontBlock();
+		} else if (unloadBack) {
+			count -= back->messages.size();
+			unloadBackBlock();
+		} else {
+			break;
+		}
+		result = true;
+	}
+	if (result) {
+		setHasPendingResizedItems();
+	}
+	return result;
+}
+
+bool History::canUnloadBlock(not_null<HistoryBlock*> block) const {
+	const auto isFront = (block == blocks.front().get());
+	const auto neighbour = isFront
+		? blocks[1]->messages.front().get()
+		: blocks[blocks.size() - 2]->messages.back().get();
+	const auto boundary = isFront
+		? block->messages.back().get()
+		: block->messages.front().get();
+	const auto groupId = boundary->data()->groupId();
+	if (groupId && neighbour->data()->groupId() == groupId) {
+		// Don't split an album.
+		return false;
+	}
+	for (const auto &view : block->messages) {
+		const auto item = view->data();
+		if (view.get() == scrollTopItem
+			|| view.get() == _unreadBarView
+			|| view.get() == _firstUnreadView
+			|| item == _joinedMessage
+			|| !IsServerMsgId(item->id)) {
+			// Local messages won't come back with the loaded slices.
+			return false;
+		}
+	}
+	return true;
+}
+
+void History::unloadFrontBlock() {
+	blocks.erase(begin(blocks));
+	for (auto i = 0, l = int(blocks.size()); i != l; ++i) {
+		blocks[i]->setIndexInHistory(i);
+	}
+	blocks.front()->messages.front()->previousInBlocksChanged();
+	_loadedAtTop = false;
+}
+
+void History::unloadBackBlock() {
+	blocks.pop_back();
+	blocks.back()->messages.back()->nextInBlocksRemoved();
+	_loadedAtBottom = false;
+}
+
 ChannelId History::channelId() const {
 	return peerToChannel(peer->id);
 }
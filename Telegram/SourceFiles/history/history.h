@@ -241,12 +241,23 @@ public:
 
 	void resizeToWidth(int newWidth);
 	void forceFullResize();
+
+	// If there are too many views, destroys views of whole blocks far away
+	// from [visibleTop, visibleBottom) and marks the history as not loaded
+	// there. Items stay in memory and views are created again when that
+	// part is loaded. Returns true if any block was unloaded.
+	bool unloadFarBlocks(int visibleTop, int visibleBottom);
+
+	// Views closer than that many visible heights are never unloaded,
+	// HistoryWidget preloads less, so unloaded blocks are not requested.
+	static constexpr auto kKeepViewsHeights = 8;
 	int height() const;
 
 	void itemRemoved(not_null<HistoryItem*> item);
 	void itemVanished(not_null<HistoryItem*> item);
 
 	HistoryItem *currentNotification();
+	HistoryItem *nextNotification();
 	bool hasNotification() const;
 	void skipNotification();
 	void popNotification(HistoryItem *item);
@@ -263,11 +274,13 @@ public:
 		int outerWidth,
 		style::color color,
 		crl::time now);
+	[[nodiscard]] bool hasSendActionAnimation() const;
 
 	// Interface for Histories
 	bool updateSendActionNeedsAnimating(
 		crl::time now,
-		bool force = false);
+		bool force = false,
+		bool animate = true);
 	bool updateSendActionNeedsAnimating(
 		not_null<UserData*> user,
 		const MTPSendMessageAction &action);
@@ -374,7 +387,7 @@ public:
 	std::optional<int> countStillUnreadLocal(MsgId readTillId) const;
 
 	// Still public data.
-	std::deque<std::unique_ptr<HistoryBlock>> blocks;
+	std::vector<std::unique_ptr<HistoryBlock>> blocks;
 
 	not_null<PeerData*> peer;
 
@@ -454,6 +467,9 @@ private:
 	}
 
 	void checkForLoadedAtTop(not_null<HistoryItem*> added);
+	[[nodiscard]] bool canUnloadBlock(not_null<HistoryBlock*> block) const;
+	void unloadFrontBlock();
+	void unloadBackBlock();
 	void mainViewRemoved(
 		not_null<HistoryBlock*> block,
 		not_null<Element*> view);
@@ -563,7 +579,7 @@ private:
 	Ui::SendActionAnimation _sendActionAnimation;
 	base::flat_map<SendAction::Type, crl::time> _mySendActions;
 
-	std::deque<not_null<HistoryItem*>> _notifications;
+	std::vector<not_null<HistoryItem*>> _notifications;
 
  };
 
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_history.h"
 #include "core/file_utilities.h"
 #include "core/crash_reports.h"
+#include "core/paint_profiler.h"
 #include "history/history.h"
 #include "history/history_message.h"
 #include "history/view/media/history_view_media.h"
@@ -55,6 +56,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_user.h"
 #include "data/data_file_origin.h"
 #include "data/data_histories.h"
+#include "storage/download_manager_mtproto.h"
 #include "facades.h"
 #include "app.h"
 
@@ -66,6 +68,7 @@ namespace {
 
 constexpr auto kScrollDateHideTimeout = 1000;
 constexpr auto kUnloadHeavyPartsPages = 1;
+constexpr auto kPrewarmMediaSessionsEach = crl::time(1000);
 
 // Helper binary search for an item in a list that is not completely
 // above the given top of the visible area or below the given bottom of the visible area
@@ -557,6 +560,9 @@ void HistoryInner::paintEmpty(Painter &p, int width, int height) {
 }
 
 void HistoryInner::paintEvent(QPaintEvent *e) {
+	const auto profile = Core::PaintProfilerScope(
+		"HistoryInner",
+		Core::PaintZone::Frame);
 	if (Ui::skipPaintEvent(this, e)) {
 		return;
 	}
@@ -1956,7 +1962,10 @@ TextForMimeData HistoryInner::getSelectedText() const {
 	const auto timeFormat = qsl(", [dd.MM.yy hh:mm]\n");
 	auto groups = base::flat_set<not_null<const Data::Group*>>();
 	auto fullSize = 0;
-	auto texts = base::flat_map<Data::MessagePosition, TextForMimeData>();
+	auto texts = std::vector<std::pair<
+		Data::MessagePosition,
+		TextForMimeData>>();
+	texts.reserve(selected.size());
 
 	const auto wrapItem = [&](
 			not_null<HistoryItem*> item,
@@ -1969,7 +1978,7 @@ TextForMimeData HistoryInner::getSelectedText() const {
 		part.reserve(size);
 		part.append(item->author()->name).append(time);
 		part.append(std::move(unwrapped));
-		texts.emplace(item->position(), part);
+		texts.emplace_back(item->position(), std::move(part));
 		fullSize += size;
 	};
 	const auto addItem = [&](not_null<HistoryItem*> item) {
@@ -1997,6 +2006,12 @@ TextForMimeData HistoryInner::getSelectedText() const {
 		}
 	}
 
+	// Sort once in the end, a sorted container costs a linear
+	// insertion for each of possibly thousands of selected items.
+	ranges::sort(texts, std::less<>(), [](const auto &pair) {
+		return pair.first;
+	});
+
 	auto result = TextForMimeData();
 	const auto sep = qstr("\n\n");
 	result.reserve(fullSize + (texts.size() - 1) * sep.size());
@@ -2231,7 +2246,71 @@ void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 	const auto from = _visibleAreaTop - pages * visibleAreaHeight;
 	const auto till = _visibleAreaBottom + pages * visibleAreaHeight;
 	session().data().unloadHeavyViewParts(ElementDelegate(), from, till);
+	loadPreviewsInRange(from, till);
 	checkHistoryActivation();
+	prewarmVisibleMediaSessions();
+}
+
+void HistoryInner::loadPreviewsInRange(int from, int till) {
+	const auto load = [&](History *history, int historytop) {
+		if (!history || historytop < 0) {
+			return;
+		}
+		for (const auto &block : history->blocks) {
+			const auto blocktop = historytop + block->y();
+			if (blocktop >= till) {
+				break;
+			} else if (blocktop + block->height() <= from) {
+				continue;
+			}
+			for (const auto &view : block->messages) {
+				const auto itemtop = blocktop + view->y();
+				if (itemtop >= till) {
+					break;
+				} else if (itemtop + view->height() <= from) {
+					continue;
+				} else if (const auto media = view->media()) {
+					media->loadPreview();
+				}
+			}
+		}
+	};
+	load(_migrated, migratedTop());
+	load(_history, historyTop());
+}
+
+void HistoryInner::prewarmVisibleMediaSessions() {
+	// Open download sessions for dcs of visible not loaded media,
+	// so that the first tap doesn't wait for the connection setup.
+	const auto now = crl::now();
+	if (_lastMediaSessionsPrewarm
+		&& now - _lastMediaSessionsPrewarm < kPrewarmMediaSessionsEach) {
+		return;
+	}
+	_lastMediaSessionsPrewarm = now;
+
+	auto dcIds = base::flat_set<MTP::DcId>();
+	enumerateItems<EnumItemsDirection::TopToBottom>([&](
+			not_null<Element*> view,
+			int itemtop,
+			int itembottom) {
+		if (const auto media = view->data()->media()) {
+			if (const auto photo = media->photo()) {
+				if (!photo->loaded()) {
+					dcIds.emplace(photo->dcId());
+				}
+			} else if (const auto document = media->document()) {
+				if (!document->loaded()) {
+					dcIds.emplace(document->dcId());
+				}
+			}
+		}
+		return true;
+	});
+	auto &downloader = session().downloader();
+	for (const auto dcId : dcIds) {
+		downloader.prewarm(dcId);
+	}
 }
 
 bool HistoryInner::displayScrollDate() const {
@@ -63,6 +63,8 @@ public:
 	void touchScrollUpdated(const QPoint &screenPos);
 
 	void checkHistoryActivation();
+	void prewarmVisibleMediaSessions();
+	void loadPreviewsInRange(int from, int till);
 	void recountHistoryGeometry();
 	void updateSize();
 
@@ -387,4 +389,6 @@ private:
 	int _scrollDateLastItemTop = 0;
 	ClickHandlerPtr _scrollDateLink;
 
+	crl::time _lastMediaSessionsPrewarm = 0;
+
 };
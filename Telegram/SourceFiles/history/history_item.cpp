@@ -779,8 +779,36 @@ MessageGroupId HistoryItem::groupId() const {
 	return _groupId;
 }
 
+Ui::Text::String &HistoryItem::textLayout() const {
+	const auto that = const_cast<HistoryItem*>(this);
+	if (_textPending) {
+		that->applyPendingText();
+	}
+	return that->_text;
+}
+
+int HistoryItem::textHeightFor(int width) {
+	const auto from = begin(_textHeights);
+	const auto i = ranges::find(_textHeights, width, &TextHeight::width);
+	if (i != end(_textHeights)) {
+		std::rotate(from, i, i + 1);
+	} else {
+		std::rotate(from, end(_textHeights) - 1, end(_textHeights));
+		*from = { width, textLayout().countHeight(width) };
+	}
+	return from->height;
+}
+
+void HistoryItem::invalidateTextHeights() {
+	_textHeights = {};
+}
+
+QString HistoryItem::searchText() const {
+	return _textPending ? _textPending->text : _text.toString();
+}
+
 bool HistoryItem::isEmpty() const {
-	return _text.isEmpty()
+	return emptyText()
 		&& !_media
 		&& !Has<HistoryMessageLogEntryOriginal>();
 }
@@ -790,7 +818,7 @@ QString HistoryItem::notificationText() const {
 		if (_media) {
 			return _media->notificationText();
 		} else if (!emptyText()) {
-			return _text.toString();
+			return textLayout().toString();
 		}
 		return QString();
 	}();
@@ -807,7 +835,7 @@ QString HistoryItem::inDialogsText(DrawInDialog way) const {
 			}
 			return _media->chatListText();
 		} else if (!emptyText()) {
-			return TextUtilities::Clean(_text.toString());
+			return TextUtilities::Clean(textLayout().toString());
 		}
 		return QString();
 	};
@@ -256,9 +256,15 @@ public:
 		Ui::Text::String &cache) const;
 
 	[[nodiscard]] bool emptyText() const {
-		return _text.isEmpty();
+		return !_textPending && _text.isEmpty();
 	}
 
+	// The text layout is built from the raw text when it is first needed.
+	[[nodiscard]] Ui::Text::String &textLayout() const;
+
+	// Plain message text, doesn't build the layout if it is not built yet.
+	[[nodiscard]] QString searchText() const;
+
 	[[nodiscard]] bool isPinned() const;
 	[[nodiscard]] bool canPin() const;
 	[[nodiscard]] bool canStopPoll() const;
@@ -343,6 +349,8 @@ protected:
 
 	virtual void markMediaAsReadHook() {
 	}
+	virtual void applyPendingText() {
+	}
 
 	void finishEdition(int oldKeyboardTop);
 	void finishEditionToEmpty();
@@ -356,15 +364,26 @@ protected:
 
 	void setGroupId(MessageGroupId groupId);
 
+	// Text height for the few recently used widths, so that resizing
+	// the window back and forth does not lay the text out again.
+	[[nodiscard]] int textHeightFor(int width);
+	void invalidateTextHeights();
+
 	Ui::Text::String _text = { st::msgMinWidth };
-	int _textWidth = -1;
-	int _textHeight = 0;
+	std::unique_ptr<TextWithEntities> _textPending;
 
 	std::unique_ptr<Data::Media> _savedMedia;
 	std::unique_ptr<Data::Media> _media;
 
 private:
+	static constexpr auto kTextHeightsCount = 3;
+	struct TextHeight {
+		int width = -1;
+		int height = 0;
+	};
+
 	TimeId _date = 0;
+	std::array<TextHeight, kTextHeightsCount> _textHeights;
 
 	HistoryView::Element *_mainView = nullptr;
 	friend class HistoryView::Element;
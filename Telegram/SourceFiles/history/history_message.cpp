@@ -1195,6 +1195,8 @@ TextWithEntities HistoryMessage::withLocalEntities(
 }
 
 void HistoryMessage::setText(const TextWithEntities &textWithEntities) {
+	history()->owner().messagesSearchIndex().changed(this);
+
 	for_const (auto &entity, textWithEntities.entities) {
 		auto type = entity.type();
 		if (type == EntityType::Url
@@ -1205,16 +1207,29 @@ void HistoryMessage::setText(const TextWithEntities &textWithEntities) {
 		}
 	}
 
-	if (_media && _media->consumeMessageText(textWithEntities)) {
+	if ((_media && _media->consumeMessageText(textWithEntities))
+		|| textWithEntities.text.isEmpty()) {
 		setEmptyText();
 		return;
 	}
 	clearIsolatedEmoji();
+
+	// Most of the messages received in background chats are never shown,
+	// so the text is parsed only when a view or a preview needs it.
+	_textPending = std::make_unique<TextWithEntities>(
+		withLocalEntities(textWithEntities));
+	invalidateTextHeights();
+}
+
+void HistoryMessage::applyPendingText() {
+	Expects(_textPending != nullptr);
+
+	const auto pending = base::take(_textPending);
 	_text.setMarkedText(
 		st::messageTextStyle,
-		withLocalEntities(textWithEntities),
+		*pending,
 		Ui::ItemTextOptions(this));
-	if (!textWithEntities.text.isEmpty() && _text.isEmpty()) {
+	if (_text.isEmpty()) {
 		// If server has allowed some text that we've trim-ed entirely,
 		// just replace it with something so that UI won't look buggy.
 		_text.setMarkedText(
@@ -1224,8 +1239,6 @@ void HistoryMessage::setText(const TextWithEntities &textWithEntities) {
 	} else if (!_media) {
 		checkIsolatedEmoji();
 	}
-	_textWidth = -1;
-	_textHeight = 0;
 }
 
 void HistoryMessage::reapplyText() {
@@ -1235,13 +1248,13 @@ void HistoryMessage::reapplyText() {
 
 void HistoryMessage::setEmptyText() {
 	clearIsolatedEmoji();
+	_textPending = nullptr;
 	_text.setMarkedText(
 		st::messageTextStyle,
 		{ QString(), EntitiesInText() },
 		Ui::ItemTextOptions(this));
 
-	_textWidth = -1;
-	_textHeight = 0;
+	invalidateTextHeights();
 }
 
 void HistoryMessage::clearIsolatedEmoji() {
@@ -1301,25 +1314,25 @@ void HistoryMessage::setReplyMarkup(const MTPReplyMarkup *markup) {
 }
 
 Ui::Text::IsolatedEmoji HistoryMessage::isolatedEmoji() const {
-	return _text.toIsolatedEmoji();
+	return textLayout().toIsolatedEmoji();
 }
 
 TextWithEntities HistoryMessage::originalText() const {
 	if (emptyText()) {
 		return { QString(), EntitiesInText() };
 	}
-	return _text.toTextWithEntities();
+	return textLayout().toTextWithEntities();
 }
 
 TextForMimeData HistoryMessage::clipboardText() const {
 	if (emptyText()) {
 		return TextForMimeData();
 	}
-	return _text.toTextForMimeData();
+	return textLayout().toTextForMimeData();
 }
 
 bool HistoryMessage::textHasLinks() const {
-	return emptyText() ? false : _text.hasLinks();
+	return emptyText() ? false : textLayout().hasLinks();
 }
 
 void HistoryMessage::setViewsCount(int32 count) {
@@ -1379,6 +1392,10 @@ QString HistoryMessage::notificationHeader() const {
 
 std::unique_ptr<HistoryView::Element> HistoryMessage::createView(
 		not_null<HistoryView::ElementDelegate*> delegate) {
+	// The view layout depends on the isolated emoji check.
+	if (_textPending) {
+		applyPendingText();
+	}
 	return delegate->elementCreate(this);
 }
 
@@ -174,6 +174,7 @@ public:
 
 private:
 	void setEmptyText();
+	void applyPendingText() override;
 	[[nodiscard]] bool isTooOldForEdit(TimeId now) const;
 	[[nodiscard]] bool isLegacyMessage() const {
 		return _flags & MTPDmessage::Flag::f_legacy;
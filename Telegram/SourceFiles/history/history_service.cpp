@@ -584,8 +584,7 @@ void HistoryService::setServiceText(const PreparedText &prepared) {
 		// Link indices start with 1.
 		_text.setLink(++linkIndex, link);
 	}
-	_textWidth = -1;
-	_textHeight = 0;
+	invalidateTextHeights();
 }
 
 void HistoryService::markMediaAsReadHook() {
@@ -711,8 +710,7 @@ void HistoryService::removeMedia() {
 	if (!_media) return;
 
 	_media.reset();
-	_textWidth = -1;
-	_textHeight = 0;
+	invalidateTextHeights();
 	history()->owner().requestItemResize(this);
 }
 
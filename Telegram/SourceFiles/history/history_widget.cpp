@@ -113,6 +113,11 @@ namespace {
 constexpr auto kMessagesPerPageFirst = 30;
 constexpr auto kMessagesPerPage = 50;
 constexpr auto kPreloadHeightsCount = 3; // when 3 screens to scroll left make a preload request
+constexpr auto kPreloadHeightsCountMax = History::kKeepViewsHeights - 1;
+constexpr auto kPreloadMessagesMin = 20;
+constexpr auto kPreloadMessagesMax = 100; // messages.getHistory limit
+constexpr auto kPreloadRoundTripDefault = crl::time(300);
+constexpr auto kScrollVelocityTimeout = crl::time(250);
 constexpr auto kTabbedSelectorToggleTooltipTimeoutMs = 3000;
 constexpr auto kTabbedSelectorToggleTooltipCount = 3;
 constexpr auto kScrollToVoiceAfterScrolledMs = 1000;
@@ -328,6 +333,7 @@ HistoryWidget::HistoryWidget(
 
 	connect(Media::Capture::instance(), SIGNAL(error()), this, SLOT(onRecordError()));
 	connect(Media::Capture::instance(), SIGNAL(updated(quint16,qint32)), this, SLOT(onRecordUpdate(quint16,qint32)));
+	connect(Media::Capture::instance(), SIGNAL(encoded(QByteArray)), this, SLOT(onRecordEncoded(QByteArray)));
 	connect(Media::Capture::instance(), SIGNAL(done(QByteArray,VoiceWaveform,qint32)), this, SLOT(onRecordDone(QByteArray,VoiceWaveform,qint32)));
 
 	_attachToggle->addClickHandler(App::LambdaDelayed(
@@ -1414,13 +1420,30 @@ void HistoryWidget::onRecordDone(
 		QByteArray result,
 		VoiceWaveform waveform,
 		qint32 samples) {
-	if (!canWriteMessage() || result.isEmpty()) return;
+	const auto streamedId = base::take(_recordingStreamedId);
+	if (!canWriteMessage() || result.isEmpty()) {
+		if (streamedId) {
+			session().uploader().cancelStreamed(streamedId);
+		}
+		return;
+	}
 
 	ActivateWindow(controller());
 	const auto duration = samples / Media::Player::kDefaultFrequency;
 	auto action = Api::SendAction(_history);
 	action.replyTo = replyToId();
-	session().api().sendVoiceMessage(result, waveform, duration, action);
+	session().api().sendVoiceMessage(
+		result,
+		waveform,
+		duration,
+		action,
+		streamedId);
+}
+
+void HistoryWidget::onRecordEncoded(QByteArray data) {
+	if (_recordingStreamedId) {
+		session().uploader().feedStreamed(_recordingStreamedId, data);
+	}
 }
 
 void HistoryWidget::onRecordUpdate(quint16 level, qint32 samples) {
@@ -2642,31 +2665,18 @@ void HistoryWidget::firstLoadMessages() {
 		}
 	}
 
-	auto offsetDate = 0;
-	auto maxId = 0;
-	auto minId = 0;
-	auto historyHash = 0;
-
 	const auto history = from;
-	const auto type = Data::Histories::RequestType::History;
+	const auto range = Data::Histories::MessagesRange{
+		offsetId,
+		offset,
+		loadCount
+	};
 	auto &histories = history->owner().histories();
-	_firstLoadRequest = histories.sendRequest(history, type, [=](Fn<void()> finish) {
-		return history->session().api().request(MTPmessages_GetHistory(
-			history->peer->input,
-			MTP_int(offsetId),
-			MTP_int(offsetDate),
-			MTP_int(offset),
-			MTP_int(loadCount),
-			MTP_int(maxId),
-			MTP_int(minId),
-			MTP_int(historyHash)
-		)).done([=](const MTPmessages_Messages &result) {
-			messagesReceived(history->peer, result, _firstLoadRequest);
-			finish();
-		}).fail([=](const RPCError &error) {
-			messagesFailed(error, _firstLoadRequest);
-			finish();
-		}).send();
+	_firstLoadRequest = histories.requestMessages(history, range, [=](
+			const MTPmessages_Messages &result) {
+		messagesReceived(history->peer, result, _firstLoadRequest);
+	}, [=](const RPCError &error) {
+		messagesFailed(error, _firstLoadRequest);
 	});
 }
 
@@ -2691,33 +2701,22 @@ void HistoryWidget::loadMessages() {
 	auto offsetId = from->minMsgId();
 	auto addOffset = 0;
 	auto loadCount = offsetId
-		? kMessagesPerPage
+		? preloadMessagesCount(-1)
 		: kMessagesPerPageFirst;
-	auto offsetDate = 0;
-	auto maxId = 0;
-	auto minId = 0;
-	auto historyHash = 0;
-
 	const auto history = from;
-	const auto type = Data::Histories::RequestType::History;
+	const auto range = Data::Histories::MessagesRange{
+		offsetId,
+		addOffset,
+		loadCount
+	};
+	const auto sent = crl::now();
 	auto &histories = history->owner().histories();
-	_preloadRequest = histories.sendRequest(history, type, [=](Fn<void()> finish) {
-		return history->session().api().request(MTPmessages_GetHistory(
-			history->peer->input,
-			MTP_int(offsetId),
-			MTP_int(offsetDate),
-			MTP_int(addOffset),
-			MTP_int(loadCount),
-			MTP_int(maxId),
-			MTP_int(minId),
-			MTP_int(historyHash)
-		)).done([=](const MTPmessages_Messages &result) {
-			messagesReceived(history->peer, result, _preloadRequest);
-			finish();
-		}).fail([=](const RPCError &error) {
-			messagesFailed(error, _preloadRequest);
-			finish();
-		}).send();
+	_preloadRequest = histories.requestMessages(history, range, [=](
+			const MTPmessages_Messages &result) {
+		rememberPreloadRoundTrip(crl::now() - sent);
+		messagesReceived(history->peer, result, _preloadRequest);
+	}, [=](const RPCError &error) {
+		messagesFailed(error, _preloadRequest);
 	});
 }
 
@@ -2736,7 +2735,7 @@ void HistoryWidget::loadMessagesDown() {
 		return;
 	}
 
-	auto loadCount = kMessagesPerPage;
+	auto loadCount = preloadMessagesCount(1);
 	auto addOffset = -loadCount;
 	auto offsetId = from->maxMsgId();
 	if (!offsetId) {
@@ -2744,31 +2743,20 @@ void HistoryWidget::loadMessagesDown() {
 		++offsetId;
 		++addOffset;
 	}
-	auto offsetDate = 0;
-	auto maxId = 0;
-	auto minId = 0;
-	auto historyHash = 0;
-
 	const auto history = from;
-	const auto type = Data::Histories::RequestType::History;
+	const auto range = Data::Histories::MessagesRange{
+		offsetId + 1,
+		addOffset,
+		loadCount
+	};
+	const auto sent = crl::now();
 	auto &histories = history->owner().histories();
-	_preloadDownRequest = histories.sendRequest(history, type, [=](Fn<void()> finish) {
-		return history->session().api().request(MTPmessages_GetHistory(
-			history->peer->input,
-			MTP_int(offsetId + 1),
-			MTP_int(offsetDate),
-			MTP_int(addOffset),
-			MTP_int(loadCount),
-			MTP_int(maxId),
-			MTP_int(minId),
-			MTP_int(historyHash)
-		)).done([=](const MTPmessages_Messages &result) {
-			messagesReceived(history->peer, result, _preloadDownRequest);
-			finish();
-		}).fail([=](const RPCError &error) {
-			messagesFailed(error, _preloadDownRequest);
-			finish();
-		}).send();
+	_preloadDownRequest = histories.requestMessages(history, range, [=](
+			const MTPmessages_Messages &result) {
+		rememberPreloadRoundTrip(crl::now() - sent);
+		messagesReceived(history->peer, result, _preloadDownRequest);
+	}, [=](const RPCError &error) {
+		messagesFailed(error, _preloadDownRequest);
 	});
 }
 
@@ -2808,31 +2796,18 @@ void HistoryWidget::delayedShowAt(MsgId showAtMsgId) {
 			offsetId = -_delayedShowAtMsgId;
 		}
 	}
-	auto offsetDate = 0;
-	auto maxId = 0;
-	auto minId = 0;
-	auto historyHash = 0;
-
 	const auto history = from;
-	const auto type = Data::Histories::RequestType::History;
+	const auto range = Data::Histories::MessagesRange{
+		offsetId,
+		offset,
+		loadCount
+	};
 	auto &histories = history->owner().histories();
-	_delayedShowAtRequest = histories.sendRequest(history, type, [=](Fn<void()> finish) {
-		return history->session().api().request(MTPmessages_GetHistory(
-			history->peer->input,
-			MTP_int(offsetId),
-			MTP_int(offsetDate),
-			MTP_int(offset),
-			MTP_int(loadCount),
-			MTP_int(maxId),
-			MTP_int(minId),
-			MTP_int(historyHash)
-		)).done([=](const MTPmessages_Messages &result) {
-			messagesReceived(history->peer, result, _delayedShowAtRequest);
-			finish();
-		}).fail([=](const RPCError &error) {
-			messagesFailed(error, _delayedShowAtRequest);
-			finish();
-		}).send();
+	_delayedShowAtRequest = histories.requestMessages(history, range, [=](
+			const MTPmessages_Messages &result) {
+		messagesReceived(history->peer, result, _delayedShowAtRequest);
+	}, [=](const RPCError &error) {
+		messagesFailed(error, _delayedShowAtRequest);
 	});
 }
 
@@ -2880,18 +2855,104 @@ void HistoryWidget::preloadHistoryIfNeeded() {
 
 	updateHistoryDownVisibility();
 	updateUnreadMentionsVisibility();
+	auto scrollTop = _scroll->scrollTop();
+	updateScrollVelocity(scrollTop);
 	if (!_scrollToAnimation.animating()) {
+		unloadFarHistoryBlocks();
 		preloadHistoryByScroll();
 		checkReplyReturns();
 	}
 
-	auto scrollTop = _scroll->scrollTop();
 	if (scrollTop != _lastScrollTop) {
 		_lastScrolled = crl::now();
 		_lastScrollTop = scrollTop;
 	}
 }
 
+void HistoryWidget::updateScrollVelocity(int scrollTop) {
+	if (scrollTop == _lastScrollTop) {
+		return;
+	}
+	const auto elapsed = crl::now() - _lastScrolled;
+	if (elapsed >= kScrollVelocityTimeout) {
+		_scrollVelocity = 0.;
+	} else if (elapsed > 0) {
+		const auto current = (scrollTop - _lastScrollTop)
+			/ float64(elapsed);
+		_scrollVelocity = ((_scrollVelocity > 0.) == (current > 0.))
+			? (_scrollVelocity * 0.7 + current * 0.3)
+			: current;
+	}
+}
+
+void HistoryWidget::rememberPreloadRoundTrip(crl::time duration) {
+	_preloadRoundTrip = _preloadRoundTrip
+		? (_preloadRoundTrip * 3 + duration) / 4
+		: duration;
+}
+
+int HistoryWidget::preloadDistance(int direction) const {
+	// Request more when the content left can be scrolled through
+	// faster than the next slice has a chance to arrive. Only in the
+	// scroll direction, the other side is not needed that soon.
+	const auto scrollHeight = std::max(_scroll->height(), 1);
+	const auto stopped = (crl::now() - _lastScrolled
+		>= kScrollVelocityTimeout);
+	const auto velocity = stopped
+		? 0.
+		: std::max(_scrollVelocity * direction, 0.);
+	const auto roundTrip = _preloadRoundTrip
+		? _preloadRoundTrip
+		: kPreloadRoundTripDefault;
+	const auto covered = int(std::ceil(velocity * roundTrip * 2.));
+	return std::clamp(
+		kPreloadHeightsCount * scrollHeight + covered,
+		kPreloadHeightsCount * scrollHeight,
+		kPreloadHeightsCountMax * scrollHeight);
+}
+
+int HistoryWidget::preloadMessagesCount(int direction) const {
+	const auto itemHeight = averageItemHeight();
+	if (!itemHeight) {
+		return kMessagesPerPage;
+	}
+	return std::clamp(
+		preloadDistance(direction) / itemHeight,
+		kPreloadMessagesMin,
+		kPreloadMessagesMax);
+}
+
+int HistoryWidget::averageItemHeight() const {
+	auto height = 0;
+	auto count = 0;
+	for (const auto history : { _migrated, _history }) {
+		if (!history) {
+			continue;
+		}
+		for (const auto &block : history->blocks) {
+			height += block->height();
+			count += block->messages.size();
+		}
+	}
+	return count ? (height / count) : 0;
+}
+
+void HistoryWidget::unloadFarHistoryBlocks() {
+	// Migrated histories are shown together, keep them as they are.
+	if (_migrated || _preloadRequest || _preloadDownRequest) {
+		return;
+	}
+	const auto top = _list->historyTop();
+	if (top < 0) {
+		return;
+	}
+	const auto visibleTop = _scroll->scrollTop() - top;
+	const auto visibleBottom = visibleTop + _scroll->height();
+	if (_history->unloadFarBlocks(visibleTop, visibleBottom)) {
+		updateHistoryGeometry();
+	}
+}
+
 void HistoryWidget::preloadHistoryByScroll() {
 	if (_firstLoadRequest
 		|| _delayedShowAtRequest
@@ -2903,11 +2964,10 @@ void HistoryWidget::preloadHistoryByScroll() {
 
 	auto scrollTop = _scroll->scrollTop();
 	auto scrollTopMax = _scroll->scrollTopMax();
-	auto scrollHeight = _scroll->height();
-	if (scrollTop + kPreloadHeightsCount * scrollHeight >= scrollTopMax) {
+	if (scrollTop + preloadDistance(1) >= scrollTopMax) {
 		loadMessagesDown();
 	}
-	if (scrollTop <= kPreloadHeightsCount * scrollHeight) {
+	if (scrollTop <= preloadDistance(-1)) {
 		loadMessages();
 	}
 }
@@ -3507,6 +3567,14 @@ void HistoryWidget::recordStartCallback() {
 
 	emit Media::Capture::instance()->start();
 
+	if (_recordingStreamedId) {
+		session().uploader().cancelStreamed(
+			base::take(_recordingStreamedId));
+	}
+	if (cStreamedVoiceUpload()) {
+		_recordingStreamedId = session().uploader().startStreamed();
+	}
+
 	_recording = _inField = true;
 	updateControlsVisibility();
 	activate();
@@ -3541,6 +3609,11 @@ void HistoryWidget::mouseReleaseEvent(QMouseEvent *e) {
 void HistoryWidget::stopRecording(bool send) {
 	emit Media::Capture::instance()->stop(send);
 
+	if (!send && _recordingStreamedId) {
+		session().uploader().cancelStreamed(
+			base::take(_recordingStreamedId));
+	}
+
 	_recordingLevel = anim::value();
 	_recordingAnimation.stop();
 
@@ -5353,11 +5426,23 @@ std::optional<int> HistoryWidget::unreadBarTop() const {
 }
 
 void HistoryWidget::addMessagesToFront(PeerData *peer, const QVector<MTPMessage> &messages) {
+	const auto started = crl::now();
 	_list->messagesReceived(peer, messages);
 	if (!_firstLoadRequest) {
 		updateHistoryGeometry();
 		updateBotKeyboard();
 	}
+	logSliceLayoutTime(messages.size(), crl::now() - started);
+}
+
+void HistoryWidget::logSliceLayoutTime(
+		int count,
+		crl::time duration) const {
+	// Message texts are laid out on the main thread while a received
+	// slice is inserted, this shows how long the insertion blocks it.
+	DEBUG_LOG(("History Layout: %1 messages added in %2 ms."
+		).arg(count
+		).arg(duration));
 }
 
 void HistoryWidget::addMessagesToBack(
@@ -5370,6 +5455,7 @@ void HistoryWidget::addMessagesToBack(
 		_history->calculateFirstUnreadMessage();
 		return !_history->firstUnreadMessage();
 	}();
+	const auto started = crl::now();
 	_list->messagesReceivedDown(peer, messages);
 	if (checkForUnreadStart) {
 		_history->calculateFirstUnreadMessage();
@@ -5378,6 +5464,7 @@ void HistoryWidget::addMessagesToBack(
 	if (!_firstLoadRequest) {
 		updateHistoryGeometry(false, true, { ScrollChangeNoJumpToBottom, 0 });
 	}
+	logSliceLayoutTime(messages.size(), crl::now() - started);
 }
 
 void HistoryWidget::updateBotKeyboard(History *h, bool force) {
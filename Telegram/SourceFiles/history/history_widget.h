@@ -308,6 +308,7 @@ public slots:
 	void onRecordError();
 	void onRecordDone(QByteArray result, VoiceWaveform waveform, qint32 samples);
 	void onRecordUpdate(quint16 level, qint32 samples);
+	void onRecordEncoded(QByteArray data);
 
 	void onUpdateHistoryItems();
 
@@ -577,6 +578,13 @@ private:
 	bool messagesFailed(const RPCError &error, int requestId);
 	void addMessagesToFront(PeerData *peer, const QVector<MTPMessage> &messages);
 	void addMessagesToBack(PeerData *peer, const QVector<MTPMessage> &messages);
+	void logSliceLayoutTime(int count, crl::time duration) const;
+	void updateScrollVelocity(int scrollTop);
+	void rememberPreloadRoundTrip(crl::time duration);
+	// Direction is -1 for the older messages and 1 for the newer ones.
+	[[nodiscard]] int preloadDistance(int direction) const;
+	[[nodiscard]] int preloadMessagesCount(int direction) const;
+	[[nodiscard]] int averageItemHeight() const;
 
 	void botCallbackDone(BotCallbackInfo info, const MTPmessages_BotCallbackAnswer &answer, mtpRequestId req);
 	bool botCallbackFail(BotCallbackInfo info, const RPCError &error, mtpRequestId req);
@@ -619,6 +627,7 @@ private:
 	void visibleAreaUpdated();
 	int countInitialScrollTop();
 	int countAutomaticScrollTop();
+	void unloadFarHistoryBlocks();
 	void preloadHistoryByScroll();
 	void checkReplyReturns();
 	void scrollToAnimationCallback(FullMsgId attachToId, int relativeTo);
@@ -706,6 +715,8 @@ private:
 
 	int _lastScrollTop = 0; // gifs optimization
 	crl::time _lastScrolled = 0;
+	float64 _scrollVelocity = 0.; // px per ms, negative when scrolling up
+	crl::time _preloadRoundTrip = 0;
 	QTimer _updateHistoryItems;
 
 	crl::time _lastUserScrolled = 0;
@@ -754,6 +765,7 @@ private:
 	bool _inPinnedMsg = false;
 	bool _inClickable = false;
 	int _recordingSamples = 0;
+	uint64 _recordingStreamedId = 0;
 	int _recordCancelWidth;
 
 	rpl::lifetime _uploaderSubscriptions;
@@ -50,6 +50,7 @@ constexpr auto kPreloadedScreensCount = 4;
 constexpr auto kPreloadIfLessThanScreens = 2;
 constexpr auto kPreloadedScreensCountFull
 	= kPreloadedScreensCount + 1 + kPreloadedScreensCount;
+constexpr auto kUnusedViewLifetime = 10 * crl::time(1000);
 
 } // namespace
 
@@ -244,6 +245,7 @@ ListWidget::ListWidget(
 , _controller(controller)
 , _context(_delegate->listContext())
 , _itemAverageHeight(itemMinimalHeight())
+, _unusedViewsTimer([=] { clearUnusedViews(); })
 , _scrollDateCheck([this] { scrollDateCheck(); })
 , _applyUpdatedScrollState([this] { applyUpdatedScrollState(); })
 , _selectEnabled(_delegate->listAllowsMultiSelect())
@@ -331,6 +333,7 @@ void ListWidget::refreshRows() {
 		}
 	}
 	updateAroundPositionFromRows();
+	markUnusedViews();
 
 	updateItemsGeometry();
 	checkUnreadBarCreation();
@@ -339,6 +342,49 @@ void ListWidget::refreshRows() {
 	_delegate->listContentRefreshed();
 }
 
+void ListWidget::markUnusedViews() {
+	if (_views.size() == _items.size()) {
+		_unusedViews.clear();
+		return;
+	}
+	const auto now = crl::now();
+	const auto shown = base::flat_set<not_null<const Element*>>(
+		begin(_items),
+		end(_items));
+	for (const auto &[item, view] : _views) {
+		if (shown.contains(view.get())) {
+			_unusedViews.remove(item);
+		} else {
+			_unusedViews.emplace(item, now);
+		}
+	}
+	if (!_unusedViews.empty() && !_unusedViewsTimer.isActive()) {
+		_unusedViewsTimer.callOnce(kUnusedViewLifetime);
+	}
+}
+
+void ListWidget::clearUnusedViews() {
+	const auto now = crl::now();
+	auto nearest = std::optional<crl::time>();
+	for (auto i = begin(_unusedViews); i != end(_unusedViews);) {
+		const auto [item, since] = *i;
+		if (since + kUnusedViewLifetime > now) {
+			const auto left = since + kUnusedViewLifetime - now;
+			nearest = nearest ? std::min(*nearest, left) : left;
+			++i;
+			continue;
+		}
+		if (const auto j = _views.find(item); j != end(_views)) {
+			viewReplaced(j->second.get(), nullptr);
+			_views.erase(j);
+		}
+		i = _unusedViews.erase(i);
+	}
+	if (nearest) {
+		_unusedViewsTimer.callOnce(*nearest);
+	}
+}
+
 std::optional<int> ListWidget::scrollTopForPosition(
 		Data::MessagePosition position) const {
 	if (position == Data::MaxMessagePosition) {
@@ -2524,6 +2570,7 @@ void ListWidget::itemRemoved(not_null<const HistoryItem*> item) {
 		end(_items));
 	viewReplaced(view, nullptr);
 	_views.erase(i);
+	_unusedViews.remove(item);
 
 	updateItemsGeometry();
 }
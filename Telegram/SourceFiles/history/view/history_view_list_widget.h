@@ -276,6 +276,8 @@ private:
 	void refreshViewer();
 	void updateAroundPositionFromRows();
 	void refreshRows();
+	void markUnusedViews();
+	void clearUnusedViews();
 	ScrollTopState countScrollState() const;
 	void saveScrollState();
 	void restoreScrollState();
@@ -452,6 +454,10 @@ private:
 	int _itemAverageHeight = 0;
 	base::flat_set<FullMsgId> _animatedStickersPlayed;
 
+	// Views that left the slice, destroyed if they don't come back soon.
+	base::flat_map<not_null<const HistoryItem*>, crl::time> _unusedViews;
+	base::Timer _unusedViewsTimer;
+
 	int _minHeight = 0;
 	int _visibleTop = 0;
 	int _visibleBottom = 0;
@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/media/history_view_media.h"
 #include "history/view/media/history_view_web_page.h"
 #include "history/history.h"
+#include "core/paint_profiler.h"
 #include "ui/toast/toast.h"
 #include "data/data_session.h"
 #include "data/data_user.h"
@@ -266,17 +267,15 @@ QSize Message::performCountOptimalSize() {
 		auto mediaOnTop = (mediaDisplayed && media->isBubbleTop()) || (entry && entry->isBubbleTop());
 
 		if (mediaOnBottom) {
-			if (item->_text.removeSkipBlock()) {
-				item->_textWidth = -1;
-				item->_textHeight = 0;
+			if (item->textLayout().removeSkipBlock()) {
+				item->invalidateTextHeights();
 			}
-		} else if (item->_text.updateSkipBlock(skipBlockWidth(), skipBlockHeight())) {
-			item->_textWidth = -1;
-			item->_textHeight = 0;
+		} else if (item->textLayout().updateSkipBlock(skipBlockWidth(), skipBlockHeight())) {
+			item->invalidateTextHeights();
 		}
 
 		maxWidth = plainMaxWidth();
-		minHeight = hasVisibleText() ? item->_text.minHeight() : 0;
+		minHeight = hasVisibleText() ? item->textLayout().minHeight() : 0;
 		if (!mediaOnBottom) {
 			minHeight += st::msgPadding.bottom();
 			if (mediaDisplayed) minHeight += st::mediaInBubbleSkip;
@@ -291,8 +290,8 @@ QSize Message::performCountOptimalSize() {
 			if (media->enforceBubbleWidth()) {
 				maxWidth = media->maxWidth();
 				if (hasVisibleText() && maxWidth < plainMaxWidth()) {
-					minHeight -= item->_text.minHeight();
-					minHeight += item->_text.countHeight(maxWidth - st::msgPadding.left() - st::msgPadding.right());
+					minHeight -= item->textLayout().minHeight();
+					minHeight += item->textLayout().countHeight(maxWidth - st::msgPadding.left() - st::msgPadding.right());
 				}
 			} else {
 				accumulate_max(maxWidth, media->maxWidth());
@@ -669,6 +668,9 @@ void Message::paintViaBotIdInfo(Painter &p, QRect &trect, bool selected) const {
 }
 
 void Message::paintText(Painter &p, QRect &trect, TextSelection selection) const {
+	const auto profile = Core::PaintProfilerScope(
+		"Message::paintText",
+		Core::PaintZone::Text);
 	if (!hasVisibleText()) {
 		return;
 	}
@@ -678,7 +680,7 @@ void Message::paintText(Painter &p, QRect &trect, TextSelection selection) const
 	auto selected = (selection == FullSelection);
 	p.setPen(outbg ? (selected ? st::historyTextOutFgSelected : st::historyTextOutFg) : (selected ? st::historyTextInFgSelected : st::historyTextInFg));
 	p.setFont(st::msgFont);
-	item->_text.draw(p, trect.x(), trect.y(), trect.width(), style::al_left, 0, -1, selection);
+	item->textLayout().draw(p, trect.x(), trect.y(), trect.width(), style::al_left, 0, -1, selection);
 }
 
 PointState Message::pointState(QPoint point) const {
@@ -820,7 +822,7 @@ TextState Message::textState(
 				result = entry->textState(
 					point - QPoint(entryLeft, entryTop),
 					request);
-				result.symbol += item->_text.length() + (mediaDisplayed ? media->fullSelectionLength() : 0);
+				result.symbol += item->textLayout().length() + (mediaDisplayed ? media->fullSelectionLength() : 0);
 			}
 		}
 
@@ -845,18 +847,18 @@ TextState Message::textState(
 
 				if (point.y() >= mediaTop && point.y() < mediaTop + mediaHeight) {
 					result = media->textState(point - QPoint(mediaLeft, mediaTop), request);
-					result.symbol += item->_text.length();
+					result.symbol += item->textLayout().length();
 				} else if (getStateText(point, trect, &result, request)) {
 					checkForPointInTime();
 					return result;
 				} else if (point.y() >= trect.y() + trect.height()) {
-					result.symbol = item->_text.length();
+					result.symbol = item->textLayout().length();
 				}
 			} else if (getStateText(point, trect, &result, request)) {
 				checkForPointInTime();
 				return result;
 			} else if (point.y() >= trect.y() + trect.height()) {
-				result.symbol = item->_text.length();
+				result.symbol = item->textLayout().length();
 			}
 		}
 		checkForPointInTime();
@@ -878,7 +880,7 @@ TextState Message::textState(
 		}
 	} else if (media && media->isDisplayed()) {
 		result = media->textState(point - g.topLeft(), request);
-		result.symbol += item->_text.length();
+		result.symbol += item->textLayout().length();
 	}
 
 	if (keyboard && item->isHistoryEntry()) {
@@ -1030,7 +1032,7 @@ bool Message::getStateText(
 	}
 	const auto item = message();
 	if (base::in_range(point.y(), trect.y(), trect.y() + trect.height())) {
-		*outResult = TextState(item, item->_text.getState(
+		*outResult = TextState(item, item->textLayout().getState(
 			point - trect.topLeft(),
 			trect.width(),
 			request.forText()));
@@ -1098,7 +1100,7 @@ TextForMimeData Message::selectedText(TextSelection selection) const {
 	const auto media = this->media();
 
 	auto logEntryOriginalResult = TextForMimeData();
-	auto textResult = item->_text.toTextForMimeData(selection);
+	auto textResult = item->textLayout().toTextForMimeData(selection);
 	auto skipped = skipTextSelection(selection);
 	auto mediaDisplayed = (media && media->isDisplayed());
 	auto mediaResult = (mediaDisplayed || isHiddenByGroup())
@@ -1130,8 +1132,8 @@ TextSelection Message::adjustSelection(
 	const auto item = message();
 	const auto media = this->media();
 
-	auto result = item->_text.adjustSelection(selection, type);
-	auto beforeMediaLength = item->_text.length();
+	auto result = item->textLayout().adjustSelection(selection, type);
+	auto beforeMediaLength = item->textLayout().length();
 	if (selection.to <= beforeMediaLength) {
 		return result;
 	}
@@ -1346,7 +1348,7 @@ int Message::timeLeft() const {
 
 int Message::plainMaxWidth() const {
 	return st::msgPadding.left()
-		+ (hasVisibleText() ? message()->_text.maxWidth() : 0)
+		+ (hasVisibleText() ? message()->textLayout().maxWidth() : 0)
 		+ st::msgPadding.right();
 }
 
@@ -1633,11 +1635,11 @@ void Message::fromNameUpdated(int width) const {
 }
 
 TextSelection Message::skipTextSelection(TextSelection selection) const {
-	return HistoryView::UnshiftItemSelection(selection, message()->_text);
+	return HistoryView::UnshiftItemSelection(selection, message()->textLayout());
 }
 
 TextSelection Message::unskipTextSelection(TextSelection selection) const {
-	return HistoryView::ShiftItemSelection(selection, message()->_text);
+	return HistoryView::ShiftItemSelection(selection, message()->textLayout());
 }
 
 QRect Message::countGeometry() const {
@@ -1744,11 +1746,7 @@ int Message::resizeContentGetHeight(int newWidth) {
 		} else {
 			if (hasVisibleText()) {
 				auto textWidth = qMax(contentWidth - st::msgPadding.left() - st::msgPadding.right(), 1);
-				if (textWidth != item->_textWidth) {
-					item->_textWidth = textWidth;
-					item->_textHeight = item->_text.countHeight(textWidth);
-				}
-				newHeight = item->_textHeight;
+				newHeight = item->textHeightFor(textWidth);
 			} else {
 				newHeight = 0;
 			}
@@ -1868,10 +1866,9 @@ void Message::initTime() {
 			? 0
 			: st::msgDateFont->width(views->_viewsText);
 	}
-	if (item->_text.hasSkipBlock()) {
-		if (item->_text.updateSkipBlock(skipBlockWidth(), skipBlockHeight())) {
-			item->_textWidth = -1;
-			item->_textHeight = 0;
+	if (item->textLayout().hasSkipBlock()) {
+		if (item->textLayout().updateSkipBlock(skipBlockWidth(), skipBlockHeight())) {
+			item->invalidateTextHeights();
 		}
 	}
 }
@@ -338,9 +338,7 @@ QSize Service::performCountCurrentSize(int newWidth) {
 	const auto item = message();
 	const auto media = this->media();
 
-	if (item->_text.isEmpty()) {
-		item->_textHeight = 0;
-	} else {
+	if (!item->textLayout().isEmpty()) {
 		auto contentWidth = newWidth;
 		if (Adaptive::ChatWide() && !AdaptiveBubbles()) {
 			accumulate_min(contentWidth, st::msgMaxWidth + 2 * st::msgPhotoSkip + 2 * st::msgMargin.left());
@@ -351,14 +349,10 @@ QSize Service::performCountCurrentSize(int newWidth) {
 		}
 
 		auto nwidth = qMax(contentWidth - st::msgServicePadding.left() - st::msgServicePadding.right(), 0);
-		if (nwidth != item->_textWidth) {
-			item->_textWidth = nwidth;
-			item->_textHeight = item->_text.countHeight(nwidth);
-		}
 		if (contentWidth >= maxWidth()) {
 			newHeight += minHeight();
 		} else {
-			newHeight += item->_textHeight;
+			newHeight += item->textHeightFor(nwidth);
 		}
 		newHeight += st::msgServicePadding.top() + st::msgServicePadding.bottom() + st::msgServiceMargin.top() + st::msgServiceMargin.bottom();
 		if (media) {
@@ -373,8 +367,8 @@ QSize Service::performCountOptimalSize() {
 	const auto item = message();
 	const auto media = this->media();
 
-	auto maxWidth = item->_text.maxWidth() + st::msgServicePadding.left() + st::msgServicePadding.right();
-	auto minHeight = item->_text.minHeight();
+	auto maxWidth = item->textLayout().maxWidth() + st::msgServicePadding.left() + st::msgServicePadding.right();
+	auto minHeight = item->textLayout().minHeight();
 	if (media) {
 		media->initDimensions();
 	}
@@ -447,12 +441,12 @@ void Service::draw(
 
 	auto trect = QRect(g.left(), st::msgServiceMargin.top(), g.width(), height).marginsAdded(-st::msgServicePadding);
 
-	ServiceMessagePainter::paintComplexBubble(p, g.left(), g.width(), item->_text, trect);
+	ServiceMessagePainter::paintComplexBubble(p, g.left(), g.width(), item->textLayout(), trect);
 
 	p.setBrush(Qt::NoBrush);
 	p.setPen(st::msgServiceFg);
 	p.setFont(st::msgServiceFont);
-	item->_text.draw(p, trect.x(), trect.y(), trect.width(), Qt::AlignCenter, 0, -1, selection, false);
+	item->textLayout().draw(p, trect.x(), trect.y(), trect.width(), Qt::AlignCenter, 0, -1, selection, false);
 
 	p.restoreTextPalette();
 
@@ -510,7 +504,7 @@ TextState Service::textState(QPoint point, StateRequest request) const {
 	if (trect.contains(point)) {
 		auto textRequest = request.forText();
 		textRequest.align = style::al_center;
-		result = TextState(item, item->_text.getState(
+		result = TextState(item, item->textLayout().getState(
 			point - trect.topLeft(),
 			trect.width(),
 			textRequest));
@@ -537,13 +531,13 @@ void Service::updatePressed(QPoint point) {
 }
 
 TextForMimeData Service::selectedText(TextSelection selection) const {
-	return message()->_text.toTextForMimeData(selection);
+	return message()->textLayout().toTextForMimeData(selection);
 }
 
 TextSelection Service::adjustSelection(
 		TextSelection selection,
 		TextSelectType type) const {
-	return message()->_text.adjustSelection(selection, type);
+	return message()->textLayout().adjustSelection(selection, type);
 }
 
 EmptyPainter::EmptyPainter(not_null<History*> history) : _history(history) {
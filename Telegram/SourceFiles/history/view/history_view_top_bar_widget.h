@@ -9,7 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "ui/rp_widget.h"
 #include "ui/effects/animations.h"
-#include "base/timer.h"
+#include "core/timer_wheel.h"
 #include "base/object_ptr.h"
 #include "dialogs/dialogs_key.h"
 
@@ -157,7 +157,7 @@ private:
 	std::unique_ptr<Ui::InfiniteRadialAnimation> _connecting;
 
 	int _unreadCounterSubscription = 0;
-	base::Timer _onlineUpdater;
+	Core::WheelTimer _onlineUpdater;
 
 	rpl::event_stream<> _forwardSelection;
 	rpl::event_stream<> _sendNowSelection;
@@ -154,7 +154,9 @@ QSize Document::countOptimalSize() {
 	}
 	auto thumbed = Get<HistoryDocumentThumbed>();
 	if (thumbed) {
-		_data->loadThumbnail(_realParent->fullId());
+		if (!LazyPreviewLoad(_parent)) {
+			_data->loadThumbnail(_realParent->fullId());
+		}
 		auto tw = style::ConvertScale(_data->thumbnail()->width());
 		auto th = style::ConvertScale(_data->thumbnail()->height());
 		if (tw > th) {
@@ -862,6 +864,12 @@ void Document::refreshParentId(not_null<HistoryItem*> realParent) {
 	}
 }
 
+void Document::loadPreview() const {
+	if (Has<HistoryDocumentThumbed>()) {
+		_data->loadThumbnail(_realParent->fullId());
+	}
+}
+
 void Document::parentTextUpdated() {
 	auto caption = (_parent->media() == this)
 		? createCaption()
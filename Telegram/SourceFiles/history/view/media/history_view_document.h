@@ -62,6 +62,7 @@ public:
 
 	void refreshParentId(not_null<HistoryItem*> realParent) override;
 	void parentTextUpdated() override;
+	void loadPreview() const override;
 
 protected:
 	float64 dataProgress() const override;
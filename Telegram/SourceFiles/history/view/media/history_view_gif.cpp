@@ -79,7 +79,13 @@ Gif::Gif(
 	setStatusSize(FileStatusSizeReady);
 
 	refreshCaption();
-	_data->loadThumbnail(realParent->fullId());
+	if (!LazyPreviewLoad(parent)) {
+		loadPreview();
+	}
+}
+
+void Gif::loadPreview() const {
+	_data->loadThumbnail(_realParent->fullId());
 }
 
 Gif::~Gif() {
@@ -103,6 +103,7 @@ public:
 	void unloadHeavyPart() override {
 		stopAnimation();
 	}
+	void loadPreview() const override;
 
 	void refreshParentId(not_null<HistoryItem*> realParent) override;
 
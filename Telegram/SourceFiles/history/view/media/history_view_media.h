@@ -256,6 +256,10 @@ public:
 	virtual void unloadHeavyPart() {
 	}
 
+	// Starts loading the thumbnails required to paint the media.
+	virtual void loadPreview() const {
+	}
+
 	// Should be called only by Data::Session.
 	virtual void updateSharedContactUserId(UserId userId) {
 	}
@@ -9,6 +9,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "layout.h"
 #include "data/data_document.h"
+#include "data/data_media_types.h"
+#include "history/history_item.h"
 #include "history/view/history_view_element.h"
 #include "history/view/media/history_view_media_grouped.h"
 #include "history/view/media/history_view_photo.h"
@@ -94,4 +96,9 @@ int unitedLineHeight() {
 	return qMax(st::webPageTitleFont->height, st::webPageDescriptionFont->height);
 }
 
+bool LazyPreviewLoad(not_null<Element*> parent) {
+	const auto media = parent->data()->media();
+	return media && (media->webpage() != nullptr);
+}
+
 } // namespace HistoryView
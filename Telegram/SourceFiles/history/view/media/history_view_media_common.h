@@ -39,6 +39,10 @@ std::unique_ptr<Media> CreateAttach(
 	const QString &webpageUrl = QString());
 int unitedLineHeight();
 
+// Media attached to a web page preview start loading their thumbnails
+// only when the message gets close to the visible area, not when created.
+[[nodiscard]] bool LazyPreviewLoad(not_null<Element*> parent);
+
 [[nodiscard]] inline QSize NonEmptySize(QSize size) {
 	return QSize(std::max(size.width(), 1), std::max(size.height(), 1));
 }
@@ -439,6 +439,12 @@ void GroupedMedia::unloadHeavyPart() {
 	}
 }
 
+void GroupedMedia::loadPreview() const {
+	for (const auto &part : _parts) {
+		part.content->loadPreview();
+	}
+}
+
 void GroupedMedia::parentTextUpdated() {
 	history()->owner().requestViewResize(_parent);
 }
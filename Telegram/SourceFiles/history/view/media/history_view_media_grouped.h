@@ -89,6 +89,7 @@ public:
 	void stopAnimation() override;
 	int checkAnimationCount() override;
 	void unloadHeavyPart() override;
+	void loadPreview() const override;
 
 	void parentTextUpdated() override;
 
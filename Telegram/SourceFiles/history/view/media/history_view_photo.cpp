@@ -52,10 +52,16 @@ void Photo::create(FullMsgId contextId, PeerData *chat) {
 		std::make_shared<PhotoOpenClickHandler>(_data, contextId, chat),
 		std::make_shared<PhotoSaveClickHandler>(_data, contextId, chat),
 		std::make_shared<PhotoCancelClickHandler>(_data, contextId, chat));
+	if (!LazyPreviewLoad(_parent)) {
+		loadPreview();
+	}
+}
+
+void Photo::loadPreview() const {
 	if (!_data->thumbnailInline()
 		&& !_data->loaded()
 		&& !_data->thumbnail()->loaded()) {
-		_data->thumbnailSmall()->load(contextId);
+		_data->thumbnailSmall()->load(_realParent->fullId());
 	}
 }
 
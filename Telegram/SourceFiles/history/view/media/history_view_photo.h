@@ -74,6 +74,7 @@ public:
 	bool isReadyForOpen() const override;
 
 	void parentTextUpdated() override;
+	void loadPreview() const override;
 
 protected:
 	float64 dataProgress() const override;
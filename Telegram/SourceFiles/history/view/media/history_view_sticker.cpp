@@ -31,6 +31,18 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace HistoryView {
 namespace {
 
+using SharedLottieKey = std::tuple<
+	not_null<DocumentData*>,
+	const Lottie::ColorReplacements*,
+	int,
+	int>;
+
+// Looping stickers of the same size play in sync, so all views showing
+// them can paint frames rendered by a single player.
+base::flat_map<
+	SharedLottieKey,
+	std::weak_ptr<Lottie::SinglePlayer>> SharedLottiePlayers;
+
 double GetEmojiStickerZoom(not_null<Main::Session*> session) {
 	return session->account().appConfig().get<double>(
 		"emojies_animated_zoom",
@@ -57,6 +69,11 @@ bool Sticker::isEmojiSticker() const {
 	return (_parent->data()->media() == nullptr);
 }
 
+bool Sticker::playOnce() const {
+	return isEmojiSticker()
+		|| !_document->session().settings().loopAnimatedStickers();
+}
+
 QSize Sticker::size() {
 	_size = _document->dimensions;
 	const auto maxHeight = int(st::maxStickerSize / 256.0 * StickerHeight());
@@ -111,8 +128,7 @@ void Sticker::paintLottie(Painter &p, const QRect &r, bool selected) {
 		frame.image);
 
 	const auto paused = App::wnd()->sessionController()->isGifPausedAtLeastFor(Window::GifPauseReason::Any);
-	const auto playOnce = isEmojiSticker()
-		|| !_document->session().settings().loopAnimatedStickers();
+	const auto playOnce = this->playOnce();
 	if (!paused
 		&& (!playOnce || frame.index != 0 || !_lottieOncePlayed)
 		&& _lottie->markFrameShown()
@@ -190,12 +206,39 @@ void Sticker::refreshLink() {
 }
 
 void Sticker::setupLottie() {
-	_lottie = Stickers::LottiePlayerFromDocument(
-		_document,
-		_replacements,
-		Stickers::LottieSize::MessageHistory,
-		_size * cIntRetinaFactor(),
-		Lottie::Quality::High);
+	const auto box = _size * cIntRetinaFactor();
+	const auto create = [&] {
+		return std::shared_ptr<Lottie::SinglePlayer>(
+			Stickers::LottiePlayerFromDocument(
+				_document,
+				_replacements,
+				Stickers::LottieSize::MessageHistory,
+				box,
+				Lottie::Quality::High));
+	};
+	if (playOnce()) {
+		// Each view stops after its own first loop, they can't share.
+		_lottie = create();
+	} else {
+		const auto key = SharedLottieKey{
+			_document,
+			_replacements,
+			box.width(),
+			box.height() };
+		auto &weak = SharedLottiePlayers[key];
+		_lottie = weak.lock();
+		if (!_lottie) {
+			_lottie = create();
+			weak = _lottie;
+		}
+		for (auto i = begin(SharedLottiePlayers); i != end(SharedLottiePlayers);) {
+			if (i->second.expired()) {
+				i = SharedLottiePlayers.erase(i);
+			} else {
+				++i;
+			}
+		}
+	}
 	_parent->data()->history()->owner().registerHeavyViewPart(_parent);
 
 	_lottie->updates(
@@ -212,6 +255,7 @@ void Sticker::unloadLottie() {
 	if (!_lottie) {
 		return;
 	}
+	_lifetime.destroy();
 	_lottie = nullptr;
 	_parent->data()->history()->owner().unregisterHeavyViewPart(_parent);
 }
@@ -50,6 +50,7 @@ public:
 
 private:
 	[[nodiscard]] bool isEmojiSticker() const;
+	[[nodiscard]] bool playOnce() const;
 	void paintLottie(Painter &p, const QRect &r, bool selected);
 	void paintPixmap(Painter &p, const QRect &r, bool selected);
 	[[nodiscard]] QPixmap paintedPixmap(bool selected) const;
@@ -60,7 +61,7 @@ private:
 	const not_null<Element*> _parent;
 	const not_null<DocumentData*> _document;
 	const Lottie::ColorReplacements *_replacements = nullptr;
-	std::unique_ptr<Lottie::SinglePlayer> _lottie;
+	std::shared_ptr<Lottie::SinglePlayer> _lottie;
 	ClickHandlerPtr _link;
 	QSize _size;
 	mutable bool _lottieOncePlayed = false;
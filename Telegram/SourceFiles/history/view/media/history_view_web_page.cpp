@@ -417,8 +417,17 @@ void WebPage::refreshParentId(not_null<HistoryItem*> realParent) {
 	}
 }
 
+void WebPage::loadPreview() const {
+	if (_attach) {
+		_attach->loadPreview();
+	} else if (asArticle()) {
+		_data->photo->loadThumbnail(_parent->data()->fullId());
+	}
+}
+
 void WebPage::draw(Painter &p, const QRect &r, TextSelection selection, crl::time ms) const {
 	if (width() < st::msgPadding.left() + st::msgPadding.right() + 1) return;
+	loadPreview();
 	auto paintx = 0, painty = 0, paintw = width(), painth = height();
 
 	auto outbg = _parent->hasOutLayout();
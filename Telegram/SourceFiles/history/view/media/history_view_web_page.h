@@ -59,6 +59,8 @@ public:
 	DocumentData *getDocument() const override {
 		return _attach ? _attach->getDocument() : nullptr;
 	}
+	void loadPreview() const override;
+
 	void stopAnimation() override {
 		if (_attach) _attach->stopAnimation();
 	}
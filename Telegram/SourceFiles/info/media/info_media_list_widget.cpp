@@ -50,6 +50,7 @@ constexpr auto kPreloadIfLessThanScreens = 2;
 constexpr auto kPreloadedScreensCountFull
 	= kPreloadedScreensCount + 1 + kPreloadedScreensCount;
 constexpr auto kMediaCountForSearch = 10;
+constexpr auto kThumbnailsPerPaint = 8;
 
 UniversalMsgId GetUniversalId(FullMsgId itemId) {
 	return (itemId.channel != 0)
@@ -1143,12 +1144,17 @@ void ListWidget::paintEvent(QPaintEvent *e) {
 		&_dragSelected,
 		_dragSelectAction
 	};
+	context.layoutContext.thumbnailsBudget = kThumbnailsPerPaint;
 	for (auto it = fromSectionIt; it != tillSectionIt; ++it) {
 		auto top = it->top();
 		p.translate(0, top);
 		it->paint(p, context, clip.translated(0, -top), outerWidth);
 		p.translate(0, -top);
 	}
+	if (context.layoutContext.thumbnailsDelayed) {
+		// Prepare the remaining thumbnails in the next frames.
+		crl::on_main(this, [=] { update(); });
+	}
 }
 
 void ListWidget::mousePressEvent(QMouseEvent *e) {
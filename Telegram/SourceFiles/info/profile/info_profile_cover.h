@@ -9,7 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "ui/wrap/padding_wrap.h"
 #include "ui/widgets/checkbox.h"
-#include "base/timer.h"
+#include "core/timer_wheel.h"
 
 namespace Window {
 class SessionController;
@@ -97,7 +97,7 @@ private:
 	object_ptr<Ui::RpWidget> _scamBadge = { nullptr };
 	object_ptr<Ui::FlatLabel> _status = { nullptr };
 	//object_ptr<CoverDropArea> _dropArea = { nullptr };
-	base::Timer _refreshStatusTimer;
+	Core::WheelTimer _refreshStatusTimer;
 
 	rpl::event_stream<Section> _showSection;
 
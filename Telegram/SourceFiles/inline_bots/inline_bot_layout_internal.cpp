@@ -141,7 +141,7 @@ void Gif::paint(Painter &p, const QRect &clip, const PaintContext *context) cons
 	document->automaticLoad(fileOrigin(), nullptr);
 
 	bool loaded = document->loaded(), loading = document->loading(), displayLoading = document->displayLoading();
-	if (loaded && !_gif && !_gif.isBad()) {
+	if (loaded && !_gif && !_gif.isBad() && !context->scrolling) {
 		auto that = const_cast<Gif*>(this);
 		that->_gif = Media::Clip::MakeReader(document, FullMsgId(), [that](Media::Clip::Notification notification) {
 			that->clipCallback(notification);
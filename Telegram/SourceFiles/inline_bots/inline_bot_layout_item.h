@@ -27,6 +27,10 @@ public:
 	}
 	bool paused, lastRow;
 
+	// While the list is scrolled fast new animations are not started,
+	// the items are repainted once the scrolling stops.
+	bool scrolling = false;
+
 };
 
 // this type used as a flag, we dynamic_cast<> to it
@@ -86,6 +86,9 @@ void Inner::visibleTopBottomUpdated(
 		_visibleTop = visibleTop;
 		_lastScrolled = crl::now();
 	}
+	if (isVisible()) {
+		preloadImages();
+	}
 }
 
 void Inner::checkRestrictedPeer() {
@@ -430,10 +433,26 @@ Inner::Row &Inner::layoutInlineRow(Row &row, int32 sumWidth) {
 }
 
 void Inner::preloadImages() {
+	// Gallery bots return large pages, so only the thumbnails of the rows
+	// around the visible ones are requested, the rest wait for a scroll.
+	const auto known = (_visibleBottom > _visibleTop);
+	const auto visibleHeight = _visibleBottom - _visibleTop;
+	const auto preloadTop = _visibleTop - visibleHeight;
+	const auto preloadBottom = _visibleBottom + visibleHeight;
+	auto top = st::stickerPanPadding;
+	if (_switchPmButton) {
+		top += _switchPmButton->height() + st::inlineResultsSkip;
+	}
 	for (auto row = 0, rows = _rows.size(); row != rows; ++row) {
-		for (auto col = 0, cols = _rows[row].items.size(); col != cols; ++col) {
-			_rows[row].items[col]->preload();
+		const auto bottom = top + _rows[row].height;
+		if (known && top >= preloadBottom) {
+			break;
+		} else if (!known || bottom > preloadTop) {
+			for (auto col = 0, cols = _rows[row].items.size(); col != cols; ++col) {
+				_rows[row].items[col]->preload();
+			}
 		}
+		top = bottom;
 	}
 }
 
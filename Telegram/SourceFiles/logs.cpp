@@ -11,10 +11,18 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/crash_reports.h"
 #include "core/launcher.h"
 
+#include <QtCore/QWaitCondition>
+
 namespace {
 
 std::atomic<int> ThreadCounter/* = 0*/;
 
+// Debug lines waiting for the background writer, in UTF-16 code units.
+constexpr auto kDebugQueueLimit = 2 * 1024 * 1024;
+
+// How long the crash handler waits for the queue, in milliseconds.
+constexpr auto kDebugQueueCrashTimeout = 1000;
+
 } // namespace
 
 enum LogDataType {
@@ -241,12 +249,111 @@ using LogsInMemoryList = QList<QPair<LogDataType, QString>>;
 LogsInMemoryList *LogsInMemory = 0;
 LogsInMemoryList *DeletedLogsInMemory = SharedMemoryLocation<LogsInMemoryList, 0>();
 
+// Debug, tcp and mtp lines are written and flushed to disk on a background
+// thread, so that logging from the MTProto threads doesn't wait for the
+// disk. The queue is bounded, lines that don't fit are dropped and counted.
+// The main log is still written right away, it must survive a crash.
+class DebugLogsQueue final {
+public:
+	void push(LogDataType type, const QString &msg) {
+		QMutexLocker lock(&_mutex);
+		if (_finished) {
+			return;
+		} else if (_size + msg.size() > kDebugQueueLimit) {
+			++_dropped;
+			return;
+		}
+		_size += msg.size();
+		_list.push_back(qMakePair(type, msg));
+		if (!_writing) {
+			_writing = true;
+			crl::async([=] { write(); });
+		}
+	}
+
+	// Waits for the background writer before LogsData is destroyed,
+	// lines pushed after that are ignored.
+	void finish() {
+		QMutexLocker lock(&_mutex);
+		while (_writing) {
+			_writingFinished.wait(&_mutex);
+		}
+		_finished = true;
+	}
+
+	// Called from the crash handler, so it doesn't wait for the locks
+	// that the crashed thread could be holding.
+	void flushCrashed() {
+		if (!_mutex.tryLock(kDebugQueueCrashTimeout)) {
+			return;
+		}
+		const auto list = base::take(_list);
+		const auto dropped = base::take(_dropped);
+		_size = 0;
+		_finished = true;
+		_mutex.unlock();
+
+		if (!_writeMutex.tryLock(kDebugQueueCrashTimeout)) {
+			return;
+		}
+		writeList(list, dropped);
+		_writeMutex.unlock();
+	}
+
+private:
+	void write() {
+		while (true) {
+			QMutexLocker lock(&_mutex);
+			if (_list.isEmpty()) {
+				_writing = false;
+				_writingFinished.wakeAll();
+				return;
+			}
+			const auto list = base::take(_list);
+			const auto dropped = base::take(_dropped);
+			_size = 0;
+			lock.unlock();
+
+			QMutexLocker writeLock(&_writeMutex);
+			writeList(list, dropped);
+		}
+	}
+
+	void writeList(const LogsInMemoryList &list, int dropped) {
+		if (!LogsData) {
+			return;
+		}
+		if (dropped > 0) {
+			LogsData->write(
+				LogDataDebug,
+				QString("[%1 debug log lines dropped]\n").arg(dropped));
+		}
+		for (const auto &entry : list) {
+			LogsData->write(entry.first, entry.second);
+		}
+	}
+
+	QMutex _mutex;
+	QMutex _writeMutex;
+	QWaitCondition _writingFinished;
+	LogsInMemoryList _list;
+	int _size = 0;
+	int _dropped = 0;
+	bool _writing = false;
+	bool _finished = false;
+
+};
+
+DebugLogsQueue DebugLogs;
+
 QString LogsBeforeSingleInstanceChecked; // LogsInMemory already dumped in LogsData, but LogsData is about to be deleted
 
 void _logsWrite(LogDataType type, const QString &msg) {
 	if (LogsData && (type == LogDataMain || LogsStartIndexChosen < 0)) {
-		if (type == LogDataMain || Logs::DebugEnabled()) {
+		if (type == LogDataMain) {
 			LogsData->write(type, msg);
+		} else if (Logs::DebugEnabled()) {
+			DebugLogs.push(type, msg);
 		}
 	} else if (LogsInMemory != DeletedLogsInMemory) {
 		if (!LogsInMemory) {
@@ -455,6 +562,7 @@ void start(not_null<Core::Launcher*> launcher) {
 }
 
 void finish() {
+	DebugLogs.finish();
 	delete LogsData;
 	LogsData = 0;
 
@@ -478,6 +586,7 @@ bool instanceChecked() {
 	if (!LogsData->instanceChecked()) {
 		LogsBeforeSingleInstanceChecked = Logs::full();
 
+		DebugLogs.finish();
 		delete LogsData;
 		LogsData = 0;
 		LOG(("FATAL: Could not move logging to '%1'!").arg(_logsFilePath(LogDataMain)));
@@ -517,6 +626,10 @@ void multipleInstances() {
 	LogsBeforeSingleInstanceChecked.clear();
 }
 
+void flushCrashed() {
+	DebugLogs.flushCrashed();
+}
+
 void closeMain() {
 	LOG(("Explicitly closing main log and finishing crash handlers."));
 	if (LogsData) {
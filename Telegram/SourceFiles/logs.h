@@ -30,6 +30,9 @@ void multipleInstances();
 
 void closeMain();
 
+// Writes the queued debug lines synchronously, when the app crashes.
+void flushCrashed();
+
 void writeMain(const QString &v);
 
 void writeDebug(const char *file, int32 line, const QString &v);
@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "core/launcher.h"
 #include "core/shortcuts.h"
+#include "core/startup_tracer.h"
 #include "storage/serialize_common.h"
 #include "storage/localstorage.h"
 #include "data/data_session.h"
@@ -20,9 +21,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "observer_peer.h"
 #include "main/main_app_config.h"
 #include "main/main_session.h"
+#include "base/unixtime.h"
 #include "facades.h"
 
 namespace Main {
+namespace {
+
+[[nodiscard]] TimeId LocalUnixtime() {
+	return TimeId(QDateTime::currentDateTimeUtc().toTime_t());
+}
+
+} // namespace
 
 Account::Account(const QString &dataName) {
 	watchProxyChanges();
@@ -224,6 +233,7 @@ QByteArray Account::serializeMtpAuthorization() const {
 		auto result = QByteArray();
 		auto size = sizeof(qint32) + sizeof(qint32); // userId + mainDcId
 		size += keysSize(keys) + keysSize(keysToDestroy);
+		size += sizeof(qint32); // server time delta
 		result.reserve(size);
 		{
 			QDataStream stream(&result, QIODevice::WriteOnly);
@@ -236,6 +246,10 @@ QByteArray Account::serializeMtpAuthorization() const {
 			writeKeys(stream, keys);
 			writeKeys(stream, keysToDestroy);
 
+			// Server time delta, lets the next launch send correct
+			// msg_id values right away without a bad_msg round trip.
+			stream << qint32(base::unixtime::now() - LocalUnixtime());
+
 			DEBUG_LOG(("MTP Info: Keys written, userId: %1, dcId: %2").arg(currentUserId).arg(mainDcId));
 		}
 		return result;
@@ -323,11 +337,25 @@ void Account::setMtpAuthorization(const QByteArray &serialized) {
 		"read keys, current: %1, to destroy: %2"
 		).arg(_mtpConfig.keys.size()
 		).arg(_mtpKeysToDestroy.size()));
+
+	if (!stream.atEnd()) {
+		const auto delta = Serialize::read<qint32>(stream);
+		if (stream.status() == QDataStream::Ok) {
+			// This marks the time as synced, so the time received from
+			// the server in key creation and bad_server_salt is forced.
+			base::unixtime::update(LocalUnixtime() + delta);
+			_serverTimeDeltaRestored = true;
+			LOG(("MTP Info: restored server time delta: %1").arg(delta));
+		}
+	}
 }
 
 void Account::startMtp() {
 	Expects(!_mtp);
 
+	const auto phase = Core::StartupPhase("Account::startMtp");
+	_mtpStartedAt = crl::now();
+
 	auto config = base::take(_mtpConfig);
 	config.deviceModel = Core::App().launcher()->deviceModel();
 	config.systemVersion = Core::App().launcher()->systemVersion();
@@ -387,6 +415,12 @@ bool Account::checkForUpdates(const mtpPrime *from, const mtpPrime *end) {
 	if (!updates.read(from, end)) {
 		return false;
 	}
+	if (_mtpStartedAt) {
+		LOG(("MTP Info: first updates received in %1 ms, "
+			"server time delta restored: %2"
+			).arg(crl::now() - base::take(_mtpStartedAt)
+			).arg(Logs::b(_serverTimeDeltaRestored)));
+	}
 	_mtpUpdates.fire(std::move(updates));
 	return true;
 }
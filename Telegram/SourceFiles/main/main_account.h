@@ -111,6 +111,10 @@ private:
 	MTP::AuthKeysList _mtpKeysToDestroy;
 	bool _loggingOut = false;
 
+	// Startup diagnostics for the restored server time delta.
+	crl::time _mtpStartedAt = 0;
+	bool _serverTimeDeltaRestored = false;
+
 	rpl::lifetime _lifetime;
 
 };
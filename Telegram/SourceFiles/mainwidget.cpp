@@ -2837,13 +2837,14 @@ void MainWidget::searchInChat(Dialogs::Key chat) {
 void MainWidget::feedUpdateVector(
 		const MTPVector<MTPUpdate> &updates,
 		bool skipMessageIds) {
+	session().data().startUpdatesBatch();
 	for (const auto &update : updates.v) {
 		if (skipMessageIds && update.type() == mtpc_updateMessageID) {
 			continue;
 		}
 		feedUpdate(update);
 	}
-	session().data().sendHistoryChangeNotifications();
+	session().data().finishUpdatesBatch();
 }
 
 void MainWidget::feedMessageIds(const MTPVector<MTPUpdate> &updates) {
@@ -2941,6 +2942,7 @@ void MainWidget::gotChannelDifference(
 
 void MainWidget::feedChannelDifference(
 		const MTPDupdates_channelDifference &data) {
+	session().data().startUpdatesBatch();
 	session().data().processUsers(data.vusers());
 	session().data().processChats(data.vchats());
 
@@ -2951,6 +2953,7 @@ void MainWidget::feedChannelDifference(
 		NewMessageType::Unread);
 	feedUpdateVector(data.vother_updates(), true);
 	_handlingChannelDifference = false;
+	session().data().finishUpdatesBatch();
 }
 
 bool MainWidget::failChannelDifference(ChannelData *channel, const RPCError &error) {
@@ -3092,11 +3095,16 @@ void MainWidget::feedDifference(
 		const MTPVector<MTPMessage> &msgs,
 		const MTPVector<MTPUpdate> &other) {
 	session().checkAutoLock();
+
+	// A difference after a long sleep may have thousands of updates,
+	// each history and item is notified about only once in the end.
+	session().data().startUpdatesBatch();
 	session().data().processUsers(users);
 	session().data().processChats(chats);
 	feedMessageIds(other);
 	session().data().processMessages(msgs, NewMessageType::Unread);
 	feedUpdateVector(other, true);
+	session().data().finishUpdatesBatch();
 }
 
 bool MainWidget::failDifference(const RPCError &error) {
@@ -3234,16 +3242,10 @@ void MainWidget::start() {
 	update();
 
 	_started = true;
-	Local::readInstalledStickers();
-	Local::readFeaturedStickers();
-	Local::readRecentStickers();
-	Local::readFavedStickers();
-	Local::readSavedGifs();
+	session().data().readLocalStickersDelayed();
 	if (const auto availableAt = Local::ReadExportSettings().availableAt) {
 		session().data().suggestStartExport(availableAt);
 	}
-	session().data().notifyStickersUpdated();
-	session().data().notifySavedGifsUpdated();
 
 	_history->start();
 
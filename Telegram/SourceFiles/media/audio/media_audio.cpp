@@ -437,8 +437,47 @@ void Mixer::Track::clear() {
 	}
 
 	setExternalData(nullptr);
-	lastUpdateWhen = 0;
-	lastUpdatePosition = 0;
+	sync.reset();
+}
+
+void Mixer::Track::SyncPoint::set(
+		uint32 playId,
+		crl::time position,
+		crl::time when) {
+	const auto version = _version.load(std::memory_order_relaxed);
+	_version.store(version + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	_playId.store(playId, std::memory_order_relaxed);
+	_position.store(position, std::memory_order_relaxed);
+	_when.store(when, std::memory_order_relaxed);
+	_version.store(version + 2, std::memory_order_release);
+}
+
+void Mixer::Track::SyncPoint::reset() {
+	set(0, 0, 0);
+}
+
+auto Mixer::Track::SyncPoint::get(uint32 playId) const
+-> std::optional<Streaming::TimePoint> {
+	while (true) {
+		const auto version = _version.load(std::memory_order_acquire);
+		if (version & 1) {
+			continue;
+		}
+		const auto id = _playId.load(std::memory_order_relaxed);
+		const auto position = _position.load(std::memory_order_relaxed);
+		const auto when = _when.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (_version.load(std::memory_order_relaxed) != version) {
+			continue;
+		} else if (id != playId || when <= 0) {
+			return std::nullopt;
+		}
+		auto result = Streaming::TimePoint();
+		result.trackTime = position;
+		result.worldTime = when;
+		return result;
+	}
 }
 
 void Mixer::Track::started() {
@@ -781,8 +820,7 @@ void Mixer::play(
 
 		current->clear(); // Clear all previous state.
 		current->state.id = audio;
-		current->lastUpdateWhen = 0;
-		current->lastUpdatePosition = 0;
+		current->sync.reset();
 		if (externalData) {
 			current->setExternalData(std::move(externalData));
 		} else {
@@ -848,31 +886,40 @@ Streaming::TimePoint Mixer::getExternalSyncTimePoint(
 		const AudioMsgId &audio) const {
 	Expects(audio.externalPlayId() != 0);
 
-	auto result = Streaming::TimePoint();
-	const auto type = audio.type();
+	// Called for each video frame, so this doesn't take the AudioMutex.
+	const auto point = findExternalSyncPoint(audio);
+	return point ? *point : Streaming::TimePoint();
+}
 
-	QMutexLocker lock(&AudioMutex);
-	const auto track = trackForType(type);
-	if (track && track->state.id == audio && track->lastUpdateWhen > 0) {
-		result.trackTime = track->lastUpdatePosition;
-		result.worldTime = track->lastUpdateWhen;
+crl::time Mixer::getExternalCorrectedTime(const AudioMsgId &audio, crl::time frameMs, crl::time systemMs) {
+	auto result = frameMs;
+	if (const auto point = findExternalSyncPoint(audio)) {
+		result = point->trackTime;
+		if (systemMs > point->worldTime) {
+			result += (systemMs - point->worldTime);
+		}
 	}
 	return result;
 }
 
-crl::time Mixer::getExternalCorrectedTime(const AudioMsgId &audio, crl::time frameMs, crl::time systemMs) {
-	auto result = frameMs;
+std::optional<Streaming::TimePoint> Mixer::findExternalSyncPoint(
+		const AudioMsgId &audio) const {
+	const auto playId = audio.externalPlayId();
+	if (!playId) {
+		return std::nullopt;
+	}
+	// Tracks are never reallocated, the sync point checks the play id.
 	const auto type = audio.type();
-
-	QMutexLocker lock(&AudioMutex);
-	const auto track = trackForType(type);
-	if (track && track->state.id == audio && track->lastUpdateWhen > 0) {
-		result = static_cast<crl::time>(track->lastUpdatePosition);
-		if (systemMs > track->lastUpdateWhen) {
-			result += (systemMs - track->lastUpdateWhen);
+	const auto count = (type == AudioMsgId::Type::Video) ? 1 : kTogetherLimit;
+	for (auto i = 0; i != count; ++i) {
+		const auto track = trackForType(type, i);
+		if (!track) {
+			break;
+		} else if (const auto point = track->sync.get(playId)) {
+			return point;
 		}
 	}
-	return result;
+	return std::nullopt;
 }
 
 void Mixer::externalSoundProgress(const AudioMsgId &audio) {
@@ -882,8 +929,10 @@ void Mixer::externalSoundProgress(const AudioMsgId &audio) {
 	const auto current = trackForType(type);
 	if (current && current->state.length && current->state.frequency) {
 		if (current->state.id == audio && current->state.state == State::Playing) {
-			current->lastUpdateWhen = crl::now();
-			current->lastUpdatePosition = (current->state.position * 1000ULL) / current->state.frequency;
+			current->sync.set(
+				audio.externalPlayId(),
+				(current->state.position * 1000ULL) / current->state.frequency,
+				crl::now());
 		}
 	}
 }
@@ -940,8 +989,7 @@ void Mixer::pause(const AudioMsgId &audio, bool fast) {
 
 		emit faderOnTimer();
 
-		track->lastUpdateWhen = 0;
-		track->lastUpdatePosition = 0;
+		track->sync.reset();
 	}
 	if (current) emit updated(current);
 }
@@ -1676,13 +1724,25 @@ public:
 
 		auto fmt = format();
 		auto peak = uint16(0);
-		auto callback = [&](uint16 sample) {
-			accumulate_max(peak, sample);
-			sumbytes += Media::Player::kWaveformSamplesCount;
-			if (sumbytes >= countbytes) {
-				sumbytes -= countbytes;
-				peaks.push_back(peak);
-				peak = 0;
+
+		// Each sample adds kWaveformSamplesCount to sumbytes and a peak is
+		// finished once sumbytes reaches countbytes, so instead of checking
+		// that for every sample we reduce whole runs up to the next peak.
+		const auto reduce = [&](auto samples) {
+			constexpr auto step = int64(Media::Player::kWaveformSamplesCount);
+			while (!samples.empty()) {
+				const auto left = (countbytes - sumbytes + step - 1) / step;
+				const auto take = std::min(int64(samples.size()), left);
+				accumulate_max(
+					peak,
+					Media::Audio::MaxSample(samples.first(take)));
+				sumbytes += take * step;
+				if (sumbytes >= countbytes) {
+					sumbytes -= countbytes;
+					peaks.push_back(peak);
+					peak = 0;
+				}
+				samples = samples.subspan(take);
 			}
 		};
 		while (processed < countbytes) {
@@ -1699,9 +1759,9 @@ public:
 
 			auto sampleBytes = bytes::make_span(buffer);
 			if (fmt == AL_FORMAT_MONO8 || fmt == AL_FORMAT_STEREO8) {
-				Media::Audio::IterateSamples<uchar>(sampleBytes, callback);
+				reduce(Media::Audio::SamplesSpan<uchar>(sampleBytes));
 			} else if (fmt == AL_FORMAT_MONO16 || fmt == AL_FORMAT_STEREO16) {
-				Media::Audio::IterateSamples<int16>(sampleBytes, callback);
+				reduce(Media::Audio::SamplesSpan<int16>(sampleBytes));
 			}
 			processed += sampleSize() * samples;
 		}
@@ -13,6 +13,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <QtCore/QTimer>
 
+#include <atomic>
+
 namespace Media {
 struct ExternalSoundData;
 struct ExternalSoundPart;
@@ -60,6 +62,10 @@ base::Observable<AudioMsgId> &Updated();
 
 float64 ComputeVolume(AudioMsgId::Type type);
 
+// Duration of decoded audio queued ahead of playback, 0 for the default.
+void SetDecodeAheadDuration(crl::time duration);
+[[nodiscard]] crl::time DecodeAheadDuration();
+
 enum class State {
 	Stopped = 0x01,
 	StoppedAtEnd = 0x02,
@@ -197,6 +203,8 @@ private:
 	bool checkCurrentALError(AudioMsgId::Type type);
 
 	void externalSoundProgress(const AudioMsgId &audio);
+	[[nodiscard]] std::optional<Streaming::TimePoint> findExternalSyncPoint(
+		const AudioMsgId &audio) const;
 
 	class Track {
 	public:
@@ -253,8 +261,24 @@ private:
 		};
 		std::unique_ptr<SpeedEffect> speedEffect;
 #endif // TDESKTOP_DISABLE_OPENAL_EFFECTS
-		crl::time lastUpdateWhen = 0;
-		crl::time lastUpdatePosition = 0;
+
+		// Written under AudioMutex, read without it by the video threads
+		// that synchronize their frames with the track (a seqlock).
+		class SyncPoint {
+		public:
+			void set(uint32 playId, crl::time position, crl::time when);
+			void reset();
+			[[nodiscard]] std::optional<Streaming::TimePoint> get(
+				uint32 playId) const;
+
+		private:
+			std::atomic<uint32> _version = 0;
+			std::atomic<uint32> _playId = 0;
+			std::atomic<crl::time> _position = 0;
+			std::atomic<crl::time> _when = 0;
+
+		};
+		SyncPoint sync;
 
 	private:
 		void createStream(AudioMsgId::Type type);
@@ -383,6 +407,24 @@ TG_FORCE_INLINE uint16 ReadOneSample(int16 data) {
 	return qAbs(data);
 }
 
+template <typename SampleType>
+gsl::span<const SampleType> SamplesSpan(bytes::const_span bytes) {
+	return gsl::make_span(
+		reinterpret_cast<const SampleType*>(bytes.data()),
+		bytes.size() / sizeof(SampleType));
+}
+
+// A plain loop without early exits, so that it gets vectorized.
+template <typename SampleType>
+uint16 MaxSample(gsl::span<const SampleType> samples) {
+	auto result = uint16(0);
+	for (const auto sample : samples) {
+		const auto value = ReadOneSample(sample);
+		result = (value > result) ? value : result;
+	}
+	return result;
+}
+
 template <typename SampleType, typename Callback>
 void IterateSamples(bytes::const_span bytes, Callback &&callback) {
 	auto samplesPointer = reinterpret_cast<const SampleType*>(bytes.data());
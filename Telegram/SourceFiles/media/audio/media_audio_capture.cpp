@@ -54,6 +54,7 @@ Instance::Instance() : _inner(new Inner(&_thread)) {
 	connect(this, SIGNAL(stop(bool)), _inner, SLOT(onStop(bool)));
 	connect(_inner, SIGNAL(done(QByteArray, VoiceWaveform, qint32)), this, SIGNAL(done(QByteArray, VoiceWaveform, qint32)));
 	connect(_inner, SIGNAL(updated(quint16, qint32)), this, SIGNAL(updated(quint16, qint32)));
+	connect(_inner, SIGNAL(encoded(QByteArray)), this, SIGNAL(encoded(QByteArray)));
 	connect(_inner, SIGNAL(error()), this, SIGNAL(error()));
 	connect(&_thread, SIGNAL(started()), _inner, SLOT(onInit()));
 	connect(&_thread, SIGNAL(finished()), _inner, SLOT(deleteLater()));
@@ -106,6 +107,7 @@ struct Instance::Inner::Private {
 
 	QByteArray data;
 	int32 dataPos = 0;
+	int32 dataEncoded = 0;
 
 	int64 waveformMod = 0;
 	int64 waveformEach = (kCaptureFrequency / 100);
@@ -339,6 +341,7 @@ void Instance::Inner::onStop(bool needResult) {
 		if ((_captured.size() % sizeof(short)) || (d->fullSamples + capturedSamples < kCaptureFrequency) || (capturedSamples < fadeSamples)) {
 			d->fullSamples = 0;
 			d->dataPos = 0;
+			d->dataEncoded = 0;
 			d->data.clear();
 			d->waveformMod = 0;
 			d->waveformPeak = 0;
@@ -364,6 +367,7 @@ void Instance::Inner::onStop(bool needResult) {
 			if (encoded != _captured.size()) {
 				d->fullSamples = 0;
 				d->dataPos = 0;
+				d->dataEncoded = 0;
 				d->data.clear();
 				d->waveformMod = 0;
 				d->waveformPeak = 0;
@@ -460,6 +464,7 @@ void Instance::Inner::onStop(bool needResult) {
 		d->levelMax = 0;
 
 		d->dataPos = 0;
+		d->dataEncoded = 0;
 		d->data.clear();
 
 		d->waveformMod = 0;
@@ -529,12 +534,24 @@ void Instance::Inner::onTimeout() {
 			int32 goodSize = _captured.size() - encoded;
 			memmove(_captured.data(), _captured.constData() + encoded, goodSize);
 			_captured.resize(goodSize);
+
+			emitEncoded();
 		}
 	} else {
 		DEBUG_LOG(("Audio Capture: no samples to capture."));
 	}
 }
 
+void Instance::Inner::emitEncoded() {
+	// Bytes already emitted are never rewritten, the ogg muxer
+	// only appends pages. If it did, the receiver would notice
+	// a mismatch with the final data and discard what it got.
+	if (d->dataEncoded < d->data.size()) {
+		emit encoded(d->data.mid(d->dataEncoded));
+		d->dataEncoded = d->data.size();
+	}
+}
+
 void Instance::Inner::processFrame(int32 offset, int32 framesize) {
 	// Prepare audio frame
 
@@ -36,6 +36,7 @@ signals:
 
 	void done(QByteArray data, VoiceWaveform waveform, qint32 samples);
 	void updated(quint16 level, qint32 samples);
+	void encoded(QByteArray data);
 	void error();
 
 private:
@@ -60,6 +61,7 @@ public:
 signals:
 	void error();
 	void updated(quint16 level, qint32 samples);
+	void encoded(QByteArray data);
 	void done(QByteArray data, VoiceWaveform waveform, qint32 samples);
 
 public slots:
@@ -74,6 +76,9 @@ private:
 
 	void writeFrame(AVFrame *frame);
 
+	// Emits encoded() with the bytes the muxer has written since last time.
+	void emitEncoded();
+
 	// Writes the packets till EAGAIN is got from av_receive_packet()
 	// Returns number of packets written or -1 on error
 	int writePackets();
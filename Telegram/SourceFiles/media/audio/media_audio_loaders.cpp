@@ -16,9 +16,42 @@ namespace Player {
 namespace {
 
 constexpr auto kPlaybackBufferSize = 256 * 1024;
+constexpr auto kPlaybackBufferSizeMin = 32 * 1024;
+constexpr auto kPlaybackBufferSizeMax = 4 * 1024 * 1024;
+
+// Track::kBuffersCount buffers are queued to a source at the same time.
+constexpr auto kQueuedBuffersCount = 3;
+
+std::atomic<crl::time> DecodeAhead = 0;
+
+[[nodiscard]] int PlaybackBufferSize(int format, int frequency) {
+	const auto duration = DecodeAhead.load();
+	if (duration <= 0 || frequency <= 0) {
+		return kPlaybackBufferSize;
+	}
+	const auto bytesPerFrame = (format == AL_FORMAT_STEREO16)
+		? 4
+		: (format == AL_FORMAT_MONO8)
+		? 1
+		: 2;
+	const auto perBuffer = duration * frequency * bytesPerFrame
+		/ (1000 * kQueuedBuffersCount);
+	return int(std::clamp(
+		perBuffer,
+		crl::time(kPlaybackBufferSizeMin),
+		crl::time(kPlaybackBufferSizeMax)));
+}
 
 } // namespace
 
+void SetDecodeAheadDuration(crl::time duration) {
+	DecodeAhead = std::max(duration, crl::time(0));
+}
+
+crl::time DecodeAheadDuration() {
+	return DecodeAhead.load();
+}
+
 Loaders::Loaders(QThread *thread)
 : _fromExternalNotify([=] { videoSoundAdded(); }) {
 	moveToThread(thread);
@@ -166,12 +199,16 @@ void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 	auto waiting = false;
 	auto errAtStart = started;
 
+	const auto bufferSize = PlaybackBufferSize(
+		l->format(),
+		l->samplesFrequency());
+
 	QByteArray samples;
 	int64 samplesCount = 0;
 	if (l->holdsSavedDecodedSamples()) {
 		l->takeSavedDecodedSamples(&samples, &samplesCount);
 	}
-	while (samples.size() < kPlaybackBufferSize) {
+	while (samples.size() < bufferSize) {
 		auto res = l->readMore(samples, samplesCount);
 		using Result = AudioPlayerLoader::ReadResult;
 		if (res == Result::Error) {
@@ -193,7 +230,7 @@ void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 		} else if (res == Result::Ok) {
 			errAtStart = false;
 		} else if (res == Result::Wait) {
-			waiting = (samples.size() < kPlaybackBufferSize)
+			waiting = (samples.size() < bufferSize)
 				&& (!samplesCount || !l->forceToBuffer());
 			if (waiting) {
 				l->saveDecodedSamples(&samples, &samplesCount);
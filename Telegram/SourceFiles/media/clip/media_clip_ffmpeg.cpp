@@ -18,6 +18,11 @@ namespace {
 
 constexpr auto kSkipInvalidDataPackets = 10;
 
+// When inspecting a file for sending only the container metadata and
+// the first keyframe are needed, don't read much while probing streams.
+constexpr auto kInspectProbeSize = 1024 * 1024;
+constexpr auto kInspectAnalyzeDuration = AV_TIME_BASE;
+
 // See https://github.com/telegramdesktop/tdesktop/issues/7225
 constexpr auto kAlignImageBy = 64;
 
@@ -212,7 +217,12 @@ crl::time FFMpegReaderImplementation::framePresentationTime() const {
 }
 
 crl::time FFMpegReaderImplementation::durationMs() const {
-	if (_fmtContext->streams[_streamId]->duration == AV_NOPTS_VALUE) return 0;
+	if (_fmtContext->streams[_streamId]->duration == AV_NOPTS_VALUE) {
+		// Some containers have only the overall duration in the header.
+		return (_fmtContext->duration != AV_NOPTS_VALUE)
+			? (_fmtContext->duration * 1000LL / AV_TIME_BASE)
+			: 0;
+	}
 	return (_fmtContext->streams[_streamId]->duration * 1000LL * _fmtContext->streams[_streamId]->time_base.num) / _fmtContext->streams[_streamId]->time_base.den;
 }
 
@@ -243,16 +253,20 @@ bool FFMpegReaderImplementation::renderFrame(QImage &to, bool &hasAlpha, const Q
 			memcpy(d + i * dbpl, s + i * sbpl, bpl);
 		}
 	} else {
-		if ((_swsSize != toSize) || (_frame->format != -1 && _frame->format != _codecContext->pix_fmt) || !_swsContext) {
-			_swsSize = toSize;
-			_swsContext = sws_getCachedContext(_swsContext, _frame->width, _frame->height, AVPixelFormat(_frame->format), toSize.width(), toSize.height(), AV_PIX_FMT_BGRA, 0, nullptr, nullptr, nullptr);
+		_swscale = FFmpeg::MakeSwscalePointer(
+			_frame.get(),
+			toSize,
+			&_swscale);
+		if (!_swscale) {
+			LOG(("Gif Error: Unable to create swscale context %1").arg(logData()));
+			return false;
 		}
 		// AV_NUM_DATA_POINTERS defined in AVFrame struct
 		uint8_t *toData[AV_NUM_DATA_POINTERS] = { to.bits(), nullptr };
 		int toLinesize[AV_NUM_DATA_POINTERS] = { to.bytesPerLine(), 0 };
 		int res;
-		if ((res = sws_scale(_swsContext, _frame->data, _frame->linesize, 0, _frame->height, toData, toLinesize)) != _swsSize.height()) {
-			LOG(("Gif Error: Unable to sws_scale to good size %1, height %2, should be %3").arg(logData()).arg(res).arg(_swsSize.height()));
+		if ((res = sws_scale(_swscale.get(), _frame->data, _frame->linesize, 0, _frame->height, toData, toLinesize)) != toSize.height()) {
+			LOG(("Gif Error: Unable to sws_scale to good size %1, height %2, should be %3").arg(logData()).arg(res).arg(toSize.height()));
 			return false;
 		}
 	}
@@ -310,6 +324,10 @@ bool FFMpegReaderImplementation::start(Mode mode, crl::time &positionMs) {
 		return false;
 	}
 	_fmtContext->pb = _ioContext;
+	if (_mode == Mode::Inspecting) {
+		_fmtContext->probesize = kInspectProbeSize;
+		_fmtContext->max_analyze_duration = kInspectAnalyzeDuration;
+	}
 
 	int res = 0;
 	char err[AV_ERROR_MAX_STRING_SIZE] = { 0 };
@@ -368,6 +386,11 @@ bool FFMpegReaderImplementation::start(Mode mode, crl::time &positionMs) {
 		LOG(("Gif Error: Unable to avcodec_open2 %1, error %2, %3").arg(logData()).arg(res).arg(av_make_error_string(err, sizeof(err), res)));
 		return false;
 	}
+	if (_mode == Mode::Inspecting) {
+		// The thumbnail is taken from the first keyframe,
+		// don't decode any frames that could be there before it.
+		_codecContext->skip_frame = AVDISCARD_NONKEY;
+	}
 
 	std::unique_ptr<ExternalSoundData> soundData;
 	if (_audioStreamId >= 0) {
@@ -473,7 +496,6 @@ QString FFMpegReaderImplementation::logData() const {
 
 FFMpegReaderImplementation::~FFMpegReaderImplementation() {
 	if (_codecContext) avcodec_free_context(&_codecContext);
-	if (_swsContext) sws_freeContext(_swsContext);
 	if (_opened) {
 		avformat_close_input(&_fmtContext);
 	}
@@ -99,8 +99,7 @@ private:
 
 	int _width = 0;
 	int _height = 0;
-	SwsContext *_swsContext = nullptr;
-	QSize _swsSize;
+	FFmpeg::SwscalePointer _swscale;
 
 	crl::time _frameMs = 0;
 	int _nextFrameDelay = 0;
@@ -32,6 +32,14 @@ namespace {
 QVector<QThread*> threads;
 QVector<Manager*> managers;
 
+[[nodiscard]] int ThreadsCount() {
+	static const auto result = std::clamp(
+		QThread::idealThreadCount(),
+		2,
+		int(ClipThreadsCount));
+	return result;
+}
+
 QImage PrepareFrameImage(const FrameRequest &request, const QImage &original, bool hasAlpha, QImage &cache) {
 	auto needResize = (original.width() != request.framew) || (original.height() != request.frameh);
 	auto needOuterFill = (request.outerw != request.framew) || (request.outerh != request.frameh);
@@ -110,7 +118,7 @@ Reader::Reader(const QByteArray &data, Callback &&callback, Mode mode, crl::time
 }
 
 void Reader::init(const FileLocation &location, const QByteArray &data) {
-	if (threads.size() < ClipThreadsCount) {
+	if (threads.size() < ThreadsCount()) {
 		_threadIndex = threads.size();
 		threads.push_back(new QThread());
 		managers.push_back(new Manager(threads.back()));
@@ -609,6 +617,12 @@ private:
 
 };
 
+int32 Manager::ReaderLoad(not_null<const ReaderPrivate*> reader) {
+	return (reader->_width > 0)
+		? (reader->_width * reader->_height)
+		: AverageGifSize;
+}
+
 Manager::Manager(QThread *thread) {
 	moveToThread(thread);
 	connect(thread, SIGNAL(started()), this, SLOT(process()));
@@ -709,6 +723,10 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, c
 			if (reader->_frames[ishowing].when + WaitBeforeGifPause < ms || (reader->_frames[iprevious].when && previous->displayed.loadAcquire() <= 0)) {
 				reader->_autoPausedGif = true;
 				it.key()->_autoPausedGif.storeRelease(1);
+
+				// Paused GIFs don't take decoding time, so new readers
+				// should prefer threads with fewer visible ones.
+				_loadLevel.fetchAndAddRelaxed(-ReaderLoad(reader));
 				result = ProcessResult::Paused;
 			}
 		}
@@ -738,7 +756,7 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, c
 
 Manager::ResultHandleState Manager::handleResult(ReaderPrivate *reader, ProcessResult result, crl::time ms) {
 	if (!handleProcessResult(reader, result, ms)) {
-		_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : AverageGifSize));
+		removeLoad(reader);
 		delete reader;
 		return ResultHandleRemove;
 	}
@@ -792,6 +810,7 @@ void Manager::process() {
 					i.value() = ms;
 					if (i.key()->_autoPausedGif && !it.key()->_autoPausedGif.loadAcquire()) {
 						i.key()->_autoPausedGif = false;
+						_loadLevel.fetchAndAddRelaxed(ReaderLoad(i.key()));
 					}
 					if (it.key()->_videoPauseRequest.loadAcquire()) {
 						i.key()->pauseVideo(ms);
@@ -807,30 +826,41 @@ void Manager::process() {
 		checkAllReaders = (_readers.size() > _readerPointers.size());
 	}
 
+	// Process due readers by their frame deadlines, most overdue first,
+	// so a late visible frame doesn't wait for readers ahead in the map.
+	auto due = std::vector<std::pair<crl::time, ReaderPrivate*>>();
+	for (auto i = _readers.begin(), e = _readers.end(); i != e; ++i) {
+		if (i.value() <= ms) {
+			due.emplace_back(i.value(), i.key());
+		}
+	}
+	ranges::sort(due);
+	for (const auto &[deadline, reader] : due) {
+		ResultHandleState state = handleResult(reader, reader->process(ms), ms);
+		if (state == ResultHandleRemove) {
+			_readers.remove(reader);
+			continue;
+		} else if (state == ResultHandleStop) {
+			_processingInThread = nullptr;
+			return;
+		}
+		ms = crl::now();
+		if (reader->_videoPausedAtMs) {
+			_readers[reader] = ms + 86400 * 1000ULL;
+		} else if (reader->_nextFrameWhen && reader->_started) {
+			_readers[reader] = reader->_nextFrameWhen;
+		} else {
+			_readers[reader] = (ms + 86400 * 1000ULL);
+		}
+	}
+
 	for (auto i = _readers.begin(), e = _readers.end(); i != e;) {
 		ReaderPrivate *reader = i.key();
-		if (i.value() <= ms) {
-			ResultHandleState state = handleResult(reader, reader->process(ms), ms);
-			if (state == ResultHandleRemove) {
-				i = _readers.erase(i);
-				continue;
-			} else if (state == ResultHandleStop) {
-				_processingInThread = nullptr;
-				return;
-			}
-			ms = crl::now();
-			if (reader->_videoPausedAtMs) {
-				i.value() = ms + 86400 * 1000ULL;
-			} else if (reader->_nextFrameWhen && reader->_started) {
-				i.value() = reader->_nextFrameWhen;
-			} else {
-				i.value() = (ms + 86400 * 1000ULL);
-			}
-		} else if (checkAllReaders) {
+		if (checkAllReaders) {
 			QMutexLocker lock(&_readerPointersMutex);
 			auto it = constUnsafeFindReaderPointer(reader);
 			if (it == _readerPointers.cend()) {
-				_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : AverageGifSize));
+				removeLoad(reader);
 				delete reader;
 				i = _readers.erase(i);
 				continue;
@@ -853,6 +883,12 @@ void Manager::process() {
 	_processingInThread = nullptr;
 }
 
+void Manager::removeLoad(ReaderPrivate *reader) {
+	if (!reader->_autoPausedGif) {
+		_loadLevel.fetchAndAddRelaxed(-ReaderLoad(reader));
+	}
+}
+
 void Manager::finish() {
 	_timer.stop();
 	clear();
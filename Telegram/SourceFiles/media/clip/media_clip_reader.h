@@ -272,6 +272,8 @@ public slots:
 private:
 
 	void clear();
+	void removeLoad(ReaderPrivate *reader);
+	static int32 ReaderLoad(not_null<const ReaderPrivate*> reader);
 
 	QAtomicInt _loadLevel;
 	using ReaderPointers = QMap<Reader*, QAtomicInt>;
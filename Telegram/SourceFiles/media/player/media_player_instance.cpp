@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/audio/media_audio_capture.h"
 #include "media/streaming/media_streaming_instance.h"
 #include "media/streaming/media_streaming_player.h"
+#include "media/streaming/media_streaming_document.h"
 #include "media/view/media_view_playback_progress.h"
 #include "calls/calls_instance.h"
 #include "history/history.h"
@@ -44,6 +45,10 @@ constexpr auto kIdsPreloadAfter = 28;
 
 constexpr auto kMinLengthForSavePosition = 20 * TimeId(60); // 20 minutes.
 
+// Start loading the next playlist track when this much playback is left.
+constexpr auto kPrefetchNextBefore = crl::time(10000);
+constexpr auto kPrefetchNextBytes = 512 * 1024;
+
 } // namespace
 
 struct Instance::Streamed {
@@ -173,6 +178,10 @@ void Instance::setCurrent(const AudioMsgId &audioId) {
 			&& changed(data->streamed->id)) {
 			clearStreamed(data);
 		}
+		if (data->prefetchedId != audioId.contextId()) {
+			data->prefetched = nullptr;
+			data->prefetchedId = FullMsgId();
+		}
 		data->current = audioId;
 		data->isPlaying = false;
 
@@ -431,6 +440,10 @@ void Instance::playStreamed(
 
 	data->streamed->instance.play(streamingOptions(audioId));
 
+	// The prefetched document (if it was this one) is held by the instance.
+	data->prefetched = nullptr;
+	data->prefetchedId = FullMsgId();
+
 	emitUpdate(audioId.type());
 }
 
@@ -660,6 +673,9 @@ void Instance::emitUpdate(AudioMsgId::Type type, CheckCallback check) {
 			}
 		}
 		_updatedNotifier.fire_copy({state});
+		if (state.state == State::Playing && !data->repeatEnabled) {
+			prefetchNext(data, state);
+		}
 		if (data->isPlaying && state.state == State::StoppedAtEnd) {
 			if (data->repeatEnabled) {
 				play(data->current);
@@ -671,6 +687,37 @@ void Instance::emitUpdate(AudioMsgId::Type type, CheckCallback check) {
 	}
 }
 
+void Instance::prefetchNext(not_null<Data*> data, const TrackState &state) {
+	if (!data->playlistIndex || !state.frequency || !state.length) {
+		return;
+	}
+	const auto left = (state.length - state.position) * 1000
+		/ state.frequency;
+	if (left > kPrefetchNextBefore) {
+		return;
+	}
+	const auto item = itemByIndex(data, *data->playlistIndex + 1);
+	if (!item || item->fullId() == data->prefetchedId) {
+		return;
+	}
+	const auto media = item->media();
+	const auto document = media ? media->document() : nullptr;
+	if (!document
+		|| (!document->isAudioFile()
+			&& !document->isVoiceMessage()
+			&& !document->isVideoMessage())) {
+		return;
+	}
+	data->prefetchedId = item->fullId();
+	data->prefetched = document->owner().streaming().sharedDocument(
+		document,
+		item->fullId());
+	if (data->prefetched) {
+		// Keeping the document alive makes the autonext play() reuse it.
+		data->prefetched->player().prefetch(kPrefetchNextBytes);
+	}
+}
+
 void Instance::setupShortcuts() {
 	Shortcuts::Requests(
 	) | rpl::start_with_next([=](not_null<Shortcuts::Request*> request) {
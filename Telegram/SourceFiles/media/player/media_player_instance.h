@@ -187,6 +187,8 @@ private:
 		bool isPlaying = false;
 		bool resumeOnCallEnd = false;
 		std::unique_ptr<Streamed> streamed;
+		std::shared_ptr<Streaming::Document> prefetched;
+		FullMsgId prefetchedId;
 	};
 
 	Instance();
@@ -226,6 +228,7 @@ private:
 		Streaming::Error &&error);
 
 	void clearStreamed(not_null<Data*> data, bool savePosition = true);
+	void prefetchNext(not_null<Data*> data, const TrackState &state);
 	void emitUpdate(AudioMsgId::Type type);
 	template <typename CheckCallback>
 	void emitUpdate(AudioMsgId::Type type, CheckCallback check);
@@ -44,6 +44,7 @@ struct PlaybackOptions {
 	AudioMsgId audioId;
 	bool syncVideoByAudio = true;
 	bool waitForMarkAsShown = false;
+	bool keyframesOnly = false;
 	bool loop = false;
 };
 
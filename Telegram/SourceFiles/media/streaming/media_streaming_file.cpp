@@ -17,6 +17,20 @@ namespace {
 
 constexpr auto kMaxSingleReadAmount = 8 * 1024 * 1024;
 constexpr auto kMaxQueuedPackets = 1024;
+constexpr auto kKeyframesSaveEach = 16;
+constexpr auto kKeyframesMax = 16 * 1024;
+
+[[nodiscard]] int64 ComputeBitRate(not_null<AVFormatContext*> format, int size) {
+	if (format->bit_rate > 0) {
+		return format->bit_rate;
+	} else if (format->duration == AV_NOPTS_VALUE || format->duration <= 0) {
+		return 0;
+	}
+	const auto duration = FFmpeg::PtsToTime(
+		format->duration,
+		FFmpeg::kUniversalTimeBase);
+	return (duration > 0) ? (int64(size) * 8 * 1000 / duration) : 0;
+}
 
 } // namespace
 
@@ -28,7 +42,9 @@ File::Context::Context(
 , _size(reader->size()) {
 }
 
-File::Context::~Context() = default;
+File::Context::~Context() {
+	saveKeyframes();
+}
 
 int File::Context::Read(void *opaque, uint8_t *buffer, int bufferSize) {
 	return static_cast<Context*>(opaque)->read(
@@ -144,7 +160,9 @@ Stream File::Context::initStream(
 		}
 	}
 
-	result.codec = FFmpeg::MakeCodecPointer(info);
+	result.codec = FFmpeg::MakeCodecPointer(
+		info,
+		(type == AVMEDIA_TYPE_VIDEO));
 	if (!result.codec) {
 		if (info->codecpar->codec_id == AV_CODEC_ID_MJPEG) {
 			// mp3 files contain such "video stream", just ignore it.
@@ -260,11 +278,14 @@ void File::Context::start(crl::time position) {
 	}
 
 	_reader->headerDone();
+	_reader->setBitRate(ComputeBitRate(format.get(), _size));
 	if (_reader->isRemoteLoader()) {
 		sendFullInCache(true);
 	}
 	if (video.codec || audio.codec) {
-		seekToPosition(format.get(), video.codec ? video : audio, position);
+		const auto &main = video.codec ? video : audio;
+		applyKeyframes(format.get(), main);
+		seekToPosition(format.get(), main, position);
 	}
 	if (unroll()) {
 		return;
@@ -304,6 +325,8 @@ void File::Context::readNextPacket() {
 		const auto i = _queuedPackets.find(index);
 		if (i == end(_queuedPackets)) {
 			return;
+		} else if (index == _keyframesStream) {
+			rememberKeyframe(packet->fields());
 		}
 		i->second.push_back(std::move(*packet));
 		if (i->second.size() == kMaxQueuedPackets) {
@@ -321,7 +344,54 @@ void File::Context::readNextPacket() {
 	}
 }
 
+void File::Context::rememberKeyframe(const AVPacket &packet) {
+	if (!(packet.flags & AV_PKT_FLAG_KEY)
+		|| packet.pts == AV_NOPTS_VALUE
+		|| packet.pos < 0
+		|| packet.pos >= _size
+		|| int(_keyframes.size()) >= kKeyframesMax) {
+		return;
+	} else if (!_keyframes.emplace(packet.pts, int(packet.pos)).second) {
+		return;
+	} else if (int(_keyframes.size()) - _keyframesSaved
+		>= kKeyframesSaveEach) {
+		saveKeyframes();
+	}
+}
+
+void File::Context::saveKeyframes() {
+	if (_keyframesStream < 0
+		|| int(_keyframes.size()) == _keyframesSaved) {
+		return;
+	}
+	_keyframesSaved = int(_keyframes.size());
+	_reader->putKeyframes(_keyframesStream, _keyframes);
+}
+
+void File::Context::applyKeyframes(
+		not_null<AVFormatContext*> format,
+		const Stream &stream) {
+	const auto info = format->streams[stream.index];
+	if (info->nb_index_entries > 1) {
+		// The demuxer has its own index, like mp4 'moov' or mkv cues.
+		return;
+	}
+	_keyframesStream = stream.index;
+
+	for (const auto &[pts, position] : _reader->keyframes(stream.index)) {
+		if (position < 0 || position >= _size) {
+			continue;
+		}
+		_keyframes.emplace(pts, position);
+		av_add_index_entry(info, position, pts, 0, 0, AVINDEX_KEYFRAME);
+	}
+	_keyframesSaved = int(_keyframes.size());
+	DEBUG_LOG(("Streaming Info: Applied %1 cached keyframes."
+		).arg(_keyframes.size()));
+}
+
 void File::Context::handleEndOfFile() {
+	saveKeyframes();
 	_delegate->fileProcessEndOfFile();
 	if (_delegate->fileReadMore()) {
 		_readTillEnd = false;
@@ -435,6 +505,12 @@ void File::setLoaderPriority(int priority) {
 	_reader->setLoaderPriority(priority);
 }
 
+void File::prefetch(int bytes) {
+	if (!_context) {
+		_reader->prefetch(bytes);
+	}
+}
+
 File::~File() {
 	stop();
 }
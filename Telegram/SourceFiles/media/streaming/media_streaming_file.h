@@ -38,6 +38,7 @@ public:
 
 	[[nodiscard]] bool isRemoteLoader() const;
 	void setLoaderPriority(int priority);
+	void prefetch(int bytes);
 
 	~File();
 
@@ -92,6 +93,14 @@ private:
 		void handleEndOfFile();
 		void sendFullInCache(bool force = false);
 
+		// Keyframe positions of streams without a demuxer index are
+		// cached, so that later seeks in the same file are exact.
+		void applyKeyframes(
+			not_null<AVFormatContext*> format,
+			const Stream &stream);
+		void rememberKeyframe(const AVPacket &packet);
+		void saveKeyframes();
+
 		const not_null<FileDelegate*> _delegate;
 		const not_null<Reader*> _reader;
 
@@ -101,6 +110,9 @@ private:
 		bool _failed = false;
 		bool _readTillEnd = false;
 		std::optional<bool> _fullInCache;
+		base::flat_map<int64, int> _keyframes;
+		int _keyframesStream = -1;
+		int _keyframesSaved = 0;
 		crl::semaphore _semaphore;
 		std::atomic<bool> _interrupted = false;
 
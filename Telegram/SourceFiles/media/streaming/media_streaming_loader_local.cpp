@@ -18,6 +18,12 @@ namespace {
 // This is the maximum file size in Telegram API.
 constexpr auto kMaxFileSize = 3000 * 512 * 1024;
 
+// Larger files are read part by part, mapping them whole could exhaust
+// the address space. On 32 bit builds files are never mapped.
+constexpr auto kMaxMappedSize = (sizeof(void*) >= 8)
+	? (512 * 1024 * 1024)
+	: 0;
+
 int ValidateLocalSize(int64 size) {
 	return (size > 0 && size <= kMaxFileSize) ? int(size) : 0;
 }
@@ -31,6 +37,24 @@ LoaderLocal::LoaderLocal(std::unique_ptr<QIODevice> device)
 
 	if (!_size || !_device->open(QIODevice::ReadOnly)) {
 		fail();
+		return;
+	}
+	mapContent();
+}
+
+void LoaderLocal::mapContent() {
+	if (const auto file = qobject_cast<QFile*>(_device.get())) {
+		if (_size > kMaxMappedSize) {
+			return;
+		}
+		_content = file->map(0, _size);
+		if (!_content) {
+			LOG(("Streaming Info: Could not map '%1', reading instead."
+				).arg(file->fileName()));
+		}
+	} else if (const auto buffer = qobject_cast<QBuffer*>(_device.get())) {
+		_content = reinterpret_cast<const uchar*>(
+			buffer->data().constData());
 	}
 }
 
@@ -43,6 +67,28 @@ int LoaderLocal::size() const {
 }
 
 void LoaderLocal::load(int offset) {
+	if (_content && _device->size() < _size) {
+		// Touching the mapping past the end of a truncated file raises
+		// SIGBUS, so new parts are read from the file instead. This only
+		// narrows the window: a truncation after this check, or while the
+		// parts already sent from the mapping are in use, still crashes.
+		LOG(("Streaming Error: Mapped file was truncated, reading instead."));
+		_content = nullptr;
+	}
+	if (_content) {
+		if (offset < 0 || offset >= _size) {
+			fail();
+			return;
+		}
+		const auto length = std::min(kPartSize, _size - offset);
+		auto result = QByteArray::fromRawData(
+			reinterpret_cast<const char*>(_content) + offset,
+			length);
+		crl::on_main(this, [=, result = std::move(result)]() mutable {
+			_parts.fire({ offset, std::move(result) });
+		});
+		return;
+	}
 	if (_device->pos() != offset && !_device->seek(offset)) {
 		fail();
 		return;
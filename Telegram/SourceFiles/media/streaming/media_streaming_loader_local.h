@@ -41,9 +41,15 @@ public:
 
 private:
 	void fail();
+	void mapContent();
 
 	const std::unique_ptr<QIODevice> _device;
 	const int _size = 0;
+
+	// Whole content, memory mapped for not too large files on 64 bit,
+	// parts don't copy from it. The Reader destroys parts before the
+	// loader is destroyed. Without it the parts are read from _device.
+	const uchar *_content = nullptr;
 	rpl::event_stream<LoadedPart> _parts;
 
 };
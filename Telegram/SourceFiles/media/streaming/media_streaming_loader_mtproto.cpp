@@ -27,7 +27,16 @@ LoaderMtproto::LoaderMtproto(
 	Data::FileOrigin origin)
 : DownloadMtprotoTask(owner, location, origin)
 , _size(size)
-, _api(api().instance()) {
+, _api(api().instance())
+, _fetched((size + kPartSize - 1) / kPartSize, false) {
+}
+
+LoaderMtproto::~LoaderMtproto() {
+	if (_duplicateFetches > 0) {
+		LOG(("Streaming Info: %1 of %2 parts were fetched more than once."
+			).arg(_duplicateFetches
+			).arg(_fetched.size()));
+	}
 }
 
 std::optional<Storage::Cache::Key> LoaderMtproto::baseCacheKey() const {
@@ -129,7 +138,22 @@ int LoaderMtproto::takeNextRequestOffset() {
 	return *offset;
 }
 
+int LoaderMtproto::duplicateFetches() const {
+	return _duplicateFetches;
+}
+
 bool LoaderMtproto::feedPart(int offset, const QByteArray &bytes) {
+	const auto index = offset / kPartSize;
+	if (index >= 0 && index < _fetched.size()) {
+		if (_fetched[index]) {
+			++_duplicateFetches;
+			DEBUG_LOG(("Streaming Info: Part %1 fetched again, total %2."
+				).arg(offset
+				).arg(_duplicateFetches));
+		} else {
+			_fetched[index] = true;
+		}
+	}
 	_parts.fire({ offset, bytes });
 	return true;
 }
@@ -22,6 +22,7 @@ public:
 		const StorageFileLocation &location,
 		int size,
 		Data::FileOrigin origin);
+	~LoaderMtproto();
 
 	[[nodiscard]] auto baseCacheKey() const
 	-> std::optional<Storage::Cache::Key> override;
@@ -42,6 +43,9 @@ public:
 		not_null<Storage::StreamedFileDownloader*> downloader) override;
 	void clearAttachedDownloader() override;
 
+	// Parts that came from the network more than once.
+	[[nodiscard]] int duplicateFetches() const;
+
 private:
 	bool readyToRequest() const override;
 	int takeNextRequestOffset() override;
@@ -61,6 +65,9 @@ private:
 
 	Storage::StreamedFileDownloader *_downloader = nullptr;
 
+	std::vector<bool> _fetched;
+	int _duplicateFetches = 0;
+
 };
 
 } // namespace Streaming
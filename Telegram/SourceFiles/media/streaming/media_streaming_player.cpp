@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/streaming/media_streaming_video_track.h"
 #include "media/audio/media_audio.h" // for SupportsSpeedControl()
 #include "data/data_document.h" // for DocumentData::duration()
+#include "ffmpeg/ffmpeg_utility.h" // for FrameStoragePoolTrim()
 
 namespace Media {
 namespace Streaming {
@@ -27,6 +28,9 @@ constexpr auto kMsFrequency = 1000; // 1000 ms per second.
 // slower than we're playing, so load full file in that case.
 constexpr auto kLoadFullIfStuckAfterPlayback = 3 * crl::time(1000);
 
+// Main thread, when no players are left the frame buffers pool is freed.
+auto PlayersCount = 0;
+
 [[nodiscard]] bool FullTrackReceived(const TrackState &state) {
 	return (state.duration != kTimeUnknown)
 		&& (state.receivedTill == state.duration);
@@ -85,6 +89,7 @@ Player::Player(
 : _file(std::make_unique<File>(owner, std::move(reader)))
 , _remoteLoader(_file->isRemoteLoader())
 , _renderFrameTimer([=] { checkNextFrameRender(); }) {
+	++PlayersCount;
 }
 
 not_null<FileDelegate*> Player::delegate() {
@@ -147,6 +152,12 @@ void Player::setLoaderPriority(int priority) {
 	_file->setLoaderPriority(priority);
 }
 
+void Player::prefetch(int bytes) {
+	if (_stage == Stage::Uninitialized) {
+		_file->prefetch(bytes);
+	}
+}
+
 template <typename Track>
 void Player::trackReceivedTill(
 		const Track &track,
@@ -854,6 +865,15 @@ void Player::setWaitForMarkAsShown(bool wait) {
 	}
 }
 
+void Player::setKeyframesOnly(bool only) {
+	if (_options.keyframesOnly != only) {
+		_options.keyframesOnly = only;
+		if (_video) {
+			_video->setKeyframesOnly(only);
+		}
+	}
+}
+
 bool Player::active() const {
 	return (_stage != Stage::Uninitialized) && !finished() && !failed();
 }
@@ -983,6 +1003,10 @@ Player::~Player() {
 	// So instead of maintaining it in the class definition as well we
 	// simply call stop() here, after that the destruction is trivial.
 	stop();
+
+	if (!--PlayersCount) {
+		FFmpeg::FrameStoragePoolTrim();
+	}
 }
 
 } // namespace Streaming
@@ -55,6 +55,9 @@ public:
 	void setSpeed(float64 speed); // 0.5 <= speed <= 2.
 	void setWaitForMarkAsShown(bool wait);
 
+	// Decodes only the keyframes while nobody can see the video.
+	void setKeyframesOnly(bool only);
+
 	[[nodiscard]] bool playing() const;
 	[[nodiscard]] bool buffering() const;
 	[[nodiscard]] bool paused() const;
@@ -73,6 +76,9 @@ public:
 
 	void setLoaderPriority(int priority);
 
+	// Start loading the file beginning while the player is not active.
+	void prefetch(int bytes);
+
 	[[nodiscard]] Media::Player::TrackState prepareLegacyState() const;
 
 	void lock();
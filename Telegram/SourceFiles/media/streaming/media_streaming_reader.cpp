@@ -10,6 +10,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/streaming/media_streaming_common.h"
 #include "media/streaming/media_streaming_loader.h"
 #include "storage/cache/storage_cache_database.h"
+#include "storage/storage_cache_metrics.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QDataStream>
 
 namespace Media {
 namespace Streaming {
@@ -23,12 +27,69 @@ constexpr auto kMaxOnlyInHeader = 80 * kPartSize;
 constexpr auto kPartsOutsideFirstSliceGood = 8;
 constexpr auto kSlicesInMemory = 2;
 
-// 1 MB of parts are requested from cloud ahead of reading demand.
+// 1 MB of parts are requested from cloud ahead of reading demand,
+// unless the bitrate is known, then we try to keep kPreloadDuration of
+// playback requested, but not more than kPreloadPartsAheadMax parts.
 constexpr auto kPreloadPartsAhead = 8;
+constexpr auto kPreloadPartsAheadMin = 2;
+constexpr auto kPreloadPartsAheadMax = 32;
+constexpr auto kPreloadDuration = crl::time(5000);
+constexpr auto kThroughputPeriod = crl::time(1000);
 constexpr auto kDownloaderRequestsLimit = 4;
 
+// Slice numbers never exceed 250 for the 2000 MB file size limit,
+// so the last key of the document key space keeps the keyframe index.
+constexpr auto kKeyframesSliceNumber = 0xFF;
+constexpr auto kKeyframesMax = 16 * 1024;
+
 using PartsMap = base::flat_map<int, QByteArray>;
 
+[[nodiscard]] QByteArray SerializeKeyframes(
+		int streamIndex,
+		const base::flat_map<int64, int> &keyframes) {
+	auto result = QByteArray();
+	result.reserve(2 * sizeof(qint32)
+		+ keyframes.size() * (sizeof(qint64) + sizeof(qint32)));
+	auto buffer = QBuffer(&result);
+	buffer.open(QIODevice::WriteOnly);
+	auto stream = QDataStream(&buffer);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream << qint32(streamIndex) << qint32(keyframes.size());
+	for (const auto &[pts, position] : keyframes) {
+		stream << qint64(pts) << qint32(position);
+	}
+	return result;
+}
+
+[[nodiscard]] bool ParseKeyframes(
+		const QByteArray &serialized,
+		int &streamIndex,
+		base::flat_map<int64, int> &keyframes) {
+	auto data = QDataStream(serialized);
+	data.setVersion(QDataStream::Qt_5_1);
+	auto index = qint32();
+	auto count = qint32();
+	data >> index >> count;
+	if (data.status() != QDataStream::Ok
+		|| index < 0
+		|| count <= 0
+		|| count > kKeyframesMax) {
+		return false;
+	}
+	streamIndex = index;
+	keyframes.clear();
+	for (auto i = 0; i != count; ++i) {
+		auto pts = qint64();
+		auto position = qint32();
+		data >> pts >> position;
+		if (data.status() != QDataStream::Ok) {
+			break;
+		}
+		keyframes.emplace(pts, position);
+	}
+	return true;
+}
+
 struct ParsedCacheEntry {
 	PartsMap parts;
 	std::optional<PartsMap> included;
@@ -226,6 +287,10 @@ struct Reader::CacheHelper {
 	base::flat_map<int, PartsMap> results;
 	std::vector<int> sizes;
 	std::atomic<crl::semaphore*> waiting = nullptr;
+
+	// Merged from all the contexts of the reader, guarded by the mutex.
+	int keyframesStream = -1;
+	base::flat_map<int64, int> keyframes;
 };
 
 Reader::CacheHelper::CacheHelper(Storage::Cache::Key baseKey)
@@ -262,14 +327,16 @@ void Reader::Slice::addPart(int offset, QByteArray bytes) {
 	}
 }
 
-auto Reader::Slice::prepareFill(int from, int till) -> PrepareFillResult {
+auto Reader::Slice::prepareFill(
+		int from,
+		int till,
+		int preloadParts) -> PrepareFillResult {
 	auto result = PrepareFillResult();
 
 	result.ready = false;
 	const auto fromOffset = (from / kPartSize) * kPartSize;
 	const auto tillPart = (till + kPartSize - 1) / kPartSize;
-	const auto preloadTillOffset = (tillPart + kPreloadPartsAhead)
-		* kPartSize;
+	const auto preloadTillOffset = (tillPart + preloadParts) * kPartSize;
 
 	const auto after = ranges::upper_bound(
 		parts,
@@ -541,7 +608,10 @@ void Reader::Slices::processPart(
 	checkSliceFullLoaded(index + 1);
 }
 
-auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
+auto Reader::Slices::fill(
+		int offset,
+		bytes::span buffer,
+		int preloadParts) -> FillResult {
 	Expects(!buffer.empty());
 	Expects(offset >= 0 && offset < _size);
 	Expects(offset + buffer.size() <= _size);
@@ -555,7 +625,7 @@ auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
 		Assert(waitingForHeaderCache());
 		return {};
 	} else if (isFullInHeader()) {
-		return fillFromHeader(offset, buffer);
+		return fillFromHeader(offset, buffer, preloadParts);
 	}
 
 	auto result = FillResult();
@@ -595,9 +665,15 @@ auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
 	const auto firstTill = std::min(kInSlice, till - fromSlice * kInSlice);
 	const auto secondFrom = 0;
 	const auto secondTill = till - (fromSlice + 1) * kInSlice;
-	const auto first = _data[fromSlice].prepareFill(firstFrom, firstTill);
+	const auto first = _data[fromSlice].prepareFill(
+		firstFrom,
+		firstTill,
+		preloadParts);
 	const auto second = (fromSlice + 1 < tillSlice)
-		? _data[fromSlice + 1].prepareFill(secondFrom, secondTill)
+		? _data[fromSlice + 1].prepareFill(
+			secondFrom,
+			secondTill,
+			preloadParts)
 		: Slice::PrepareFillResult();
 	handlePrepareResult(fromSlice, first);
 	if (fromSlice + 1 < tillSlice) {
@@ -629,13 +705,15 @@ auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
 	return result;
 }
 
-auto Reader::Slices::fillFromHeader(int offset, bytes::span buffer)
--> FillResult {
+auto Reader::Slices::fillFromHeader(
+		int offset,
+		bytes::span buffer,
+		int preloadParts) -> FillResult {
 	auto result = FillResult();
 	const auto from = offset;
 	const auto till = int(offset + buffer.size());
 
-	const auto prepared = _header.prepareFill(from, till);
+	const auto prepared = _header.prepareFill(from, till, preloadParts);
 	for (const auto full : prepared.offsetsFromLoader.values()) {
 		if (full < _size) {
 			result.offsetsFromLoader.add(full);
@@ -858,6 +936,8 @@ Reader::Reader(
 		}
 		if (_streamingActive) {
 			_loadedParts.emplace(std::move(part));
+		} else if (_prefetching) {
+			processPrefetchedPart(std::move(part));
 		}
 		if (const auto waiting = _waiting.load(std::memory_order_acquire)) {
 			_waiting.store(nullptr, std::memory_order_release);
@@ -867,6 +947,7 @@ Reader::Reader(
 
 	if (_cacheHelper) {
 		readFromCache(0);
+		readKeyframesFromCache();
 	}
 }
 
@@ -901,9 +982,37 @@ void Reader::tryRemoveLoaderAsync() {
 
 void Reader::startStreaming() {
 	_streamingActive = true;
+	_prefetching = false;
 	refreshLoaderPriority();
 }
 
+void Reader::prefetch(int bytes) {
+	processCacheResults();
+	if (_streamingActive
+		|| !isRemoteLoader()
+		|| _slices.waitingForHeaderCache()
+		|| !_slices.headerModeUnknown()) {
+		return;
+	}
+	// Without the streaming thread the slices are used on main thread,
+	// the same way the downloader uses them.
+	_prefetching = true;
+	const auto till = std::min(bytes, size());
+	for (auto offset = 0; offset < till; offset += kPartSize) {
+		loadAtOffset(offset);
+	}
+}
+
+void Reader::processPrefetchedPart(LoadedPart &&part) {
+	if (!part.valid(size())) {
+		_prefetching = false;
+		return;
+	} else if (!_loadingOffsets.remove(part.offset)) {
+		return;
+	}
+	_slices.processPart(part.offset, std::move(part.bytes));
+}
+
 void Reader::stopStreaming(bool stillActive) {
 	Expects(_sleeping == nullptr);
 
@@ -1132,9 +1241,14 @@ void Reader::readFromCache(int sliceNumber) {
 	const auto key = _cacheHelper->key(sliceNumber);
 	const auto cache = std::weak_ptr<CacheHelper>(_cacheHelper);
 	const auto weak = base::make_weak(this);
+	const auto started = crl::now();
 	const auto ready = [=](
 			QByteArray &&result,
 			std::vector<int> &&sizes = {}) {
+		Storage::CountCacheRead(
+			Storage::CacheKind::StreamingSlice,
+			!result.isEmpty(),
+			started);
 		crl::async([
 			=,
 			result = std::move(result),
@@ -1185,9 +1299,79 @@ void Reader::putToCache(SerializedSlice &&slice) {
 	Expects(_cacheHelper != nullptr);
 	Expects(slice.number >= 0);
 
+	Storage::CountCacheWrite(
+		Storage::CacheKind::StreamingSlice,
+		slice.data.size());
 	_cache->put(_cacheHelper->key(slice.number), std::move(slice.data));
 }
 
+void Reader::readKeyframesFromCache() {
+	Expects(_cacheHelper != nullptr);
+
+	const auto cache = std::weak_ptr<CacheHelper>(_cacheHelper);
+	_cache->get(
+		_cacheHelper->key(kKeyframesSliceNumber),
+		[=](QByteArray &&result) {
+			const auto strong = cache.lock();
+			auto streamIndex = -1;
+			auto keyframes = base::flat_map<int64, int>();
+			if (!strong || !ParseKeyframes(result, streamIndex, keyframes)) {
+				return;
+			}
+			QMutexLocker lock(&strong->mutex);
+			if (strong->keyframesStream < 0) {
+				strong->keyframesStream = streamIndex;
+				strong->keyframes = std::move(keyframes);
+			} else if (strong->keyframesStream == streamIndex) {
+				// Some keyframes were already put, keep them too.
+				for (const auto &[pts, position] : keyframes) {
+					strong->keyframes.emplace(pts, position);
+				}
+			}
+		});
+}
+
+base::flat_map<int64, int> Reader::keyframes(int streamIndex) const {
+	if (!_cacheHelper) {
+		return {};
+	}
+	QMutexLocker lock(&_cacheHelper->mutex);
+	return (_cacheHelper->keyframesStream == streamIndex)
+		? _cacheHelper->keyframes
+		: base::flat_map<int64, int>();
+}
+
+void Reader::putKeyframes(
+		int streamIndex,
+		const base::flat_map<int64, int> &keyframes) {
+	if (!_cacheHelper || keyframes.empty()) {
+		return;
+	}
+
+	// Several contexts of the reader may put their keyframes at once,
+	// so they are merged and written to the cache under the same lock.
+	QMutexLocker lock(&_cacheHelper->mutex);
+	auto &stored = _cacheHelper->keyframes;
+	if (_cacheHelper->keyframesStream != streamIndex) {
+		_cacheHelper->keyframesStream = streamIndex;
+		stored = keyframes;
+	} else {
+		for (const auto &[pts, position] : keyframes) {
+			if (int(stored.size()) >= kKeyframesMax) {
+				break;
+			}
+			stored.emplace(pts, position);
+		}
+	}
+	auto data = SerializeKeyframes(streamIndex, stored);
+	Storage::CountCacheWrite(
+		Storage::CacheKind::StreamingSlice,
+		data.size());
+	_cache->put(
+		_cacheHelper->key(kKeyframesSliceNumber),
+		std::move(data));
+}
+
 int Reader::size() const {
 	return _loader->size();
 }
@@ -1208,6 +1392,44 @@ bool Reader::fullInCache() const {
 	return _slices.fullInCache();
 }
 
+void Reader::setBitRate(int64 bitsPerSecond) {
+	_bitRate = std::max(bitsPerSecond, int64(0));
+}
+
+int Reader::preloadPartsAhead() const {
+	if (!_bitRate) {
+		return kPreloadPartsAhead;
+	}
+	const auto bytesPerSecond = _bitRate / 8;
+	auto bytes = bytesPerSecond * kPreloadDuration / 1000;
+	if (_throughput > 0 && _throughput < bytesPerSecond) {
+		// Loading is slower than playback, request further ahead.
+		bytes *= 2;
+	}
+	return std::clamp(
+		int((bytes + kPartSize - 1) / kPartSize),
+		kPreloadPartsAheadMin,
+		kPreloadPartsAheadMax);
+}
+
+void Reader::updateThroughput(int received) {
+	// Count only the time when some parts were requested and not received.
+	const auto now = crl::now();
+	_throughputBytes += received;
+	const auto elapsed = now - _throughputStarted;
+	const auto idle = _loadingOffsets.empty();
+	if (_throughputStarted && (idle || elapsed >= kThroughputPeriod)) {
+		if (elapsed > 0) {
+			const auto current = _throughputBytes * 1000 / elapsed;
+			_throughput = _throughput
+				? (_throughput + current) / 2
+				: current;
+		}
+		_throughputBytes = 0;
+		_throughputStarted = idle ? 0 : now;
+	}
+}
+
 bool Reader::fill(
 		int offset,
 		bytes::span buffer,
@@ -1255,7 +1477,7 @@ bool Reader::fill(
 bool Reader::fillFromSlices(int offset, bytes::span buffer) {
 	using namespace rpl::mappers;
 
-	auto result = _slices.fill(offset, buffer);
+	auto result = _slices.fill(offset, buffer, preloadPartsAhead());
 	if (!result.filled && _slices.headerWontBeFilled()) {
 		_streamingError = Error::NotStreamable;
 		return false;
@@ -1345,6 +1567,7 @@ bool Reader::processLoadedParts() {
 	}
 
 	auto loaded = _loadedParts.take();
+	auto received = 0;
 	for (auto &part : loaded) {
 		if (!part.valid(size())) {
 			_streamingError = Error::LoadFailed;
@@ -1352,10 +1575,14 @@ bool Reader::processLoadedParts() {
 		} else if (!_loadingOffsets.remove(part.offset)) {
 			continue;
 		}
+		received += part.bytes.size();
 		_slices.processPart(
 			part.offset,
 			std::move(part.bytes));
 	}
+	if (received > 0) {
+		updateThroughput(received);
+	}
 	return !loaded.empty();
 }
 
@@ -1367,6 +1594,10 @@ bool Reader::checkForSomethingMoreReceived() {
 
 void Reader::loadAtOffset(int offset) {
 	if (_loadingOffsets.add(offset)) {
+		if (!_throughputStarted) {
+			_throughputStarted = crl::now();
+			_throughputBytes = 0;
+		}
 		_loader->load(offset);
 	}
 }
@@ -1379,6 +1610,13 @@ void Reader::finalizeCache() {
 		QMutexLocker lock(&_cacheHelper->mutex);
 		_cacheHelper->waiting.store(nullptr, std::memory_order_release);
 	}
+	if (_prefetching
+		&& _slices.headerModeUnknown()
+		&& !_slices.waitingForHeaderCache()
+		&& _slices.headerSize() > 0) {
+		// The playback didn't start, keep the prefetched parts as header.
+		_slices.headerDone(false);
+	}
 	auto toCache = _slices.unloadToCache();
 	while (toCache.number >= 0) {
 		putToCache(std::move(toCache));
@@ -52,6 +52,15 @@ public:
 	void headerDone();
 	[[nodiscard]] int headerSize() const;
 	[[nodiscard]] bool fullInCache() const;
+	void setBitRate(int64 bitsPerSecond);
+
+	// Keyframe positions by pts, stored next to the cached slices.
+	// Thread safe, the keyframes put by different contexts are merged.
+	[[nodiscard]] base::flat_map<int64, int> keyframes(
+		int streamIndex) const;
+	void putKeyframes(
+		int streamIndex,
+		const base::flat_map<int64, int> &keyframes);
 
 	// Thread safe.
 	void startSleep(not_null<crl::semaphore*> wake);
@@ -63,6 +72,9 @@ public:
 	// Main thread.
 	void startStreaming();
 	void stopStreaming(bool stillActive = false);
+
+	// Requests the first bytes before the playback starts.
+	void prefetch(int bytes);
 	[[nodiscard]] rpl::producer<LoadedPart> partsForDownloader() const;
 	void loadForDownloader(
 		not_null<Storage::StreamedFileDownloader*> downloader,
@@ -74,7 +86,8 @@ public:
 	~Reader();
 
 private:
-	static constexpr auto kLoadFromRemoteMax = 8;
+	// Enough for the largest read-ahead plus the parts being read.
+	static constexpr auto kLoadFromRemoteMax = 40;
 
 	struct CacheHelper;
 
@@ -123,7 +136,7 @@ private:
 
 		void processCacheData(PartsMap &&data);
 		void addPart(int offset, QByteArray bytes);
-		PrepareFillResult prepareFill(int from, int till);
+		PrepareFillResult prepareFill(int from, int till, int preloadParts);
 
 		// Get up to kLoadFromRemoteMax not loaded parts in from-till range.
 		StackIntVector<kLoadFromRemoteMax> offsetsFromLoader(
@@ -154,7 +167,10 @@ private:
 		void processCachedSizes(const std::vector<int> &sizes);
 		void processPart(int offset, QByteArray &&bytes);
 
-		[[nodiscard]] FillResult fill(int offset, bytes::span buffer);
+		[[nodiscard]] FillResult fill(
+			int offset,
+			bytes::span buffer,
+			int preloadParts);
 		[[nodiscard]] SerializedSlice unloadToCache();
 
 		[[nodiscard]] QByteArray partForDownloader(int offset) const;
@@ -181,7 +197,8 @@ private:
 		[[nodiscard]] bool computeIsGoodHeader() const;
 		[[nodiscard]] FillResult fillFromHeader(
 			int offset,
-			bytes::span buffer);
+			bytes::span buffer,
+			int preloadParts);
 		void unloadSlice(Slice &slice) const;
 		void checkSliceFullLoaded(int sliceNumber);
 		[[nodiscard]] bool checkFullInCache() const;
@@ -206,10 +223,13 @@ private:
 	void loadAtOffset(int offset);
 	void checkLoadWillBeFirst(int offset);
 	bool processLoadedParts();
+	void processPrefetchedPart(LoadedPart &&part);
 
 	bool checkForSomethingMoreReceived();
 
 	bool fillFromSlices(int offset, bytes::span buffer);
+	void updateThroughput(int received);
+	[[nodiscard]] int preloadPartsAhead() const;
 
 	void finalizeCache();
 
@@ -224,6 +244,7 @@ private:
 	void checkForDownloaderReadyOffsets();
 
 	void refreshLoaderPriority();
+	void readKeyframesFromCache();
 
 	static std::shared_ptr<CacheHelper> InitCacheHelper(
 		std::optional<Storage::Cache::Key> baseKey);
@@ -243,6 +264,12 @@ private:
 	// Even if streaming had failed, the Reader can work for the downloader.
 	std::optional<Error> _streamingError;
 
+	// Streaming thread, used to choose the read-ahead size.
+	int64 _bitRate = 0;
+	int64 _throughput = 0; // Bytes per second while loading.
+	int64 _throughputBytes = 0;
+	crl::time _throughputStarted = 0;
+
 	// In case streaming is active both main and streaming threads have work.
 	// In case only downloader is active, all work is done on main thread.
 
@@ -251,6 +278,7 @@ private:
 	rpl::event_stream<LoadedPart> _partsForDownloader;
 	int _realPriority = 1;
 	bool _streamingActive = false;
+	bool _prefetching = false;
 
 	// Streaming thread.
 	std::deque<int> _offsetsForDownloader;
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "media/streaming/media_streaming_common.h"
 #include "ui/image/image_prepare.h"
+#include "core/paint_profiler.h"
 #include "ffmpeg/ffmpeg_utility.h"
 
 namespace Media {
@@ -17,6 +18,20 @@ namespace {
 
 constexpr auto kSkipInvalidDataPackets = 10;
 
+bool ReopenSoftwareCodec(Stream &stream) {
+	auto codec = FFmpeg::MakeSoftwareCodecPointer(stream.codec.get());
+	if (!codec) {
+		return false;
+	}
+	av_frame_unref(stream.frame.get());
+	stream.codec = std::move(codec);
+	stream.transferFrame = nullptr;
+
+	// Decoding starts from the next keyframe, the references are lost.
+	stream.codec->skip_frame = AVDISCARD_NONKEY;
+	return true;
+}
+
 } // namespace
 
 crl::time FramePosition(const Stream &stream) {
@@ -36,6 +51,13 @@ FFmpeg::AvErrorWrap ProcessPacket(Stream &stream, FFmpeg::Packet &&packet) {
 	auto error = FFmpeg::AvErrorWrap();
 
 	const auto native = &packet.fields();
+	if (!stream.keyframesOnly
+		&& stream.codec->skip_frame == AVDISCARD_NONKEY
+		&& (native->flags & AV_PKT_FLAG_KEY)) {
+		// Start decoding all frames again only from a keyframe,
+		// otherwise the skipped references would show as artifacts.
+		stream.codec->skip_frame = AVDISCARD_DEFAULT;
+	}
 	const auto guard = gsl::finally([
 		&,
 		size = native->size,
@@ -72,9 +94,16 @@ FFmpeg::AvErrorWrap ReadNextFrame(Stream &stream) {
 		error = avcodec_receive_frame(
 			stream.codec.get(),
 			stream.frame.get());
-		if (!error
-			|| error.code() != AVERROR(EAGAIN)
-			|| stream.queue.empty()) {
+		if (!error) {
+			error = FFmpeg::TransferHardwareFrame(
+				stream.frame,
+				stream.transferFrame);
+			if (!error || !ReopenSoftwareCodec(stream)) {
+				return error;
+			}
+			error = AVERROR(EAGAIN);
+		}
+		if (error.code() != AVERROR(EAGAIN) || stream.queue.empty()) {
 			return error;
 		}
 
@@ -108,6 +137,10 @@ QImage ConvertFrame(
 		QImage storage) {
 	Expects(frame != nullptr);
 
+	const auto profile = Core::PaintProfilerScope(
+		"ConvertFrame",
+		Core::PaintZone::MediaDecode);
+
 	const auto frameSize = QSize(frame->width, frame->height);
 	if (frameSize.isEmpty()) {
 		LOG(("Streaming Error: Bad frame size %1,%2"
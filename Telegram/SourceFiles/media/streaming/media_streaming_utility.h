@@ -31,6 +31,7 @@ struct Stream {
 	AVRational timeBase = FFmpeg::kUniversalTimeBase;
 	FFmpeg::CodecPointer codec;
 	FFmpeg::FramePointer frame;
+	FFmpeg::FramePointer transferFrame;
 	std::deque<FFmpeg::Packet> queue;
 	int invalidDataPackets = 0;
 
@@ -41,6 +42,7 @@ struct Stream {
 	int rotation = 0;
 	AVRational aspect = FFmpeg::kNormalAspect;
 	FFmpeg::SwscalePointer swscale;
+	bool keyframesOnly = false;
 };
 
 [[nodiscard]] crl::time FramePosition(const Stream &stream);
@@ -43,6 +43,7 @@ public:
 	void resume(crl::time time);
 	void setSpeed(float64 speed);
 	void setWaitForMarkAsShown(bool wait);
+	void setKeyframesOnly(bool only);
 	void interrupt();
 	void frameShown();
 	void addTimelineDelay(crl::time delayed);
@@ -133,6 +134,11 @@ VideoTrackObject::VideoTrackObject(
 	Expects(_stream.duration > 1);
 	Expects(_ready != nullptr);
 	Expects(_error != nullptr);
+
+	if (_options.keyframesOnly) {
+		_stream.keyframesOnly = true;
+		_stream.codec->skip_frame = AVDISCARD_NONKEY;
+	}
 }
 
 rpl::producer<> VideoTrackObject::checkNextFrame() const {
@@ -446,6 +452,16 @@ void VideoTrackObject::setWaitForMarkAsShown(bool wait) {
 	_options.waitForMarkAsShown = wait;
 }
 
+void VideoTrackObject::setKeyframesOnly(bool only) {
+	if (interrupted() || _stream.keyframesOnly == only) {
+		return;
+	}
+	_options.keyframesOnly = _stream.keyframesOnly = only;
+	if (only) {
+		_stream.codec->skip_frame = AVDISCARD_NONKEY;
+	}
+}
+
 bool VideoTrackObject::interrupted() const {
 	return (_shared == nullptr);
 }
@@ -469,7 +485,9 @@ void VideoTrackObject::addTimelineDelay(crl::time delayed) {
 void VideoTrackObject::updateFrameRequest(
 		const Instance *instance,
 		const FrameRequest &request) {
-	_requests.emplace(instance, request);
+	// Replace an existing request as well, otherwise after a resize the
+	// frames keep being converted to the old size and rescaled on paint.
+	_requests[instance] = request;
 }
 
 void VideoTrackObject::removeFrameRequest(const Instance *instance) {
@@ -936,6 +954,12 @@ void VideoTrack::setWaitForMarkAsShown(bool wait) {
 	});
 }
 
+void VideoTrack::setKeyframesOnly(bool only) {
+	_wrapped.with([=](Implementation &unwrapped) {
+		unwrapped.setKeyframesOnly(only);
+	});
+}
+
 crl::time VideoTrack::nextFrameDisplayTime() const {
 	return _shared->nextFrameDisplayTime();
 }
@@ -998,7 +1022,8 @@ QImage VideoTrack::frame(
 				if (alreadyInstance != instance
 					&& prepared.request == useRequest
 					&& !prepared.image.isNull()) {
-					return prepared.image;
+					j->second.image = prepared.image;
+					return j->second.image;
 				}
 			}
 		}
@@ -1026,25 +1051,40 @@ void VideoTrack::PrepareFrameByRequests(
 
 	const auto begin = frame->prepared.begin();
 	const auto end = frame->prepared.end();
+	const auto needed = [&](const Prepared &prepared) {
+		return frame->alpha
+			|| !GoodForRequest(frame->original, rotation, prepared.request);
+	};
+	const auto sameRequest = [&](auto i) {
+		for (auto j = begin; j != i; ++j) {
+			if (j->second.request == i->second.request) {
+				return j;
+			}
+		}
+		return end;
+	};
+
+	// Each distinct request is prepared once, the consumers with the same
+	// request share the result. Shared images from the previous frame are
+	// released first, so that the storage can be reused without a detach.
+	for (auto i = begin; i != end; ++i) {
+		if (sameRequest(i) != end) {
+			i->second.image = QImage();
+		}
+	}
 	for (auto i = begin; i != end; ++i) {
 		auto &prepared = i->second;
-		if (frame->alpha
-			|| !GoodForRequest(frame->original, rotation, prepared.request)) {
-			auto j = begin;
-			for (; j != i; ++j) {
-				if (j->second.request == prepared.request) {
-					prepared.image = QImage();
-					break;
-				}
-			}
-			if (j == i) {
-				prepared.image = PrepareByRequest(
-					frame->original,
-					frame->alpha,
-					rotation,
-					prepared.request,
-					std::move(prepared.image));
-			}
+		if (!needed(prepared)) {
+			continue;
+		} else if (const auto j = sameRequest(i); j != end) {
+			prepared.image = j->second.image;
+		} else {
+			prepared.image = PrepareByRequest(
+				frame->original,
+				frame->alpha,
+				rotation,
+				prepared.request,
+				std::move(prepared.image));
 		}
 	}
 }
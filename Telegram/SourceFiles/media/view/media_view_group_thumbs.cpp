@@ -183,7 +183,6 @@ GroupThumbs::Thumb::Thumb(
 	_fullWidth = std::min(
 		wantedPixSize().width(),
 		st::mediaviewGroupWidthMax);
-	validateImage();
 }
 
 QSize GroupThumbs::Thumb::wantedPixSize() const {
@@ -209,8 +208,7 @@ void GroupThumbs::Thumb::validateImage() {
 		const auto originalHeight = _image->height();
 		const auto takeWidth = originalWidth * st::mediaviewGroupWidthMax
 			/ pixSize.width();
-		const auto original = _image->pixNoCache(_origin).toImage();
-		_full = App::pixmapFromImageInPlace(original.copy(
+		_full = App::pixmapFromImageInPlace(_image->original().copy(
 			(originalWidth - takeWidth) / 2,
 			0,
 			takeWidth,
@@ -332,14 +330,24 @@ void GroupThumbs::Thumb::paint(
 		int y,
 		int outerWidth,
 		float64 progress) {
-	validateImage();
-
 	_opacity.update(progress, anim::linear);
 	_left.update(progress, anim::linear);
 	_width.update(progress, anim::linear);
 
 	const auto left = x + currentLeft();
 	const auto width = currentWidth();
+
+	// Only thumbs inside the strip (with some margin) load their images
+	// and hold the scaled pixmaps, the rest release them.
+	const auto margin = st::mediaviewGroupWidthMax;
+	if (left + width < -margin || left > outerWidth + margin) {
+		_full = QPixmap();
+		return;
+	}
+	validateImage();
+	if (_full.isNull()) {
+		return;
+	}
 	const auto opacity = p.opacity();
 	p.setOpacity(_opacity.current() * opacity);
 	if (width == _fullWidth) {
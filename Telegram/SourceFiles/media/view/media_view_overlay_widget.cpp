@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/application.h"
 #include "core/file_utilities.h"
 #include "core/mime_type.h"
+#include "core/paint_profiler.h"
 #include "ui/widgets/popup_menu.h"
 #include "ui/widgets/buttons.h"
 #include "ui/image/image.h"
@@ -70,6 +71,7 @@ namespace View {
 namespace {
 
 constexpr auto kPreloadCount = 4;
+constexpr auto kPreparedPhotosMemoryLimit = 128 * 1024 * 1024;
 constexpr auto kMaxZoomLevel = 7; // x8
 constexpr auto kZoomToScreenLevel = 1024;
 constexpr auto kOverlayLoaderPriority = 2;
@@ -324,6 +326,7 @@ OverlayWidget::OverlayWidget()
 			subscribe(session->downloaderTaskFinished(), [=] {
 				if (!isHidden()) {
 					updateControls();
+					prepareNeighbourPhotos();
 				}
 			});
 			subscribe(session->calls().currentCallChanged(), [=](Calls::Call *call) {
@@ -451,10 +454,9 @@ bool OverlayWidget::videoIsGifv() const {
 	return _streamed && _doc->isAnimation() && !_doc->isVideoMessage();
 }
 
-QImage OverlayWidget::videoFrame() const {
+QImage OverlayWidget::videoFrame(Streaming::FrameRequest request) const {
 	Expects(videoShown());
 
-	auto request = Streaming::FrameRequest();
 	//request.radius = (_doc && _doc->isVideoMessage())
 	//	? ImageRoundRadius::Ellipse
 	//	: ImageRoundRadius::None;
@@ -463,10 +465,31 @@ QImage OverlayWidget::videoFrame() const {
 		: _streamed->instance.info().video.cover;
 }
 
+Streaming::FrameRequest OverlayWidget::videoFrameRequestForPaint() const {
+	Expects(_streamed != nullptr);
+
+	// When the video is shown downscaled ask for frames of the painted size,
+	// so that swscale converts and scales them in one pass on the decoder
+	// thread and the painter only blits the result without smoothing.
+	auto result = Streaming::FrameRequest();
+	const auto &video = _streamed->instance.info().video;
+	if (_rotation != 0 || video.rotation != 0) {
+		return result;
+	}
+	const auto size = contentRect().size() * cIntRetinaFactor();
+	const auto original = video.size;
+	if (!size.isEmpty()
+		&& size.width() < original.width()
+		&& size.height() < original.height()) {
+		result.resize = result.outer = size;
+	}
+	return result;
+}
+
 QImage OverlayWidget::videoFrameForDirectPaint() const {
 	Expects(_streamed != nullptr);
 
-	const auto result = videoFrame();
+	const auto result = videoFrame(videoFrameRequestForPaint());
 
 #ifdef USE_OPENGL_OVERLAY_WIDGET
 	const auto bytesPerLine = result.bytesPerLine();
@@ -1084,6 +1107,8 @@ void OverlayWidget::clearData() {
 	if (!_animationOpacities.empty()) {
 		_animationOpacities.clear();
 	}
+	_preparedPhotos.clear();
+	_preparingPhotos.clear();
 	clearStreaming();
 	delete _menu;
 	_menu = nullptr;
@@ -1923,6 +1948,7 @@ void OverlayWidget::displayPhoto(not_null<PhotoData*> photo, HistoryItem *item)
 	_zoomToScreen = _zoomToDefault = 0;
 	_blurred = true;
 	_staticContent = QPixmap();
+	_staticContentPrepared = false;
 	_down = OverNone;
 	const auto size = style::ConvertScale(flipSizeByRotation(QSize(
 		photo->width(),
@@ -1967,6 +1993,7 @@ void OverlayWidget::displayDocument(
 	}
 	_fullScreenVideo = false;
 	_staticContent = QPixmap();
+	_staticContentPrepared = false;
 	clearStreaming(_doc != doc);
 	destroyThemePreview();
 	_doc = doc;
@@ -2702,11 +2729,66 @@ void OverlayWidget::validatePhotoImage(Image *image, bool blurred) {
 		Images::Option::Smooth
 		| (blurred ? Images::Option::Blurred : Images::Option(0)));
 	_staticContent.setDevicePixelRatio(cRetinaFactor());
+	_staticContentPrepared = false;
 	_blurred = blurred;
 }
 
+void OverlayWidget::validatePhotoPreview() {
+	// While the large photo is loading its partially decoded content
+	// is shown instead of the blurred thumbnail, getting sharper.
+	const auto large = _photo->large();
+	if (!_blurred || large->loaded()) {
+		return;
+	}
+	const auto preview = large->preview();
+	if (preview.isNull()
+		|| (preview.cacheKey() == _previewImageKey
+			&& _staticContent.cacheKey() == _previewContentKey)) {
+		return;
+	}
+	const auto use = flipSizeByRotation({ _width, _height })
+		* cIntRetinaFactor();
+	_staticContent = App::pixmapFromImageInPlace(Images::prepare(
+		preview,
+		use.width(),
+		use.height(),
+		Images::Option::Smooth,
+		-1,
+		-1));
+	_staticContent.setDevicePixelRatio(cRetinaFactor());
+	_staticContentPrepared = false;
+	_previewImageKey = preview.cacheKey();
+	_previewContentKey = _staticContent.cacheKey();
+}
+
+void OverlayWidget::usePreparedPhoto() {
+	// The prepared image is only good while the photo is shown
+	// fitted to the screen, setZoomLevel() drops it on zoom in.
+	if (!_staticContent.isNull() && !_blurred) {
+		return;
+	}
+	const auto i = _preparedPhotos.find(_photo);
+	if (i == end(_preparedPhotos)) {
+		return;
+	} else if (_rotation
+		|| i->second.size != QSize(_w, _h) * cIntRetinaFactor()) {
+		_preparedPhotos.erase(i);
+		return;
+	}
+	_staticContent = App::pixmapFromImageInPlace(
+		std::move(i->second.image));
+	_staticContent.setDevicePixelRatio(cRetinaFactor());
+	_staticContentPrepared = true;
+	_blurred = false;
+	_preparedPhotos.erase(i);
+}
+
 void OverlayWidget::validatePhotoCurrentImage() {
+	if (_photo->large()->loaded()) {
+		usePreparedPhoto();
+	}
 	validatePhotoImage(_photo->large(), false);
+	validatePhotoPreview();
 	validatePhotoImage(_photo->thumbnail(), true);
 	validatePhotoImage(_photo->thumbnailSmall(), true);
 	validatePhotoImage(_photo->thumbnailInline(), true);
@@ -2725,6 +2807,9 @@ void OverlayWidget::validatePhotoCurrentImage() {
 }
 
 void OverlayWidget::paintEvent(QPaintEvent *e) {
+	const auto profile = Core::PaintProfilerScope(
+		"OverlayWidget",
+		Core::PaintZone::Frame);
 	const auto r = e->rect();
 	const auto &region = e->region();
 	const auto rects = region.rects();
@@ -3320,6 +3405,12 @@ void OverlayWidget::setZoomLevel(int newZoom, bool force) {
 		_x = qRound(nx / (-z + 1) + width() / 2.);
 		_y = qRound(ny / (-z + 1) + height() / 2.);
 	}
+	if (_staticContentPrepared
+		&& _w * cIntRetinaFactor() > _staticContent.width()) {
+		_staticContent = QPixmap();
+		_staticContentPrepared = false;
+		_blurred = true;
+	}
 	snapXY();
 	update();
 }
@@ -3490,6 +3581,94 @@ void OverlayWidget::preloadData(int delta) {
 			}
 		}
 	}
+	prepareNeighbourPhotos();
+}
+
+QSize OverlayWidget::preparedPhotoSize(not_null<PhotoData*> photo) const {
+	// Same size as resizeContentByScreenSize() gives to a fitted photo.
+	auto w = style::ConvertScale(photo->width());
+	auto h = style::ConvertScale(photo->height());
+	if (w <= 0 || h <= 0) {
+		return QSize();
+	} else if (w > width() || h > height()) {
+		auto zoom = float64(width()) / w;
+		if (h * zoom > height()) {
+			zoom = float64(height()) / h;
+		}
+		zoom = (zoom >= 1.) ? (zoom - 1.) : (1. - (1. / zoom));
+		if (zoom >= 0) {
+			w = qRound(w * (zoom + 1));
+			h = qRound(h * (zoom + 1));
+		} else {
+			w = qRound(w / (-zoom + 1));
+			h = qRound(h / (-zoom + 1));
+		}
+	}
+	return QSize(w, h) * cIntRetinaFactor();
+}
+
+void OverlayWidget::prepareNeighbourPhotos() {
+	if (!_index) {
+		return;
+	}
+	auto photos = std::vector<not_null<PhotoData*>>();
+	for (auto distance = 1; distance <= kPreloadCount; ++distance) {
+		for (const auto index : { *_index + distance, *_index - distance }) {
+			const auto entity = entityByIndex(index);
+			if (const auto photo = base::get_if<not_null<PhotoData*>>(
+					&entity.data)) {
+				photos.push_back(*photo);
+			}
+		}
+	}
+	for (auto i = begin(_preparedPhotos); i != end(_preparedPhotos);) {
+		if (!ranges::contains(photos, i->first)) {
+			i = _preparedPhotos.erase(i);
+		} else {
+			++i;
+		}
+	}
+	auto memory = int64();
+	for (const auto &[photo, prepared] : _preparedPhotos) {
+		memory += int64(prepared.size.width()) * prepared.size.height() * 4;
+	}
+	const auto weak = Ui::MakeWeak(this);
+	for (const auto photo : photos) {
+		const auto size = preparedPhotoSize(photo);
+		const auto bytes = int64(size.width()) * size.height() * 4;
+		if (_preparedPhotos.contains(photo)
+			|| _preparingPhotos.contains(photo)) {
+			continue;
+		} else if (size.isEmpty()
+			|| memory + bytes > kPreparedPhotosMemoryLimit) {
+			break;
+		}
+		const auto image = photo->large();
+		if (!image->loaded()
+			|| photo->owner().mediaRotation().get(photo) != 0) {
+			continue;
+		}
+		memory += bytes;
+		_preparingPhotos.emplace(photo);
+		crl::async([=, original = image->original()]() mutable {
+			auto scaled = Images::prepare(
+				std::move(original),
+				size.width(),
+				size.height(),
+				Images::Option::Smooth,
+				-1,
+				-1);
+			crl::on_main(weak, [=, scaled = std::move(scaled)]() mutable {
+				if (!_preparingPhotos.remove(photo)
+					|| preparedPhotoSize(photo) != size) {
+					return;
+				}
+				_preparedPhotos.emplace(
+					photo,
+					PreparedPhoto{ size, std::move(scaled) });
+			});
+		});
+	}
 }
 
 void OverlayWidget::mousePressEvent(QMouseEvent *e) {
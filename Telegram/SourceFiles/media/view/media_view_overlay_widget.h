@@ -193,6 +193,9 @@ private:
 	void moveToScreen(bool force = false);
 	bool moveToNext(int delta);
 	void preloadData(int delta);
+	void prepareNeighbourPhotos();
+	[[nodiscard]] QSize preparedPhotoSize(not_null<PhotoData*> photo) const;
+	void usePreparedPhoto();
 
 	Entity entityForUserPhotos(int index) const;
 	Entity entityForSharedMedia(int index) const;
@@ -326,6 +329,7 @@ private:
 	void initGroupThumbs();
 
 	void validatePhotoImage(Image *image, bool blurred);
+	void validatePhotoPreview();
 	void validatePhotoCurrentImage();
 
 	[[nodiscard]] QSize flipSizeByRotation(QSize size) const;
@@ -334,8 +338,10 @@ private:
 	[[nodiscard]] bool videoShown() const;
 	[[nodiscard]] QSize videoSize() const;
 	[[nodiscard]] bool videoIsGifv() const;
-	[[nodiscard]] QImage videoFrame() const;
+	[[nodiscard]] QImage videoFrame(
+		Streaming::FrameRequest request = Streaming::FrameRequest()) const;
 	[[nodiscard]] QImage videoFrameForDirectPaint() const;
+	[[nodiscard]] Streaming::FrameRequest videoFrameRequestForPaint() const;
 	[[nodiscard]] QImage transformVideoFrame(QImage frame) const;
 	[[nodiscard]] QImage transformStaticContent(QPixmap content) const;
 	[[nodiscard]] bool documentContentShown() const;
@@ -392,7 +398,10 @@ private:
 	bool _pressed = false;
 	int32 _dragging = 0;
 	QPixmap _staticContent;
+	qint64 _previewImageKey = 0;
+	qint64 _previewContentKey = 0;
 	bool _blurred = true;
+	bool _staticContentPrepared = false;
 
 	std::unique_ptr<Streamed> _streamed;
 	std::unique_ptr<PipWrap> _pip;
@@ -480,6 +489,14 @@ private:
 	QTimer _saveMsgUpdater;
 	Ui::Text::String _saveMsgText;
 
+	// Neighbour photos decoded and scaled to the screen in the background.
+	struct PreparedPhoto {
+		QSize size;
+		QImage image;
+	};
+	base::flat_map<not_null<PhotoData*>, PreparedPhoto> _preparedPhotos;
+	base::flat_set<not_null<PhotoData*>> _preparingPhotos;
+
 	base::flat_map<OverState, crl::time> _animations;
 	base::flat_map<OverState, anim::value> _animationOpacities;
 
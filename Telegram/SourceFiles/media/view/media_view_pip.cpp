@@ -40,6 +40,9 @@ constexpr auto kPipLoaderPriority = 2;
 constexpr auto kSaveGeometryTimeout = crl::time(1000);
 constexpr auto kMsInSecond = 1000;
 
+// If frames arrive and nothing is painted, the window can't be seen.
+constexpr auto kHiddenPaintTimeout = crl::time(1000);
+
 [[nodiscard]] bool IsWindowControlsOnLeft() {
 	return Platform::IsMac();
 }
@@ -571,13 +574,29 @@ void PipPanel::paintEvent(QPaintEvent *e) {
 			? RectPart(0)
 			: RectPart::BottomLeft);
 	request.radius = ImageRoundRadius::Large;
-	if (_useTransparency) {
-		const auto sides = RectPart::AllSides & ~_attached;
-		Ui::Shadow::paint(p, inner, width(), st::callShadow);
+	if (_useTransparency && !inner.contains(e->rect())) {
+		validateShadowCache(inner);
+		p.drawImage(0, 0, _shadowCache);
 	}
 	_paint(p, request);
 }
 
+void PipPanel::validateShadowCache(QRect inner) {
+	const auto ratio = style::DevicePixelRatio();
+	if (_shadowCache.size() == size() * ratio
+		&& _shadowCacheInner == inner) {
+		return;
+	}
+	_shadowCacheInner = inner;
+	_shadowCache = QImage(
+		size() * ratio,
+		QImage::Format_ARGB32_Premultiplied);
+	_shadowCache.setDevicePixelRatio(ratio);
+	_shadowCache.fill(Qt::transparent);
+	auto p = QPainter(&_shadowCache);
+	Ui::Shadow::paint(p, inner, width(), st::callShadow);
+}
+
 void PipPanel::mousePressEvent(QMouseEvent *e) {
 	if (e->button() != Qt::LeftButton) {
 		return;
@@ -828,7 +847,11 @@ Pip::Pip(
 	setupStreaming();
 }
 
-Pip::~Pip() = default;
+Pip::~Pip() {
+	if (_keyframesOnly) {
+		_instance.player().setKeyframesOnly(false);
+	}
+}
 
 void Pip::setupPanel() {
 	const auto size = [&] {
@@ -1143,6 +1166,27 @@ void Pip::paint(QPainter &p, FrameRequest request) {
 	}
 	paintRadialLoading(p);
 	paintControls(p);
+
+	_lastPaintTime = crl::now();
+	if (_keyframesOnly) {
+		_keyframesOnly = false;
+		_instance.player().setKeyframesOnly(false);
+	}
+}
+
+void Pip::checkKeyframesOnly() {
+	// Paints are not delivered to minimized or fully covered windows
+	// on most platforms, decode only the keyframes till the next one.
+	if (_keyframesOnly) {
+		return;
+	}
+	const auto hidden = _panel.isMinimized()
+		|| (_lastPaintTime
+			&& crl::now() - _lastPaintTime > kHiddenPaintTimeout);
+	if (hidden) {
+		_keyframesOnly = true;
+		_instance.player().setKeyframesOnly(true);
+	}
 }
 
 void Pip::paintControls(QPainter &p) const {
@@ -1265,9 +1309,12 @@ void Pip::handleStreamingUpdate(Streaming::Update &&update) {
 	}, [&](const PreloadedVideo &update) {
 		updatePlaybackState();
 	}, [&](const UpdateVideo &update) {
-		_panel.update();
+		// The shadow around the video is cached in the panel,
+		// only the video with the controls over it is repainted.
+		_panel.update(_panel.inner());
 		Core::App().updateNonIdle();
 		updatePlaybackState();
+		checkKeyframesOnly();
 	}, [&](const PreloadedAudio &update) {
 		updatePlaybackState();
 	}, [&](const UpdateAudio &update) {
@@ -85,6 +85,7 @@ private:
 	void updateOverState(QPoint point);
 	void moveAnimated(QPoint to);
 	void updateDecorations();
+	void validateShadowCache(QRect inner);
 
 	QPointer<QWidget> _parent;
 	Fn<void(QPainter&, FrameRequest)> _paint;
@@ -95,6 +96,8 @@ private:
 	bool _useTransparency = true;
 	bool _dragDisabled = false;
 	style::margins _padding;
+	QImage _shadowCache;
+	QRect _shadowCacheInner;
 
 	RectPart _overState = RectPart();
 	std::optional<RectPart> _pressState;
@@ -162,6 +165,7 @@ private:
 	void saveGeometry();
 
 	void updatePlaybackState();
+	void checkKeyframesOnly();
 	void updatePlayPauseResumeState(const Player::TrackState &state);
 	void restartAtSeekPosition(crl::time position);
 
@@ -210,6 +214,8 @@ private:
 	QString _timeAlready, _timeLeft;
 	int _timeLeftWidth = 0;
 	int _rotation = 0;
+	crl::time _lastPaintTime = 0;
+	bool _keyframesOnly = false;
 	crl::time _seekPositionMs = -1;
 	crl::time _lastDurationMs = 0;
 	OverState _over = OverState::None;
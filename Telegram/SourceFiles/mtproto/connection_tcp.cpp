@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/bytes.h"
 #include "base/openssl_help.h"
 #include "base/qthelp_url.h"
+#include "base/invoke_queued.h"
 
 extern "C" {
 #include <openssl/aes.h>
@@ -441,11 +442,37 @@ void TcpConnection::sendData(mtpBuffer &&buffer) {
 	const auto connectionStartPrefix = prepareConnectionStartPrefix(
 		bytes::make_span(connectionStartPrefixBytes));
 
+	if (!connectionStartPrefix.empty()) {
+		_writePrefix = bytes::make_vector(connectionStartPrefix);
+	}
+
 	// buffer: 2 available int-s + data + available int.
 	const auto bytes = _protocol->finalizePacket(buffer);
 	TCP_LOG(("TCP Info: write packet %1 bytes").arg(bytes.size()));
 	aesCtrEncrypt(bytes, _sendKey, &_sendState);
-	_socket->write(connectionStartPrefix, bytes);
+
+	const auto flushScheduled = !_writeBuffer.empty();
+	_writeBuffer.insert(end(_writeBuffer), bytes.begin(), bytes.end());
+	if (!flushScheduled) {
+		InvokeQueued(this, [=] { flushWrites(); });
+	}
+}
+
+void TcpConnection::flushWrites() {
+	if (!_socket || _writeBuffer.empty()) {
+		return;
+	}
+	TCP_LOG(("TCP Info: flush %1 bytes").arg(_writeBuffer.size()));
+	_socket->write(_writePrefix, _writeBuffer);
+	_writePrefix.clear();
+
+	// Keep the buffer for the next pass unless it was a large upload.
+	constexpr auto kKeepWriteBufferCapacity = 64 * 1024;
+	if (_writeBuffer.capacity() > kKeepWriteBufferCapacity) {
+		_writeBuffer = bytes::vector();
+	} else {
+		_writeBuffer.clear();
+	}
 }
 
 bytes::const_span TcpConnection::prepareConnectionStartPrefix(
@@ -506,6 +533,8 @@ void TcpConnection::disconnectFromServer() {
 	_connectedLifetime.destroy();
 	_lifetime.destroy();
 	_socket = nullptr;
+	_writePrefix = bytes::vector();
+	_writeBuffer = bytes::vector();
 }
 
 void TcpConnection::connectToServer(
@@ -53,6 +53,7 @@ private:
 
 	void socketRead();
 	bytes::const_span prepareConnectionStartPrefix(bytes::span buffer);
+	void flushWrites();
 
 	void socketPacket(bytes::const_span bytes);
 
@@ -71,6 +72,10 @@ private:
 	std::unique_ptr<AbstractSocket> _socket;
 	bool _connectionStarted = false;
 
+	// Packets from one send pass are written to the socket together.
+	bytes::vector _writePrefix;
+	bytes::vector _writeBuffer;
+
 	int _offsetBytes = 0;
 	int _readBytes = 0;
 	int _leftBytes = 0;
@@ -431,6 +431,16 @@ QByteArray DcOptions::serialize() const {
 				<< Serialize::bytes(key.n)
 				<< Serialize::bytes(key.e);
 		}
+
+		// Endpoint connection history.
+		QMutexLocker statsLock(&_endpointStatsMutex);
+		stream << qint32(_endpointStats.size());
+		for (const auto &[key, stats] : _endpointStats) {
+			const auto &[dcId, ip, port] = key;
+			stream << qint32(dcId) << qint32(port) << qint32(ip.size());
+			stream.writeRawData(ip.data(), ip.size());
+			stream << qint32(stats.connectTime) << qint32(stats.failures);
+		}
 	}
 	return result;
 }
@@ -525,6 +535,71 @@ void DcOptions::constructFromSerialized(const QByteArray &serialized) {
 			}
 		}
 	}
+
+	// Read endpoint connection history
+	if (!stream.atEnd()) {
+		auto count = qint32(0);
+		stream >> count;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("MTP Error: Bad data for endpoint stats in DcOptions::constructFromSerialized()"));
+			return;
+		}
+
+		QMutexLocker statsLock(&_endpointStatsMutex);
+		_endpointStats.clear();
+		for (auto i = 0; i != count; ++i) {
+			qint32 dcId = 0, port = 0, ipSize = 0;
+			stream >> dcId >> port >> ipSize;
+
+			constexpr auto kMaxIpSize = 45;
+			if (ipSize <= 0 || ipSize > kMaxIpSize) {
+				LOG(("MTP Error: Bad data for endpoint stats inside DcOptions::constructFromSerialized()"));
+				return;
+			}
+			auto ip = std::string(ipSize, ' ');
+			stream.readRawData(ip.data(), ipSize);
+
+			qint32 connectTime = 0, failures = 0;
+			stream >> connectTime >> failures;
+			if (stream.status() != QDataStream::Ok) {
+				LOG(("MTP Error: Bad data for endpoint stats inside DcOptions::constructFromSerialized()"));
+				return;
+			}
+			_endpointStats.emplace(
+				EndpointKey(dcId, std::move(ip), port),
+				EndpointStats{ crl::time(connectTime), int(failures) });
+		}
+	}
+}
+
+void DcOptions::endpointConnected(
+		DcId dcId,
+		const std::string &ip,
+		int port,
+		crl::time connectTime) {
+	QMutexLocker lock(&_endpointStatsMutex);
+	auto &stats = _endpointStats[EndpointKey(dcId, ip, port)];
+	stats.connectTime = stats.connectTime
+		? (stats.connectTime * 3 + connectTime) / 4
+		: std::max(connectTime, crl::time(1));
+	stats.failures = 0;
+}
+
+void DcOptions::endpointFailed(DcId dcId, const std::string &ip, int port) {
+	QMutexLocker lock(&_endpointStatsMutex);
+	++_endpointStats[EndpointKey(dcId, ip, port)].failures;
+}
+
+auto DcOptions::endpointStats(
+	DcId dcId,
+	const std::string &ip,
+	int port) const
+-> std::optional<EndpointStats> {
+	QMutexLocker lock(&_endpointStatsMutex);
+	const auto i = _endpointStats.find(EndpointKey(dcId, ip, port));
+	return (i != end(_endpointStats))
+		? std::make_optional(i->second)
+		: std::optional<EndpointStats>();
 }
 
 rpl::producer<DcId> DcOptions::changed() const {
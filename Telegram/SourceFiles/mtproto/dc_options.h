@@ -11,7 +11,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/bytes.h"
 
 #include <QtCore/QReadWriteLock>
+#include <QtCore/QMutex>
+#include <optional>
 #include <string>
+#include <tuple>
 #include <vector>
 #include <map>
 #include <set>
@@ -102,11 +105,29 @@ public:
 		DcId dcId,
 		const QVector<MTPlong> &fingerprints) const;
 
+	// Connection history, used to try the best endpoint first.
+	struct EndpointStats {
+		crl::time connectTime = 0;
+		int failures = 0;
+	};
+	void endpointConnected(
+		DcId dcId,
+		const std::string &ip,
+		int port,
+		crl::time connectTime);
+	void endpointFailed(DcId dcId, const std::string &ip, int port);
+	[[nodiscard]] std::optional<EndpointStats> endpointStats(
+		DcId dcId,
+		const std::string &ip,
+		int port) const;
+
 	// Debug feature for now.
 	bool loadFromFile(const QString &path);
 	bool writeToFile(const QString &path) const;
 
 private:
+	using EndpointKey = std::tuple<DcId, std::string, int>;
+
 	bool applyOneGuarded(
 		DcId dcId,
 		Flags flags,
@@ -144,6 +165,9 @@ private:
 	std::map<DcId, std::map<uint64, details::RSAPublicKey>> _cdnPublicKeys;
 	mutable QReadWriteLock _useThroughLockers;
 
+	std::map<EndpointKey, EndpointStats> _endpointStats;
+	mutable QMutex _endpointStatsMutex;
+
 	rpl::event_stream<DcId> _changed;
 	rpl::event_stream<> _cdnConfigChanged;
 
@@ -103,16 +103,15 @@ SerializedRequest DcKeyBinder::prepareRequest(
 	return result;
 }
 
-DcKeyBindState DcKeyBinder::handleResponse(const mtpBuffer &response) {
-	Expects(!response.isEmpty());
+DcKeyBindState DcKeyBinder::handleResponse(
+		const mtpPrime *from,
+		const mtpPrime *end) {
+	Expects(from < end);
 
-	auto from = response.begin();
-	const auto end = from + response.size();
 	auto error = MTPRpcError();
-	auto result = MTPBool();
-	if (response[0] == mtpc_boolTrue) {
+	if (*from == mtpc_boolTrue) {
 		return DcKeyBindState::Success;
-	} else if (response[0] == mtpc_rpc_error && error.read(from, end)) {
+	} else if (*from == mtpc_rpc_error && error.read(from, end)) {
 		const auto destroyed = error.match([&](const MTPDrpc_error &data) {
 			return (data.verror_code().v == 400)
 				&& (data.verror_message().v == "ENCRYPTED_MESSAGE_INVALID");
@@ -0,0 +1,147 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_gzip_unpacker.h"
+
+#include "zlib.h"
+
+namespace MTP::details {
+namespace {
+
+constexpr auto kMaxUnpackedSize = 64 * 1024 * 1024;
+constexpr auto kGzipTrailerSize = 8;
+
+[[nodiscard]] bytes::const_span ReadPackedBytes(
+		const mtpPrime *from,
+		const mtpPrime *end) {
+	// Same layout as tl::string, but without copying the bytes out.
+	const auto available = (end - from) * sizeof(mtpPrime);
+	if (available < sizeof(mtpPrime)) {
+		return {};
+	}
+	const auto data = reinterpret_cast<const uchar*>(from);
+	const auto longLength = (data[0] == 254);
+	const auto length = longLength
+		? (uint32(data[1]) | (uint32(data[2]) << 8) | (uint32(data[3]) << 16))
+		: uint32(data[0]);
+	const auto offset = longLength ? 4 : 1;
+	if (offset + length > available) {
+		return {};
+	}
+	return bytes::const_span(
+		reinterpret_cast<const bytes::type*>(data + offset),
+		length);
+}
+
+[[nodiscard]] uint32 ReadUnpackedSizeHint(bytes::const_span packed) {
+	// ISIZE field of the gzip trailer: unpacked size modulo 2^32.
+	if (packed.size() < kGzipTrailerSize) {
+		return 0;
+	}
+	const auto isize = reinterpret_cast<const uchar*>(
+		packed.data() + packed.size() - 4);
+	return uint32(isize[0])
+		| (uint32(isize[1]) << 8)
+		| (uint32(isize[2]) << 16)
+		| (uint32(isize[3]) << 24);
+}
+
+} // namespace
+
+GzipUnpacker::GzipUnpacker() : _stream(std::make_unique<z_stream>()) {
+}
+
+GzipUnpacker::~GzipUnpacker() {
+	if (_initialized) {
+		inflateEnd(_stream.get());
+	}
+}
+
+bool GzipUnpacker::prepareStream() {
+	if (_initialized) {
+		const auto res = inflateReset(_stream.get());
+		if (res == Z_OK) {
+			return true;
+		}
+		LOG(("RPC Error: could not reset zlib stream, code: %1").arg(res));
+		inflateEnd(_stream.get());
+		_initialized = false;
+	}
+	*_stream = z_stream();
+	const auto res = inflateInit2(_stream.get(), 16 + MAX_WBITS);
+	if (res != Z_OK) {
+		LOG(("RPC Error: could not init zlib stream, code: %1").arg(res));
+		return false;
+	}
+	_initialized = true;
+	return true;
+}
+
+mtpBuffer GzipUnpacker::unpack(const mtpPrime *from, const mtpPrime *end) {
+	const auto packed = ReadPackedBytes(from, end);
+	if (packed.empty()) {
+		LOG(("RPC Error: could not read gziped bytes."));
+		return mtpBuffer();
+	} else if (!prepareStream()) {
+		return mtpBuffer();
+	}
+	const auto stream = _stream.get();
+
+	const auto hint = ReadUnpackedSizeHint(packed);
+	const auto hintInts = (hint > 0 && hint <= kMaxUnpackedSize)
+		? int((hint + sizeof(mtpPrime) - 1) / sizeof(mtpPrime))
+		: int(packed.size());
+
+	// One extra int lets us see Z_STREAM_END without a reallocation
+	// when the hint was exact.
+	auto result = mtpBuffer();
+	result.resize(hintInts + 1);
+
+	stream->avail_in = packed.size();
+	stream->next_in = reinterpret_cast<Bytef*>(
+		const_cast<bytes::type*>(packed.data()));
+	stream->avail_out = result.size() * sizeof(mtpPrime);
+	stream->next_out = reinterpret_cast<Bytef*>(result.data());
+	while (true) {
+		const auto res = inflate(stream, Z_NO_FLUSH);
+		if (res == Z_STREAM_END) {
+			break;
+		} else if (res != Z_OK && res != Z_BUF_ERROR) {
+			LOG(("RPC Error: could not unpack gziped data, code: %1"
+				).arg(res));
+			DEBUG_LOG(("RPC Error: bad gzip: %1"
+				).arg(Logs::mb(packed.data(), packed.size()).str()));
+			return mtpBuffer();
+		} else if (stream->avail_out) {
+			LOG(("RPC Error: truncated gziped data."));
+			return mtpBuffer();
+		}
+		const auto was = result.size();
+		if (was * sizeof(mtpPrime) >= kMaxUnpackedSize) {
+			LOG(("RPC Error: too large gziped data."));
+			return mtpBuffer();
+		}
+		result.resize(was * 2);
+		stream->avail_out = (result.size() - was) * sizeof(mtpPrime);
+		stream->next_out = reinterpret_cast<Bytef*>(result.data() + was);
+	}
+	const auto unpacked = result.size() * sizeof(mtpPrime)
+		- stream->avail_out;
+	if (unpacked & 0x03) {
+		LOG(("RPC Error: bad length of unpacked data %1").arg(unpacked));
+		DEBUG_LOG(("RPC Error: bad unpacked data %1"
+			).arg(Logs::mb(result.data(), unpacked).str()));
+		return mtpBuffer();
+	}
+	result.resize(unpacked / sizeof(mtpPrime));
+	if (result.empty()) {
+		LOG(("RPC Error: bad length of unpacked data 0"));
+	}
+	return result;
+}
+
+} // namespace MTP::details
@@ -0,0 +1,38 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+
+struct z_stream_s;
+
+namespace MTP::details {
+
+// Inflate state reused for all gzip_packed objects of one session.
+// The output buffer is allocated once using the size written in the gzip
+// trailer, so even multi-megabyte responses cost a single allocation.
+class GzipUnpacker final {
+public:
+	GzipUnpacker();
+	GzipUnpacker(const GzipUnpacker &other) = delete;
+	GzipUnpacker &operator=(const GzipUnpacker &other) = delete;
+	~GzipUnpacker();
+
+	// [from, end) is the serialized gzip_packed bytes without constructor.
+	// Returns an empty buffer on any error.
+	[[nodiscard]] mtpBuffer unpack(const mtpPrime *from, const mtpPrime *end);
+
+private:
+	[[nodiscard]] bool prepareStream();
+
+	std::unique_ptr<z_stream_s> _stream;
+	bool _initialized = false;
+
+};
+
+} // namespace MTP::details
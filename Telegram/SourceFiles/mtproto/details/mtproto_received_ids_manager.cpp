@@ -10,45 +10,95 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace MTP::details {
 
 bool ReceivedIdsManager::registerMsgId(mtpMsgId msgId, bool needAck) {
-	const auto i = _idsNeedAck.find(msgId);
-	if (i == _idsNeedAck.end()) {
-		if (_idsNeedAck.size() < kIdsBufferSize || msgId > min()) {
-			_idsNeedAck.emplace(msgId, needAck);
-			return true;
+	if (!_size || msgId > max()) {
+		if (_size == kCapacity) {
+			popFront();
 		}
-		MTP_LOG(-1, ("No need to handle - %1 < min = %2").arg(msgId).arg(min()));
-	} else {
+		const auto position = index(_size++);
+		_ids[position] = msgId;
+		_needAck[position] = needAck;
+		return true;
+	}
+	const auto found = lowerBound(msgId);
+	if (_ids[index(found)] == msgId) {
 		MTP_LOG(-1, ("No need to handle - %1 already is in map").arg(msgId));
+		return false;
+	} else if (_size >= kIdsBufferSize && msgId <= min()) {
+		MTP_LOG(-1, ("No need to handle - %1 < min = %2").arg(msgId).arg(min()));
+		return false;
+	}
+
+	// Out of order id, shift the newer ones, they are usually few.
+	auto insertAt = found;
+	if (_size == kCapacity) {
+		popFront();
+		--insertAt;
 	}
-	return false;
+	for (auto i = _size; i != insertAt; --i) {
+		const auto to = index(i);
+		const auto from = index(i - 1);
+		_ids[to] = _ids[from];
+		_needAck[to] = _needAck[from];
+	}
+	++_size;
+	const auto position = index(insertAt);
+	_ids[position] = msgId;
+	_needAck[position] = needAck;
+	return true;
 }
 
 mtpMsgId ReceivedIdsManager::min() const {
-	return _idsNeedAck.empty() ? 0 : _idsNeedAck.begin()->first;
+	return _size ? _ids[index(0)] : 0;
 }
 
 mtpMsgId ReceivedIdsManager::max() const {
-	auto end = _idsNeedAck.end();
-	return _idsNeedAck.empty() ? 0 : (--end)->first;
+	return _size ? _ids[index(_size - 1)] : 0;
 }
 
 ReceivedIdsManager::State ReceivedIdsManager::lookup(mtpMsgId msgId) const {
-	auto i = _idsNeedAck.find(msgId);
-	if (i == _idsNeedAck.end()) {
+	if (!_size || msgId < min() || msgId > max()) {
+		return State::NotFound;
+	}
+	const auto position = index(lowerBound(msgId));
+	if (_ids[position] != msgId) {
 		return State::NotFound;
 	}
-	return i->second ? State::NeedsAck : State::NoAckNeeded;
+	return _needAck[position] ? State::NeedsAck : State::NoAckNeeded;
 }
 
 void ReceivedIdsManager::shrink() {
-	auto size = _idsNeedAck.size();
-	while (size-- > kIdsBufferSize) {
-		_idsNeedAck.erase(_idsNeedAck.begin());
+	while (_size > kIdsBufferSize) {
+		popFront();
 	}
 }
 
 void ReceivedIdsManager::clear() {
-	_idsNeedAck.clear();
+	_head = _size = 0;
+}
+
+int ReceivedIdsManager::index(int position) const {
+	return (_head + position) % kCapacity;
+}
+
+int ReceivedIdsManager::lowerBound(mtpMsgId msgId) const {
+	auto from = 0;
+	auto till = _size;
+	while (from < till) {
+		const auto middle = from + (till - from) / 2;
+		if (_ids[index(middle)] < msgId) {
+			from = middle + 1;
+		} else {
+			till = middle;
+		}
+	}
+	return from;
+}
+
+void ReceivedIdsManager::popFront() {
+	Expects(_size > 0);
+
+	_head = (_head + 1) % kCapacity;
+	--_size;
 }
 
 } // namespace MTP::details
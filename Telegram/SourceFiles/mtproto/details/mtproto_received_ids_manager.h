@@ -7,7 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
-#include "base/flat_map.h"
+#include <array>
+#include <bitset>
 
 namespace MTP::details {
 
@@ -31,7 +32,18 @@ public:
 	void clear();
 
 private:
-	base::flat_map<mtpMsgId, bool> _idsNeedAck;
+	// Ids are kept sorted in a fixed ring, usually they come in order
+	// so registering is a push to the back and shrinking a pop from front.
+	static constexpr auto kCapacity = 2 * kIdsBufferSize;
+
+	[[nodiscard]] int index(int position) const;
+	[[nodiscard]] int lowerBound(mtpMsgId msgId) const;
+	void popFront();
+
+	std::array<mtpMsgId, kCapacity> _ids = { { 0 } };
+	std::bitset<kCapacity> _needAck;
+	int _head = 0;
+	int _size = 0;
 
 };
 
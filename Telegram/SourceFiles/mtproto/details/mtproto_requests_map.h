@@ -0,0 +1,130 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+
+#include <QtCore/QMutex>
+#include <chrono>
+#include <map>
+
+namespace MTP::details {
+
+struct RequestsMapLockStats {
+	uint64 locks = 0;
+	uint64 contended = 0;
+	uint64 waitedNanoseconds = 0;
+};
+
+// Map keyed by mtpRequestId, split into shards with their own mutexes.
+// Sequential request ids land in different shards, so session threads
+// handling responses to different requests don't wait for each other.
+template <typename Value>
+class RequestsMap final {
+public:
+	void set(mtpRequestId requestId, Value value) {
+		auto &shard = locked(requestId);
+		shard.map[requestId] = std::move(value);
+		shard.mutex.unlock();
+	}
+
+	[[nodiscard]] std::optional<Value> find(mtpRequestId requestId) const {
+		auto &shard = locked(requestId);
+		const auto i = shard.map.find(requestId);
+		auto result = (i != shard.map.end())
+			? std::make_optional(i->second)
+			: std::optional<Value>();
+		shard.mutex.unlock();
+		return result;
+	}
+
+	[[nodiscard]] std::optional<Value> take(mtpRequestId requestId) {
+		auto &shard = locked(requestId);
+		const auto i = shard.map.find(requestId);
+		auto result = std::optional<Value>();
+		if (i != shard.map.end()) {
+			result = std::move(i->second);
+			shard.map.erase(i);
+		}
+		shard.mutex.unlock();
+		return result;
+	}
+
+	[[nodiscard]] bool contains(mtpRequestId requestId) const {
+		auto &shard = locked(requestId);
+		const auto result = (shard.map.find(requestId) != shard.map.end());
+		shard.mutex.unlock();
+		return result;
+	}
+
+	void remove(mtpRequestId requestId) {
+		auto &shard = locked(requestId);
+		shard.map.erase(requestId);
+		shard.mutex.unlock();
+	}
+
+	// Calls method(Value&) under the shard lock, returns a copy after it.
+	template <typename Method>
+	std::optional<Value> modify(mtpRequestId requestId, Method &&method) {
+		auto &shard = locked(requestId);
+		const auto i = shard.map.find(requestId);
+		auto result = std::optional<Value>();
+		if (i != shard.map.end()) {
+			method(i->second);
+			result = i->second;
+		}
+		shard.mutex.unlock();
+		return result;
+	}
+
+	[[nodiscard]] RequestsMapLockStats lockStats() const {
+		auto result = RequestsMapLockStats();
+		for (const auto &shard : _shards) {
+			result.locks += shard.locks.load(std::memory_order_relaxed);
+			result.contended += shard.contended.load(
+				std::memory_order_relaxed);
+			result.waitedNanoseconds += shard.waited.load(
+				std::memory_order_relaxed);
+		}
+		return result;
+	}
+
+private:
+	static constexpr auto kShardsCount = 16;
+
+	struct alignas(64) Shard {
+		mutable QMutex mutex;
+		std::map<mtpRequestId, Value> map;
+		mutable std::atomic<uint64> locks = 0;
+		mutable std::atomic<uint64> contended = 0;
+		mutable std::atomic<uint64> waited = 0;
+	};
+
+	[[nodiscard]] Shard &locked(mtpRequestId requestId) const {
+		using Clock = std::chrono::steady_clock;
+
+		auto &result = _shards[uint32(requestId) % kShardsCount];
+		result.locks.fetch_add(1, std::memory_order_relaxed);
+		if (!result.mutex.tryLock()) {
+			const auto started = Clock::now();
+			result.mutex.lock();
+			const auto waited = std::chrono::duration_cast<
+				std::chrono::nanoseconds>(Clock::now() - started).count();
+			result.contended.fetch_add(1, std::memory_order_relaxed);
+			result.waited.fetch_add(
+				uint64(waited),
+				std::memory_order_relaxed);
+		}
+		return result;
+	}
+
+	mutable std::array<Shard, kShardsCount> _shards;
+
+};
+
+} // namespace MTP::details
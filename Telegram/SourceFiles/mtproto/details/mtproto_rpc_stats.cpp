@@ -0,0 +1,109 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_rpc_stats.h"
+
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonArray>
+
+namespace MTP::details {
+
+void RpcHistogram::add(uint64 value) {
+	auto bucket = 0;
+	while (bucket + 1 < kBucketsCount && (uint64(1) << bucket) <= value) {
+		++bucket;
+	}
+	_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	_sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+QJsonObject RpcHistogram::toJson() const {
+	auto buckets = QJsonArray();
+	auto count = uint64(0);
+	auto last = 0;
+	for (auto i = 0; i != kBucketsCount; ++i) {
+		const auto value = _buckets[i].load(std::memory_order_relaxed);
+		if (value) {
+			last = i + 1;
+		}
+		count += value;
+	}
+	for (auto i = 0; i != last; ++i) {
+		buckets.append(
+			double(_buckets[i].load(std::memory_order_relaxed)));
+	}
+	auto result = QJsonObject();
+	result.insert("count", double(count));
+	result.insert("sum", double(_sum.load(std::memory_order_relaxed)));
+	result.insert("buckets", buckets);
+	return result;
+}
+
+void RpcStats::responseReceived(
+		DcId dcId,
+		mtpTypeId method,
+		crl::time latency,
+		int requestBytes,
+		int responseBytes,
+		bool error) {
+	auto &stats = entry(dcId, method);
+	stats.latency.add(std::max(latency, crl::time(0)));
+	stats.requestBytes.add(std::max(requestBytes, 0));
+	stats.responseBytes.add(std::max(responseBytes, 0));
+	if (error) {
+		stats.errors.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void RpcStats::requestRetried(DcId dcId, mtpTypeId method) {
+	entry(dcId, method).retries.fetch_add(1, std::memory_order_relaxed);
+}
+
+RpcMethodStats &RpcStats::entry(DcId dcId, mtpTypeId method) {
+	const auto key = Key(dcId, method);
+	{
+		QReadLocker lock(&_lock);
+		const auto i = _methods.find(key);
+		if (i != end(_methods)) {
+			return *i->second;
+		}
+	}
+	QWriteLocker lock(&_lock);
+	auto &result = _methods[key];
+	if (!result) {
+		result = std::make_unique<RpcMethodStats>();
+	}
+	return *result;
+}
+
+QByteArray RpcStats::toJson() const {
+	auto methods = QJsonArray();
+	QReadLocker lock(&_lock);
+	for (const auto &[key, stats] : _methods) {
+		auto method = QJsonObject();
+		method.insert("dc", key.first);
+		method.insert("method", QString("0x%1").arg(key.second, 8, 16, QChar('0')));
+		method.insert("latency_ms", stats->latency.toJson());
+		method.insert("request_bytes", stats->requestBytes.toJson());
+		method.insert("response_bytes", stats->responseBytes.toJson());
+		method.insert(
+			"errors",
+			double(stats->errors.load(std::memory_order_relaxed)));
+		method.insert(
+			"retries",
+			double(stats->retries.load(std::memory_order_relaxed)));
+		methods.append(method);
+	}
+	lock.unlock();
+
+	auto result = QJsonObject();
+	result.insert("methods", methods);
+	return QJsonDocument(result).toJson(QJsonDocument::Indented);
+}
+
+} // namespace MTP::details
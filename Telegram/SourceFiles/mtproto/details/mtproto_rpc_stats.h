@@ -0,0 +1,68 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+#include "base/flat_map.h"
+
+#include <QtCore/QReadWriteLock>
+#include <array>
+#include <atomic>
+
+class QJsonObject;
+
+namespace MTP::details {
+
+// Power of two buckets, the last one takes everything that is larger.
+class RpcHistogram final {
+public:
+	static constexpr auto kBucketsCount = 24;
+
+	void add(uint64 value);
+	[[nodiscard]] QJsonObject toJson() const;
+
+private:
+	std::array<std::atomic<uint32>, kBucketsCount> _buckets{};
+	std::atomic<uint64> _sum = 0;
+
+};
+
+struct RpcMethodStats {
+	RpcHistogram latency;
+	RpcHistogram requestBytes;
+	RpcHistogram responseBytes;
+	std::atomic<uint32> errors = 0;
+	std::atomic<uint32> retries = 0;
+};
+
+// Per DC and per TL method counters, cheap enough to be always on.
+// The lock is taken for write only the first time a method is seen.
+class RpcStats final {
+public:
+	void responseReceived(
+		DcId dcId,
+		mtpTypeId method,
+		crl::time latency,
+		int requestBytes,
+		int responseBytes,
+		bool error);
+	void requestRetried(DcId dcId, mtpTypeId method);
+
+	[[nodiscard]] QByteArray toJson() const;
+
+private:
+	using Key = std::pair<DcId, mtpTypeId>;
+
+	[[nodiscard]] RpcMethodStats &entry(DcId dcId, mtpTypeId method);
+
+	mutable QReadWriteLock _lock;
+	base::flat_map<Key, std::unique_ptr<RpcMethodStats>> _methods;
+
+};
+
+} // namespace MTP::details
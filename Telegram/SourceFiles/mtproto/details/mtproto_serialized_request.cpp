@@ -9,9 +9,125 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "base/openssl_help.h"
 
+#include <QtCore/QMutex>
+#include <array>
+#include <atomic>
+
 namespace MTP::details {
 namespace {
 
+// Buffers of released small requests are kept by capacity class and
+// reused, so a typical request doesn't allocate on the heap at all.
+constexpr auto kPoolMinClassPrimes = 32;
+constexpr auto kPoolClassesCount = 8;
+constexpr auto kPoolMaxPerClass = 64;
+
+class RequestsPool final {
+public:
+	[[nodiscard]] RequestData *take(int sizeClass);
+	[[nodiscard]] bool put(not_null<RequestData*> data, int sizeClass);
+
+	void countAllocated();
+	void countFreed();
+	[[nodiscard]] SerializedRequestsPoolStats stats() const;
+
+private:
+	QMutex _mutex;
+	std::array<std::vector<RequestData*>, kPoolClassesCount> _free;
+	std::atomic<uint64> _allocated = 0;
+	std::atomic<uint64> _reused = 0;
+	std::atomic<uint64> _pooled = 0;
+	std::atomic<uint64> _freed = 0;
+
+};
+
+RequestData *RequestsPool::take(int sizeClass) {
+	Expects(sizeClass >= 0 && sizeClass < kPoolClassesCount);
+
+	QMutexLocker lock(&_mutex);
+	auto &list = _free[sizeClass];
+	if (list.empty()) {
+		return nullptr;
+	}
+	const auto result = list.back();
+	list.pop_back();
+	_reused.fetch_add(1, std::memory_order_relaxed);
+	return result;
+}
+
+bool RequestsPool::put(not_null<RequestData*> data, int sizeClass) {
+	Expects(sizeClass >= 0 && sizeClass < kPoolClassesCount);
+
+	QMutexLocker lock(&_mutex);
+	auto &list = _free[sizeClass];
+	if (list.size() >= kPoolMaxPerClass) {
+		return false;
+	}
+	list.push_back(data);
+	_pooled.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void RequestsPool::countAllocated() {
+	_allocated.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RequestsPool::countFreed() {
+	_freed.fetch_add(1, std::memory_order_relaxed);
+}
+
+SerializedRequestsPoolStats RequestsPool::stats() const {
+	auto result = SerializedRequestsPoolStats();
+	result.allocated = _allocated.load(std::memory_order_relaxed);
+	result.reused = _reused.load(std::memory_order_relaxed);
+	result.pooled = _pooled.load(std::memory_order_relaxed);
+	result.freed = _freed.load(std::memory_order_relaxed);
+	return result;
+}
+
+[[nodiscard]] RequestsPool &Pool() {
+	// Never destroyed, requests may be released during static destruction.
+	static const auto result = new RequestsPool();
+	return *result;
+}
+
+// Smallest class that fits the capacity, kPoolClassesCount if none fits.
+[[nodiscard]] int TakeSizeClass(uint32 capacity) {
+	auto result = 0;
+	while (result < kPoolClassesCount
+		&& uint32(kPoolMinClassPrimes << result) < capacity) {
+		++result;
+	}
+	return result;
+}
+
+// Largest class that the capacity fits, -1 if it is too small.
+[[nodiscard]] int PutSizeClass(int capacity) {
+	auto result = -1;
+	while (result + 1 < kPoolClassesCount
+		&& (kPoolMinClassPrimes << (result + 1)) <= capacity) {
+		++result;
+	}
+	return result;
+}
+
+void ReleaseRequestData(RequestData *data) {
+	data->after = SerializedRequest();
+	data->lastSentTime = 0;
+	data->requestId = 0;
+	data->needsLayer = false;
+	data->forceSendInContainer = false;
+	data->clear();
+
+	const auto sizeClass = PutSizeClass(data->capacity());
+	const auto tooLarge = (data->capacity()
+		> (kPoolMinClassPrimes << (kPoolClassesCount - 1)));
+	if (tooLarge || sizeClass < 0 || !Pool().put(data, sizeClass)) {
+		Pool().countFreed();
+		delete data;
+	}
+}
+
 uint32 CountPaddingPrimesCount(uint32 requestSize, bool extended, bool old) {
 	if (old) {
 		return ((8 + requestSize) & 0x03)
@@ -37,8 +153,23 @@ uint32 CountPaddingPrimesCount(uint32 requestSize, bool extended, bool old) {
 
 } // namespace
 
-SerializedRequest::SerializedRequest(const RequestConstructHider::Tag &tag)
-: _data(std::make_shared<RequestData>(tag)) {
+SerializedRequest::SerializedRequest(
+		const RequestConstructHider::Tag &tag,
+		uint32 capacity) {
+	const auto sizeClass = TakeSizeClass(capacity);
+	if (sizeClass == kPoolClassesCount) {
+		Pool().countAllocated();
+		_data = std::make_shared<RequestData>(tag);
+		_data->reserve(capacity);
+		return;
+	}
+	auto data = Pool().take(sizeClass);
+	if (!data) {
+		Pool().countAllocated();
+		data = new RequestData(tag);
+		data->reserve(kPoolMinClassPrimes << sizeClass);
+	}
+	_data = std::shared_ptr<RequestData>(data, ReleaseRequestData);
 }
 
 SerializedRequest SerializedRequest::Prepare(
@@ -48,14 +179,19 @@ SerializedRequest SerializedRequest::Prepare(
 
 	const auto finalSize = std::max(size, reserveSize);
 
-	auto result = SerializedRequest(RequestConstructHider::Tag{});
-	result->reserve(kMessageBodyPosition + finalSize);
+	auto result = SerializedRequest(
+		RequestConstructHider::Tag{},
+		kMessageBodyPosition + finalSize);
 	result->resize(kMessageBodyPosition);
 	result->back() = (size << 2);
 	result->lastSentTime = crl::now();
 	return result;
 }
 
+SerializedRequestsPoolStats SerializedRequest::PoolStats() {
+	return Pool().stats();
+}
+
 RequestData *SerializedRequest::operator->() const {
 	Expects(_data != nullptr);
 
@@ -23,6 +23,13 @@ class RequestConstructHider {
 	friend class SerializedRequest;
 };
 
+struct SerializedRequestsPoolStats {
+	uint64 allocated = 0;
+	uint64 reused = 0;
+	uint64 pooled = 0;
+	uint64 freed = 0;
+};
+
 class SerializedRequest {
 public:
 	SerializedRequest() = default;
@@ -42,6 +49,9 @@ public:
 
 	static SerializedRequest Prepare(uint32 size, uint32 reserveSize = 0);
 
+	// Thread-safe.
+	[[nodiscard]] static SerializedRequestsPoolStats PoolStats();
+
 	template <
 		typename Request,
 		typename = std::enable_if_t<tl::is_boxed_v<Request>>>
@@ -73,7 +83,7 @@ public:
 	using ResponseType = void; // don't know real response type =(
 
 private:
-	explicit SerializedRequest(const RequestConstructHider::Tag &);
+	SerializedRequest(const RequestConstructHider::Tag &, uint32 capacity);
 
 	[[nodiscard]] size_t sizeInBytes() const;
 	[[nodiscard]] const void *dataInBytes() const;
@@ -511,6 +511,8 @@ void TlsSocket::plainConnected() {
 void TlsSocket::plainDisconnected() {
 	_state = State::NotConnected;
 	_incoming = QByteArray();
+	_outgoing = QByteArray();
+	_incomingConsumed = 0;
 	_serverHelloLength = 0;
 	_incomingGoodDataOffset = 0;
 	_incomingGoodDataLimit = 0;
@@ -537,7 +539,7 @@ void TlsSocket::readHello() {
 		if (!_socket.bytesAvailable()) {
 			return;
 		}
-		_incoming.append(_socket.readAll());
+		appendIncoming();
 	}
 	checkHelloParts12(parts1Size);
 }
@@ -625,7 +627,8 @@ void TlsSocket::readData() {
 	if (!isConnected()) {
 		return;
 	}
-	_incoming.append(_socket.readAll());
+	compactIncoming();
+	appendIncoming();
 	if (!checkNextPacket()) {
 		handleError();
 	} else if (hasBytesAvailable()) {
@@ -634,11 +637,12 @@ void TlsSocket::readData() {
 }
 
 bool TlsSocket::checkNextPacket() {
-	auto offset = 0;
+	auto offset = _incomingConsumed;
 	const auto incoming = bytes::make_span(_incoming);
 	while (!_incomingGoodDataLimit) {
 		const auto fullHeader = kServerHeader.size() + kLengthSize;
 		if (incoming.size() <= offset + fullHeader) {
+			_incomingConsumed = offset;
 			return true;
 		}
 		if (!CheckPart(incoming.subspan(offset), kServerHeader)) {
@@ -649,10 +653,8 @@ bool TlsSocket::checkNextPacket() {
 			incoming,
 			offset + kServerHeader.size());
 		if (length > 0) {
-			if (offset > 0) {
-				shiftIncomingBy(offset);
-			}
-			_incomingGoodDataOffset = fullHeader;
+			_incomingConsumed = offset;
+			_incomingGoodDataOffset = offset + fullHeader;
 			_incomingGoodDataLimit = length;
 		} else {
 			offset += kServerHeader.size() + kLengthSize + length;
@@ -661,6 +663,32 @@ bool TlsSocket::checkNextPacket() {
 	return true;
 }
 
+void TlsSocket::compactIncoming() {
+	if (!_incomingConsumed) {
+		return;
+	}
+	if (_incomingGoodDataLimit) {
+		_incomingGoodDataOffset -= _incomingConsumed;
+	}
+	if (_incoming.size() > _incomingConsumed) {
+		_incoming.remove(0, _incomingConsumed);
+	} else {
+		_incoming.clear();
+	}
+	_incomingConsumed = 0;
+}
+
+void TlsSocket::appendIncoming() {
+	const auto available = _socket.bytesAvailable();
+	if (available <= 0) {
+		return;
+	}
+	const auto was = _incoming.size();
+	_incoming.resize(was + int(available));
+	const auto read = _socket.read(_incoming.data() + was, available);
+	_incoming.resize(was + int(std::max(read, qint64(0))));
+}
+
 void TlsSocket::shiftIncomingBy(int amount) {
 	Expects(_incomingGoodDataOffset == 0);
 	Expects(_incomingGoodDataLimit == 0);
@@ -723,7 +751,7 @@ int64 TlsSocket::read(bytes::span buffer) {
 		if (_incomingGoodDataLimit) {
 			return written;
 		}
-		shiftIncomingBy(base::take(_incomingGoodDataOffset));
+		_incomingConsumed = base::take(_incomingGoodDataOffset);
 		if (!checkNextPacket()) {
 			_state = State::Error;
 			InvokeQueued(this, [=] { handleError(); });
@@ -739,27 +767,42 @@ void TlsSocket::write(bytes::const_span prefix, bytes::const_span buffer) {
 	if (!isConnected()) {
 		return;
 	}
+
+	// Frame all the records in one reused buffer and write it at once.
+	const auto recordHeader = kClientHeader.size() + int(kLengthSize);
+	const auto payload = prefix.size() + buffer.size();
+	const auto records = (payload + kClientPartSize - 1) / kClientPartSize;
+	_outgoing.resize(0);
+	_outgoing.reserve(int((prefix.empty() ? 0 : kClientPrefix.size())
+		+ records * recordHeader
+		+ payload));
 	if (!prefix.empty()) {
-		_socket.write(kClientPrefix.data(), kClientPrefix.size());
+		_outgoing.append(kClientPrefix.data(), kClientPrefix.size());
 	}
 	while (!buffer.empty()) {
 		const auto write = std::min(
 			kClientPartSize - prefix.size(),
 			buffer.size());
-		_socket.write(kClientHeader.data(), kClientHeader.size());
+		_outgoing.append(kClientHeader.data(), kClientHeader.size());
 		const auto size = qToBigEndian(uint16(prefix.size() + write));
-		_socket.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		_outgoing.append(reinterpret_cast<const char*>(&size), sizeof(size));
 		if (!prefix.empty()) {
-			_socket.write(
+			_outgoing.append(
 				reinterpret_cast<const char*>(prefix.data()),
 				prefix.size());
 			prefix = bytes::const_span();
 		}
-		_socket.write(
+		_outgoing.append(
 			reinterpret_cast<const char*>(buffer.data()),
 			write);
 		buffer = buffer.subspan(write);
 	}
+	_socket.write(_outgoing);
+
+	constexpr auto kKeepOutgoingCapacity = 64 * 1024;
+	if (_outgoing.capacity() > kKeepOutgoingCapacity) {
+		_outgoing = QByteArray();
+	}
 }
 
 int32 TlsSocket::debugState() {
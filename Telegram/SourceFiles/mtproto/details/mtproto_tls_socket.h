@@ -52,11 +52,18 @@ private:
 	void readData();
 	[[nodiscard]] bool checkNextPacket();
 	void shiftIncomingBy(int amount);
+	void compactIncoming();
+	void appendIncoming();
 
 	const bytes::vector _secret;
 	QTcpSocket _socket;
 	State _state = State::NotConnected;
 	QByteArray _incoming;
+	QByteArray _outgoing;
+
+	// Records are parsed in place, consumed ones are dropped only once
+	// per socket read instead of moving the data after each record.
+	int _incomingConsumed = 0;
 	int _incomingGoodDataOffset = 0;
 	int _incomingGoodDataLimit = 0;
 	int16 _serverHelloLength = 0;
@@ -0,0 +1,90 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_trace.h"
+
+namespace MTP::details {
+namespace {
+
+constexpr auto kTraceRecordsCount = 16384;
+
+struct Record {
+	// Index of the record plus one, stored last, zero while writing.
+	std::atomic<uint64> sequence = 0;
+	crl::time time = 0;
+	mtpMsgId msgId = 0;
+	mtpTypeId type = 0;
+	uint32 size = 0;
+	ShiftedDcId shiftedDcId = 0;
+	TraceDirection direction = TraceDirection::Sent;
+};
+
+// Zero initialized, so the memory is not touched until tracing is enabled.
+Record Records[kTraceRecordsCount];
+std::atomic<uint64> RecordsWritten = 0;
+
+} // namespace
+
+void TraceRecord(
+		TraceDirection direction,
+		ShiftedDcId shiftedDcId,
+		mtpMsgId msgId,
+		mtpTypeId type,
+		uint32 size) {
+	const auto index = RecordsWritten.fetch_add(
+		1,
+		std::memory_order_relaxed);
+	auto &record = Records[index % kTraceRecordsCount];
+	record.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	record.time = crl::now();
+	record.msgId = msgId;
+	record.type = type;
+	record.size = size;
+	record.shiftedDcId = shiftedDcId;
+	record.direction = direction;
+	record.sequence.store(index + 1, std::memory_order_release);
+}
+
+void TraceSetEnabled(bool enabled) {
+	TraceEnabledFlag.store(enabled, std::memory_order_relaxed);
+}
+
+QString TraceDump() {
+	const auto written = RecordsWritten.load(std::memory_order_acquire);
+	const auto from = (written > kTraceRecordsCount)
+		? (written - kTraceRecordsCount)
+		: uint64(0);
+	auto result = QStringList();
+	result.reserve(int(written - from));
+	for (auto index = from; index != written; ++index) {
+		const auto &record = Records[index % kTraceRecordsCount];
+		if (record.sequence.load(std::memory_order_acquire) != index + 1) {
+			continue;
+		}
+		const auto time = record.time;
+		const auto msgId = record.msgId;
+		const auto type = record.type;
+		const auto size = record.size;
+		const auto shiftedDcId = record.shiftedDcId;
+		const auto direction = record.direction;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (record.sequence.load(std::memory_order_relaxed) != index + 1) {
+			continue;
+		}
+		result.push_back(QString("%1 dc:%2 %3 msg_id:%4 type:0x%5 size:%6"
+		).arg(time
+		).arg(shiftedDcId
+		).arg((direction == TraceDirection::Sent) ? "->" : "<-"
+		).arg(msgId
+		).arg(type, 8, 16, QChar('0')
+		).arg(size));
+	}
+	return result.join('\n');
+}
+
+} // namespace MTP::details
@@ -0,0 +1,41 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+
+#include <atomic>
+
+namespace MTP::details {
+
+enum class TraceDirection : uchar {
+	Sent,
+	Received,
+};
+
+// Binary ring buffer of the last messages passed through the sessions.
+// Recording is a relaxed flag check when disabled and a few stores when
+// enabled, the text is rendered only in TraceDump().
+// Callers check TraceEnabled() so that arguments aren't even computed.
+inline std::atomic<bool> TraceEnabledFlag = false;
+
+[[nodiscard]] inline bool TraceEnabled() {
+	return TraceEnabledFlag.load(std::memory_order_relaxed);
+}
+
+void TraceRecord(
+	TraceDirection direction,
+	ShiftedDcId shiftedDcId,
+	mtpMsgId msgId,
+	mtpTypeId type,
+	uint32 size);
+
+void TraceSetEnabled(bool enabled);
+[[nodiscard]] QString TraceDump();
+
+} // namespace MTP::details
@@ -8,7 +8,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/mtp_instance.h"
 
 #include "mtproto/details/mtproto_dcenter.h"
+#include "mtproto/details/mtproto_requests_map.h"
 #include "mtproto/details/mtproto_rsa_public_key.h"
+#include "mtproto/details/mtproto_rpc_stats.h"
 #include "mtproto/special_config_request.h"
 #include "mtproto/session.h"
 #include "mtproto/dc_options.h"
@@ -36,6 +38,13 @@ constexpr auto kCheckKeyEach = 60 * crl::time(1000);
 
 using namespace details;
 
+[[nodiscard]] mtpTypeId RequestMethod(const SerializedRequest &request) {
+	constexpr auto kPosition = SerializedRequest::kMessageBodyPosition;
+	return (request && request->size() > kPosition)
+		? mtpTypeId((*request)[kPosition])
+		: mtpTypeId(0);
+}
+
 std::atomic<int> GlobalAtomicRequestId = 0;
 
 } // namespace
@@ -159,6 +168,9 @@ public:
 
 	void prepareToDestroy();
 
+	[[nodiscard]] QString requestsLockStats() const;
+	[[nodiscard]] QByteArray rpcStatsJson() const;
+
 private:
 	bool hasAuthorization();
 	void importDone(const MTPauth_Authorization &result, mtpRequestId requestId);
@@ -190,6 +202,9 @@ private:
 		mtpRequestId requestId, DcId newdc);
 
 	void checkDelayedRequests();
+	void requestRetried(
+		const SerializedRequest &request,
+		ShiftedDcId shiftedDcId);
 
 	const not_null<Instance*> _instance;
 	const not_null<DcOptions*> _dcOptions;
@@ -227,17 +242,14 @@ private:
 	rpl::event_stream<> _allKeysDestroyed;
 
 	// holds dcWithShift for request to this dc or -dc for request to main dc
-	std::map<mtpRequestId, ShiftedDcId> _requestsByDc;
-	mutable QMutex _requestByDcLock;
+	RequestsMap<ShiftedDcId> _requestsByDc;
 
 	// holds target dcWithShift for auth export request
 	std::map<mtpRequestId, ShiftedDcId> _authExportRequests;
 
-	std::map<mtpRequestId, RPCResponseHandler> _parserMap;
-	QMutex _parserMapLock;
-
-	std::map<mtpRequestId, SerializedRequest> _requestMap;
-	QReadWriteLock _requestMapLock;
+	RequestsMap<RPCResponseHandler> _parserMap;
+	RequestsMap<SerializedRequest> _requestMap;
+	RpcStats _rpcStats;
 
 	std::deque<std::pair<mtpRequestId, crl::time>> _delayedRequests;
 
@@ -552,13 +564,8 @@ void Instance::Private::cancel(mtpRequestId requestId) {
 	DEBUG_LOG(("MTP Info: Cancel request %1.").arg(requestId));
 	const auto shiftedDcId = queryRequestByDc(requestId);
 	auto msgId = mtpMsgId(0);
-	{
-		QWriteLocker locker(&_requestMapLock);
-		auto it = _requestMap.find(requestId);
-		if (it != _requestMap.end()) {
-			msgId = *(mtpMsgId*)(it->second->constData() + 4);
-			_requestMap.erase(it);
-		}
+	if (const auto request = _requestMap.take(requestId)) {
+		msgId = *(mtpMsgId*)((*request)->constData() + 4);
 	}
 	unregisterRequest(requestId);
 	if (shiftedDcId) {
@@ -566,8 +573,7 @@ void Instance::Private::cancel(mtpRequestId requestId) {
 		session->cancel(requestId, msgId);
 	}
 
-	QMutexLocker locker(&_parserMapLock);
-	_parserMap.erase(requestId);
+	_parserMap.remove(requestId);
 }
 
 // result < 0 means waiting for such count of ms.
@@ -866,28 +872,19 @@ bool Instance::Private::configLoadFail(const RPCError &error) {
 
 std::optional<ShiftedDcId> Instance::Private::queryRequestByDc(
 		mtpRequestId requestId) const {
-	QMutexLocker locker(&_requestByDcLock);
-	auto it = _requestsByDc.find(requestId);
-	if (it != _requestsByDc.cend()) {
-		return it->second;
-	}
-	return std::nullopt;
+	return _requestsByDc.find(requestId);
 }
 
 std::optional<ShiftedDcId> Instance::Private::changeRequestByDc(
 		mtpRequestId requestId,
 		DcId newdc) {
-	QMutexLocker locker(&_requestByDcLock);
-	auto it = _requestsByDc.find(requestId);
-	if (it != _requestsByDc.cend()) {
-		if (it->second < 0) {
-			it->second = -newdc;
+	return _requestsByDc.modify(requestId, [&](ShiftedDcId &shiftedDcId) {
+		if (shiftedDcId < 0) {
+			shiftedDcId = -newdc;
 		} else {
-			it->second = ShiftDcId(newdc, GetDcIdShift(it->second));
+			shiftedDcId = ShiftDcId(newdc, GetDcIdShift(shiftedDcId));
 		}
-		return it->second;
-	}
-	return std::nullopt;
+	});
 }
 
 void Instance::Private::checkDelayedRequests() {
@@ -904,18 +901,14 @@ void Instance::Private::checkDelayedRequests() {
 			continue;
 		}
 
-		auto request = SerializedRequest();
-		{
-			QReadLocker locker(&_requestMapLock);
-			auto it = _requestMap.find(requestId);
-			if (it == _requestMap.cend()) {
-				DEBUG_LOG(("MTP Error: could not find request %1").arg(requestId));
-				continue;
-			}
-			request = it->second;
+		const auto request = _requestMap.find(requestId);
+		if (!request) {
+			DEBUG_LOG(("MTP Error: could not find request %1").arg(requestId));
+			continue;
 		}
 		const auto session = getSession(qAbs(dcWithShift));
-		session->sendPrepared(request);
+		requestRetried(*request, dcWithShift);
+		session->sendPrepared(*request);
 	}
 
 	if (!_delayedRequests.empty()) {
@@ -923,6 +916,14 @@ void Instance::Private::checkDelayedRequests() {
 	}
 }
 
+void Instance::Private::requestRetried(
+		const SerializedRequest &request,
+		ShiftedDcId shiftedDcId) {
+	_rpcStats.requestRetried(
+		BareDcId(qAbs(shiftedDcId)),
+		RequestMethod(request));
+}
+
 void Instance::Private::sendRequest(
 		mtpRequestId requestId,
 		SerializedRequest &&request,
@@ -953,22 +954,15 @@ void Instance::Private::sendRequest(
 void Instance::Private::registerRequest(
 		mtpRequestId requestId,
 		ShiftedDcId shiftedDcId) {
-	QMutexLocker locker(&_requestByDcLock);
-	_requestsByDc[requestId] = shiftedDcId;
+	_requestsByDc.set(requestId, shiftedDcId);
 }
 
 void Instance::Private::unregisterRequest(mtpRequestId requestId) {
 	DEBUG_LOG(("MTP Info: unregistering request %1.").arg(requestId));
 
 	_requestsDelays.erase(requestId);
-
-	{
-		QWriteLocker locker(&_requestMapLock);
-		_requestMap.erase(requestId);
-	}
-
-	QMutexLocker locker(&_requestByDcLock);
-	_requestsByDc.erase(requestId);
+	_requestMap.remove(requestId);
+	_requestsByDc.remove(requestId);
 }
 
 void Instance::Private::storeRequest(
@@ -976,25 +970,13 @@ void Instance::Private::storeRequest(
 		const SerializedRequest &request,
 		RPCResponseHandler &&callbacks) {
 	if (callbacks.onDone || callbacks.onFail) {
-		QMutexLocker locker(&_parserMapLock);
-		_parserMap.emplace(requestId, std::move(callbacks));
-	}
-	{
-		QWriteLocker locker(&_requestMapLock);
-		_requestMap.emplace(requestId, request);
+		_parserMap.set(requestId, std::move(callbacks));
 	}
+	_requestMap.set(requestId, request);
 }
 
 SerializedRequest Instance::Private::getRequest(mtpRequestId requestId) {
-	auto result = SerializedRequest();
-	{
-		QReadLocker locker(&_requestMapLock);
-		auto it = _requestMap.find(requestId);
-		if (it != _requestMap.cend()) {
-			result = it->second;
-		}
-	}
-	return result;
+	return _requestMap.find(requestId).value_or(SerializedRequest());
 }
 
 
@@ -1002,16 +984,19 @@ void Instance::Private::execCallback(
 		mtpRequestId requestId,
 		const mtpPrime *from,
 		const mtpPrime *end) {
-	RPCResponseHandler h;
-	{
-		QMutexLocker locker(&_parserMapLock);
-		auto it = _parserMap.find(requestId);
-		if (it != _parserMap.cend()) {
-			h = it->second;
-			_parserMap.erase(it);
-
-			DEBUG_LOG(("RPC Info: found parser for request %1, trying to parse response...").arg(requestId));
-		}
+	if (const auto request = _requestMap.find(requestId)) {
+		const auto shiftedDcId = _requestsByDc.find(requestId);
+		_rpcStats.responseReceived(
+			shiftedDcId ? BareDcId(qAbs(*shiftedDcId)) : DcId(0),
+			RequestMethod(*request),
+			crl::now() - (*request)->lastSentTime,
+			int(request->messageSize() * sizeof(mtpPrime)),
+			int((end - from) * sizeof(mtpPrime)),
+			(from < end && *from == mtpc_rpc_error));
+	}
+	auto h = _parserMap.take(requestId).value_or(RPCResponseHandler());
+	if (h.onDone || h.onFail) {
+		DEBUG_LOG(("RPC Info: found parser for request %1, trying to parse response...").arg(requestId));
 	}
 	if (h.onDone || h.onFail) {
 		const auto handleError = [&](const RPCError &error) {
@@ -1023,8 +1008,7 @@ void Instance::Private::execCallback(
 			if (rpcErrorOccured(requestId, h, error)) {
 				unregisterRequest(requestId);
 			} else {
-				QMutexLocker locker(&_parserMapLock);
-				_parserMap.emplace(requestId, h);
+				_parserMap.set(requestId, h);
 			}
 		};
 
@@ -1054,9 +1038,7 @@ void Instance::Private::execCallback(
 }
 
 bool Instance::Private::hasCallbacks(mtpRequestId requestId) {
-	QMutexLocker locker(&_parserMapLock);
-	auto it = _parserMap.find(requestId);
-	return (it != _parserMap.cend());
+	return _parserMap.contains(requestId);
 }
 
 void Instance::Private::globalCallback(const mtpPrime *from, const mtpPrime *end) {
@@ -1120,10 +1102,9 @@ void Instance::Private::importDone(const MTPauth_Authorization &result, mtpReque
 
 	auto &waiters = _authWaiters[newdc];
 	if (waiters.size()) {
-		QReadLocker locker(&_requestMapLock);
 		for (auto waitedRequestId : waiters) {
-			auto it = _requestMap.find(waitedRequestId);
-			if (it == _requestMap.cend()) {
+			const auto request = _requestMap.find(waitedRequestId);
+			if (!request) {
 				LOG(("MTP Error: could not find request %1 for resending").arg(waitedRequestId));
 				continue;
 			}
@@ -1136,7 +1117,8 @@ void Instance::Private::importDone(const MTPauth_Authorization &result, mtpReque
 			}
 			DEBUG_LOG(("MTP Info: resending request %1 to dc %2 after import auth").arg(waitedRequestId).arg(*shiftedDcId));
 			const auto session = getSession(*shiftedDcId);
-			session->sendPrepared(it->second);
+			requestRetried(*request, *shiftedDcId);
+			session->sendPrepared(*request);
 		}
 		waiters.clear();
 	}
@@ -1243,19 +1225,17 @@ bool Instance::Private::onErrorDefault(mtpRequestId requestId, const RPCError &e
 		}
 
 		auto request = SerializedRequest();
-		{
-			QReadLocker locker(&_requestMapLock);
-			auto it = _requestMap.find(requestId);
-			if (it == _requestMap.cend()) {
-				LOG(("MTP Error: could not find request %1").arg(requestId));
-				return false;
-			}
-			request = it->second;
+		if (const auto found = _requestMap.find(requestId)) {
+			request = *found;
+		} else {
+			LOG(("MTP Error: could not find request %1").arg(requestId));
+			return false;
 		}
 		const auto session = getSession(newdcWithShift);
 		registerRequest(
 			requestId,
 			(dcWithShift < 0) ? -newdcWithShift : newdcWithShift);
+		requestRetried(request, newdcWithShift);
 		session->sendPrepared(request);
 		return true;
 	} else if (code < 0 || code >= 500 || (m = QRegularExpression("^FLOOD_WAIT_(\\d+)$").match(err)).hasMatch()) {
@@ -1272,6 +1252,9 @@ bool Instance::Private::onErrorDefault(mtpRequestId requestId, const RPCError &e
 		} else {
 			secs = m.captured(1).toInt();
 //			if (secs >= 60) return false;
+			DEBUG_LOG(("MTP Info: flood wait %1 seconds for request %2"
+				).arg(secs
+				).arg(requestId));
 		}
 		auto sendAt = crl::now() + secs * 1000 + 10;
 		auto it = _delayedRequests.begin(), e = _delayedRequests.end();
@@ -1315,14 +1298,11 @@ bool Instance::Private::onErrorDefault(mtpRequestId requestId, const RPCError &e
 		return true;
 	} else if (err == qstr("CONNECTION_NOT_INITED") || err == qstr("CONNECTION_LAYER_INVALID")) {
 		SerializedRequest request;
-		{
-			QReadLocker locker(&_requestMapLock);
-			auto it = _requestMap.find(requestId);
-			if (it == _requestMap.cend()) {
-				LOG(("MTP Error: could not find request %1").arg(requestId));
-				return false;
-			}
-			request = it->second;
+		if (const auto found = _requestMap.find(requestId)) {
+			request = *found;
+		} else {
+			LOG(("MTP Error: could not find request %1").arg(requestId));
+			return false;
 		}
 		auto dcWithShift = ShiftedDcId(0);
 		if (const auto shiftedDcId = queryRequestByDc(requestId)) {
@@ -1340,14 +1320,11 @@ bool Instance::Private::onErrorDefault(mtpRequestId requestId, const RPCError &e
 		Lang::CurrentCloudManager().resetToDefault();
 	} else if (err == qstr("MSG_WAIT_FAILED")) {
 		SerializedRequest request;
-		{
-			QReadLocker locker(&_requestMapLock);
-			auto it = _requestMap.find(requestId);
-			if (it == _requestMap.cend()) {
-				LOG(("MTP Error: could not find request %1").arg(requestId));
-				return false;
-			}
-			request = it->second;
+		if (const auto found = _requestMap.find(requestId)) {
+			request = *found;
+		} else {
+			LOG(("MTP Error: could not find request %1").arg(requestId));
+			return false;
 		}
 		if (!request->after) {
 			LOG(("MTP Error: wait failed for not dependent request %1").arg(requestId));
@@ -1599,7 +1576,36 @@ void Instance::Private::clearGlobalHandlers() {
 	setSessionResetHandler(Fn<void(ShiftedDcId)>());
 }
 
+QString Instance::Private::requestsLockStats() const {
+	const auto format = [](const char *name, RequestsMapLockStats stats) {
+		return QString("%1: %2 locks, %3 contended, %4 ms waited"
+		).arg(name
+		).arg(stats.locks
+		).arg(stats.contended
+		).arg(stats.waitedNanoseconds / 1000000.);
+	};
+	return QStringList{
+		format("requests", _requestMap.lockStats()),
+		format("parsers", _parserMap.lockStats()),
+		format("dcs", _requestsByDc.lockStats()),
+	}.join("; ");
+}
+
+QByteArray Instance::Private::rpcStatsJson() const {
+	return _rpcStats.toJson();
+}
+
 void Instance::Private::prepareToDestroy() {
+	DEBUG_LOG(("MTP Info: requests maps lock stats: %1"
+		).arg(requestsLockStats()));
+	const auto pool = SerializedRequest::PoolStats();
+	DEBUG_LOG(("MTP Info: requests pool stats: "
+		"%1 allocated, %2 reused, %3 pooled, %4 freed"
+		).arg(pool.allocated
+		).arg(pool.reused
+		).arg(pool.pooled
+		).arg(pool.freed));
+
 	// It accesses Instance in destructor, so it should be destroyed first.
 	_configLoader.reset();
 
@@ -1780,6 +1786,14 @@ QString Instance::systemVersion() const {
 	return _private->systemVersion();
 }
 
+QString Instance::requestsLockStats() const {
+	return _private->requestsLockStats();
+}
+
+QByteArray Instance::rpcStatsJson() const {
+	return _private->rpcStatsJson();
+}
+
 void Instance::unpaused() {
 	_private->unpaused();
 }
@@ -65,6 +65,8 @@ public:
 	// Thread-safe.
 	[[nodiscard]] QString deviceModel() const;
 	[[nodiscard]] QString systemVersion() const;
+	[[nodiscard]] QString requestsLockStats() const;
+	[[nodiscard]] QByteArray rpcStatsJson() const;
 
 	// Main thread.
 	void dcPersistentKeyChanged(DcId dcId, const AuthKeyPtr &persistentKey);
@@ -11,7 +11,75 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/mtproto_rpc_sender.h"
 #include "mtproto/facade.h"
 
+#include <QtCore/QMutex>
+#include <deque>
+
 namespace MTP {
+namespace {
+
+// Don't block the receiving thread for too long with one batch.
+constexpr auto kMaxBatchSize = 64;
+
+} // namespace
+
+class ConcurrentSender::Batcher final
+	: public std::enable_shared_from_this<Batcher> {
+public:
+	explicit Batcher(Fn<void(FnMut<void()>)> runner);
+
+	void push(FnMut<void()> &&callback);
+
+private:
+	void run();
+
+	const Fn<void(FnMut<void()>)> _runner;
+	QMutex _mutex;
+	std::deque<FnMut<void()>> _queue;
+	bool _scheduled = false;
+
+};
+
+ConcurrentSender::Batcher::Batcher(Fn<void(FnMut<void()>)> runner)
+: _runner(std::move(runner)) {
+}
+
+void ConcurrentSender::Batcher::push(FnMut<void()> &&callback) {
+	QMutexLocker lock(&_mutex);
+	_queue.push_back(std::move(callback));
+	if (_scheduled) {
+		return;
+	}
+	_scheduled = true;
+	lock.unlock();
+
+	_runner([that = shared_from_this()] { that->run(); });
+}
+
+void ConcurrentSender::Batcher::run() {
+	auto batch = std::vector<FnMut<void()>>();
+	{
+		QMutexLocker lock(&_mutex);
+		const auto count = std::min(int(_queue.size()), kMaxBatchSize);
+		batch.reserve(count);
+		for (auto i = 0; i != count; ++i) {
+			batch.push_back(std::move(_queue.front()));
+			_queue.pop_front();
+		}
+	}
+	for (auto &callback : batch) {
+		callback();
+	}
+
+	QMutexLocker lock(&_mutex);
+	if (_queue.empty()) {
+		_scheduled = false;
+		return;
+	}
+	lock.unlock();
+
+	// Let the receiving event loop breathe between batches.
+	_runner([that = shared_from_this()] { that->run(); });
+}
 
 class ConcurrentSender::RPCDoneHandler : public RPCAbstractDoneHandler {
 public:
@@ -102,11 +170,16 @@ bool ConcurrentSender::RPCFailHandler::operator()(
 template <typename Method>
 auto ConcurrentSender::with_instance(Method &&method)
 -> std::enable_if_t<is_callable_v<Method, not_null<Instance*>>> {
-	crl::on_main([method = std::forward<Method>(method)]() mutable {
+	auto callback = [method = std::forward<Method>(method)]() mutable {
 		if (const auto instance = MainInstance()) {
 			std::move(method)(instance);
 		}
-	});
+	};
+	if (_toMain) {
+		_toMain->push(std::move(callback));
+	} else {
+		crl::on_main(std::move(callback));
+	}
 }
 
 ConcurrentSender::RequestBuilder::RequestBuilder(
@@ -162,8 +235,21 @@ mtpRequestId ConcurrentSender::RequestBuilder::send() {
 	return requestId;
 }
 
-ConcurrentSender::ConcurrentSender(Fn<void(FnMut<void()>)> runner)
-: _runner(runner) {
+ConcurrentSender::ConcurrentSender(
+	Fn<void(FnMut<void()>)> runner,
+	Delivery delivery)
+: _toMain((delivery == Delivery::Batched)
+	? std::make_shared<Batcher>([](FnMut<void()> &&callback) {
+		crl::on_main(std::move(callback));
+	})
+	: nullptr)
+, _runner((delivery == Delivery::Batched)
+	? Fn<void(FnMut<void()>)>([
+			batcher = std::make_shared<Batcher>(std::move(runner))
+		](FnMut<void()> callback) {
+			batcher->push(std::move(callback));
+		})
+	: std::move(runner)) {
 }
 
 ConcurrentSender::~ConcurrentSender() {
@@ -87,7 +87,15 @@ class ConcurrentSender : public base::has_weak_ptr {
 	};
 
 public:
-	ConcurrentSender(Fn<void(FnMut<void()>)> runner);
+	// In Batched mode callbacks posted in one burst, both to the main
+	// thread and to the runner, are delivered in a single invocation.
+	enum class Delivery {
+		Immediate,
+		Batched,
+	};
+	ConcurrentSender(
+		Fn<void(FnMut<void()>)> runner,
+		Delivery delivery = Delivery::Immediate);
 
 	template <typename Request>
 	class SpecificRequestBuilder : public RequestBuilder {
@@ -175,6 +183,7 @@ public:
 	~ConcurrentSender();
 
 private:
+	class Batcher;
 	class RPCDoneHandler;
 	friend class RPCDoneHandler;
 	class RPCFailHandler;
@@ -193,6 +202,7 @@ private:
 	void senderRequestCancelAll();
 	void senderRequestDetach(mtpRequestId requestId);
 
+	const std::shared_ptr<Batcher> _toMain;
 	const Fn<void(FnMut<void()>)> _runner;
 	base::flat_map<mtpRequestId, Handlers> _requests;
 
@@ -16,6 +16,15 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace MTP {
 namespace details {
+namespace {
+
+// Requests sent right after another one are held for a short window,
+// a fraction of the measured round trip time, and go in one container.
+constexpr auto kSendBatchingWindowMin = crl::time(2);
+constexpr auto kSendBatchingWindowMax = crl::time(20);
+constexpr auto kSendBatchingRttDivider = 16;
+
+} // namespace
 
 SessionOptions::SessionOptions(
 	const QString &systemLangCode,
@@ -93,6 +102,20 @@ void SessionData::queueSendAnything(crl::time msCanWait) {
 	});
 }
 
+void SessionData::updateRoundTripTime(crl::time sample) {
+	if (sample < 0) {
+		return;
+	}
+	const auto was = _roundTripTime.load(std::memory_order_relaxed);
+	_roundTripTime.store(
+		was ? ((was * 7 + sample) / 8) : sample,
+		std::memory_order_relaxed);
+}
+
+crl::time SessionData::roundTripTime() const {
+	return _roundTripTime.load(std::memory_order_relaxed);
+}
+
 bool SessionData::connectionInited() const {
 	QMutexLocker lock(&_ownerMutex);
 	return _owner ? _owner->connectionInited() : false;
@@ -444,11 +467,26 @@ void Session::sendPrepared(
 	DEBUG_LOG(("MTP Info: added, requestId %1").arg(request->requestId));
 	if (msCanWait >= 0) {
 		InvokeQueued(this, [=] {
-			sendAnything(msCanWait);
+			sendAnything(msCanWait ? msCanWait : sendBatchingDelay());
 		});
 	}
 }
 
+crl::time Session::sendBatchingDelay() {
+	// The first request after a quiet period is sent right away, so that
+	// a single interactive request never waits for the batching window.
+	const auto now = crl::now();
+	const auto window = std::clamp(
+		_data->roundTripTime() / kSendBatchingRttDivider,
+		kSendBatchingWindowMin,
+		kSendBatchingWindowMax);
+	if (now - _batchStartedAt >= window) {
+		_batchStartedAt = now;
+		return 0;
+	}
+	return window;
+}
+
 CreatingKeyType Session::acquireKeyCreation(DcType type) {
 	Expects(_myKeyCreation == CreatingKeyType::None);
 
@@ -569,16 +607,14 @@ void Session::tryToReceive() {
 		for (const auto &[requestId, response] : responses) {
 			_instance->execCallback(
 				requestId,
-				response.constData(),
-				response.constData() + response.size());
+				response.from(),
+				response.till());
 		}
 
 		// Call globalCallback only in main session.
 		if (_shiftedDcId == BareDcId(_shiftedDcId)) {
 			for (const auto &update : updates) {
-				_instance->globalCallback(
-					update.constData(),
-					update.constData() + update.size());
+				_instance->globalCallback(update.from(), update.till());
 			}
 		}
 	}
@@ -52,6 +52,52 @@ struct SessionOptions {
 
 };
 
+// A part of a received decrypted packet. It shares the packet buffer with
+// all the other responses and updates parsed from it, so containers can be
+// split without copying each contained message to a separate buffer.
+class ReceivedSlice final {
+public:
+	ReceivedSlice() = default;
+	explicit ReceivedSlice(mtpBuffer &&buffer)
+	: _buffer(std::move(buffer))
+	, _size(_buffer.size()) {
+	}
+	ReceivedSlice(
+		const mtpBuffer &buffer,
+		const mtpPrime *from,
+		const mtpPrime *till)
+	: _buffer(buffer)
+	, _offset(from - buffer.constData())
+	, _size(till - from) {
+		Expects(_offset >= 0 && _size >= 0);
+		Expects(_offset + _size <= _buffer.size());
+	}
+
+	[[nodiscard]] const mtpPrime *from() const {
+		return _buffer.constData() + _offset;
+	}
+	[[nodiscard]] const mtpPrime *till() const {
+		return from() + _size;
+	}
+	[[nodiscard]] int size() const {
+		return _size;
+	}
+	[[nodiscard]] bool empty() const {
+		return !_size;
+	}
+	[[nodiscard]] mtpPrime operator[](int index) const {
+		Expects(index >= 0 && index < _size);
+
+		return from()[index];
+	}
+
+private:
+	mtpBuffer _buffer;
+	int _offset = 0;
+	int _size = 0;
+
+};
+
 class Session;
 class SessionData final {
 public:
@@ -84,10 +130,10 @@ public:
 	base::flat_map<mtpMsgId, SerializedRequest> &haveSentMap() {
 		return _haveSent;
 	}
-	base::flat_map<mtpRequestId, mtpBuffer> &haveReceivedResponses() {
+	base::flat_map<mtpRequestId, ReceivedSlice> &haveReceivedResponses() {
 		return _receivedResponses;
 	}
-	std::vector<mtpBuffer> &haveReceivedUpdates() {
+	std::vector<ReceivedSlice> &haveReceivedUpdates() {
 		return _receivedUpdates;
 	}
 
@@ -98,6 +144,10 @@ public:
 	void queueResetDone();
 	void queueSendAnything(crl::time msCanWait = 0);
 
+	// SessionPrivate thread writes, Session thread reads.
+	void updateRoundTripTime(crl::time sample);
+	[[nodiscard]] crl::time roundTripTime() const;
+
 	[[nodiscard]] bool connectionInited() const;
 	[[nodiscard]] AuthKeyPtr getPersistentKey() const;
 	[[nodiscard]] AuthKeyPtr getTemporaryKey(TemporaryKeyType type) const;
@@ -122,14 +172,16 @@ private:
 	SessionOptions _options;
 	mutable QReadWriteLock _optionsLock;
 
+	std::atomic<crl::time> _roundTripTime = 0;
+
 	base::flat_map<mtpRequestId, SerializedRequest> _toSend; // map of request_id -> request, that is waiting to be sent
 	QReadWriteLock _toSendLock;
 
 	base::flat_map<mtpMsgId, SerializedRequest> _haveSent; // map of msg_id -> request, that was sent
 	QReadWriteLock _haveSentLock;
 
-	base::flat_map<mtpRequestId, mtpBuffer> _receivedResponses; // map of request_id -> response that should be processed in the main thread
-	std::vector<mtpBuffer> _receivedUpdates; // list of updates that should be processed in the main thread
+	base::flat_map<mtpRequestId, ReceivedSlice> _receivedResponses; // map of request_id -> response that should be processed in the main thread
+	std::vector<ReceivedSlice> _receivedUpdates; // list of updates that should be processed in the main thread
 	QReadWriteLock _haveReceivedLock;
 
 };
@@ -192,6 +244,8 @@ private:
 
 	void killConnection();
 
+	[[nodiscard]] crl::time sendBatchingDelay();
+
 	bool rpcErrorOccured(
 		mtpRequestId requestId,
 		const RPCFailHandlerPtr &onFail,
@@ -217,6 +271,7 @@ private:
 
 	crl::time _msSendCall = 0;
 	crl::time _msWait = 0;
+	crl::time _batchStartedAt = 0;
 
 	bool _ping = false;
 
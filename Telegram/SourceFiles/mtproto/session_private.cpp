@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/details/mtproto_dcenter.h"
 #include "mtproto/details/mtproto_dump_to_text.h"
 #include "mtproto/details/mtproto_rsa_public_key.h"
+#include "mtproto/details/mtproto_trace.h"
 #include "mtproto/session.h"
 #include "mtproto/mtproto_rpc_sender.h"
 #include "mtproto/dc_options.h"
@@ -18,7 +19,6 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/openssl_help.h"
 #include "base/qthelp_url.h"
 #include "base/unixtime.h"
-#include "zlib.h"
 
 namespace MTP {
 namespace details {
@@ -26,6 +26,8 @@ namespace {
 
 constexpr auto kIntSize = static_cast<int>(sizeof(mtpPrime));
 constexpr auto kWaitForBetterTimeout = crl::time(2000);
+constexpr auto kTryOtherEndpointsAfter = crl::time(300);
+constexpr auto kPreferredEndpointPriority = 4;
 constexpr auto kMinConnectedTimeout = crl::time(1000);
 constexpr auto kMaxConnectedTimeout = crl::time(8000);
 constexpr auto kMinReceiveTimeout = crl::time(4000);
@@ -57,8 +59,96 @@ constexpr auto kSendStateRequestWaiting = crl::time(1000);
 // How much time to wait for some more requests, when sending msg acks.
 constexpr auto kAckSendWaiting = 10 * crl::time(1000);
 
+constexpr auto kExternalHeaderIntsCount = 6U; // 2 auth_key_id, 4 msg_key
+constexpr auto kEncryptedHeaderIntsCount = 8U; // 2 salt, 2 session, 2 msg_id, 1 seq_no, 1 length
+constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
+constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
+
+// Received packets at least this large are decrypted on the crl::async
+// thread pool, when several of them are waiting to be handled at once.
+constexpr auto kParallelDecryptMinSize = 64 * 1024;
+constexpr auto kParallelDecryptMaxCount = 8;
+
 using namespace details;
 
+[[nodiscard]] bool ReceivedPacketLooksGood(
+		const mtpBuffer &buffer,
+		uint64 keyId) {
+	const auto intsCount = uint32(buffer.size());
+	return (intsCount >= kMinimalIntsCount)
+		&& (intsCount <= kMaxMessageLength / kIntSize)
+		&& (*(const uint64*)buffer.constData() == keyId);
+}
+
+#ifndef TDESKTOP_MTPROTO_OLD
+// Decrypts the packet in place and returns whether msg_key matches.
+[[nodiscard]] bool DecryptReceivedPacket(
+		mtpBuffer &buffer,
+		const AuthKeyPtr &key) {
+	const auto ints = buffer.data();
+	const auto encryptedInts = ints + kExternalHeaderIntsCount;
+	const auto encryptedIntsCount = (uint32(buffer.size())
+		- kExternalHeaderIntsCount) & ~0x03U;
+	const auto encryptedBytesCount = encryptedIntsCount * kIntSize;
+	const auto msgKey = *(MTPint128*)(ints + 2);
+
+	aesIgeDecrypt(
+		encryptedInts,
+		encryptedInts,
+		encryptedBytesCount,
+		key,
+		msgKey);
+
+	std::array<uchar, 32> sha256Buffer = { { 0 } };
+
+	SHA256_CTX msgKeyLargeContext;
+	SHA256_Init(&msgKeyLargeContext);
+	SHA256_Update(&msgKeyLargeContext, key->partForMsgKey(false), 32);
+	SHA256_Update(&msgKeyLargeContext, encryptedInts, encryptedBytesCount);
+	SHA256_Final(sha256Buffer.data(), &msgKeyLargeContext);
+
+	constexpr auto kMsgKeyShift = 8U;
+	return !memcmp(&msgKey, sha256Buffer.data() + kMsgKeyShift, sizeof(msgKey));
+}
+
+// AES-IGE can't be parallelized inside one packet, but different packets
+// are independent. So when several large packets are waiting we decrypt
+// them all at once and then handle them in the order they were received.
+[[nodiscard]] std::vector<bool> DecryptLargeReceivedPackets(
+		std::deque<mtpBuffer> &received,
+		uint64 keyId,
+		const AuthKeyPtr &key) {
+	auto count = 0;
+	for (const auto &buffer : received) {
+		if (count == kParallelDecryptMaxCount
+			|| buffer.size() * kIntSize < kParallelDecryptMinSize
+			|| !ReceivedPacketLooksGood(buffer, keyId)) {
+			break;
+		}
+		++count;
+	}
+	if (count < 2) {
+		return {};
+	}
+	auto results = std::vector<char>(count, 0);
+	auto semaphore = QSemaphore();
+	for (auto i = 1; i != count; ++i) {
+		auto &buffer = received[i];
+		auto &result = results[i];
+
+		// Detach here, so that no QVector internals are touched async.
+		buffer.data();
+		crl::async([&, key] {
+			result = DecryptReceivedPacket(buffer, key) ? 1 : 0;
+			semaphore.release();
+		});
+	}
+	results[0] = DecryptReceivedPacket(received[0], key) ? 1 : 0;
+	semaphore.acquire(count - 1);
+	return { begin(results), end(results) };
+}
+#endif // !TDESKTOP_MTPROTO_OLD
+
 [[nodiscard]] QString LogIdsVector(const QVector<MTPlong> &ids) {
 	if (!ids.size()) return "[]";
 	auto idsStr = QString("[%1").arg(ids.cbegin()->v);
@@ -122,6 +212,7 @@ SessionPrivate::SessionPrivate(
 , _waitForConnectedTimer(thread, [=] { waitConnectedFailed(); })
 , _waitForReceivedTimer(thread, [=] { waitReceivedFailed(); })
 , _waitForBetterTimer(thread, [=] { waitBetterFailed(); })
+, _delayedTestsTimer(thread, [=] { startDelayedTestConnections(); })
 , _waitForReceived(kMinReceiveTimeout)
 , _waitForConnected(kMinConnectedTimeout)
 , _pingSender(thread, [=] { sendPingByTimer(); })
@@ -149,12 +240,15 @@ void SessionPrivate::appendTestConnection(
 		DcOptions::Variants::Protocol protocol,
 		const QString &ip,
 		int port,
-		const bytes::vector &protocolSecret) {
+		const bytes::vector &protocolSecret,
+		bool preferred) {
 	QWriteLocker lock(&_stateMutex);
 
-	const auto priority = (qthelp::is_ipv6(ip) ? 0 : 1)
-		+ (protocol == DcOptions::Variants::Tcp ? 1 : 0)
-		+ (protocolSecret.empty() ? 0 : 1);
+	const auto priority = preferred
+		? kPreferredEndpointPriority
+		: ((qthelp::is_ipv6(ip) ? 0 : 1)
+			+ (protocol == DcOptions::Variants::Tcp ? 1 : 0)
+			+ (protocolSecret.empty() ? 0 : 1));
 	_testConnections.push_back({
 		AbstractConnection::Create(
 			_instance,
@@ -162,7 +256,11 @@ void SessionPrivate::appendTestConnection(
 			thread(),
 			protocolSecret,
 			_options->proxy),
-		priority
+		priority,
+		ip,
+		port,
+		crl::now(),
+		preferred
 	});
 	const auto weak = _testConnections.back().data.get();
 	connect(weak, &AbstractConnection::error, [=](int errorCode) {
@@ -195,6 +293,73 @@ void SessionPrivate::appendTestConnection(
 	});
 }
 
+void SessionPrivate::startTestConnections(
+		std::vector<TestEndpoint> &&endpoints) {
+	// If some endpoint connected fine last time, try it alone first
+	// and start all the others only if it doesn't connect quickly.
+	const auto dcOptions = _instance->dcOptions();
+	const auto bareDc = BareDcId(_shiftedDcId);
+	auto best = end(endpoints);
+	auto bestConnectTime = crl::time();
+	for (auto i = begin(endpoints); i != end(endpoints); ++i) {
+		const auto stats = dcOptions->endpointStats(
+			bareDc,
+			i->ip.toStdString(),
+			i->port);
+		if (stats
+			&& !stats->failures
+			&& (best == end(endpoints)
+				|| stats->connectTime < bestConnectTime)) {
+			best = i;
+			bestConnectTime = stats->connectTime;
+		}
+	}
+	if (best == end(endpoints) || endpoints.size() == 1) {
+		for (const auto &endpoint : endpoints) {
+			appendTestConnection(
+				endpoint.protocol,
+				endpoint.ip,
+				endpoint.port,
+				endpoint.secret);
+		}
+		return;
+	}
+	DEBUG_LOG(("MTP Info: trying %1:%2 first, connected in %3 ms before."
+		).arg(best->ip
+		).arg(best->port
+		).arg(bestConnectTime));
+	appendTestConnection(
+		best->protocol,
+		best->ip,
+		best->port,
+		best->secret,
+		true);
+	endpoints.erase(best);
+	_delayedTestEndpoints = std::move(endpoints);
+	_delayedTestsTimer.callOnce(kTryOtherEndpointsAfter);
+}
+
+void SessionPrivate::startDelayedTestConnections() {
+	_delayedTestsTimer.cancel();
+	for (const auto &endpoint : base::take(_delayedTestEndpoints)) {
+		appendTestConnection(
+			endpoint.protocol,
+			endpoint.ip,
+			endpoint.port,
+			endpoint.secret);
+	}
+}
+
+void SessionPrivate::testConnectionFailed(const TestConnection &test) {
+	if (test.ip.isEmpty()) {
+		return;
+	}
+	_instance->dcOptions()->endpointFailed(
+		BareDcId(_shiftedDcId),
+		test.ip.toStdString(),
+		test.port);
+}
+
 int16 SessionPrivate::getProtocolDcId() const {
 	const auto dcId = BareDcId(_shiftedDcId);
 	const auto simpleDcId = isTemporaryDcId(dcId)
@@ -272,6 +437,8 @@ void SessionPrivate::destroyAllConnections() {
 	_waitForBetterTimer.cancel();
 	_waitForReceivedTimer.cancel();
 	_waitForConnectedTimer.cancel();
+	_delayedTestsTimer.cancel();
+	_delayedTestEndpoints.clear();
 	_testConnections.clear();
 	_connection = nullptr;
 }
@@ -391,6 +558,22 @@ mtpMsgId SessionPrivate::prepareToSend(
 		SerializedRequest &request,
 		mtpMsgId currentLastId,
 		bool forceNewMsgId) {
+	const auto result = assignMsgId(request, currentLastId, forceNewMsgId);
+	if (TraceEnabled()) {
+		TraceRecord(
+			TraceDirection::Sent,
+			_shiftedDcId,
+			result,
+			mtpTypeId((*request)[SerializedRequest::kMessageBodyPosition]),
+			request.messageSize() * sizeof(mtpPrime));
+	}
+	return result;
+}
+
+mtpMsgId SessionPrivate::assignMsgId(
+		SerializedRequest &request,
+		mtpMsgId currentLastId,
+		bool forceNewMsgId) {
 	Expects(request->size() > 8);
 
 	if (const auto msgId = request.getMsgId()) {
@@ -939,6 +1122,7 @@ void SessionPrivate::connectToServer(bool afterConfig) {
 			: !useHttp
 			? Variants::Http
 			: Variants::ProtocolCount;
+		auto endpoints = std::vector<TestEndpoint>();
 		for (auto address = 0; address != Variants::AddressTypeCount; ++address) {
 			if (address == skipAddress) {
 				continue;
@@ -948,14 +1132,16 @@ void SessionPrivate::connectToServer(bool afterConfig) {
 					continue;
 				}
 				for (const auto &endpoint : variants.data[address][protocol]) {
-					appendTestConnection(
+					endpoints.push_back({
 						static_cast<Variants::Protocol>(protocol),
 						QString::fromStdString(endpoint.ip),
 						endpoint.port,
-						endpoint.secret);
+						endpoint.secret
+					});
 				}
 			}
 		}
+		startTestConnections(std::move(endpoints));
 	}
 	if (_testConnections.empty()) {
 		if (_instance->isKeysDestroyer()) {
@@ -1136,6 +1322,7 @@ void SessionPrivate::waitBetterFailed() {
 
 void SessionPrivate::connectingTimedOut() {
 	for (const auto &connection : _testConnections) {
+		testConnectionFailed(connection);
 		connection.data->timedOut();
 	}
 	doDisconnect();
@@ -1157,16 +1344,20 @@ void SessionPrivate::handleReceived() {
 
 	onReceivedSome();
 
+#ifndef TDESKTOP_MTPROTO_OLD
+	const auto decryptedAhead = DecryptLargeReceivedPackets(
+		_connection->received(),
+		_keyId,
+		_encryptionKey);
+	auto decryptedIndex = size_t(0);
+#endif // !TDESKTOP_MTPROTO_OLD
+
 	while (!_connection->received().empty()) {
 		auto intsBuffer = std::move(_connection->received().front());
 		_connection->received().pop_front();
 
-		constexpr auto kExternalHeaderIntsCount = 6U; // 2 auth_key_id, 4 msg_key
-		constexpr auto kEncryptedHeaderIntsCount = 8U; // 2 salt, 2 session, 2 msg_id, 1 seq_no, 1 length
-		constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
-		constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
 		auto intsCount = uint32(intsBuffer.size());
-		auto ints = intsBuffer.constData();
+		auto ints = intsBuffer.data();
 		if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
 			LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
 			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
@@ -1183,16 +1374,20 @@ void SessionPrivate::handleReceived() {
 		auto encryptedInts = ints + kExternalHeaderIntsCount;
 		auto encryptedIntsCount = (intsCount - kExternalHeaderIntsCount) & ~0x03U;
 		auto encryptedBytesCount = encryptedIntsCount * kIntSize;
-		auto decryptedBuffer = QByteArray(encryptedBytesCount, Qt::Uninitialized);
-		auto msgKey = *(MTPint128*)(ints + 2);
 
+		// Decrypt in place, the received buffer is owned only by us here
+		// and all the parsed responses will be slices of it afterwards.
 #ifdef TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt_oldmtp(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, _encryptionKey, msgKey);
+		auto msgKey = *(MTPint128*)(ints + 2);
+		aesIgeDecrypt_oldmtp(encryptedInts, encryptedInts, encryptedBytesCount, _encryptionKey, msgKey);
 #else // TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, _encryptionKey, msgKey);
+		const auto msgKeyGood = (decryptedIndex < decryptedAhead.size())
+			? decryptedAhead[decryptedIndex]
+			: DecryptReceivedPacket(intsBuffer, _encryptionKey);
+		++decryptedIndex;
 #endif // TDESKTOP_MTPROTO_OLD
 
-		auto decryptedInts = reinterpret_cast<const mtpPrime*>(decryptedBuffer.constData());
+		const auto decryptedInts = static_cast<const mtpPrime*>(encryptedInts);
 		auto serverSalt = *(uint64*)&decryptedInts[0];
 		auto session = *(uint64*)&decryptedInts[2];
 		auto msgId = *(uint64*)&decryptedInts[4];
@@ -1223,7 +1418,7 @@ void SessionPrivate::handleReceived() {
 		constexpr auto kMsgKeyShift_oldmtp = 4U;
 		if (memcmp(&msgKey, sha1ForMsgKeyCheck.data() + kMsgKeyShift_oldmtp, sizeof(msgKey)) != 0) {
 			LOG(("TCP Error: bad SHA1 hash after aesDecrypt in message."));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+			TCP_LOG(("TCP Error: bad decrypted message %1").arg(Logs::mb(decryptedInts, encryptedBytesCount).str()));
 
 			return restart();
 		}
@@ -1232,18 +1427,9 @@ void SessionPrivate::handleReceived() {
 		constexpr auto kMaxPaddingSize = 1024U;
 		auto badMessageLength = (paddingSize < kMinPaddingSize || paddingSize > kMaxPaddingSize);
 
-		std::array<uchar, 32> sha256Buffer = { { 0 } };
-
-		SHA256_CTX msgKeyLargeContext;
-		SHA256_Init(&msgKeyLargeContext);
-		SHA256_Update(&msgKeyLargeContext, _encryptionKey->partForMsgKey(false), 32);
-		SHA256_Update(&msgKeyLargeContext, decryptedInts, encryptedBytesCount);
-		SHA256_Final(sha256Buffer.data(), &msgKeyLargeContext);
-
-		constexpr auto kMsgKeyShift = 8U;
-		if (memcmp(&msgKey, sha256Buffer.data() + kMsgKeyShift, sizeof(msgKey)) != 0) {
+		if (!msgKeyGood) {
 			LOG(("TCP Error: bad SHA256 hash after aesDecrypt in message"));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+			TCP_LOG(("TCP Error: bad decrypted message %1").arg(Logs::mb(decryptedInts, encryptedBytesCount).str()));
 
 			return restart();
 		}
@@ -1251,7 +1437,7 @@ void SessionPrivate::handleReceived() {
 
 		if (badMessageLength || (messageLength & 0x03)) {
 			LOG(("TCP Error: bad msg_len received %1, data size: %2").arg(messageLength).arg(encryptedBytesCount));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+			TCP_LOG(("TCP Error: bad decrypted message %1").arg(Logs::mb(decryptedInts, encryptedBytesCount).str()));
 
 			return restart();
 		}
@@ -1309,7 +1495,14 @@ void SessionPrivate::handleReceived() {
 			).arg(_encryptionKey->keyId()));
 
 		if (_receivedMessageIds.registerMsgId(msgId, needAck)) {
-			res = handleOneReceived(from, end, msgId, serverTime, serverSalt, badTime);
+			res = handleOneReceived(
+				intsBuffer,
+				from,
+				end,
+				msgId,
+				serverTime,
+				serverSalt,
+				badTime);
 		}
 		_receivedMessageIds.shrink();
 
@@ -1353,6 +1546,7 @@ void SessionPrivate::handleReceived() {
 }
 
 SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
+		const mtpBuffer &owner,
 		const mtpPrime *from,
 		const mtpPrime *end,
 		uint64 msgId,
@@ -1361,15 +1555,31 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		bool badTime) {
 	Expects(from < end);
 
+	if (TraceEnabled()) {
+		TraceRecord(
+			TraceDirection::Received,
+			_shiftedDcId,
+			msgId,
+			mtpTypeId(*from),
+			uint32((end - from) * sizeof(mtpPrime)));
+	}
+
 	switch (mtpTypeId(*from)) {
 
 	case mtpc_gzip_packed: {
 		DEBUG_LOG(("Message Info: gzip container"));
-		mtpBuffer response = ungzip(++from, end);
+		mtpBuffer response = _gzipUnpacker.unpack(++from, end);
 		if (response.empty()) {
 			return HandleResult::RestartConnection;
 		}
-		return handleOneReceived(response.data(), response.data() + response.size(), msgId, serverTime, serverSalt, badTime);
+		return handleOneReceived(
+			response,
+			response.constData(),
+			response.constData() + response.size(),
+			msgId,
+			serverTime,
+			serverSalt,
+			badTime);
 	}
 
 	case mtpc_msg_container: {
@@ -1421,7 +1631,14 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 
 			auto res = HandleResult::Success; // if no need to handle, then succeed
 			if (_receivedMessageIds.registerMsgId(inMsgId.v, needAck)) {
-				res = handleOneReceived(from, otherEnd, inMsgId.v, serverTime, serverSalt, badTime);
+				res = handleOneReceived(
+					owner,
+					from,
+					otherEnd,
+					inMsgId.v,
+					serverTime,
+					serverSalt,
+					badTime);
 				badTime = false;
 			}
 			if (res != HandleResult::Success) {
@@ -1531,7 +1748,9 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 
 				// Save rpc_error for processing in the main thread.
 				QWriteLocker locker(_sessionData->haveReceivedMutex());
-				_sessionData->haveReceivedResponses().emplace(requestId, response);
+				_sessionData->haveReceivedResponses().emplace(
+					requestId,
+					ReceivedSlice(std::move(response)));
 			} else {
 				DEBUG_LOG(("Message Error: "
 					"such message was not sent recently %1").arg(badMsgId));
@@ -1557,7 +1776,7 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		}
 
 		_sessionSalt = data.vnew_server_salt().v;
-		base::unixtime::update(serverTime);
+		base::unixtime::update(serverTime, true);
 
 		if (setState(ConnectedState, ConnectingState)) {
 			resendAll();
@@ -1693,7 +1912,7 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		if (from + 3 > end) {
 			return HandleResult::ParseError;
 		}
-		auto response = mtpBuffer();
+		auto response = ReceivedSlice();
 
 		MTPlong reqMsgId;
 		if (!reqMsgId.read(++from, end)) {
@@ -1716,17 +1935,17 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		mtpTypeId typeId = from[0];
 		if (typeId == mtpc_gzip_packed) {
 			DEBUG_LOG(("RPC Info: gzip container"));
-			response = ungzip(++from, end);
-			if (response.empty()) {
+			auto unpacked = _gzipUnpacker.unpack(++from, end);
+			if (unpacked.empty()) {
 				return HandleResult::RestartConnection;
 			}
+			response = ReceivedSlice(std::move(unpacked));
 			typeId = response[0];
 		} else {
-			response.resize(end - from);
-			memcpy(response.data(), from, (end - from) * sizeof(mtpPrime));
+			response = ReceivedSlice(owner, from, end);
 		}
 		if (typeId == mtpc_rpc_error) {
-			if (IsDestroyedTemporaryKeyError(response)) {
+			if (IsDestroyedTemporaryKeyError(response.from(), response.till())) {
 				return HandleResult::DestroyTemporaryKey;
 			}
 			// An error could be some RPC_CALL_FAIL or other error inside
@@ -1745,7 +1964,9 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		if (requestId && requestId != mtpRequestId(0xFFFFFFFF)) {
 			// Save rpc_result for processing in the main thread.
 			QWriteLocker locker(_sessionData->haveReceivedMutex());
-			_sessionData->haveReceivedResponses().emplace(requestId, response);
+			_sessionData->haveReceivedResponses().emplace(
+				requestId,
+				std::move(response));
 		} else {
 			DEBUG_LOG(("RPC Info: requestId not found for msgId %1").arg(requestMsgId));
 		}
@@ -1789,12 +2010,9 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 			resend(msgId, 10, true);
 		}
 
-		mtpBuffer update(from - start);
-		if (from > start) memcpy(update.data(), start, (from - start) * sizeof(mtpPrime));
-
 		// Notify main process about new session - need to get difference.
 		QWriteLocker locker(_sessionData->haveReceivedMutex());
-		_sessionData->haveReceivedUpdates().push_back(mtpBuffer(update));
+		_sessionData->haveReceivedUpdates().emplace_back(owner, start, from);
 	} return HandleResult::Success;
 
 	case mtpc_pong: {
@@ -1834,14 +2052,9 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 	}
 
 	if (_currentDcType == DcType::Regular) {
-		mtpBuffer update(end - from);
-		if (end > from) {
-			memcpy(update.data(), from, (end - from) * sizeof(mtpPrime));
-		}
-
 		// Notify main process about the new updates.
 		QWriteLocker locker(_sessionData->haveReceivedMutex());
-		_sessionData->haveReceivedUpdates().push_back(mtpBuffer(update));
+		_sessionData->haveReceivedUpdates().emplace_back(owner, from, end);
 	} else {
 		LOG(("Message Error: unexpected updates in dcType: %1"
 			).arg(static_cast<int>(_currentDcType)));
@@ -1852,13 +2065,15 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 
 SessionPrivate::HandleResult SessionPrivate::handleBindResponse(
 		mtpMsgId requestMsgId,
-		const mtpBuffer &response) {
+		const ReceivedSlice &response) {
 	if (!_keyCreator || !_bindMsgId || _bindMsgId != requestMsgId) {
 		return HandleResult::Ignored;
 	}
 	_bindMsgId = 0;
 
-	const auto result = _keyCreator->handleBindResponse(response);
+	const auto result = _keyCreator->handleBindResponse(
+		response.from(),
+		response.till());
 	switch (result) {
 	case DcKeyBindState::Success:
 		if (!_sessionData->releaseKeyCreationOnDone(
@@ -1880,58 +2095,6 @@ SessionPrivate::HandleResult SessionPrivate::handleBindResponse(
 	Unexpected("Result of BoundKeyCreator::handleBindResponse.");
 }
 
-mtpBuffer SessionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) const {
-	mtpBuffer result; // * 4 because of mtpPrime type
-	result.resize(0);
-
-	MTPstring packed;
-	if (!packed.read(from, end)) { // read packed string as serialized mtp string type
-		LOG(("RPC Error: could not read gziped bytes."));
-		return result;
-	}
-	uint32 packedLen = packed.v.size(), unpackedChunk = packedLen, unpackedLen = 0;
-
-	z_stream stream;
-	stream.zalloc = 0;
-	stream.zfree = 0;
-	stream.opaque = 0;
-	stream.avail_in = 0;
-	stream.next_in = 0;
-	int res = inflateInit2(&stream, 16 + MAX_WBITS);
-	if (res != Z_OK) {
-		LOG(("RPC Error: could not init zlib stream, code: %1").arg(res));
-		return result;
-	}
-	stream.avail_in = packedLen;
-	stream.next_in = reinterpret_cast<Bytef*>(packed.v.data());
-
-	stream.avail_out = 0;
-	while (!stream.avail_out) {
-		result.resize(result.size() + unpackedChunk);
-		stream.avail_out = unpackedChunk * sizeof(mtpPrime);
-		stream.next_out = (Bytef*)&result[result.size() - unpackedChunk];
-		int res = inflate(&stream, Z_NO_FLUSH);
-		if (res != Z_OK && res != Z_STREAM_END) {
-			inflateEnd(&stream);
-			LOG(("RPC Error: could not unpack gziped data, code: %1").arg(res));
-			DEBUG_LOG(("RPC Error: bad gzip: %1").arg(Logs::mb(packed.v.constData(), packedLen).str()));
-			return mtpBuffer();
-		}
-	}
-	if (stream.avail_out & 0x03) {
-		uint32 badSize = result.size() * sizeof(mtpPrime) - stream.avail_out;
-		LOG(("RPC Error: bad length of unpacked data %1").arg(badSize));
-		DEBUG_LOG(("RPC Error: bad unpacked data %1").arg(Logs::mb(result.data(), badSize).str()));
-		return mtpBuffer();
-	}
-	result.resize(result.size() - (stream.avail_out >> 2));
-	inflateEnd(&stream);
-	if (!result.size()) {
-		LOG(("RPC Error: bad length of unpacked data 0"));
-	}
-	return result;
-}
-
 bool SessionPrivate::requestsFixTimeSalt(const QVector<MTPlong> &ids, int32 serverTime, uint64 serverSalt) {
 	uint32 idsCount = ids.size();
 
@@ -1980,6 +2143,10 @@ void SessionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byResponse)
 					DEBUG_LOG(("Message Info: ignoring ACK for msgId %1 because request %2 requires a response").arg(msgId).arg(requestId));
 					continue;
 				}
+				if (byResponse && i->second->lastSentTime) {
+					_sessionData->updateRoundTripTime(
+						crl::now() - i->second->lastSentTime);
+				}
 				haveSent.erase(i);
 
 				_ackedIds.emplace(msgId, requestId);
@@ -2160,6 +2327,13 @@ void SessionPrivate::onConnected(
 		connection.get(),
 		[](const TestConnection &test) { return test.data.get(); });
 	Assert(i != end(_testConnections));
+	if (!i->ip.isEmpty()) {
+		_instance->dcOptions()->endpointConnected(
+			BareDcId(_shiftedDcId),
+			i->ip.toStdString(),
+			i->port,
+			crl::now() - i->startedAt);
+	}
 	const auto my = i->priority;
 	const auto j = ranges::find_if(
 		_testConnections,
@@ -2171,6 +2345,8 @@ void SessionPrivate::onConnected(
 	} else {
 		DEBUG_LOG(("MTP Info: connection through IPv4 succeed."));
 		_waitForBetterTimer.cancel();
+		_delayedTestsTimer.cancel();
+		_delayedTestEndpoints.clear();
 		_connection = std::move(i->data);
 		_testConnections.clear();
 		checkAuthKey();
@@ -2207,6 +2383,9 @@ void SessionPrivate::confirmBestConnection() {
 	DEBUG_LOG(("MTP Info: can't connect through better, using %1."
 		).arg(i->data->tag()));
 
+	_delayedTestsTimer.cancel();
+	_delayedTestEndpoints.clear();
+
 	_connection = std::move(i->data);
 	_testConnections.clear();
 
@@ -2215,12 +2394,21 @@ void SessionPrivate::confirmBestConnection() {
 
 void SessionPrivate::removeTestConnection(
 		not_null<AbstractConnection*> connection) {
-	_testConnections.erase(
-		ranges::remove(
-			_testConnections,
-			connection.get(),
-			[](const TestConnection &test) { return test.data.get(); }),
-		end(_testConnections));
+	const auto i = ranges::find(
+		_testConnections,
+		connection.get(),
+		[](const TestConnection &test) { return test.data.get(); });
+	if (i == end(_testConnections)) {
+		return;
+	}
+	const auto preferred = i->preferred;
+	if (!i->data->isConnected()) {
+		testConnectionFailed(*i);
+	}
+	_testConnections.erase(i);
+	if (preferred) {
+		startDelayedTestConnections();
+	}
 }
 
 void SessionPrivate::checkAuthKey() {
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "mtproto/details/mtproto_gzip_unpacker.h"
 #include "mtproto/details/mtproto_received_ids_manager.h"
 #include "mtproto/details/mtproto_serialized_request.h"
 #include "mtproto/mtproto_auth_key.h"
@@ -54,9 +55,19 @@ public:
 private:
 	static constexpr auto kUpdateStateAlways = 666;
 
+	struct TestEndpoint {
+		DcOptions::Variants::Protocol protocol = {};
+		QString ip;
+		int port = 0;
+		bytes::vector secret;
+	};
 	struct TestConnection {
 		ConnectionPointer data;
 		int priority = 0;
+		QString ip;
+		int port = 0;
+		crl::time startedAt = 0;
+		bool preferred = false;
 	};
 	struct SentContainer {
 		crl::time sent = 0;
@@ -111,6 +122,10 @@ private:
 		SerializedRequest &request,
 		mtpMsgId currentLastId,
 		bool forceNewMsgId);
+	mtpMsgId assignMsgId(
+		SerializedRequest &request,
+		mtpMsgId currentLastId,
+		bool forceNewMsgId);
 	mtpMsgId replaceMsgId(
 		SerializedRequest &request,
 		mtpMsgId newId);
@@ -120,11 +135,19 @@ private:
 		bool needAnyResponse);
 	mtpRequestId wasSent(mtpMsgId msgId) const;
 
-	[[nodiscard]] HandleResult handleOneReceived(const mtpPrime *from, const mtpPrime *end, uint64 msgId, int32 serverTime, uint64 serverSalt, bool badTime);
+	// [from, end) must lie inside the owner buffer, so that the contained
+	// responses and updates can be passed on as slices of it.
+	[[nodiscard]] HandleResult handleOneReceived(
+		const mtpBuffer &owner,
+		const mtpPrime *from,
+		const mtpPrime *end,
+		uint64 msgId,
+		int32 serverTime,
+		uint64 serverSalt,
+		bool badTime);
 	[[nodiscard]] HandleResult handleBindResponse(
 		mtpMsgId requestMsgId,
-		const mtpBuffer &response);
-	mtpBuffer ungzip(const mtpPrime *from, const mtpPrime *end) const;
+		const ReceivedSlice &response);
 	void handleMsgsStates(const QVector<MTPlong> &ids, const QByteArray &states);
 
 	// _sessionDataMutex must be locked for read.
@@ -134,7 +157,11 @@ private:
 		DcOptions::Variants::Protocol protocol,
 		const QString &ip,
 		int port,
-		const bytes::vector &protocolSecret);
+		const bytes::vector &protocolSecret,
+		bool preferred = false);
+	void startTestConnections(std::vector<TestEndpoint> &&endpoints);
+	void startDelayedTestConnections();
+	void testConnectionFailed(const TestConnection &test);
 
 	// if badTime received - search for ids in sessionData->haveSent and sessionData->wereAcked and sync time/salt, return true if found
 	bool requestsFixTimeSalt(const QVector<MTPlong> &ids, int32 serverTime, uint64 serverSalt);
@@ -179,6 +206,7 @@ private:
 
 	ConnectionPointer _connection;
 	std::vector<TestConnection> _testConnections;
+	std::vector<TestEndpoint> _delayedTestEndpoints;
 	crl::time _startedConnectingAt = 0;
 
 	base::Timer _retryTimer; // exp retry timer
@@ -191,6 +219,7 @@ private:
 	base::Timer _waitForConnectedTimer;
 	base::Timer _waitForReceivedTimer;
 	base::Timer _waitForBetterTimer;
+	base::Timer _delayedTestsTimer;
 	crl::time _waitForReceived = 0;
 	crl::time _waitForConnected = 0;
 	crl::time _firstSentAt = -1;
@@ -215,6 +244,7 @@ private:
 	QVector<MTPlong> _resendRequestData;
 	base::flat_set<mtpMsgId> _stateRequestData;
 	ReceivedIdsManager _receivedMessageIds;
+	GzipUnpacker _gzipUnpacker;
 	base::flat_map<mtpMsgId, mtpRequestId> _resendingIds;
 	base::flat_map<mtpMsgId, mtpRequestId> _ackedIds;
 	base::flat_map<mtpMsgId, SerializedRequest> _stateAndResendRequests;
@@ -18,17 +18,63 @@ NeverFreedPointer<SmallUpdatesList> SmallUpdates;
 using AllUpdatesList = QMap<PeerData*, PeerUpdate>;
 NeverFreedPointer<AllUpdatesList> AllUpdates;
 
+// Viewers of a single peer subscribe here, so that an update of one peer
+// doesn't run the filters of every widget that watches some other peer.
+struct PeerStream {
+	rpl::event_stream<PeerUpdate> updates;
+	int subscribers = 0;
+	bool firing = false;
+};
+using PeerStreamsMap = std::map<not_null<PeerData*>, PeerStream>;
+NeverFreedPointer<PeerStreamsMap> PeerStreams;
+
 void StartCallback() {
 	SmallUpdates.createIfNull();
 	AllUpdates.createIfNull();
+	PeerStreams.createIfNull();
 }
 void FinishCallback() {
 	SmallUpdates.clear();
 	AllUpdates.clear();
+	PeerStreams.clear();
 }
 
 base::Observable<PeerUpdate, PeerUpdatedHandler> PeerUpdatedObservable;
 
+void SendToPeerStream(const PeerUpdate &update) {
+	if (!PeerStreams || !update.peer) {
+		return;
+	}
+	const auto i = PeerStreams->find(update.peer);
+	if (i == end(*PeerStreams)) {
+		return;
+	}
+
+	// The last subscriber may go away while we fire, the entry is
+	// erased after that so that the stream is not destroyed in place.
+	auto &stream = i->second;
+	const auto firing = std::exchange(stream.firing, true);
+	stream.updates.fire_copy(update);
+	stream.firing = firing;
+	if (!firing && !stream.subscribers) {
+		PeerStreams->erase(i);
+	}
+}
+
+void RemovePeerStreamSubscriber(not_null<PeerData*> peer) {
+	if (!PeerStreams) {
+		return;
+	}
+	const auto i = PeerStreams->find(peer);
+	if (i == end(*PeerStreams)) {
+		return;
+	}
+	auto &stream = i->second;
+	if (!--stream.subscribers && !stream.firing) {
+		PeerStreams->erase(i);
+	}
+}
+
 } // namespace
 
 void mergePeerUpdate(PeerUpdate &mergeTo, const PeerUpdate &mergeFrom) {
@@ -76,11 +122,11 @@ void peerUpdatedSendDelayed() {
 
 	auto smallList = base::take(*SmallUpdates);
 	auto allList = base::take(*AllUpdates);
-	for (auto &update : smallList) {
-		PeerUpdated().notify(std::move(update), true);
+	for (const auto &update : smallList) {
+		peerUpdatedSend(update);
 	}
-	for (auto &update : allList) {
-		PeerUpdated().notify(std::move(update), true);
+	for (const auto &update : allList) {
+		peerUpdatedSend(update);
 	}
 
 	if (SmallUpdates->isEmpty()) {
@@ -89,6 +135,11 @@ void peerUpdatedSendDelayed() {
 	}
 }
 
+void peerUpdatedSend(const PeerUpdate &update) {
+	SendToPeerStream(update);
+	PeerUpdated().notify(update, true);
+}
+
 base::Observable<PeerUpdate, PeerUpdatedHandler> &PeerUpdated() {
 	return PeerUpdatedObservable;
 }
@@ -109,11 +160,23 @@ rpl::producer<PeerUpdate> PeerUpdateViewer(
 rpl::producer<PeerUpdate> PeerUpdateViewer(
 		not_null<PeerData*> peer,
 		PeerUpdate::Flags flags) {
-	return PeerUpdateViewer(
-		flags
-	) | rpl::filter([=](const PeerUpdate &update) {
-		return (update.peer == peer);
-	});
+	return [=](const auto &consumer) {
+		PeerStreams.createIfNull();
+		auto &stream = (*PeerStreams)[peer];
+		++stream.subscribers;
+
+		auto lifetime = rpl::lifetime();
+		stream.updates.events(
+		) | rpl::filter([=](const PeerUpdate &update) -> bool {
+			return (update.flags & flags);
+		}) | rpl::start_with_next([=](const PeerUpdate &update) {
+			consumer.put_next_copy(update);
+		}, lifetime);
+		lifetime.add([=] {
+			RemovePeerStreamSubscriber(peer);
+		});
+		return lifetime;
+	};
 }
 
 rpl::producer<PeerUpdate> PeerUpdateValue(
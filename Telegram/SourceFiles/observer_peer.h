@@ -88,6 +88,10 @@ inline void peerUpdatedDelayed(PeerData *peer, PeerUpdate::Flags events) {
 }
 void peerUpdatedSendDelayed();
 
+// Sends the update right away, both to PeerUpdated() and to the viewers
+// of this single peer. All immediate peer updates must go through here.
+void peerUpdatedSend(const PeerUpdate &update);
+
 class PeerUpdatedHandler {
 public:
 	template <typename Lambda>
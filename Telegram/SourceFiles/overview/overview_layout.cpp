@@ -324,7 +324,14 @@ void Photo::paint(Painter &p, const QRect &clip, TextSelection selection, const
 		_data->thumbnail()->automaticLoad(parent()->fullId(), parent());
 		good = _data->thumbnail()->loaded();
 	}
-	if ((good && !_goodLoaded) || _pix.width() != _width * cIntRetinaFactor()) {
+	const auto wrongSize = (_pix.width() != _width * cIntRetinaFactor());
+	if (good
+		&& (!_goodLoaded || wrongSize)
+		&& context
+		&& !context->takeThumbnailBudget()) {
+		good = false;
+	}
+	if ((good && !_goodLoaded) || wrongSize) {
 		_goodLoaded = good;
 		_pix = QPixmap();
 		if (_goodLoaded) {
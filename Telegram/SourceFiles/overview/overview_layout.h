@@ -32,6 +32,21 @@ public:
 	}
 	bool isAfterDate = false;
 
+	// How many full quality thumbnails may be prepared in this paint,
+	// negative means no limit. The rest are drawn from the blurred
+	// inline thumbnail and thumbnailsDelayed is set.
+	[[nodiscard]] bool takeThumbnailBudget() const {
+		if (!thumbnailsBudget) {
+			thumbnailsDelayed = true;
+			return false;
+		} else if (thumbnailsBudget > 0) {
+			--thumbnailsBudget;
+		}
+		return true;
+	}
+	mutable int thumbnailsBudget = -1;
+	mutable bool thumbnailsDelayed = false;
+
 };
 
 class ItemBase;
@@ -1384,10 +1384,13 @@ void FormController::uploadScan(
 		return std::nullopt;
 	}();
 	auto &scan = nonconst->fileInEdit(type, fileIndex);
-	encryptFile(scan, std::move(content), [=](UploadScanData &&result) {
-		uploadEncryptedFile(
-			nonconst->fileInEdit(type, fileIndex),
-			std::move(result));
+	encryptFile(scan, std::move(content), [=](
+			UploadScanData &&result,
+			QImage &&image) {
+		auto &file = nonconst->fileInEdit(type, fileIndex);
+		file.fields.image = std::move(image);
+		_scanUpdated.fire(&file);
+		uploadEncryptedFile(file, std::move(result));
 	});
 }
 
@@ -1405,16 +1408,13 @@ void FormController::restoreScan(
 	scanDeleteRestore(value, type, fileIndex, false);
 }
 
-void FormController::prepareFile(
-		EditFile &file,
-		const QByteArray &content) {
+void FormController::prepareFile(EditFile &file, int size) {
 	const auto fileId = rand_value<uint64>();
-	file.fields.size = content.size();
+	file.fields.size = size;
 	file.fields.id = fileId;
 	file.fields.dcId = MTP::maindc();
 	file.fields.secret = GenerateSecretBytes();
 	file.fields.date = base::unixtime::now();
-	file.fields.image = ReadImage(bytes::make_span(content));
 	file.fields.downloadOffset = file.fields.size;
 
 	_scanUpdated.fire(&file);
@@ -1423,8 +1423,8 @@ void FormController::prepareFile(
 void FormController::encryptFile(
 		EditFile &file,
 		QByteArray &&content,
-		Fn<void(UploadScanData &&result)> callback) {
-	prepareFile(file, content);
+		Fn<void(UploadScanData &&result, QImage &&image)> callback) {
+	prepareFile(file, content.size());
 
 	const auto weak = std::weak_ptr<bool>(file.guard);
 	crl::async([
@@ -1445,9 +1445,16 @@ void FormController::encryptFile(
 			result.bytes.data(),
 			result.bytes.size(),
 			result.md5checksum.data());
-		crl::on_main([=, encrypted = std::move(result)]() mutable {
+
+		// The scan preview is a full sized image, decode it here as well.
+		auto image = ReadImage(bytes::make_span(bytes));
+		crl::on_main([
+			=,
+			encrypted = std::move(result),
+			image = std::move(image)
+		]() mutable {
 			if (weak.lock()) {
-				callback(std::move(encrypted));
+				callback(std::move(encrypted), std::move(image));
 			}
 		});
 	});
@@ -464,10 +464,8 @@ private:
 	void encryptFile(
 		EditFile &file,
 		QByteArray &&content,
-		Fn<void(UploadScanData &&result)> callback);
-	void prepareFile(
-		EditFile &file,
-		const QByteArray &content);
+		Fn<void(UploadScanData &&result, QImage &&image)> callback);
+	void prepareFile(EditFile &file, int size);
 	void uploadEncryptedFile(
 		EditFile &file,
 		UploadScanData &&data);
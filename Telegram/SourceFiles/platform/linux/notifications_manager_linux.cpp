@@ -17,6 +17,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtCore/QVersionNumber>
 #include <QtDBus/QDBusMessage>
 #include <QtDBus/QDBusReply>
+#include <QtDBus/QDBusPendingCallWatcher>
+#include <QtDBus/QDBusPendingReply>
 #include <QtDBus/QDBusError>
 #include <QtDBus/QDBusMetaType>
 #endif // !TDESKTOP_DISABLE_DBUS_INTEGRATION
@@ -43,6 +45,8 @@ constexpr auto kInterface = kService;
 constexpr auto kPropertiesInterface = "org.freedesktop.DBus.Properties"_cs;
 
 bool InhibitedNotSupported = false;
+std::optional<bool> InhibitedValue;
+bool InhibitedRefreshing = false;
 
 std::vector<QString> ComputeServerInformation() {
 	std::vector<QString> serverInformation;
@@ -100,7 +104,7 @@ QStringList GetCapabilities() {
 	return Capabilities;
 }
 
-bool Inhibited() {
+QDBusMessage InhibitedMessage() {
 	auto message = QDBusMessage::createMethodCall(
 		kService.utf16(),
 		kObjectPath.utf16(),
@@ -112,9 +116,10 @@ bool Inhibited() {
 		qsl("Inhibited")
 	});
 
-	const QDBusReply<QVariant> reply = QDBusConnection::sessionBus().call(
-		message);
+	return message;
+}
 
+bool ParseInhibited(const QDBusReply<QVariant> &reply) {
 	const auto notSupportedErrors = {
 		QDBusError::ServiceUnknown,
 		QDBusError::InvalidArgs,
@@ -135,6 +140,40 @@ bool Inhibited() {
 	return false;
 }
 
+// This is checked for each notification, so only the first check waits
+// for the daemon, after that the last known value is returned while the
+// next one is requested asynchronously.
+bool Inhibited() {
+	if (!InhibitedValue) {
+		InhibitedValue = ParseInhibited(
+			QDBusConnection::sessionBus().call(InhibitedMessage()));
+	} else if (!InhibitedRefreshing) {
+		InhibitedRefreshing = true;
+		const auto watcher = new QDBusPendingCallWatcher(
+			QDBusConnection::sessionBus().asyncCall(InhibitedMessage()));
+		QObject::connect(watcher, &QDBusPendingCallWatcher::finished, [=] {
+			watcher->deleteLater();
+			InhibitedValue = ParseInhibited(QDBusReply<QVariant>(*watcher));
+			InhibitedRefreshing = false;
+		});
+	}
+	return *InhibitedValue;
+}
+
+void SendCloseNotification(QDBusConnection connection, uint id) {
+	auto message = QDBusMessage::createMethodCall(
+		kService.utf16(),
+		kObjectPath.utf16(),
+		kInterface.utf16(),
+		qsl("CloseNotification"));
+
+	message.setArguments({
+		id
+	});
+
+	connection.send(message);
+}
+
 QVersionNumber ParseSpecificationVersion(
 		const std::vector<QString> &serverInformation) {
 	if (serverInformation.size() >= 4) {
@@ -180,6 +219,7 @@ NotificationData::NotificationData(
 		MsgId msgId,
 		bool hideReplyButton)
 : _dbusConnection(QDBusConnection::sessionBus())
+, _shown(std::make_shared<Shown>())
 , _manager(manager)
 , _title(title)
 , _imageKey(GetImageKey(ParseSpecificationVersion(
@@ -265,7 +305,7 @@ NotificationData::NotificationData(
 		SLOT(notificationClosed(uint)));
 }
 
-bool NotificationData::show() {
+void NotificationData::show() {
 	const auto iconName = _imageKey.isEmpty() || !_hints.contains(_imageKey)
 		? GetIconName()
 		: QString();
@@ -287,30 +327,40 @@ bool NotificationData::show() {
 		-1
 	});
 
-	const QDBusReply<uint> reply = _dbusConnection.call(
-		message);
-
-	if (reply.isValid()) {
-		_notificationId = reply.value();
-	} else {
-		LOG(("Native notification error: %1").arg(reply.error().message()));
-	}
-
-	return reply.isValid();
+	// The reply may come after this notification was closed and destroyed,
+	// so everything the handler needs is captured by value.
+	const auto watcher = new QDBusPendingCallWatcher(
+		_dbusConnection.asyncCall(message));
+	const auto connection = _dbusConnection;
+	const auto shown = _shown;
+	const auto manager = _manager;
+	const auto peerId = _peerId;
+	const auto msgId = _msgId;
+	QObject::connect(watcher, &QDBusPendingCallWatcher::finished, [=] {
+		watcher->deleteLater();
+
+		const QDBusPendingReply<uint> reply = *watcher;
+		if (reply.isError()) {
+			LOG(("Native notification error: %1"
+				).arg(reply.error().message()));
+			crl::on_main(manager, [=] {
+				manager->clearNotification(peerId, msgId);
+			});
+			return;
+		}
+		shown->id = reply.value();
+		if (shown->closeRequested) {
+			SendCloseNotification(connection, shown->id);
+		}
+	});
 }
 
 void NotificationData::close() {
-	auto message = QDBusMessage::createMethodCall(
-		kService.utf16(),
-		kObjectPath.utf16(),
-		kInterface.utf16(),
-		qsl("CloseNotification"));
-
-	message.setArguments({
-		_notificationId
-	});
-
-	_dbusConnection.send(message);
+	if (!_shown->id) {
+		_shown->closeRequested = true;
+		return;
+	}
+	SendCloseNotification(_dbusConnection, _shown->id);
 }
 
 void NotificationData::setImage(const QString &imagePath) {
@@ -343,7 +393,7 @@ void NotificationData::setImage(const QString &imagePath) {
 }
 
 void NotificationData::notificationClosed(uint id) {
-	if (id == _notificationId) {
+	if (id == _shown->id) {
 		const auto manager = _manager;
 		crl::on_main(manager, [=] {
 			manager->clearNotification(_peerId, _msgId);
@@ -352,7 +402,7 @@ void NotificationData::notificationClosed(uint id) {
 }
 
 void NotificationData::actionInvoked(uint id, const QString &actionName) {
-	if (id != _notificationId) {
+	if (id != _shown->id) {
 		return;
 	}
 
@@ -371,7 +421,7 @@ void NotificationData::actionInvoked(uint id, const QString &actionName) {
 }
 
 void NotificationData::notificationReplied(uint id, const QString &text) {
-	if (id == _notificationId) {
+	if (id == _shown->id) {
 		const auto manager = _manager;
 		crl::on_main(manager, [=] {
 			manager->notificationReplied(_peerId, _msgId, { text, {} });
@@ -520,13 +570,7 @@ void Manager::Private::showNotification(
 		i = _notifications.insert(peer->id, QMap<MsgId, Notification>());
 	}
 	_notifications[peer->id].insert(msgId, notification);
-	if (!notification->show()) {
-		i = _notifications.find(peer->id);
-		if (i != _notifications.cend()) {
-			i->remove(msgId);
-			if (i->isEmpty()) _notifications.erase(i);
-		}
-	}
+	notification->show();
 }
 
 void Manager::Private::clearAll() {
@@ -38,7 +38,7 @@ public:
 	NotificationData(NotificationData &&other) = delete;
 	NotificationData &operator=(NotificationData &&other) = delete;
 
-	bool show();
+	void show();
 	void close();
 	void setImage(const QString &imagePath);
 
@@ -50,7 +50,14 @@ public:
 	};
 
 private:
+	// The id is known when the asynchronous Notify call is finished.
+	struct Shown {
+		uint id = 0;
+		bool closeRequested = false;
+	};
+
 	QDBusConnection _dbusConnection;
+	const std::shared_ptr<Shown> _shown;
 	base::weak_ptr<Manager> _manager;
 
 	QString _title;
@@ -59,7 +66,6 @@ private:
 	QVariantMap _hints;
 	QString _imageKey;
 
-	uint _notificationId;
 	PeerId _peerId;
 	MsgId _msgId;
 
@@ -302,6 +302,7 @@ bool AddCustomReplace(QString from, QString to) {
 
 bool gConfirmBeforeCall = false;
 bool gNoTaskbarFlashing = false;
+bool gStreamedVoiceUpload = false;
 
 rpl::variable<int> gRecentStickersLimit = 20;
 void SetRecentStickersLimit(int limit) {
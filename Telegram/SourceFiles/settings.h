@@ -241,6 +241,7 @@ DeclareRefSetting(CustomReplacementsMap, CustomReplaces);
 bool AddCustomReplace(QString from, QString to);
 DeclareSetting(bool, ConfirmBeforeCall);
 DeclareSetting(bool, NoTaskbarFlashing);
+DeclareSetting(bool, StreamedVoiceUpload);
 
 void SetRecentStickersLimit(int limit);
 [[nodiscard]] int RecentStickersLimit();
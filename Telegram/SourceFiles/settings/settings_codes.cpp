@@ -11,15 +11,23 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/toast/toast.h"
 #include "mainwidget.h"
 #include "data/data_session.h"
+#include "dialogs/dialogs_benchmark.h"
 #include "storage/localstorage.h"
 #include "boxes/confirm_box.h"
 #include "lang/lang_cloud_manager.h"
 #include "lang/lang_instance.h"
 #include "core/application.h"
+#include "main/main_account.h"
 #include "mtproto/mtp_instance.h"
 #include "mtproto/dc_options.h"
+#include "mtproto/details/mtproto_trace.h"
+#include "main/main_session.h"
+#include "storage/download_manager_mtproto.h"
+#include "storage/storage_cache_metrics.h"
 #include "core/file_utilities.h"
+#include "core/paint_profiler.h"
 #include "core/update_checker.h"
+#include "ffmpeg/ffmpeg_utility.h"
 #include "window/themes/window_theme.h"
 #include "window/themes/window_theme_editor.h"
 #include "media/audio/media_audio_track.h"
@@ -112,12 +120,106 @@ auto GenerateCodes() {
 			}
 		});
 	});
+	codes.emplace(qsl("mtptrace"), [](::Main::Session *session) {
+		using namespace MTP::details;
+		if (!TraceEnabled()) {
+			TraceSetEnabled(true);
+			Ui::Toast::Show("MTP tracing enabled.");
+			return;
+		}
+		TraceSetEnabled(false);
+		const auto path = cWorkingDir() + "mtp_trace.txt";
+		auto f = QFile(path);
+		if (f.open(QIODevice::WriteOnly)) {
+			f.write(TraceDump().toUtf8());
+			f.close();
+			File::ShowInFolder(path);
+		}
+	});
+	codes.emplace(qsl("paintprofile"), [](::Main::Session *session) {
+		using namespace Core;
+		if (!PaintProfilerEnabled()) {
+			PaintProfilerSetEnabled(true);
+			Ui::Toast::Show("Paint profiling enabled.");
+			return;
+		}
+		PaintProfilerSetEnabled(false);
+		const auto summary = PaintProfilerSummary();
+		LOG(("Paint Profile:\n%1").arg(summary));
+		const auto path = cWorkingDir() + "paint_trace.json";
+		auto f = QFile(path);
+		if (f.open(QIODevice::WriteOnly)) {
+			f.write(PaintProfilerChromeTrace());
+			f.close();
+			File::ShowInFolder(path);
+		}
+		Ui::show(Box<InformBox>(summary));
+	});
+	codes.emplace(qsl("videodecoder"), [](::Main::Session *session) {
+		Ui::show(Box<InformBox>(FFmpeg::HardwareDecodingStatus()));
+	});
+	codes.emplace(qsl("framepool"), [](::Main::Session *session) {
+		const auto stats = FFmpeg::FrameStoragePoolStatsGet();
+		Ui::show(Box<InformBox>(qsl("Frame storage pool\n\n"
+			"Allocated: %1\nReused: %2\nReleased: %3\n"
+			"Pooled: %4 buffers, %5 KB"
+			).arg(stats.allocated
+			).arg(stats.reused
+			).arg(stats.released
+			).arg(stats.pooledBuffers
+			).arg(stats.pooledBytes / 1024)));
+	});
+	codes.emplace(qsl("staticdownloads"), [](::Main::Session *session) {
+		if (!session) {
+			return;
+		}
+		auto &downloader = session->downloader();
+		downloader.setAdaptiveWindows(!downloader.adaptiveWindows());
+		Ui::Toast::Show(downloader.adaptiveWindows()
+			? "Adaptive download windows enabled."
+			: "Static download windows enabled.");
+	});
+	codes.emplace(qsl("rpcstats"), [](::Main::Session *session) {
+		const auto mtp = Core::App().activeAccount().mtp();
+		if (!mtp) {
+			return;
+		}
+		const auto json = mtp->rpcStatsJson();
+		FileDialog::GetWritePath(Core::App().getFileDialogParent(), "Save RPC stats", "JSON (*.json)", "rpc_stats.json", [=](const QString &result) {
+			if (result.isEmpty()) {
+				return;
+			}
+			auto f = QFile(result);
+			if (f.open(QIODevice::WriteOnly)) {
+				f.write(json);
+				Ui::Toast::Show("RPC stats saved.");
+			}
+		});
+	});
 #ifndef TDESKTOP_DISABLE_REGISTER_CUSTOM_SCHEME
 	codes.emplace(qsl("registertg"), [](::Main::Session *session) {
 		Platform::RegisterCustomScheme(true);
 		Ui::Toast::Show("Forced custom scheme register.");
 	});
 #endif // !TDESKTOP_DISABLE_REGISTER_CUSTOM_SCHEME
+	codes.emplace(qsl("memorystats"), [](::Main::Session *session) {
+		if (!session) {
+			return;
+		}
+		const auto report = session->data().memoryDescription()
+			+ "\n\nCache: "
+			+ Storage::CacheMetricsDescription();
+		LOG(("Memory Stats:\n%1").arg(report));
+		Ui::show(Box<InformBox>(report));
+	});
+	codes.emplace(qsl("dialogsbench"), [](::Main::Session *session) {
+		if (!session) {
+			return;
+		}
+		const auto report = Dialogs::RunListBenchmark(session);
+		LOG(("Dialogs Benchmark:\n%1").arg(report));
+		Ui::show(Box<InformBox>(report));
+	});
 	codes.emplace(qsl("export"), [](::Main::Session *session) {
 		session->data().startExport();
 	});
@@ -27,6 +27,7 @@ https://github.com/kotatogram/kotatogram-desktop/blob/dev/LEGAL
 #include "core/update_checker.h"
 #include "core/kotato_settings.h"
 #include "core/application.h"
+#include "ffmpeg/ffmpeg_utility.h"
 #include "storage/localstorage.h"
 #include "data/data_session.h"
 #include "main/main_session.h"
@@ -220,6 +221,20 @@ void SetupKotatoSystem(not_null<Ui::VerticalLayout*> container) {
 		KotatoSettings::Write();
 	}, container->lifetime());
 
+	AddButton(
+		container,
+		tr::ktg_settings_hw_video_decoding(),
+		st::settingsButton
+	)->toggleOn(
+		rpl::single(FFmpeg::HardwareDecoding())
+	)->toggledValue(
+	) | rpl::filter([](bool enabled) {
+		return (enabled != FFmpeg::HardwareDecoding());
+	}) | rpl::start_with_next([](bool enabled) {
+		FFmpeg::SetHardwareDecoding(enabled);
+		KotatoSettings::Write();
+	}, container->lifetime());
+
 	AddSkip(container);
 }
 
@@ -30,6 +30,48 @@ constexpr auto kMaxTrackedSuccesses = kRetryAddSessionSuccesses
 constexpr auto kRemoveSessionAfterTimeouts = 4;
 constexpr auto kResetDownloadPrioritiesTimeout = crl::time(200);
 constexpr auto kBadRequestDurationThreshold = 8 * crl::time(1000);
+constexpr auto kStripedSessionsCount = 4;
+
+// Time until the next part of a task of each class should be sent
+// and the relative shares of parts the classes get when not late.
+constexpr auto kClassDeadlines = std::array<crl::time, kDownloadClassCount>{
+	crl::time(500),
+	crl::time(2000),
+	crl::time(10000),
+	crl::time(60000),
+};
+constexpr auto kClassWeights = std::array<uint64, kDownloadClassCount>{
+	16,
+	8,
+	2,
+	1,
+};
+constexpr auto kClassStrideBase = uint64(16);
+
+[[nodiscard]] DownloadClass ComputeClass(
+		not_null<DownloadMtprotoTask*> task,
+		int priority) {
+	return (priority > 0) ? DownloadClass::Playback : task->downloadClass();
+}
+
+[[nodiscard]] const char *ClassName(int index) {
+	switch (DownloadClass(index)) {
+	case DownloadClass::Playback: return "playback";
+	case DownloadClass::Visible: return "visible";
+	case DownloadClass::Prefetch: return "prefetch";
+	case DownloadClass::Bulk: return "bulk";
+	}
+	Unexpected("Class in download manager ClassName.");
+}
+
+// Adaptive windows keep about kAdaptiveGain bandwidth-delay products in
+// flight, measured from the best delivery rate and the least round trip
+// over the last kAdaptiveFilterTimeout, and back off on queueing delay.
+constexpr auto kAdaptiveGain = 2;
+constexpr auto kAdaptiveMaxWaitedInSession = 32 * kDownloadPartSize;
+constexpr auto kAdaptiveFilterTimeout = 10 * crl::time(1000);
+constexpr auto kAdaptiveCongestedRoundTrips = 4;
+constexpr auto kAdaptiveCongestedMinDuration = crl::time(1000);
 
 // Each (session remove by timeouts) we wait for time:
 // kRetryAddSessionTimeout * max(removesCount, kMaxTrackedSessionRemoves)
@@ -44,13 +86,17 @@ void DownloadManagerMtproto::Queue::enqueue(
 	const auto position = ranges::find_if(_tasks, [&](const Enqueued &task) {
 		return task.priority <= priority;
 	}) - begin(_tasks);
+	const auto type = ComputeClass(task, priority);
+	const auto deadline = crl::now() + kClassDeadlines[int(type)];
 	const auto now = ranges::find(_tasks, task, &Enqueued::task);
 	const auto i = [&] {
 		if (now != end(_tasks)) {
-			(now->priority = priority);
+			now->priority = priority;
+			now->type = type;
+			accumulate_min(now->deadline, deadline);
 			return now;
 		}
-		_tasks.push_back({ task, priority });
+		_tasks.push_back({ task, priority, type, deadline });
 		return end(_tasks) - 1;
 	}();
 	const auto j = begin(_tasks) + position;
@@ -80,25 +126,60 @@ bool DownloadManagerMtproto::Queue::empty() const {
 	return _tasks.empty();
 }
 
-auto DownloadManagerMtproto::Queue::nextTask(bool onlyHighestPriority) const
--> Task* {
-	if (_tasks.empty()) {
-		return nullptr;
+auto DownloadManagerMtproto::Queue::nextTask(
+	const ClassShares &shares,
+	crl::time now)
+-> Enqueued* {
+	// Late tasks go earliest deadline first, otherwise the class with
+	// the least used share sends the part of its earliest deadline task.
+	//
+	// Tasks not requested again since the last generation reset, like
+	// userpics of rows scrolled out of view, go after the requested ones
+	// of their class and are never late, so they don't block those.
+	//
+	// Auto downloads wait while anything else requested is ready,
+	// only their deadlines keep them going at a slow pace meanwhile.
+	auto late = (Enqueued*)nullptr;
+	auto best = std::array<Enqueued*, kDownloadClassCount>{ { nullptr } };
+	auto interactive = false;
+	for (auto &enqueued : _tasks) {
+		if (!enqueued.task->readyToRequest()) {
+			continue;
+		}
+		if (enqueued.type != DownloadClass::Prefetch
+			&& enqueued.priority >= 0) {
+			interactive = true;
+		}
+		auto &first = best[int(enqueued.type)];
+		if (!first
+			|| (enqueued.priority > first->priority)
+			|| (enqueued.priority == first->priority
+				&& enqueued.deadline < first->deadline)) {
+			first = &enqueued;
+		}
+		if (enqueued.priority >= 0
+			&& enqueued.deadline <= now
+			&& (!late || enqueued.deadline < late->deadline)) {
+			late = &enqueued;
+		}
 	}
-	const auto highestPriority = _tasks.front().priority;
-	const auto notHighestPriority = [&](const Enqueued &enqueued) {
-		return (enqueued.priority != highestPriority);
-	};
-	const auto till = (onlyHighestPriority && highestPriority > 0)
-		? ranges::find_if(_tasks, notHighestPriority)
-		: end(_tasks);
-	const auto readyToRequest = [&](const Enqueued &enqueued) {
-		return enqueued.task->readyToRequest();
-	};
-	const auto first = ranges::find_if(
-		ranges::make_subrange(begin(_tasks), till),
-		readyToRequest);
-	return (first != till) ? first->task.get() : nullptr;
+	if (late) {
+		return late;
+	}
+	auto result = (Enqueued*)nullptr;
+	auto resultPass = uint64();
+	for (auto i = 0; i != kDownloadClassCount; ++i) {
+		if (!best[i]
+			|| (interactive && DownloadClass(i) == DownloadClass::Prefetch)) {
+			continue;
+		}
+		const auto pass = std::max(shares.pass[i], shares.globalPass);
+		if (!result || pass < resultPass) {
+			result = best[i];
+			resultPass = pass;
+		}
+	}
+	return result;
 }
 
 void DownloadManagerMtproto::Queue::removeSession(int index) {
@@ -131,12 +212,24 @@ DownloadManagerMtproto::DownloadManagerMtproto(not_null<ApiWrap*> api)
 
 DownloadManagerMtproto::~DownloadManagerMtproto() {
 	killSessions();
+
+	for (auto i = 0; i != kDownloadClassCount; ++i) {
+		if (_shares.dispatched[i]) {
+			LOG(("Download Info: %1 parts sent: %2, late: %3."
+				).arg(ClassName(i)
+				).arg(_shares.dispatched[i]
+				).arg(_shares.missed[i]));
+		}
+	}
 }
 
 void DownloadManagerMtproto::enqueue(not_null<Task*> task, int priority) {
 	const auto dcId = task->dcId();
 	auto &queue = _queues[dcId];
 	queue.enqueue(task, priority);
+	if (task->striped()) {
+		addStripedSessions(dcId);
+	}
 	if (!_resetGenerationTimer.isActive()) {
 		_resetGenerationTimer.callOnce(kResetDownloadPrioritiesTimeout);
 	}
@@ -157,6 +250,22 @@ void DownloadManagerMtproto::resetGeneration() {
 	}
 }
 
+void DownloadManagerMtproto::addStripedSessions(MTP::DcId dcId) {
+	auto &dc = _balanceData[dcId];
+	if (dc.timeouts > 0 || dc.sessions.size() >= kStripedSessionsCount) {
+		return;
+	}
+	const auto now = crl::now();
+	const auto delay = (dc.sessionRemoveTimes + 1) * kRetryAddSessionTimeout;
+	if (dc.lastSessionRemove && now < dc.lastSessionRemove + delay) {
+		return;
+	}
+	dc.sessions.resize(kStripedSessionsCount);
+	DEBUG_LOG(("Download (%1) striped, now sessions: %2"
+		).arg(dcId
+		).arg(dc.sessions.size()));
+}
+
 void DownloadManagerMtproto::checkSendNext() {
 	for (auto &[dcId, queue] : _queues) {
 		if (queue.empty()) {
@@ -178,7 +287,7 @@ bool DownloadManagerMtproto::trySendNextPart(MTP::DcId dcId, Queue &queue) {
 		const auto proj = [](const DcSessionBalanceData &data) {
 			return (data.requested < data.maxWaitedAmount)
 				? data.requested
-				: kMaxWaitedInSession;
+				: std::max(kMaxWaitedInSession, kAdaptiveMaxWaitedInSession);
 		};
 		const auto j = ranges::min_element(sessions, ranges::less(), proj);
 		return (j->requested + kDownloadPartSize <= j->maxWaitedAmount)
@@ -188,14 +297,33 @@ bool DownloadManagerMtproto::trySendNextPart(MTP::DcId dcId, Queue &queue) {
 	if (bestIndex < 0) {
 		return false;
 	}
-	const auto onlyHighestPriority = (balanceData.totalRequested > 0);
-	if (const auto task = queue.nextTask(onlyHighestPriority)) {
+	const auto now = crl::now();
+	if (const auto enqueued = queue.nextTask(_shares, now)) {
+		const auto task = enqueued->task;
+		dispatched(*enqueued, now);
 		task->loadPart(bestIndex);
 		return true;
 	}
 	return false;
 }
 
+void DownloadManagerMtproto::dispatched(
+		Queue::Enqueued &enqueued,
+		crl::time now) {
+	const auto index = int(enqueued.type);
+	const auto pass = std::max(_shares.pass[index], _shares.globalPass);
+	_shares.globalPass = pass;
+	_shares.pass[index] = pass + kClassStrideBase / kClassWeights[index];
+	++_shares.dispatched[index];
+	if (enqueued.deadline < now) {
+		++_shares.missed[index];
+		DEBUG_LOG(("Download Info: %1 part late by %2 ms."
+			).arg(ClassName(index)
+			).arg(now - enqueued.deadline));
+	}
+	enqueued.deadline = now + kClassDeadlines[index];
+}
+
 int DownloadManagerMtproto::changeRequestedAmount(
 		MTP::DcId dcId,
 		int index,
@@ -257,7 +385,12 @@ void DownloadManagerMtproto::requestSucceeded(
 		});
 		return;
 	}
-	if (amountAtRequestStart == data.maxWaitedAmount
+	if (_adaptiveWindows) {
+		if (!updateAdaptiveWindows(dc, amountAtRequestStart, duration)) {
+			// More sessions won't help while windows are not saturated.
+			return;
+		}
+	} else if (amountAtRequestStart == data.maxWaitedAmount
 		&& data.maxWaitedAmount < kMaxWaitedInSession) {
 		data.maxWaitedAmount = std::min(
 			data.maxWaitedAmount + kDownloadPartSize,
@@ -296,6 +429,83 @@ void DownloadManagerMtproto::requestSucceeded(
 		).arg(dc.sessions.size()));
 }
 
+bool DownloadManagerMtproto::updateAdaptiveWindows(
+		DcBalanceData &dc,
+		int amountAtRequestStart,
+		crl::time duration) {
+	const auto now = crl::now();
+	const auto roundTrip = std::max(duration, crl::time(1));
+	if (!dc.minRoundTrip
+		|| roundTrip <= dc.minRoundTrip
+		|| now - dc.minRoundTripAt > kAdaptiveFilterTimeout) {
+		dc.minRoundTrip = roundTrip;
+		dc.minRoundTripAt = now;
+	}
+	const auto rate = int64(amountAtRequestStart) * 1000 / roundTrip;
+	if (rate >= dc.maxDeliveryRate
+		|| now - dc.maxDeliveryRateAt > kAdaptiveFilterTimeout) {
+		dc.maxDeliveryRate = rate;
+		dc.maxDeliveryRateAt = now;
+	}
+
+	const auto count = int(dc.sessions.size());
+	const auto congested = (duration >= kAdaptiveCongestedMinDuration)
+		&& (duration > kAdaptiveCongestedRoundTrips * dc.minRoundTrip);
+	if (congested) {
+		for (auto &session : dc.sessions) {
+			session.maxWaitedAmount = std::max(
+				(session.maxWaitedAmount * 3 / 4)
+					/ kDownloadPartSize
+					* kDownloadPartSize,
+				kStartWaitedInSession);
+		}
+		DEBUG_LOG(("Download Info: Congested with %1 sessions, "
+			"duration: %2, min rtt: %3."
+			).arg(count
+			).arg(duration
+			).arg(dc.minRoundTrip));
+		return false;
+	}
+
+	const auto product = dc.maxDeliveryRate * dc.minRoundTrip / 1000;
+	const auto perSession = (kAdaptiveGain * product + count - 1) / count;
+	const auto parts = (perSession + kDownloadPartSize - 1) / kDownloadPartSize;
+	const auto target = std::clamp(
+		int(std::min(parts, int64(kAdaptiveMaxWaitedInSession)))
+			* kDownloadPartSize,
+		kStartWaitedInSession,
+		kAdaptiveMaxWaitedInSession);
+	for (auto &session : dc.sessions) {
+		// Grow by a part per success, like the static windows do.
+		if (session.maxWaitedAmount < target) {
+			session.maxWaitedAmount += kDownloadPartSize;
+		} else if (session.maxWaitedAmount > target) {
+			session.maxWaitedAmount = target;
+		}
+	}
+	return (target == kAdaptiveMaxWaitedInSession);
+}
+
+void DownloadManagerMtproto::setAdaptiveWindows(bool enabled) {
+	if (_adaptiveWindows == enabled) {
+		return;
+	}
+	_adaptiveWindows = enabled;
+	for (auto &[dcId, dc] : _balanceData) {
+		for (auto &session : dc.sessions) {
+			session.maxWaitedAmount = std::min(
+				session.maxWaitedAmount,
+				kMaxWaitedInSession);
+		}
+		dc.minRoundTrip = dc.minRoundTripAt = 0;
+		dc.maxDeliveryRate = dc.maxDeliveryRateAt = 0;
+	}
+}
+
+bool DownloadManagerMtproto::adaptiveWindows() const {
+	return _adaptiveWindows;
+}
+
 int DownloadManagerMtproto::chooseSessionIndex(MTP::DcId dcId) const {
 	const auto i = _balanceData.find(dcId);
 	Assert(i != end(_balanceData));
@@ -358,6 +568,25 @@ void DownloadManagerMtproto::removeSession(MTP::DcId dcId) {
 	dc.lastSessionRemove = crl::now();
 }
 
+void DownloadManagerMtproto::prewarm(MTP::DcId dcId) {
+	if (!dcId) {
+		return;
+	}
+	const auto killing = _killSessionsWhen.find(dcId);
+	if (killing != end(_killSessionsWhen)) {
+		// Idle, but still connected, keep it a little longer.
+		killing->second = crl::now() + kKillSessionTimeout;
+		return;
+	}
+	auto &dc = _balanceData[dcId];
+	if (dc.totalRequested > 0) {
+		return;
+	}
+	DEBUG_LOG(("Download Info: prewarming session for dc %1.").arg(dcId));
+	MTP::sendAnything(MTP::downloadDcId(dcId, 0));
+	killSessionsSchedule(dcId);
+}
+
 void DownloadManagerMtproto::killSessionsSchedule(MTP::DcId dcId) {
 	if (!_killSessionsWhen.contains(dcId)) {
 		_killSessionsWhen.emplace(dcId, crl::now() + kKillSessionTimeout);
@@ -433,6 +662,14 @@ DownloadMtprotoTask::~DownloadMtprotoTask() {
 	_owner->remove(this);
 }
 
+bool DownloadMtprotoTask::striped() const {
+	return false;
+}
+
+DownloadClass DownloadMtprotoTask::downloadClass() const {
+	return DownloadClass::Visible;
+}
+
 MTP::DcId DownloadMtprotoTask::dcId() const {
 	return _dcId;
 }
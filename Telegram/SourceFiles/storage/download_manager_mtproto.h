@@ -22,6 +22,15 @@ namespace Storage {
 // fixed part size download for hash checking.
 constexpr auto kDownloadPartSize = 128 * 1024;
 
+// Each class has a deadline for its next part and a share of parts.
+enum class DownloadClass {
+	Playback,
+	Visible,
+	Prefetch,
+	Bulk,
+};
+inline constexpr auto kDownloadClassCount = 4;
+
 class DownloadMtprotoTask;
 
 class DownloadManagerMtproto final : public base::has_weak_ptr {
@@ -50,21 +59,40 @@ public:
 		crl::time timeAtRequestStart);
 	[[nodiscard]] int chooseSessionIndex(MTP::DcId dcId) const;
 
+	// Adaptive windows are on by default, the static ones are a fallback.
+	void setAdaptiveWindows(bool enabled);
+	[[nodiscard]] bool adaptiveWindows() const;
+
+	// Opens the first download session of the dc in advance,
+	// it is killed by the usual idle timeout if nothing is loaded.
+	void prewarm(MTP::DcId dcId);
+
 private:
+	struct ClassShares {
+		std::array<uint64, kDownloadClassCount> pass = { { 0 } };
+		uint64 globalPass = 0;
+		std::array<int, kDownloadClassCount> dispatched = { { 0 } };
+		std::array<int, kDownloadClassCount> missed = { { 0 } };
+	};
 	class Queue final {
 	public:
+		struct Enqueued {
+			not_null<Task*> task;
+			int priority = 0;
+			DownloadClass type = DownloadClass::Visible;
+			crl::time deadline = 0;
+		};
+
 		void enqueue(not_null<Task*> task, int priority);
 		void remove(not_null<Task*> task);
 		void resetGeneration();
 		[[nodiscard]] bool empty() const;
-		[[nodiscard]] Task *nextTask(bool onlyHighestPriority) const;
+		[[nodiscard]] Enqueued *nextTask(
+			const ClassShares &shares,
+			crl::time now);
 		void removeSession(int index);
 
 	private:
-		struct Enqueued {
-			not_null<Task*> task;
-			int priority = 0;
-		};
 		std::vector<Enqueued> _tasks;
 
 	};
@@ -84,8 +112,19 @@ private:
 		int sessionRemoveTimes = 0;
 		int timeouts = 0; // Since all sessions had successes >= required.
 		int totalRequested = 0;
+
+		// Adaptive windows: windowed min round trip and max delivery rate.
+		crl::time minRoundTrip = 0;
+		crl::time minRoundTripAt = 0;
+		int64 maxDeliveryRate = 0; // Bytes per second.
+		crl::time maxDeliveryRateAt = 0;
 	};
 
+	[[nodiscard]] bool updateAdaptiveWindows(
+		DcBalanceData &dc,
+		int amountAtRequestStart,
+		crl::time duration);
+
 	void checkSendNext();
 	void checkSendNext(MTP::DcId dcId, Queue &queue);
 	bool trySendNextPart(MTP::DcId dcId, Queue &queue);
@@ -96,6 +135,8 @@ private:
 	void killSessions(MTP::DcId dcId);
 
 	void resetGeneration();
+	void dispatched(Queue::Enqueued &enqueued, crl::time now);
+	void addStripedSessions(MTP::DcId dcId);
 	void sessionTimedOut(MTP::DcId dcId, int index);
 	void removeSession(MTP::DcId dcId);
 
@@ -110,6 +151,8 @@ private:
 	base::Timer _killSessionsTimer;
 
 	base::flat_map<MTP::DcId, Queue> _queues;
+	ClassShares _shares;
+	bool _adaptiveWindows = true;
 	rpl::lifetime _lifetime;
 
 };
@@ -139,6 +182,13 @@ public:
 	[[nodiscard]] const Location &location() const;
 
 	[[nodiscard]] virtual bool readyToRequest() const = 0;
+
+	// Large files open several sessions of the dc (or its cdn) at once
+	// instead of growing them one by one as requests succeed.
+	[[nodiscard]] virtual bool striped() const;
+
+	// Tasks enqueued with a positive priority are always Playback.
+	[[nodiscard]] virtual DownloadClass downloadClass() const;
 	void loadPart(int sessionIndex);
 	void removeSession(int sessionIndex);
 
@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "core/application.h"
 #include "storage/localstorage.h"
+#include "storage/storage_cache_metrics.h"
 #include "platform/platform_file_utilities.h"
 #include "main/main_session.h"
 #include "apiwrap.h"
@@ -23,6 +24,101 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "facades.h"
 #include "app.h"
 
+#include <QtCore/QDataStream>
+
+namespace {
+
+constexpr auto kResumePartSize = 128 * 1024;
+constexpr auto kResumeSaveEach = 32; // Parts, 4 MB.
+constexpr auto kResumeMapMagic = quint32(0x54445052); // 'TDPR'
+constexpr auto kResumeMapVersion = qint32(1);
+
+// Partial files left by downloads that were never finished.
+constexpr auto kResumeMaxAge = 7 * 24 * 3600; // Seconds.
+constexpr auto kResumeMaxSize = int64(2048) * 1024 * 1024;
+
+// Progressive JPEGs give a full sized picture from a part of the file,
+// baseline ones are decoded down to the last received row.
+constexpr auto kPreviewMinFileSize = 512 * 1024;
+constexpr auto kPreviewRedecodeParts = 4;
+
+// Smaller images are decoded right when they're needed.
+constexpr auto kAsyncDecodeMinSize = 32 * 1024;
+
+[[nodiscard]] QImage ReadImage(
+		const QByteArray &data,
+		const QSize &shrinkBox,
+		QByteArray *format) {
+	auto image = App::readImage(data, format, false);
+	if (!image.isNull()
+		&& !shrinkBox.isEmpty()
+		&& (image.width() > shrinkBox.width()
+			|| image.height() > shrinkBox.height())) {
+		return image.scaled(
+			shrinkBox,
+			Qt::KeepAspectRatio,
+			Qt::SmoothTransformation);
+	}
+	return image;
+}
+
+[[nodiscard]] QString ResumeMapPath(const QString &path) {
+	return path + qsl(".map");
+}
+
+// Main thread, partial files that some loader has open right now.
+base::flat_set<QString> ResumePathsInUse;
+bool ResumeFolderPruned = false;
+
+void PruneResumeFolder() {
+	struct Entry {
+		QDateTime modified;
+		int64 size = 0;
+		QStringList paths;
+	};
+	auto entries = base::flat_map<QString, Entry>();
+	const auto folder = Storage::ResumableDownloadsFolder();
+	const auto list = QDir(folder).entryInfoList(QDir::Files);
+	for (const auto &info : list) {
+		const auto path = info.absoluteFilePath();
+		const auto data = path.endsWith(qstr(".map"))
+			? path.mid(0, path.size() - 4)
+			: path;
+		auto &entry = entries[data];
+		entry.modified = std::max(entry.modified, info.lastModified());
+		entry.size += info.size();
+		entry.paths.push_back(path);
+	}
+	auto sorted = std::vector<Entry>();
+	sorted.reserve(entries.size());
+	for (auto &[data, entry] : entries) {
+		sorted.push_back(std::move(entry));
+	}
+	ranges::sort(sorted, std::greater<>(), &Entry::modified);
+
+	const auto old = QDateTime::currentDateTime().addSecs(-kResumeMaxAge);
+	auto total = int64();
+	for (const auto &entry : sorted) {
+		total += entry.size;
+		if (entry.modified >= old && total <= kResumeMaxSize) {
+			continue;
+		}
+		for (const auto &path : entry.paths) {
+			QFile::remove(path);
+		}
+	}
+}
+
+} // namespace
+
+namespace Storage {
+
+QString ResumableDownloadsFolder() {
+	return cWorkingDir() + qsl("tdata/downloads/");
+}
+
+} // namespace Storage
+
 FileLoader::FileLoader(
 	const QString &toFile,
 	int32 size,
@@ -43,7 +139,14 @@ FileLoader::FileLoader(
 	Expects(!_filename.isEmpty() || (_size <= Storage::kMaxFileInMemory));
 }
 
-FileLoader::~FileLoader() = default;
+FileLoader::~FileLoader() {
+	if (!_finished && !_resumeParts.empty()) {
+		writeResumeMap();
+	}
+	if (!_resumePath.isEmpty()) {
+		ResumePathsInUse.remove(_resumePath);
+	}
+}
 
 Main::Session &FileLoader::session() const {
 	return *_session;
@@ -89,15 +192,45 @@ QImage FileLoader::imageData(const QSize &shrinkBox) const {
 	return _imageData;
 }
 
+bool FileLoader::prepareImageData(const QSize &shrinkBox) {
+	Expects(_finished);
+
+	if (_imageDecoded
+		|| !_imageData.isNull()
+		|| _locationType != UnknownFileLocation
+		|| _data.size() < kAsyncDecodeMinSize) {
+		return true;
+	} else if (_imageDecoding) {
+		return false;
+	}
+	crl::async([
+		=,
+		data = _data,
+		guard = _imageDecoding.make_guard()
+	]() mutable {
+		auto format = QByteArray();
+		auto image = ReadImage(data, shrinkBox, &format);
+		crl::on_main(std::move(guard), [
+			=,
+			image = std::move(image),
+			format = std::move(format)
+		]() mutable {
+			_imageDecoded = true;
+			if (_imageData.isNull() && !image.isNull()) {
+				_imageData = std::move(image);
+				_imageFormat = std::move(format);
+			}
+			session().downloaderTaskFinished().notify();
+		});
+	});
+	return false;
+}
+
 void FileLoader::readImage(const QSize &shrinkBox) const {
 	auto format = QByteArray();
-	auto image = App::readImage(_data, &format, false);
+	auto image = ReadImage(_data, shrinkBox, &format);
 	if (!image.isNull()) {
-		if (!shrinkBox.isEmpty() && (image.width() > shrinkBox.width() || image.height() > shrinkBox.height())) {
-			_imageData = image.scaled(shrinkBox, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-		} else {
-			_imageData = std::move(image);
-		}
+		_imageData = std::move(image);
 		_imageFormat = format;
 	}
 }
@@ -130,9 +263,45 @@ void FileLoader::permitLoadFromCloud() {
 }
 
 void FileLoader::notifyAboutProgress() {
+	checkPreview();
 	emit progress(this);
 }
 
+void FileLoader::checkPreview() {
+	if (_finished
+		|| _cancelled
+		|| _fileIsOpen
+		|| _skippedBytes != 0
+		|| _locationType != UnknownFileLocation
+		|| _size < kPreviewMinFileSize
+		|| _previewLoading) {
+		return;
+	}
+	const auto available = _data.size();
+	const auto step = _size / kPreviewRedecodeParts;
+	if (available >= _size || available - _previewDecodedSize < step) {
+		return;
+	}
+	_previewDecodedSize = available;
+	crl::async([
+		=,
+		data = _data,
+		guard = _previewLoading.make_guard()
+	]() mutable {
+		auto image = App::readImage(data, nullptr, false);
+		crl::on_main(std::move(guard), [
+			=,
+			image = std::move(image)
+		]() mutable {
+			if (_finished || image.isNull()) {
+				return;
+			}
+			_preview = std::move(image);
+			session().downloaderTaskFinished().notify();
+		});
+	});
+}
+
 void FileLoader::localLoaded(
 		const StorageImageSaved &result,
 		const QByteArray &imageFormat,
@@ -160,7 +329,10 @@ void FileLoader::start() {
 	}
 
 	if (!_filename.isEmpty() && _toCache == LoadToFileOnly && !_fileIsOpen) {
-		_fileIsOpen = _file.open(QIODevice::WriteOnly);
+		// Opened for reading as well for readLoadedPartBack().
+		_fileIsOpen = resumable()
+			? openResumable()
+			: _file.open(QIODevice::ReadWrite | QIODevice::Truncate);
 		if (!_fileIsOpen) {
 			return cancel(true);
 		}
@@ -186,8 +358,11 @@ void FileLoader::loadLocal(const Storage::Cache::Key &key) {
 				std::move(image));
 		});
 	};
+	const auto kind = Storage::CacheKindFromTag(_cacheTag);
+	const auto started = crl::now();
 	session().data().cache().get(key, [=, callback = std::move(done)](
 			QByteArray &&value) mutable {
+		Storage::CountCacheRead(kind, !value.isEmpty(), started);
 		if (readImage) {
 			crl::async([
 				value = std::move(value),
@@ -251,6 +426,7 @@ void FileLoader::cancel(bool fail) {
 		_fileIsOpen = false;
 		_file.remove();
 	}
+	clearResumable();
 	_data = QByteArray();
 
 	const auto weak = QPointer<FileLoader>(this);
@@ -266,7 +442,7 @@ void FileLoader::cancel(bool fail) {
 }
 
 int FileLoader::currentOffset() const {
-	return (_fileIsOpen ? _file.size() : _data.size()) - _skippedBytes;
+	return (_fileIsOpen ? _fileWrittenTill : _data.size()) - _skippedBytes;
 }
 
 bool FileLoader::writeResultPart(int offset, bytes::const_span buffer) {
@@ -275,8 +451,14 @@ bool FileLoader::writeResultPart(int offset, bytes::const_span buffer) {
 	if (buffer.empty()) {
 		return true;
 	}
+	const auto till = offset + int(buffer.size());
 	if (_fileIsOpen) {
-		auto fsize = _file.size();
+		if (!_filePreallocated && _size > 0) {
+			// Allocate the whole file once, parts are written in place.
+			_filePreallocated = true;
+			_file.resize(_size);
+		}
+		const auto fsize = _fileWrittenTill;
 		if (offset < fsize) {
 			_skippedBytes -= buffer.size();
 		} else if (offset > fsize) {
@@ -287,9 +469,16 @@ bool FileLoader::writeResultPart(int offset, bytes::const_span buffer) {
 			cancel(true);
 			return false;
 		}
+		accumulate_max(_fileWrittenTill, till);
+		markResumedPart(offset, buffer.size());
 		return true;
 	}
-	_data.reserve(offset + buffer.size());
+	if (_data.capacity() < till) {
+		// Reserve the known size at once, grow geometrically past it.
+		_data.reserve((till <= _size)
+			? _size
+			: std::max(till, _data.capacity() * 2));
+	}
 	if (offset > _data.size()) {
 		_skippedBytes += offset - _data.size();
 		_data.resize(offset);
@@ -309,6 +498,162 @@ bool FileLoader::writeResultPart(int offset, bytes::const_span buffer) {
 	return true;
 }
 
+bool FileLoader::resumable() const {
+	return false;
+}
+
+bool FileLoader::resumedPartLoaded(int offset) const {
+	const auto index = offset / kResumePartSize;
+	return !(offset % kResumePartSize)
+		&& (index < _resumeParts.size())
+		&& _resumeParts[index];
+}
+
+bool FileLoader::openResumable() {
+	Expects(_size > 0);
+
+	const auto folder = Storage::ResumableDownloadsFolder();
+	if (!ResumeFolderPruned) {
+		ResumeFolderPruned = true;
+		PruneResumeFolder();
+	}
+
+	// The target is a part of the name, so that loaders of the same file
+	// to different places don't share the partial file.
+	const auto key = cacheKey();
+	const auto target = QFileInfo(_filename).absoluteFilePath().toUtf8();
+	const auto hash = hashSha1(target.constData(), target.size());
+	const auto resumeKey = QByteArray::number(quint64(key.high), 16)
+		+ '_'
+		+ QByteArray::number(quint64(key.low), 16)
+		+ '_'
+		+ QByteArray(hash.data(), 4).toHex();
+	const auto resumePath = folder + QString::fromLatin1(resumeKey);
+	if (ResumePathsInUse.contains(resumePath)) {
+		// Someone already loads this file to the same place.
+		return _file.open(QIODevice::ReadWrite | QIODevice::Truncate);
+	}
+	ResumePathsInUse.emplace(resumePath);
+	_resumeKey = resumeKey;
+	_resumePath = resumePath;
+	_resumeParts = std::vector<bool>(
+		(_size + kResumePartSize - 1) / kResumePartSize,
+		false);
+	QDir().mkpath(folder);
+	_file.setFileName(_resumePath);
+
+	auto map = QFile(ResumeMapPath(_resumePath));
+	if (QFileInfo(_resumePath).size() == _size
+		&& map.open(QIODevice::ReadOnly)) {
+		auto stream = QDataStream(&map);
+		stream.setVersion(QDataStream::Qt_5_1);
+		auto magic = quint32();
+		auto version = qint32();
+		auto resumeKey = QByteArray();
+		auto size = qint32();
+		auto parts = QByteArray();
+		stream >> magic >> version >> resumeKey >> size >> parts;
+		map.close();
+		const auto count = int(_resumeParts.size());
+		if (stream.status() == QDataStream::Ok
+			&& magic == kResumeMapMagic
+			&& version == kResumeMapVersion
+			&& resumeKey == _resumeKey
+			&& size == _size
+			&& parts.size() == (count + 7) / 8
+			&& _file.open(QIODevice::ReadWrite)) {
+			auto loaded = 0;
+			for (auto i = 0; i != count; ++i) {
+				if (uchar(parts[i / 8]) & (1 << (i % 8))) {
+					_resumeParts[i] = true;
+					loaded += std::min(
+						kResumePartSize,
+						_size - i * kResumePartSize);
+				}
+			}
+			_filePreallocated = true;
+			_fileWrittenTill = _size;
+			_skippedBytes = _size - loaded;
+			LOG(("Download Info: Resuming %1, loaded %2 of %3."
+				).arg(QString::fromLatin1(_resumeKey)
+				).arg(loaded
+				).arg(_size));
+			return true;
+		}
+	}
+	return _file.open(QIODevice::ReadWrite | QIODevice::Truncate);
+}
+
+void FileLoader::markResumedPart(int offset, int size) {
+	if (_resumeParts.empty() || (offset % kResumePartSize)) {
+		return;
+	}
+	const auto index = offset / kResumePartSize;
+	const auto full = (size == kResumePartSize)
+		|| (offset + size == _size);
+	if (!full || index >= _resumeParts.size() || _resumeParts[index]) {
+		return;
+	}
+	_resumeParts[index] = true;
+	if (++_resumeUnsavedParts >= kResumeSaveEach) {
+		writeResumeMap();
+	}
+}
+
+void FileLoader::writeResumeMap() {
+	_resumeUnsavedParts = 0;
+	if (_fileIsOpen) {
+		// Make sure the map never marks parts that were not written.
+		_file.flush();
+	}
+
+	const auto count = int(_resumeParts.size());
+	auto parts = QByteArray((count + 7) / 8, char(0));
+	for (auto i = 0; i != count; ++i) {
+		if (_resumeParts[i]) {
+			parts[i / 8] = char(uchar(parts[i / 8]) | (1 << (i % 8)));
+		}
+	}
+	auto map = QFile(ResumeMapPath(_resumePath));
+	if (!map.open(QIODevice::WriteOnly)) {
+		return;
+	}
+	auto stream = QDataStream(&map);
+	stream.setVersion(QDataStream::Qt_5_1);
+	stream
+		<< kResumeMapMagic
+		<< kResumeMapVersion
+		<< _resumeKey
+		<< qint32(_size)
+		<< parts;
+}
+
+bool FileLoader::moveResumableToTarget() {
+	QFile::remove(ResumeMapPath(_resumePath));
+	_resumeParts.clear();
+	QFile::remove(_filename);
+	if (!_file.rename(_filename)) {
+		if (!_file.copy(_filename)) {
+			LOG(("Download Error: Could not move %1 to %2."
+				).arg(_resumePath
+				).arg(_filename));
+			return false;
+		}
+		_file.remove();
+		_file.setFileName(_filename);
+	}
+	return true;
+}
+
+void FileLoader::clearResumable() {
+	if (_resumePath.isEmpty()) {
+		return;
+	}
+	QFile::remove(_resumePath);
+	QFile::remove(ResumeMapPath(_resumePath));
+	_resumeParts.clear();
+}
+
 QByteArray FileLoader::readLoadedPartBack(int offset, int size) {
 	Expects(offset >= 0 && size > 0);
 
@@ -321,7 +666,7 @@ QByteArray FileLoader::readLoadedPartBack(int offset, int size) {
 				return QByteArray();
 			}
 		}
-		if (!_file.seek(offset)) {
+		if (offset + size > _fileWrittenTill || !_file.seek(offset)) {
 			return QByteArray();
 		}
 		auto result = _file.read(size);
@@ -348,8 +693,16 @@ bool FileLoader::finalizeResult() {
 
 	_finished = true;
 	if (_fileIsOpen) {
+		if (_filePreallocated && _file.size() > _fileWrittenTill) {
+			_file.resize(_fileWrittenTill);
+		}
 		_file.close();
 		_fileIsOpen = false;
+		if (!_resumeParts.empty() && !moveResumableToTarget()) {
+			_finished = false;
+			cancel(true);
+			return false;
+		}
 		Platform::File::PostprocessDownloaded(
 			QFileInfo(_file).absoluteFilePath());
 	}
@@ -361,10 +714,13 @@ bool FileLoader::finalizeResult() {
 		}
 		if ((_toCache == LoadToCacheAsWell)
 			&& (_data.size() <= Storage::kMaxFileInMemory)) {
+			Storage::CountCacheWrite(
+				Storage::CacheKindFromTag(_cacheTag),
+				_data.size());
 			session().data().cache().put(
 				cacheKey(),
 				Storage::Cache::Database::TaggedValue(
-					base::duplicate(_data),
+					QByteArray(_data), // Finished, so it is not changed.
 					_cacheTag));
 		}
 	}
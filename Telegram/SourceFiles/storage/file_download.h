@@ -43,6 +43,9 @@ constexpr auto kMaxAnimationInMemory = kMaxFileInMemory;
 // 4096x4096 is max area.
 constexpr auto kMaxWallPaperDimension = 4096;
 
+// Partial files of the resumable downloads with their loaded parts maps.
+[[nodiscard]] QString ResumableDownloadsFolder();
+
 } // namespace Storage
 
 struct StorageImageSaved {
@@ -85,6 +88,16 @@ public:
 	}
 	QByteArray imageFormat(const QSize &shrinkBox = QSize()) const;
 	QImage imageData(const QSize &shrinkBox = QSize()) const;
+
+	// Decodes the loaded image on a background thread, returns true when
+	// imageData() will return it without decoding on the main thread.
+	[[nodiscard]] bool prepareImageData(const QSize &shrinkBox = QSize());
+
+	// While a large image is loaded to memory part by part in order,
+	// the received beginning of it is decoded from time to time.
+	[[nodiscard]] const QImage &preview() const {
+		return _preview;
+	}
 	QString fileName() const {
 		return _filename;
 	}
@@ -125,6 +138,7 @@ protected:
 	};
 
 	void readImage(const QSize &shrinkBox) const;
+	void checkPreview();
 
 	bool tryLoadLocal();
 	void loadLocal(const Storage::Cache::Key &key);
@@ -133,6 +147,11 @@ protected:
 	virtual void cancelHook() = 0;
 	virtual void startLoading() = 0;
 
+	// Resumable loads are written to a partial file keyed by cacheKey()
+	// with a map of loaded parts, so they continue after a restart.
+	[[nodiscard]] virtual bool resumable() const;
+	[[nodiscard]] bool resumedPartLoaded(int offset) const;
+
 	void cancel(bool failed);
 
 	void notifyAboutProgress();
@@ -141,6 +160,12 @@ protected:
 	bool finalizeResult();
 	[[nodiscard]] QByteArray readLoadedPartBack(int offset, int size);
 
+	bool openResumable();
+	void markResumedPart(int offset, int size);
+	void writeResumeMap();
+	bool moveResumableToTarget();
+	void clearResumable();
+
 	const not_null<Main::Session*> _session;
 
 	bool _autoLoading = false;
@@ -152,6 +177,13 @@ protected:
 	QString _filename;
 	QFile _file;
 	bool _fileIsOpen = false;
+	bool _filePreallocated = false;
+	int _fileWrittenTill = 0;
+
+	QString _resumePath;
+	QByteArray _resumeKey;
+	std::vector<bool> _resumeParts;
+	int _resumeUnsavedParts = 0;
 
 	LoadToCacheSetting _toCache;
 	LoadFromCloudSetting _fromCloud;
@@ -166,4 +198,11 @@ protected:
 	mutable QByteArray _imageFormat;
 	mutable QImage _imageData;
 
+	base::binary_guard _imageDecoding;
+	bool _imageDecoded = false;
+
+	base::binary_guard _previewLoading;
+	QImage _preview;
+	int _previewDecodedSize = 0;
+
 };
@@ -17,6 +17,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/openssl_help.h"
 #include "facades.h"
 
+namespace {
+
+constexpr auto kStripedMinSize = 64 * 1024 * 1024;
+constexpr auto kResumableMinSize = Storage::kMaxFileInMemory;
+
+} // namespace
+
 mtpFileLoader::mtpFileLoader(
 	const StorageFileLocation &location,
 	Data::FileOrigin origin,
@@ -93,11 +100,24 @@ bool mtpFileLoader::readyToRequest() const {
 		&& (!_size || _nextRequestOffset < _size);
 }
 
+bool mtpFileLoader::striped() const {
+	return (_size >= kStripedMinSize);
+}
+
+Storage::DownloadClass mtpFileLoader::downloadClass() const {
+	return _autoLoading
+		? Storage::DownloadClass::Prefetch
+		: (_toCache == LoadToFileOnly)
+		? Storage::DownloadClass::Bulk
+		: Storage::DownloadClass::Visible;
+}
+
 int mtpFileLoader::takeNextRequestOffset() {
 	Expects(readyToRequest());
 
 	const auto result = _nextRequestOffset;
 	_nextRequestOffset += Storage::kDownloadPartSize;
+	skipResumedParts();
 	return result;
 }
 
@@ -141,7 +161,27 @@ bool mtpFileLoader::setWebFileSizeHook(int size) {
 	return false;
 }
 
+bool mtpFileLoader::resumable() const {
+	return (_size >= kResumableMinSize)
+		&& base::get_if<StorageFileLocation>(&location().data);
+}
+
+void mtpFileLoader::skipResumedParts() {
+	while (_nextRequestOffset < _size
+		&& resumedPartLoaded(_nextRequestOffset)) {
+		_nextRequestOffset += Storage::kDownloadPartSize;
+	}
+}
+
 void mtpFileLoader::startLoading() {
+	skipResumedParts();
+	if (_size && _nextRequestOffset >= _size) {
+		// Everything was loaded before the restart.
+		if (finalizeResult()) {
+			notifyAboutProgress();
+		}
+		return;
+	}
 	addToQueue();
 }
 
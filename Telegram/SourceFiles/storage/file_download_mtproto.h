@@ -46,7 +46,12 @@ private:
 	void startLoading() override;
 	void cancelHook() override;
 
+	bool resumable() const override;
+	void skipResumedParts();
+
 	bool readyToRequest() const override;
+	bool striped() const override;
+	Storage::DownloadClass downloadClass() const override;
 	int takeNextRequestOffset() override;
 	bool feedPart(int offset, const QByteArray &bytes) override;
 	void cancelOnFail() override;
@@ -13,7 +13,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace {
 
-constexpr auto kMaxWebFileQueries = 8;
+constexpr auto kMaxWebFileQueries = 32;
+constexpr auto kMaxWebFileQueriesPerHost = 6;
+constexpr auto kMaxCachedResponseSize = 512 * 1024;
+constexpr auto kMaxCachedResponsesSize = 8 * 1024 * 1024;
 constexpr auto kMaxHttpRedirects = 5;
 constexpr auto kResetDownloadPrioritiesTimeout = crl::time(200);
 
@@ -71,12 +74,18 @@ private:
 	};
 	struct Sent {
 		QString url;
+		QString original;
+		QString host;
 		not_null<QNetworkReply*> reply;
 		QByteArray data;
 		int64 ready = 0;
 		int64 total = 0;
 		int redirectsLeft = kMaxHttpRedirects;
 	};
+	struct Cached {
+		QString url;
+		QByteArray data;
+	};
 
 	// Constructor.
 	void handleNetworkErrors();
@@ -86,6 +95,10 @@ private:
 	void remove(int id);
 	void resetGeneration();
 	void checkSendNext();
+	bool sendFirstAvailable(std::deque<Enqueued> &queue);
+	[[nodiscard]] bool hostAvailable(const Enqueued &entry) const;
+	[[nodiscard]] bool sendCached(const Enqueued &entry);
+	void cacheResponse(const QString &url, const QByteArray &data);
 	void send(const Enqueued &entry);
 	[[nodiscard]] not_null<QNetworkReply*> send(int id, const QString &url);
 	[[nodiscard]] Sent *findSent(int id, not_null<QNetworkReply*> reply);
@@ -129,6 +142,9 @@ private:
 	std::deque<Enqueued> _queue;
 	std::deque<Enqueued> _previousGeneration;
 	base::flat_map<int, Sent> _sent;
+	base::flat_map<QString, int> _sentByHost;
+	std::deque<Cached> _cached;
+	int _cachedSize = 0;
 	std::vector<QPointer<QNetworkReply>> _repliesBeingDeleted;
 
 };
@@ -209,6 +225,9 @@ void WebLoadManager::enqueue(int id, const QString &url) {
 	_previousGeneration.erase(
 		ranges::remove(_previousGeneration, id, &Enqueued::id),
 		end(_previousGeneration));
+	if (sendCached(Enqueued{ id, url })) {
+		return;
+	}
 	_queue.push_back(Enqueued{ id, url });
 	if (!_resetGenerationTimer.isActive()) {
 		_resetGenerationTimer.callOnce(kResetDownloadPrioritiesTimeout);
@@ -236,25 +255,74 @@ void WebLoadManager::resetGeneration() {
 }
 
 void WebLoadManager::checkSendNext() {
-	if (_sent.size() >= kMaxWebFileQueries
-		|| (_queue.empty() && _previousGeneration.empty())) {
-		return;
+	// Many requests to one host (like inline bot results) don't take
+	// all the slots, the rest hosts are sent in parallel with them.
+	while (_sent.size() < kMaxWebFileQueries) {
+		if (!sendFirstAvailable(_queue)
+			&& !sendFirstAvailable(_previousGeneration)) {
+			return;
+		}
+	}
+}
+
+bool WebLoadManager::sendFirstAvailable(std::deque<Enqueued> &queue) {
+	const auto i = ranges::find_if(queue, [&](const Enqueued &entry) {
+		return hostAvailable(entry);
+	});
+	if (i == end(queue)) {
+		return false;
 	}
-	const auto entry = _queue.empty()
-		? _previousGeneration.front()
-		: _queue.front();
-	(_queue.empty() ? _previousGeneration : _queue).pop_front();
+	const auto entry = *i;
+	queue.erase(i);
 	send(entry);
+	return true;
+}
+
+bool WebLoadManager::hostAvailable(const Enqueued &entry) const {
+	const auto i = _sentByHost.find(QUrl(entry.url).host());
+	return (i == end(_sentByHost)) || (i->second < kMaxWebFileQueriesPerHost);
+}
+
+bool WebLoadManager::sendCached(const Enqueued &entry) {
+	const auto i = ranges::find(_cached, entry.url, &Cached::url);
+	if (i == end(_cached)) {
+		return false;
+	}
+	auto cached = std::move(*i);
+	_cached.erase(i);
+	queueFinishedUpdate(entry.id, cached.data);
+	_cached.push_back(std::move(cached));
+	return true;
+}
+
+void WebLoadManager::cacheResponse(
+		const QString &url,
+		const QByteArray &data) {
+	if (data.isEmpty() || data.size() > kMaxCachedResponseSize) {
+		return;
+	}
+	_cached.push_back({ url, data });
+	_cachedSize += data.size();
+	while (_cachedSize > kMaxCachedResponsesSize) {
+		_cachedSize -= _cached.front().data.size();
+		_cached.pop_front();
+	}
 }
 
 void WebLoadManager::send(const Enqueued &entry) {
 	const auto id = entry.id;
 	const auto url = entry.url;
-	_sent.emplace(id, Sent{ url, send(id, url) });
+	const auto host = QUrl(url).host();
+	++_sentByHost[host];
+	_sent.emplace(id, Sent{ url, url, host, send(id, url) });
 }
 
 void WebLoadManager::removeSent(int id) {
 	if (const auto i = _sent.find(id); i != end(_sent)) {
+		const auto j = _sentByHost.find(i->second.host);
+		if (j != end(_sentByHost) && !--j->second) {
+			_sentByHost.erase(j);
+		}
 		deleteDeferred(i->second.reply);
 		_sent.erase(i);
 		checkSendNext();
@@ -262,7 +330,9 @@ void WebLoadManager::removeSent(int id) {
 }
 
 not_null<QNetworkReply*> WebLoadManager::send(int id, const QString &url) {
-	const auto result = _network.get(QNetworkRequest(url));
+	auto request = QNetworkRequest(url);
+	request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+	const auto result = _network.get(request);
 	const auto handleProgress = [=](qint64 ready, qint64 total) {
 		progress(id, result, ready, total);
 	};
@@ -383,6 +453,7 @@ void WebLoadManager::deleteDeferred(not_null<QNetworkReply*> reply) {
 void WebLoadManager::finished(int id, not_null<QNetworkReply*> reply) {
 	if (const auto sent = findSent(id, reply)) {
 		const auto data = base::take(sent->data);
+		cacheResponse(sent->original, data);
 		removeSent(id);
 		queueFinishedUpdate(id, data);
 	}
@@ -398,6 +469,9 @@ void WebLoadManager::clear() {
 			delete reply;
 		}
 	}
+	_sentByHost.clear();
+	_cached.clear();
+	_cachedSize = 0;
 }
 
 void WebLoadManager::queueProgressUpdate(int id, int64 ready, int64 total) {
@@ -43,8 +43,21 @@ constexpr auto kUploadRequestInterval = crl::time(500);
 // How much time without upload causes additional session kill.
 constexpr auto kKillSessionTimeout = 15 * crl::time(000);
 
+// How many files may have parts in flight at the same time.
+constexpr auto kMaxFilesInFlight = 4;
+
+// Voice messages recorded right now are sent in small parts,
+// so that not much is left to upload when the recording stops.
+constexpr auto kStreamedPartSize = kDocumentUploadPartSize0;
+
 } // namespace
 
+struct Uploader::Streamed {
+	QByteArray data;
+	HashMd5 md5Hash;
+	int32 sentParts = 0;
+};
+
 struct Uploader::File {
 	File(const SendMediaReady &media);
 	File(const std::shared_ptr<FileLoadResult> &file);
@@ -62,7 +75,18 @@ struct Uploader::File {
 	uint64 thumbId() const;
 	const QString &filename() const;
 
+	PeerId peer() const;
+	const SendingAlbum *album() const;
+
+	UploadFileParts &parts();
+	uint64 partsOfId() const;
+	bool hasPartsToSend();
+	int64 remainingSize();
+
 	HashMd5 md5Hash;
+	bool started = false;
+	int32 requestsInFlight = 0;
+	int32 docRequestsInFlight = 0;
 
 	std::unique_ptr<QFile> docFile;
 	int32 docSentParts = 0;
@@ -139,6 +163,44 @@ const QString &Uploader::File::filename() const {
 	return file ? file->filename : media.filename;
 }
 
+PeerId Uploader::File::peer() const {
+	return file ? file->to.peer : media.peer;
+}
+
+const SendingAlbum *Uploader::File::album() const {
+	return file ? file->album.get() : nullptr;
+}
+
+UploadFileParts &Uploader::File::parts() {
+	return file
+		? ((type() == SendMediaType::Photo
+			|| type() == SendMediaType::Secure)
+			? file->fileparts
+			: file->thumbparts)
+		: media.parts;
+}
+
+uint64 Uploader::File::partsOfId() const {
+	return file
+		? ((type() == SendMediaType::Photo
+			|| type() == SendMediaType::Secure)
+			? file->id
+			: file->thumbId)
+		: media.thumbId;
+}
+
+bool Uploader::File::hasPartsToSend() {
+	return !parts().isEmpty() || (docSentParts < docPartsCount);
+}
+
+int64 Uploader::File::remainingSize() {
+	auto result = int64(docPartsCount - docSentParts) * docPartSize;
+	for (const auto &part : parts()) {
+		result += part.size();
+	}
+	return result;
+}
+
 Uploader::Uploader(not_null<ApiWrap*> api)
 : _api(api) {
 	nextTimer.setSingleShot(true);
@@ -206,12 +268,125 @@ void Uploader::upload(
 			document->setLocation(FileLocation(file->filepath));
 		}
 	}
-	queue.emplace(msgId, File(file));
+	const auto i = queue.emplace(msgId, File(file)).first;
+	adoptStreamed(msgId, i->second);
 	sendNext();
 }
 
-void Uploader::currentFailed() {
-	auto j = queue.find(uploadingId);
+uint64 Uploader::startStreamed() {
+	auto id = rand_value<uint64>();
+	while (!id || _streamed.find(id) != _streamed.end()) {
+		id = rand_value<uint64>();
+	}
+	_streamed.emplace(id, Streamed());
+	if (stopSessionsTimer.isActive()) {
+		stopSessionsTimer.stop();
+	}
+	return id;
+}
+
+void Uploader::feedStreamed(uint64 id, const QByteArray &bytes) {
+	const auto i = _streamed.find(id);
+	if (i == _streamed.end()) {
+		return;
+	}
+	i->second.data.append(bytes);
+	sendStreamedParts(id, i->second);
+}
+
+void Uploader::cancelStreamed(uint64 id) {
+	if (_streamed.erase(id)) {
+		cancelStreamedRequests(id);
+		sendNext();
+	}
+}
+
+void Uploader::cancelStreamedRequests(uint64 id) {
+	for (auto i = requestsSent.begin(); i != requestsSent.end();) {
+		if (i->second.streamedId == id) {
+			MTP::cancel(i->first);
+			sentSize -= i->second.size;
+			sentSizes[i->second.dc] -= i->second.size;
+			i = requestsSent.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void Uploader::sendStreamedParts(uint64 id, Streamed &streamed) {
+	// Only full parts are sent, the last one is sent with the file.
+	// Big files need the parts count in each part, so stop before that.
+	while (true) {
+		const auto offset = streamed.sentParts * kStreamedPartSize;
+		if (streamed.data.size() < offset + kStreamedPartSize
+			|| offset + kStreamedPartSize > kUseBigFilesFrom) {
+			return;
+		}
+		const auto bytes = QByteArray::fromRawData(
+			streamed.data.constData() + offset,
+			kStreamedPartSize);
+		streamed.md5Hash.feed(bytes.constData(), bytes.size());
+
+		const auto todc = chooseSession();
+		const auto requestId = MTP::send(
+			MTPupload_SaveFilePart(
+				MTP_long(id),
+				MTP_int(streamed.sentParts),
+				MTP_bytes(bytes)),
+			rpcDone(&Uploader::partLoaded),
+			rpcFail(&Uploader::partFailed),
+			MTP::uploadDcId(todc));
+		auto request = Request{ FullMsgId(), kStreamedPartSize, todc, true };
+		request.streamedId = id;
+		requestsSent.emplace(requestId, request);
+		sentSize += kStreamedPartSize;
+		sentSizes[todc] += kStreamedPartSize;
+
+		++streamed.sentParts;
+	}
+}
+
+void Uploader::adoptStreamed(const FullMsgId &fullId, File &file) {
+	const auto i = _streamed.find(file.id());
+	if (i == _streamed.end()) {
+		return;
+	}
+	const auto id = i->first;
+	const auto streamed = std::move(i->second);
+	_streamed.erase(i);
+
+	const auto &content = file.file->content;
+	const auto sent = streamed.sentParts * kStreamedPartSize;
+	const auto matches = (content.size() >= sent)
+		&& !memcmp(content.constData(), streamed.data.constData(), sent);
+	if (matches
+		&& file.docSize <= kUseBigFilesFrom
+		&& file.setPartSize(kStreamedPartSize)) {
+		file.docSentParts = streamed.sentParts;
+		file.md5Hash = streamed.md5Hash;
+		for (auto &[requestId, request] : requestsSent) {
+			if (request.streamedId == id) {
+				request.fullId = fullId;
+				request.streamedId = 0;
+				++file.docRequestsInFlight;
+			}
+		}
+		file.started = (file.docRequestsInFlight > 0);
+		DEBUG_LOG(("Upload Info: %1 of %2 voice parts sent while recording."
+			).arg(file.docSentParts
+			).arg(file.docPartsCount));
+	} else {
+		// The whole file is uploaded with the same id again,
+		// already sent parts are simply overwritten on the server.
+		LOG(("Upload Error: streamed voice data mismatch, reuploading."));
+		cancelStreamedRequests(id);
+		file.setDocSize(file.docSize);
+	}
+}
+
+void Uploader::failed(const FullMsgId &fullId) {
+	auto j = queue.find(fullId);
 	if (j != queue.end()) {
 		if (j->second.type() == SendMediaType::Photo) {
 			_photoFailed.fire_copy(j->first);
@@ -226,34 +401,91 @@ void Uploader::currentFailed() {
 		} else if (j->second.type() == SendMediaType::Secure) {
 			_secureFailed.fire_copy(j->first);
 		} else {
-			Unexpected("Type in Uploader::currentFailed.");
+			Unexpected("Type in Uploader::failed.");
 		}
 		queue.erase(j);
 	}
 
-	requestsSent.clear();
-	docRequestsSent.clear();
-	dcMap.clear();
-	uploadingId = FullMsgId();
-	sentSize = 0;
-	for (int i = 0; i < cNetUploadSessionsCount(); ++i) {
-		sentSizes[i] = 0;
+	for (auto i = requestsSent.begin(); i != requestsSent.end();) {
+		if (i->second.fullId == fullId) {
+			MTP::cancel(i->first);
+			sentSize -= i->second.size;
+			sentSizes[i->second.dc] -= i->second.size;
+			i = requestsSent.erase(i);
+		} else {
+			++i;
+		}
 	}
 
 	sendNext();
 }
 
+int Uploader::chooseSession() const {
+	auto result = 0;
+	for (auto dc = 1; dc != cNetUploadSessionsCount(); ++dc) {
+		if (sentSizes[dc] < sentSizes[result]) {
+			result = dc;
+		}
+	}
+	return result;
+}
+
 void Uploader::stopSessions() {
 	for (int i = 0; i < cNetUploadSessionsCount(); ++i) {
 		MTP::stopSession(MTP::uploadDcId(i));
 	}
 }
 
+base::flat_set<FullMsgId> Uploader::currentFiles() const {
+	// Messages of one history must be sent in the order they were created,
+	// so only the first queued file of each history may be uploaded, with
+	// the other files of its album. An album is sent when all are ready.
+	auto result = base::flat_set<FullMsgId>();
+	auto first = base::flat_map<PeerId, const File*>();
+	for (const auto &[fullId, file] : queue) {
+		const auto i = first.find(file.peer());
+		if (i == end(first)) {
+			first.emplace(file.peer(), &file);
+			result.emplace(fullId);
+		} else if (file.album() && file.album() == i->second->album()) {
+			result.emplace(fullId);
+		}
+	}
+	return result;
+}
+
+FullMsgId Uploader::chooseNext(const base::flat_set<FullMsgId> &current) {
+	// Several files are uploaded at once, the one with the least bytes
+	// left goes first, so small files don't wait behind large ones.
+	auto startedCount = 0;
+	for (const auto &[fullId, file] : queue) {
+		if (file.started) {
+			++startedCount;
+		}
+	}
+	const auto canStart = (startedCount < kMaxFilesInFlight);
+	auto result = FullMsgId();
+	auto resultRemaining = int64();
+	for (auto &[fullId, file] : queue) {
+		if ((!file.started && !canStart)
+			|| !file.hasPartsToSend()
+			|| !current.contains(fullId)) {
+			continue;
+		}
+		const auto remaining = file.remainingSize();
+		if (!result.msg || remaining < resultRemaining) {
+			result = fullId;
+			resultRemaining = remaining;
+		}
+	}
+	return result;
+}
+
 void Uploader::sendNext() {
 	if (sentSize >= (cNetUploadSessionsCount() * 512 * 1024) || _pausedId.msg) return;
 
 	bool stopping = stopSessionsTimer.isActive();
-	if (queue.empty()) {
+	if (queue.empty() && _streamed.empty()) {
 		if (!stopping) {
 			stopSessionsTimer.start(kKillSessionTimeout);
 		}
@@ -263,136 +495,152 @@ void Uploader::sendNext() {
 	if (stopping) {
 		stopSessionsTimer.stop();
 	}
-	auto i = uploadingId.msg ? queue.find(uploadingId) : queue.begin();
-	if (!uploadingId.msg) {
-		uploadingId = i->first;
-	} else if (i == queue.end()) {
-		i = queue.begin();
-		uploadingId = i->first;
+	if (queue.empty()) {
+		return;
 	}
-	auto &uploadingData = i->second;
-
-	auto todc = 0;
-	for (auto dc = 1; dc != cNetUploadSessionsCount(); ++dc) {
-		if (sentSizes[dc] < sentSizes[todc]) {
-			todc = dc;
+	const auto current = currentFiles();
+	for (auto &[fullId, file] : queue) {
+		if (!file.requestsInFlight
+			&& !file.docRequestsInFlight
+			&& !file.hasPartsToSend()
+			&& current.contains(fullId)) {
+			const auto id = fullId;
+			finish(id, file);
+			queue.erase(id);
+			sendNext();
+			return;
 		}
 	}
+	const auto fullId = chooseNext(current);
+	const auto i = queue.find(fullId);
+	if (i == queue.end()) {
+		return;
+	}
 
-	auto &parts = uploadingData.file
-		? ((uploadingData.type() == SendMediaType::Photo
-			|| uploadingData.type() == SendMediaType::Secure)
-			? uploadingData.file->fileparts
-			: uploadingData.file->thumbparts)
-		: uploadingData.media.parts;
-	const auto partsOfId = uploadingData.file
-		? ((uploadingData.type() == SendMediaType::Photo
-			|| uploadingData.type() == SendMediaType::Secure)
-			? uploadingData.file->id
-			: uploadingData.file->thumbId)
-		: uploadingData.media.thumbId;
-	if (parts.isEmpty()) {
-		if (uploadingData.docSentParts >= uploadingData.docPartsCount) {
-			if (requestsSent.empty() && docRequestsSent.empty()) {
-				const auto options = uploadingData.file
-					? uploadingData.file->to.options
-					: Api::SendOptions();
-				const auto edit = uploadingData.file &&
-					uploadingData.file->edit;
-				if (uploadingData.type() == SendMediaType::Photo) {
-					auto photoFilename = uploadingData.filename();
-					if (!photoFilename.endsWith(qstr(".jpg"), Qt::CaseInsensitive)) {
-						// Server has some extensions checking for inputMediaUploadedPhoto,
-						// so force the extension to be .jpg anyway. It doesn't matter,
-						// because the filename from inputFile is not used anywhere.
-						photoFilename += qstr(".jpg");
-					}
-					const auto md5 = uploadingData.file
-						? uploadingData.file->filemd5
-						: uploadingData.media.jpeg_md5;
-					const auto file = MTP_inputFile(
-						MTP_long(uploadingData.id()),
-						MTP_int(uploadingData.partsCount),
-						MTP_string(photoFilename),
-						MTP_bytes(md5));
-					_photoReady.fire({ uploadingId, options, file, edit });
-				} else if (uploadingData.type() == SendMediaType::File
-					|| uploadingData.type() == SendMediaType::ThemeFile
-					|| uploadingData.type() == SendMediaType::Audio) {
-					QByteArray docMd5(32, Qt::Uninitialized);
-					hashMd5Hex(uploadingData.md5Hash.result(), docMd5.data());
-
-					const auto file = (uploadingData.docSize > kUseBigFilesFrom)
-						? MTP_inputFileBig(
-							MTP_long(uploadingData.id()),
-							MTP_int(uploadingData.docPartsCount),
-							MTP_string(uploadingData.filename()))
-						: MTP_inputFile(
-							MTP_long(uploadingData.id()),
-							MTP_int(uploadingData.docPartsCount),
-							MTP_string(uploadingData.filename()),
-							MTP_bytes(docMd5));
-					if (uploadingData.partsCount) {
-						const auto thumbFilename = uploadingData.file
-							? uploadingData.file->thumbname
-							: (qsl("thumb.") + uploadingData.media.thumbExt);
-						const auto thumbMd5 = uploadingData.file
-							? uploadingData.file->thumbmd5
-							: uploadingData.media.jpeg_md5;
-						const auto thumb = MTP_inputFile(
-							MTP_long(uploadingData.thumbId()),
-							MTP_int(uploadingData.partsCount),
-							MTP_string(thumbFilename),
-							MTP_bytes(thumbMd5));
-						_thumbDocumentReady.fire({
-							uploadingId,
-							options,
-							file,
-							thumb,
-							edit });
-					} else {
-						_documentReady.fire({
-							uploadingId,
-							options,
-							file,
-							edit });
-					}
-				} else if (uploadingData.type() == SendMediaType::Secure) {
-					_secureReady.fire({
-						uploadingId,
-						uploadingData.id(),
-						uploadingData.partsCount });
-				}
-				queue.erase(uploadingId);
-				uploadingId = FullMsgId();
-				sendNext();
-			}
-			return;
+	sendPart(fullId, i->second, chooseSession());
+}
+
+void Uploader::finish(const FullMsgId &fullId, File &uploadingData) {
+	const auto options = uploadingData.file
+		? uploadingData.file->to.options
+		: Api::SendOptions();
+	const auto edit = uploadingData.file &&
+		uploadingData.file->edit;
+	if (uploadingData.type() == SendMediaType::Photo) {
+		auto photoFilename = uploadingData.filename();
+		if (!photoFilename.endsWith(qstr(".jpg"), Qt::CaseInsensitive)) {
+			// Server has some extensions checking for inputMediaUploadedPhoto,
+			// so force the extension to be .jpg anyway. It doesn't matter,
+			// because the filename from inputFile is not used anywhere.
+			photoFilename += qstr(".jpg");
+		}
+		const auto md5 = uploadingData.file
+			? uploadingData.file->filemd5
+			: uploadingData.media.jpeg_md5;
+		const auto file = MTP_inputFile(
+			MTP_long(uploadingData.id()),
+			MTP_int(uploadingData.partsCount),
+			MTP_string(photoFilename),
+			MTP_bytes(md5));
+		_photoReady.fire({ fullId, options, file, edit });
+	} else if (uploadingData.type() == SendMediaType::File
+		|| uploadingData.type() == SendMediaType::ThemeFile
+		|| uploadingData.type() == SendMediaType::Audio) {
+		QByteArray docMd5(32, Qt::Uninitialized);
+		hashMd5Hex(uploadingData.md5Hash.result(), docMd5.data());
+
+		const auto file = (uploadingData.docSize > kUseBigFilesFrom)
+			? MTP_inputFileBig(
+				MTP_long(uploadingData.id()),
+				MTP_int(uploadingData.docPartsCount),
+				MTP_string(uploadingData.filename()))
+			: MTP_inputFile(
+				MTP_long(uploadingData.id()),
+				MTP_int(uploadingData.docPartsCount),
+				MTP_string(uploadingData.filename()),
+				MTP_bytes(docMd5));
+		if (uploadingData.partsCount) {
+			const auto thumbFilename = uploadingData.file
+				? uploadingData.file->thumbname
+				: (qsl("thumb.") + uploadingData.media.thumbExt);
+			const auto thumbMd5 = uploadingData.file
+				? uploadingData.file->thumbmd5
+				: uploadingData.media.jpeg_md5;
+			const auto thumb = MTP_inputFile(
+				MTP_long(uploadingData.thumbId()),
+				MTP_int(uploadingData.partsCount),
+				MTP_string(thumbFilename),
+				MTP_bytes(thumbMd5));
+			_thumbDocumentReady.fire({
+				fullId,
+				options,
+				file,
+				thumb,
+				edit });
+		} else {
+			_documentReady.fire({
+				fullId,
+				options,
+				file,
+				edit });
 		}
+	} else if (uploadingData.type() == SendMediaType::Secure) {
+		_secureReady.fire({
+			fullId,
+			uploadingData.id(),
+			uploadingData.partsCount });
+	}
+}
+
+void Uploader::sendPart(
+		const FullMsgId &fullId,
+		File &uploadingData,
+		int todc) {
+	uploadingData.started = true;
 
+	auto &parts = uploadingData.parts();
+	if (parts.isEmpty()) {
 		auto &content = uploadingData.file
 			? uploadingData.file->content
 			: uploadingData.media.data;
+		const auto offset = uploadingData.docSentParts
+			* uploadingData.docPartSize;
+		const auto last = (uploadingData.docSentParts + 1
+			== uploadingData.docPartsCount);
 		QByteArray toSend;
 		if (content.isEmpty()) {
+			// Parts are read from disk only when they're sent,
+			// so just one part of the file is held in memory.
 			if (!uploadingData.docFile) {
 				const auto filepath = uploadingData.file
 					? uploadingData.file->filepath
 					: uploadingData.media.file;
 				uploadingData.docFile = std::make_unique<QFile>(filepath);
 				if (!uploadingData.docFile->open(QIODevice::ReadOnly)) {
-					currentFailed();
+					failed(fullId);
 					return;
 				}
 			}
+			if (!uploadingData.docFile->seek(offset)) {
+				failed(fullId);
+				return;
+			}
 			toSend = uploadingData.docFile->read(uploadingData.docPartSize);
+			if (last) {
+				uploadingData.docFile = nullptr;
+			}
 			if (uploadingData.docSize <= kUseBigFilesFrom) {
 				uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
 			}
 		} else {
-			const auto offset = uploadingData.docSentParts
-				* uploadingData.docPartSize;
-			toSend = content.mid(offset, uploadingData.docPartSize);
+			// The part is copied to the request once, when serialized.
+			toSend = (offset < content.size())
+				? QByteArray::fromRawData(
+					content.constData() + offset,
+					std::min(
+						uploadingData.docPartSize,
+						content.size() - offset))
+				: QByteArray();
 			if ((uploadingData.type() == SendMediaType::File
 				|| uploadingData.type() == SendMediaType::ThemeFile
 				|| uploadingData.type() == SendMediaType::Audio)
@@ -401,9 +649,8 @@ void Uploader::sendNext() {
 			}
 		}
 		if ((toSend.size() > uploadingData.docPartSize)
-			|| ((toSend.size() < uploadingData.docPartSize
-				&& uploadingData.docSentParts + 1 != uploadingData.docPartsCount))) {
-			currentFailed();
+			|| (toSend.size() < uploadingData.docPartSize && !last)) {
+			failed(fullId);
 			return;
 		}
 		mtpRequestId requestId;
@@ -427,37 +674,46 @@ void Uploader::sendNext() {
 				rpcFail(&Uploader::partFailed),
 				MTP::uploadDcId(todc));
 		}
-		docRequestsSent.emplace(requestId, uploadingData.docSentParts);
-		dcMap.emplace(requestId, todc);
+		requestsSent.emplace(requestId, Request{
+			fullId,
+			uploadingData.docPartSize,
+			todc,
+			true });
 		sentSize += uploadingData.docPartSize;
 		sentSizes[todc] += uploadingData.docPartSize;
 
 		uploadingData.docSentParts++;
+		uploadingData.docRequestsInFlight++;
 	} else {
 		auto part = parts.begin();
 
 		const auto requestId = MTP::send(
 			MTPupload_SaveFilePart(
-				MTP_long(partsOfId),
+				MTP_long(uploadingData.partsOfId()),
 				MTP_int(part.key()),
 				MTP_bytes(part.value())),
 			rpcDone(&Uploader::partLoaded),
 			rpcFail(&Uploader::partFailed),
 			MTP::uploadDcId(todc));
-		requestsSent.emplace(requestId, part.value());
-		dcMap.emplace(requestId, todc);
+		requestsSent.emplace(requestId, Request{
+			fullId,
+			int32(part.value().size()),
+			todc,
+			false });
 		sentSize += part.value().size();
 		sentSizes[todc] += part.value().size();
 
 		parts.erase(part);
+		uploadingData.requestsInFlight++;
 	}
 	nextTimer.start(crl::time(cNetUploadRequestInterval()));
 }
 
 void Uploader::cancel(const FullMsgId &msgId) {
 	uploaded.erase(msgId);
-	if (uploadingId == msgId) {
-		currentFailed();
+	const auto i = queue.find(msgId);
+	if (i != queue.end() && i->second.started) {
+		failed(msgId);
 	} else {
 		queue.erase(msgId);
 	}
@@ -478,15 +734,11 @@ void Uploader::confirm(const FullMsgId &msgId) {
 void Uploader::clear() {
 	uploaded.clear();
 	queue.clear();
+	_streamed.clear();
 	for (const auto &requestData : requestsSent) {
 		MTP::cancel(requestData.first);
 	}
 	requestsSent.clear();
-	for (const auto &requestData : docRequestsSent) {
-		MTP::cancel(requestData.first);
-	}
-	docRequestsSent.clear();
-	dcMap.clear();
 	sentSize = 0;
 	for (int i = 0; i < cNetUploadSessionsCount(); ++i) {
 		MTP::stopSession(MTP::uploadDcId(i));
@@ -496,64 +748,59 @@ void Uploader::clear() {
 }
 
 void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
-	auto j = docRequestsSent.end();
-	auto i = requestsSent.find(requestId);
-	if (i == requestsSent.cend()) {
-		j = docRequestsSent.find(requestId);
-	}
-	if (i != requestsSent.cend() || j != docRequestsSent.cend()) {
+	const auto i = requestsSent.find(requestId);
+	if (i != requestsSent.end()) {
+		const auto request = i->second;
 		if (mtpIsFalse(result)) { // failed to upload current file
-			currentFailed();
+			if (request.streamedId) {
+				cancelStreamed(request.streamedId);
+			} else {
+				failed(request.fullId);
+			}
+			return;
+		}
+		requestsSent.erase(i);
+		sentSize -= request.size;
+		sentSizes[request.dc] -= request.size;
+
+		if (request.streamedId) {
+			sendNext();
 			return;
+		}
+		auto k = queue.find(request.fullId);
+		Assert(k != queue.cend());
+		auto &[fullId, file] = *k;
+		if (request.docPart) {
+			file.docRequestsInFlight--;
 		} else {
-			auto dcIt = dcMap.find(requestId);
-			if (dcIt == dcMap.cend()) { // must not happen
-				currentFailed();
-				return;
-			}
-			auto dc = dcIt->second;
-			dcMap.erase(dcIt);
-
-			int32 sentPartSize = 0;
-			auto k = queue.find(uploadingId);
-			Assert(k != queue.cend());
-			auto &[fullId, file] = *k;
-			if (i != requestsSent.cend()) {
-				sentPartSize = i->second.size();
-				requestsSent.erase(i);
-			} else {
-				sentPartSize = file.docPartSize;
-				docRequestsSent.erase(j);
+			file.requestsInFlight--;
+		}
+		if (file.type() == SendMediaType::Photo) {
+			file.fileSentSize += request.size;
+			const auto photo = Auth().data().photo(file.id());
+			if (photo->uploading() && file.file) {
+				photo->uploadingData->size = file.file->partssize;
+				photo->uploadingData->offset = file.fileSentSize;
 			}
-			sentSize -= sentPartSize;
-			sentSizes[dc] -= sentPartSize;
-			if (file.type() == SendMediaType::Photo) {
-				file.fileSentSize += sentPartSize;
-				const auto photo = Auth().data().photo(file.id());
-				if (photo->uploading() && file.file) {
-					photo->uploadingData->size = file.file->partssize;
-					photo->uploadingData->offset = file.fileSentSize;
-				}
-				_photoProgress.fire_copy(fullId);
-			} else if (file.type() == SendMediaType::File
-				|| file.type() == SendMediaType::ThemeFile
-				|| file.type() == SendMediaType::Audio) {
-				const auto document = Auth().data().document(file.id());
-				if (document->uploading()) {
-					const auto doneParts = file.docSentParts
-						- int(docRequestsSent.size());
-					document->uploadingData->offset = std::min(
-						document->uploadingData->size,
-						doneParts * file.docPartSize);
-				}
-				_documentProgress.fire_copy(fullId);
-			} else if (file.type() == SendMediaType::Secure) {
-				file.fileSentSize += sentPartSize;
-				_secureProgress.fire_copy({
-					fullId,
-					file.fileSentSize,
-					file.file->partssize });
+			_photoProgress.fire_copy(fullId);
+		} else if (file.type() == SendMediaType::File
+			|| file.type() == SendMediaType::ThemeFile
+			|| file.type() == SendMediaType::Audio) {
+			const auto document = Auth().data().document(file.id());
+			if (document->uploading()) {
+				const auto doneParts = file.docSentParts
+					- file.docRequestsInFlight;
+				document->uploadingData->offset = std::min(
+					document->uploadingData->size,
+					doneParts * file.docPartSize);
 			}
+			_documentProgress.fire_copy(fullId);
+		} else if (file.type() == SendMediaType::Secure) {
+			file.fileSentSize += request.size;
+			_secureProgress.fire_copy({
+				fullId,
+				file.fileSentSize,
+				file.file->partssize });
 		}
 	}
 
@@ -563,10 +810,16 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 bool Uploader::partFailed(const RPCError &error, mtpRequestId requestId) {
 	if (MTP::isDefaultHandledError(error)) return false;
 
-	// failed to upload current file
-	if ((requestsSent.find(requestId) != requestsSent.cend())
-		|| (docRequestsSent.find(requestId) != docRequestsSent.cend())) {
-		currentFailed();
+	// failed to upload the file of this part
+	const auto i = requestsSent.find(requestId);
+	if (i != requestsSent.end()) {
+		if (const auto streamedId = i->second.streamedId) {
+			// The file will be uploaded from scratch when it is sent.
+			cancelStreamed(streamedId);
+		} else {
+			failed(i->second.fullId);
+		}
+		return true;
 	}
 	sendNext();
 	return true;
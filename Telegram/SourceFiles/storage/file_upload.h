@@ -67,6 +67,12 @@ public:
 		const FullMsgId &msgId,
 		const std::shared_ptr<FileLoadResult> &file);
 
+	// Voice messages are uploaded part by part while they're recorded.
+	// The returned id should be used as the document id when sending.
+	[[nodiscard]] uint64 startStreamed();
+	void feedStreamed(uint64 id, const QByteArray &bytes);
+	void cancelStreamed(uint64 id);
+
 	void cancel(const FullMsgId &msgId);
 	void pause(const FullMsgId &msgId);
 	void confirm(const FullMsgId &msgId);
@@ -111,23 +117,38 @@ public slots:
 
 private:
 	struct File;
+	struct Streamed;
+	struct Request {
+		FullMsgId fullId;
+		int32 size = 0;
+		int dc = 0;
+		bool docPart = false;
+		uint64 streamedId = 0;
+	};
 
 	void partLoaded(const MTPBool &result, mtpRequestId requestId);
 	bool partFailed(const RPCError &err, mtpRequestId requestId);
 
-	void currentFailed();
+	[[nodiscard]] base::flat_set<FullMsgId> currentFiles() const;
+	[[nodiscard]] FullMsgId chooseNext(
+		const base::flat_set<FullMsgId> &current);
+	[[nodiscard]] int chooseSession() const;
+	void sendStreamedParts(uint64 id, Streamed &streamed);
+	void adoptStreamed(const FullMsgId &fullId, File &file);
+	void cancelStreamedRequests(uint64 id);
+	void sendPart(const FullMsgId &fullId, File &file, int todc);
+	void finish(const FullMsgId &fullId, File &file);
+	void failed(const FullMsgId &fullId);
 
 	not_null<ApiWrap*> _api;
-	base::flat_map<mtpRequestId, QByteArray> requestsSent;
-	base::flat_map<mtpRequestId, int32> docRequestsSent;
-	base::flat_map<mtpRequestId, int32> dcMap;
+	base::flat_map<mtpRequestId, Request> requestsSent;
 	uint32 sentSize = 0;
 	uint32 sentSizes[MTP::kUploadSessionsCountMax] = { 0 };
 
-	FullMsgId uploadingId;
 	FullMsgId _pausedId;
 	std::map<FullMsgId, File> queue;
 	std::map<FullMsgId, File> uploaded;
+	std::map<uint64, Streamed> _streamed;
 	QTimer nextTimer, stopSessionsTimer;
 
 	rpl::event_stream<UploadedPhoto> _photoReady;
@@ -22,6 +22,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_keys.h"
 #include "storage/file_download.h"
 #include "storage/storage_media_prepare.h"
+#include "ui/image/image.h"
 #include "window/themes/window_theme_preview.h"
 #include "mainwidget.h"
 #include "mainwindow.h"
@@ -66,11 +67,10 @@ PreparedFileThumbnail PrepareFileThumbnail(QImage &&original) {
 			: kThumbnailSize;
 	};
 	result.image = scaled
-		? original.scaled(
+		? Images::Downscale(
+			std::move(original),
 			scaledWidth(),
-			scaledHeight(),
-			Qt::IgnoreAspectRatio,
-			Qt::SmoothTransformation)
+			scaledHeight())
 		: std::move(original);
 	result.mtpSize = MTP_photoSize(
 		MTP_string(),
@@ -192,11 +192,7 @@ SendMediaReady PreparePeerPhoto(PeerId peerId, QImage &&image) {
 	image.save(&jpegBuffer, "JPG", 87);
 
 	const auto scaled = [&](int size) {
-		return image.scaled(
-			size,
-			size,
-			Qt::KeepAspectRatio,
-			Qt::SmoothTransformation);
+		return Images::Downscale(image, size, size, Qt::KeepAspectRatio);
 	};
 	const auto push = [&](const char *type, QImage &&image) {
 		photoSizes.push_back(MTP_photoSize(
@@ -241,7 +237,8 @@ SendMediaReady PreparePeerPhoto(PeerId peerId, QImage &&image) {
 		0);
 }
 
-TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
+TaskQueue::TaskQueue(crl::time stopTimeoutMs, int workersCount)
+: _workersCount(std::max(workersCount, 1)) {
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -253,95 +250,141 @@ TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
 TaskId TaskQueue::addTask(std::unique_ptr<Task> &&task) {
 	const auto result = task->id();
 	{
-		QMutexLocker lock(&_tasksToProcessMutex);
-		_tasksToProcess.push_back(std::move(task));
+		QMutexLocker lock(&_tasksMutex);
+		const auto inOrder = task->finishInOrder();
+		const auto group = task->finishGroup();
+		_tasks.push_back({
+			result,
+			std::move(task),
+			TaskState::Waiting,
+			inOrder,
+			group });
 	}
 
-	wakeThread();
+	wakeThreads();
 
 	return result;
 }
 
 void TaskQueue::addTasks(std::vector<std::unique_ptr<Task>> &&tasks) {
 	{
-		QMutexLocker lock(&_tasksToProcessMutex);
+		QMutexLocker lock(&_tasksMutex);
 		for (auto &task : tasks) {
-			_tasksToProcess.push_back(std::move(task));
+			const auto id = task->id();
+			const auto inOrder = task->finishInOrder();
+			const auto group = task->finishGroup();
+			_tasks.push_back({
+				id,
+				std::move(task),
+				TaskState::Waiting,
+				inOrder,
+				group });
 		}
 	}
 
-	wakeThread();
+	wakeThreads();
 }
 
-void TaskQueue::wakeThread() {
-	if (!_thread) {
-		_thread = new QThread();
+void TaskQueue::wakeThreads() {
+	if (_threads.empty()) {
+		for (auto i = 0; i != _workersCount; ++i) {
+			const auto thread = new QThread();
+			const auto worker = new TaskQueueWorker(this);
+			worker->moveToThread(thread);
 
-		_worker = new TaskQueueWorker(this);
-		_worker->moveToThread(_thread);
+			connect(this, SIGNAL(taskAdded()), worker, SLOT(onTaskAdded()));
+			connect(worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
 
-		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
-		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
-
-		_thread->start();
+			thread->start();
+			_threads.push_back(thread);
+			_workers.push_back(worker);
+		}
 	}
 	if (_stopTimer) _stopTimer->stop();
 	emit taskAdded();
 }
 
 void TaskQueue::cancelTask(TaskId id) {
-	const auto removeFrom = [&](std::deque<std::unique_ptr<Task>> &queue) {
-		const auto proj = [](const std::unique_ptr<Task> &task) {
-			return task->id();
-		};
-		auto i = ranges::find(queue, id, proj);
-		if (i != queue.end()) {
-			queue.erase(i);
-		}
-	};
+	// If the task is being processed right now the worker destroys it.
+	auto finishNext = false;
 	{
-		QMutexLocker lock(&_tasksToProcessMutex);
-		removeFrom(_tasksToProcess);
-		if (_taskInProcessId == id) {
-			_taskInProcessId = TaskId();
+		QMutexLocker lock(&_tasksMutex);
+		const auto i = ranges::find(_tasks, id, &Entry::id);
+		if (i == _tasks.end()) {
+			return;
+		}
+		_tasks.erase(i);
+		for (auto j = begin(_tasks); j != end(_tasks); ++j) {
+			if (j->state == TaskState::Processed && canFinish(j)) {
+				finishNext = true;
+				break;
+			}
 		}
 	}
-	QMutexLocker lock(&_tasksToFinishMutex);
-	removeFrom(_tasksToFinish);
+	if (finishNext) {
+		crl::on_main(this, [=] {
+			onTaskProcessed();
+		});
+	}
+}
+
+bool TaskQueue::canFinish(std::deque<Entry>::const_iterator i) const {
+	if (i == begin(_tasks) || !i->inOrder) {
+		return true;
+	} else if (!i->group) {
+		return false;
+	}
+	// All the tasks before this one must be from the same group.
+	return std::all_of(begin(_tasks), i, [&](const Entry &entry) {
+		return (entry.group == i->group);
+	});
 }
 
 void TaskQueue::onTaskProcessed() {
 	do {
 		auto task = std::unique_ptr<Task>();
 		{
-			QMutexLocker lock(&_tasksToFinishMutex);
-			if (_tasksToFinish.empty()) break;
-			task = std::move(_tasksToFinish.front());
-			_tasksToFinish.pop_front();
+			QMutexLocker lock(&_tasksMutex);
+			for (auto i = begin(_tasks); i != end(_tasks); ++i) {
+				if (i->state == TaskState::Processed && canFinish(i)) {
+					task = std::move(i->task);
+					_tasks.erase(i);
+					break;
+				}
+			}
+		}
+		if (!task) {
+			break;
 		}
 		task->finish();
 	} while (true);
 
 	if (_stopTimer) {
-		QMutexLocker lock(&_tasksToProcessMutex);
-		if (_tasksToProcess.empty() && !_taskInProcessId) {
+		QMutexLocker lock(&_tasksMutex);
+		if (_tasks.empty()) {
 			_stopTimer->start();
 		}
 	}
 }
 
 void TaskQueue::stop() {
-	if (_thread) {
-		_thread->requestInterruption();
-		_thread->quit();
+	if (!_threads.empty()) {
+		for (const auto thread : _threads) {
+			thread->requestInterruption();
+			thread->quit();
+		}
 		DEBUG_LOG(("Waiting for taskThread to finish"));
-		_thread->wait();
-		delete base::take(_worker);
-		delete base::take(_thread);
+		for (const auto thread : _threads) {
+			thread->wait();
+		}
+		for (const auto worker : base::take(_workers)) {
+			delete worker;
+		}
+		for (const auto thread : base::take(_threads)) {
+			delete thread;
+		}
 	}
-	_tasksToProcess.clear();
-	_tasksToFinish.clear();
-	_taskInProcessId = TaskId();
+	_tasks.clear();
 }
 
 TaskQueue::~TaskQueue() {
@@ -350,34 +393,46 @@ TaskQueue::~TaskQueue() {
 }
 
 void TaskQueueWorker::onTaskAdded() {
+	using State = TaskQueue::TaskState;
+
 	if (_inTaskAdded) return;
 	_inTaskAdded = true;
 
+	const auto waiting = [&] {
+		return ranges::find(
+			_queue->_tasks,
+			State::Waiting,
+			&TaskQueue::Entry::state);
+	};
 	bool someTasksLeft = false;
 	do {
 		auto task = std::unique_ptr<Task>();
 		{
-			QMutexLocker lock(&_queue->_tasksToProcessMutex);
-			if (!_queue->_tasksToProcess.empty()) {
-				task = std::move(_queue->_tasksToProcess.front());
-				_queue->_tasksToProcess.pop_front();
-				_queue->_taskInProcessId = task->id();
+			QMutexLocker lock(&_queue->_tasksMutex);
+			const auto i = waiting();
+			if (i != _queue->_tasks.end()) {
+				task = std::move(i->task);
+				i->state = State::Processing;
 			}
 		}
 
+		someTasksLeft = false;
 		if (task) {
 			task->process();
 			bool emitTaskProcessed = false;
 			{
-				QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
-				if (_queue->_taskInProcessId == task->id()) {
-					_queue->_taskInProcessId = TaskId();
-					someTasksLeft = !_queue->_tasksToProcess.empty();
-
-					QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
-					emitTaskProcessed = _queue->_tasksToFinish.empty();
-					_queue->_tasksToFinish.push_back(std::move(task));
+				QMutexLocker lock(&_queue->_tasksMutex);
+				auto &tasks = _queue->_tasks;
+				const auto i = ranges::find(
+					tasks,
+					task->id(),
+					&TaskQueue::Entry::id);
+				if (i != tasks.end()) {
+					i->task = std::move(task);
+					i->state = State::Processed;
+					emitTaskProcessed = _queue->canFinish(i);
 				}
+				someTasksLeft = (waiting() != tasks.end());
 			}
 			if (emitTaskProcessed) {
 				emit taskProcessed();
@@ -498,8 +553,9 @@ FileLoadTask::FileLoadTask(
 	int32 duration,
 	const VoiceWaveform &waveform,
 	const FileLoadTo &to,
-	const TextWithTags &caption)
-: _id(rand_value<uint64>())
+	const TextWithTags &caption,
+	uint64 streamedId)
+: _id(streamedId ? streamedId : rand_value<uint64>())
 , _to(to)
 , _content(voice)
 , _duration(duration)
@@ -851,15 +907,32 @@ void FileLoadTask::process() {
 			} else if (isAnimation) {
 				attributes.push_back(MTP_documentAttributeAnimated());
 			} else if (_type != SendMediaType::File) {
-				auto thumb = (w > 100 || h > 100) ? fullimage.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				// Each smaller size is scaled down from the previous one,
+				// so the full image is downscaled only once.
+				const auto started = crl::now();
+				const auto downscale = [](const QImage &image, int size) {
+					return (image.width() > size || image.height() > size)
+						? Images::Downscale(
+							image,
+							size,
+							size,
+							Qt::KeepAspectRatio)
+						: image;
+				};
+				auto full = downscale(fullimage, 1280);
+				auto medium = downscale(full, 320);
+				auto thumb = downscale(medium, 100);
+				DEBUG_LOG(("File Load: photo %1x%2 downscaled in %3 ms."
+					).arg(w
+					).arg(h
+					).arg(crl::now() - started));
+
 				photoThumbs.emplace('s', thumb);
 				photoSizes.push_back(MTP_photoSize(MTP_string("s"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(thumb.width()), MTP_int(thumb.height()), MTP_int(0)));
 
-				auto medium = (w > 320 || h > 320) ? fullimage.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
 				photoThumbs.emplace('m', medium);
 				photoSizes.push_back(MTP_photoSize(MTP_string("m"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(medium.width()), MTP_int(medium.height()), MTP_int(0)));
 
-				auto full = (w > 1280 || h > 1280) ? fullimage.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
 				photoThumbs.emplace('y', full);
 				photoSizes.push_back(MTP_photoSize(MTP_string("y"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(full.width()), MTP_int(full.height()), MTP_int(0)));
 
@@ -968,6 +1041,13 @@ void FileLoadTask::finish() {
 	}
 }
 
+uint64 FileLoadTask::finishGroup() const {
+	// Album items are sent together in the order of SendingAlbum::items,
+	// so each of them can start uploading as soon as it is prepared. The
+	// files queued before the album still get their messages first.
+	return _album ? _album->groupId : 0;
+}
+
 void FileLoadTask::removeFromAlbum() {
 	if (!_album) {
 		return;
@@ -94,6 +94,18 @@ public:
 	virtual void finish() = 0; // is executed in the same as TaskQueue thread
 	virtual ~Task() = default;
 
+	// If false finish() is called right after process(), without waiting
+	// for the tasks that were added before this one.
+	virtual bool finishInOrder() const {
+		return true;
+	}
+
+	// Tasks of the same non-zero group may finish in any order between
+	// them, but only when all the tasks before them are finished.
+	virtual uint64 finishGroup() const {
+		return 0;
+	}
+
 	TaskId id() const {
 		return static_cast<TaskId>(const_cast<Task*>(this));
 	}
@@ -105,7 +117,8 @@ class TaskQueue : public QObject {
 	Q_OBJECT
 
 public:
-	explicit TaskQueue(crl::time stopTimeoutMs = 0); // <= 0 - never stop worker
+	// stopTimeoutMs <= 0 - never stop workers.
+	explicit TaskQueue(crl::time stopTimeoutMs = 0, int workersCount = 1);
 
 	TaskId addTask(std::unique_ptr<Task> &&task);
 	void addTasks(std::vector<std::unique_ptr<Task>> &&tasks);
@@ -123,14 +136,31 @@ public slots:
 private:
 	friend class TaskQueueWorker;
 
-	void wakeThread();
+	enum class TaskState : uchar {
+		Waiting,
+		Processing,
+		Processed,
+	};
+	struct Entry {
+		TaskId id = TaskId();
+		std::unique_ptr<Task> task; // Empty while processing.
+		TaskState state = TaskState::Waiting;
+		bool inOrder = true;
+		uint64 group = 0;
+	};
+
+	[[nodiscard]] bool canFinish(std::deque<Entry>::const_iterator i) const;
 
-	std::deque<std::unique_ptr<Task>> _tasksToProcess;
-	std::deque<std::unique_ptr<Task>> _tasksToFinish;
-	TaskId _taskInProcessId = TaskId();
-	QMutex _tasksToProcessMutex, _tasksToFinishMutex;
-	QThread *_thread = nullptr;
-	TaskQueueWorker *_worker = nullptr;
+	void wakeThreads();
+
+	// Any idle worker takes the first waiting task, but tasks are finished
+	// in the order they were added, like with a single worker, unless they
+	// don't require it or wait only for the tasks of their own group.
+	std::deque<Entry> _tasks;
+	QMutex _tasksMutex;
+	int _workersCount = 1;
+	std::vector<QThread*> _threads;
+	std::vector<TaskQueueWorker*> _workers;
 	QTimer *_stopTimer = nullptr;
 
 };
@@ -283,7 +313,8 @@ public:
 		int32 duration,
 		const VoiceWaveform &waveform,
 		const FileLoadTo &to,
-		const TextWithTags &caption);
+		const TextWithTags &caption,
+		uint64 streamedId = 0);
 
 	uint64 fileid() const {
 		return _id;
@@ -291,6 +322,7 @@ public:
 
 	void process();
 	void finish();
+	uint64 finishGroup() const override;
 
 private:
 	static bool CheckForSong(
@@ -11,6 +11,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/serialize_common.h"
 #include "storage/storage_encrypted_file.h"
 #include "storage/storage_clear_legacy.h"
+#include "storage/file_download.h"
+#include "core/startup_tracer.h"
 #include "chat_helpers/stickers.h"
 #include "data/data_drafts.h"
 #include "data/data_user.h"
@@ -44,6 +46,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtCore/QSaveFile>
 #include <QtCore/QtEndian>
 #include <QtCore/QDirIterator>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
 
 #ifndef Q_OS_WIN
 #include <unistd.h>
@@ -58,9 +62,11 @@ namespace {
 
 constexpr auto kThemeFileSizeLimit = 5 * 1024 * 1024;
 constexpr auto kFileLoaderQueueStopTimeout = crl::time(5000);
+constexpr auto kFileLoaderWorkersLimit = 4;
 constexpr auto kDefaultStickerInstallDate = TimeId(1);
 constexpr auto kProxyTypeShift = 1024;
 constexpr auto kWriteMapTimeout = crl::time(1000);
+constexpr auto kAsyncWriteDelay = crl::time(500);
 constexpr auto kSavedBackgroundFormat = QImage::Format_ARGB32_Premultiplied;
 
 constexpr auto kWallPaperLegacySerializeTagId = int32(-111);
@@ -74,7 +80,10 @@ constexpr auto kSinglePeerTypeSelf = qint32(4);
 constexpr auto kSinglePeerTypeEmpty = qint32(0);
 
 constexpr auto kStickersVersionTag = quint32(-1);
-constexpr auto kStickersSerializeVersion = 1;
+constexpr auto kStickersSerializeVersionMonolithic = 1;
+constexpr auto kStickersSerializeVersionIndexed = 2;
+constexpr auto kStickersSerializeVersion = 3;
+constexpr auto kStickerSetsReadSlice = 8;
 constexpr auto kMaxSavedStickerSetsCount = 1000;
 
 const auto kThemeNewPathRelativeTag = qstr("special://new_tag");
@@ -113,11 +122,66 @@ bool _userWorking() {
 enum class FileOption {
 	User = (1 << 0),
 	Safe = (1 << 1),
+	Async = (1 << 2),
 };
 using FileOptions = base::flags<FileOption>;
 inline constexpr auto is_flag_type(FileOption) { return true; };
 
+struct FileWriteBlock {
+	QByteArray data;
+	MTP::AuthKeyPtr key;
+	bool encrypt = false;
+};
+
+struct FileWriteJob {
+	QString base;
+	FileOptions options;
+	std::vector<FileWriteBlock> blocks;
+};
+
+// Encrypts and writes files on a separate thread. Jobs are keyed by
+// the file path, a newer job for the same file replaces a pending one.
+class AsyncFileWriter final : public QThread {
+public:
+	AsyncFileWriter();
+
+	void enqueue(FileWriteJob &&job);
+	[[nodiscard]] bool pending(const QString &base);
+
+	// Both wait until the file is not touched by the storage thread.
+	void flush(const QString &base);
+	void cancel(const QString &base);
+	void cancelAll();
+
+	// Writes everything pending and stops the thread.
+	void finish();
+
+protected:
+	void run() override;
+
+private:
+	struct Pending {
+		FileWriteJob job;
+		crl::time when = 0;
+	};
+
+	QMutex _mutex;
+	QWaitCondition _condition;
+	QWaitCondition _written;
+	std::map<QString, Pending> _pending;
+	QString _writing;
+	bool _finishing = false;
+	int _writtenCount = 0;
+	int _coalesced = 0;
+
+};
+
+AsyncFileWriter *_writer = nullptr;
+
 bool keyAlreadyUsed(QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
+	if (_writer && _writer->pending(name)) {
+		return true;
+	}
 	name += '0';
 	if (QFileInfo(name).exists()) {
 		return true;
@@ -164,7 +228,11 @@ void clearKey(const FileKey &key, FileOptions options = FileOption::User | FileO
 
 	QString base = (options & FileOption::User) ? _userBasePath : _basePath, name;
 	name.reserve(base.size() + 0x11);
-	name.append(base).append(toFilePart(key)).append('0');
+	name.append(base).append(toFilePart(key));
+	if (_writer) {
+		_writer->cancel(name);
+	}
+	name.append('0');
 	QFile::remove(name);
 	if (options & FileOption::Safe) {
 		name[name.size() - 1] = '1';
@@ -192,6 +260,8 @@ auto PassKey = MTP::AuthKeyPtr();
 auto LocalKey = MTP::AuthKeyPtr();
 
 void createLocalKey(const QByteArray &pass, QByteArray *salt, MTP::AuthKeyPtr *result) {
+	const auto phase = Core::StartupPhase("Local::createKey");
+
 	auto key = MTP::AuthKey::Data { { gsl::byte{} } };
 	auto iterCount = pass.size() ? LocalEncryptIterCount : LocalEncryptNoPwdIterCount; // dont slow down for no password
 	auto newSalt = QByteArray();
@@ -250,13 +320,82 @@ struct EncryptedDescriptor {
 	}
 };
 
+QByteArray encryptLocal(QByteArray &toEncrypt, const MTP::AuthKeyPtr &key) {
+	// prepare for encryption
+	uint32 size = toEncrypt.size(), fullSize = size;
+	if (fullSize & 0x0F) {
+		fullSize += 0x10 - (fullSize & 0x0F);
+		toEncrypt.resize(fullSize);
+		memset_rand(toEncrypt.data() + size, fullSize - size);
+	}
+	*(uint32*)toEncrypt.data() = size;
+	QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
+	hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
+	MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
+
+	return encrypted;
+}
+
+// May be called from the storage thread, uses only the job data.
+bool writeFileJob(FileWriteJob &job) {
+	QFile plainFile;
+	QSaveFile saveFile;
+	const auto safe = (job.options & FileOption::Safe) != 0;
+	QFileDevice &file = safe ? (QFileDevice&)saveFile : plainFile;
+	if (safe) {
+		saveFile.setFileName(job.base + 's');
+	} else {
+		plainFile.setFileName(job.base + '0');
+	}
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+	file.write(tdfMagic, tdfMagicLen);
+	qint32 version = AppVersion;
+	file.write((const char*)&version, sizeof(version));
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	HashMd5 md5;
+	int32 dataSize = 0;
+	for (auto &block : job.blocks) {
+		const auto data = block.encrypt
+			? encryptLocal(block.data, block.key)
+			: block.data;
+		stream << data;
+		quint32 len = data.isNull() ? 0xffffffff : data.size();
+		if (QSysInfo::ByteOrder != QSysInfo::BigEndian) {
+			len = qbswap(len);
+		}
+		md5.feed(&len, sizeof(len));
+		md5.feed(data.constData(), data.size());
+		dataSize += sizeof(len) + data.size();
+	}
+	stream.setDevice(nullptr);
+
+	md5.feed(&dataSize, sizeof(dataSize));
+	md5.feed(&version, sizeof(version));
+	md5.feed(tdfMagic, tdfMagicLen);
+	file.write((const char*)md5.result(), 0x10);
+
+	if (safe) {
+		if (!saveFile.commit()) {
+			return false;
+		}
+		QFile::remove(job.base + '0');
+		QFile::remove(job.base + '1');
+	} else {
+		plainFile.close();
+	}
+	return true;
+}
+
 struct FileWriteDescriptor {
-	FileWriteDescriptor(const FileKey &key, FileOptions options = FileOption::User | FileOption::Safe)
-	: file((options & FileOption::Safe) ? (QFileDevice&)saveFile : plainFile) {
+	FileWriteDescriptor(const FileKey &key, FileOptions options = FileOption::User | FileOption::Safe | FileOption::Async) {
 		init(toFilePart(key), options);
 	}
-	FileWriteDescriptor(const QString &name, FileOptions options = FileOption::User | FileOption::Safe)
-	: file((options & FileOption::Safe) ? (QFileDevice&)saveFile : plainFile) {
+	FileWriteDescriptor(const QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
 		init(name, options);
 	}
 	void init(const QString &name, FileOptions options) {
@@ -266,95 +405,150 @@ struct FileWriteDescriptor {
 			if (!_working()) return;
 		}
 
-		const auto base = ((options & FileOption::User) ? _userBasePath : _basePath) + name;
-		if (options & FileOption::Safe) {
-			toDelete = base;
-			saveFile.setFileName(base + 's');
-		} else {
-			plainFile.setFileName(base + '0');
-		}
-		if (file.open(QIODevice::WriteOnly)) {
-			file.write(tdfMagic, tdfMagicLen);
-			qint32 version = AppVersion;
-			file.write((const char*)&version, sizeof(version));
-
-			stream.setDevice(&file);
-			stream.setVersion(QDataStream::Qt_5_1);
-		}
+		job.base = ((options & FileOption::User) ? _userBasePath : _basePath) + name;
+		job.options = options;
+		working = true;
 	}
 	bool writeData(const QByteArray &data) {
-		if (!file.isOpen()) return false;
-
-		stream << data;
-		quint32 len = data.isNull() ? 0xffffffff : data.size();
-		if (QSysInfo::ByteOrder != QSysInfo::BigEndian) {
-			len = qbswap(len);
-		}
-		md5.feed(&len, sizeof(len));
-		md5.feed(data.constData(), data.size());
-		dataSize += sizeof(len) + data.size();
+		if (!working) return false;
 
+		job.blocks.push_back({ data });
 		return true;
 	}
 	static QByteArray prepareEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
 		data.finish();
-		QByteArray &toEncrypt(data.data);
+		return encryptLocal(data.data, key);
+	}
+	bool writeEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
+		if (!working) return false;
 
-		// prepare for encryption
-		uint32 size = toEncrypt.size(), fullSize = size;
-		if (fullSize & 0x0F) {
-			fullSize += 0x10 - (fullSize & 0x0F);
-			toEncrypt.resize(fullSize);
-			memset_rand(toEncrypt.data() + size, fullSize - size);
+		// Encryption is done together with the write, maybe in background.
+		data.finish();
+		job.blocks.push_back({ std::move(data.data), key, true });
+		return true;
+	}
+	void finish() {
+		if (!base::take(working)) return;
+
+		if (_writer && (job.options & FileOption::Async)) {
+			_writer->enqueue(std::move(job));
+		} else if (!writeFileJob(job)) {
+			LOG(("App Error: could not write '%1'.").arg(job.base));
 		}
-		*(uint32*)toEncrypt.data() = size;
-		QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
-		hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
-		MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
+	}
 
-		return encrypted;
+	FileWriteJob job;
+	bool working = false;
+
+	~FileWriteDescriptor() {
+		finish();
 	}
-	bool writeEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
-		return writeData(prepareEncrypted(data, key));
+};
+
+AsyncFileWriter::AsyncFileWriter() {
+	start(QThread::LowPriority);
+}
+
+void AsyncFileWriter::enqueue(FileWriteJob &&job) {
+	QMutexLocker lock(&_mutex);
+	const auto i = _pending.find(job.base);
+	if (i != end(_pending)) {
+		// Keep the first deadline, so often changed files still
+		// reach the disk once in kAsyncWriteDelay.
+		i->second.job = std::move(job);
+		++_coalesced;
+		return;
 	}
-	void finish() {
-		if (!file.isOpen()) return;
+	const auto base = job.base;
+	_pending.emplace(base, Pending{ std::move(job), crl::now() + kAsyncWriteDelay });
+	_condition.wakeOne();
+}
 
-		stream.setDevice(nullptr);
+bool AsyncFileWriter::pending(const QString &base) {
+	QMutexLocker lock(&_mutex);
+	return (_pending.find(base) != end(_pending)) || (_writing == base);
+}
 
-		md5.feed(&dataSize, sizeof(dataSize));
-		qint32 version = AppVersion;
-		md5.feed(&version, sizeof(version));
-		md5.feed(tdfMagic, tdfMagicLen);
-		file.write((const char*)md5.result(), 0x10);
+void AsyncFileWriter::flush(const QString &base) {
+	QMutexLocker lock(&_mutex);
+	const auto i = _pending.find(base);
+	if (i != end(_pending)) {
+		i->second.when = 0;
+		_condition.wakeOne();
+	}
+	while ((_pending.find(base) != end(_pending)) || (_writing == base)) {
+		_written.wait(&_mutex);
+	}
+}
 
-		if (saveFile.isOpen()) {
-			saveFile.commit();
-		} else {
-			plainFile.close();
-		}
+void AsyncFileWriter::cancel(const QString &base) {
+	QMutexLocker lock(&_mutex);
+	_pending.erase(base);
+	while (_writing == base) {
+		_written.wait(&_mutex);
+	}
+}
 
-		if (!toDelete.isEmpty()) {
-			QFile::remove(toDelete + '0');
-			QFile::remove(toDelete + '1');
-		}
+void AsyncFileWriter::cancelAll() {
+	QMutexLocker lock(&_mutex);
+	_pending.clear();
+	while (!_writing.isEmpty()) {
+		_written.wait(&_mutex);
 	}
-	QFile plainFile;
-	QSaveFile saveFile;
-	QFileDevice &file;
-	QDataStream stream;
+}
 
-	QString toDelete;
+void AsyncFileWriter::finish() {
+	{
+		QMutexLocker lock(&_mutex);
+		_finishing = true;
+		_condition.wakeOne();
+	}
+	wait();
+	if (_writtenCount > 0) {
+		LOG(("App Info: storage thread wrote %1 files, %2 writes coalesced."
+			).arg(_writtenCount
+			).arg(_coalesced));
+	}
+}
 
-	HashMd5 md5;
-	int32 dataSize = 0;
+void AsyncFileWriter::run() {
+	QMutexLocker lock(&_mutex);
+	while (true) {
+		if (_pending.empty()) {
+			if (_finishing) {
+				break;
+			}
+			_condition.wait(&_mutex);
+			continue;
+		}
+		const auto i = ranges::min_element(
+			_pending,
+			ranges::less(),
+			[](const auto &pair) { return pair.second.when; });
+		const auto now = crl::now();
+		if (!_finishing && i->second.when > now) {
+			_condition.wait(&_mutex, ulong(i->second.when - now));
+			continue;
+		}
+		auto job = std::move(i->second.job);
+		_writing = i->first;
+		_pending.erase(i);
 
-	~FileWriteDescriptor() {
-		finish();
+		lock.unlock();
+		if (!writeFileJob(job)) {
+			LOG(("App Error: could not write '%1'.").arg(job.base));
+		}
+		lock.relock();
+
+		++_writtenCount;
+		_writing = QString();
+		_written.wakeAll();
 	}
-};
+}
 
 bool readFile(FileReadDescriptor &result, const QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
+	const auto phase = Core::StartupPhase("Local::readFile");
+
 	if (options & FileOption::User) {
 		if (!_userWorking()) return false;
 	} else {
@@ -362,6 +556,9 @@ bool readFile(FileReadDescriptor &result, const QString &name, FileOptions optio
 	}
 
 	const auto base = ((options & FileOption::User) ? _userBasePath : _basePath) + name;
+	if (_writer) {
+		_writer->flush(base);
+	}
 
 	// detect order of read attempts
 	QString toTry[2];
@@ -462,6 +659,8 @@ bool readFile(FileReadDescriptor &result, const QString &name, FileOptions optio
 }
 
 bool decryptLocal(EncryptedDescriptor &result, const QByteArray &encrypted, const MTP::AuthKeyPtr &key = LocalKey) {
+	const auto phase = Core::StartupPhase("Local::decrypt");
+
 	if (encrypted.size() <= 16 || (encrypted.size() & 0x0F)) {
 		LOG(("App Error: bad encrypted part size: %1").arg(encrypted.size()));
 		return false;
@@ -667,17 +866,49 @@ DraftsMap _draftsMap, _draftCursorsMap;
 typedef QMap<PeerId, bool> DraftsNotReadMap;
 DraftsNotReadMap _draftsNotReadMap;
 
+// Plain contents of the draft files written in this session, so that
+// switching between chats doesn't rewrite files with unchanged drafts.
+QMap<FileKey, QByteArray> _draftsWrittenData;
+
+bool _draftDataChanged(FileKey key, const QByteArray &data) {
+	auto i = _draftsWrittenData.find(key);
+	if (i != _draftsWrittenData.end() && i.value() == data) {
+		return false;
+	}
+	_draftsWrittenData.insert(key, data);
+	return true;
+}
+
 typedef QPair<FileKey, qint32> FileDesc; // file, size
 
 typedef QMultiMap<MediaKey, FileLocation> FileLocations;
-FileLocations _fileLocations;
 typedef QPair<MediaKey, FileLocation> FileLocationPair;
 typedef QMap<QString, FileLocationPair> FileLocationPairs;
-FileLocationPairs _fileLocationPairs;
 typedef QMap<MediaKey, MediaKey> FileLocationAliases;
 FileLocationAliases _fileLocationAliases;
 FileKey _locationsKey = 0, _trustedBotsKey = 0;
 
+// File locations are split by the media key hash into buckets, each one
+// in a separate file. The _locationsKey file holds only the buckets keys
+// and the aliases. A bucket is read when a location from it is needed
+// and the most recently used half of the buckets is kept in memory, so
+// that lookups spread over many files don't read a bucket each time.
+constexpr auto kLocationsBucketsCount = 256;
+constexpr auto kLocationsBucketsInMemory = kLocationsBucketsCount / 2;
+constexpr auto kLocationsIndexTag = quint32(0xFFFFFFFFU);
+constexpr auto kLocationsIndexVersion = 1;
+
+struct LocationsBucket {
+	FileKey key = 0;
+	FileLocations locations;
+	FileLocationPairs pairs;
+	bool loaded = false;
+	bool changed = false;
+};
+std::array<LocationsBucket, kLocationsBucketsCount> _locationsBuckets;
+std::deque<int> _locationsBucketsUsed;
+bool _locationsIndexChanged = false;
+
 using TrustedBots = OrderedSet<uint64>;
 TrustedBots _trustedBots;
 bool _trustedBotsRead = false;
@@ -721,6 +952,7 @@ FileKey _langPackKey = 0;
 FileKey _languagesKey = 0;
 
 bool _mapChanged = false;
+int _mapJournalRecords = 0;
 int32 _oldMapVersion = 0, _oldSettingsVersion = 0;
 int32 _oldKotatoVersion = 0;
 
@@ -740,80 +972,313 @@ Main::Settings &GetStoredSessionSettings() {
 
 void _writeMap(WriteMapWhen when = WriteMapWhen::Soon);
 
-void _writeLocations(WriteMapWhen when = WriteMapWhen::Soon) {
-	Expects(_manager != nullptr);
+// Drafts keys change much more often than anything else in the map,
+// so their changes are appended to the "mapj" journal as encrypted
+// records and the whole map is rewritten only once in a while.
+constexpr auto kMapJournalCompactAfter = 256;
 
-	if (when != WriteMapWhen::Now) {
-		_manager->writeLocations(when == WriteMapWhen::Fast);
+QString _mapJournalPath() {
+	return _userBasePath + qsl("mapj");
+}
+
+void _journalDraftKey(quint32 keyType, PeerId peer, FileKey key) {
+	if (_mapChanged || _userBasePath.isEmpty() || !LocalKey) {
+		// The whole map will be written anyway.
+		_mapChanged = true;
+		_writeMap();
 		return;
 	}
-	if (!_working()) return;
+	EncryptedDescriptor record(sizeof(quint32) + 2 * sizeof(quint64));
+	record.stream << keyType << quint64(peer) << quint64(key);
+	const auto encrypted = FileWriteDescriptor::prepareEncrypted(record);
 
-	_manager->writingLocations();
-	if (_fileLocations.isEmpty()) {
-		if (_locationsKey) {
-			clearKey(_locationsKey);
-			_locationsKey = 0;
+	auto f = QFile(_mapJournalPath());
+	if (!f.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		_mapChanged = true;
+		_writeMap(WriteMapWhen::Fast);
+		return;
+	}
+	{
+		QDataStream stream(&f);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << encrypted;
+	}
+	f.close();
+
+	if (++_mapJournalRecords >= kMapJournalCompactAfter) {
+		_mapChanged = true;
+		_writeMap();
+	}
+}
+
+void _replayMapJournal(
+		DraftsMap &draftsMap,
+		DraftsMap &draftCursorsMap,
+		DraftsNotReadMap &draftsNotReadMap) {
+	_mapJournalRecords = 0;
+
+	auto f = QFile(_mapJournalPath());
+	if (!f.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	QDataStream stream(&f);
+	stream.setVersion(QDataStream::Qt_5_1);
+	while (!stream.atEnd()) {
+		auto encrypted = QByteArray();
+		stream >> encrypted;
+		EncryptedDescriptor record;
+		if (stream.status() != QDataStream::Ok
+			|| !decryptLocal(record, encrypted)) {
+			// A record torn by a crash, the rest can't be trusted.
+			LOG(("App Error: bad record in map journal."));
 			_mapChanged = true;
-			_writeMap();
+			break;
 		}
-	} else {
-		if (!_locationsKey) {
-			_locationsKey = genKey();
+		quint32 keyType = 0;
+		quint64 peer = 0, key = 0;
+		record.stream >> keyType >> peer >> key;
+		if (!_checkStreamStatus(record.stream)) {
 			_mapChanged = true;
-			_writeMap(WriteMapWhen::Fast);
+			break;
 		}
-		quint32 size = 0;
-		for (FileLocations::const_iterator i = _fileLocations.cbegin(), e = _fileLocations.cend(); i != e; ++i) {
-			// location + type + namelen + name
-			size += sizeof(quint64) * 2 + sizeof(quint32) + Serialize::stringSize(i.value().name());
-			if (AppVersion > 9013) {
-				// bookmark
-				size += Serialize::bytearraySize(i.value().bookmark());
+		if (keyType == lskDraft) {
+			if (key) {
+				draftsMap.insert(peer, key);
+				draftsNotReadMap.insert(peer, true);
+			} else {
+				draftsMap.remove(peer);
+				draftsNotReadMap.remove(peer);
+			}
+		} else if (keyType == lskDraftPosition) {
+			if (key) {
+				draftCursorsMap.insert(peer, key);
+			} else {
+				draftCursorsMap.remove(peer);
 			}
-			// date + size
-			size += Serialize::dateTimeSize() + sizeof(quint32);
 		}
+		++_mapJournalRecords;
+	}
+	if (_mapJournalRecords > 0) {
+		LOG(("App Info: replayed %1 map journal records."
+			).arg(_mapJournalRecords));
+	}
+}
+
+void _writeLocations(WriteMapWhen when = WriteMapWhen::Soon);
+
+int _locationsBucketIndex(const MediaKey &key) {
+	const auto mixed = (key.first * 0x9E3779B97F4A7C15ULL) ^ key.second;
+	return int((mixed ^ (mixed >> 32)) % kLocationsBucketsCount);
+}
+
+void _insertLocation(
+		LocationsBucket &bucket,
+		const MediaKey &key,
+		const FileLocation &loc) {
+	bucket.locations.insert(key, loc);
+	if (!loc.inMediaCache()) {
+		bucket.pairs.insert(loc.fname, FileLocationPair(key, loc));
+	}
+}
+
+void _writeLocationsBucket(LocationsBucket &bucket) {
+	bucket.changed = false;
+	if (bucket.locations.isEmpty()) {
+		if (bucket.key) {
+			clearKey(bucket.key);
+			bucket.key = 0;
+			_locationsIndexChanged = true;
+		}
+		return;
+	}
+	if (!bucket.key) {
+		bucket.key = genKey();
+		_locationsIndexChanged = true;
+	}
+	quint32 size = sizeof(quint32);
+	for (auto i = bucket.locations.cbegin(), e = bucket.locations.cend(); i != e; ++i) {
+		// location + name + bookmark + date + size
+		size += sizeof(quint64) * 2
+			+ Serialize::stringSize(i.value().name())
+			+ Serialize::bytearraySize(i.value().bookmark())
+			+ Serialize::dateTimeSize()
+			+ sizeof(quint32);
+	}
+	EncryptedDescriptor data(size);
+	data.stream << quint32(bucket.locations.size());
+	for (auto i = bucket.locations.cbegin(), e = bucket.locations.cend(); i != e; ++i) {
+		data.stream
+			<< quint64(i.key().first)
+			<< quint64(i.key().second)
+			<< i.value().name()
+			<< i.value().bookmark()
+			<< i.value().modified
+			<< quint32(i.value().size);
+	}
+	FileWriteDescriptor file(bucket.key);
+	file.writeEncrypted(data);
+}
 
-		//end mark
-		size += sizeof(quint64) * 2 + sizeof(quint32) + Serialize::stringSize(QString());
-		if (AppVersion > 9013) {
-			size += Serialize::bytearraySize(QByteArray());
+void _readLocationsBucket(LocationsBucket &bucket) {
+	bucket.loaded = true;
+	if (!bucket.key) {
+		return;
+	}
+	FileReadDescriptor locations;
+	if (!readEncryptedFile(locations, bucket.key)) {
+		clearKey(bucket.key);
+		bucket.key = 0;
+		_locationsIndexChanged = true;
+		_writeLocations();
+		return;
+	}
+	quint32 count = 0;
+	locations.stream >> count;
+	for (quint32 i = 0; i != count; ++i) {
+		quint64 first = 0, second = 0;
+		QByteArray bookmark;
+		FileLocation loc;
+		locations.stream
+			>> first
+			>> second
+			>> loc.fname
+			>> bookmark
+			>> loc.modified
+			>> loc.size;
+		if (!_checkStreamStatus(locations.stream)) {
+			bucket.changed = true;
+			_writeLocations();
+			break;
 		}
-		size += Serialize::dateTimeSize() + sizeof(quint32);
+		loc.setBookmark(bookmark);
+		_insertLocation(bucket, MediaKey(first, second), loc);
+	}
+}
 
-		size += sizeof(quint32); // aliases count
-		for (FileLocationAliases::const_iterator i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
-			// alias + location
-			size += sizeof(quint64) * 2 + sizeof(quint64) * 2;
+void _trimLocationsBuckets() {
+	while (_locationsBucketsUsed.size() > kLocationsBucketsInMemory) {
+		auto &bucket = _locationsBuckets[_locationsBucketsUsed.front()];
+		_locationsBucketsUsed.pop_front();
+		if (bucket.changed) {
+			_writeLocationsBucket(bucket);
 		}
+		bucket.locations.clear();
+		bucket.pairs.clear();
+		bucket.loaded = false;
+	}
+}
 
-		EncryptedDescriptor data(size);
-		auto legacyTypeField = 0;
-		for (FileLocations::const_iterator i = _fileLocations.cbegin(); i != _fileLocations.cend(); ++i) {
-			data.stream << quint64(i.key().first) << quint64(i.key().second) << quint32(legacyTypeField) << i.value().name();
-			if (AppVersion > 9013) {
-				data.stream << i.value().bookmark();
-			}
-			data.stream << i.value().modified << quint32(i.value().size);
+LocationsBucket &_locationsBucket(const MediaKey &key) {
+	const auto index = _locationsBucketIndex(key);
+	auto &bucket = _locationsBuckets[index];
+	if (bucket.loaded) {
+		const auto i = ranges::find(_locationsBucketsUsed, index);
+		Assert(i != end(_locationsBucketsUsed));
+		if (i + 1 != end(_locationsBucketsUsed)) {
+			_locationsBucketsUsed.erase(i);
+			_locationsBucketsUsed.push_back(index);
 		}
+		return bucket;
+	}
+	_readLocationsBucket(bucket);
+	_locationsBucketsUsed.push_back(index);
+	_trimLocationsBuckets();
+	if (_locationsIndexChanged) {
+		_writeLocations(WriteMapWhen::Fast);
+	}
+	return bucket;
+}
+
+void _writeLocations(WriteMapWhen when) {
+	Expects(_manager != nullptr);
+
+	if (when != WriteMapWhen::Now) {
+		_manager->writeLocations(when == WriteMapWhen::Fast);
+		return;
+	}
+	if (!_working()) return;
 
-		data.stream << quint64(0) << quint64(0) << quint32(0) << QString();
-		if (AppVersion > 9013) {
-			data.stream << QByteArray();
+	_manager->writingLocations();
+	for (auto &bucket : _locationsBuckets) {
+		if (bucket.changed) {
+			_writeLocationsBucket(bucket);
 		}
-		data.stream << QDateTime::currentDateTime() << quint32(0);
+	}
+	_trimLocationsBuckets();
+	if (!base::take(_locationsIndexChanged)) {
+		return;
+	}
 
-		data.stream << quint32(_fileLocationAliases.size());
-		for (FileLocationAliases::const_iterator i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
-			data.stream << quint64(i.key().first) << quint64(i.key().second) << quint64(i.value().first) << quint64(i.value().second);
+	const auto hasBuckets = ranges::any_of(
+		_locationsBuckets,
+		[](const LocationsBucket &bucket) { return bucket.key != 0; });
+	if (!hasBuckets && _fileLocationAliases.isEmpty()) {
+		if (_locationsKey) {
+			clearKey(_locationsKey);
+			_locationsKey = 0;
+			_mapChanged = true;
+			_writeMap();
 		}
+		return;
+	}
+	if (!_locationsKey) {
+		_locationsKey = genKey();
+		_mapChanged = true;
+		_writeMap(WriteMapWhen::Fast);
+	}
 
-		FileWriteDescriptor file(_locationsKey);
-		file.writeEncrypted(data);
+	// tag + version + buckets count + buckets keys
+	quint32 size = sizeof(quint64) * 2 + sizeof(quint32) + sizeof(qint32) * 2;
+	size += kLocationsBucketsCount * sizeof(quint64);
+	// aliases count + (alias + location) for each
+	size += sizeof(quint32) + _fileLocationAliases.size() * (sizeof(quint64) * 4);
+
+	EncryptedDescriptor data(size);
+	data.stream
+		<< quint64(0)
+		<< quint64(0)
+		<< quint32(kLocationsIndexTag)
+		<< qint32(kLocationsIndexVersion)
+		<< qint32(kLocationsBucketsCount);
+	for (const auto &bucket : _locationsBuckets) {
+		data.stream << quint64(bucket.key);
+	}
+	data.stream << quint32(_fileLocationAliases.size());
+	for (FileLocationAliases::const_iterator i = _fileLocationAliases.cbegin(), e = _fileLocationAliases.cend(); i != e; ++i) {
+		data.stream << quint64(i.key().first) << quint64(i.key().second) << quint64(i.value().first) << quint64(i.value().second);
+	}
+
+	FileWriteDescriptor file(_locationsKey);
+	file.writeEncrypted(data);
+}
+
+void _readLocationsAliases(FileReadDescriptor &locations) {
+	quint32 cnt;
+	locations.stream >> cnt;
+	for (quint32 i = 0; i < cnt; ++i) {
+		quint64 kfirst, ksecond, vfirst, vsecond;
+		locations.stream >> kfirst >> ksecond >> vfirst >> vsecond;
+		_fileLocationAliases.insert(MediaKey(kfirst, ksecond), MediaKey(vfirst, vsecond));
 	}
 }
 
+bool _readLocationsIndex(FileReadDescriptor &locations) {
+	qint32 version = 0, count = 0;
+	locations.stream >> version >> count;
+	if (!_checkStreamStatus(locations.stream)
+		|| version != kLocationsIndexVersion
+		|| count != kLocationsBucketsCount) {
+		return false;
+	}
+	for (auto &bucket : _locationsBuckets) {
+		quint64 key = 0;
+		locations.stream >> key;
+		bucket.key = key;
+	}
+	_readLocationsAliases(locations);
+	return _checkStreamStatus(locations.stream);
+}
+
 void _readLocations() {
 	FileReadDescriptor locations;
 	if (!readEncryptedFile(locations, _locationsKey)) {
@@ -823,6 +1288,27 @@ void _readLocations() {
 		return;
 	}
 
+	const auto start = locations.buffer.pos();
+	quint64 indexFirst = 0, indexSecond = 0;
+	quint32 indexTag = 0;
+	locations.stream >> indexFirst >> indexSecond >> indexTag;
+	if (!indexFirst && !indexSecond && indexTag == kLocationsIndexTag) {
+		if (!_readLocationsIndex(locations)) {
+			for (auto &bucket : _locationsBuckets) {
+				bucket.key = 0;
+			}
+			_fileLocationAliases.clear();
+			clearKey(_locationsKey);
+			_locationsKey = 0;
+			_mapChanged = true;
+			_writeMap();
+		}
+		return;
+	}
+	locations.buffer.seek(start);
+
+	// Legacy format with all the locations in one file.
+	// Moving all of them to the buckets, this happens only once.
 	bool endMarkFound = false;
 	while (!locations.stream.atEnd()) {
 		quint64 first, second;
@@ -843,20 +1329,18 @@ void _readLocations() {
 
 		MediaKey key(first, second);
 
-		_fileLocations.insert(key, loc);
-		if (!loc.inMediaCache()) {
-			_fileLocationPairs.insert(loc.fname, FileLocationPair(key, loc));
+		const auto index = _locationsBucketIndex(key);
+		auto &bucket = _locationsBuckets[index];
+		if (!bucket.loaded) {
+			bucket.loaded = true;
+			_locationsBucketsUsed.push_back(index);
 		}
+		_insertLocation(bucket, key, loc);
+		bucket.changed = true;
 	}
 
 	if (endMarkFound) {
-		quint32 cnt;
-		locations.stream >> cnt;
-		for (quint32 i = 0; i < cnt; ++i) {
-			quint64 kfirst, ksecond, vfirst, vsecond;
-			locations.stream >> kfirst >> ksecond >> vfirst >> vsecond;
-			_fileLocationAliases.insert(MediaKey(kfirst, ksecond), MediaKey(vfirst, vsecond));
-		}
+		_readLocationsAliases(locations);
 
 		if (!locations.stream.atEnd()) {
 			quint32 webLocationsCount;
@@ -870,6 +1354,8 @@ void _readLocations() {
 			}
 		}
 	}
+	_locationsIndexChanged = true;
+	_writeLocations(WriteMapWhen::Fast);
 }
 
 struct ReadSettingsContext {
@@ -2411,6 +2897,8 @@ ReadMapState _readMap(const QByteArray &pass) {
 		}
 	}
 
+	_replayMapJournal(draftsMap, draftCursorsMap, draftsNotReadMap);
+
 	_draftsMap = draftsMap;
 	_draftCursorsMap = draftCursorsMap;
 	_draftsNotReadMap = draftsNotReadMap;
@@ -2430,7 +2918,7 @@ ReadMapState _readMap(const QByteArray &pass) {
 	_recentHashtagsAndBotsKey = recentHashtagsAndBotsKey;
 	_exportSettingsKey = exportSettingsKey;
 	_oldMapVersion = mapData.version;
-	if (_oldMapVersion < AppVersion) {
+	if (_oldMapVersion < AppVersion || _mapChanged) {
 		_mapChanged = true;
 		_writeMap();
 	} else {
@@ -2582,6 +3070,10 @@ void _writeMap(WriteMapWhen when) {
 	}
 	map.writeEncrypted(mapData);
 
+	// Everything from the journal is in the map now.
+	QFile::remove(_mapJournalPath());
+	_mapJournalRecords = 0;
+
 	_mapChanged = false;
 }
 
@@ -2595,6 +3087,10 @@ void finish() {
 		_manager = nullptr;
 		delete base::take(_localLoader);
 	}
+	if (const auto writer = base::take(_writer)) {
+		writer->finish();
+		delete writer;
+	}
 }
 
 void InitialLoadTheme();
@@ -2608,7 +3104,13 @@ void start() {
 	writeKotatoVersion(AppKotatoVersion);
 
 	_manager = new internal::Manager();
-	_localLoader = new TaskQueue(kFileLoaderQueueStopTimeout);
+	_localLoader = new TaskQueue(
+		kFileLoaderQueueStopTimeout,
+		std::clamp(
+			QThread::idealThreadCount() / 2,
+			1,
+			kFileLoaderWorkersLimit));
+	_writer = new AsyncFileWriter();
 
 	_basePath = cWorkingDir() + qsl("tdata/");
 	if (!QDir().exists(_basePath)) QDir().mkpath(_basePath);
@@ -2837,18 +3339,27 @@ void reset() {
 	if (_localLoader) {
 		_localLoader->stop();
 	}
+	if (_writer) {
+		// All the user files are going to be forgotten.
+		_writer->cancelAll();
+	}
 
 	_passKeySalt.clear(); // reset passcode, local key
 	_draftsMap.clear();
 	_draftCursorsMap.clear();
-	_fileLocations.clear();
-	_fileLocationPairs.clear();
+	_draftsWrittenData.clear();
+	for (auto &bucket : _locationsBuckets) {
+		bucket = LocationsBucket();
+	}
+	_locationsBucketsUsed.clear();
+	_locationsIndexChanged = false;
 	_fileLocationAliases.clear();
 	_draftsNotReadMap.clear();
 	_locationsKey = _trustedBotsKey = 0;
 	_recentStickersKeyOld = 0;
 	_installedStickersKey = _featuredStickersKey = _recentStickersKey = _favedStickersKey = _archivedStickersKey = 0;
 	_savedGifsKey = 0;
+	_stickerSetsContent.clear();
 	_backgroundKeyDay = _backgroundKeyNight = 0;
 	Window::Theme::Background()->reset();
 	_userSettingsKey = _recentHashtagsAndBotsKey = _exportSettingsKey = 0;
@@ -2901,7 +3412,7 @@ base::flat_set<QString> CollectGoodNames() {
 		_exportSettingsKey,
 		_trustedBotsKey
 	};
-	auto result = base::flat_set<QString>{ "map0", "map1", "maps" };
+	auto result = base::flat_set<QString>{ "map0", "map1", "maps", "mapj" };
 	const auto push = [&](FileKey key) {
 		if (!key) {
 			return;
@@ -2922,6 +3433,9 @@ base::flat_set<QString> CollectGoodNames() {
 	for (const auto &value : keys) {
 		push(value);
 	}
+	for (const auto &bucket : _locationsBuckets) {
+		push(bucket.key);
+	}
 	return result;
 }
 
@@ -2932,6 +3446,8 @@ void FilterLegacyFiles(FnMut<void(base::flat_set<QString>&&)> then) {
 }
 
 ReadMapState readMap(const QByteArray &pass) {
+	const auto phase = Core::StartupPhase("Local::readMap");
+
 	ReadMapState result = _readMap(pass);
 	if (result == ReadMapFailed) {
 		_mapChanged = true;
@@ -2961,10 +3477,10 @@ void writeDrafts(const PeerId &peer, const MessageDraft &localDraft, const Messa
 	if (localDraft.msgId <= 0 && localDraft.textWithTags.text.isEmpty() && editDraft.msgId <= 0) {
 		auto i = _draftsMap.find(peer);
 		if (i != _draftsMap.cend()) {
+			_draftsWrittenData.remove(i.value());
 			clearKey(i.value());
 			_draftsMap.erase(i);
-			_mapChanged = true;
-			_writeMap();
+			_journalDraftKey(lskDraft, peer, 0);
 		}
 
 		_draftsNotReadMap.remove(peer);
@@ -2972,8 +3488,7 @@ void writeDrafts(const PeerId &peer, const MessageDraft &localDraft, const Messa
 		auto i = _draftsMap.constFind(peer);
 		if (i == _draftsMap.cend()) {
 			i = _draftsMap.insert(peer, genKey());
-			_mapChanged = true;
-			_writeMap(WriteMapWhen::Fast);
+			_journalDraftKey(lskDraft, peer, i.value());
 		}
 
 		auto msgTags = TextUtilities::SerializeTags(
@@ -2992,8 +3507,10 @@ void writeDrafts(const PeerId &peer, const MessageDraft &localDraft, const Messa
 		data.stream << editDraft.textWithTags.text << editTags;
 		data.stream << qint32(editDraft.msgId) << qint32(editDraft.previewCancelled ? 1 : 0);
 
-		FileWriteDescriptor file(i.value());
-		file.writeEncrypted(data);
+		if (_draftDataChanged(i.value(), data.data)) {
+			FileWriteDescriptor file(i.value());
+			file.writeEncrypted(data);
+		}
 
 		_draftsNotReadMap.remove(peer);
 	}
@@ -3002,10 +3519,10 @@ void writeDrafts(const PeerId &peer, const MessageDraft &localDraft, const Messa
 void clearDraftCursors(const PeerId &peer) {
 	DraftsMap::iterator i = _draftCursorsMap.find(peer);
 	if (i != _draftCursorsMap.cend()) {
+		_draftsWrittenData.remove(i.value());
 		clearKey(i.value());
 		_draftCursorsMap.erase(i);
-		_mapChanged = true;
-		_writeMap();
+		_journalDraftKey(lskDraftPosition, peer, 0);
 	}
 }
 
@@ -3051,6 +3568,7 @@ void readDraftsWithCursors(History *h) {
 	}
 	FileReadDescriptor draft;
 	if (!readEncryptedFile(draft, j.value())) {
+		_draftsWrittenData.remove(j.value());
 		clearKey(j.value());
 		_draftsMap.erase(j);
 		clearDraftCursors(peer);
@@ -3079,6 +3597,7 @@ void readDraftsWithCursors(History *h) {
 		}
 	}
 	if (draftPeer != peer) {
+		_draftsWrittenData.remove(j.value());
 		clearKey(j.value());
 		_draftsMap.erase(j);
 		clearDraftCursors(peer);
@@ -3126,16 +3645,17 @@ void writeDraftCursors(const PeerId &peer, const MessageCursor &msgCursor, const
 		DraftsMap::const_iterator i = _draftCursorsMap.constFind(peer);
 		if (i == _draftCursorsMap.cend()) {
 			i = _draftCursorsMap.insert(peer, genKey());
-			_mapChanged = true;
-			_writeMap(WriteMapWhen::Fast);
+			_journalDraftKey(lskDraftPosition, peer, i.value());
 		}
 
 		EncryptedDescriptor data(sizeof(quint64) + sizeof(qint32) * 3);
 		data.stream << quint64(peer) << qint32(msgCursor.position) << qint32(msgCursor.anchor) << qint32(msgCursor.scroll);
 		data.stream << qint32(editCursor.position) << qint32(editCursor.anchor) << qint32(editCursor.scroll);
 
-		FileWriteDescriptor file(i.value());
-		file.writeEncrypted(data);
+		if (_draftDataChanged(i.value(), data.data)) {
+			FileWriteDescriptor file(i.value());
+			file.writeEncrypted(data);
+		}
 	}
 }
 
@@ -3156,47 +3676,55 @@ void writeFileLocation(MediaKey location, const FileLocation &local) {
 		if (aliasIt != _fileLocationAliases.cend()) {
 			location = aliasIt.value();
 		}
+	}
 
-		FileLocationPairs::iterator i = _fileLocationPairs.find(local.fname);
-		if (i != _fileLocationPairs.cend()) {
+	// Same files are found only among the locations of one bucket.
+	auto &bucket = _locationsBucket(location);
+	if (!local.inMediaCache()) {
+		FileLocationPairs::iterator i = bucket.pairs.find(local.fname);
+		if (i != bucket.pairs.cend()) {
 			if (i.value().second == local) {
 				if (i.value().first != location) {
 					_fileLocationAliases.insert(location, i.value().first);
+					_locationsIndexChanged = true;
 					_writeLocations(WriteMapWhen::Fast);
 				}
 				return;
 			}
 			if (i.value().first != location) {
-				for (FileLocations::iterator j = _fileLocations.find(i.value().first), e = _fileLocations.end(); (j != e) && (j.key() == i.value().first); ++j) {
+				for (FileLocations::iterator j = bucket.locations.find(i.value().first), e = bucket.locations.end(); (j != e) && (j.key() == i.value().first); ++j) {
 					if (j.value() == i.value().second) {
-						_fileLocations.erase(j);
+						bucket.locations.erase(j);
 						break;
 					}
 				}
-				_fileLocationPairs.erase(i);
+				bucket.pairs.erase(i);
 			}
 		}
-		_fileLocationPairs.insert(local.fname, FileLocationPair(location, local));
+		bucket.pairs.insert(local.fname, FileLocationPair(location, local));
 	} else {
-		for (FileLocations::iterator i = _fileLocations.find(location); (i != _fileLocations.end()) && (i.key() == location);) {
+		for (FileLocations::iterator i = bucket.locations.find(location); (i != bucket.locations.end()) && (i.key() == location);) {
 			if (i.value().inMediaCache() || i.value().check()) {
 				return;
 			}
-			i = _fileLocations.erase(i);
+			i = bucket.locations.erase(i);
 		}
 	}
-	_fileLocations.insert(location, local);
+	bucket.locations.insert(location, local);
+	bucket.changed = true;
 	_writeLocations(WriteMapWhen::Fast);
 }
 
 void removeFileLocation(MediaKey location) {
-	FileLocations::iterator i = _fileLocations.find(location);
-	if (i == _fileLocations.end()) {
+	auto &bucket = _locationsBucket(location);
+	FileLocations::iterator i = bucket.locations.find(location);
+	if (i == bucket.locations.end()) {
 		return;
 	}
-	while (i != _fileLocations.end() && (i.key() == location)) {
-		i = _fileLocations.erase(i);
+	while (i != bucket.locations.end() && (i.key() == location)) {
+		i = bucket.locations.erase(i);
 	}
+	bucket.changed = true;
 	_writeLocations(WriteMapWhen::Fast);
 }
 
@@ -3206,10 +3734,12 @@ FileLocation readFileLocation(MediaKey location) {
 		location = aliasIt.value();
 	}
 
-	for (FileLocations::iterator i = _fileLocations.find(location); (i != _fileLocations.end()) && (i.key() == location);) {
+	auto &bucket = _locationsBucket(location);
+	for (FileLocations::iterator i = bucket.locations.find(location); (i != bucket.locations.end()) && (i.key() == location);) {
 		if (!i.value().inMediaCache() && !i.value().check()) {
-			_fileLocationPairs.remove(i.value().fname);
-			i = _fileLocations.erase(i);
+			bucket.pairs.remove(i.value().fname);
+			i = bucket.locations.erase(i);
+			bucket.changed = true;
 			_writeLocations();
 			continue;
 		}
@@ -3315,6 +3845,10 @@ public:
 			Auth().data().requestDocumentViewRepaint(_doc);
 		}
 	}
+	bool finishInOrder() const override {
+		// Waveforms of all visible voice messages are counted at once.
+		return false;
+	}
 	~CountWaveformTask() {
 		if (_data.isEmpty() && _doc) {
 			_loc.accessDisable();
@@ -3348,46 +3882,114 @@ void cancelTask(TaskId id) {
 	}
 }
 
-void _writeStickerSet(QDataStream &stream, const Stickers::Set &set) {
-	const auto writeInfo = [&](int count) {
-		stream
-			<< quint64(set.id)
-			<< quint64(set.access)
-			<< set.title
-			<< set.shortName
-			<< qint32(count)
-			<< qint32(set.hash)
-			<< qint32(set.flags)
-			<< qint32(set.installDate);
-		Serialize::writeStorageImageLocation(
-			stream,
-			set.thumbnail ? set.thumbnail->location() : StorageImageLocation());
-	};
+// Encrypted stickers of the sets read from the indexed format. They are
+// decrypted and parsed when the set is requested or later in idle time.
+struct StickerSetContent {
+	QByteArray encrypted;
+	int32 version = 0;
+	int32 hash = 0;
+	int32 count = 0;
+};
+base::flat_map<uint64, StickerSetContent> _stickerSetsContent;
+
+void _writeStickerSetInfo(
+		QDataStream &stream,
+		const Stickers::Set &set,
+		int count) {
+	stream
+		<< quint64(set.id)
+		<< quint64(set.access)
+		<< set.title
+		<< set.shortName
+		<< qint32(count)
+		<< qint32(set.hash)
+		<< qint32(set.flags)
+		<< qint32(set.installDate);
+	Serialize::writeStorageImageLocation(
+		stream,
+		set.thumbnail ? set.thumbnail->location() : StorageImageLocation());
+}
+
+quint32 _stickerSetInfoSize(const Stickers::Set &set) {
+	// id + access + title + shortName + stickersCount + hash + flags + installDate
+	return sizeof(quint64) * 2
+		+ Serialize::stringSize(set.title)
+		+ Serialize::stringSize(set.shortName)
+		+ sizeof(qint32) * 4
+		+ Serialize::storageImageLocationSize(set.thumbnail
+			? set.thumbnail->location()
+			: StorageImageLocation());
+}
+
+bool _stickerSetHasStickers(const Stickers::Set &set) {
+	return !set.stickers.isEmpty() || _stickerSetsContent.contains(set.id);
+}
+
+// Count written to the index, negative for sets without the stickers.
+int _stickerSetStoredCount(const Stickers::Set &set) {
 	if (set.flags & MTPDstickerSet_ClientFlag::f_not_loaded) {
-		writeInfo(-set.count);
-		return;
-	} else if (set.stickers.isEmpty()) {
+		return -set.count;
+	} else if (!set.stickers.isEmpty()) {
+		return set.stickers.size();
+	}
+	const auto i = _stickerSetsContent.find(set.id);
+	return (i != end(_stickerSetsContent)) ? i->second.count : 0;
+}
+
+// Stickers that were not parsed yet keep the version they were written with.
+int32 _stickerSetStickersVersion(const Stickers::Set &set) {
+	if (!set.stickers.isEmpty()) {
+		return AppVersion;
+	}
+	const auto i = _stickerSetsContent.find(set.id);
+	Assert(i != end(_stickerSetsContent));
+	return i->second.version;
+}
+
+void _writeStickerSetStickers(
+		FileWriteDescriptor &file,
+		const Stickers::Set &set) {
+	if (set.stickers.isEmpty()) {
+		// Not parsed yet, so not changed since it was read.
+		const auto i = _stickerSetsContent.find(set.id);
+		Assert(i != end(_stickerSetsContent));
+		file.writeData(i->second.encrypted);
 		return;
 	}
 
-	writeInfo(set.stickers.size());
-	for (const auto &sticker : set.stickers) {
-		Serialize::Document::writeToStream(stream, sticker);
+	quint32 size = 0;
+	for (const auto sticker : set.stickers) {
+		sticker->refreshStickerThumbFileReference();
+		size += Serialize::Document::sizeInStream(sticker);
 	}
-	stream << qint32(set.dates.size());
+
+	size += sizeof(qint32); // datesCount
 	if (!set.dates.empty()) {
-		Assert(set.dates.size() == set.stickers.size());
-		for (const auto date : set.dates) {
-			stream << qint32(date);
-		}
+		Assert(set.stickers.size() == set.dates.size());
+		size += set.dates.size() * sizeof(qint32);
+	}
+
+	size += sizeof(qint32); // emojiCount
+	for (auto j = set.emoji.cbegin(), e = set.emoji.cend(); j != e; ++j) {
+		size += Serialize::stringSize(j.key()->id()) + sizeof(qint32) + (j->size() * sizeof(quint64));
 	}
-	stream << qint32(set.emoji.size());
+
+	EncryptedDescriptor data(size);
+	for (const auto &sticker : set.stickers) {
+		Serialize::Document::writeToStream(data.stream, sticker);
+	}
+	data.stream << qint32(set.dates.size());
+	for (const auto date : set.dates) {
+		data.stream << qint32(date);
+	}
+	data.stream << qint32(set.emoji.size());
 	for (auto j = set.emoji.cbegin(), e = set.emoji.cend(); j != e; ++j) {
-		stream << j.key()->id() << qint32(j->size());
+		data.stream << j.key()->id() << qint32(j->size());
 		for (const auto sticker : *j) {
-			stream << quint64(sticker->id);
+			data.stream << quint64(sticker->id);
 		}
 	}
+	file.writeEncrypted(data);
 }
 
 // In generic method _writeStickerSets() we look through all the sets and call a
@@ -3398,6 +4000,11 @@ enum class StickerSetCheckResult {
 	Abort,
 };
 
+// The index with the sets info and order is written as the first encrypted
+// block of the file, followed by one encrypted block of stickers for each
+// set with a positive count in the index, in the same order. For such sets
+// the index also holds the app version the stickers block was written with.
+//
 // CheckSet is a functor on Stickers::Set, which returns a StickerSetCheckResult.
 template <typename CheckSet>
 void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::Order &order) {
@@ -3417,7 +4024,7 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 	// versionTag + version + count
 	quint32 size = sizeof(quint32) + sizeof(qint32) + sizeof(qint32);
 
-	int32 setsCount = 0;
+	auto written = std::vector<not_null<const Stickers::Set*>>();
 	for (const auto &set : sets) {
 		auto result = checkSet(set);
 		if (result == StickerSetCheckResult::Abort) {
@@ -3425,38 +4032,13 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 		} else if (result == StickerSetCheckResult::Skip) {
 			continue;
 		}
-
-		// id + access + title + shortName + stickersCount + hash + flags + installDate
-		size += sizeof(quint64) * 2
-			+ Serialize::stringSize(set.title)
-			+ Serialize::stringSize(set.shortName)
-			+ sizeof(qint32) * 4
-			+ Serialize::storageImageLocationSize(set.thumbnail
-				? set.thumbnail->location()
-				: StorageImageLocation());
-		if (set.flags & MTPDstickerSet_ClientFlag::f_not_loaded) {
-			continue;
-		}
-
-		for (const auto sticker : set.stickers) {
-			sticker->refreshStickerThumbFileReference();
-			size += Serialize::Document::sizeInStream(sticker);
-		}
-
-		size += sizeof(qint32); // datesCount
-		if (!set.dates.empty()) {
-			Assert(set.stickers.size() == set.dates.size());
-			size += set.dates.size() * sizeof(qint32);
+		size += _stickerSetInfoSize(set);
+		if (_stickerSetStoredCount(set) > 0) {
+			size += sizeof(qint32); // stickersVersion
 		}
-
-		size += sizeof(qint32); // emojiCount
-		for (auto j = set.emoji.cbegin(), e = set.emoji.cend(); j != e; ++j) {
-			size += Serialize::stringSize(j.key()->id()) + sizeof(qint32) + (j->size() * sizeof(quint64));
-		}
-
-		++setsCount;
+		written.push_back(&set);
 	}
-	if (!setsCount && order.isEmpty()) {
+	if (written.empty() && order.isEmpty()) {
 		if (stickersKey) {
 			clearKey(stickersKey);
 			stickersKey = 0;
@@ -3476,25 +4058,120 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 	data.stream
 		<< quint32(kStickersVersionTag)
 		<< qint32(kStickersSerializeVersion)
-		<< qint32(setsCount);
-	for (const auto &set : sets) {
-		auto result = checkSet(set);
-		if (result == StickerSetCheckResult::Abort) {
-			return;
-		} else if (result == StickerSetCheckResult::Skip) {
-			continue;
+		<< qint32(written.size());
+	for (const auto set : written) {
+		const auto count = _stickerSetStoredCount(*set);
+		_writeStickerSetInfo(data.stream, *set, count);
+		if (count > 0) {
+			data.stream << qint32(_stickerSetStickersVersion(*set));
 		}
-		_writeStickerSet(data.stream, set);
 	}
 	data.stream << order;
 
 	FileWriteDescriptor file(stickersKey);
 	file.writeEncrypted(data);
+	for (const auto set : written) {
+		if (_stickerSetStoredCount(*set) > 0) {
+			_writeStickerSetStickers(file, *set);
+		}
+	}
+}
+
+// Reads the stickers, dates and emoji of the set written after its info.
+bool _readStickerSetStickers(
+		QDataStream &stream,
+		int32 version,
+		Stickers::Set &set,
+		int32 scnt,
+		bool fillStickers) {
+	const auto inputSet = MTP_inputStickerSetID(MTP_long(set.id), MTP_long(set.access));
+
+	if (fillStickers) {
+		set.stickers.reserve(scnt);
+		set.count = 0;
+	}
+
+	Serialize::Document::StickerSetInfo info(set.id, set.access, set.shortName);
+	base::flat_set<DocumentId> read;
+	for (int32 j = 0; j < scnt; ++j) {
+		auto document = Serialize::Document::readStickerFromStream(version, stream, info);
+		if (!_checkStreamStatus(stream)) {
+			return false;
+		} else if (!document
+			|| !document->sticker()
+			|| read.contains(document->id)) {
+			continue;
+		}
+		read.emplace(document->id);
+		if (fillStickers) {
+			set.stickers.push_back(document);
+			if (!(set.flags & MTPDstickerSet_ClientFlag::f_special)) {
+				if (document->sticker()->set.type() != mtpc_inputStickerSetID) {
+					document->sticker()->set = inputSet;
+				}
+			}
+			++set.count;
+		}
+	}
+
+	qint32 datesCount = 0;
+	stream >> datesCount;
+	if (datesCount > 0) {
+		if (datesCount != scnt) {
+			return false;
+		}
+		const auto fillDates = (set.id == Stickers::CloudRecentSetId)
+			&& (set.stickers.size() == datesCount);
+		if (fillDates) {
+			set.dates.clear();
+			set.dates.reserve(datesCount);
+		}
+		for (auto i = 0; i != datesCount; ++i) {
+			qint32 date = 0;
+			stream >> date;
+			if (fillDates) {
+				set.dates.push_back(TimeId(date));
+			}
+		}
+	}
+
+	qint32 emojiCount = 0;
+	stream >> emojiCount;
+	if (!_checkStreamStatus(stream) || emojiCount < 0) {
+		return false;
+	}
+	for (int32 j = 0; j < emojiCount; ++j) {
+		QString emojiString;
+		qint32 stickersCount;
+		stream >> emojiString >> stickersCount;
+		Stickers::Pack pack;
+		pack.reserve(stickersCount);
+		for (int32 k = 0; k < stickersCount; ++k) {
+			quint64 id;
+			stream >> id;
+			const auto doc = Auth().data().document(id);
+			if (!doc->sticker()) continue;
+
+			pack.push_back(doc);
+		}
+		if (fillStickers) {
+			if (auto emoji = Ui::Emoji::Find(emojiString)) {
+				emoji = emoji->original();
+				set.emoji.insert(emoji, pack);
+			}
+		}
+	}
+	return true;
 }
 
 void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr, MTPDstickerSet::Flags readingFlags = 0) {
-	FileReadDescriptor stickers;
-	if (!readEncryptedFile(stickers, stickersKey)) {
+	FileReadDescriptor file;
+	EncryptedDescriptor stickers;
+	auto encrypted = QByteArray();
+	if (readFile(file, toFilePart(stickersKey))) {
+		file.stream >> encrypted;
+	}
+	if (encrypted.isEmpty() || !decryptLocal(stickers, encrypted)) {
 		clearKey(stickersKey);
 		stickersKey = 0;
 		_writeMap();
@@ -3513,10 +4190,13 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 	qint32 version = 0;
 	stickers.stream >> versionTag >> version;
 	if (versionTag != kStickersVersionTag
-		|| version != kStickersSerializeVersion) {
+		|| (version != kStickersSerializeVersion
+			&& version != kStickersSerializeVersionIndexed
+			&& version != kStickersSerializeVersionMonolithic)) {
 		// Old data, without sticker set thumbnails.
 		return failed();
 	}
+	const auto indexed = (version != kStickersSerializeVersionMonolithic);
 	qint32 count = 0;
 	stickers.stream >> count;
 	if (!_checkStreamStatus(stickers.stream)
@@ -3546,7 +4226,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 			>> setFlagsValue
 			>> setInstallDate;
 		const auto thumbnail = Serialize::readStorageImageLocation(
-			stickers.version,
+			file.version,
 			stickers.stream);
 		if (!thumbnail || !_checkStreamStatus(stickers.stream)) {
 			return failed();
@@ -3560,6 +4240,22 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 			setThumbnail = *thumbnail;
 		}
 
+		auto content = QByteArray();
+		auto contentVersion = qint32(file.version);
+		if (version == kStickersSerializeVersion && scnt > 0) {
+			stickers.stream >> contentVersion;
+			if (!_checkStreamStatus(stickers.stream)
+				|| contentVersion > AppVersion) {
+				return failed();
+			}
+		}
+		if (indexed && scnt > 0) {
+			file.stream >> content;
+			if (!_checkStreamStatus(file.stream)) {
+				return failed();
+			}
+		}
+
 		setFlags = MTPDstickerSet::Flags::from_raw(setFlagsValue);
 		if (setId == Stickers::DefaultSetId) {
 			setTitle = tr::lng_stickers_default_set(tr::now);
@@ -3593,8 +4289,8 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 				Images::CreateStickerSetThumbnail(setThumbnail)));
 		}
 		auto &set = it.value();
-		auto inputSet = MTP_inputStickerSetID(MTP_long(set.id), MTP_long(set.access));
-		const auto fillStickers = set.stickers.isEmpty();
+		const auto fillStickers = set.stickers.isEmpty()
+			&& !_stickerSetsContent.contains(set.id);
 
 		if (scnt < 0) { // disabled not loaded set
 			if (!set.count || fillStickers) {
@@ -3603,81 +4299,26 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 			continue;
 		}
 
-		if (fillStickers) {
-			set.stickers.reserve(scnt);
-			set.count = 0;
-		}
-
-		Serialize::Document::StickerSetInfo info(setId, setAccess, setShortName);
-		base::flat_set<DocumentId> read;
-		for (int32 j = 0; j < scnt; ++j) {
-			auto document = Serialize::Document::readStickerFromStream(stickers.version, stickers.stream, info);
-			if (!_checkStreamStatus(stickers.stream)) {
-				return failed();
-			} else if (!document
-				|| !document->sticker()
-				|| read.contains(document->id)) {
-				continue;
-			}
-			read.emplace(document->id);
-			if (fillStickers) {
-				set.stickers.push_back(document);
-				if (!(set.flags & MTPDstickerSet_ClientFlag::f_special)) {
-					if (document->sticker()->set.type() != mtpc_inputStickerSetID) {
-						document->sticker()->set = inputSet;
-					}
-				}
-				++set.count;
-			}
-		}
-
-		qint32 datesCount = 0;
-		stickers.stream >> datesCount;
-		if (datesCount > 0) {
-			if (datesCount != scnt) {
-				return failed();
-			}
-			const auto fillDates = (set.id == Stickers::CloudRecentSetId)
-				&& (set.stickers.size() == datesCount);
-			if (fillDates) {
-				set.dates.clear();
-				set.dates.reserve(datesCount);
-			}
-			for (auto i = 0; i != datesCount; ++i) {
-				qint32 date = 0;
-				stickers.stream >> date;
-				if (fillDates) {
-					set.dates.push_back(TimeId(date));
-				}
+		if (indexed) {
+			// Stickers of the set are parsed later, when they are needed.
+			if (fillStickers && scnt > 0) {
+				set.count = scnt;
+				_stickerSetsContent.emplace(setId, StickerSetContent{
+					std::move(content),
+					contentVersion,
+					set.hash,
+					scnt });
 			}
+			continue;
 		}
-
-		qint32 emojiCount = 0;
-		stickers.stream >> emojiCount;
-		if (!_checkStreamStatus(stickers.stream) || emojiCount < 0) {
+		if (!_readStickerSetStickers(
+				stickers.stream,
+				file.version,
+				set,
+				scnt,
+				fillStickers)) {
 			return failed();
 		}
-		for (int32 j = 0; j < emojiCount; ++j) {
-			QString emojiString;
-			qint32 stickersCount;
-			stickers.stream >> emojiString >> stickersCount;
-			Stickers::Pack pack;
-			pack.reserve(stickersCount);
-			for (int32 k = 0; k < stickersCount; ++k) {
-				quint64 id;
-				stickers.stream >> id;
-				const auto doc = Auth().data().document(id);
-				if (!doc->sticker()) continue;
-
-				pack.push_back(doc);
-			}
-			if (fillStickers) {
-				if (auto emoji = Ui::Emoji::Find(emojiString)) {
-					emoji = emoji->original();
-					set.emoji.insert(emoji, pack);
-				}
-			}
-		}
 	}
 
 	// Read orders of installed and featured stickers.
@@ -3715,6 +4356,63 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 			}
 		}
 	}
+	if (_manager && !_stickerSetsContent.empty()) {
+		_manager->readStickerSetsLater();
+	}
+}
+
+bool _readStickerSetContent(uint64 setId) {
+	const auto i = _stickerSetsContent.find(setId);
+	if (i == end(_stickerSetsContent)) {
+		return false;
+	}
+	const auto content = std::move(i->second);
+	_stickerSetsContent.erase(i);
+
+	auto &sets = Auth().data().stickerSetsRef();
+	const auto it = sets.find(setId);
+	if (it == sets.end()
+		|| !it->stickers.isEmpty()
+		|| it->hash != content.hash) {
+		// Changed since it was read, the stored stickers are outdated.
+		return false;
+	}
+	auto &set = it.value();
+	EncryptedDescriptor data;
+	if (!decryptLocal(data, content.encrypted)
+		|| !_readStickerSetStickers(
+			data.stream,
+			content.version,
+			set,
+			content.count,
+			true)) {
+		LOG(("App Error: could not read stickers of set %1.").arg(setId));
+		set.stickers.clear();
+		set.dates.clear();
+		set.emoji.clear();
+		set.count = content.count;
+		return false;
+	}
+	set.flags &= ~MTPDstickerSet_ClientFlag::f_not_loaded;
+	return true;
+}
+
+bool _readStickerSetsSlice() {
+	if (!Main::Session::Exists()) {
+		_stickerSetsContent.clear();
+		return false;
+	}
+	for (auto i = 0; i != kStickerSetsReadSlice; ++i) {
+		if (_stickerSetsContent.empty()) {
+			break;
+		}
+		_readStickerSetContent(_stickerSetsContent.front().first);
+	}
+	if (!_stickerSetsContent.empty()) {
+		return true;
+	}
+	Auth().data().notifyStickersUpdated();
+	return false;
 }
 
 void writeInstalledStickers() {
@@ -3724,14 +4422,14 @@ void writeInstalledStickers() {
 		if (set.id == Stickers::CloudRecentSetId || set.id == Stickers::FavedSetId) { // separate files for them
 			return StickerSetCheckResult::Skip;
 		} else if (set.flags & MTPDstickerSet_ClientFlag::f_special) {
-			if (set.stickers.isEmpty()) { // all other special are "installed"
+			if (!_stickerSetHasStickers(set)) { // all other special are "installed"
 				return StickerSetCheckResult::Skip;
 			}
 		} else if (!(set.flags & MTPDstickerSet::Flag::f_installed_date) || (set.flags & MTPDstickerSet::Flag::f_archived)) {
 			return StickerSetCheckResult::Skip;
 		} else if (set.flags & MTPDstickerSet_ClientFlag::f_not_loaded) { // waiting to receive
 			return StickerSetCheckResult::Abort;
-		} else if (set.stickers.isEmpty()) {
+		} else if (!_stickerSetHasStickers(set)) {
 			return StickerSetCheckResult::Skip;
 		}
 		return StickerSetCheckResult::Write;
@@ -3750,7 +4448,7 @@ void writeFeaturedStickers() {
 			return StickerSetCheckResult::Skip;
 		} else if (set.flags & MTPDstickerSet_ClientFlag::f_not_loaded) { // waiting to receive
 			return StickerSetCheckResult::Abort;
-		} else if (set.stickers.isEmpty()) {
+		} else if (!_stickerSetHasStickers(set)) {
 			return StickerSetCheckResult::Skip;
 		}
 		return StickerSetCheckResult::Write;
@@ -3761,7 +4459,7 @@ void writeRecentStickers() {
 	if (!Global::started()) return;
 
 	_writeStickerSets(_recentStickersKey, [](const Stickers::Set &set) {
-		if (set.id != Stickers::CloudRecentSetId || set.stickers.isEmpty()) {
+		if (set.id != Stickers::CloudRecentSetId || !_stickerSetHasStickers(set)) {
 			return StickerSetCheckResult::Skip;
 		}
 		return StickerSetCheckResult::Write;
@@ -3772,7 +4470,7 @@ void writeFavedStickers() {
 	if (!Global::started()) return;
 
 	_writeStickerSets(_favedStickersKey, [](const Stickers::Set &set) {
-		if (set.id != Stickers::FavedSetId || set.stickers.isEmpty()) {
+		if (set.id != Stickers::FavedSetId || !_stickerSetHasStickers(set)) {
 			return StickerSetCheckResult::Skip;
 		}
 		return StickerSetCheckResult::Write;
@@ -3783,7 +4481,7 @@ void writeArchivedStickers() {
 	if (!Global::started()) return;
 
 	_writeStickerSets(_archivedStickersKey, [](const Stickers::Set &set) {
-		if (!(set.flags & MTPDstickerSet::Flag::f_archived) || set.stickers.isEmpty()) {
+		if (!(set.flags & MTPDstickerSet::Flag::f_archived) || !_stickerSetHasStickers(set)) {
 			return StickerSetCheckResult::Skip;
 		}
 		return StickerSetCheckResult::Write;
@@ -3904,6 +4602,7 @@ void readInstalledStickers() {
 	}
 
 	Auth().data().stickerSetsRef().clear();
+	_stickerSetsContent.clear();
 	_readStickerSets(
 		_installedStickersKey,
 		&Auth().data().stickerSetsOrderRef(),
@@ -3943,6 +4642,10 @@ void readArchivedStickers() {
 	}
 }
 
+bool readStickerSetStickers(uint64 setId) {
+	return _readStickerSetContent(setId);
+}
+
 int32 countDocumentVectorHash(const QVector<DocumentData*> vector) {
 	auto result = Api::HashInit();
 	for (const auto document : vector) {
@@ -5078,6 +5781,10 @@ bool ClearManager::addTask(int task) {
 	if (!data->tasks.isEmpty() && (data->tasks.at(0) == ClearManagerAll)) return true;
 	if (task == ClearManagerAll) {
 		data->tasks.clear();
+		if (_writer) {
+			_writer->cancelAll();
+		}
+		_draftsWrittenData.clear();
 		if (!_draftsMap.isEmpty()) {
 			_draftsMap.clear();
 			_mapChanged = true;
@@ -5148,6 +5855,37 @@ ClearManager::~ClearManager() {
 	delete data;
 }
 
+bool ClearManager::removeDirectories(const std::vector<QString> &paths) {
+	struct State {
+		QMutex mutex;
+		QWaitCondition finished;
+		int left = 0;
+		bool result = true;
+	};
+	const auto state = std::make_shared<State>();
+	state->left = paths.size();
+
+	// Different directories are removed in parallel.
+	for (const auto &path : paths) {
+		crl::async([=] {
+			const auto removed = QDir(path).removeRecursively();
+
+			QMutexLocker lock(&state->mutex);
+			if (!removed) {
+				state->result = false;
+			}
+			if (!--state->left) {
+				state->finished.wakeAll();
+			}
+		});
+	}
+	QMutexLocker lock(&state->mutex);
+	while (state->left > 0) {
+		state->finished.wait(&state->mutex);
+	}
+	return state->result;
+}
+
 void ClearManager::onStart() {
 	while (true) {
 		int task = 0;
@@ -5162,13 +5900,17 @@ void ClearManager::onStart() {
 		}
 		switch (task) {
 		case ClearManagerAll: {
-			result = QDir(cTempDir()).removeRecursively();
+			result = true;
+			auto directories = std::vector<QString>{
+				cTempDir(),
+				Storage::ResumableDownloadsFolder(),
+			};
 			QDirIterator di(_userBasePath, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
 			while (di.hasNext()) {
 				di.next();
 				const QFileInfo& fi = di.fileInfo();
 				if (fi.isDir() && !fi.isSymLink()) {
-					if (!QDir(di.filePath()).removeRecursively()) result = false;
+					directories.push_back(di.filePath());
 				} else {
 					QString path = di.filePath();
 					if (!path.endsWith(qstr("map0")) && !path.endsWith(qstr("map1")) && !path.endsWith(qstr("maps"))) {
@@ -5176,9 +5918,15 @@ void ClearManager::onStart() {
 					}
 				}
 			}
+			if (!removeDirectories(directories)) {
+				result = false;
+			}
 		} break;
 		case ClearManagerDownloads:
-			result = QDir(cTempDir()).removeRecursively();
+			result = removeDirectories({
+				cTempDir(),
+				Storage::ResumableDownloadsFolder(),
+			});
 		break;
 		case ClearManagerStorage:
 			result = true;
@@ -5209,6 +5957,8 @@ Manager::Manager() {
 	connect(&_mapWriteTimer, SIGNAL(timeout()), this, SLOT(mapWriteTimeout()));
 	_locationsWriteTimer.setSingleShot(true);
 	connect(&_locationsWriteTimer, SIGNAL(timeout()), this, SLOT(locationsWriteTimeout()));
+	_stickerSetsReadTimer.setSingleShot(true);
+	connect(&_stickerSetsReadTimer, SIGNAL(timeout()), this, SLOT(stickerSetsReadTimeout()));
 }
 
 void Manager::writeMap(bool fast) {
@@ -5243,6 +5993,18 @@ void Manager::locationsWriteTimeout() {
 	_writeLocations(WriteMapWhen::Now);
 }
 
+void Manager::readStickerSetsLater() {
+	if (!_stickerSetsReadTimer.isActive()) {
+		_stickerSetsReadTimer.start(0);
+	}
+}
+
+void Manager::stickerSetsReadTimeout() {
+	if (_readStickerSetsSlice()) {
+		_stickerSetsReadTimer.start(0);
+	}
+}
+
 void Manager::finish() {
 	if (_mapWriteTimer.isActive()) {
 		mapWriteTimeout();
@@ -84,6 +84,8 @@ private slots:
 private:
 	~ClearManager();
 
+	bool removeDirectories(const std::vector<QString> &paths);
+
 	ClearManagerData *data;
 
 };
@@ -145,6 +147,10 @@ void readFeaturedStickers();
 void readRecentStickers();
 void readFavedStickers();
 void readArchivedStickers();
+
+// Parses the stickers of a set that was read without them, if they are
+// still up to date. Returns false if the set should be requested.
+bool readStickerSetStickers(uint64 setId);
 int32 countStickersHash(bool checkOutdatedInfo = false);
 int32 countRecentStickersHash();
 int32 countFavedStickersHash();
@@ -201,15 +207,18 @@ public:
 	void writingMap();
 	void writeLocations(bool fast);
 	void writingLocations();
+	void readStickerSetsLater();
 	void finish();
 
 public slots:
 	void mapWriteTimeout();
 	void locationsWriteTimeout();
+	void stickerSetsReadTimeout();
 
 private:
 	QTimer _mapWriteTimer;
 	QTimer _locationsWriteTimer;
+	QTimer _stickerSetsReadTimer;
 
 };
 
@@ -0,0 +1,110 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/storage_cache_metrics.h"
+
+#include "data/data_types.h"
+
+#include <atomic>
+
+namespace Storage {
+namespace {
+
+struct AtomicMetrics {
+	std::atomic<uint64> hits = 0;
+	std::atomic<uint64> misses = 0;
+	std::atomic<uint64> writes = 0;
+	std::atomic<uint64> writtenBytes = 0;
+	std::atomic<int64> readDuration = 0;
+};
+
+std::array<AtomicMetrics, kCacheKindsCount> Metrics;
+
+[[nodiscard]] AtomicMetrics &MetricsRef(CacheKind kind) {
+	const auto index = int(kind);
+	Assert(index >= 0 && index < kCacheKindsCount);
+	return Metrics[index];
+}
+
+[[nodiscard]] QString KindName(CacheKind kind) {
+	switch (kind) {
+	case CacheKind::Image: return qsl("images");
+	case CacheKind::Sticker: return qsl("stickers");
+	case CacheKind::StreamingSlice: return qsl("streaming");
+	case CacheKind::Other: return qsl("other");
+	}
+	Unexpected("Kind in Storage::KindName.");
+}
+
+} // namespace
+
+CacheKind CacheKindFromTag(uint8 tag) {
+	switch (tag) {
+	case Data::kImageCacheTag: return CacheKind::Image;
+	case Data::kStickerCacheTag: return CacheKind::Sticker;
+	}
+	return CacheKind::Other;
+}
+
+float64 CacheMetrics::hitRate() const {
+	const auto reads = hits + misses;
+	return reads ? (hits / float64(reads)) : 0.;
+}
+
+float64 CacheMetrics::averageReadDuration() const {
+	const auto reads = hits + misses;
+	return reads ? (readDuration / float64(reads)) : 0.;
+}
+
+void CountCacheRead(CacheKind kind, bool hit, crl::time started) {
+	auto &metrics = MetricsRef(kind);
+	(hit ? metrics.hits : metrics.misses).fetch_add(
+		1,
+		std::memory_order_relaxed);
+	metrics.readDuration.fetch_add(
+		std::max(crl::now() - started, crl::time(0)),
+		std::memory_order_relaxed);
+}
+
+void CountCacheWrite(CacheKind kind, int64 size) {
+	auto &metrics = MetricsRef(kind);
+	metrics.writes.fetch_add(1, std::memory_order_relaxed);
+	metrics.writtenBytes.fetch_add(uint64(size), std::memory_order_relaxed);
+}
+
+CacheMetrics CacheMetricsFor(CacheKind kind) {
+	const auto &metrics = MetricsRef(kind);
+	auto result = CacheMetrics();
+	result.hits = metrics.hits.load(std::memory_order_relaxed);
+	result.misses = metrics.misses.load(std::memory_order_relaxed);
+	result.writes = metrics.writes.load(std::memory_order_relaxed);
+	result.writtenBytes = metrics.writtenBytes.load(
+		std::memory_order_relaxed);
+	result.readDuration = metrics.readDuration.load(
+		std::memory_order_relaxed);
+	return result;
+}
+
+QString CacheMetricsDescription() {
+	auto result = QStringList();
+	for (auto i = 0; i != kCacheKindsCount; ++i) {
+		const auto kind = CacheKind(i);
+		const auto metrics = CacheMetricsFor(kind);
+		result.push_back(qsl("%1: %2 hits, %3 misses (%4%), "
+			"%5 ms average read, %6 writes (%7 bytes)"
+			).arg(KindName(kind)
+			).arg(metrics.hits
+			).arg(metrics.misses
+			).arg(int(std::round(metrics.hitRate() * 100))
+			).arg(metrics.averageReadDuration(), 0, 'f', 1
+			).arg(metrics.writes
+			).arg(metrics.writtenBytes));
+	}
+	return result.join(qsl("; "));
+}
+
+} // namespace Storage
@@ -0,0 +1,40 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Storage {
+
+enum class CacheKind : uchar {
+	Image,
+	Sticker,
+	StreamingSlice,
+	Other,
+};
+inline constexpr auto kCacheKindsCount = 4;
+
+[[nodiscard]] CacheKind CacheKindFromTag(uint8 tag);
+
+struct CacheMetrics {
+	uint64 hits = 0;
+	uint64 misses = 0;
+	uint64 writes = 0;
+	uint64 writtenBytes = 0;
+	crl::time readDuration = 0; // Sum for all reads, hits and misses.
+
+	[[nodiscard]] float64 hitRate() const;
+	[[nodiscard]] float64 averageReadDuration() const;
+};
+
+// May be called from any thread, with the time the read was started at.
+void CountCacheRead(CacheKind kind, bool hit, crl::time started);
+void CountCacheWrite(CacheKind kind, int64 size);
+
+[[nodiscard]] CacheMetrics CacheMetricsFor(CacheKind kind);
+[[nodiscard]] QString CacheMetricsDescription();
+
+} // namespace Storage
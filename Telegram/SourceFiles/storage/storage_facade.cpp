@@ -26,6 +26,7 @@ public:
 	rpl::producer<SharedMediaRemoveOne> sharedMediaOneRemoved() const;
 	rpl::producer<SharedMediaRemoveAll> sharedMediaAllRemoved() const;
 	rpl::producer<SharedMediaInvalidateBottom> sharedMediaBottomInvalidated() const;
+	int64 sharedMediaEvictedBytes() const;
 
 	void add(UserPhotosAddNew &&query);
 	void add(UserPhotosAddSlice &&query);
@@ -99,6 +100,10 @@ rpl::producer<SharedMediaInvalidateBottom> Facade::Impl::sharedMediaBottomInvali
 	return _sharedMedia.bottomInvalidated();
 }
 
+int64 Facade::Impl::sharedMediaEvictedBytes() const {
+	return _sharedMedia.evictedBytes();
+}
+
 void Facade::Impl::add(UserPhotosAddNew &&query) {
 	return _userPhotos.add(std::move(query));
 }
@@ -219,6 +224,10 @@ rpl::producer<SharedMediaInvalidateBottom> Facade::sharedMediaBottomInvalidated(
 	return _impl->sharedMediaBottomInvalidated();
 }
 
+int64 Facade::sharedMediaEvictedBytes() const {
+	return _impl->sharedMediaEvictedBytes();
+}
+
 void Facade::add(UserPhotosAddNew &&query) {
 	return _impl->add(std::move(query));
 }
@@ -10,16 +10,22 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <rpl/map.h>
 
 namespace Storage {
+namespace {
 
-std::map<PeerId, SharedMedia::Lists>::iterator
-		SharedMedia::enforceLists(PeerId peer) {
+constexpr auto kMemoryBudget = int64(16 * 1024 * 1024);
+
+} // namespace
+
+SharedMedia::Iterator SharedMedia::enforceLists(PeerId peer) {
 	auto result = _lists.find(peer);
 	if (result != _lists.end()) {
+		markUsed(result->second);
 		return result;
 	}
-	result = _lists.emplace(peer, Lists {}).first;
+	result = _lists.try_emplace(peer).first;
+	markUsed(result->second);
 	for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
-		auto &list = result->second[index];
+		auto &list = result->second.lists[index];
 		auto type = static_cast<SharedMediaType>(index);
 
 		list.sliceUpdated(
@@ -28,20 +34,57 @@ std::map<PeerId, SharedMedia::Lists>::iterator
 				peer,
 				type,
 				update);
-		}) | rpl::start_to_stream(_sliceUpdated, _lifetime);
+		}) | rpl::start_to_stream(_sliceUpdated, result->second.lifetime);
 	}
 	return result;
 }
 
+void SharedMedia::markUsed(const Entry &entry) const {
+	entry.usedAt = ++_usedCounter;
+}
+
+// Evicted lists are requested from the server again, because queries
+// for them return nothing, the same as for a never opened peer.
+void SharedMedia::checkMemory(Iterator peerIt) {
+	auto &entry = peerIt->second;
+	_bytes -= entry.bytes;
+	entry.bytes = 0;
+	for (const auto &list : entry.lists) {
+		entry.bytes += list.memoryUsage();
+	}
+	_bytes += entry.bytes;
+
+	while (_bytes > kMemoryBudget) {
+		auto oldest = _lists.end();
+		for (auto i = _lists.begin(); i != _lists.end(); ++i) {
+			if (i != peerIt
+				&& (oldest == _lists.end()
+					|| i->second.usedAt < oldest->second.usedAt)) {
+				oldest = i;
+			}
+		}
+		if (oldest == _lists.end()) {
+			break;
+		}
+		DEBUG_LOG(("Shared Media: evicting %1 bytes of lists for peer %2."
+			).arg(oldest->second.bytes
+			).arg(oldest->first));
+		_bytes -= oldest->second.bytes;
+		_evictedBytes += oldest->second.bytes;
+		_lists.erase(oldest);
+	}
+}
+
 void SharedMedia::add(SharedMediaAddNew &&query) {
 	auto peer = query.peerId;
 	auto peerIt = enforceLists(peer);
 	for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 		auto type = static_cast<SharedMediaType>(index);
 		if (query.types.test(type)) {
-			peerIt->second[index].addNew(query.messageId);
+			peerIt->second.lists[index].addNew(query.messageId);
 		}
 	}
+	checkMemory(peerIt);
 }
 
 void SharedMedia::add(SharedMediaAddExisting &&query) {
@@ -49,9 +92,10 @@ void SharedMedia::add(SharedMediaAddExisting &&query) {
 	for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 		auto type = static_cast<SharedMediaType>(index);
 		if (query.types.test(type)) {
-			peerIt->second[index].addExisting(query.messageId, query.noSkipRange);
+			peerIt->second.lists[index].addExisting(query.messageId, query.noSkipRange);
 		}
 	}
+	checkMemory(peerIt);
 }
 
 void SharedMedia::add(SharedMediaAddSlice &&query) {
@@ -59,10 +103,11 @@ void SharedMedia::add(SharedMediaAddSlice &&query) {
 
 	auto peerIt = enforceLists(query.peerId);
 	auto index = static_cast<int>(query.type);
-	peerIt->second[index].addSlice(
+	peerIt->second.lists[index].addSlice(
 		std::move(query.messageIds),
 		query.noSkipRange,
 		query.count);
+	checkMemory(peerIt);
 }
 
 void SharedMedia::remove(SharedMediaRemoveOne &&query) {
@@ -71,9 +116,10 @@ void SharedMedia::remove(SharedMediaRemoveOne &&query) {
 		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 			auto type = static_cast<SharedMediaType>(index);
 			if (query.types.test(type)) {
-				peerIt->second[index].removeOne(query.messageId);
+				peerIt->second.lists[index].removeOne(query.messageId);
 			}
 		}
+		checkMemory(peerIt);
 		_oneRemoved.fire(std::move(query));
 	}
 }
@@ -82,8 +128,9 @@ void SharedMedia::remove(SharedMediaRemoveAll &&query) {
 	auto peerIt = _lists.find(query.peerId);
 	if (peerIt != _lists.end()) {
 		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
-			peerIt->second[index].removeAll();
+			peerIt->second.lists[index].removeAll();
 		}
+		checkMemory(peerIt);
 		_allRemoved.fire(std::move(query));
 	}
 }
@@ -92,7 +139,7 @@ void SharedMedia::invalidate(SharedMediaInvalidateBottom &&query) {
 	auto peerIt = _lists.find(query.peerId);
 	if (peerIt != _lists.end()) {
 		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
-			peerIt->second[index].invalidateBottom();
+			peerIt->second.lists[index].invalidateBottom();
 		}
 		_bottomInvalidated.fire(std::move(query));
 	}
@@ -102,8 +149,9 @@ rpl::producer<SharedMediaResult> SharedMedia::query(SharedMediaQuery &&query) co
 	Expects(IsValidSharedMediaType(query.key.type));
 	auto peerIt = _lists.find(query.key.peerId);
 	if (peerIt != _lists.end()) {
+		markUsed(peerIt->second);
 		auto index = static_cast<int>(query.key.type);
-		return peerIt->second[index].query(SparseIdsListQuery(
+		return peerIt->second.lists[index].query(SparseIdsListQuery(
 			query.key.messageId,
 			query.limitBefore,
 			query.limitAfter));
@@ -130,4 +178,8 @@ rpl::producer<SharedMediaInvalidateBottom> SharedMedia::bottomInvalidated() cons
 	return _bottomInvalidated.events();
 }
 
+int64 SharedMedia::evictedBytes() const {
+	return _evictedBytes;
+}
+
 } // namespace Storage
@@ -196,20 +196,33 @@ public:
 	rpl::producer<SharedMediaRemoveAll> allRemoved() const;
 	rpl::producer<SharedMediaInvalidateBottom> bottomInvalidated() const;
 
+	// Bytes of the lists dropped to stay in the memory budget.
+	[[nodiscard]] int64 evictedBytes() const;
+
 private:
 	using Lists = std::array<SparseIdsList, kSharedMediaTypeCount>;
-
-	std::map<PeerId, Lists>::iterator enforceLists(PeerId peer);
-
-	std::map<PeerId, Lists> _lists;
+	struct Entry {
+		Lists lists;
+		int64 bytes = 0;
+		mutable uint64 usedAt = 0;
+		rpl::lifetime lifetime;
+	};
+	using Iterator = std::map<PeerId, Entry>::iterator;
+
+	Iterator enforceLists(PeerId peer);
+	void markUsed(const Entry &entry) const;
+	void checkMemory(Iterator peerIt);
+
+	std::map<PeerId, Entry> _lists;
+	int64 _bytes = 0;
+	int64 _evictedBytes = 0;
+	mutable uint64 _usedCounter = 0;
 
 	rpl::event_stream<SharedMediaSliceUpdate> _sliceUpdated;
 	rpl::event_stream<SharedMediaRemoveOne> _oneRemoved;
 	rpl::event_stream<SharedMediaRemoveAll> _allRemoved;
 	rpl::event_stream<SharedMediaInvalidateBottom> _bottomInvalidated;
 
-	rpl::lifetime _lifetime;
-
 };
 
 } // namespace Storage
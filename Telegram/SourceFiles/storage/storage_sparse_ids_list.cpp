@@ -8,6 +8,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_sparse_ids_list.h"
 
 namespace Storage {
+namespace {
+
+// Merging a flat_set allocates a temporary buffer for all the ids,
+// inserting a few ids one by one only shifts the ids after them.
+constexpr auto kInsertOneByOneLimit = 16;
+
+} // namespace
 
 SparseIdsList::Slice::Slice(
 	base::flat_set<MsgId> &&messages,
@@ -23,7 +30,16 @@ void SparseIdsList::Slice::merge(
 	Expects(moreNoSkipRange.from <= range.till);
 	Expects(range.from <= moreNoSkipRange.till);
 
-	messages.merge(std::begin(moreMessages), std::end(moreMessages));
+	const auto from = std::begin(moreMessages);
+	const auto till = std::end(moreMessages);
+	const auto added = std::distance(from, till);
+	if (added <= kInsertOneByOneLimit) {
+		for (auto i = from; i != till; ++i) {
+			messages.insert(*i);
+		}
+	} else {
+		messages.merge(from, till);
+	}
 	range = {
 		qMin(range.from, moreNoSkipRange.from),
 		qMax(range.till, moreNoSkipRange.till)
@@ -204,6 +220,15 @@ rpl::producer<SparseIdsSliceUpdate> SparseIdsList::sliceUpdated() const {
 	return _sliceUpdated.events();
 }
 
+int64 SparseIdsList::memoryUsage() const {
+	auto result = int64(sizeof(SparseIdsList))
+		+ int64(_slices.size()) * int64(sizeof(Slice));
+	for (const auto &slice : _slices) {
+		result += int64(slice.messages.size()) * int64(sizeof(MsgId));
+	}
+	return result;
+}
+
 SparseIdsListResult SparseIdsList::queryFromSlice(
 		const SparseIdsListQuery &query,
 		const Slice &slice) const {
@@ -52,6 +52,9 @@ public:
 	rpl::producer<SparseIdsListResult> query(SparseIdsListQuery &&query) const;
 	rpl::producer<SparseIdsSliceUpdate> sliceUpdated() const;
 
+	// Approximate size of the stored ids in bytes.
+	[[nodiscard]] int64 memoryUsage() const;
+
 private:
 	struct Slice {
 		Slice(base::flat_set<MsgId> &&messages, MsgRange range);
@@ -566,10 +566,14 @@ void Templates::updateRequestFinished(QNetworkReply *reply) {
 	LOG(("Got template from url '%1'"
 		).arg(reply->url().toDisplayString()));
 	const auto content = reply->readAll();
+	const auto kept = _data.files.at(path);
 	crl::async([=, weak = base::make_weak(this)]{
 		auto result = ReadFromBlob(content);
 		auto one = TemplatesData();
 		one.files.emplace(path, std::move(result.result));
+
+		// The locally kept keys have the highest weight in the index.
+		MoveKeys(one.files.at(path), kept);
 		auto index = ComputeIndex(one);
 		crl::on_main(weak,[
 			=,
@@ -579,8 +583,7 @@ void Templates::updateRequestFinished(QNetworkReply *reply) {
 		]() mutable {
 			auto &existing = _data.files.at(path);
 			auto &parsed = one.files.at(path);
-			MoveKeys(parsed, existing);
-			ReplaceFileIndex(_index, ComputeIndex(one), path);
+			ReplaceFileIndex(_index, std::move(index), path);
 			if (!errors.isEmpty()) {
 				_errors.fire(std::move(errors));
 			}
@@ -10,6 +10,19 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Ui {
 namespace {
 
+constexpr auto kCachedLayoutsLimit = 64;
+
+struct CachedLayout {
+	std::vector<QSize> sizes;
+	int maxWidth = 0;
+	int minWidth = 0;
+	int spacing = 0;
+	std::vector<GroupMediaLayout> layout;
+};
+
+// Most recently used first, the search is cheaper than the layout itself.
+std::vector<CachedLayout> CachedLayouts;
+
 int Round(float64 value) {
 	return int(std::round(value));
 }
@@ -572,7 +585,25 @@ std::vector<GroupMediaLayout> LayoutMediaGroup(
 		int maxWidth,
 		int minWidth,
 		int spacing) {
-	return Layouter(sizes, maxWidth, minWidth, spacing).layout();
+	const auto i = ranges::find_if(CachedLayouts, [&](
+			const CachedLayout &cached) {
+		return (cached.maxWidth == maxWidth)
+			&& (cached.minWidth == minWidth)
+			&& (cached.spacing == spacing)
+			&& (cached.sizes == sizes);
+	});
+	if (i != end(CachedLayouts)) {
+		std::rotate(begin(CachedLayouts), i, i + 1);
+		return CachedLayouts.front().layout;
+	}
+	auto result = Layouter(sizes, maxWidth, minWidth, spacing).layout();
+	if (CachedLayouts.size() == kCachedLayoutsLimit) {
+		CachedLayouts.pop_back();
+	}
+	CachedLayouts.insert(
+		begin(CachedLayouts),
+		CachedLayout{ sizes, maxWidth, minWidth, spacing, result });
+	return result;
 }
 
 RectParts GetCornersFromSides(RectParts sides) {
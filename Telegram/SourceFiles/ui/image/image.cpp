@@ -8,7 +8,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/image/image.h"
 
 #include "ui/image/image_source.h"
+#include "ui/image/image_userpics.h"
 #include "core/media_active_cache.h"
+#include "core/paint_profiler.h"
 #include "storage/cache/storage_cache_database.h"
 #include "data/data_session.h"
 #include "data/data_file_origin.h"
@@ -21,15 +23,96 @@ using namespace Images;
 namespace Images {
 namespace {
 
-// After 128 MB of unpacked images we try to clear some memory.
-constexpr auto kMemoryForCache = 128 * 1024 * 1024;
-
 std::map<QString, std::unique_ptr<Image>> LocalFileImages;
 std::map<QString, std::unique_ptr<Image>> WebUrlImages;
 std::unordered_map<InMemoryKey, std::unique_ptr<Image>> StorageImages;
 std::unordered_map<InMemoryKey, std::unique_ptr<Image>> WebCachedImages;
 std::unordered_map<InMemoryKey, std::unique_ptr<Image>> GeoPointImages;
 
+constexpr auto kVariantsMemoryLimit = int64(64) * 1024 * 1024;
+constexpr auto kBlurInPlaceMaxArea = 100 * 100;
+
+uint64 BlurRequestId = 0;
+bool BlurRepaintScheduled = false;
+
+// Same as Images::prepare(), but the padding up to the outer size is
+// filled with the given color, palette can be read only on main thread.
+QImage PrepareWithBackground(
+		QImage data,
+		int w,
+		int h,
+		Options options,
+		int outerw,
+		int outerh,
+		QColor background) {
+	if (outerw <= 0 || outerh <= 0) {
+		return prepare(std::move(data), w, h, options, outerw, outerh);
+	}
+	const auto shape = Option::Circled
+		| Option::RoundedLarge
+		| Option::RoundedSmall;
+	auto image = prepare(std::move(data), w, h, options & ~shape, -1, -1);
+	outerw *= cIntRetinaFactor();
+	outerh *= cIntRetinaFactor();
+	if (outerw != image.width() || outerh != image.height()) {
+		auto result = QImage(
+			outerw,
+			outerh,
+			QImage::Format_ARGB32_Premultiplied);
+		result.setDevicePixelRatio(cRetinaFactor());
+		if (options & Option::TransparentBackground) {
+			result.fill(Qt::transparent);
+		}
+		{
+			QPainter p(&result);
+			if (image.width() < outerw || image.height() < outerh) {
+				p.fillRect(0, 0, result.width(), result.height(), background);
+			}
+			p.drawImage(
+				(result.width() - image.width()) / (2 * cIntRetinaFactor()),
+				(result.height() - image.height()) / (2 * cIntRetinaFactor()),
+				image);
+		}
+		image = std::move(result);
+	}
+	const auto corners = RectPart::None
+		| ((options & Option::RoundedTopLeft)
+			? RectPart::TopLeft
+			: RectPart::None)
+		| ((options & Option::RoundedTopRight)
+			? RectPart::TopRight
+			: RectPart::None)
+		| ((options & Option::RoundedBottomLeft)
+			? RectPart::BottomLeft
+			: RectPart::None)
+		| ((options & Option::RoundedBottomRight)
+			? RectPart::BottomRight
+			: RectPart::None);
+	if (options & Option::Circled) {
+		prepareCircle(image);
+	} else if (options & Option::RoundedLarge) {
+		prepareRound(image, ImageRoundRadius::Large, corners);
+	} else if (options & Option::RoundedSmall) {
+		prepareRound(image, ImageRoundRadius::Small, corners);
+	}
+	image.setDevicePixelRatio(cRetinaFactor());
+	return image;
+}
+
+// Many blurred variants can be ready at once, repaint them together.
+void ScheduleBlurRepaint() {
+	if (BlurRepaintScheduled) {
+		return;
+	}
+	BlurRepaintScheduled = true;
+	crl::on_main([] {
+		BlurRepaintScheduled = false;
+		if (Main::Session::Exists()) {
+			Auth().downloaderTaskFinished().notify();
+		}
+	});
+}
+
 int64 ComputeUsage(QSize size) {
 	return int64(size.width()) * size.height() * 4;
 }
@@ -44,11 +127,26 @@ int64 ComputeUsage(const QImage &image) {
 
 [[nodiscard]] Core::MediaActiveCache<const Image> &ActiveCache() {
 	static auto Instance = Core::MediaActiveCache<const Image>(
-		kMemoryForCache,
+		Core::MediaMemoryKind::Images,
 		[](const Image *image) { image->unload(); });
 	return Instance;
 }
 
+// Scaled, rounded, blurred and colored pixmaps of an image are counted
+// apart from the originals and are dropped before them when not painted.
+[[nodiscard]] Core::MediaActiveCache<const Image> &VariantsCache() {
+	static auto Instance = Core::MediaActiveCache<const Image>(
+		Core::MediaMemoryKind::ImageVariants,
+		[](const Image *image) { image->unloadVariants(); });
+	[[maybe_unused]] static const auto Limited = [] {
+		Core::SetMediaMemoryKindLimit(
+			Core::MediaMemoryKind::ImageVariants,
+			kVariantsMemoryLimit);
+		return true;
+	}();
+	return Instance;
+}
+
 uint64 PixKey(int width, int height, Options options) {
 	return static_cast<uint64>(width)
 		| (static_cast<uint64>(height) << 24)
@@ -59,8 +157,79 @@ uint64 SinglePixKey(Options options) {
 	return PixKey(0, 0, options);
 }
 
+// Puts each of the four 8 bit channels of a pixel in its own 16 bit lane,
+// so that four pixels are summed channel-wise with plain 64 bit additions.
+inline uint64 SpreadChannels(uint32 pixel) {
+	return (uint64(pixel) | (uint64(pixel) << 24)) & 0x00FF00FF00FF00FFULL;
+}
+
+inline uint32 PackChannels(uint64 lanes) {
+	lanes &= 0x00FF00FF00FF00FFULL;
+	return uint32(lanes) | uint32(lanes >> 24);
+}
+
+[[nodiscard]] bool CanHalve(QImage::Format format) {
+	return (format == QImage::Format_RGB32)
+		|| (format == QImage::Format_ARGB32_Premultiplied);
+}
+
+[[nodiscard]] QImage Halve(const QImage &image) {
+	Expects(CanHalve(image.format()));
+
+	constexpr auto kRounding = 0x0002000200020002ULL;
+
+	const auto width = image.width() / 2;
+	const auto height = image.height() / 2;
+	auto result = QImage(width, height, image.format());
+	for (auto y = 0; y != height; ++y) {
+		const auto top = reinterpret_cast<const uint32*>(
+			image.constScanLine(2 * y));
+		const auto bottom = reinterpret_cast<const uint32*>(
+			image.constScanLine(2 * y + 1));
+		const auto to = reinterpret_cast<uint32*>(result.scanLine(y));
+		for (auto x = 0; x != width; ++x) {
+			const auto sum = SpreadChannels(top[2 * x])
+				+ SpreadChannels(top[2 * x + 1])
+				+ SpreadChannels(bottom[2 * x])
+				+ SpreadChannels(bottom[2 * x + 1]);
+			to[x] = PackChannels((sum + kRounding) >> 2);
+		}
+	}
+	return result;
+}
+
 } // namespace
 
+QImage Downscale(
+		QImage image,
+		int width,
+		int height,
+		Qt::AspectRatioMode mode) {
+	const auto size = image.size().scaled(width, height, mode);
+	if (size.isEmpty() || size == image.size()) {
+		return image;
+	}
+	const auto halve = [&] {
+		return (image.width() >= 4 * size.width())
+			&& (image.height() >= 4 * size.height());
+	};
+	if (halve()) {
+		if (image.format() == QImage::Format_ARGB32) {
+			image = std::move(image).convertToFormat(
+				QImage::Format_ARGB32_Premultiplied);
+		}
+		if (CanHalve(image.format())) {
+			do {
+				image = Halve(image);
+			} while (halve());
+		}
+	}
+	return image.scaled(
+		size,
+		Qt::IgnoreAspectRatio,
+		Qt::SmoothTransformation);
+}
+
 void ClearRemote() {
 	base::take(StorageImages);
 	base::take(WebUrlImages);
@@ -70,6 +239,8 @@ void ClearRemote() {
 
 void ClearAll() {
 	ActiveCache().clear();
+	VariantsCache().clear();
+	ClearUserpics();
 	base::take(LocalFileImages);
 	ClearRemote();
 }
@@ -561,8 +732,9 @@ const QPixmap &Image::pix(
 		auto p = pixNoCache(origin, w, h, options);
 		p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+		VariantsCache().increment(ComputeUsage(*i));
 	}
+	VariantsCache().up(this);
 	return i.value();
 }
 
@@ -600,8 +772,9 @@ const QPixmap &Image::pixRounded(
 		auto p = pixNoCache(origin, w, h, options);
 		p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+		VariantsCache().increment(ComputeUsage(*i));
 	}
+	VariantsCache().up(this);
 	return i.value();
 }
 
@@ -624,8 +797,9 @@ const QPixmap &Image::pixCircled(
 		auto p = pixNoCache(origin, w, h, options);
 		p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+		VariantsCache().increment(ComputeUsage(*i));
 	}
+	VariantsCache().up(this);
 	return i.value();
 }
 
@@ -645,11 +819,9 @@ const QPixmap &Image::pixBlurredCircled(
 	auto k = PixKey(w, h, options);
 	auto i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+		i = insertBlurred(origin, k, w, h, options);
 	}
+	VariantsCache().up(this);
 	return i.value();
 }
 
@@ -669,11 +841,9 @@ const QPixmap &Image::pixBlurred(
 	auto k = PixKey(w, h, options);
 	auto i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+		i = insertBlurred(origin, k, w, h, options);
 	}
+	VariantsCache().up(this);
 	return i.value();
 }
 
@@ -697,8 +867,9 @@ const QPixmap &Image::pixColored(
 		auto p = pixColoredNoCache(origin, add, w, h, true);
 		p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+		VariantsCache().increment(ComputeUsage(*i));
 	}
+	VariantsCache().up(this);
 	return i.value();
 }
 
@@ -722,8 +893,9 @@ const QPixmap &Image::pixBlurredColored(
 		auto p = pixBlurredColoredNoCache(origin, add, w, h);
 		p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+		VariantsCache().increment(ComputeUsage(*i));
 	}
+	VariantsCache().up(this);
 	return i.value();
 }
 
@@ -767,13 +939,14 @@ const QPixmap &Image::pixSingle(
 	auto i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
 		if (i != _sizesCache.cend()) {
-			ActiveCache().decrement(ComputeUsage(*i));
+			VariantsCache().decrement(ComputeUsage(*i));
 		}
 		auto p = pixNoCache(origin, w, h, options, outerw, outerh, colored);
 		p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+		VariantsCache().increment(ComputeUsage(*i));
 	}
+	VariantsCache().up(this);
 	return i.value();
 }
 
@@ -813,16 +986,83 @@ const QPixmap &Image::pixBlurredSingle(
 	auto i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
 		if (i != _sizesCache.cend()) {
-			ActiveCache().decrement(ComputeUsage(*i));
+			VariantsCache().decrement(ComputeUsage(*i));
 		}
-		auto p = pixNoCache(origin, w, h, options, outerw, outerh);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+		i = insertBlurred(origin, k, w, h, options, outerw, outerh);
 	}
+	VariantsCache().up(this);
 	return i.value();
 }
 
+auto Image::insertBlurred(
+		Data::FileOrigin origin,
+		uint64 key,
+		int w,
+		int h,
+		Options options,
+		int outerw,
+		int outerh) const -> SizesCache::const_iterator {
+	const auto area = int64(std::max(w, outerw * cIntRetinaFactor()))
+		* std::max(h > 0 ? h : w, outerh * cIntRetinaFactor());
+	const auto inPlace = (area <= kBlurInPlaceMaxArea);
+
+	// Until the blur is ready the smoothly scaled image is painted,
+	// for the small thumbnails used as placeholders it looks close.
+	auto p = pixNoCache(
+		origin,
+		w,
+		h,
+		inPlace ? options : (options & ~Option::Blurred),
+		outerw,
+		outerh);
+	p.setDevicePixelRatio(cRetinaFactor());
+	const auto result = _sizesCache.insert(key, p);
+	VariantsCache().increment(ComputeUsage(*result));
+	if (inPlace || _data.isNull()) {
+		_blurring.remove(key);
+		return result;
+	}
+	const auto request = ++BlurRequestId;
+	_blurring[key] = request;
+	const auto weak = base::make_weak(const_cast<Image*>(this));
+	const auto background = st::imageBg->c;
+	crl::async([=, data = _data] {
+		auto image = PrepareWithBackground(
+			data,
+			w,
+			h,
+			options,
+			outerw,
+			outerh,
+			background);
+		crl::on_main(weak, [=, image = std::move(image)]() mutable {
+			weak->applyBlurred(key, request, std::move(image));
+		});
+	});
+	return result;
+}
+
+void Image::applyBlurred(
+		uint64 key,
+		uint64 request,
+		QImage &&image) const {
+	const auto i = _blurring.find(key);
+	if (i == end(_blurring) || i->second != request) {
+		return;
+	}
+	_blurring.erase(i);
+	const auto j = _sizesCache.find(key);
+	if (j == _sizesCache.end()) {
+		return;
+	}
+	auto &cache = VariantsCache();
+	cache.decrement(ComputeUsage(*j));
+	*j = App::pixmapFromImageInPlace(std::move(image));
+	j->setDevicePixelRatio(cRetinaFactor());
+	cache.increment(ComputeUsage(*j));
+	ScheduleBlurRepaint();
+}
+
 QPixmap Image::pixNoCache(
 		Data::FileOrigin origin,
 		int w,
@@ -842,6 +1082,9 @@ QPixmap Image::pixNoCache(
 		}
 		return Empty()->pixNoCache(origin, w, h, options, outerw, outerh);
 	}
+	const auto profile = Core::PaintProfilerScope(
+		"Image::pixNoCache",
+		Core::PaintZone::Image);
 
 	if (isNull() && outerw > 0 && outerh > 0) {
 		outerw *= cIntRetinaFactor();
@@ -1001,12 +1244,18 @@ void Image::setImageBytes(const QByteArray &bytes) {
 	checkSource();
 }
 
+void Image::unloadVariants() const {
+	invalidateSizeCache();
+}
+
 void Image::invalidateSizeCache() const {
-	auto &cache = ActiveCache();
+	auto &cache = VariantsCache();
 	for (const auto &image : std::as_const(_sizesCache)) {
 		cache.decrement(ComputeUsage(image));
 	}
 	_sizesCache.clear();
+	_blurring.clear();
+	cache.remove(this);
 }
 
 Image::~Image() {
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "ui/image/image_prepare.h"
+#include "base/weak_ptr.h"
 
 class HistoryItem;
 
@@ -16,6 +17,15 @@ namespace Images {
 void ClearRemote();
 void ClearAll();
 
+// Same result size as QImage::scaled with Qt::SmoothTransformation, but
+// big images are first halved with an exact 2x2 box filter until they are
+// at most four times larger than the result, which is much cheaper.
+[[nodiscard]] QImage Downscale(
+	QImage image,
+	int width,
+	int height,
+	Qt::AspectRatioMode mode = Qt::IgnoreAspectRatio);
+
 ImagePtr Create(const QString &file, QByteArray format);
 ImagePtr Create(const QString &url, QSize box);
 ImagePtr Create(const QString &url, int width, int height);
@@ -59,6 +69,7 @@ public:
 	virtual void load(Data::FileOrigin origin) = 0;
 	virtual void loadEvenCancelled(Data::FileOrigin origin) = 0;
 	virtual QImage takeLoaded() = 0;
+	virtual QImage preview() = 0;
 	virtual void unload() = 0;
 
 	virtual void automaticLoad(
@@ -92,7 +103,7 @@ public:
 
 } // namespace Images
 
-class Image final {
+class Image final : public base::has_weak_ptr {
 public:
 	explicit Image(std::unique_ptr<Images::Source> &&source);
 
@@ -103,6 +114,11 @@ public:
 
 	QImage original() const;
 
+	// Partially decoded content while the image is still loading.
+	QImage preview() const {
+		return _source->preview();
+	}
+
 	const QPixmap &pix(
 		Data::FileOrigin origin,
 		int32 w = 0,
@@ -225,6 +241,7 @@ public:
 	bool loaded() const;
 	bool isNull() const;
 	void unload() const;
+	void unloadVariants() const;
 	void setDelayedStorageLocation(
 		Data::FileOrigin origin,
 		const StorageImageLocation &location);
@@ -233,11 +250,23 @@ public:
 	~Image();
 
 private:
+	using SizesCache = QMap<uint64, QPixmap>;
+
 	void checkSource() const;
 	void invalidateSizeCache() const;
+	SizesCache::const_iterator insertBlurred(
+		Data::FileOrigin origin,
+		uint64 key,
+		int w,
+		int h,
+		Images::Options options,
+		int outerw = -1,
+		int outerh = -1) const;
+	void applyBlurred(uint64 key, uint64 request, QImage &&image) const;
 
 	std::unique_ptr<Images::Source> _source;
-	mutable QMap<uint64, QPixmap> _sizesCache;
+	mutable SizesCache _sizesCache;
+	mutable base::flat_map<uint64, uint64> _blurring;
 	mutable QImage _data;
 
 };
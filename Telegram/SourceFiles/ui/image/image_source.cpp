@@ -18,9 +18,31 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "app.h"
 
 #include <QtCore/QBuffer>
+#include <QtGui/QImageReader>
 
 namespace Images {
 
+QImage ReadScaled(QByteArray bytes, QSize box, QByteArray *format) {
+	auto buffer = QBuffer(&bytes);
+	auto reader = QImageReader(&buffer, format ? *format : QByteArray());
+#ifndef OS_MAC_OLD
+	reader.setAutoTransform(true);
+#endif // OS_MAC_OLD
+	const auto size = reader.size();
+	if (size.isValid()
+		&& (size.width() > box.width() || size.height() > box.height())) {
+		reader.setScaledSize(size.scaled(box, Qt::KeepAspectRatio));
+	}
+	auto result = QImage();
+	if (!reader.read(&result)) {
+		return QImage();
+	}
+	if (format) {
+		*format = reader.format();
+	}
+	return result;
+}
+
 ImageSource::ImageSource(QImage &&data, const QByteArray &format)
 : _data(std::move(data))
 , _format(format)
@@ -43,6 +65,10 @@ QImage ImageSource::takeLoaded() {
 	return _data;
 }
 
+QImage ImageSource::preview() {
+	return QImage();
+}
+
 void ImageSource::unload() {
 	if (_bytes.isEmpty() && !_data.isNull()) {
 		if (_format != "JPG") {
@@ -145,11 +171,13 @@ LocalFileSource::LocalFileSource(
 	const QString &path,
 	const QByteArray &content,
 	const QByteArray &format,
-	QImage &&data)
+	QImage &&data,
+	QSize box)
 : _path(path)
 , _bytes(content)
 , _format(format)
 , _data(std::move(data))
+, _box(box)
 , _width(_data.width())
 , _height(_data.height()) {
 }
@@ -168,7 +196,9 @@ void LocalFileSource::load(Data::FileOrigin origin) {
 		}
 	}
 	if (_bytes != "(bad)") {
-		_data = App::readImage(_bytes, &_format, false, nullptr);
+		_data = _box.isEmpty()
+			? App::readImage(_bytes, &_format, false, nullptr)
+			: ReadScaled(_bytes, _box, &_format);
 	}
 	_width = std::max(_data.width(), 1);
 	_height = std::max(_data.height(), 1);
@@ -182,6 +212,10 @@ QImage LocalFileSource::takeLoaded() {
 	return std::move(_data);
 }
 
+QImage LocalFileSource::preview() {
+	return QImage();
+}
+
 void LocalFileSource::unload() {
 	_data = QImage();
 }
@@ -283,6 +317,9 @@ QImage RemoteSource::takeLoaded() {
 		_cancelled = true;
 		destroyLoader();
 		return QImage();
+	} else if (!_loader->prepareImageData(shrinkBox())) {
+		// The image is painted with the thumbnail until it is decoded.
+		return QImage();
 	}
 	auto data = _loader->imageData(shrinkBox());
 	if (data.isNull()) {
@@ -297,6 +334,10 @@ QImage RemoteSource::takeLoaded() {
 	return data;
 }
 
+QImage RemoteSource::preview() {
+	return _loader ? _loader->preview() : QImage();
+}
+
 void RemoteSource::destroyLoader() {
 	if (!_loader) {
 		return;
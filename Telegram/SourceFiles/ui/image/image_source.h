@@ -11,6 +11,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Images {
 
+// Decodes the image to fit inside the box, letting the format plugin
+// produce the smaller size directly when it supports scaled reading.
+[[nodiscard]] QImage ReadScaled(
+	QByteArray bytes,
+	QSize box,
+	QByteArray *format = nullptr);
+
 class ImageSource : public Source {
 public:
 	ImageSource(QImage &&data, const QByteArray &format);
@@ -18,6 +25,7 @@ public:
 	void load(Data::FileOrigin origin) override;
 	void loadEvenCancelled(Data::FileOrigin origin) override;
 	QImage takeLoaded() override;
+	QImage preview() override;
 	void unload() override;
 
 	void automaticLoad(
@@ -62,11 +70,13 @@ public:
 		const QString &path,
 		const QByteArray &content = QByteArray(),
 		const QByteArray &format = QByteArray(),
-		QImage &&data = QImage());
+		QImage &&data = QImage(),
+		QSize box = QSize());
 
 	void load(Data::FileOrigin origin) override;
 	void loadEvenCancelled(Data::FileOrigin origin) override;
 	QImage takeLoaded() override;
+	QImage preview() override;
 	void unload() override;
 
 	void automaticLoad(
@@ -103,6 +113,7 @@ private:
 	QByteArray _bytes;
 	QByteArray _format;
 	QImage _data;
+	QSize _box;
 	int _width = 0;
 	int _height = 0;
 
@@ -113,6 +124,7 @@ public:
 	void load(Data::FileOrigin origin) override;
 	void loadEvenCancelled(Data::FileOrigin origin) override;
 	QImage takeLoaded() override;
+	QImage preview() override;
 	void unload() override;
 
 	void automaticLoad(
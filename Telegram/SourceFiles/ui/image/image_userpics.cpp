@@ -0,0 +1,108 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/image/image_userpics.h"
+
+#include <list>
+#include <map>
+
+namespace Images {
+namespace {
+
+constexpr auto kUserpicsMemoryLimit = 16 * 1024 * 1024;
+
+struct UserpicKey {
+	InMemoryKey key;
+	int size = 0;
+	int ratio = 0;
+	UserpicShape shape = UserpicShape();
+
+	friend inline bool operator<(const UserpicKey &a, const UserpicKey &b) {
+		return std::tie(a.key, a.size, a.ratio, a.shape)
+			< std::tie(b.key, b.size, b.ratio, b.shape);
+	}
+};
+
+struct Userpic {
+	UserpicKey key;
+	QPixmap pixmap;
+};
+
+struct Userpics {
+	std::list<Userpic> used; // The most recently used first.
+	std::map<UserpicKey, std::list<Userpic>::iterator> index;
+	int64 memory = 0;
+};
+
+[[nodiscard]] Userpics &Cache() {
+	static auto Instance = Userpics();
+	return Instance;
+}
+
+[[nodiscard]] int64 ComputeUsage(const QPixmap &pixmap) {
+	return int64(pixmap.width()) * pixmap.height() * 4;
+}
+
+[[nodiscard]] UserpicKey MakeKey(
+		const InMemoryKey &key,
+		int size,
+		UserpicShape shape) {
+	return { key, size, cIntRetinaFactor(), shape };
+}
+
+void RemoveLeastUsed(Userpics &cache) {
+	while (cache.memory > kUserpicsMemoryLimit && cache.used.size() > 1) {
+		const auto &last = cache.used.back();
+		cache.memory -= ComputeUsage(last.pixmap);
+		cache.index.erase(last.key);
+		cache.used.pop_back();
+	}
+}
+
+} // namespace
+
+const QPixmap *LookupUserpic(
+		const InMemoryKey &key,
+		int size,
+		UserpicShape shape) {
+	auto &cache = Cache();
+	const auto i = cache.index.find(MakeKey(key, size, shape));
+	if (i == end(cache.index)) {
+		return nullptr;
+	}
+	cache.used.splice(begin(cache.used), cache.used, i->second);
+	return &i->second->pixmap;
+}
+
+const QPixmap &RememberUserpic(
+		const InMemoryKey &key,
+		int size,
+		UserpicShape shape,
+		QPixmap pixmap) {
+	auto &cache = Cache();
+	const auto full = MakeKey(key, size, shape);
+	const auto i = cache.index.find(full);
+	if (i != end(cache.index)) {
+		cache.memory -= ComputeUsage(i->second->pixmap);
+		cache.used.erase(i->second);
+		cache.index.erase(i);
+	}
+	cache.memory += ComputeUsage(pixmap);
+	cache.used.push_front({ full, std::move(pixmap) });
+	cache.index.emplace(full, begin(cache.used));
+	RemoveLeastUsed(cache);
+	return cache.used.front().pixmap;
+}
+
+void ClearUserpics() {
+	auto &cache = Cache();
+	cache.index.clear();
+	cache.used.clear();
+	cache.memory = 0;
+}
+
+} // namespace Images
@@ -0,0 +1,35 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "ui/image/image_location.h"
+
+namespace Images {
+
+enum class UserpicShape : uchar {
+	Square,
+	Rounded,
+	RoundedLarge,
+	Circled,
+};
+
+// Prepared userpics are shared by every place painting the same picture
+// with the same size and shape. They outlive the unloaded originals and
+// are dropped least recently used first above a fixed memory budget.
+[[nodiscard]] const QPixmap *LookupUserpic(
+	const InMemoryKey &key,
+	int size,
+	UserpicShape shape);
+const QPixmap &RememberUserpic(
+	const InMemoryKey &key,
+	int size,
+	UserpicShape shape,
+	QPixmap pixmap);
+void ClearUserpics();
+
+} // namespace Images
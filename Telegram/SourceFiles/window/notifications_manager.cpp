@@ -353,6 +353,8 @@ void System::showNext() {
 				_waitTimer.callOnce(next - ms);
 				break;
 			} else {
+				notifyItem = skipToLastInBurst(notifyHistory, ms);
+
 				const auto isForwarded = notifyItem->Has<HistoryMessageForwarded>();
 				const auto isAlbum = notifyItem->groupId();
 
@@ -449,6 +451,32 @@ void System::showNext() {
 	}
 }
 
+// When many messages from one chat are due at once, show only the last.
+HistoryItem *System::skipToLastInBurst(
+		not_null<History*> history,
+		crl::time now) {
+	const auto grouped = [](not_null<HistoryItem*> item) {
+		return item->Has<HistoryMessageForwarded>() || item->groupId();
+	};
+	const auto j = _whenMaps.find(history);
+	while (true) {
+		const auto current = history->currentNotification();
+		const auto next = history->nextNotification();
+		if (j == _whenMaps.end()
+			|| !next
+			|| grouped(current)
+			|| grouped(next)) {
+			return current;
+		}
+		const auto k = j.value().constFind(next->id);
+		if (k == j.value().cend() || k.value() > now) {
+			return current;
+		}
+		j.value().remove(current->id);
+		history->skipNotification();
+	}
+}
+
 void System::ensureSoundCreated() {
 	if (_soundTrack) {
 		return;
@@ -97,6 +97,9 @@ private:
 
 	void showNext();
 	void showGrouped();
+	[[nodiscard]] HistoryItem *skipToLastInBurst(
+		not_null<History*> history,
+		crl::time now);
 	void ensureSoundCreated();
 
 	not_null<Main::Session*> _session;
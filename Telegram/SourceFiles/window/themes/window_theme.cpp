@@ -39,6 +39,7 @@ constexpr auto kThemeFileSizeLimit = 5 * 1024 * 1024;
 constexpr auto kBackgroundSizeLimit = 25 * 1024 * 1024;
 constexpr auto kNightThemeFile = ":/gui/night.tdesktop-theme"_cs;
 constexpr auto kMinimumTiledSize = 512;
+constexpr auto kPreparedBackgroundsCount = 2;
 
 struct Applying {
 	Saved data;
@@ -660,13 +661,15 @@ void ChatBackground::set(const Data::WallPaper &paper, QImage image) {
 				: image));
 		if (const auto fill = _paper.backgroundColor()) {
 			if (_paper.isPattern() && !image.isNull()) {
-				auto prepared = validateBackgroundImage(
-					Data::PreparePatternImage(
-						image,
-						*fill,
-						Data::PatternColor(*fill),
-						_paper.patternIntensity()));
-				setPreparedImage(std::move(image), std::move(prepared));
+				if (!applyPrepared(image)) {
+					auto prepared = validateBackgroundImage(
+						Data::PreparePatternImage(
+							image,
+							*fill,
+							Data::PatternColor(*fill),
+							_paper.patternIntensity()));
+					setPreparedImage(std::move(image), std::move(prepared));
+				}
 			} else {
 				_original = QImage();
 				_pixmap = QPixmap();
@@ -699,14 +702,61 @@ void ChatBackground::setPreparedImage(QImage original, QImage prepared) {
 	Expects(prepared.format() == QImage::Format_ARGB32_Premultiplied);
 	Expects(prepared.width() > 0 && prepared.height() > 0);
 
+	if (applyPrepared(original)) {
+		return;
+	}
+	const auto key = preparedKey(original);
 	_original = std::move(original);
 	if (!_paper.isPattern() && _paper.isBlurred()) {
 		prepared = Data::PrepareBlurredBackground(std::move(prepared));
 	}
+	auto average = std::optional<QColor>();
 	if (adjustPaletteRequired()) {
-		adjustPaletteUsingBackground(prepared);
+		average = CountAverageColor(prepared);
+		adjustPaletteUsingColor(*average);
 	}
 	preparePixmaps(std::move(prepared));
+
+	_prepared.erase(
+		ranges::remove(_prepared, key, &Prepared::key),
+		end(_prepared));
+	if (_prepared.size() == kPreparedBackgroundsCount) {
+		_prepared.erase(begin(_prepared));
+	}
+	_prepared.push_back({
+		key,
+		average,
+		_isMonoColorImage,
+		_pixmap,
+		_pixmapForTiled });
+}
+
+auto ChatBackground::preparedKey(const QImage &original) const
+-> PreparedKey {
+	return {
+		original.cacheKey(),
+		_paper.backgroundColor(),
+		_paper.patternIntensity(),
+		_paper.isPattern(),
+		_paper.isBlurred()
+	};
+}
+
+bool ChatBackground::applyPrepared(QImage &original) {
+	const auto key = preparedKey(original);
+	const auto i = ranges::find(_prepared, key, &Prepared::key);
+	const auto adjust = adjustPaletteRequired();
+	if (i == end(_prepared) || (adjust && !i->average)) {
+		return false;
+	}
+	_original = std::move(original);
+	if (adjust) {
+		adjustPaletteUsingColor(*i->average);
+	}
+	_isMonoColorImage = i->isMonoColorImage;
+	_pixmap = i->pixmap;
+	_pixmapForTiled = i->pixmapForTiled;
+	return true;
 }
 
 void ChatBackground::preparePixmaps(QImage image) {
@@ -789,10 +839,6 @@ void ChatBackground::clearEditingTheme(ClearEditing clear) {
 	}
 }
 
-void ChatBackground::adjustPaletteUsingBackground(const QImage &image) {
-	adjustPaletteUsingColor(CountAverageColor(image));
-}
-
 void ChatBackground::adjustPaletteUsingColor(QColor color) {
 	const auto prepared = color.toHsl();
 	for (const auto &adjustable : _adjustableColors) {
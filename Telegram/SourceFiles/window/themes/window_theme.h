@@ -176,16 +176,39 @@ private:
 		style::color item;
 		QColor original;
 	};
+	struct PreparedKey {
+		qint64 original = 0;
+		std::optional<QColor> fill;
+		int intensity = 0;
+		bool pattern = false;
+		bool blurred = false;
+
+		inline bool operator==(const PreparedKey &other) const {
+			return (original == other.original)
+				&& (fill == other.fill)
+				&& (intensity == other.intensity)
+				&& (pattern == other.pattern)
+				&& (blurred == other.blurred);
+		}
+	};
+	struct Prepared {
+		PreparedKey key;
+		std::optional<QColor> average;
+		bool isMonoColorImage = false;
+		QPixmap pixmap;
+		QPixmap pixmapForTiled;
+	};
 
 	void ensureStarted();
 	void saveForRevert();
 	void setPreparedImage(QImage original, QImage prepared);
+	[[nodiscard]] PreparedKey preparedKey(const QImage &original) const;
+	bool applyPrepared(QImage &original);
 	void preparePixmaps(QImage image);
 	void writeNewBackgroundSettings();
 	void setPaper(const Data::WallPaper &paper);
 
 	[[nodiscard]] bool adjustPaletteRequired();
-	void adjustPaletteUsingBackground(const QImage &image);
 	void adjustPaletteUsingColor(QColor color);
 	void restoreAdjustableColors();
 
@@ -227,6 +250,10 @@ private:
 
 	bool _isMonoColorImage = false;
 
+	// A couple of last prepared backgrounds, so that toggling night mode
+	// or testing a theme doesn't blur and tile the same image again.
+	std::vector<Prepared> _prepared;
+
 	Object _themeObject;
 	QImage _themeImage;
 	bool _themeTile = false;
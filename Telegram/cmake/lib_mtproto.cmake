@@ -25,8 +25,13 @@ PRIVATE
     mtproto/details/mtproto_domain_resolver.h
     mtproto/details/mtproto_dump_to_text.cpp
     mtproto/details/mtproto_dump_to_text.h
+    mtproto/details/mtproto_gzip_unpacker.cpp
+    mtproto/details/mtproto_gzip_unpacker.h
     mtproto/details/mtproto_received_ids_manager.cpp
     mtproto/details/mtproto_received_ids_manager.h
+    mtproto/details/mtproto_requests_map.h
+    mtproto/details/mtproto_rpc_stats.cpp
+    mtproto/details/mtproto_rpc_stats.h
     mtproto/details/mtproto_rsa_public_key.cpp
     mtproto/details/mtproto_rsa_public_key.h
     mtproto/details/mtproto_serialized_request.cpp
@@ -35,6 +40,8 @@ PRIVATE
     mtproto/details/mtproto_tcp_socket.h
     mtproto/details/mtproto_tls_socket.cpp
     mtproto/details/mtproto_tls_socket.h
+    mtproto/details/mtproto_trace.cpp
+    mtproto/details/mtproto_trace.h
     mtproto/mtproto_auth_key.cpp
     mtproto/mtproto_auth_key.h
     mtproto/mtproto_concurrent_sender.cpp